@@ -18,6 +18,7 @@
 #include <omp.h>
 
 #include <algorithm>
+#include <cstring>
 
 namespace
 {
@@ -61,3 +62,30 @@ void vtk::detail::smp::vtkSMPTools_Impl_For_OpenMP(vtkIdType first,
     functorExecuter(functor, from, grain, last);
     }
 }
+
+bool vtkSMPTools::SetBackend(const char* backend)
+{
+  if (backend && strcmp(backend, "OpenMP") == 0)
+    {
+    return true;
+    }
+  vtkGenericWarningMacro("SMP backend " << (backend ? backend : "(none)")
+                         << " is not available, using OpenMP.");
+  return false;
+}
+
+const char* vtkSMPTools::GetBackend()
+{
+  return "OpenMP";
+}
+
+void vtkSMPTools::SetNestedParallelism(bool isNested)
+{
+  // Values above the supported number of levels are clamped by OpenMP.
+  omp_set_max_active_levels(isNested ? VTK_INT_MAX : 1);
+}
+
+bool vtkSMPTools::GetNestedParallelism()
+{
+  return omp_get_max_active_levels() > 1;
+}
@@ -0,0 +1,671 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkSMPTools.cxx
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+
+#include "vtkSMPTools.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Implementation based on a persistent pool of std::thread workers.
+//
+// Each call to For() publishes a job: the range is cut into chunks of grain
+// iterations and the chunks are claimed with a single atomic counter per
+// job. The calling thread works on its own job while idle workers claim
+// chunks from the same counter of the most recently published job that has
+// some left. There are no per-thread queues and no stealing between them.
+// When a loop body calls For() again, the nested job is
+// published in the same way and executed by the same pool, so nested
+// parallelism never creates additional threads. A thread that waits for
+// the helpers of its job only helps with jobs nested in that job, which
+// keeps the thread local state of the outer loop body consistent.
+//
+// OpenMP and TBB may also be selected at run time when VTK is configured
+// with VTK_SMP_ENABLE_OPENMP or VTK_SMP_ENABLE_TBB.
+
+namespace vtk
+{
+namespace detail
+{
+namespace smp
+{
+#ifdef VTK_SMP_ENABLE_OPENMP
+void vtkSMPTools_Impl_For_OpenMPBackend(vtkIdType first, vtkIdType last,
+  vtkIdType grain, ExecuteFunctorPtrType functorExecuter, void *functor);
+void InitializeOpenMPBackend(int numThreads);
+int GetNumberOfThreadsOpenMPBackend();
+void SetNestedParallelismOpenMPBackend(bool isNested);
+#endif
+#ifdef VTK_SMP_ENABLE_TBB
+void vtkSMPTools_Impl_For_TBBBackend(vtkIdType first, vtkIdType last,
+  vtkIdType grain, ExecuteFunctorPtrType functorExecuter, void *functor);
+void InitializeTBBBackend(int numThreads);
+int GetNumberOfThreadsTBBBackend();
+#endif
+}
+}
+}
+
+using vtk::detail::smp::ExecuteFunctorPtrType;
+
+namespace
+{
+
+enum BackendType
+{
+  SEQUENTIAL_BACKEND,
+  STDTHREAD_BACKEND,
+  OPENMP_BACKEND,
+  TBB_BACKEND
+};
+
+const char* const BackendNames[] =
+{
+  "Sequential",
+  "STDThread",
+  "OpenMP",
+  "TBB"
+};
+
+bool IsBackendAvailable(int backend)
+{
+  switch (backend)
+    {
+    case SEQUENTIAL_BACKEND:
+    case STDTHREAD_BACKEND:
+      return true;
+#ifdef VTK_SMP_ENABLE_OPENMP
+    case OPENMP_BACKEND:
+      return true;
+#endif
+#ifdef VTK_SMP_ENABLE_TBB
+    case TBB_BACKEND:
+      return true;
+#endif
+    default:
+      return false;
+    }
+}
+
+class ThreadPool;
+
+//--------------------------------------------------------------------------------
+// A parallel loop published to the thread pool.
+struct Job
+{
+  // The pool the job is published to. Loops nested in the job run on it.
+  ThreadPool *Pool;
+
+  ExecuteFunctorPtrType Executer;
+  void *Functor;
+  vtkIdType First;
+  vtkIdType Last;
+  vtkIdType Grain;
+  vtkIdType NumberOfChunks;
+  std::atomic<vtkIdType> NextChunk;
+
+  // Number of threads other than the owner working on the job. Protected by
+  // the mutex of the pool.
+  int Helpers;
+
+  // The job whose loop body published this one, if any.
+  Job *Parent;
+
+  bool HasWork() const
+  {
+    return this->NextChunk.load() < this->NumberOfChunks;
+  }
+
+  bool IsNestedIn(const Job *job) const
+  {
+    for (const Job *parent = this->Parent; parent; parent = parent->Parent)
+      {
+      if (parent == job)
+        {
+        return true;
+        }
+      }
+    return false;
+  }
+
+  void Run();
+};
+
+// The job executed by the current thread, used to detect nested loops.
+thread_local Job *CurrentJob = nullptr;
+
+// Sets the job executed by the current thread for its lifetime.
+class CurrentJobScope
+{
+public:
+  explicit CurrentJobScope(Job *job)
+    : Outer(CurrentJob)
+  {
+    CurrentJob = job;
+  }
+
+  ~CurrentJobScope()
+  {
+    CurrentJob = this->Outer;
+  }
+
+private:
+  Job *Outer;
+};
+
+void Job::Run()
+{
+  CurrentJobScope scope(this);
+  for (;;)
+    {
+    vtkIdType chunk = this->NextChunk++;
+    if (chunk >= this->NumberOfChunks)
+      {
+      break;
+      }
+    this->Executer(this->Functor, this->First + chunk * this->Grain,
+                   this->Grain, this->Last);
+    }
+}
+
+//--------------------------------------------------------------------------------
+class ThreadPool
+{
+public:
+  explicit ThreadPool(int numThreads);
+  ~ThreadPool();
+
+  int GetNumberOfThreads() const
+  {
+    return this->NumberOfThreads;
+  }
+
+  void For(vtkIdType first, vtkIdType last, vtkIdType grain,
+           ExecuteFunctorPtrType functorExecuter, void *functor);
+
+  // Number of top-level loops running on the pool. Protected by the mutex
+  // of SMPState.
+  int Users;
+
+private:
+  ThreadPool(const ThreadPool&) = delete;
+  void operator=(const ThreadPool&) = delete;
+
+  class JobScope;
+
+  void Work();
+  Job* FindJob(const Job *outer);
+  void Help(Job *job, std::unique_lock<std::mutex> &lock);
+  void Publish(Job *job);
+  void Unpublish(Job *job, bool help);
+
+  int NumberOfThreads;
+  std::vector<std::thread> Threads;
+
+  // Protects Jobs, Job::Helpers and Stop.
+  std::mutex Mutex;
+  // Signaled when a job is published, when the last helper leaves a job
+  // and when the pool is stopped.
+  std::condition_variable Changed;
+  // Published jobs, the most recent last.
+  std::vector<Job*> Jobs;
+  bool Stop;
+};
+
+ThreadPool::ThreadPool(int numThreads)
+  : Users(0), NumberOfThreads(numThreads), Stop(false)
+{
+  // The thread calling For() is one of the threads of the pool.
+  for (int i = 1; i < numThreads; ++i)
+    {
+    this->Threads.push_back(std::thread(&ThreadPool::Work, this));
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(this->Mutex);
+    this->Stop = true;
+  }
+  this->Changed.notify_all();
+  for (size_t i = 0; i < this->Threads.size(); ++i)
+    {
+    this->Threads[i].join();
+    }
+}
+
+// Return the most recently published job with unclaimed chunks. When outer
+// is given, only jobs nested in it are considered. Exhausted jobs are
+// removed from the list. Must be called with the mutex locked.
+Job* ThreadPool::FindJob(const Job *outer)
+{
+  for (size_t i = this->Jobs.size(); i-- > 0; )
+    {
+    Job *job = this->Jobs[i];
+    if (!job->HasWork())
+      {
+      this->Jobs.erase(this->Jobs.begin() + i);
+      }
+    else if (!outer || job->IsNestedIn(outer))
+      {
+      return job;
+      }
+    }
+  return nullptr;
+}
+
+// Work on a job published by another thread. Must be called with the mutex
+// locked; the mutex is released while the chunks are executed.
+void ThreadPool::Help(Job *job, std::unique_lock<std::mutex> &lock)
+{
+  ++job->Helpers;
+  lock.unlock();
+  job->Run();
+  lock.lock();
+  if (--job->Helpers == 0)
+    {
+    this->Changed.notify_all();
+    }
+}
+
+void ThreadPool::Work()
+{
+  std::unique_lock<std::mutex> lock(this->Mutex);
+  while (!this->Stop)
+    {
+    Job *job = this->FindJob(nullptr);
+    if (job)
+      {
+      this->Help(job, lock);
+      }
+    else
+      {
+      this->Changed.wait(lock);
+      }
+    }
+}
+
+void ThreadPool::Publish(Job *job)
+{
+  {
+    std::lock_guard<std::mutex> lock(this->Mutex);
+    this->Jobs.push_back(job);
+  }
+  this->Changed.notify_all();
+}
+
+// Remove a job from the list and wait for its helpers to finish their
+// chunks. When help is true, the jobs they nest in the meantime are helped
+// with.
+void ThreadPool::Unpublish(Job *job, bool help)
+{
+  // No chunk is handed out any more, which matters when the loop body threw
+  // before all of them were claimed.
+  job->NextChunk = job->NumberOfChunks;
+
+  std::unique_lock<std::mutex> lock(this->Mutex);
+  for (size_t i = 0; i < this->Jobs.size(); ++i)
+    {
+    if (this->Jobs[i] == job)
+      {
+      this->Jobs.erase(this->Jobs.begin() + i);
+      break;
+      }
+    }
+  while (job->Helpers > 0)
+    {
+    Job *nested = help ? this->FindJob(job) : nullptr;
+    if (nested)
+      {
+      this->Help(nested, lock);
+      }
+    else
+      {
+      this->Changed.wait(lock);
+      }
+    }
+}
+
+// Publishes a job for the lifetime of the scope. The job lives on the stack
+// of the thread calling For(), so it is unpublished and its helpers are
+// waited for even when the loop body throws.
+class ThreadPool::JobScope
+{
+public:
+  JobScope(ThreadPool *pool, Job *job)
+    : Pool(pool), Published(job)
+  {
+    this->Pool->Publish(job);
+  }
+
+  ~JobScope()
+  {
+    if (this->Published)
+      {
+      this->Pool->Unpublish(this->Published, false);
+      }
+  }
+
+  // Unpublish the job once all its chunks have been claimed.
+  void Finish()
+  {
+    this->Pool->Unpublish(this->Published, true);
+    this->Published = nullptr;
+  }
+
+private:
+  ThreadPool *Pool;
+  Job *Published;
+};
+
+void ThreadPool::For(vtkIdType first, vtkIdType last, vtkIdType grain,
+                     ExecuteFunctorPtrType functorExecuter, void *functor)
+{
+  vtkIdType n = last - first;
+  if (grain <= 0)
+    {
+    vtkIdType estimateGrain = n / (this->NumberOfThreads * 4);
+    grain = (estimateGrain > 0) ? estimateGrain : 1;
+    }
+
+  Job job;
+  job.Pool = this;
+  job.Executer = functorExecuter;
+  job.Functor = functor;
+  job.First = first;
+  job.Last = last;
+  job.Grain = grain;
+  job.NumberOfChunks = (n + grain - 1) / grain;
+  job.NextChunk = 0;
+  job.Helpers = 0;
+  job.Parent = CurrentJob;
+
+  JobScope scope(this, &job);
+  job.Run();
+
+  // All chunks have been claimed. Wait for the helpers to finish theirs,
+  // helping with the loops they may have nested in the meantime.
+  scope.Finish();
+}
+
+//--------------------------------------------------------------------------------
+// Global state of the backend. The settings are atomic since they are read
+// without the mutex by the loops, while another thread may change them.
+// The mutex protects the pool.
+struct SMPState
+{
+  std::mutex Mutex;
+  std::atomic<int> Backend;
+  std::atomic<int> NumberOfSpecifiedThreads;
+  std::atomic<bool> NestedParallelism;
+  ThreadPool *Pool;
+
+  SMPState()
+    : Backend(STDTHREAD_BACKEND), NumberOfSpecifiedThreads(0),
+      NestedParallelism(true), Pool(nullptr)
+  {
+    const char *backend = getenv("VTK_SMP_BACKEND_IN_USE");
+    if (backend)
+      {
+      int type = SEQUENTIAL_BACKEND;
+      for (; type <= TBB_BACKEND; ++type)
+        {
+        if (strcmp(backend, BackendNames[type]) == 0)
+          {
+          break;
+          }
+        }
+      if (IsBackendAvailable(type))
+        {
+        this->Backend.store(type);
+        }
+      else
+        {
+        vtkGenericWarningMacro("VTK_SMP_BACKEND_IN_USE requests SMP backend "
+                               << backend << " which is not available, "
+                               "using STDThread.");
+        }
+      }
+  }
+
+  ~SMPState()
+  {
+    delete this->Pool;
+  }
+
+  int GetDefaultNumberOfThreads() const
+  {
+    int numSpecified = this->NumberOfSpecifiedThreads.load();
+    if (numSpecified > 0)
+      {
+      return numSpecified;
+      }
+    int numThreads = static_cast<int>(std::thread::hardware_concurrency());
+    return numThreads > 0 ? numThreads : 1;
+  }
+
+  // Return the pool for a top-level loop, which must give it back with
+  // ReleasePool() when it is done.
+  ThreadPool* AcquirePool()
+  {
+    std::lock_guard<std::mutex> lock(this->Mutex);
+    if (!this->Pool)
+      {
+      this->Pool = new ThreadPool(this->GetDefaultNumberOfThreads());
+      }
+    ++this->Pool->Users;
+    return this->Pool;
+  }
+
+  // A pool replaced by Initialize() while it was in use is deleted when its
+  // last loop is done.
+  void ReleasePool(ThreadPool *pool)
+  {
+    {
+      std::lock_guard<std::mutex> lock(this->Mutex);
+      if (--pool->Users > 0 || pool == this->Pool)
+        {
+        return;
+        }
+    }
+    delete pool;
+  }
+};
+
+SMPState& GetState()
+{
+  static SMPState state;
+  return state;
+}
+
+// Uses the pool of a top-level loop for the lifetime of the scope.
+class PoolScope
+{
+public:
+  explicit PoolScope(SMPState &state)
+    : State(state), Pool(state.AcquirePool())
+  {
+  }
+
+  ~PoolScope()
+  {
+    this->State.ReleasePool(this->Pool);
+  }
+
+  ThreadPool* GetPool() const
+  {
+    return this->Pool;
+  }
+
+private:
+  PoolScope(const PoolScope&) = delete;
+  void operator=(const PoolScope&) = delete;
+
+  SMPState &State;
+  ThreadPool *Pool;
+};
+
+} // end anon namespace
+
+//--------------------------------------------------------------------------------
+void vtkSMPTools::Initialize(int numThreads)
+{
+  SMPState &state = GetState();
+  if (numThreads <= 0)
+    {
+    return;
+    }
+  {
+    std::lock_guard<std::mutex> lock(state.Mutex);
+    state.NumberOfSpecifiedThreads.store(numThreads);
+    if (state.Pool && state.Pool->GetNumberOfThreads() != numThreads)
+      {
+      // Created again with the new size on next use. Loops still running
+      // on the old pool, including the one calling this method if any, keep
+      // it alive until they are done.
+      if (state.Pool->Users == 0)
+        {
+        delete state.Pool;
+        }
+      state.Pool = nullptr;
+      }
+  }
+#ifdef VTK_SMP_ENABLE_OPENMP
+  vtk::detail::smp::InitializeOpenMPBackend(numThreads);
+#endif
+#ifdef VTK_SMP_ENABLE_TBB
+  vtk::detail::smp::InitializeTBBBackend(numThreads);
+#endif
+}
+
+//--------------------------------------------------------------------------------
+int vtkSMPTools::GetEstimatedNumberOfThreads()
+{
+  return vtk::detail::smp::GetNumberOfThreads();
+}
+
+//--------------------------------------------------------------------------------
+bool vtkSMPTools::SetBackend(const char* backend)
+{
+  SMPState &state = GetState();
+  for (int type = SEQUENTIAL_BACKEND; backend && type <= TBB_BACKEND; ++type)
+    {
+    if (strcmp(backend, BackendNames[type]) == 0 && IsBackendAvailable(type))
+      {
+      state.Backend.store(type);
+      return true;
+      }
+    }
+  vtkGenericWarningMacro("SMP backend " << (backend ? backend : "(none)")
+                         << " is not available, using "
+                         << BackendNames[state.Backend.load()] << ".");
+  return false;
+}
+
+//--------------------------------------------------------------------------------
+const char* vtkSMPTools::GetBackend()
+{
+  return BackendNames[GetState().Backend.load()];
+}
+
+//--------------------------------------------------------------------------------
+void vtkSMPTools::SetNestedParallelism(bool isNested)
+{
+  GetState().NestedParallelism.store(isNested);
+#ifdef VTK_SMP_ENABLE_OPENMP
+  vtk::detail::smp::SetNestedParallelismOpenMPBackend(isNested);
+#endif
+}
+
+//--------------------------------------------------------------------------------
+bool vtkSMPTools::GetNestedParallelism()
+{
+  return GetState().NestedParallelism.load();
+}
+
+//--------------------------------------------------------------------------------
+int vtk::detail::smp::GetNumberOfThreads()
+{
+  SMPState &state = GetState();
+  switch (state.Backend.load())
+    {
+    case SEQUENTIAL_BACKEND:
+      return 1;
+#ifdef VTK_SMP_ENABLE_OPENMP
+    case OPENMP_BACKEND:
+      return GetNumberOfThreadsOpenMPBackend();
+#endif
+#ifdef VTK_SMP_ENABLE_TBB
+    case TBB_BACKEND:
+      return GetNumberOfThreadsTBBBackend();
+#endif
+    default:
+      return state.GetDefaultNumberOfThreads();
+    }
+}
+
+//--------------------------------------------------------------------------------
+void vtk::detail::smp::vtkSMPTools_Impl_For_STDThread(vtkIdType first,
+  vtkIdType last, vtkIdType grain, ExecuteFunctorPtrType functorExecuter,
+  void *functor)
+{
+  SMPState &state = GetState();
+  switch (state.Backend.load())
+    {
+#ifdef VTK_SMP_ENABLE_OPENMP
+    case OPENMP_BACKEND:
+      vtkSMPTools_Impl_For_OpenMPBackend(first, last, grain, functorExecuter,
+                                         functor);
+      return;
+#endif
+#ifdef VTK_SMP_ENABLE_TBB
+    case TBB_BACKEND:
+      vtkSMPTools_Impl_For_TBBBackend(first, last, grain, functorExecuter,
+                                      functor);
+      return;
+#endif
+    case STDTHREAD_BACKEND:
+      if (CurrentJob)
+        {
+        // The outer loop keeps its pool alive.
+        ThreadPool *pool = CurrentJob->Pool;
+        if (state.NestedParallelism.load() && pool->GetNumberOfThreads() > 1)
+          {
+          pool->For(first, last, grain, functorExecuter, functor);
+          return;
+          }
+        }
+      else
+        {
+        PoolScope scope(state);
+        if (scope.GetPool()->GetNumberOfThreads() > 1)
+          {
+          scope.GetPool()->For(first, last, grain, functorExecuter, functor);
+          return;
+          }
+        }
+      break;
+    default:
+      break;
+    }
+
+  // Sequential execution.
+  functorExecuter(functor, first, last - first, last);
+}
@@ -0,0 +1,71 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkSMPToolsOpenMP.cxx
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+
+#include "vtkSMPTools.h"
+
+#include <omp.h>
+
+// OpenMP loops for the run time selectable backends of the STDThread
+// implementation. This is the only file compiled with the OpenMP flags.
+
+namespace vtk
+{
+namespace detail
+{
+namespace smp
+{
+
+namespace
+{
+int vtkSMPNumberOfSpecifiedThreads = 0;
+}
+
+void InitializeOpenMPBackend(int numThreads)
+{
+  vtkSMPNumberOfSpecifiedThreads = numThreads;
+  omp_set_num_threads(numThreads);
+}
+
+int GetNumberOfThreadsOpenMPBackend()
+{
+  return vtkSMPNumberOfSpecifiedThreads ? vtkSMPNumberOfSpecifiedThreads :
+         omp_get_max_threads();
+}
+
+void SetNestedParallelismOpenMPBackend(bool isNested)
+{
+  // Values above the supported number of levels are clamped by OpenMP.
+  omp_set_max_active_levels(isNested ? VTK_INT_MAX : 1);
+}
+
+void vtkSMPTools_Impl_For_OpenMPBackend(vtkIdType first, vtkIdType last,
+  vtkIdType grain, ExecuteFunctorPtrType functorExecuter, void *functor)
+{
+  if (grain <= 0)
+    {
+    vtkIdType estimateGrain = (last - first)/(omp_get_max_threads() * 4);
+    grain = (estimateGrain > 0) ? estimateGrain : 1;
+    }
+
+# pragma omp parallel for schedule(runtime)
+  for (vtkIdType from = first; from < last; from += grain)
+    {
+    functorExecuter(functor, from, grain, last);
+    }
+}
+
+}
+}
+}
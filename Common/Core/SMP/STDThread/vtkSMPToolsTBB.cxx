@@ -0,0 +1,118 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkSMPToolsTBB.cxx
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+
+#include "vtkSMPTools.h"
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <tbb/task_arena.h>
+
+#include <mutex>
+
+// TBB loops for the run time selectable backends of the STDThread
+// implementation. Loops run in a task arena so that the number of threads
+// can be chosen with vtkSMPTools::Initialize().
+
+namespace vtk
+{
+namespace detail
+{
+namespace smp
+{
+
+namespace
+{
+std::mutex ArenaMutex;
+tbb::task_arena *Arena = nullptr;
+
+tbb::task_arena& GetArena()
+{
+  std::lock_guard<std::mutex> lock(ArenaMutex);
+  if (!Arena)
+    {
+    Arena = new tbb::task_arena;
+    }
+  return *Arena;
+}
+
+class FuncCall
+{
+  ExecuteFunctorPtrType Executer;
+  void *Functor;
+
+public:
+  FuncCall(ExecuteFunctorPtrType executer, void *functor)
+    : Executer(executer), Functor(functor)
+  {
+  }
+
+  void operator()(const tbb::blocked_range<vtkIdType>& r) const
+  {
+    this->Executer(this->Functor, r.begin(), r.end() - r.begin(), r.end());
+  }
+};
+
+class ForCall
+{
+  vtkIdType First;
+  vtkIdType Last;
+  vtkIdType Grain;
+  FuncCall Call;
+
+public:
+  ForCall(vtkIdType first, vtkIdType last, vtkIdType grain,
+          const FuncCall& call)
+    : First(first), Last(last), Grain(grain), Call(call)
+  {
+  }
+
+  void operator()() const
+  {
+    if (this->Grain > 0)
+      {
+      tbb::parallel_for(tbb::blocked_range<vtkIdType>(
+        this->First, this->Last, this->Grain), this->Call);
+      }
+    else
+      {
+      tbb::parallel_for(tbb::blocked_range<vtkIdType>(
+        this->First, this->Last), this->Call);
+      }
+  }
+};
+}
+
+void InitializeTBBBackend(int numThreads)
+{
+  std::lock_guard<std::mutex> lock(ArenaMutex);
+  delete Arena;
+  Arena = new tbb::task_arena(numThreads);
+}
+
+int GetNumberOfThreadsTBBBackend()
+{
+  return GetArena().max_concurrency();
+}
+
+void vtkSMPTools_Impl_For_TBBBackend(vtkIdType first, vtkIdType last,
+  vtkIdType grain, ExecuteFunctorPtrType functorExecuter, void *functor)
+{
+  ForCall call(first, last, grain, FuncCall(functorExecuter, functor));
+  GetArena().execute(call);
+}
+
+}
+}
+}
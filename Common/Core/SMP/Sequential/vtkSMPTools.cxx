@@ -15,6 +15,8 @@
 
 #include "vtkSMPTools.h"
 
+#include <cstring>
+
 // Simple implementation that runs everything sequentially.
 
 //--------------------------------------------------------------------------------
@@ -26,3 +28,32 @@ int vtkSMPTools::GetEstimatedNumberOfThreads()
 {
   return 1;
 }
+
+//--------------------------------------------------------------------------------
+bool vtkSMPTools::SetBackend(const char* backend)
+{
+  if (backend && strcmp(backend, "Sequential") == 0)
+    {
+    return true;
+    }
+  vtkGenericWarningMacro("SMP backend " << (backend ? backend : "(none)")
+                         << " is not available, using Sequential.");
+  return false;
+}
+
+//--------------------------------------------------------------------------------
+const char* vtkSMPTools::GetBackend()
+{
+  return "Sequential";
+}
+
+//--------------------------------------------------------------------------------
+void vtkSMPTools::SetNestedParallelism(bool)
+{
+}
+
+//--------------------------------------------------------------------------------
+bool vtkSMPTools::GetNestedParallelism()
+{
+  return false;
+}
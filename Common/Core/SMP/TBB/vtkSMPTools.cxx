@@ -17,6 +17,7 @@
 
 #include "vtkCriticalSection.h"
 
+#include <cstring>
 #include <tbb/task_scheduler_init.h>
 
 struct vtkSMPToolsInit
@@ -30,6 +31,7 @@ struct vtkSMPToolsInit
 
 static bool vtkSMPToolsInitialized = 0;
 static int vtkTBBNumSpecifiedThreads = 0;
+static bool vtkTBBNestedParallelism = true;
 static vtkSimpleCriticalSection vtkSMPToolsCS;
 
 //--------------------------------------------------------------------------------
@@ -56,3 +58,35 @@ int vtkSMPTools::GetEstimatedNumberOfThreads()
   return vtkTBBNumSpecifiedThreads ? vtkTBBNumSpecifiedThreads
     : tbb::task_scheduler_init::default_num_threads();
 }
+
+//--------------------------------------------------------------------------------
+bool vtkSMPTools::SetBackend(const char* backend)
+{
+  if (backend && strcmp(backend, "TBB") == 0)
+    {
+    return true;
+    }
+  vtkGenericWarningMacro("SMP backend " << (backend ? backend : "(none)")
+                         << " is not available, using TBB.");
+  return false;
+}
+
+//--------------------------------------------------------------------------------
+const char* vtkSMPTools::GetBackend()
+{
+  return "TBB";
+}
+
+//--------------------------------------------------------------------------------
+// TBB runs nested loops with the threads of its own scheduler and never
+// oversubscribes, so the setting is only recorded.
+void vtkSMPTools::SetNestedParallelism(bool isNested)
+{
+  vtkTBBNestedParallelism = isNested;
+}
+
+//--------------------------------------------------------------------------------
+bool vtkSMPTools::GetNestedParallelism()
+{
+  return vtkTBBNestedParallelism;
+}
@@ -14,6 +14,7 @@
 =========================================================================*/
 
 #include "vtkBitArray.h"
+#include "vtkDoubleArray.h"
 #include "vtkIdList.h"
 #include "vtkIdTypeArray.h"
 #include "vtkIntArray.h"
@@ -592,6 +593,81 @@ int TestArrayLookupInt(vtkIdType numVal, bool runComparison)
   return errors;
 }
 
+// The lookup must follow appended values, return the first occurrence of a
+// value, be discarded by DataChanged() and be shared by shallow copies.
+int TestArrayLookupIncremental()
+{
+  int errors = 0;
+  const vtkIdType numVal = 100000;
+
+  VTK_CREATE(vtkIntArray, arr);
+  for (vtkIdType i = 0; i < numVal; i++)
+    {
+    arr->InsertNextValue(static_cast<int>(i % 1000));
+    }
+  if (arr->LookupValue(999) != 999 || arr->LookupValue(1000) != -1)
+    {
+    cerr << "ERROR: lookup did not find the first occurrence" << endl;
+    errors++;
+    }
+
+  // Appended values must be found, small and large batches alike.
+  for (vtkIdType count = 1; count <= numVal; count *= 10)
+    {
+    vtkIdType first = arr->GetNumberOfValues();
+    for (vtkIdType i = 0; i < count; i++)
+      {
+      arr->InsertNextValue(static_cast<int>(1000 + first + i));
+      }
+    vtkIdType last = arr->GetNumberOfValues() - 1;
+    if (arr->LookupValue(static_cast<int>(1000 + first)) != first ||
+        arr->LookupValue(static_cast<int>(1000 + last)) != last ||
+        arr->LookupValue(5) != 5)
+      {
+      cerr << "ERROR: lookup failed after appending " << count
+           << " values" << endl;
+      errors++;
+      }
+    }
+
+  VTK_CREATE(vtkIdList, list);
+  arr->LookupValue(7, list);
+  if (list->GetNumberOfIds() != numVal / 1000 || list->GetId(0) != 7)
+    {
+    cerr << "ERROR: list lookup found " << list->GetNumberOfIds()
+         << " matches" << endl;
+    errors++;
+    }
+
+  // Shallow copies share the index until the data changes.
+  VTK_CREATE(vtkIntArray, copy);
+  copy->ShallowCopy(arr);
+  if (copy->LookupValue(3) != 3)
+    {
+    cerr << "ERROR: lookup failed on shallow copy" << endl;
+    errors++;
+    }
+  arr->SetValue(3, -3);
+  arr->DataChanged();
+  if (copy->LookupValue(-3) != 3 || copy->LookupValue(3) != 1003)
+    {
+    cerr << "ERROR: shared lookup was not invalidated" << endl;
+    errors++;
+    }
+
+  // Zeros of either sign are equal.
+  VTK_CREATE(vtkDoubleArray, darr);
+  darr->InsertNextValue(1.5);
+  darr->InsertNextValue(-0.0);
+  if (darr->LookupValue(0.0) != 1 || darr->LookupValue(2.5) != -1)
+    {
+    cerr << "ERROR: floating point lookup failed" << endl;
+    errors++;
+    }
+
+  return errors;
+}
+
 int TestArrayLookup(int argc, char* argv[])
 {
   vtkIdType min = 100;
@@ -664,5 +740,6 @@ int TestArrayLookup(int argc, char* argv[])
     errors += TestArrayLookupBit(numVal);
     cerr << endl;
     }
+  errors += TestArrayLookupIncremental();
   return errors;
 }
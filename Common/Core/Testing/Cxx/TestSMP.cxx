@@ -13,12 +13,16 @@
 
 =========================================================================*/
 #include "vtkSMPThreadLocal.h"
+#include "vtkMultiThreader.h"
 #include "vtkNew.h"
 #include "vtkObject.h"
 #include "vtkObjectFactory.h"
 #include "vtkSMPTools.h"
 #include "vtkSMPThreadLocalObject.h"
+#include "vtkSimpleCriticalSection.h"
 #include <functional>
+#include <stdexcept>
+#include <string>
 #include <vector>
 
 static const int Target = 10000;
@@ -94,6 +98,330 @@ public:
 // For sorting comparison
 bool myComp (double a, double b) { return (a<b); }
 
+// For transform
+struct Square
+{
+  double operator()(double x) const { return x*x; }
+};
+
+// For reduction and scans: an associative, non-commutative operation
+std::string myConcat (const std::string& a, const std::string& b)
+{
+  return a + b;
+}
+
+int TestSMPAlgorithms()
+{
+  const vtkIdType n = 100000;
+  std::vector<double> in(n), out(n);
+  std::vector<vtkIdType> counts(n), offsets(n);
+  for (vtkIdType i=0; i<n; ++i)
+    {
+    in[i] = static_cast<double>(i % 100);
+    counts[i] = i % 7;
+    }
+
+  // Transform, unary and binary
+  vtkSMPTools::Transform(in.begin(), in.end(), out.begin(), Square());
+  for (vtkIdType i=0; i<n; ++i)
+    {
+    if ( out[i] != in[i]*in[i] )
+      {
+      cerr << "Error: Bad unary transform!" << endl;
+      return 1;
+      }
+    }
+  vtkSMPTools::Transform(in.begin(), in.end(), out.begin(), out.begin(),
+                         std::plus<double>());
+  for (vtkIdType i=0; i<n; ++i)
+    {
+    if ( out[i] != in[i]*in[i] + in[i] )
+      {
+      cerr << "Error: Bad binary transform!" << endl;
+      return 1;
+      }
+    }
+
+  // Fill
+  vtkSMPTools::Fill(out.begin(), out.end(), 3.0);
+  for (vtkIdType i=0; i<n; ++i)
+    {
+    if ( out[i] != 3.0 )
+      {
+      cerr << "Error: Bad fill!" << endl;
+      return 1;
+      }
+    }
+
+  // Reduce
+  vtkIdType expectedSum = 0;
+  for (vtkIdType i=0; i<n; ++i)
+    {
+    expectedSum += counts[i];
+    }
+  vtkIdType sum = vtkSMPTools::Reduce(counts.begin(), counts.end(),
+                                      static_cast<vtkIdType>(10));
+  if ( sum != expectedSum + 10 )
+    {
+    cerr << "Error: Bad reduction!" << endl;
+    return 1;
+    }
+  if ( vtkSMPTools::Reduce(counts.begin(), counts.begin(),
+                           static_cast<vtkIdType>(10)) != 10 )
+    {
+    cerr << "Error: Bad empty reduction!" << endl;
+    return 1;
+    }
+
+  // Exclusive and inclusive scans
+  vtkIdType total = vtkSMPTools::ExclusiveScan(counts.begin(), counts.end(),
+    offsets.begin(), static_cast<vtkIdType>(0));
+  if ( total != expectedSum )
+    {
+    cerr << "Error: Bad exclusive scan total!" << endl;
+    return 1;
+    }
+  vtkIdType running = 0;
+  for (vtkIdType i=0; i<n; ++i)
+    {
+    if ( offsets[i] != running )
+      {
+      cerr << "Error: Bad exclusive scan!" << endl;
+      return 1;
+      }
+    running += counts[i];
+    }
+  total = vtkSMPTools::InclusiveScan(counts.begin(), counts.end(),
+                                     offsets.begin(),
+                                     static_cast<vtkIdType>(5));
+  running = 5;
+  for (vtkIdType i=0; i<n; ++i)
+    {
+    running += counts[i];
+    if ( offsets[i] != running )
+      {
+      cerr << "Error: Bad inclusive scan!" << endl;
+      return 1;
+      }
+    }
+  if ( total != running )
+    {
+    cerr << "Error: Bad inclusive scan total!" << endl;
+    return 1;
+    }
+
+  // In-place exclusive scan
+  std::vector<vtkIdType> inplace(counts);
+  vtkSMPTools::ExclusiveScan(inplace.begin(), inplace.end(), inplace.begin(),
+                             static_cast<vtkIdType>(0));
+  running = 0;
+  for (vtkIdType i=0; i<n; ++i)
+    {
+    if ( inplace[i] != running )
+      {
+      cerr << "Error: Bad in-place scan!" << endl;
+      return 1;
+      }
+    running += counts[i];
+    }
+
+  // Order of the partial results must be preserved.
+  std::vector<std::string> letters(1000);
+  std::string expected("<");
+  for (size_t i=0; i<letters.size(); ++i)
+    {
+    letters[i] = std::string(1, static_cast<char>('a' + i % 26));
+    expected += letters[i];
+    }
+  std::string concat = vtkSMPTools::Reduce(letters.begin(), letters.end(),
+                                           std::string("<"), myConcat);
+  if ( concat != expected )
+    {
+    cerr << "Error: Reduction did not preserve order!" << endl;
+    return 1;
+    }
+  std::vector<std::string> prefixes(letters.size());
+  concat = vtkSMPTools::ExclusiveScan(letters.begin(), letters.end(),
+                                      prefixes.begin(), std::string("<"),
+                                      myConcat);
+  if ( concat != expected ||
+       prefixes[500] != expected.substr(0, 501) )
+    {
+    cerr << "Error: Scan did not preserve order!" << endl;
+    return 1;
+    }
+
+  return 0;
+}
+
+// Each outer iteration runs a parallel inner loop. Both loops accumulate
+// into thread local storage; the outer value is read before and written
+// after the inner loop to check that it is not clobbered by other outer
+// iterations while the thread waits for the inner loop.
+class InnerFunctor
+{
+public:
+  vtkSMPThreadLocal<vtkIdType> Counter;
+
+  InnerFunctor(): Counter(0)
+  {
+  }
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    this->Counter.Local() += end - begin;
+  }
+
+  vtkIdType GetTotal()
+  {
+    vtkIdType total = 0;
+    vtkSMPThreadLocal<vtkIdType>::iterator itr = this->Counter.begin();
+    for (; itr != this->Counter.end(); ++itr)
+      {
+      total += *itr;
+      }
+    return total;
+  }
+};
+
+class OuterFunctor
+{
+public:
+  vtkSMPThreadLocal<vtkIdType> Counter;
+
+  OuterFunctor(): Counter(0)
+  {
+  }
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    for (vtkIdType i=begin; i<end; i++)
+      {
+      vtkIdType &counter = this->Counter.Local();
+      vtkIdType value = counter;
+      InnerFunctor inner;
+      vtkSMPTools::For(0, Target, 10, inner);
+      counter = value + inner.GetTotal();
+      }
+  }
+};
+
+int TestSMPNested()
+{
+  OuterFunctor outer;
+  vtkSMPTools::For(0, 50, 1, outer);
+
+  vtkIdType total = 0;
+  vtkSMPThreadLocal<vtkIdType>::iterator itr = outer.Counter.begin();
+  for (; itr != outer.Counter.end(); ++itr)
+    {
+    total += *itr;
+    }
+  if (total != 50 * Target)
+    {
+    cerr << "Error: nested loops generated " << total << " instead of "
+         << 50 * Target << endl;
+    return 1;
+    }
+  return 0;
+}
+
+// Changes the number of threads while loops run on the pool.
+class ResizingFunctor
+{
+public:
+  vtkSMPThreadLocal<vtkIdType> Counter;
+
+  ResizingFunctor(): Counter(0)
+  {
+  }
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    for (vtkIdType i=begin; i<end; i++)
+      {
+      vtkSMPTools::Initialize(static_cast<int>(2 + i % 3));
+      InnerFunctor inner;
+      vtkSMPTools::For(0, Target, 10, inner);
+      this->Counter.Local() += inner.GetTotal();
+      }
+  }
+};
+
+int TestSMPResize()
+{
+  ResizingFunctor resizing;
+  vtkSMPTools::For(0, 20, 1, resizing);
+
+  vtkIdType total = 0;
+  vtkSMPThreadLocal<vtkIdType>::iterator itr = resizing.Counter.begin();
+  for (; itr != resizing.Counter.end(); ++itr)
+    {
+    total += *itr;
+    }
+  if (total != 20 * Target)
+    {
+    cerr << "Error: loops resizing the pool generated " << total
+         << " instead of " << 20 * Target << endl;
+    return 1;
+    }
+  return 0;
+}
+
+// Throws from the first chunk executed by the thread calling For(). The
+// other threads wait for it, so that they cannot run all the chunks first.
+class ThrowingFunctor
+{
+public:
+  vtkMultiThreaderIDType Caller;
+  vtkSimpleCriticalSection Lock;
+  bool Thrown;
+
+  ThrowingFunctor(): Caller(vtkMultiThreader::GetCurrentThreadID()),
+                     Thrown(false)
+  {
+  }
+
+  void operator()(vtkIdType, vtkIdType)
+  {
+    if (vtkMultiThreader::ThreadsEqual(vtkMultiThreader::GetCurrentThreadID(),
+                                       this->Caller))
+      {
+      this->Lock.Lock();
+      this->Thrown = true;
+      this->Lock.Unlock();
+      throw std::runtime_error("ThrowingFunctor");
+      }
+    for (bool thrown = false; !thrown; )
+      {
+      this->Lock.Lock();
+      thrown = this->Thrown;
+      this->Lock.Unlock();
+      }
+  }
+};
+
+int TestSMPException()
+{
+  ThrowingFunctor throwing;
+  bool thrown = false;
+  try
+    {
+    vtkSMPTools::For(0, 1000, 1, throwing);
+    }
+  catch (const std::runtime_error&)
+    {
+    thrown = true;
+    }
+  if (!thrown)
+    {
+    cerr << "Error: the exception of the loop body was lost" << endl;
+    return 1;
+    }
+  // The loop that threw is no longer run by the pool.
+  return TestSMPNested();
+}
+
 int TestSMP(int, char*[])
 {
   //vtkSMPTools::Initialize(8);
@@ -167,5 +495,38 @@ int TestSMP(int, char*[])
       }
     }
 
-  return 0;
+  if (TestSMPAlgorithms())
+    {
+    return 1;
+    }
+
+  bool nested = vtkSMPTools::GetNestedParallelism();
+  vtkSMPTools::SetNestedParallelism(true);
+  int errors = TestSMPNested();
+  vtkSMPTools::SetNestedParallelism(false);
+  errors += TestSMPNested();
+  vtkSMPTools::SetNestedParallelism(nested);
+  errors += TestSMPResize();
+
+  // The STDThread backend can switch to sequential execution at run time.
+  std::string backend = vtkSMPTools::GetBackend();
+  if (!vtkSMPTools::SetBackend(backend.c_str()))
+    {
+    cerr << "Error: cannot select backend " << backend << endl;
+    return 1;
+    }
+  if (backend == "STDThread")
+    {
+    errors += TestSMPException();
+    vtkSMPTools::SetBackend("Sequential");
+    if (vtkSMPTools::GetEstimatedNumberOfThreads() != 1)
+      {
+      cerr << "Error: Sequential backend uses more than one thread" << endl;
+      ++errors;
+      }
+    errors += TestSMPNested() + TestSMPAlgorithms();
+    vtkSMPTools::SetBackend(backend.c_str());
+    }
+
+  return errors;
 }
@@ -129,6 +129,13 @@ public:
   // DELETE, delete[] will be used. The default is FREE.
   void SetArray(ValueType* array, vtkIdType size, int save, int deleteMethod);
   void SetArray(ValueType* array, vtkIdType size, int save);
+
+  // Description:
+  // Use the data at @a array in place without ever freeing them.  They
+  // must stay valid as long as @a owner exists, such as the mapping of a
+  // file in memory.  The owner is referenced until the data are replaced
+  // or released, also by the arrays sharing them after a ShallowCopy.
+  void SetArray(ValueType* array, vtkIdType size, vtkObjectBase* owner);
   void SetVoidArray(void* array, vtkIdType size, int save) VTK_OVERRIDE;
   void SetVoidArray(void* array, vtkIdType size, int save,
                     int deleteMethod) VTK_OVERRIDE;
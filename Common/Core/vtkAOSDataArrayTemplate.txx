@@ -53,6 +53,15 @@ void vtkAOSDataArrayTemplate<ValueTypeT>
   this->DataChanged();
 }
 
+//-----------------------------------------------------------------------------
+template <class ValueTypeT>
+void vtkAOSDataArrayTemplate<ValueTypeT>
+::SetArray(ValueType* array, vtkIdType size, vtkObjectBase* owner)
+{
+  this->SetArray(array, size, 1);
+  this->Buffer->SetOwner(owner);
+}
+
 //-----------------------------------------------------------------------------
 template <class ValueTypeT>
 void vtkAOSDataArrayTemplate<ValueTypeT>
@@ -105,6 +114,7 @@ void vtkAOSDataArrayTemplate<ValueTypeT>::ShallowCopy(vtkDataArray *other)
       this->Buffer->Register(NULL);
       }
     this->DataChanged();
+    this->Lookup.ShareLookup(o->Lookup);
     }
   else
     {
@@ -53,6 +53,12 @@ public:
   void SetBuffer(ScalarType* array, vtkIdType size, bool save=false,
                  int deleteMethod=VTK_DATA_ARRAY_FREE);
 
+  // Description:
+  // Set an object keeping the saved buffer valid, such as the mapping of
+  // a file in memory.  It is referenced until the buffer is replaced or
+  // this vtkBuffer object is deleted.
+  void SetOwner(vtkObjectBase* owner);
+
   // Description:
   // Return the number of elements the current buffer can hold.
   inline vtkIdType GetSize() const { return this->Size; }
@@ -71,19 +77,22 @@ protected:
     : Pointer(NULL),
       Size(0),
       Save(false),
-      DeleteMethod(VTK_DATA_ARRAY_FREE)
+      DeleteMethod(VTK_DATA_ARRAY_FREE),
+      Owner(NULL)
   {
   }
 
   ~vtkBuffer()
   {
     this->SetBuffer(NULL, 0);
+    this->SetOwner(NULL);
   }
 
   ScalarType *Pointer;
   vtkIdType Size;
   bool Save;
   int DeleteMethod;
+  vtkObjectBase* Owner;
 
 private:
   vtkBuffer(const vtkBuffer&) VTK_DELETE_FUNCTION;
@@ -115,6 +124,7 @@ void vtkBuffer<ScalarT>::SetBuffer(
         delete [] this->Pointer;
         }
       }
+    this->SetOwner(NULL);
     this->Pointer = array;
     }
   this->Size = size;
@@ -122,6 +132,24 @@ void vtkBuffer<ScalarT>::SetBuffer(
   this->DeleteMethod = deleteMethod;
 }
 
+//------------------------------------------------------------------------------
+template <typename ScalarT>
+void vtkBuffer<ScalarT>::SetOwner(vtkObjectBase* owner)
+{
+  if (this->Owner != owner)
+    {
+    if (owner)
+      {
+      owner->Register(this);
+      }
+    if (this->Owner)
+      {
+      this->Owner->UnRegister(this);
+      }
+    this->Owner = owner;
+    }
+}
+
 //------------------------------------------------------------------------------
 template <typename ScalarT>
 bool vtkBuffer<ScalarT>::Allocate(vtkIdType size)
@@ -332,7 +332,7 @@ void vtkGenericDataArray<DerivedT, ValueTypeT>::ClearLookup()
 template <class DerivedT, class ValueTypeT>
 void vtkGenericDataArray<DerivedT, ValueTypeT>::DataChanged()
 {
-  this->Lookup.ClearLookup();
+  this->Lookup.DataChanged();
 }
 
 //-----------------------------------------------------------------------------
@@ -15,18 +15,58 @@
 // .NAME vtkGenericDataArrayLookupHelper - internal class used by
 // vtkGenericDataArray to support LookupValue.
 // .SECTION Description
+// The lookup is a hash index of the array values. The index stores only
+// value indices, grouped by hash bucket in a compact offsets/indices
+// layout; values are read back from the array to resolve collisions, and
+// the indices of a bucket are sorted so that LookupValue() returns the
+// first occurrence of a value. The index is built in parallel with
+// vtkSMPTools on the first lookup.
+//
+// Values appended after the index was built (e.g. with InsertNextValue())
+// are kept in a small secondary index, which is merged into a rebuilt hash
+// index once it grows past a fraction of the array. Any other modification
+// must be followed by a call to DataChanged() on the array, which discards
+// the index.
+//
+// The index is reference counted so that arrays sharing the same memory
+// (see vtkAOSDataArrayTemplate::ShallowCopy()) can share it. DataChanged()
+// on any of these arrays invalidates the shared index for all of them.
 
 #ifndef vtkGenericDataArrayLookupHelper_h
 #define vtkGenericDataArrayLookupHelper_h
 
 #include <algorithm>
+#include <cstring>
+#include <map>
+#include "vtkAtomic.h"
 #include "vtkIdList.h"
+#include "vtkSMPTools.h"
 
 namespace detail
 {
   // this can be removed when C++11 is required.
   template< class T > struct remove_const { typedef T type; };
   template< class T > struct remove_const<const T> { typedef T type; };
+
+  // Hash the bit pattern of a value. Values comparing equal must hash
+  // equally, hence -0.0 is mapped to 0.0.
+  template <class T>
+  inline vtkTypeUInt64 LookupHash(T value)
+  {
+    if (value == T(0))
+      {
+      value = T(0);
+      }
+    vtkTypeUInt64 bits = 0;
+    memcpy(&bits, &value, sizeof(T) < sizeof(bits) ? sizeof(T) : sizeof(bits));
+    // 64-bit finalizer of MurmurHash3
+    bits ^= bits >> 33;
+    bits *= 0xff51afd7ed558ccdULL;
+    bits ^= bits >> 33;
+    bits *= 0xc4ceb9fe1a85ec53ULL;
+    bits ^= bits >> 33;
+    return bits;
+  }
 }
 
 template <class ArrayTypeT>
@@ -39,7 +79,8 @@ public:
   // Constructor.
   vtkGenericDataArrayLookupHelper()
     : AssociatedArray(NULL),
-    SortedArray(NULL)
+    Index(NULL),
+    TailEnd(0)
     {
     }
   ~vtkGenericDataArrayLookupHelper()
@@ -59,35 +100,43 @@ public:
   vtkIdType LookupValue(ValueType elem)
     {
     this->UpdateLookup();
-    ValueWithIndex temp;
-    temp.Value = elem;
-    ValueWithIndex* pos =
-      std::lower_bound(this->SortedArray,
-                       this->SortedArray + this->SortedArraySize, temp);
-    if (pos == (this->SortedArray + this->SortedArraySize))
+    if (this->Index)
       {
-      return -1;
+      const vtkIdType *begin, *end;
+      this->Index->GetBucket(elem, begin, end);
+      for (; begin != end; ++begin)
+        {
+        if (this->AssociatedArray->GetValue(*begin) == elem)
+          {
+          return *begin;
+          }
+        }
       }
-    if (pos->Value != elem)
-      {
-      return -1;
-      }
-    return pos->Index;
+    typename TailMap::const_iterator pos = this->Tail.find(elem);
+    return pos == this->Tail.end() ? -1 : pos->second;
     }
 
   void LookupValue(ValueType elem, vtkIdList* ids)
     {
     this->UpdateLookup();
-    ValueWithIndex temp;
-    temp.Value = elem;
-    std::pair<ValueWithIndex*, ValueWithIndex*> range =
-      std::equal_range(this->SortedArray,
-                       this->SortedArray + this->SortedArraySize, temp);
-    while (range.first != range.second)
+    if (this->Index)
       {
-      // assert(range.first->Value == elem);
-      ids->InsertNextId(range.first->Index);
-      ++range.first;
+      const vtkIdType *begin, *end;
+      this->Index->GetBucket(elem, begin, end);
+      for (; begin != end; ++begin)
+        {
+        if (this->AssociatedArray->GetValue(*begin) == elem)
+          {
+          ids->InsertNextId(*begin);
+          }
+        }
+      }
+    std::pair<typename TailMap::const_iterator,
+              typename TailMap::const_iterator> range =
+      this->Tail.equal_range(elem);
+    for (; range.first != range.second; ++range.first)
+      {
+      ids->InsertNextId(range.first->second);
       }
     }
 
@@ -95,56 +144,239 @@ public:
   // Release any allocated memory for internal data-structures.
   void ClearLookup()
     {
-    free(this->SortedArray);
-    this->SortedArray = NULL;
-    this->SortedArraySize = 0;
+    if (this->Index)
+      {
+      this->Index->UnRegister();
+      this->Index = NULL;
+      }
+    this->Tail.clear();
+    this->TailEnd = 0;
+    }
+
+  // Description:
+  // Discard the index because the values of the array changed. A shared
+  // index is invalidated for all the arrays using it.
+  void DataChanged()
+    {
+    if (this->Index)
+      {
+      this->Index->Valid = 0;
+      }
+    this->ClearLookup();
+    }
+
+  // Description:
+  // Use the index of another helper whose array refers to the same memory
+  // as the array of this helper. The index is not copied.
+  void ShareLookup(vtkGenericDataArrayLookupHelper<ArrayTypeT> &other)
+    {
+    if (this == &other || !other.Index || !other.Index->Valid)
+      {
+      return;
+      }
+    this->ClearLookup();
+    this->Index = other.Index;
+    this->Index->Register();
+    this->TailEnd = this->Index->Size;
     }
 
 private:
   vtkGenericDataArrayLookupHelper(const vtkGenericDataArrayLookupHelper&) VTK_DELETE_FUNCTION;
   void operator=(const vtkGenericDataArrayLookupHelper&) VTK_DELETE_FUNCTION;
 
-  struct ValueWithIndex
+  typedef typename ::detail::remove_const<ValueType>::type KeyType;
+  typedef std::multimap<KeyType, vtkIdType> TailMap;
+
+  // Reference counted hash index of the values [0, Size) of an array. The
+  // indices of the values falling into bucket b are
+  // Indices[Offsets[b], Offsets[b+1]).
+  struct HashIndex
     {
-    typename ::detail::remove_const<ValueType>::type Value;
-    vtkIdType Index;
-    inline bool operator<(const ValueWithIndex& other) const
+    vtkAtomic<int> ReferenceCount;
+    vtkAtomic<int> Valid;
+    vtkIdType Size;
+    vtkTypeUInt64 Mask;
+    vtkAtomic<vtkIdType> *Offsets;
+    vtkIdType *Indices;
+
+    HashIndex(vtkIdType size) : ReferenceCount(1), Valid(1), Size(size)
+      {
+      vtkIdType numBuckets = 1;
+      while (numBuckets < size)
+        {
+        numBuckets *= 2;
+        }
+      this->Mask = static_cast<vtkTypeUInt64>(numBuckets - 1);
+      this->Offsets = new vtkAtomic<vtkIdType>[numBuckets + 1];
+      this->Indices = new vtkIdType[size];
+      }
+    ~HashIndex()
+      {
+      delete [] this->Offsets;
+      delete [] this->Indices;
+      }
+
+    void Register()
+      {
+      ++this->ReferenceCount;
+      }
+    void UnRegister()
+      {
+      if (--this->ReferenceCount == 0)
+        {
+        delete this;
+        }
+      }
+
+    vtkIdType GetNumberOfBuckets() const
+      {
+      return static_cast<vtkIdType>(this->Mask) + 1;
+      }
+    vtkIdType GetBucket(ValueType value) const
       {
-      return this->Value < other.Value;
+      return static_cast<vtkIdType>(::detail::LookupHash(value) & this->Mask);
+      }
+    void GetBucket(ValueType value, const vtkIdType *&begin,
+                   const vtkIdType *&end) const
+      {
+      vtkIdType bucket = this->GetBucket(value);
+      begin = this->Indices + this->Offsets[bucket].load();
+      end = this->Indices + this->Offsets[bucket + 1].load();
+      }
+
+  private:
+    HashIndex(const HashIndex&) VTK_DELETE_FUNCTION;
+    void operator=(const HashIndex&) VTK_DELETE_FUNCTION;
+    };
+
+  // Count the number of values per bucket.
+  struct CountBuckets
+    {
+    ArrayTypeT *Array;
+    HashIndex *Index;
+    CountBuckets(ArrayTypeT *array, HashIndex *index)
+      : Array(array), Index(index)
+      {
+      }
+    void operator()(vtkIdType begin, vtkIdType end)
+      {
+      for (; begin < end; ++begin)
+        {
+        ++this->Index->Offsets[this->Index->GetBucket(
+          this->Array->GetValue(begin))];
+        }
       }
     };
 
+  // After an inclusive scan of the counts Offsets[b] is the end of bucket
+  // b. Filling the buckets from the back leaves Offsets[b] at the start.
+  struct FillBuckets
+    {
+    ArrayTypeT *Array;
+    HashIndex *Index;
+    FillBuckets(ArrayTypeT *array, HashIndex *index)
+      : Array(array), Index(index)
+      {
+      }
+    void operator()(vtkIdType begin, vtkIdType end)
+      {
+      for (; begin < end; ++begin)
+        {
+        vtkIdType bucket = this->Index->GetBucket(
+          this->Array->GetValue(begin));
+        this->Index->Indices[--this->Index->Offsets[bucket]] = begin;
+        }
+      }
+    };
+
+  // Threads fill the buckets in any order; sort them so that the first
+  // occurrence of a value is found first.
+  struct SortBuckets
+    {
+    HashIndex *Index;
+    SortBuckets(HashIndex *index) : Index(index)
+      {
+      }
+    void operator()(vtkIdType begin, vtkIdType end)
+      {
+      for (; begin < end; ++begin)
+        {
+        vtkIdType *first = this->Index->Indices +
+          this->Index->Offsets[begin].load();
+        vtkIdType *last = this->Index->Indices +
+          this->Index->Offsets[begin + 1].load();
+        if (last - first > 1)
+          {
+          std::sort(first, last);
+          }
+        }
+      }
+    };
+
+  void BuildIndex(vtkIdType numValues)
+    {
+    this->ClearLookup();
+    if (numValues == 0)
+      {
+      return;
+      }
+
+    HashIndex *index = new HashIndex(numValues);
+    vtkIdType numBuckets = index->GetNumberOfBuckets();
+    CountBuckets count(this->AssociatedArray, index);
+    vtkSMPTools::For(0, numValues, count);
+    vtkSMPTools::InclusiveScan(index->Offsets, index->Offsets + numBuckets,
+                               index->Offsets, static_cast<vtkIdType>(0));
+    index->Offsets[numBuckets] = numValues;
+    FillBuckets fill(this->AssociatedArray, index);
+    vtkSMPTools::For(0, numValues, fill);
+    SortBuckets sort(index);
+    vtkSMPTools::For(0, numBuckets, sort);
+
+    this->Index = index;
+    this->TailEnd = numValues;
+    }
+
   void UpdateLookup()
     {
-    if (!this->AssociatedArray || this->SortedArray)
+    if (!this->AssociatedArray)
       {
       return;
       }
 
-    int numComps = this->AssociatedArray->GetNumberOfComponents();
-    this->SortedArraySize =
-        this->AssociatedArray->GetNumberOfTuples() * numComps;
+    vtkIdType numValues = this->AssociatedArray->GetNumberOfValues();
+    if (this->Index && !this->Index->Valid)
+      {
+      this->ClearLookup();
+      }
+    if (numValues == this->TailEnd && (this->Index || numValues == 0))
+      {
+      return;
+      }
 
-    if (this->SortedArraySize == 0)
+    vtkIdType indexSize = this->Index ? this->Index->Size : 0;
+    vtkIdType tailSize = numValues - indexSize;
+    if (!this->Index || numValues < this->TailEnd || tailSize * 8 > indexSize)
       {
+      this->BuildIndex(numValues);
       return;
       }
 
-    this->SortedArray = reinterpret_cast<ValueWithIndex*>(
-          malloc(this->SortedArraySize * sizeof(ValueWithIndex)));
-    for (vtkIdType cc = 0, max = this->AssociatedArray->GetNumberOfValues();
-         cc < max; ++cc)
+    // Only values were appended: add them to the secondary index.
+    for (; this->TailEnd < numValues; ++this->TailEnd)
       {
-      ValueWithIndex& item = this->SortedArray[cc];
-      item.Value = this->AssociatedArray->GetValue(cc);
-      item.Index = cc;
+      KeyType value = this->AssociatedArray->GetValue(this->TailEnd);
+      if (value == value) // NaN never compares equal
+        {
+        this->Tail.insert(std::make_pair(value, this->TailEnd));
+        }
       }
-    std::sort(this->SortedArray, this->SortedArray + this->SortedArraySize);
     }
 
   ArrayTypeT *AssociatedArray;
-  ValueWithIndex* SortedArray;
-  vtkIdType SortedArraySize;
+  HashIndex *Index;
+  TailMap Tail;
+  vtkIdType TailEnd;
 };
 
 #endif
@@ -17,8 +17,11 @@
 // vtkSMPTools provides a set of utility functions that can
 // be used to parallelize parts of VTK code using multiple threads.
 // There are several back-end implementations of parallel functionality
-// (currently Sequential, TBB and X-Kaapi) that actual execution is
-// delegated to.
+// (currently Sequential, OpenMP, TBB and STDThread) that actual execution
+// is delegated to. Besides For(), parallel versions of common algorithms
+// (Sort, Transform, Fill, Reduce and prefix scans) are provided; the
+// scans are the building block of two-pass algorithms that first count
+// and then write their output without a serial compaction step.
 
 #ifndef vtkSMPTools_h
 #define vtkSMPTools_h
@@ -29,6 +32,8 @@
 #include "vtkSMPThreadLocal.h" // For Initialized
 #include "vtkSMPToolsInternal.h"
 
+#include <functional> // For std::plus
+
 
 #ifndef DOXYGEN_SHOULD_SKIP_THIS
 #ifndef __VTK_WRAP__
@@ -200,7 +205,8 @@ public:
   // execution of any parallel code. However, it can be used to
   // control the maximum number of threads used when the back-end
   // supports it (currently Simple and TBB only). Make sure to call
-  // it before any other parallel operation.
+  // it before any other parallel operation. With STDThread, loops
+  // already running when it is called finish on the previous threads.
   // When using Kaapi, use the KAAPI_CPUCOUNT env. variable to control
   // the number of threads used in the thread pool.
   static void Initialize(int numThreads=0);
@@ -212,6 +218,33 @@ public:
   // available threads.
   static int GetEstimatedNumberOfThreads();
 
+  // Description:
+  // Select the backend used for parallel execution. Returns false (and
+  // keeps the current backend) if the requested backend is not available.
+  // The STDThread implementation can switch at run time between
+  // "Sequential", "STDThread" (its native thread pool) and, when VTK was
+  // configured with them, "OpenMP" and "TBB"; the initial choice may be
+  // made with the VTK_SMP_BACKEND_IN_USE environment variable. The other
+  // implementations only support their own backend. The backend must not
+  // be changed while a parallel operation is running.
+  static bool SetBackend(const char* backend);
+
+  // Description:
+  // Return the name of the backend in use.
+  static const char* GetBackend();
+
+  // Description:
+  // Control whether a vtkSMPTools::For() invoked from within another
+  // parallel operation runs in parallel. When off, nested loops are
+  // executed serially by the calling thread. The STDThread thread pool
+  // executes nested loops with the threads of the pool, so enabling it
+  // (the default) never oversubscribes the machine. With OpenMP this maps
+  // to omp_set_max_active_levels(). With TBB the setting is a no-op: the
+  // value is returned by GetNestedParallelism() but nested loops are always
+  // scheduled on the threads of the TBB scheduler.
+  static void SetNestedParallelism(bool isNested);
+  static bool GetNestedParallelism();
+
   // Description:
   // A convenience method for sorting data. It is a drop in replacement for
   // std::sort(). Under the hood different methods are used. For example,
@@ -234,6 +267,110 @@ public:
     vtk::detail::smp::vtkSMPTools_Impl_Sort(begin,end,comp);
   }
 
+  // Description:
+  // A convenience method for transforming data. It is a drop in replacement
+  // for std::transform(): the unary functor is applied to each element of
+  // [inBegin,inEnd) and the result is written to the range beginning at
+  // outBegin. Iterators must be random access. The functor may be invoked
+  // concurrently and in any order.
+  template<typename InputIt, typename OutputIt, typename Functor>
+    static void Transform(InputIt inBegin, InputIt inEnd, OutputIt outBegin,
+                          Functor transform)
+  {
+    vtk::detail::smp::vtkSMPTools_Impl_Transform(inBegin,inEnd,outBegin,
+                                                 transform);
+  }
+
+  // Description:
+  // A convenience method for transforming data. It is a drop in replacement
+  // for the binary version of std::transform(): the functor is invoked with
+  // pairs of elements taken from [inBegin1,inEnd) and from the range
+  // beginning at inBegin2.
+  template<typename InputIt1, typename InputIt2, typename OutputIt,
+           typename Functor>
+    static void Transform(InputIt1 inBegin1, InputIt1 inEnd,
+                          InputIt2 inBegin2, OutputIt outBegin,
+                          Functor transform)
+  {
+    vtk::detail::smp::vtkSMPTools_Impl_Transform(inBegin1,inEnd,inBegin2,
+                                                 outBegin,transform);
+  }
+
+  // Description:
+  // A convenience method for filling data. It is a drop in replacement for
+  // std::fill(). Iterators must be random access.
+  template<typename Iterator, typename T>
+    static void Fill(Iterator begin, Iterator end, const T& value)
+  {
+    vtk::detail::smp::vtkSMPTools_Impl_Fill(begin,end,value);
+  }
+
+  // Description:
+  // Reduce the range [begin,end) with the binary operation op, starting
+  // from init. This is a parallel replacement for std::accumulate(). The
+  // operation must be associative, but it does not need to be commutative:
+  // partial results are always combined in order. Note that for floating
+  // point data the result may depend on the number of threads used.
+  template<typename Iterator, typename T, typename BinaryOp>
+    static T Reduce(Iterator begin, Iterator end, T init, BinaryOp op)
+  {
+    return vtk::detail::smp::vtkSMPTools_Impl_Reduce(begin,end,init,op);
+  }
+
+  // Description:
+  // Sum the range [begin,end), starting from init.
+  template<typename Iterator, typename T>
+    static T Reduce(Iterator begin, Iterator end, T init)
+  {
+    return vtk::detail::smp::vtkSMPTools_Impl_Reduce(begin,end,init,
+                                                     std::plus<T>());
+  }
+
+  // Description:
+  // Compute an exclusive prefix scan (prefix sum by default) of
+  // [inBegin,inEnd) into the range beginning at outBegin: the i-th output
+  // is init combined with input elements 0 through i-1. The input and
+  // output ranges may be the same (in-place scan). The return value is the
+  // reduction of the whole range, i.e. the value that would follow the
+  // last output. This is the core of two-pass "count, then write"
+  // algorithms: the counts are scanned into offsets and the return value
+  // is the total output size. The operation must be associative.
+  template<typename InputIt, typename OutputIt, typename T, typename BinaryOp>
+    static T ExclusiveScan(InputIt inBegin, InputIt inEnd, OutputIt outBegin,
+                           T init, BinaryOp op)
+  {
+    return vtk::detail::smp::vtkSMPTools_Impl_Scan(inBegin,inEnd,outBegin,
+                                                   init,op,false);
+  }
+  template<typename InputIt, typename OutputIt, typename T>
+    static T ExclusiveScan(InputIt inBegin, InputIt inEnd, OutputIt outBegin,
+                           T init)
+  {
+    return vtk::detail::smp::vtkSMPTools_Impl_Scan(inBegin,inEnd,outBegin,
+                                                   init,std::plus<T>(),false);
+  }
+
+  // Description:
+  // Compute an inclusive prefix scan (prefix sum by default) of
+  // [inBegin,inEnd) into the range beginning at outBegin: the i-th output
+  // is init combined with input elements 0 through i. The input and output
+  // ranges may be the same. Returns the last output value (or init if the
+  // range is empty).
+  template<typename InputIt, typename OutputIt, typename T, typename BinaryOp>
+    static T InclusiveScan(InputIt inBegin, InputIt inEnd, OutputIt outBegin,
+                           T init, BinaryOp op)
+  {
+    return vtk::detail::smp::vtkSMPTools_Impl_Scan(inBegin,inEnd,outBegin,
+                                                   init,op,true);
+  }
+  template<typename InputIt, typename OutputIt, typename T>
+    static T InclusiveScan(InputIt inBegin, InputIt inEnd, OutputIt outBegin,
+                           T init)
+  {
+    return vtk::detail::smp::vtkSMPTools_Impl_Scan(inBegin,inEnd,outBegin,
+                                                   init,std::plus<T>(),true);
+  }
+
 };
 
 #endif
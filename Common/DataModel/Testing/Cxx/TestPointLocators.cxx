@@ -13,12 +13,15 @@
 
 =========================================================================*/
 #include "vtkIdList.h"
+#include "vtkIdTypeArray.h"
 #include "vtkKdTree.h"
 #include "vtkKdTreePointLocator.h"
 #include "vtkMath.h"
 #include "vtkOctreePointLocator.h"
 #include "vtkPointLocator.h"
 #include "vtkPoints.h"
+#include "vtkPolyData.h"
+#include "vtkStaticPointLocator.h"
 #include "vtkStructuredGrid.h"
 
 // returns true if 2 points are equidistant from x, within a tolerance
@@ -292,6 +295,104 @@ int TestKdTreePointLocator()
   return rval;
 }
 
+// This test checks that the batch queries of vtkStaticPointLocator return
+// the same results as the corresponding single point queries.
+int TestStaticPointLocatorBatch()
+{
+  int rval = 0;
+  vtkIdType num_points = 5000;
+  vtkIdType num_queries = 2000;
+  vtkIdType i, j;
+
+  vtkPoints *points = vtkPoints::New();
+  points->SetDataTypeToDouble();
+  points->SetNumberOfPoints(num_points);
+  for (i = 0; i < num_points; ++i)
+    {
+    points->SetPoint(i, vtkMath::Random(), vtkMath::Random(),
+                     vtkMath::Random());
+    }
+  vtkPolyData *pdata = vtkPolyData::New();
+  pdata->SetPoints(points);
+  points->Delete();
+
+  // Float query positions, partly outside the bounds of the points
+  vtkPoints *query = vtkPoints::New();
+  query->SetDataTypeToFloat();
+  query->SetNumberOfPoints(num_queries);
+  for (i = 0; i < num_queries; ++i)
+    {
+    query->SetPoint(i, vtkMath::Random(-0.2, 1.2), vtkMath::Random(-0.2, 1.2),
+                    vtkMath::Random(-0.2, 1.2));
+    }
+
+  vtkStaticPointLocator *locator = vtkStaticPointLocator::New();
+  locator->SetDataSet(pdata);
+  locator->BuildLocator();
+
+  vtkIdTypeArray *closest = vtkIdTypeArray::New();
+  vtkIdTypeArray *closestInRadius = vtkIdTypeArray::New();
+  vtkIdTypeArray *offsets = vtkIdTypeArray::New();
+  vtkIdTypeArray *ids = vtkIdTypeArray::New();
+  vtkIdList *list = vtkIdList::New();
+  double radius = 0.05;
+  locator->FindClosestPoints(query, closest);
+  locator->FindClosestPointsWithinRadius(radius, query, closestInRadius);
+  locator->FindPointsWithinRadius(radius, query, offsets, ids);
+
+  if (closest->GetNumberOfTuples() != num_queries ||
+      closestInRadius->GetNumberOfTuples() != num_queries ||
+      offsets->GetNumberOfTuples() != num_queries+1 ||
+      offsets->GetValue(num_queries) != ids->GetNumberOfTuples())
+    {
+    cerr << "Wrong size of batch query results\n";
+    rval++;
+    }
+  else
+    {
+    for (i = 0; i < num_queries; ++i)
+      {
+      double x[3], dist2;
+      query->GetPoint(i, x);
+      if (closest->GetValue(i) != locator->FindClosestPoint(x) ||
+          closestInRadius->GetValue(i) !=
+          locator->FindClosestPointWithinRadius(radius, x, dist2))
+        {
+        cerr << "Batch closest point differs for query " << i << "\n";
+        rval++;
+        }
+      locator->FindPointsWithinRadius(radius, x, list);
+      vtkIdType begin = offsets->GetValue(i);
+      if (offsets->GetValue(i+1) - begin != list->GetNumberOfIds())
+        {
+        cerr << "Batch points within radius differ for query " << i << "\n";
+        rval++;
+        continue;
+        }
+      for (j = 0; j < list->GetNumberOfIds(); ++j)
+        {
+        if (ids->GetValue(begin+j) != list->GetId(j))
+          {
+          cerr << "Batch points within radius differ for query " << i << "\n";
+          rval++;
+          break;
+          }
+        }
+      }
+    }
+
+  list->Delete();
+  ids->Delete();
+  offsets->Delete();
+  closestInRadius->Delete();
+  closest->Delete();
+  locator->Delete();
+  query->Delete();
+  pdata->Delete();
+
+  return rval;
+}
+
 int TestPointLocators(int , char *[])
 {
   vtkKdTreePointLocator* kdTreeLocator = vtkKdTreePointLocator::New();
@@ -305,11 +406,20 @@ int TestPointLocators(int , char *[])
   cout << "Comparing vtkOctreePointLocator to vtkKdTreePointLocator.\n";
   rval += ComparePointLocators(octreeLocator, kdTreeLocator);
 
+  vtkStaticPointLocator* staticLocator = vtkStaticPointLocator::New();
+
+  cout << "Comparing vtkStaticPointLocator to vtkKdTreePointLocator.\n";
+  rval += ComparePointLocators(staticLocator, kdTreeLocator);
+
   kdTreeLocator->Delete();
   uniformLocator->Delete();
   octreeLocator->Delete();
+  staticLocator->Delete();
 
   rval += TestKdTreePointLocator();
 
+  cout << "Testing vtkStaticPointLocator batch queries.\n";
+  rval += TestStaticPointLocatorBatch();
+
   return rval;
 }
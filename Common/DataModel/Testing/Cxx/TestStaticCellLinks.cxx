@@ -14,6 +14,9 @@
 =========================================================================*/
 #include "vtkStaticCellLinks.h"
 #include "vtkStaticCellLinksTemplate.h"
+#include "vtkCellArray.h"
+#include "vtkCellLinks.h"
+#include "vtkPoints.h"
 #include "vtkSmartPointer.h"
 #include "vtkImageData.h"
 #include "vtkUnstructuredGrid.h"
@@ -23,6 +26,35 @@
 #include "vtkSphereSource.h"
 #include "vtkTimerLog.h"
 
+// Check that the dynamic links of a dataset match the static links, and that
+// the cells using a point are listed in increasing order.
+static int CompareLinks(vtkDataSet *ds, vtkCellLinks *links)
+{
+  vtkStaticCellLinksTemplate<int> slinks;
+  slinks.BuildLinks(ds);
+
+  for (vtkIdType ptId=0; ptId < ds->GetNumberOfPoints(); ++ptId)
+    {
+    int numCells = slinks.GetNumberOfCells(ptId);
+    const int *cells = slinks.GetCells(ptId);
+    if ( links->GetNcells(ptId) != numCells )
+      {
+      cout << "Wrong number of cells for point " << ptId << "\n";
+      return 0;
+      }
+    for (int i=0; i < numCells; ++i)
+      {
+      if ( links->GetCells(ptId)[i] != cells[i] ||
+           ( i > 0 && cells[i-1] >= cells[i] ) )
+        {
+        cout << "Wrong cells for point " << ptId << "\n";
+        return 0;
+        }
+      }
+    }
+  return 1;
+}
+
 // Test the building of static cell links in both unstructured and structured
 // grids.
 int TestStaticCellLinks( int, char *[] )
@@ -191,5 +223,65 @@ int TestStaticCellLinks( int, char *[] )
     return EXIT_FAILURE;
     }
 
+  //----------------------------------------------------------------------------
+  // The dynamic links are built from static links
+  ugrid->BuildLinks();
+  vtkSmartPointer<vtkCellLinks> pdLinks =
+    vtkSmartPointer<vtkCellLinks>::New();
+  pdLinks->Allocate(pdata->GetNumberOfPoints());
+  pdLinks->BuildLinks(pdata);
+  if ( !CompareLinks(ugrid, ugrid->GetCellLinks()) ||
+       !CompareLinks(pdata, pdLinks) )
+    {
+    return EXIT_FAILURE;
+    }
+
+  // Lists built together can still be edited and copied
+  vtkSmartPointer<vtkCellLinks> links =
+    vtkSmartPointer<vtkCellLinks>::New();
+  links->DeepCopy(pdLinks);
+  links->ResizeCellList(0, 1);
+  links->AddCellReference(1000, 0);
+  links->DeletePoint(5);
+  if ( links->GetNcells(0) != 13 || links->GetCells(0)[12] != 1000 ||
+       links->GetNcells(5) != 0 || !CompareLinks(pdata, pdLinks) )
+    {
+    return EXIT_FAILURE;
+    }
+
+  // Polydata cell ids follow the order of insertion, not the order of the
+  // cell arrays.
+  vtkSmartPointer<vtkPolyData> mixed =
+    vtkSmartPointer<vtkPolyData>::New();
+  mixed->SetPoints(pdata->GetPoints());
+  mixed->Allocate(10);
+  vtkIdType tri[3] = {0, 1, 2};
+  vtkIdType vert[1] = {1};
+  mixed->InsertNextCell(VTK_TRIANGLE, 3, tri);
+  mixed->InsertNextCell(VTK_VERTEX, 1, vert);
+  slinks.BuildLinks(mixed);
+  numCells = slinks.GetNumberOfCells(1);
+  cells = slinks.GetCells(1);
+  unsigned short numPtCells;
+  vtkIdType *ptCells;
+  mixed->BuildLinks();
+  mixed->GetPointCells(1, numPtCells, ptCells);
+  if ( numCells != 2 || cells[0] != 0 || cells[1] != 1 ||
+       numPtCells != 2 || ptCells[0] != 0 || ptCells[1] != 1 )
+    {
+    return EXIT_FAILURE;
+    }
+
+  // Links built from a single cell array
+  vtkSmartPointer<vtkCellLinks> polyLinks =
+    vtkSmartPointer<vtkCellLinks>::New();
+  polyLinks->Allocate(pdata->GetNumberOfPoints());
+  polyLinks->BuildLinks(pdata, pdata->GetPolys());
+  slinks.BuildLinks(pdata->GetNumberOfPoints(), pdata->GetPolys());
+  if ( polyLinks->GetNcells(0) != 12 || slinks.GetNumberOfCells(0) != 12 )
+    {
+    return EXIT_FAILURE;
+    }
+
   return EXIT_SUCCESS;
 }
@@ -16,9 +16,10 @@
 
 #include "vtkCellArray.h"
 #include "vtkDataSet.h"
-#include "vtkGenericCell.h"
 #include "vtkObjectFactory.h"
 #include "vtkPolyData.h"
+#include "vtkSMPTools.h"
+#include "vtkStaticCellLinksTemplate.h"
 
 vtkStandardNewMacro(vtkCellLinks);
 
@@ -35,12 +36,15 @@ void vtkCellLinks::Initialize()
     {
     for (vtkIdType i=0; i<=this->MaxId; i++)
       {
-      delete [] this->Array[i].cells;
+      this->FreeCellList(i);
       }
 
     delete [] this->Array;
     this->Array = NULL;
     }
+  delete [] this->Storage;
+  this->Storage = NULL;
+  this->StorageSize = 0;
 }
 
 //----------------------------------------------------------------------------
@@ -124,125 +128,73 @@ vtkCellLinks::Link *vtkCellLinks::Resize(vtkIdType sz)
 }
 
 //----------------------------------------------------------------------------
-// Build the link list array.
-void vtkCellLinks::BuildLinks(vtkDataSet *data)
+// Set the links from the offsets of the static links.
+namespace
 {
-  vtkIdType numPts = data->GetNumberOfPoints();
-  vtkIdType numCells = data->GetNumberOfCells();
-  int j;
-  vtkIdType cellId;
-  unsigned short *linkLoc;
-
-  // fill out lists with number of references to cells
-  linkLoc = new unsigned short[numPts];
-  memset(linkLoc, 0, numPts*sizeof(unsigned short));
-
-  // Use fast path if polydata
-  if ( data->GetDataObjectType() == VTK_POLY_DATA )
-    {
-    vtkIdType *pts, npts;
-
-    vtkPolyData *pdata = static_cast<vtkPolyData *>(data);
-    // traverse data to determine number of uses of each point
-    for (cellId=0; cellId < numCells; cellId++)
-      {
-      pdata->GetCellPoints(cellId, npts, pts);
-      for (j=0; j < npts; j++)
-        {
-        this->IncrementLinkCount(pts[j]);
-        }
-      }
-
-    // now allocate storage for the links
-    this->AllocateLinks(numPts);
-    this->MaxId = numPts - 1;
+struct SetLinks
+{
+  vtkCellLinks::Link *Array;
+  vtkIdType *Storage;
+  const vtkIdType *Offsets;
 
-    for (cellId=0; cellId < numCells; cellId++)
-      {
-      pdata->GetCellPoints(cellId, npts, pts);
-      for (j=0; j < npts; j++)
-        {
-        this->InsertCellReference(pts[j], (linkLoc[pts[j]])++, cellId);
-        }
-      }
+  SetLinks(vtkCellLinks::Link *array, vtkIdType *storage,
+           const vtkIdType *offsets) :
+    Array(array), Storage(storage), Offsets(offsets)
+    {
     }
 
-  else //any other type of dataset
+  void operator()(vtkIdType ptId, vtkIdType endPtId)
     {
-    vtkIdType numberOfPoints, ptId;
-    vtkGenericCell *cell=vtkGenericCell::New();
-
-    // traverse data to determine number of uses of each point
-    for (cellId=0; cellId < numCells; cellId++)
+    for ( ; ptId < endPtId; ++ptId )
       {
-      data->GetCell(cellId,cell);
-      numberOfPoints = cell->GetNumberOfPoints();
-      for (j=0; j < numberOfPoints; j++)
-        {
-        this->IncrementLinkCount(cell->PointIds->GetId(j));
-        }
+      this->Array[ptId].ncells = static_cast<unsigned short>(
+        this->Offsets[ptId+1] - this->Offsets[ptId]);
+      this->Array[ptId].cells = this->Storage + this->Offsets[ptId];
       }
-
-    // now allocate storage for the links
-    this->AllocateLinks(numPts);
-    this->MaxId = numPts - 1;
-
-    for (cellId=0; cellId < numCells; cellId++)
-      {
-      data->GetCell(cellId,cell);
-      numberOfPoints = cell->GetNumberOfPoints();
-      for (j=0; j < numberOfPoints; j++)
-        {
-        ptId = cell->PointIds->GetId(j);
-        this->InsertCellReference(ptId, (linkLoc[ptId])++, cellId);
-        }
-      }
-    cell->Delete();
-    }//end else
-
-  delete [] linkLoc;
+    }
+};
 }
 
 //----------------------------------------------------------------------------
-// Build the link list array.
-void vtkCellLinks::BuildLinks(vtkDataSet *data, vtkCellArray *Connectivity)
+void vtkCellLinks::AdoptLinks(vtkStaticCellLinksTemplate<vtkIdType> &links)
 {
-  vtkIdType numPts = data->GetNumberOfPoints();
-  vtkIdType j, cellId;
-  unsigned short *linkLoc;
-  vtkIdType npts=0;
-  vtkIdType *pts=0;
-  vtkIdType loc = Connectivity->GetTraversalLocation();
-
-  // traverse data to determine number of uses of each point
-  for (Connectivity->InitTraversal();
-       Connectivity->GetNextCell(npts,pts);)
+  vtkIdType numPts = links.NumPts;
+  for (vtkIdType ptId=0; ptId <= this->MaxId; ptId++)
     {
-    for (j=0; j < npts; j++)
-      {
-      this->IncrementLinkCount(pts[j]);
-      }
+    this->FreeCellList(ptId);
+    }
+  if ( this->Size < numPts )
+    {
+    this->Allocate(numPts, this->Extend);
     }
 
-  // now allocate storage for the links
-  this->AllocateLinks(numPts);
+  // Previously built lists are replaced
+  delete [] this->Storage;
+  this->Storage = links.Links;
+  this->StorageSize = links.LinksSize;
+  links.Links = NULL;
+
+  SetLinks setLinks(this->Array, this->Storage, links.Offsets);
+  vtkSMPTools::For(0, numPts, setLinks);
   this->MaxId = numPts - 1;
+}
 
-  // fill out lists with references to cells
-  linkLoc = new unsigned short[numPts];
-  memset(linkLoc, 0, numPts*sizeof(unsigned short));
+//----------------------------------------------------------------------------
+// Build the link list array.
+void vtkCellLinks::BuildLinks(vtkDataSet *data)
+{
+  vtkStaticCellLinksTemplate<vtkIdType> links;
+  links.BuildLinks(data);
+  this->AdoptLinks(links);
+}
 
-  cellId = 0;
-  for (Connectivity->InitTraversal();
-       Connectivity->GetNextCell(npts,pts); cellId++)
-    {
-    for (j=0; j < npts; j++)
-      {
-      this->InsertCellReference(pts[j], (linkLoc[pts[j]])++, cellId);
-      }
-    }
-  delete [] linkLoc;
-  Connectivity->SetTraversalLocation(loc);
+//----------------------------------------------------------------------------
+// Build the link list array.
+void vtkCellLinks::BuildLinks(vtkDataSet *data, vtkCellArray *Connectivity)
+{
+  vtkStaticCellLinksTemplate<vtkIdType> links;
+  links.BuildLinks(data->GetNumberOfPoints(), Connectivity);
+  this->AdoptLinks(links);
 }
 
 //----------------------------------------------------------------------------
@@ -278,8 +230,27 @@ unsigned long vtkCellLinks::GetActualMemorySize()
 //----------------------------------------------------------------------------
 void vtkCellLinks::DeepCopy(vtkCellLinks *src)
 {
+  vtkIdType ptId;
+
+  this->Initialize();
   this->Allocate(src->Size, src->Extend);
-  memcpy(this->Array, src->Array, this->Size * sizeof(vtkCellLinks::Link));
+
+  // Copy the lists of cells into contiguous storage
+  for (this->StorageSize=0, ptId=0; ptId <= src->MaxId; ptId++)
+    {
+    this->StorageSize += src->Array[ptId].ncells;
+    }
+  this->Storage = new vtkIdType[this->StorageSize];
+
+  vtkIdType *cells = this->Storage;
+  for (ptId=0; ptId <= src->MaxId; ptId++)
+    {
+    this->Array[ptId].ncells = src->Array[ptId].ncells;
+    this->Array[ptId].cells = cells;
+    memcpy(cells, src->Array[ptId].cells,
+           src->Array[ptId].ncells*sizeof(vtkIdType));
+    cells += src->Array[ptId].ncells;
+    }
   this->MaxId = src->MaxId;
 }
 
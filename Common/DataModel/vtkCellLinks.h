@@ -19,6 +19,11 @@
 // a list of cell ids, each such link representing a dynamic list of cell ids
 // using the point. The information provided by this object can be used to
 // determine neighbors and construct other local topological information.
+//
+// BuildLinks() constructs the links in parallel (see
+// vtkStaticCellLinksTemplate) and stores the lists of cells contiguously
+// in a single block of memory. The lists may still be edited incrementally
+// afterwards; a list that grows is moved into its own allocation.
 
 // .SECTION Caveats
 // Note that this class is designed to support incremental link construction.
@@ -37,6 +42,7 @@
 
 class vtkDataSet;
 class vtkCellArray;
+template <typename TIds> class vtkStaticCellLinksTemplate;
 
 class VTKCOMMONDATAMODEL_EXPORT vtkCellLinks : public vtkAbstractCellLinks
 {
@@ -60,7 +66,8 @@ public:
   virtual void BuildLinks(vtkDataSet *data);
 
   // Description:
-  // Build the link list array with a provided connectivity array.
+  // Build the link list array with a provided connectivity array. Cell ids
+  // are assigned in traversal order of the connectivity array.
   void BuildLinks(vtkDataSet *data, vtkCellArray *Connectivity);
 
   // Description:
@@ -139,7 +146,8 @@ public:
   void DeepCopy(vtkCellLinks *src);
 
 protected:
-  vtkCellLinks():Array(NULL),Size(0),MaxId(-1),Extend(1000) {}
+  vtkCellLinks():Array(NULL),Size(0),MaxId(-1),Extend(1000),
+    Storage(NULL),StorageSize(0) {}
   virtual ~vtkCellLinks();
 
   // Description:
@@ -148,6 +156,11 @@ protected:
 
   void AllocateLinks(vtkIdType n);
 
+  // Description:
+  // Free the list of cells of a point, unless it is part of the storage
+  // shared by all lists.
+  void FreeCellList(vtkIdType ptId);
+
   // Description:
   // Insert a cell id into the list of cells using the point.
   void InsertCellReference(vtkIdType ptId, unsigned short pos,
@@ -159,6 +172,13 @@ protected:
   vtkIdType Extend;     // grow array by this point
   Link *Resize(vtkIdType sz);  // function to resize data
 
+  // Contiguous storage of the lists of cells built by BuildLinks()
+  vtkIdType *Storage;
+  vtkIdType StorageSize;
+
+  // Take over the storage of static links and point the lists into it.
+  void AdoptLinks(vtkStaticCellLinksTemplate<vtkIdType> &links);
+
 private:
   vtkCellLinks(const vtkCellLinks&) VTK_DELETE_FUNCTION;
   void operator=(const vtkCellLinks&) VTK_DELETE_FUNCTION;
@@ -172,11 +192,21 @@ inline void vtkCellLinks::InsertCellReference(vtkIdType ptId,
   this->Array[ptId].cells[pos] = cellId;
 }
 
+//----------------------------------------------------------------------------
+inline void vtkCellLinks::FreeCellList(vtkIdType ptId)
+{
+  vtkIdType *cells = this->Array[ptId].cells;
+  if ( cells < this->Storage || cells > this->Storage + this->StorageSize )
+    {
+    delete [] cells;
+    }
+}
+
 //----------------------------------------------------------------------------
 inline void vtkCellLinks::DeletePoint(vtkIdType ptId)
 {
   this->Array[ptId].ncells = 0;
-  delete [] this->Array[ptId].cells;
+  this->FreeCellList(ptId);
   this->Array[ptId].cells = NULL;
 }
 
@@ -223,7 +253,7 @@ inline void vtkCellLinks::ResizeCellList(vtkIdType ptId, int size)
   cells = new vtkIdType[newSize];
   memcpy(cells, this->Array[ptId].cells,
          this->Array[ptId].ncells*sizeof(vtkIdType));
-  delete [] this->Array[ptId].cells;
+  this->FreeCellList(ptId);
   this->Array[ptId].cells = cells;
 }
 
@@ -256,6 +256,9 @@ protected:
 
   void ComputePerformanceFactors();
 
+  // Lets vtkCleanPolyData bin points with the buckets of the locator.
+  friend class vtkCleanPolyDataToPointLocatorFriendship;
+
 private:
   vtkPointLocator(const vtkPointLocator&) VTK_DELETE_FUNCTION;
   void operator=(const vtkPointLocator&) VTK_DELETE_FUNCTION;
@@ -35,6 +35,12 @@
 // non-templated class vtkStaticCellLinks can be used for convenience;
 // although it uses vtkIdType and thereby loses some speed and memory
 // advantage.
+//
+// The links are built in parallel with vtkSMPTools: the uses of each point
+// are counted with atomic increments, a prefix sum of the counts provides
+// the offsets, and the cell ids are then filled in. Each list of cells is
+// sorted in increasing cell id order, so the result does not depend on the
+// number of threads.
 
 // .SECTION See Also
 // vtkCellLinks vtkStaticCellLinks
@@ -46,6 +52,7 @@ class vtkDataSet;
 class vtkPolyData;
 class vtkUnstructuredGrid;
 class vtkCellArray;
+class vtkCellLinks;
 
 
 template <typename TIds>
@@ -80,6 +87,12 @@ public:
   // Build the link list array for vtkUnstructuredGrid.
   void BuildLinks(vtkUnstructuredGrid *ugrid);
 
+  // Description:
+  // Build the link list array for the cells of a single cell array whose
+  // points have ids in the range [0,numPts). Cell ids are assigned in
+  // traversal order.
+  void BuildLinks(vtkIdType numPts, vtkCellArray *cells);
+
   // Description:
   // Get the number of cells using the point specified by ptId.
   TIds GetNumberOfCells(vtkIdType ptId)
@@ -104,6 +117,19 @@ protected:
   TIds *Links; //contiguous runs of cell ids
   TIds *Offsets; //offsets for each point into the link array
 
+  // Count, prefix sum, fill and sort for any kind of cell access.
+  template <typename TCells>
+  void BuildLinksFromCells(TCells &cells);
+
+  // Functors used by BuildLinksFromCells()
+  template <typename TCells> struct CountUses;
+  template <typename TCells> struct InsertCells;
+  struct SortCells;
+
+  // vtkCellLinks uses the link array as storage for its lists
+  friend class vtkCellLinks;
+
+
 private:
   vtkStaticCellLinksTemplate(const vtkStaticCellLinksTemplate&) VTK_DELETE_FUNCTION;
   void operator=(const vtkStaticCellLinksTemplate&) VTK_DELETE_FUNCTION;
@@ -19,255 +19,328 @@
 
 #include "vtkCellArray.h"
 #include "vtkDataSet.h"
+#include "vtkIdList.h"
+#include "vtkIdTypeArray.h"
 #include "vtkPolyData.h"
+#include "vtkSMPThreadLocalObject.h"
+#include "vtkSMPTools.h"
 #include "vtkUnstructuredGrid.h"
 
-//----------------------------------------------------------------------------
-// Note: this class is a faster, serial version of vtkCellLinks. Future work
-// to parallelize this class is possible. This includes:
-// = using a parallel prefix sum operation
-// = using atomics to update counts (i.e., number of cells using a point)
+#include <algorithm>
+#include <vector>
 
 //----------------------------------------------------------------------------
-// Clean up any previously allocated memory
-template <typename TIds> void vtkStaticCellLinksTemplate<TIds>::
-Initialize()
+// The links are built in three parallel passes over the cells or points:
+// the uses of each point are counted with atomic increments; an inclusive
+// prefix sum turns the counts into the end of each point's run of cells;
+// the cells are then inserted by decrementing the run ends, which leaves
+// them pointing to the beginning of each run. As threads insert cells in
+// any order, each run is finally sorted.
+//
+// The cell access classes below provide the point ids of a cell in a way
+// that is safe to use from several threads at the same time.
+namespace vtkStaticCellLinksDetail
 {
-  if ( this->Links )
+// Any dataset. Each thread uses its own id list.
+struct DataSetCells
+{
+  vtkDataSet *DataSet;
+  vtkSMPThreadLocalObject<vtkIdList> CellPts;
+
+  DataSetCells(vtkDataSet *ds) : DataSet(ds)
     {
-    delete [] this->Links;
-    this->Links = NULL;
+    // Some datasets build internal structures on the first request for
+    // the points of a cell. Do so before the threads start.
+    if ( ds->GetNumberOfCells() > 0 )
+      {
+      ds->GetCellPoints(0,this->CellPts.Local());
+      }
     }
-  if ( this->Offsets )
+  vtkIdType GetNumberOfCells()
     {
-    delete [] this->Offsets;
-    this->Offsets = NULL;
+    return this->DataSet->GetNumberOfCells();
+    }
+  void GetCellPoints(vtkIdType cellId, vtkIdType &npts, vtkIdType* &pts)
+    {
+    vtkIdList *cellPts = this->CellPts.Local();
+    this->DataSet->GetCellPoints(cellId,cellPts);
+    npts = cellPts->GetNumberOfIds();
+    pts = cellPts->GetPointer(0);
+    }
+};
+
+// Polydata, using the random access provided by its cell types.
+struct PolyDataCells
+{
+  vtkPolyData *PolyData;
+
+  PolyDataCells(vtkPolyData *pd) : PolyData(pd)
+    {
+    if ( pd->NeedToBuildCells() )
+      {
+      pd->BuildCells();
+      }
     }
+  vtkIdType GetNumberOfCells()
+    {
+    return this->PolyData->GetNumberOfCells();
+    }
+  void GetCellPoints(vtkIdType cellId, vtkIdType &npts, vtkIdType* &pts)
+    {
+    this->PolyData->GetCellPoints(cellId,npts,pts);
+    }
+};
+
+// A connectivity array (n,id1,id2,...) with the location of each cell.
+struct CellArrayCells
+{
+  vtkIdType *Connectivity;
+  const vtkIdType *Locations;
+  vtkIdType NumberOfCells;
+
+  CellArrayCells(vtkIdType *conn, const vtkIdType *locs, vtkIdType numCells)
+    : Connectivity(conn), Locations(locs), NumberOfCells(numCells)
+    {
+    }
+  vtkIdType GetNumberOfCells()
+    {
+    return this->NumberOfCells;
+    }
+  void GetCellPoints(vtkIdType cellId, vtkIdType &npts, vtkIdType* &pts)
+    {
+    pts = this->Connectivity + this->Locations[cellId];
+    npts = *pts++;
+    }
+};
 }
 
 //----------------------------------------------------------------------------
-// Build the link list array for any dataset type. Specialized methods are
-// used for dataset types that use vtkCellArrays to represent cells.
-template <typename TIds> void vtkStaticCellLinksTemplate<TIds>::
-BuildLinks(vtkDataSet *ds)
+// Count the number of uses of each point.
+template <typename TIds> template <typename TCells>
+struct vtkStaticCellLinksTemplate<TIds>::CountUses
 {
-  // Use a fast path if polydata or unstructured grid
-  if ( ds->GetDataObjectType() == VTK_POLY_DATA )
+  TCells &Cells;
+  vtkAtomic<TIds> *Counts;
+
+  CountUses(TCells &cells, vtkAtomic<TIds> *counts) :
+    Cells(cells), Counts(counts)
     {
-    return this->BuildLinks(static_cast<vtkPolyData*>(ds));
     }
 
-  else if ( ds->GetDataObjectType() == VTK_UNSTRUCTURED_GRID )
+  void operator()(vtkIdType cellId, vtkIdType endCellId)
     {
-    return this->BuildLinks(static_cast<vtkUnstructuredGrid*>(ds));
+    vtkIdType npts, *pts;
+    for ( ; cellId < endCellId; ++cellId )
+      {
+      this->Cells.GetCellPoints(cellId,npts,pts);
+      for (vtkIdType i=0; i < npts; ++i)
+        {
+        ++this->Counts[pts[i]];
+        }
+      }
     }
+};
 
-  // Any other type of dataset. Generally this is not called as datasets have
-  // their own, more efficient ways of getting similar information.
-  // Make sure that we clear out previous allocation.
-  this->NumCells = ds->GetNumberOfCells();
-  this->NumPts = ds->GetNumberOfPoints();
-
-  vtkIdType npts, ptId;
-  vtkIdType cellId, j;
-  vtkIdList *cellPts = vtkIdList::New();
+//----------------------------------------------------------------------------
+// Insert the cells into the runs. On entry RunEnds holds the end of each
+// point's run; on exit it holds the beginning.
+template <typename TIds> template <typename TCells>
+struct vtkStaticCellLinksTemplate<TIds>::InsertCells
+{
+  TCells &Cells;
+  vtkAtomic<TIds> *RunEnds;
+  TIds *Links;
 
-  // Traverse data to determine number of uses of each point. Also count the
-  // number of links to allocate.
-  this->Offsets = new TIds[this->NumPts+1];
-  std::fill_n(this->Offsets, this->NumPts, 0);
+  InsertCells(TCells &cells, vtkAtomic<TIds> *runEnds, TIds *links) :
+    Cells(cells), RunEnds(runEnds), Links(links)
+    {
+    }
 
-  for (this->LinksSize=0, cellId=0; cellId < this->NumCells; cellId++)
+  void operator()(vtkIdType cellId, vtkIdType endCellId)
     {
-    ds->GetCellPoints(cellId,cellPts);
-    npts = cellPts->GetNumberOfIds();
-    for (j=0; j < npts; j++)
+    vtkIdType npts, *pts;
+    for ( ; cellId < endCellId; ++cellId )
       {
-      this->Offsets[cellPts->GetId(j)]++;
-      this->LinksSize++;
+      this->Cells.GetCellPoints(cellId,npts,pts);
+      for (vtkIdType i=0; i < npts; ++i)
+        {
+        this->Links[--this->RunEnds[pts[i]]] = static_cast<TIds>(cellId);
+        }
       }
     }
+};
 
-  // Allocate space for links. Perform prefix sum.
-  this->Links = new TIds[this->LinksSize+1];
-  this->Links[this->LinksSize] = this->NumPts;
+//----------------------------------------------------------------------------
+// Copy the beginning of each run into the offsets and sort the run.
+template <typename TIds>
+struct vtkStaticCellLinksTemplate<TIds>::SortCells
+{
+  vtkAtomic<TIds> *RunBegins;
+  vtkStaticCellLinksTemplate<TIds> *Self;
 
-  for ( ptId=0; ptId < this->NumPts; ++ptId )
+  SortCells(vtkAtomic<TIds> *runBegins, vtkStaticCellLinksTemplate<TIds> *self) :
+    RunBegins(runBegins), Self(self)
     {
-    npts = this->Offsets[ptId+1];
-    this->Offsets[ptId+1] = this->Offsets[ptId] + npts;
     }
 
-  // Now build the links. The summation from the prefix sum indicates where
-  // the cells are to be inserted. Each time a cell is inserted, the offset
-  // is decremented. In the end, the offset array is also constructed as it
-  // points to the beginning of each cell run.
-  for ( cellId=0; cellId < this->NumCells; ++cellId )
+  void operator()(vtkIdType ptId, vtkIdType endPtId)
     {
-    ds->GetCellPoints(cellId,cellPts);
-    npts = cellPts->GetNumberOfIds();
-    for (j=0; j<npts; ++j)
+    TIds *links = this->Self->Links;
+    for ( ; ptId < endPtId; ++ptId )
       {
-      ptId = cellPts->GetId(j);
-      this->Offsets[ptId]--;
-      this->Links[this->Offsets[ptId]] = cellId;
+      TIds begin = this->RunBegins[ptId];
+      TIds end = ( ptId+1 < this->Self->NumPts ?
+                   static_cast<TIds>(this->RunBegins[ptId+1]) :
+                   this->Self->LinksSize );
+      this->Self->Offsets[ptId] = begin;
+      if ( end - begin > 1 )
+        {
+        std::sort(links + begin, links + end);
+        }
       }
     }
-  this->Offsets[this->NumPts] = this->LinksSize;
+};
 
-  cellPts->Delete();
+//----------------------------------------------------------------------------
+// Clean up any previously allocated memory
+template <typename TIds> void vtkStaticCellLinksTemplate<TIds>::
+Initialize()
+{
+  if ( this->Links )
+    {
+    delete [] this->Links;
+    this->Links = NULL;
+    }
+  if ( this->Offsets )
+    {
+    delete [] this->Offsets;
+    this->Offsets = NULL;
+    }
+  this->LinksSize = 0;
+  this->NumPts = 0;
+  this->NumCells = 0;
 }
 
 //----------------------------------------------------------------------------
-// Build the link list array for unstructured grids
-template <typename TIds> void vtkStaticCellLinksTemplate<TIds>::
-BuildLinks(vtkUnstructuredGrid *ugrid)
+// Build the links from any kind of cell access. The number of points must
+// be set.
+template <typename TIds> template <typename TCells>
+void vtkStaticCellLinksTemplate<TIds>::
+BuildLinksFromCells(TCells &cells)
 {
-  // Basic information about the grid
-  this->NumCells = ugrid->GetNumberOfCells();
-  this->NumPts = ugrid->GetNumberOfPoints();
+  this->NumCells = static_cast<TIds>(cells.GetNumberOfCells());
 
-  // We're going to get into the guts of the class
-  vtkCellArray *cellArray = ugrid->GetCells();
-  const vtkIdType *cells = cellArray->GetPointer();
+  // Count the uses of each point
+  vtkAtomic<TIds> *runs = new vtkAtomic<TIds>[this->NumPts];
+  CountUses<TCells> count(cells,runs);
+  vtkSMPTools::For(0,this->NumCells,count);
 
-  // I love this trick: the size of the Links array is equal to
-  // the size of the cell array, minus the number of cells.
-  this->LinksSize =
-    cellArray->GetNumberOfConnectivityEntries() - this->NumCells;
+  // Perform prefix sum. The counts become the ends of the runs.
+  this->LinksSize = vtkSMPTools::InclusiveScan(runs, runs+this->NumPts,
+                                               runs, static_cast<TIds>(0));
 
   // Extra one allocated to simplify later pointer manipulation
   this->Links = new TIds[this->LinksSize+1];
   this->Links[this->LinksSize] = this->NumPts;
   this->Offsets = new TIds[this->NumPts+1];
-  std::fill_n(this->Offsets, this->NumPts, 0);
+  this->Offsets[this->NumPts] = this->LinksSize;
 
-  // Now create the links.
-  vtkIdType npts, cellId, ptId;
-  const vtkIdType *cell=cells;
-  int i;
+  // Now build the links and the offsets
+  InsertCells<TCells> insert(cells,runs,this->Links);
+  vtkSMPTools::For(0,this->NumCells,insert);
+  SortCells sort(runs,this);
+  vtkSMPTools::For(0,this->NumPts,sort);
 
-  // Count number of point uses
-  for ( cellId=0; cellId < this->NumCells; ++cellId )
-    {
-    npts = *cell++;
-    for (i=0; i<npts; ++i)
-      {
-      this->Offsets[*cell++]++;
-      }
-    }
+  delete [] runs;
+}
 
-  // Perform prefix sum
-  for ( ptId=0; ptId < this->NumPts; ++ptId )
+//----------------------------------------------------------------------------
+// Build the link list array for any dataset type. Specialized methods are
+// used for dataset types that use vtkCellArrays to represent cells.
+template <typename TIds> void vtkStaticCellLinksTemplate<TIds>::
+BuildLinks(vtkDataSet *ds)
+{
+  // Use a fast path if polydata or unstructured grid
+  if ( ds->GetDataObjectType() == VTK_POLY_DATA )
     {
-    npts = this->Offsets[ptId+1];
-    this->Offsets[ptId+1] = this->Offsets[ptId] + npts;
+    return this->BuildLinks(static_cast<vtkPolyData*>(ds));
     }
 
-  // Now build the links. The summation from the prefix sum indicates where
-  // the cells are to be inserted. Each time a cell is inserted, the offset
-  // is decremented. In the end, the offset array is also constructed as it
-  // points to the beginning of each cell run.
-  for ( cell=cells, cellId=0; cellId < this->NumCells; ++cellId )
+  else if ( ds->GetDataObjectType() == VTK_UNSTRUCTURED_GRID )
     {
-    npts = *cell++;
-    for (i=0; i<npts; ++i)
-      {
-      this->Offsets[*cell]--;
-      this->Links[this->Offsets[*cell++]] = cellId;
-      }
+    return this->BuildLinks(static_cast<vtkUnstructuredGrid*>(ds));
     }
-  this->Offsets[this->NumPts] = this->LinksSize;
+
+  // Any other type of dataset. Generally this is not called as datasets have
+  // their own, more efficient ways of getting similar information.
+  // Make sure that we clear out previous allocation.
+  this->Initialize();
+  this->NumPts = static_cast<TIds>(ds->GetNumberOfPoints());
+
+  vtkStaticCellLinksDetail::DataSetCells cells(ds);
+  this->BuildLinksFromCells(cells);
 }
 
 //----------------------------------------------------------------------------
-// Build the link list array for poly data. This is more complex because there
-// are potentially fout different cell arrays to contend with.
+// Build the link list array for unstructured grids
 template <typename TIds> void vtkStaticCellLinksTemplate<TIds>::
-BuildLinks(vtkPolyData *pd)
+BuildLinks(vtkUnstructuredGrid *ugrid)
 {
-  // Basic information about the grid
-  this->NumCells = pd->GetNumberOfCells();
-  this->NumPts = pd->GetNumberOfPoints();
+  this->Initialize();
+  this->NumPts = static_cast<TIds>(ugrid->GetNumberOfPoints());
 
-  vtkCellArray *cellArrays[4];
-  vtkIdType numCells[4];
-  vtkIdType sizes[4];
-  int i, j;
-
-  cellArrays[0] = pd->GetVerts();
-  cellArrays[1] = pd->GetLines();
-  cellArrays[2] = pd->GetPolys();
-  cellArrays[3] = pd->GetStrips();
-
-  for (i=0; i<4; ++i)
+  // We're going to get into the guts of the class: the cell locations give
+  // random access to the connectivity.
+  vtkCellArray *cellArray = ugrid->GetCells();
+  vtkIdTypeArray *locations = ugrid->GetCellLocationsArray();
+  if ( cellArray == NULL || locations == NULL )
     {
-    if ( cellArrays[i] != NULL )
-      {
-      numCells[i] = cellArrays[i]->GetNumberOfCells();
-      sizes[i] = cellArrays[i]->GetNumberOfConnectivityEntries() - numCells[i];
-      }
-    else
-      {
-      numCells[i] = 0;
-      sizes[i] = 0;
-      }
-    }//for the four polydata arrays
+    vtkStaticCellLinksDetail::CellArrayCells cells(NULL,NULL,0);
+    this->BuildLinksFromCells(cells);
+    return;
+    }
 
-  // Allocate
-  this->LinksSize = sizes[0] + sizes[1] + sizes[2] + sizes[3];
-  this->Links = new TIds[this->LinksSize+1];
-  this->Links[this->LinksSize] = this->NumPts;
-  this->Offsets = new TIds[this->NumPts+1];
-  this->Offsets[this->NumPts] = this->LinksSize;
-  std::fill_n(this->Offsets, this->NumPts, 0);
+  vtkStaticCellLinksDetail::CellArrayCells
+    cells(cellArray->GetPointer(), locations->GetPointer(0),
+          ugrid->GetNumberOfCells());
+  this->BuildLinksFromCells(cells);
+}
 
-  // Now create the links.
-  vtkIdType npts, cellId, CellId, ptId;
-  const vtkIdType *cell;
+//----------------------------------------------------------------------------
+// Build the link list array for poly data. The cells of polydata are spread
+// over four different cell arrays; the cell types of the polydata map cell
+// ids to these arrays (and account for deleted cells).
+template <typename TIds> void vtkStaticCellLinksTemplate<TIds>::
+BuildLinks(vtkPolyData *pd)
+{
+  this->Initialize();
+  this->NumPts = static_cast<TIds>(pd->GetNumberOfPoints());
 
-  // Visit the four arrays
-  for ( CellId=0, j=0; j < 4; ++j )
-    {
-    // Count number of point uses
-    cell = cellArrays[j]->GetPointer();
-    for ( cellId=0; cellId < numCells[j]; ++cellId )
-      {
-      npts = *cell++;
-      for (i=0; i<npts; ++i)
-        {
-        this->Offsets[CellId+(*cell++)]++;
-        }
-      }
-    CellId += numCells[j];
-    } //for each of the four polydata cell arrays
+  vtkStaticCellLinksDetail::PolyDataCells cells(pd);
+  this->BuildLinksFromCells(cells);
+}
 
-  // Perform prefix sum
-  for ( ptId=0; ptId < this->NumPts; ++ptId )
+//----------------------------------------------------------------------------
+// Build the link list array for a single cell array. The cell array has no
+// random access, so the cell locations are found first.
+template <typename TIds> void vtkStaticCellLinksTemplate<TIds>::
+BuildLinks(vtkIdType numPts, vtkCellArray *cellArray)
+{
+  this->Initialize();
+  this->NumPts = static_cast<TIds>(numPts);
+
+  vtkIdType numCells = cellArray->GetNumberOfCells();
+  vtkIdType *conn = cellArray->GetPointer();
+  std::vector<vtkIdType> locations(numCells+1);
+  vtkIdType loc = 0;
+  for (vtkIdType cellId=0; cellId < numCells; ++cellId)
     {
-    npts = this->Offsets[ptId+1];
-    this->Offsets[ptId+1] = this->Offsets[ptId] + npts;
+    locations[cellId] = loc;
+    loc += conn[loc] + 1;
     }
 
-  // Now build the links. The summation from the prefix sum indicates where
-  // the cells are to be inserted. Each time a cell is inserted, the offset
-  // is decremented. In the end, the offset array is also constructed as it
-  // points to the beginning of each cell run.
-  for ( CellId=0, j=0; j < 4; ++j )
-    {
-    cell = cellArrays[j]->GetPointer();
-    for ( cellId=0; cellId < numCells[j]; ++cellId )
-      {
-      npts = *cell++;
-      for (i=0; i<npts; ++i)
-        {
-        this->Offsets[*cell]--;
-        this->Links[this->Offsets[*cell++]] = CellId+cellId;
-        }
-      }
-    CellId += numCells[j];
-    }//for each of the four polydata arrays
-  this->Offsets[this->NumPts] = this->LinksSize;
+  vtkStaticCellLinksDetail::CellArrayCells cells(conn,&locations[0],numCells);
+  this->BuildLinksFromCells(cells);
 }
 
 #endif
@@ -16,11 +16,14 @@
 
 #include "vtkCellArray.h"
 #include "vtkIdList.h"
+#include "vtkIdTypeArray.h"
 #include "vtkIntArray.h"
 #include "vtkMath.h"
 #include "vtkObjectFactory.h"
 #include "vtkPoints.h"
 #include "vtkPolyData.h"
+#include "vtkSMPThreadLocal.h"
+#include "vtkSMPThreadLocalObject.h"
 #include "vtkSMPTools.h"
 
 #include <vector>
@@ -1327,6 +1330,238 @@ GenerateRepresentation(int vtkNotUsed(level), vtkPolyData *pd)
   pd->Squeeze();
 }
 
+//-----------------------------------------------------------------------------
+// The following code supports batch queries. Each query position is
+// processed independently, so the queries are simply distributed over the
+// threads with vtkSMPTools.
+namespace {
+
+// Access to the query positions. Float and double arrays with the standard
+// memory layout are read directly, anything else through vtkDataArray.
+struct QueryPoints
+{
+  vtkDataArray *Array;
+  const float *FloatPts;
+  const double *DoublePts;
+
+  QueryPoints(vtkDataArray *array) :
+    Array(array), FloatPts(NULL), DoublePts(NULL)
+    {
+      if ( array->HasStandardMemoryLayout() )
+        {
+        if ( array->GetDataType() == VTK_FLOAT )
+          {
+          this->FloatPts = static_cast<float*>(array->GetVoidPointer(0));
+          }
+        else if ( array->GetDataType() == VTK_DOUBLE )
+          {
+          this->DoublePts = static_cast<double*>(array->GetVoidPointer(0));
+          }
+        }
+    }
+
+  void GetPoint(vtkIdType qId, double x[3]) const
+    {
+      if ( this->DoublePts )
+        {
+        const double *p = this->DoublePts + 3*qId;
+        x[0] = p[0];
+        x[1] = p[1];
+        x[2] = p[2];
+        }
+      else if ( this->FloatPts )
+        {
+        const float *p = this->FloatPts + 3*qId;
+        x[0] = static_cast<double>(p[0]);
+        x[1] = static_cast<double>(p[1]);
+        x[2] = static_cast<double>(p[2]);
+        }
+      else
+        {
+        this->Array->GetTuple(qId, x);
+        }
+    }
+};
+
+// Closest point (optionally within a radius) to each query position
+template <typename TIds>
+struct FindClosestPointsBatch
+{
+  BucketList<TIds> *BList;
+  QueryPoints Query;
+  vtkIdType *Closest;
+  double Radius;
+  double InputDataLength;
+  bool WithinRadius;
+
+  FindClosestPointsBatch(BucketList<TIds> *blist, vtkDataArray *queryPts,
+                         vtkIdType *closest) :
+    BList(blist), Query(queryPts), Closest(closest), Radius(0.0),
+    InputDataLength(0.0), WithinRadius(false)
+    {
+    }
+
+  void operator()(vtkIdType qId, vtkIdType endQId)
+    {
+      double x[3], dist2;
+      for ( ; qId < endQId; ++qId )
+        {
+        this->Query.GetPoint(qId, x);
+        this->Closest[qId] = ( !this->WithinRadius ?
+          this->BList->FindClosestPoint(x) :
+          this->BList->FindClosestPointWithinRadius(
+            this->Radius, x, this->InputDataLength, dist2) );
+        }
+    }
+};
+
+// Points within a radius of each query position. The number of points
+// found for each query is stored in Counts. The ids are gathered in thread
+// local buffers along with the ranges of queries that produced them; once
+// the counts are turned into offsets the buffers are copied into place.
+template <typename TIds>
+struct FindPointsWithinRadiusBatch
+{
+  struct QueryRange
+  {
+    vtkIdType Begin;
+    vtkIdType End;
+    vtkIdType Start; // location of the ids of the range in the local buffer
+  };
+  struct LocalResults
+  {
+    std::vector<vtkIdType> Ids;
+    std::vector<QueryRange> Ranges;
+  };
+
+  BucketList<TIds> *BList;
+  QueryPoints Query;
+  double Radius;
+  vtkIdType *Counts;
+  vtkSMPThreadLocalObject<vtkIdList> Result;
+  vtkSMPThreadLocal<LocalResults> Local;
+
+  FindPointsWithinRadiusBatch(BucketList<TIds> *blist, vtkDataArray *queryPts,
+                              double radius, vtkIdType *counts) :
+    BList(blist), Query(queryPts), Radius(radius), Counts(counts)
+    {
+    }
+
+  void operator()(vtkIdType qId, vtkIdType endQId)
+    {
+      double x[3];
+      vtkIdList *result = this->Result.Local();
+      LocalResults &local = this->Local.Local();
+      std::vector<vtkIdType> &ids = local.Ids;
+      QueryRange range;
+      range.Begin = qId;
+      range.End = endQId;
+      range.Start = static_cast<vtkIdType>(ids.size());
+      local.Ranges.push_back(range);
+
+      for ( ; qId < endQId; ++qId )
+        {
+        this->Query.GetPoint(qId, x);
+        this->BList->FindPointsWithinRadius(this->Radius, x, result);
+        vtkIdType numIds = result->GetNumberOfIds();
+        this->Counts[qId] = numIds;
+        ids.insert(ids.end(), result->GetPointer(0),
+                   result->GetPointer(0) + numIds);
+        }
+    }
+};
+
+// Copy the ids of ranges of queries into their final location
+struct CopyRanges
+{
+  std::vector<const vtkIdType*> &Sources;
+  std::vector<vtkIdType> &Begins;
+  std::vector<vtkIdType> &Ends;
+  const vtkIdType *Offsets;
+  vtkIdType *Ids;
+
+  CopyRanges(std::vector<const vtkIdType*> &sources,
+             std::vector<vtkIdType> &begins, std::vector<vtkIdType> &ends,
+             const vtkIdType *offsets, vtkIdType *ids) :
+    Sources(sources), Begins(begins), Ends(ends), Offsets(offsets), Ids(ids)
+    {
+    }
+
+  void operator()(vtkIdType range, vtkIdType endRange)
+    {
+      for ( ; range < endRange; ++range )
+        {
+        vtkIdType begin = this->Offsets[this->Begins[range]];
+        vtkIdType end = this->Offsets[this->Ends[range]];
+        std::copy(this->Sources[range], this->Sources[range] + (end - begin),
+                  this->Ids + begin);
+        }
+    }
+};
+
+//-----------------------------------------------------------------------------
+template <typename TIds>
+void BatchFindClosestPoints(BucketList<TIds> *blist, vtkDataArray *queryPts,
+                            vtkIdTypeArray *closest, bool withinRadius,
+                            double radius, double inputDataLength)
+{
+  vtkIdType numQueries = queryPts->GetNumberOfTuples();
+  closest->SetNumberOfComponents(1);
+  closest->SetNumberOfTuples(numQueries);
+
+  FindClosestPointsBatch<TIds> find(blist, queryPts, closest->GetPointer(0));
+  find.WithinRadius = withinRadius;
+  find.Radius = radius;
+  find.InputDataLength = inputDataLength;
+  vtkSMPTools::For(0, numQueries, find);
+}
+
+//-----------------------------------------------------------------------------
+template <typename TIds>
+void BatchFindPointsWithinRadius(BucketList<TIds> *blist, double radius,
+                                 vtkDataArray *queryPts,
+                                 vtkIdTypeArray *offsets, vtkIdTypeArray *ids)
+{
+  vtkIdType numQueries = queryPts->GetNumberOfTuples();
+  offsets->SetNumberOfComponents(1);
+  offsets->SetNumberOfTuples(numQueries+1);
+  vtkIdType *offsetsPtr = offsets->GetPointer(0);
+
+  // Perform the queries, counting the points found for each query
+  FindPointsWithinRadiusBatch<TIds> find(blist, queryPts, radius, offsetsPtr);
+  vtkSMPTools::For(0, numQueries, find);
+
+  // Prefix sum of the counts, in place
+  vtkIdType numIds = vtkSMPTools::ExclusiveScan(
+    offsetsPtr, offsetsPtr+numQueries, offsetsPtr, static_cast<vtkIdType>(0));
+  offsetsPtr[numQueries] = numIds;
+
+  // Gather the ranges processed by the threads and copy their ids
+  std::vector<const vtkIdType*> sources;
+  std::vector<vtkIdType> begins, ends;
+  typedef FindPointsWithinRadiusBatch<TIds> BatchType;
+  typename vtkSMPThreadLocal<typename BatchType::LocalResults>::iterator
+    iter = find.Local.begin();
+  for ( ; iter != find.Local.end(); ++iter )
+    {
+    const vtkIdType *localIds = iter->Ids.empty() ? NULL : &iter->Ids[0];
+    typename std::vector<typename BatchType::QueryRange>::iterator r;
+    for ( r=iter->Ranges.begin(); r != iter->Ranges.end(); ++r )
+      {
+      sources.push_back(localIds + r->Start);
+      begins.push_back(r->Begin);
+      ends.push_back(r->End);
+      }
+    }
+
+  ids->SetNumberOfComponents(1);
+  ids->SetNumberOfTuples(numIds);
+  CopyRanges copy(sources, begins, ends, offsetsPtr, ids->GetPointer(0));
+  vtkSMPTools::For(0, static_cast<vtkIdType>(sources.size()), copy);
+}
+
+} //anonymous namespace
+
 //-----------------------------------------------------------------------------
 // Here is the VTK class proper. It's implemented with the templated
 // BucketList class.
@@ -1595,6 +1830,126 @@ FindPointsWithinRadius(double R, const double x[3], vtkIdList *result)
     }
 }
 
+//-----------------------------------------------------------------------------
+void vtkStaticPointLocator::
+FindClosestPoints(vtkDataArray *queryPts, vtkIdTypeArray *closest)
+{
+  if ( queryPts->GetNumberOfComponents() != 3 )
+    {
+    vtkErrorMacro(<<"Query positions must have three components");
+    return;
+    }
+  this->BuildLocator(); // will subdivide if modified; otherwise returns
+  if ( !this->Buckets )
+    {
+    closest->SetNumberOfComponents(1);
+    closest->SetNumberOfTuples(queryPts->GetNumberOfTuples());
+    closest->FillComponent(0, -1);
+    return;
+    }
+
+  if ( this->LargeIds )
+    {
+    BatchFindClosestPoints(static_cast<BucketList<vtkIdType>*>(this->Buckets),
+                           queryPts, closest, false, 0.0, 0.0);
+    }
+  else
+    {
+    BatchFindClosestPoints(static_cast<BucketList<int>*>(this->Buckets),
+                           queryPts, closest, false, 0.0, 0.0);
+    }
+}
+
+//-----------------------------------------------------------------------------
+void vtkStaticPointLocator::
+FindClosestPoints(vtkPoints *queryPts, vtkIdTypeArray *closest)
+{
+  this->FindClosestPoints(queryPts->GetData(), closest);
+}
+
+//-----------------------------------------------------------------------------
+void vtkStaticPointLocator::
+FindClosestPointsWithinRadius(double radius, vtkDataArray *queryPts,
+                              vtkIdTypeArray *closest)
+{
+  if ( queryPts->GetNumberOfComponents() != 3 )
+    {
+    vtkErrorMacro(<<"Query positions must have three components");
+    return;
+    }
+  this->BuildLocator(); // will subdivide if modified; otherwise returns
+  if ( !this->Buckets )
+    {
+    closest->SetNumberOfComponents(1);
+    closest->SetNumberOfTuples(queryPts->GetNumberOfTuples());
+    closest->FillComponent(0, -1);
+    return;
+    }
+
+  // Computed once up front; GetLength() is not thread safe
+  double inputDataLength = this->DataSet->GetLength();
+  if ( this->LargeIds )
+    {
+    BatchFindClosestPoints(static_cast<BucketList<vtkIdType>*>(this->Buckets),
+                           queryPts, closest, true, radius, inputDataLength);
+    }
+  else
+    {
+    BatchFindClosestPoints(static_cast<BucketList<int>*>(this->Buckets),
+                           queryPts, closest, true, radius, inputDataLength);
+    }
+}
+
+//-----------------------------------------------------------------------------
+void vtkStaticPointLocator::
+FindClosestPointsWithinRadius(double radius, vtkPoints *queryPts,
+                              vtkIdTypeArray *closest)
+{
+  this->FindClosestPointsWithinRadius(radius, queryPts->GetData(), closest);
+}
+
+//-----------------------------------------------------------------------------
+void vtkStaticPointLocator::
+FindPointsWithinRadius(double R, vtkDataArray *queryPts,
+                       vtkIdTypeArray *offsets, vtkIdTypeArray *ids)
+{
+  if ( queryPts->GetNumberOfComponents() != 3 )
+    {
+    vtkErrorMacro(<<"Query positions must have three components");
+    return;
+    }
+  this->BuildLocator(); // will subdivide if modified; otherwise returns
+  if ( !this->Buckets )
+    {
+    offsets->SetNumberOfComponents(1);
+    offsets->SetNumberOfTuples(queryPts->GetNumberOfTuples()+1);
+    offsets->FillComponent(0, 0);
+    ids->SetNumberOfTuples(0);
+    return;
+    }
+
+  if ( this->LargeIds )
+    {
+    BatchFindPointsWithinRadius(
+      static_cast<BucketList<vtkIdType>*>(this->Buckets), R, queryPts,
+      offsets, ids);
+    }
+  else
+    {
+    BatchFindPointsWithinRadius(
+      static_cast<BucketList<int>*>(this->Buckets), R, queryPts,
+      offsets, ids);
+    }
+}
+
+//-----------------------------------------------------------------------------
+void vtkStaticPointLocator::
+FindPointsWithinRadius(double R, vtkPoints *queryPts,
+                       vtkIdTypeArray *offsets, vtkIdTypeArray *ids)
+{
+  this->FindPointsWithinRadius(R, queryPts->GetData(), offsets, ids);
+}
+
 //-----------------------------------------------------------------------------
 void vtkStaticPointLocator::
 GenerateRepresentation(int level, vtkPolyData *pd)
@@ -25,6 +25,12 @@
 // threaded (via vtkSMPTools), and supports one-time static construction
 // (i.e., incremental point insertion is not supported). If you need to
 // incrementally insert points, use the vtkPointLocator or its kin to do so.
+//
+// Besides the single point queries of the vtkAbstractPointLocator API,
+// batch queries process a whole array of query positions in parallel.
+// Queries returning a variable number of points per position store their
+// results in compressed (CSR) form: an offsets array and an ids array,
+// where the ids found for query position i are ids[offsets[i],offsets[i+1]).
 
 // .SECTION Caveats
 // This class is templated. It may run slower than serial execution if the code
@@ -48,7 +54,10 @@
 #include "vtkCommonDataModelModule.h" // For export macro
 #include "vtkAbstractPointLocator.h"
 
+class vtkDataArray;
 class vtkIdList;
+class vtkIdTypeArray;
+class vtkPoints;
 class vtkBucketList;
 
 
@@ -123,6 +132,33 @@ public:
   virtual void FindPointsWithinRadius(double R, const double x[3],
                                       vtkIdList *result);
 
+  // Description:
+  // Batch version of FindClosestPoint(). For each position in queryPts
+  // (an array of 3-component tuples, e.g., vtkPoints::GetData()) the id of
+  // the closest point is stored in closest, which is resized to the number
+  // of query positions. The queries are processed in parallel.
+  void FindClosestPoints(vtkDataArray *queryPts, vtkIdTypeArray *closest);
+  void FindClosestPoints(vtkPoints *queryPts, vtkIdTypeArray *closest);
+
+  // Description:
+  // Batch version of FindClosestPointWithinRadius(). The id stored for a
+  // query position is -1 if there is no point within the radius.
+  void FindClosestPointsWithinRadius(double radius, vtkDataArray *queryPts,
+                                     vtkIdTypeArray *closest);
+  void FindClosestPointsWithinRadius(double radius, vtkPoints *queryPts,
+                                     vtkIdTypeArray *closest);
+
+  // Description:
+  // Batch version of FindPointsWithinRadius(). The points found within the
+  // radius R of query position i are ids[offsets[i],offsets[i+1]); offsets
+  // is resized to the number of query positions plus one. Within a query
+  // the ids are in the same order as the single point query returns them.
+  // The queries are processed in parallel.
+  void FindPointsWithinRadius(double R, vtkDataArray *queryPts,
+                              vtkIdTypeArray *offsets, vtkIdTypeArray *ids);
+  void FindPointsWithinRadius(double R, vtkPoints *queryPts,
+                              vtkIdTypeArray *offsets, vtkIdTypeArray *ids);
+
   // Description:
   // See vtkLocator and vtkAbstractPointLocator interface documentation.
   // These methods are not thread safe.
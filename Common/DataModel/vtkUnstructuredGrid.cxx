@@ -1298,7 +1298,9 @@ void vtkUnstructuredGrid::BuildLinks()
   this->Links = vtkCellLinks::New();
   this->Links->Allocate(this->GetNumberOfPoints());
   this->Links->Register(this);
-  this->Links->BuildLinks(this, this->Connectivity);
+  // The cell locations provide random access to the cells, which lets the
+  // links be built in parallel.
+  this->Links->BuildLinks(this);
   this->Links->Delete();
 }
 
@@ -0,0 +1,275 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    TestCellDataToPointDataParallel.cxx
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+// Checks vtkCellDataToPointData and vtkPointDataToCellData run on several
+// threads against a direct computation of the averages, on image data, a
+// structured grid with blanked cells, an unstructured grid and polydata.
+
+#include "vtkCellData.h"
+#include "vtkCellDataToPointData.h"
+#include "vtkDoubleArray.h"
+#include "vtkIdList.h"
+#include "vtkImageData.h"
+#include "vtkIntArray.h"
+#include "vtkMath.h"
+#include "vtkNew.h"
+#include "vtkPointData.h"
+#include "vtkPointDataToCellData.h"
+#include "vtkPoints.h"
+#include "vtkPolyData.h"
+#include "vtkSMPTools.h"
+#include "vtkSmartPointer.h"
+#include "vtkSphereSource.h"
+#include "vtkStructuredGrid.h"
+#include "vtkUnstructuredGrid.h"
+
+#include <vector>
+
+namespace
+{
+
+// A three component double array and an integer array, whose averages
+// must be rounded.
+void AddArrays(vtkDataSetAttributes *data, vtkIdType num)
+{
+  vtkNew<vtkDoubleArray> vectors;
+  vectors->SetName("Vectors");
+  vectors->SetNumberOfComponents(3);
+  vectors->SetNumberOfTuples(num);
+  vtkNew<vtkIntArray> labels;
+  labels->SetName("Labels");
+  labels->SetNumberOfTuples(num);
+  for (vtkIdType i = 0; i < num; i++)
+    {
+    vectors->SetTuple3(i, vtkMath::Random(-1.0, 1.0),
+                       vtkMath::Random(-1.0, 1.0), vtkMath::Random(-1.0, 1.0));
+    labels->SetValue(i, static_cast<int>(vtkMath::Random(0.0, 5.0)));
+    }
+  data->AddArray(vectors.GetPointer());
+  data->SetScalars(labels.GetPointer());
+}
+
+vtkSmartPointer<vtkImageData> MakeImage()
+{
+  vtkSmartPointer<vtkImageData> image = vtkSmartPointer<vtkImageData>::New();
+  image->SetExtent(0, 30, 0, 20, 0, 25);
+  return image;
+}
+
+vtkSmartPointer<vtkStructuredGrid> MakeStructuredGrid()
+{
+  vtkSmartPointer<vtkImageData> image = MakeImage();
+  vtkNew<vtkPoints> points;
+  points->SetNumberOfPoints(image->GetNumberOfPoints());
+  for (vtkIdType i = 0; i < image->GetNumberOfPoints(); i++)
+    {
+    points->SetPoint(i, image->GetPoint(i));
+    }
+  vtkSmartPointer<vtkStructuredGrid> grid =
+    vtkSmartPointer<vtkStructuredGrid>::New();
+  grid->SetExtent(image->GetExtent());
+  grid->SetPoints(points.GetPointer());
+  return grid;
+}
+
+// The cells of the image, as hexahedra.
+vtkSmartPointer<vtkUnstructuredGrid> MakeUnstructuredGrid()
+{
+  vtkSmartPointer<vtkImageData> image = MakeImage();
+  vtkSmartPointer<vtkStructuredGrid> sgrid = MakeStructuredGrid();
+  vtkSmartPointer<vtkUnstructuredGrid> grid =
+    vtkSmartPointer<vtkUnstructuredGrid>::New();
+  grid->SetPoints(sgrid->GetPoints());
+  grid->Allocate(image->GetNumberOfCells());
+  vtkNew<vtkIdList> ptIds;
+  for (vtkIdType i = 0; i < image->GetNumberOfCells(); i++)
+    {
+    image->GetCellPoints(i, ptIds.GetPointer());
+    vtkIdType hex[8] = { ptIds->GetId(0), ptIds->GetId(1), ptIds->GetId(3),
+                         ptIds->GetId(2), ptIds->GetId(4), ptIds->GetId(5),
+                         ptIds->GetId(7), ptIds->GetId(6) };
+    grid->InsertNextCell(VTK_HEXAHEDRON, 8, hex);
+    }
+  return grid;
+}
+
+vtkSmartPointer<vtkPolyData> MakePolyData()
+{
+  vtkNew<vtkSphereSource> sphere;
+  sphere->SetThetaResolution(60);
+  sphere->SetPhiResolution(40);
+  sphere->Update();
+  vtkSmartPointer<vtkPolyData> pd = vtkSmartPointer<vtkPolyData>::New();
+  pd->DeepCopy(sphere->GetOutput());
+  pd->GetPointData()->Initialize();
+  return pd;
+}
+
+// The expected average of a tuple over a list of ids.
+double Average(vtkDataArray *array, vtkIdList *ids, int c)
+{
+  double weight = 1.0 / ids->GetNumberOfIds();
+  double val = 0.0;
+  for (vtkIdType i = 0; i < ids->GetNumberOfIds(); i++)
+    {
+    val += weight * array->GetComponent(ids->GetId(i), c);
+    }
+  if (array->GetDataType() == VTK_INT)
+    {
+    val = vtkMath::Round(val);
+    }
+  return val;
+}
+
+bool CompareAverage(vtkDataArray *input, vtkDataArray *output,
+                    vtkIdType id, vtkIdList *ids)
+{
+  for (int c = 0; c < input->GetNumberOfComponents(); c++)
+    {
+    double expected = ids->GetNumberOfIds() ? Average(input, ids, c) : 0.0;
+    if (output->GetComponent(id, c) != expected)
+      {
+      cerr << "Expected " << expected << " for " << input->GetName()
+           << " at " << id << ", got " << output->GetComponent(id, c) << endl;
+      return false;
+      }
+    }
+  return true;
+}
+
+bool TestCellDataToPointData(vtkDataSet *ds)
+{
+  vtkNew<vtkCellDataToPointData> c2p;
+  c2p->SetInputData(ds);
+  c2p->Update();
+  vtkDataSet *output = c2p->GetOutput();
+
+  vtkStructuredGrid *sgrid = vtkStructuredGrid::SafeDownCast(ds);
+  const char *names[2] = { "Vectors", "Labels" };
+  vtkNew<vtkIdList> cellIds;
+  vtkNew<vtkIdList> visibleIds;
+  for (vtkIdType ptId = 0; ptId < ds->GetNumberOfPoints(); ptId++)
+    {
+    ds->GetPointCells(ptId, cellIds.GetPointer());
+    visibleIds->Reset();
+    for (vtkIdType i = 0; i < cellIds->GetNumberOfIds(); i++)
+      {
+      if (!sgrid || sgrid->IsCellVisible(cellIds->GetId(i)))
+        {
+        visibleIds->InsertNextId(cellIds->GetId(i));
+        }
+      }
+    for (int a = 0; a < 2; a++)
+      {
+      if (!CompareAverage(ds->GetCellData()->GetArray(names[a]),
+                          output->GetPointData()->GetArray(names[a]),
+                          ptId, visibleIds.GetPointer()))
+        {
+        return false;
+        }
+      }
+    }
+  return true;
+}
+
+bool TestPointDataToCellData(vtkDataSet *ds)
+{
+  vtkNew<vtkPointDataToCellData> p2c;
+  p2c->SetInputData(ds);
+  p2c->Update();
+  vtkDataSet *output = p2c->GetOutput();
+
+  const char *names[2] = { "Vectors", "Labels" };
+  vtkNew<vtkIdList> ptIds;
+  for (vtkIdType cellId = 0; cellId < ds->GetNumberOfCells(); cellId++)
+    {
+    ds->GetCellPoints(cellId, ptIds.GetPointer());
+    for (int a = 0; a < 2; a++)
+      {
+      if (!CompareAverage(ds->GetPointData()->GetArray(names[a]),
+                          output->GetCellData()->GetArray(names[a]),
+                          cellId, ptIds.GetPointer()))
+        {
+        return false;
+        }
+      }
+    }
+
+  // Categorical data is copied from a single point, whatever the number
+  // of threads.
+  vtkSMPTools::Initialize(1);
+  vtkNew<vtkPointDataToCellData> serial;
+  serial->SetInputData(ds);
+  serial->CategoricalDataOn();
+  serial->Update();
+  vtkSMPTools::Initialize(4);
+  vtkNew<vtkPointDataToCellData> parallel;
+  parallel->SetInputData(ds);
+  parallel->CategoricalDataOn();
+  parallel->Update();
+  for (int a = 0; a < 2; a++)
+    {
+    vtkDataArray *x = serial->GetOutput()->GetCellData()->GetArray(names[a]);
+    vtkDataArray *y = parallel->GetOutput()->GetCellData()->GetArray(names[a]);
+    for (vtkIdType cellId = 0; cellId < ds->GetNumberOfCells(); cellId++)
+      {
+      for (int c = 0; c < x->GetNumberOfComponents(); c++)
+        {
+        if (x->GetComponent(cellId, c) != y->GetComponent(cellId, c))
+          {
+          cerr << "Different categorical data for " << names[a] << " at "
+               << cellId << endl;
+          return false;
+          }
+        }
+      }
+    }
+  return true;
+}
+
+bool TestDataSet(vtkDataSet *ds, const char *name)
+{
+  AddArrays(ds->GetPointData(), ds->GetNumberOfPoints());
+  AddArrays(ds->GetCellData(), ds->GetNumberOfCells());
+  vtkSMPTools::Initialize(4);
+  if (!TestCellDataToPointData(ds) || !TestPointDataToCellData(ds))
+    {
+    cerr << "Failed for " << name << endl;
+    return false;
+    }
+  return true;
+}
+
+}
+
+int TestCellDataToPointDataParallel(int, char *[])
+{
+  vtkMath::RandomSeed(2468);
+
+  vtkSmartPointer<vtkStructuredGrid> sgrid = MakeStructuredGrid();
+  for (vtkIdType cellId = 0; cellId < sgrid->GetNumberOfCells(); cellId += 7)
+    {
+    sgrid->BlankCell(cellId);
+    }
+
+  if (!TestDataSet(MakeImage(), "image data") ||
+      !TestDataSet(sgrid, "structured grid") ||
+      !TestDataSet(MakeUnstructuredGrid(), "unstructured grid") ||
+      !TestDataSet(MakePolyData(), "polydata"))
+    {
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -14,10 +14,16 @@
 =========================================================================*/
 
 #include <vtkCellArray.h>
+#include <vtkCellData.h>
 #include <vtkCleanPolyData.h>
+#include <vtkIdTypeArray.h>
 #include <vtkMinimalStandardRandomSequence.h>
+#include <vtkPointData.h>
 #include <vtkSmartPointer.h>
 
+#include <algorithm>
+#include <vector>
+
 namespace
 {
 void InitializePolyData(vtkPolyData *polyData, int dataType)
@@ -65,6 +71,193 @@ void InitializePolyData(vtkPolyData *polyData, int dataType)
   polyData->SetVerts(verts);
 }
 
+// Build a mesh made of triangles that do not share their points, so that
+// points have to be merged. The points are shuffled and some points are
+// not used. A few cells become degenerate once merged.
+void InitializeMergePolyData(vtkPolyData *polyData, int dataType)
+{
+  const int res = 40;
+  vtkSmartPointer<vtkMinimalStandardRandomSequence> randomSequence
+    = vtkSmartPointer<vtkMinimalStandardRandomSequence>::New();
+  randomSequence->SetSeed(2);
+
+  std::vector<double> coords;
+  for (int j = 0; j < res; ++j)
+    {
+    for (int i = 0; i < res; ++i)
+      {
+      int corners[6][2] = {{i, j}, {i+1, j}, {i+1, j+1},
+                           {i, j}, {i+1, j+1}, {i, j+1}};
+      for (int k = 0; k < 6; ++k)
+        {
+        // -0.0 and 0.0 are merged
+        coords.push_back(corners[k][0] == 0 && k % 2 ? -0.0 :
+                         0.1 * corners[k][0]);
+        coords.push_back(0.1 * corners[k][1]);
+        coords.push_back(0.0);
+        }
+      }
+    }
+  // unused points
+  for (int k = 0; k < 30; ++k)
+    {
+    randomSequence->Next();
+    coords.push_back(randomSequence->GetValue());
+    coords.push_back(0.5);
+    coords.push_back(0.5);
+    }
+
+  vtkIdType numPts = static_cast<vtkIdType>(coords.size() / 3);
+  std::vector<vtkIdType> order(numPts);
+  for (vtkIdType i = 0; i < numPts; ++i)
+    {
+    order[i] = i;
+    }
+  for (vtkIdType i = numPts - 1; i > 0; --i)
+    {
+    randomSequence->Next();
+    vtkIdType j = static_cast<vtkIdType>(randomSequence->GetValue() * i);
+    std::swap(order[i], order[j]);
+    }
+  // order[i] is the position of point i in the shuffled array
+  vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
+  points->SetDataType(dataType);
+  points->SetNumberOfPoints(numPts);
+  vtkSmartPointer<vtkIdTypeArray> pointIds =
+    vtkSmartPointer<vtkIdTypeArray>::New();
+  pointIds->SetName("PointIds");
+  pointIds->SetNumberOfTuples(numPts);
+  for (vtkIdType i = 0; i < numPts; ++i)
+    {
+    points->SetPoint(order[i], &coords[3*i]);
+    pointIds->SetValue(order[i], i);
+    }
+
+  vtkSmartPointer<vtkCellArray> verts = vtkSmartPointer<vtkCellArray>::New();
+  vtkSmartPointer<vtkCellArray> lines = vtkSmartPointer<vtkCellArray>::New();
+  vtkSmartPointer<vtkCellArray> polys = vtkSmartPointer<vtkCellArray>::New();
+  vtkSmartPointer<vtkCellArray> strips = vtkSmartPointer<vtkCellArray>::New();
+  vtkIdType tri[3];
+  for (vtkIdType t = 0; t < 2*res*res; ++t)
+    {
+    for (int k = 0; k < 3; ++k)
+      {
+      tri[k] = order[3*t + k];
+      }
+    polys->InsertNextCell(3, tri);
+    }
+  // a degenerate triangle and a line that collapse
+  tri[0] = order[0];
+  tri[1] = order[3];
+  tri[2] = order[1];
+  polys->InsertNextCell(3, tri);
+  lines->InsertNextCell(2, tri);
+  lines->InsertNextCell(3, tri);
+  verts->InsertNextCell(2, tri + 1);
+  // a strip reduced to a triangle
+  vtkIdType strip[4] = {order[6], order[7], order[8], order[9]};
+  strips->InsertNextCell(4, strip);
+  strip[1] = order[13];
+  strips->InsertNextCell(4, strip);
+
+  polyData->SetPoints(points);
+  polyData->GetPointData()->AddArray(pointIds);
+  polyData->SetVerts(verts);
+  polyData->SetLines(lines);
+  polyData->SetPolys(polys);
+  polyData->SetStrips(strips);
+
+  vtkSmartPointer<vtkIdTypeArray> cellIds =
+    vtkSmartPointer<vtkIdTypeArray>::New();
+  cellIds->SetName("CellIds");
+  for (vtkIdType i = 0; i < polyData->GetNumberOfCells(); ++i)
+    {
+    cellIds->InsertNextValue(i);
+    }
+  polyData->GetCellData()->AddArray(cellIds);
+}
+
+int CompareCells(vtkCellArray *a, vtkCellArray *b)
+{
+  if (a->GetNumberOfCells() != b->GetNumberOfCells() ||
+      a->GetNumberOfConnectivityEntries() !=
+      b->GetNumberOfConnectivityEntries())
+    {
+    return 0;
+    }
+  for (vtkIdType i = 0; i < a->GetNumberOfConnectivityEntries(); ++i)
+    {
+    if (a->GetPointer()[i] != b->GetPointer()[i])
+      {
+      return 0;
+      }
+    }
+  return 1;
+}
+
+// The parallel merge must produce the same output as the serial one.
+int CompareParallelMerging(int dataType, int outputPointsPrecision)
+{
+  vtkSmartPointer<vtkPolyData> inputPolyData
+    = vtkSmartPointer<vtkPolyData>::New();
+  InitializeMergePolyData(inputPolyData, dataType);
+
+  vtkSmartPointer<vtkPolyData> outputs[2];
+  for (int parallel = 0; parallel < 2; ++parallel)
+    {
+    vtkSmartPointer<vtkCleanPolyData> cleanPolyData
+      = vtkSmartPointer<vtkCleanPolyData>::New();
+    cleanPolyData->SetParallelPointMerging(parallel);
+    cleanPolyData->SetOutputPointsPrecision(outputPointsPrecision);
+    cleanPolyData->SetInputData(inputPolyData);
+    cleanPolyData->Update();
+    outputs[parallel] = cleanPolyData->GetOutput();
+    }
+
+  vtkPolyData *serial = outputs[0];
+  vtkPolyData *parallel = outputs[1];
+  vtkIdType numPts = serial->GetNumberOfPoints();
+  if (numPts != 41*41 || parallel->GetNumberOfPoints() != numPts)
+    {
+    std::cerr << "Unexpected number of points: " << numPts << " and "
+              << parallel->GetNumberOfPoints() << std::endl;
+    return 0;
+    }
+  vtkDataArray *serialIds = serial->GetPointData()->GetArray("PointIds");
+  vtkDataArray *parallelIds = parallel->GetPointData()->GetArray("PointIds");
+  for (vtkIdType i = 0; i < numPts; ++i)
+    {
+    double x[3], y[3];
+    serial->GetPoint(i, x);
+    parallel->GetPoint(i, y);
+    if (x[0] != y[0] || x[1] != y[1] || x[2] != y[2] ||
+        serialIds->GetTuple1(i) != parallelIds->GetTuple1(i))
+      {
+      std::cerr << "Point " << i << " differs." << std::endl;
+      return 0;
+      }
+    }
+  if (!CompareCells(serial->GetVerts(), parallel->GetVerts()) ||
+      !CompareCells(serial->GetLines(), parallel->GetLines()) ||
+      !CompareCells(serial->GetPolys(), parallel->GetPolys()) ||
+      !CompareCells(serial->GetStrips(), parallel->GetStrips()))
+    {
+    std::cerr << "Cells differ." << std::endl;
+    return 0;
+    }
+  vtkDataArray *serialCellIds = serial->GetCellData()->GetArray("CellIds");
+  vtkDataArray *parallelCellIds = parallel->GetCellData()->GetArray("CellIds");
+  for (vtkIdType i = 0; i < serial->GetNumberOfCells(); ++i)
+    {
+    if (serialCellIds->GetTuple1(i) != parallelCellIds->GetTuple1(i))
+      {
+      std::cerr << "Cell data differs." << std::endl;
+      return 0;
+      }
+    }
+  return 1;
+}
+
 int CleanPolyData(int dataType, int outputPointsPrecision)
 {
   vtkSmartPointer<vtkPolyData> inputPolyData
@@ -129,5 +322,12 @@ int TestCleanPolyData(int vtkNotUsed(argc), char *vtkNotUsed(argv)[])
     return EXIT_FAILURE;
     }
 
+  if (!CompareParallelMerging(VTK_FLOAT, vtkAlgorithm::DEFAULT_PRECISION) ||
+      !CompareParallelMerging(VTK_DOUBLE, vtkAlgorithm::DEFAULT_PRECISION) ||
+      !CompareParallelMerging(VTK_DOUBLE, vtkAlgorithm::SINGLE_PRECISION))
+    {
+    return EXIT_FAILURE;
+    }
+
   return EXIT_SUCCESS;
 }
@@ -0,0 +1,306 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    TestConnectivityFilterParallel.cxx
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+// Compares the regions labeled in parallel by vtkConnectivityFilter and
+// vtkPolyDataConnectivityFilter with the serial traversal, on a mesh made
+// of shuffled spheres, a long polyline and unused points.
+
+#include "vtkAppendPolyData.h"
+#include "vtkCellArray.h"
+#include "vtkCellData.h"
+#include "vtkConnectivityFilter.h"
+#include "vtkDataArray.h"
+#include "vtkIdList.h"
+#include "vtkIdTypeArray.h"
+#include "vtkMath.h"
+#include "vtkNew.h"
+#include "vtkPointData.h"
+#include "vtkPoints.h"
+#include "vtkPolyData.h"
+#include "vtkPolyDataConnectivityFilter.h"
+#include "vtkSMPTools.h"
+#include "vtkSmartPointer.h"
+#include "vtkSphereSource.h"
+#include "vtkUnstructuredGrid.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace
+{
+
+// Returns a random permutation of 0..n-1.
+std::vector<vtkIdType> Shuffle(vtkIdType n)
+{
+  std::vector<vtkIdType> ids(n);
+  for (vtkIdType i = 0; i < n; i++)
+    {
+    ids[i] = i;
+    }
+  for (vtkIdType i = n - 1; i > 0; i--)
+    {
+    vtkIdType j = static_cast<vtkIdType>(vtkMath::Random(0.0, i + 1.0));
+    std::swap(ids[i], ids[std::min(j, i)]);
+    }
+  return ids;
+}
+
+// Spheres of different sizes and a polyline whose points are numbered
+// backwards, with the points and the cells in random order.
+vtkSmartPointer<vtkPolyData> MakeMesh()
+{
+  vtkNew<vtkAppendPolyData> append;
+  for (int i = 0; i < 12; i++)
+    {
+    vtkNew<vtkSphereSource> sphere;
+    sphere->SetCenter(3.0 * i, 0.0, 0.0);
+    sphere->SetThetaResolution(4 + 3 * i);
+    sphere->SetPhiResolution(4 + 2 * i);
+    sphere->Update();
+    append->AddInputData(sphere->GetOutput());
+    }
+  append->Update();
+  vtkPolyData *spheres = append->GetOutput();
+
+  const vtkIdType numLinePts = 2000;
+  vtkIdType numPts = spheres->GetNumberOfPoints() + numLinePts + 10;
+  std::vector<vtkIdType> pointIds = Shuffle(numPts);
+  vtkNew<vtkPoints> points;
+  points->SetNumberOfPoints(numPts);
+  for (vtkIdType i = 0; i < spheres->GetNumberOfPoints(); i++)
+    {
+    points->SetPoint(pointIds[i], spheres->GetPoint(i));
+    }
+  for (vtkIdType i = spheres->GetNumberOfPoints(); i < numPts; i++)
+    {
+    points->SetPoint(pointIds[i], 0.01 * i, 5.0, 0.0);
+    }
+
+  // The cells of the spheres and the segments of the polyline, which are
+  // appended at the end of the mesh and come in random order.
+  std::vector<std::vector<vtkIdType> > cells;
+  vtkNew<vtkIdList> ptIds;
+  for (vtkIdType i = 0; i < spheres->GetNumberOfCells(); i++)
+    {
+    spheres->GetCellPoints(i, ptIds.GetPointer());
+    std::vector<vtkIdType> cell;
+    for (vtkIdType j = 0; j < ptIds->GetNumberOfIds(); j++)
+      {
+      cell.push_back(pointIds[ptIds->GetId(j)]);
+      }
+    cells.push_back(cell);
+    }
+  vtkIdType lineStart = spheres->GetNumberOfPoints();
+  std::sort(pointIds.begin() + lineStart,
+            pointIds.begin() + lineStart + numLinePts);
+  std::vector<std::vector<vtkIdType> > segments;
+  for (vtkIdType i = numLinePts - 1; i > 0; i--)
+    {
+    std::vector<vtkIdType> segment(2);
+    segment[0] = pointIds[lineStart + i];
+    segment[1] = pointIds[lineStart + i - 1];
+    segments.push_back(segment);
+    }
+  std::vector<vtkIdType> order = Shuffle(static_cast<vtkIdType>(cells.size()));
+  vtkNew<vtkCellArray> polys;
+  for (size_t i = 0; i < order.size(); i++)
+    {
+    const std::vector<vtkIdType> &cell = cells[order[i]];
+    polys->InsertNextCell(static_cast<vtkIdType>(cell.size()), &cell[0]);
+    }
+  vtkNew<vtkCellArray> lines;
+  order = Shuffle(static_cast<vtkIdType>(segments.size()));
+  for (size_t i = 0; i < order.size(); i++)
+    {
+    lines->InsertNextCell(2, &segments[order[i]][0]);
+    }
+
+  vtkSmartPointer<vtkPolyData> mesh = vtkSmartPointer<vtkPolyData>::New();
+  mesh->SetPoints(points.GetPointer());
+  mesh->SetPolys(polys.GetPointer());
+  mesh->SetLines(lines.GetPointer());
+  return mesh;
+}
+
+// The same cells as an unstructured grid, with a few empty cells.
+vtkSmartPointer<vtkUnstructuredGrid> MakeGrid(vtkPolyData *mesh)
+{
+  vtkSmartPointer<vtkUnstructuredGrid> grid =
+    vtkSmartPointer<vtkUnstructuredGrid>::New();
+  grid->SetPoints(mesh->GetPoints());
+  grid->Allocate(mesh->GetNumberOfCells() + 3);
+  vtkNew<vtkIdList> ptIds;
+  for (vtkIdType i = 0; i < mesh->GetNumberOfCells(); i++)
+    {
+    if (i % 1000 == 500)
+      {
+      grid->InsertNextCell(VTK_EMPTY_CELL, 0, NULL);
+      }
+    mesh->GetCellPoints(i, ptIds.GetPointer());
+    grid->InsertNextCell(mesh->GetCellType(i), ptIds.GetPointer());
+    }
+  return grid;
+}
+
+// Compares the outputs cell by cell. The output points are numbered
+// differently, so they are compared through their coordinates.
+bool CompareOutputs(vtkPointSet *a, vtkPointSet *b, vtkIdTypeArray *sizesA,
+                    vtkIdTypeArray *sizesB)
+{
+  if (sizesA->GetNumberOfTuples() < 2 ||
+      sizesA->GetNumberOfTuples() != sizesB->GetNumberOfTuples())
+    {
+    cerr << "Expected " << sizesA->GetNumberOfTuples() << " regions, got "
+         << sizesB->GetNumberOfTuples() << endl;
+    return false;
+    }
+  for (vtkIdType i = 0; i < sizesA->GetNumberOfTuples(); i++)
+    {
+    if (sizesA->GetValue(i) != sizesB->GetValue(i))
+      {
+      cerr << "Different size for region " << i << endl;
+      return false;
+      }
+    }
+
+  if (a->GetNumberOfPoints() != b->GetNumberOfPoints() ||
+      a->GetNumberOfCells() != b->GetNumberOfCells())
+    {
+    cerr << "Expected " << a->GetNumberOfPoints() << " points and "
+         << a->GetNumberOfCells() << " cells, got " << b->GetNumberOfPoints()
+         << " points and " << b->GetNumberOfCells() << " cells" << endl;
+    return false;
+    }
+  vtkDataArray *pointRegionsA = a->GetPointData()->GetArray("RegionId");
+  vtkDataArray *pointRegionsB = b->GetPointData()->GetArray("RegionId");
+  vtkDataArray *cellRegionsA = a->GetCellData()->GetArray("RegionId");
+  vtkDataArray *cellRegionsB = b->GetCellData()->GetArray("RegionId");
+  if (!pointRegionsA || !pointRegionsB || !cellRegionsA != !cellRegionsB)
+    {
+    cerr << "Missing region ids" << endl;
+    return false;
+    }
+  vtkNew<vtkIdList> ptIdsA;
+  vtkNew<vtkIdList> ptIdsB;
+  for (vtkIdType cellId = 0; cellId < a->GetNumberOfCells(); cellId++)
+    {
+    a->GetCellPoints(cellId, ptIdsA.GetPointer());
+    b->GetCellPoints(cellId, ptIdsB.GetPointer());
+    if (a->GetCellType(cellId) != b->GetCellType(cellId) ||
+        ptIdsA->GetNumberOfIds() != ptIdsB->GetNumberOfIds() ||
+        (cellRegionsA && cellRegionsA->GetComponent(cellId, 0) !=
+         cellRegionsB->GetComponent(cellId, 0)))
+      {
+      cerr << "Different cell " << cellId << endl;
+      return false;
+      }
+    for (vtkIdType i = 0; i < ptIdsA->GetNumberOfIds(); i++)
+      {
+      double xA[3], xB[3];
+      a->GetPoint(ptIdsA->GetId(i), xA);
+      b->GetPoint(ptIdsB->GetId(i), xB);
+      if (xA[0] != xB[0] || xA[1] != xB[1] || xA[2] != xB[2] ||
+          pointRegionsA->GetComponent(ptIdsA->GetId(i), 0) !=
+          pointRegionsB->GetComponent(ptIdsB->GetId(i), 0))
+        {
+        cerr << "Different point " << i << " of cell " << cellId << endl;
+        return false;
+        }
+      }
+    }
+  return true;
+}
+
+template <class TFilter>
+void SetUp(TFilter *filter, vtkDataSet *input, int mode, bool parallel)
+{
+  vtkSMPTools::Initialize(parallel ? 4 : 1);
+  filter->SetInputData(input);
+  filter->SetExtractionMode(mode);
+  filter->InitializeSpecifiedRegionList();
+  filter->AddSpecifiedRegion(1);
+  filter->AddSpecifiedRegion(3);
+  filter->ColorRegionsOn();
+  filter->SetParallelLabeling(parallel);
+  filter->Update();
+}
+
+bool TestPolyData(vtkPolyData *mesh, int mode)
+{
+  vtkNew<vtkPolyDataConnectivityFilter> serial;
+  SetUp(serial.GetPointer(), mesh, mode, false);
+  vtkNew<vtkPolyDataConnectivityFilter> parallel;
+  SetUp(parallel.GetPointer(), mesh, mode, true);
+  return CompareOutputs(serial->GetOutput(), parallel->GetOutput(),
+                        serial->GetRegionSizes(), parallel->GetRegionSizes());
+}
+
+// vtkConnectivityFilter has no accessor for the region sizes, so they are
+// computed from the cell region ids of all the regions.
+vtkSmartPointer<vtkIdTypeArray> GetRegionSizes(vtkDataSet *input,
+                                               bool parallel)
+{
+  vtkNew<vtkConnectivityFilter> all;
+  SetUp(all.GetPointer(), input, VTK_EXTRACT_ALL_REGIONS, parallel);
+  vtkSmartPointer<vtkIdTypeArray> sizes =
+    vtkSmartPointer<vtkIdTypeArray>::New();
+  sizes->SetNumberOfValues(all->GetNumberOfExtractedRegions());
+  sizes->FillComponent(0, 0);
+  vtkDataArray *regions = all->GetOutput()->GetCellData()->GetArray("RegionId");
+  for (vtkIdType i = 0; i < regions->GetNumberOfTuples(); i++)
+    {
+    vtkIdType region = static_cast<vtkIdType>(regions->GetComponent(i, 0));
+    sizes->SetValue(region, sizes->GetValue(region) + 1);
+    }
+  return sizes;
+}
+
+bool TestGrid(vtkUnstructuredGrid *grid, int mode)
+{
+  vtkNew<vtkConnectivityFilter> serial;
+  SetUp(serial.GetPointer(), grid, mode, false);
+  vtkNew<vtkConnectivityFilter> parallel;
+  SetUp(parallel.GetPointer(), grid, mode, true);
+  return CompareOutputs(serial->GetOutput(), parallel->GetOutput(),
+                        GetRegionSizes(grid, false),
+                        GetRegionSizes(grid, true));
+}
+
+}
+
+int TestConnectivityFilterParallel(int, char *[])
+{
+  vtkMath::RandomSeed(8642);
+  vtkSmartPointer<vtkPolyData> mesh = MakeMesh();
+  vtkSmartPointer<vtkUnstructuredGrid> grid = MakeGrid(mesh);
+
+  int modes[3] = { VTK_EXTRACT_LARGEST_REGION, VTK_EXTRACT_SPECIFIED_REGIONS,
+                   VTK_EXTRACT_ALL_REGIONS };
+  for (int i = 0; i < 3; i++)
+    {
+    if (!TestPolyData(mesh, modes[i]))
+      {
+      cerr << "Failed for vtkPolyDataConnectivityFilter in mode "
+           << modes[i] << endl;
+      return EXIT_FAILURE;
+      }
+    if (!TestGrid(grid, modes[i]))
+      {
+      cerr << "Failed for vtkConnectivityFilter in mode " << modes[i] << endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,297 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    TestGlyph3DParallel.cxx
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+// Compares vtkGlyph3D run on one and on several threads, with a single
+// glyph, a table of glyphs, a glyph mixing several kinds of cells and
+// attributes that are copied serially. The translated glyphs are also
+// checked against the input points.
+
+#include "vtkArrowSource.h"
+#include "vtkCellData.h"
+#include "vtkConeSource.h"
+#include "vtkCubeSource.h"
+#include "vtkDataArray.h"
+#include "vtkDoubleArray.h"
+#include "vtkFloatArray.h"
+#include "vtkGlyph3D.h"
+#include "vtkIdList.h"
+#include "vtkIntArray.h"
+#include "vtkMath.h"
+#include "vtkNew.h"
+#include "vtkPointData.h"
+#include "vtkPoints.h"
+#include "vtkPolyData.h"
+#include "vtkSMPTools.h"
+#include "vtkSmartPointer.h"
+#include "vtkStringArray.h"
+#include "vtkUnsignedCharArray.h"
+
+#include <cmath>
+#include <sstream>
+
+namespace
+{
+
+// Random points with vectors, scalars, an integer array, a string array
+// and a few duplicate ghost points.
+vtkSmartPointer<vtkPolyData> MakeInput(vtkIdType numPts)
+{
+  vtkNew<vtkPoints> points;
+  vtkNew<vtkDoubleArray> vectors;
+  vectors->SetName("Vectors");
+  vectors->SetNumberOfComponents(3);
+  vtkNew<vtkFloatArray> scalars;
+  scalars->SetName("Scalars");
+  vtkNew<vtkIntArray> labels;
+  labels->SetName("Labels");
+  labels->SetNumberOfComponents(2);
+  vtkNew<vtkStringArray> names;
+  names->SetName("Names");
+  vtkNew<vtkUnsignedCharArray> ghosts;
+  ghosts->SetName(vtkDataSetAttributes::GhostArrayName());
+  for (vtkIdType i = 0; i < numPts; i++)
+    {
+    points->InsertNextPoint(vtkMath::Random(-1.0, 1.0),
+                            vtkMath::Random(-1.0, 1.0),
+                            vtkMath::Random(-1.0, 1.0));
+    vectors->InsertNextTuple3(vtkMath::Random(-1.0, 1.0),
+                              i % 10 ? vtkMath::Random(-1.0, 1.0) : 0.0,
+                              i % 10 ? vtkMath::Random(-1.0, 1.0) : 0.0);
+    scalars->InsertNextValue(vtkMath::Random(0.0, 2.0));
+    labels->InsertNextTuple2(i, i % 7);
+    std::ostringstream name;
+    name << "Point" << i;
+    names->InsertNextValue(name.str());
+    ghosts->InsertNextValue(
+      i % 13 ? 0 : vtkDataSetAttributes::DUPLICATEPOINT);
+    }
+
+  vtkSmartPointer<vtkPolyData> input = vtkSmartPointer<vtkPolyData>::New();
+  input->SetPoints(points.GetPointer());
+  input->GetPointData()->SetVectors(vectors.GetPointer());
+  input->GetPointData()->SetScalars(scalars.GetPointer());
+  input->GetPointData()->AddArray(labels.GetPointer());
+  input->GetPointData()->AddArray(names.GetPointer());
+  input->GetPointData()->AddArray(ghosts.GetPointer());
+  return input;
+}
+
+// A glyph made of a triangle, a vertex and a line, in this order.
+vtkSmartPointer<vtkPolyData> MakeMixedGlyph()
+{
+  vtkNew<vtkPoints> points;
+  points->InsertNextPoint(0.0, 0.0, 0.0);
+  points->InsertNextPoint(1.0, 0.0, 0.0);
+  points->InsertNextPoint(0.0, 1.0, 0.0);
+  points->InsertNextPoint(0.0, 0.0, 1.0);
+  vtkSmartPointer<vtkPolyData> glyph = vtkSmartPointer<vtkPolyData>::New();
+  glyph->SetPoints(points.GetPointer());
+  glyph->Allocate();
+  vtkIdType triangle[3] = { 0, 1, 2 };
+  vtkIdType vertex[1] = { 3 };
+  vtkIdType line[2] = { 2, 3 };
+  glyph->InsertNextCell(VTK_TRIANGLE, 3, triangle);
+  glyph->InsertNextCell(VTK_VERTEX, 1, vertex);
+  glyph->InsertNextCell(VTK_LINE, 2, line);
+  return glyph;
+}
+
+bool CompareArrays(vtkAbstractArray *a, vtkAbstractArray *b)
+{
+  if (!a || !b || a->GetNumberOfValues() != b->GetNumberOfValues() ||
+      a->GetDataType() != b->GetDataType())
+    {
+    return false;
+    }
+  for (vtkIdType i = 0; i < a->GetNumberOfValues(); i++)
+    {
+    if (a->GetVariantValue(i) != b->GetVariantValue(i))
+      {
+      return false;
+      }
+    }
+  return true;
+}
+
+bool CompareAttributes(vtkDataSetAttributes *a, vtkDataSetAttributes *b)
+{
+  if (a->GetNumberOfArrays() != b->GetNumberOfArrays())
+    {
+    return false;
+    }
+  for (int i = 0; i < a->GetNumberOfArrays(); i++)
+    {
+    if (!CompareArrays(a->GetAbstractArray(i), b->GetAbstractArray(i)))
+      {
+      cerr << "Different " << a->GetAbstractArray(i)->GetName() << endl;
+      return false;
+      }
+    }
+  return true;
+}
+
+bool CompareOutputs(vtkPolyData *a, vtkPolyData *b)
+{
+  if (a->GetNumberOfPoints() != b->GetNumberOfPoints() ||
+      a->GetNumberOfCells() != b->GetNumberOfCells() ||
+      !CompareArrays(a->GetPoints()->GetData(), b->GetPoints()->GetData()) ||
+      !CompareAttributes(a->GetPointData(), b->GetPointData()) ||
+      !CompareAttributes(a->GetCellData(), b->GetCellData()))
+    {
+    return false;
+    }
+  vtkNew<vtkIdList> ptIdsA;
+  vtkNew<vtkIdList> ptIdsB;
+  for (vtkIdType cellId = 0; cellId < a->GetNumberOfCells(); cellId++)
+    {
+    a->GetCellPoints(cellId, ptIdsA.GetPointer());
+    b->GetCellPoints(cellId, ptIdsB.GetPointer());
+    if (a->GetCellType(cellId) != b->GetCellType(cellId) ||
+        ptIdsA->GetNumberOfIds() != ptIdsB->GetNumberOfIds())
+      {
+      return false;
+      }
+    for (vtkIdType i = 0; i < ptIdsA->GetNumberOfIds(); i++)
+      {
+      if (ptIdsA->GetId(i) != ptIdsB->GetId(i))
+        {
+        return false;
+        }
+      }
+    }
+  return true;
+}
+
+void SetUp(vtkGlyph3D *glyph, int test, vtkPolyData *input)
+{
+  glyph->SetInputData(input);
+  vtkNew<vtkArrowSource> arrow;
+  vtkNew<vtkConeSource> cone;
+  vtkNew<vtkCubeSource> cube;
+  switch (test)
+    {
+    case 0:
+      glyph->SetSourceConnection(arrow->GetOutputPort());
+      glyph->SetScaleModeToScaleByVector();
+      glyph->GeneratePointIdsOn();
+      glyph->FillCellDataOn();
+      break;
+    case 1:
+      glyph->SetSourceConnection(0, cone->GetOutputPort());
+      glyph->SetSourceConnection(1, arrow->GetOutputPort());
+      glyph->SetSourceConnection(2, cube->GetOutputPort());
+      glyph->SetIndexModeToScalar();
+      glyph->SetRange(0.0, 2.0);
+      glyph->SetColorModeToColorByVector();
+      break;
+    case 2:
+      glyph->SetSourceData(MakeMixedGlyph());
+      glyph->SetInputArrayToProcess(3, 0, 0,
+        vtkDataObject::FIELD_ASSOCIATION_POINTS, "Labels");
+      glyph->SetColorModeToColorByScalar();
+      glyph->FillCellDataOn();
+      break;
+    default:
+      glyph->SetSourceConnection(cube->GetOutputPort());
+      glyph->SetScaleModeToScaleByVectorComponents();
+      glyph->ClampingOn();
+      glyph->SetRange(-0.5, 0.5);
+      glyph->SetVectorModeToUseNormal();
+      break;
+    }
+}
+
+// Without scaling nor orientation, each glyph is the source translated to
+// its input point.
+bool TestTranslation(vtkPolyData *input)
+{
+  vtkNew<vtkConeSource> cone;
+  cone->Update();
+  vtkNew<vtkGlyph3D> glyph;
+  glyph->SetInputData(input);
+  glyph->SetSourceConnection(cone->GetOutputPort());
+  glyph->ScalingOff();
+  glyph->OrientOff();
+  glyph->GeneratePointIdsOn();
+  glyph->Update();
+  vtkPolyData *output = glyph->GetOutput();
+  vtkDataArray *ids = output->GetPointData()->GetArray("InputPointIds");
+  vtkIdType numSourcePts = cone->GetOutput()->GetNumberOfPoints();
+  vtkIdType ptId = 0;
+  for (vtkIdType inPtId = 0; inPtId < input->GetNumberOfPoints(); inPtId++)
+    {
+    if (inPtId % 13 == 0)
+      {
+      continue;
+      }
+    for (vtkIdType i = 0; i < numSourcePts; i++, ptId++)
+      {
+      double x[3], y[3], z[3];
+      input->GetPoint(inPtId, x);
+      cone->GetOutput()->GetPoint(i, y);
+      output->GetPoint(ptId, z);
+      if (ids->GetComponent(ptId, 0) != inPtId ||
+          std::fabs(x[0] + y[0] - z[0]) > 1e-6 ||
+          std::fabs(x[1] + y[1] - z[1]) > 1e-6 ||
+          std::fabs(x[2] + y[2] - z[2]) > 1e-6)
+        {
+        cerr << "Wrong point " << ptId << endl;
+        return false;
+        }
+      }
+    }
+  if (ptId != output->GetNumberOfPoints())
+    {
+    cerr << "Expected " << ptId << " points, got "
+         << output->GetNumberOfPoints() << endl;
+    return false;
+    }
+  return true;
+}
+
+}
+
+int TestGlyph3DParallel(int, char *[])
+{
+  vtkMath::RandomSeed(5678);
+  vtkSmartPointer<vtkPolyData> input = MakeInput(2000);
+  input->GetPointData()->SetNormals(
+    input->GetPointData()->GetArray("Vectors"));
+
+  vtkSMPTools::Initialize(4);
+  if (!TestTranslation(input))
+    {
+    return EXIT_FAILURE;
+    }
+
+  for (int test = 0; test < 4; test++)
+    {
+    vtkSMPTools::Initialize(1);
+    vtkNew<vtkGlyph3D> serial;
+    SetUp(serial.GetPointer(), test, input);
+    serial->Update();
+    vtkSMPTools::Initialize(4);
+    vtkNew<vtkGlyph3D> parallel;
+    SetUp(parallel.GetPointer(), test, input);
+    parallel->Update();
+    if (serial->GetOutput()->GetNumberOfCells() == 0 ||
+        !CompareOutputs(serial->GetOutput(), parallel->GetOutput()))
+      {
+      cerr << "Different outputs in test " << test << endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,297 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    TestPolyDataNormalsParallel.cxx
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+// Compares vtkPolyDataNormals run on one and on several threads, on a mesh
+// with sharp edges, boundaries, non-manifold edges, triangle strips and
+// inconsistently ordered polygons. The output is also checked against the
+// one of the former serial implementation.
+
+#include "vtkAppendPolyData.h"
+#include "vtkCellArray.h"
+#include "vtkCellData.h"
+#include "vtkCylinderSource.h"
+#include "vtkDataArray.h"
+#include "vtkMath.h"
+#include "vtkNew.h"
+#include "vtkPointData.h"
+#include "vtkPoints.h"
+#include "vtkPolyData.h"
+#include "vtkPolyDataNormals.h"
+#include "vtkSMPTools.h"
+#include "vtkSmartPointer.h"
+#include "vtkSphereSource.h"
+#include "vtkStripper.h"
+#include "vtkTriangleFilter.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+
+// The output of the serial implementation that preceded the parallel one
+// for each combination of options: the number of points, a hash of the
+// connectivity of the polygons and strips, and weighted sums of the point
+// and cell normals.
+struct Baseline
+{
+  vtkIdType NumberOfPoints;
+  vtkTypeUInt32 ConnectivityHash;
+  double PointNormals;
+  double CellNormals;
+};
+
+const Baseline Baselines[32] = {
+  { 4884, 3853738258u, 3604.957807, 2327.586502 },
+  { 6473, 3652400436u, 1519.517378, 2327.586502 },
+  { 4884, 3359242514u, 6451.657076, 6144.279959 },
+  { 5005, 16728595u, 6378.380361, 6144.279959 },
+  { 4884, 3853738258u, -3604.957807, 2327.586502 },
+  { 6473, 3652400436u, -1519.517378, 2327.586502 },
+  { 4884, 1455629842u, -6451.657076, -6144.279959 },
+  { 5005, 4081383265u, -6378.380361, -6144.279959 },
+  { 4884, 3853738258u, 3604.957807, 2327.586502 },
+  { 6473, 3652400436u, 1519.517378, 2327.586502 },
+  { 4884, 3359242514u, 6451.657076, 6144.279959 },
+  { 5005, 16728595u, 6378.380361, 6144.279959 },
+  { 4884, 3853738258u, -3604.957807, 2327.586502 },
+  { 6473, 3652400436u, -1519.517378, 2327.586502 },
+  { 4884, 1455629842u, -6451.657076, -6144.279959 },
+  { 5005, 4081383265u, -6378.380361, -6144.279959 },
+  { 4884, 3359242514u, 6451.657076, 6144.279959 },
+  { 5005, 16728595u, 6378.380361, 6144.279959 },
+  { 4884, 3359242514u, 6451.657076, 6144.279959 },
+  { 5005, 16728595u, 6378.380361, 6144.279959 },
+  { 4884, 1811778578u, 6913.830642, -6474.279959 },
+  { 5005, 1854919009u, 7332.380361, -6474.279959 },
+  { 4884, 1811778578u, -6913.830642, -6474.279959 },
+  { 5005, 1854919009u, -7332.380361, -6474.279959 },
+  { 4884, 3359242514u, 6451.657076, 6144.279959 },
+  { 5005, 16728595u, 6378.380361, 6144.279959 },
+  { 4884, 3359242514u, 6451.657076, 6144.279959 },
+  { 5005, 16728595u, 6378.380361, 6144.279959 },
+  { 4884, 2880801298u, 6459.657076, -6144.279959 },
+  { 5005, 1211587425u, 6386.380361, -6144.279959 },
+  { 4884, 2880801298u, -6459.657076, -6144.279959 },
+  { 5005, 1211587425u, -6386.380361, -6144.279959 }
+};
+
+// A plane of quads, some of them reversed, with a fin of triangles
+// sharing a row of its edges.
+vtkSmartPointer<vtkPolyData> MakePlane()
+{
+  const int res = 40;
+  vtkNew<vtkPoints> points;
+  for (int j = 0; j <= res; j++)
+    {
+    for (int i = 0; i <= res; i++)
+      {
+      points->InsertNextPoint(i, j, 0.2 * vtkMath::Random(-1.0, 1.0));
+      }
+    }
+  for (int i = 0; i <= res; i++)
+    {
+    points->InsertNextPoint(i, res / 2, 3.0);
+    }
+
+  vtkNew<vtkCellArray> polys;
+  for (int j = 0; j < res; j++)
+    {
+    for (int i = 0; i < res; i++)
+      {
+      vtkIdType quad[4] = { j * (res + 1) + i, j * (res + 1) + i + 1,
+                            (j + 1) * (res + 1) + i + 1,
+                            (j + 1) * (res + 1) + i };
+      if (vtkMath::Random() < 0.3)
+        {
+        std::swap(quad[1], quad[3]);
+        }
+      polys->InsertNextCell(4, quad);
+      }
+    }
+  vtkIdType finBase = (res + 1) * (res + 1);
+  for (int i = 0; i < res; i++)
+    {
+    vtkIdType tri[3] = { (res / 2) * (res + 1) + i,
+                         (res / 2) * (res + 1) + i + 1, finBase + i };
+    polys->InsertNextCell(3, tri);
+    }
+
+  vtkSmartPointer<vtkPolyData> plane = vtkSmartPointer<vtkPolyData>::New();
+  plane->SetPoints(points.GetPointer());
+  plane->SetPolys(polys.GetPointer());
+  return plane;
+}
+
+vtkSmartPointer<vtkPolyData> MakeMesh()
+{
+  vtkMath::RandomSeed(4321);
+
+  vtkNew<vtkSphereSource> sphere;
+  sphere->SetThetaResolution(80);
+  sphere->SetPhiResolution(40);
+  sphere->SetCenter(60.0, 0.0, 0.0);
+  sphere->SetRadius(10.0);
+
+  // A capped cylinder has sharp edges and is made into strips.
+  vtkNew<vtkCylinderSource> cylinder;
+  cylinder->SetResolution(30);
+  cylinder->SetCenter(-20.0, 0.0, 0.0);
+  cylinder->SetHeight(10.0);
+  cylinder->SetRadius(5.0);
+  vtkNew<vtkTriangleFilter> triangles;
+  triangles->SetInputConnection(cylinder->GetOutputPort());
+  vtkNew<vtkStripper> stripper;
+  stripper->SetInputConnection(triangles->GetOutputPort());
+
+  vtkNew<vtkAppendPolyData> append;
+  append->AddInputConnection(sphere->GetOutputPort());
+  append->AddInputConnection(stripper->GetOutputPort());
+  append->AddInputData(MakePlane());
+  append->Update();
+
+  vtkSmartPointer<vtkPolyData> mesh = vtkSmartPointer<vtkPolyData>::New();
+  mesh->DeepCopy(append->GetOutput());
+  return mesh;
+}
+
+bool CompareArrays(vtkDataArray *a, vtkDataArray *b)
+{
+  if (!a || !b)
+    {
+    return a == b;
+    }
+  if (a->GetNumberOfTuples() != b->GetNumberOfTuples() ||
+      a->GetNumberOfComponents() != b->GetNumberOfComponents())
+    {
+    return false;
+    }
+  for (vtkIdType i = 0; i < a->GetNumberOfTuples(); i++)
+    {
+    for (int c = 0; c < a->GetNumberOfComponents(); c++)
+      {
+      if (a->GetComponent(i, c) != b->GetComponent(i, c))
+        {
+        return false;
+        }
+      }
+    }
+  return true;
+}
+
+vtkTypeUInt32 HashConnectivity(vtkCellArray *cells, vtkTypeUInt32 hash)
+{
+  vtkIdType n = cells->GetNumberOfConnectivityEntries();
+  vtkIdType *ids = cells->GetPointer();
+  for (vtkIdType i = 0; i < n; i++)
+    {
+    hash = hash * 31 + static_cast<vtkTypeUInt32>(ids[i]);
+    }
+  return hash;
+}
+
+double SumNormals(vtkDataArray *normals)
+{
+  double sum = 0.0;
+  for (vtkIdType i = 0; i < normals->GetNumberOfTuples(); i++)
+    {
+    for (int c = 0; c < 3; c++)
+      {
+      sum += normals->GetComponent(i, c) * ((i + c) % 7 + 1);
+      }
+    }
+  return sum;
+}
+
+bool CompareBaseline(vtkPolyData *output, const Baseline &baseline)
+{
+  vtkTypeUInt32 hash = HashConnectivity(output->GetPolys(), 0);
+  hash = HashConnectivity(output->GetStrips(), hash);
+  double pointNormals = SumNormals(output->GetPointData()->GetNormals());
+  double cellNormals = SumNormals(output->GetCellData()->GetNormals());
+  if (output->GetNumberOfPoints() != baseline.NumberOfPoints ||
+      hash != baseline.ConnectivityHash ||
+      fabs(pointNormals - baseline.PointNormals) > 1e-3 ||
+      fabs(cellNormals - baseline.CellNormals) > 1e-3)
+    {
+    cerr << "Expected " << baseline.NumberOfPoints << " points, hash "
+         << baseline.ConnectivityHash << " and normal sums "
+         << baseline.PointNormals << " " << baseline.CellNormals << ", got "
+         << output->GetNumberOfPoints() << " points, hash " << hash
+         << " and normal sums " << pointNormals << " " << cellNormals
+         << endl;
+    return false;
+    }
+  return true;
+}
+
+vtkSmartPointer<vtkPolyData> RunNormals(vtkPolyData *mesh, int numThreads,
+                                        int options)
+{
+  vtkSMPTools::Initialize(numThreads);
+  vtkNew<vtkPolyDataNormals> normals;
+  normals->SetInputData(mesh);
+  normals->SetSplitting((options & 1) != 0);
+  normals->SetConsistency((options & 2) != 0);
+  normals->SetFlipNormals((options & 4) != 0);
+  normals->SetNonManifoldTraversal((options & 8) != 0);
+  normals->SetAutoOrientNormals((options & 16) != 0);
+  normals->ComputeCellNormalsOn();
+  normals->SetFeatureAngle(40.0);
+  normals->Update();
+
+  vtkSmartPointer<vtkPolyData> output = vtkSmartPointer<vtkPolyData>::New();
+  output->DeepCopy(normals->GetOutput());
+  return output;
+}
+
+}
+
+int TestPolyDataNormalsParallel(int, char *[])
+{
+  vtkSmartPointer<vtkPolyData> mesh = MakeMesh();
+
+  for (int options = 0; options < 32; options++)
+    {
+    vtkSmartPointer<vtkPolyData> serial = RunNormals(mesh, 1, options);
+    vtkSmartPointer<vtkPolyData> parallel = RunNormals(mesh, 4, options);
+
+    bool splitting = (options & 1) != 0;
+    if (splitting && serial->GetNumberOfPoints() <= mesh->GetNumberOfPoints())
+      {
+      cerr << "Expected points to be split" << endl;
+      return EXIT_FAILURE;
+      }
+    if (!CompareBaseline(serial, Baselines[options]))
+      {
+      cerr << "Different output from the former implementation with options "
+           << options << endl;
+      return EXIT_FAILURE;
+      }
+    if (!CompareArrays(serial->GetPoints()->GetData(),
+                       parallel->GetPoints()->GetData()) ||
+        !CompareArrays(serial->GetPolys()->GetData(),
+                       parallel->GetPolys()->GetData()) ||
+        !CompareArrays(serial->GetPointData()->GetNormals(),
+                       parallel->GetPointData()->GetNormals()) ||
+        !CompareArrays(serial->GetCellData()->GetNormals(),
+                       parallel->GetCellData()->GetNormals()))
+      {
+      cerr << "Different outputs with options " << options << endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  return EXIT_SUCCESS;
+}
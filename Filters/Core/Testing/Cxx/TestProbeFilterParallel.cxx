@@ -0,0 +1,353 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    TestProbeFilterParallel.cxx
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+// Compares the points probed on several threads with the points probed by
+// the serial loop of vtkProbeFilter, which is used when the source has a bit
+// array, for point set and image inputs and for unstructured grid, polydata,
+// rectilinear grid and image sources.
+
+#include "vtkBitArray.h"
+#include "vtkCellData.h"
+#include "vtkCellLocator.h"
+#include "vtkDoubleArray.h"
+#include "vtkFloatArray.h"
+#include "vtkIdTypeArray.h"
+#include "vtkImageData.h"
+#include "vtkIntArray.h"
+#include "vtkMath.h"
+#include "vtkNew.h"
+#include "vtkPointData.h"
+#include "vtkPoints.h"
+#include "vtkPolyData.h"
+#include "vtkProbeFilter.h"
+#include "vtkRectilinearGrid.h"
+#include "vtkSMPTools.h"
+#include "vtkSmartPointer.h"
+#include "vtkUnstructuredGrid.h"
+
+namespace
+{
+
+const int Resolution = 8;
+
+vtkIdType PointId(int i, int j, int k)
+{
+  return i + (Resolution + 1) * (j + (Resolution + 1) * k);
+}
+
+// Add point arrays of several types, and a cell array, to a source.
+void AddArrays(vtkDataSet *source)
+{
+  vtkNew<vtkFloatArray> scalars;
+  scalars->SetName("Scalars");
+  vtkNew<vtkDoubleArray> vectors;
+  vectors->SetName("Vectors");
+  vectors->SetNumberOfComponents(3);
+  vtkNew<vtkIntArray> ints;
+  ints->SetName("Ints");
+  for (vtkIdType i = 0; i < source->GetNumberOfPoints(); i++)
+    {
+    double x[3];
+    source->GetPoint(i, x);
+    scalars->InsertNextValue(x[0] + 2.0 * x[1] * x[2]);
+    vectors->InsertNextTuple3(x[1], -x[0], vtkMath::Random());
+    ints->InsertNextValue(static_cast<int>(vtkMath::Random(0, 100)));
+    }
+  source->GetPointData()->SetScalars(scalars.GetPointer());
+  source->GetPointData()->AddArray(vectors.GetPointer());
+  source->GetPointData()->AddArray(ints.GetPointer());
+
+  vtkNew<vtkIntArray> cellIds;
+  cellIds->SetName("CellIds");
+  for (vtkIdType i = 0; i < source->GetNumberOfCells(); i++)
+    {
+    cellIds->InsertNextValue(static_cast<int>(i));
+    }
+  source->GetCellData()->AddArray(cellIds.GetPointer());
+}
+
+// A grid of hexahedra and tetrahedra on [0,1]^3.
+vtkSmartPointer<vtkDataSet> MakeUnstructuredGrid()
+{
+  vtkSmartPointer<vtkUnstructuredGrid> grid =
+    vtkSmartPointer<vtkUnstructuredGrid>::New();
+  vtkNew<vtkPoints> points;
+  for (int k = 0; k <= Resolution; k++)
+    {
+    for (int j = 0; j <= Resolution; j++)
+      {
+      for (int i = 0; i <= Resolution; i++)
+        {
+        points->InsertNextPoint(static_cast<double>(i) / Resolution,
+                                static_cast<double>(j) / Resolution,
+                                static_cast<double>(k) / Resolution);
+        }
+      }
+    }
+  grid->SetPoints(points.GetPointer());
+
+  grid->Allocate(Resolution * Resolution * Resolution);
+  for (int k = 0; k < Resolution; k++)
+    {
+    for (int j = 0; j < Resolution; j++)
+      {
+      for (int i = 0; i < Resolution; i++)
+        {
+        vtkIdType hex[8] = {
+          PointId(i, j, k), PointId(i + 1, j, k),
+          PointId(i + 1, j + 1, k), PointId(i, j + 1, k),
+          PointId(i, j, k + 1), PointId(i + 1, j, k + 1),
+          PointId(i + 1, j + 1, k + 1), PointId(i, j + 1, k + 1) };
+        if ((i + j + k) % 3 == 0)
+          {
+          // split the hexahedron in five tetrahedra
+          vtkIdType tets[5][4] = {
+            { hex[0], hex[1], hex[3], hex[4] },
+            { hex[1], hex[2], hex[3], hex[6] },
+            { hex[1], hex[4], hex[5], hex[6] },
+            { hex[3], hex[4], hex[6], hex[7] },
+            { hex[1], hex[3], hex[4], hex[6] } };
+          for (int t = 0; t < 5; t++)
+            {
+            grid->InsertNextCell(VTK_TETRA, 4, tets[t]);
+            }
+          }
+        else if (i != Resolution / 2)
+          {
+          // leave a hole in the middle of the grid
+          grid->InsertNextCell(VTK_HEXAHEDRON, 8, hex);
+          }
+        }
+      }
+    }
+  AddArrays(grid);
+  return grid;
+}
+
+// Triangles and quads on the z = 0.5 plane of the unit cube.
+vtkSmartPointer<vtkDataSet> MakePolyData()
+{
+  vtkSmartPointer<vtkPolyData> polyData = vtkSmartPointer<vtkPolyData>::New();
+  vtkNew<vtkPoints> points;
+  for (int j = 0; j <= Resolution; j++)
+    {
+    for (int i = 0; i <= Resolution; i++)
+      {
+      points->InsertNextPoint(static_cast<double>(i) / Resolution,
+                              static_cast<double>(j) / Resolution, 0.5);
+      }
+    }
+  polyData->SetPoints(points.GetPointer());
+
+  polyData->Allocate(2 * Resolution * Resolution);
+  for (int j = 0; j < Resolution; j++)
+    {
+    for (int i = 0; i < Resolution; i++)
+      {
+      vtkIdType quad[4] = { PointId(i, j, 0), PointId(i + 1, j, 0),
+                            PointId(i + 1, j + 1, 0), PointId(i, j + 1, 0) };
+      if ((i + j) % 2)
+        {
+        polyData->InsertNextCell(VTK_QUAD, 4, quad);
+        }
+      else
+        {
+        vtkIdType tri[3] = { quad[0], quad[2], quad[3] };
+        polyData->InsertNextCell(VTK_TRIANGLE, 3, quad);
+        polyData->InsertNextCell(VTK_TRIANGLE, 3, tri);
+        }
+      }
+    }
+  AddArrays(polyData);
+  return polyData;
+}
+
+vtkSmartPointer<vtkDataSet> MakeImageData()
+{
+  vtkSmartPointer<vtkImageData> image = vtkSmartPointer<vtkImageData>::New();
+  image->SetExtent(0, Resolution, -1, Resolution - 1, 0, Resolution / 2);
+  image->SetOrigin(0.0, 0.125, 0.0);
+  image->SetSpacing(1.0 / Resolution, 1.0 / Resolution, 2.0 / Resolution);
+  AddArrays(image);
+  return image;
+}
+
+vtkSmartPointer<vtkDataSet> MakeRectilinearGrid()
+{
+  vtkSmartPointer<vtkRectilinearGrid> grid =
+    vtkSmartPointer<vtkRectilinearGrid>::New();
+  grid->SetDimensions(Resolution + 1, Resolution + 1, Resolution + 1);
+  vtkNew<vtkDoubleArray> coords[3];
+  for (int c = 0; c < 3; c++)
+    {
+    for (int i = 0; i <= Resolution; i++)
+      {
+      double x = static_cast<double>(i) / Resolution;
+      coords[c]->InsertNextValue(x * x);
+      }
+    }
+  grid->SetXCoordinates(coords[0].GetPointer());
+  grid->SetYCoordinates(coords[1].GetPointer());
+  grid->SetZCoordinates(coords[2].GetPointer());
+  AddArrays(grid);
+  return grid;
+}
+
+// Random points around the unit cube, some of them on the z = 0.5 plane.
+vtkSmartPointer<vtkDataSet> MakePointsInput()
+{
+  vtkSmartPointer<vtkPolyData> input = vtkSmartPointer<vtkPolyData>::New();
+  vtkNew<vtkPoints> points;
+  for (int i = 0; i < 3000; i++)
+    {
+    points->InsertNextPoint(vtkMath::Random(-0.1, 1.1),
+                            vtkMath::Random(-0.1, 1.1),
+                            i % 3 ? vtkMath::Random(-0.1, 1.1) : 0.5);
+    }
+  input->SetPoints(points.GetPointer());
+  return input;
+}
+
+vtkSmartPointer<vtkDataSet> MakeImageInput()
+{
+  vtkSmartPointer<vtkImageData> input = vtkSmartPointer<vtkImageData>::New();
+  input->SetExtent(-2, 20, 0, 22, -1, 22);
+  input->SetOrigin(0.0, -0.05, 0.0);
+  input->SetSpacing(0.05, 0.05, 0.025);
+  return input;
+}
+
+// Same as the source, with a bit array that makes the probe filter use its
+// serial loop.
+vtkSmartPointer<vtkDataSet> WithBitArray(vtkDataSet *source)
+{
+  vtkSmartPointer<vtkDataSet> copy;
+  copy.TakeReference(source->NewInstance());
+  copy->ShallowCopy(source);
+  vtkNew<vtkBitArray> bits;
+  bits->SetName("Bits");
+  bits->SetNumberOfTuples(source->GetNumberOfPoints());
+  for (vtkIdType i = 0; i < source->GetNumberOfPoints(); i++)
+    {
+    bits->SetValue(i, i % 2);
+    }
+  copy->GetPointData()->AddArray(bits.GetPointer());
+  return copy;
+}
+
+bool CompareArrays(vtkDataArray *a, vtkDataArray *b)
+{
+  if (!a || !b || a->GetNumberOfTuples() != b->GetNumberOfTuples() ||
+      a->GetNumberOfComponents() != b->GetNumberOfComponents() ||
+      a->GetDataType() != b->GetDataType())
+    {
+    return false;
+    }
+  for (vtkIdType i = 0; i < a->GetNumberOfTuples(); i++)
+    {
+    for (int c = 0; c < a->GetNumberOfComponents(); c++)
+      {
+      if (a->GetComponent(i, c) != b->GetComponent(i, c))
+        {
+        return false;
+        }
+      }
+    }
+  return true;
+}
+
+bool TestProbe(vtkDataSet *input, vtkDataSet *source, bool locator,
+               bool computeTolerance)
+{
+  vtkNew<vtkCellLocator> cellLocator;
+  vtkNew<vtkProbeFilter> serial;
+  vtkNew<vtkProbeFilter> parallel;
+  vtkProbeFilter *filters[2] = { serial.GetPointer(), parallel.GetPointer() };
+  vtkSmartPointer<vtkDataSet> sources[2] = { WithBitArray(source), source };
+  for (int i = 0; i < 2; i++)
+    {
+    filters[i]->SetInputData(input);
+    filters[i]->SetSourceData(sources[i]);
+    filters[i]->SetComputeTolerance(computeTolerance);
+    filters[i]->SetTolerance(0.01);
+    if (locator)
+      {
+      filters[i]->SetCellLocatorPrototype(cellLocator.GetPointer());
+      }
+    filters[i]->Update();
+    }
+
+  vtkDataSet *expected = serial->GetOutput();
+  vtkDataSet *output = parallel->GetOutput();
+  vtkPointData *expectedPD = expected->GetPointData();
+  vtkPointData *outputPD = output->GetPointData();
+  if (serial->GetValidPoints()->GetNumberOfTuples() == 0 ||
+      !CompareArrays(serial->GetValidPoints(), parallel->GetValidPoints()))
+    {
+    cerr << "Expected " << serial->GetValidPoints()->GetNumberOfTuples()
+         << " valid points, got "
+         << parallel->GetValidPoints()->GetNumberOfTuples() << endl;
+    return false;
+    }
+  if (expectedPD->GetNumberOfArrays() != outputPD->GetNumberOfArrays() + 1)
+    {
+    cerr << "Different number of point arrays" << endl;
+    return false;
+    }
+  for (int i = 0; i < outputPD->GetNumberOfArrays(); i++)
+    {
+    vtkDataArray *array = outputPD->GetArray(i);
+    if (!CompareArrays(expectedPD->GetArray(array->GetName()), array))
+      {
+      cerr << "Different array " << array->GetName() << endl;
+      return false;
+      }
+    }
+  return true;
+}
+
+}
+
+int TestProbeFilterParallel(int, char *[])
+{
+  vtkSMPTools::Initialize(4);
+  vtkMath::RandomSeed(5678);
+
+  vtkSmartPointer<vtkDataSet> sources[4] = {
+    MakeUnstructuredGrid(), MakePolyData(), MakeImageData(),
+    MakeRectilinearGrid() };
+  vtkSmartPointer<vtkDataSet> inputs[2] = {
+    MakePointsInput(), MakeImageInput() };
+  for (int input = 0; input < 2; input++)
+    {
+    for (int source = 0; source < 4; source++)
+      {
+      for (int test = 0; test < 4; test++)
+        {
+        bool locator = (test & 1) != 0;
+        bool computeTolerance = (test & 2) != 0;
+        if (!TestProbe(inputs[input], sources[source], locator,
+                       computeTolerance))
+          {
+          cerr << "Failed for input " << input << " and source " << source
+               << " with locator " << locator << " and computed tolerance "
+               << computeTolerance << endl;
+          return EXIT_FAILURE;
+          }
+        }
+      }
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,247 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    TestSmoothPolyDataFilterParallel.cxx
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+// Compares vtkSmoothPolyDataFilter and vtkWindowedSincPolyDataFilter run
+// on one and on several threads, and checks that the points used by
+// vertex cells do not move when the smoothing is not constrained. The
+// in-place and parallel smoothing are also checked on a grid with one
+// raised point, where the result of an iteration is known.
+
+#include "vtkAppendPolyData.h"
+#include "vtkCellArray.h"
+#include "vtkDataArray.h"
+#include "vtkMath.h"
+#include "vtkNew.h"
+#include "vtkPlaneSource.h"
+#include "vtkPoints.h"
+#include "vtkPolyData.h"
+#include "vtkSMPTools.h"
+#include "vtkSmartPointer.h"
+#include "vtkSmoothPolyDataFilter.h"
+#include "vtkSphereSource.h"
+#include "vtkStripper.h"
+#include "vtkWindowedSincPolyDataFilter.h"
+
+#include <cmath>
+
+namespace
+{
+
+// A noisy sphere, a plane made of triangle strips, a polyline and a
+// vertex cell.
+vtkSmartPointer<vtkPolyData> MakeInput()
+{
+  vtkNew<vtkSphereSource> sphere;
+  sphere->SetThetaResolution(40);
+  sphere->SetPhiResolution(40);
+  vtkNew<vtkPlaneSource> plane;
+  plane->SetResolution(20, 10);
+  plane->SetCenter(2.0, 0.0, 0.0);
+  vtkNew<vtkStripper> stripper;
+  stripper->SetInputConnection(plane->GetOutputPort());
+  vtkNew<vtkAppendPolyData> append;
+  append->AddInputConnection(sphere->GetOutputPort());
+  append->AddInputConnection(stripper->GetOutputPort());
+  append->Update();
+
+  vtkSmartPointer<vtkPolyData> input = vtkSmartPointer<vtkPolyData>::New();
+  input->DeepCopy(append->GetOutput());
+  vtkPoints *points = input->GetPoints();
+  for (vtkIdType i = 0; i < points->GetNumberOfPoints(); i++)
+    {
+    double x[3];
+    points->GetPoint(i, x);
+    for (int j = 0; j < 3; j++)
+      {
+      x[j] += vtkMath::Random(-0.02, 0.02);
+      }
+    points->SetPoint(i, x);
+    }
+
+  vtkNew<vtkCellArray> lines;
+  lines->InsertNextCell(20);
+  for (int i = 0; i < 20; i++)
+    {
+    lines->InsertCellPoint(points->InsertNextPoint(
+      -2.0 + 0.1 * i, vtkMath::Random(-0.1, 0.1), 0.0));
+    }
+  input->SetLines(lines.GetPointer());
+  vtkNew<vtkCellArray> verts;
+  verts->InsertNextCell(1);
+  verts->InsertCellPoint(5);
+  input->SetVerts(verts.GetPointer());
+  return input;
+}
+
+bool ComparePoints(vtkPolyData *a, vtkPolyData *b)
+{
+  vtkDataArray *pointsA = a->GetPoints()->GetData();
+  vtkDataArray *pointsB = b->GetPoints()->GetData();
+  if (pointsA->GetNumberOfTuples() != pointsB->GetNumberOfTuples())
+    {
+    return false;
+    }
+  for (vtkIdType i = 0; i < pointsA->GetNumberOfTuples(); i++)
+    {
+    for (int j = 0; j < 3; j++)
+      {
+      if (pointsA->GetComponent(i, j) != pointsB->GetComponent(i, j))
+        {
+        return false;
+        }
+      }
+    }
+  return true;
+}
+
+bool CheckFixedPoint(vtkPolyData *input, vtkPolyData *output)
+{
+  double x[3], y[3];
+  input->GetPoint(5, x);
+  output->GetPoint(5, y);
+  return vtkMath::Distance2BetweenPoints(x, y) < 1e-12;
+}
+
+bool TestSmooth(vtkPolyData *input, bool constrained)
+{
+  vtkNew<vtkSphereSource> surface;
+  surface->SetThetaResolution(20);
+  surface->SetPhiResolution(20);
+  surface->Update();
+
+  vtkSmartPointer<vtkPolyData> outputs[2];
+  for (int i = 0; i < 2; i++)
+    {
+    vtkSMPTools::Initialize(i ? 4 : 1);
+    vtkNew<vtkSmoothPolyDataFilter> smooth;
+    smooth->SetInputData(input);
+    smooth->ParallelSmoothingOn();
+    smooth->SetNumberOfIterations(30);
+    smooth->SetRelaxationFactor(0.1);
+    if (constrained)
+      {
+      smooth->FeatureEdgeSmoothingOn();
+      smooth->SetSourceData(surface->GetOutput());
+      }
+    smooth->Update();
+    outputs[i] = smooth->GetOutput();
+    }
+  // All the points are first moved to the surface when constrained.
+  return ComparePoints(outputs[0], outputs[1]) &&
+    (constrained || CheckFixedPoint(input, outputs[0]));
+}
+
+// A 4x4 grid of quads whose boundary is fixed, with point 5 raised. One
+// iteration moves point 5 down. In parallel, its neighbors 6 and 9 are
+// raised by the same amount and point 10 does not move. In place, the
+// points are moved in order from the ones already moved.
+bool TestKnownResult(bool parallel)
+{
+  const double h = 1.0;
+  const double f = 0.5;
+  vtkNew<vtkPlaneSource> plane;
+  plane->SetOrigin(0.0, 0.0, 0.0);
+  plane->SetPoint1(3.0, 0.0, 0.0);
+  plane->SetPoint2(0.0, 3.0, 0.0);
+  plane->SetResolution(3, 3);
+  plane->Update();
+  vtkNew<vtkPolyData> grid;
+  grid->DeepCopy(plane->GetOutput());
+  grid->GetPoints()->SetPoint(5, 1.0, 1.0, h);
+
+  vtkNew<vtkSmoothPolyDataFilter> smooth;
+  smooth->SetInputData(grid.GetPointer());
+  smooth->SetParallelSmoothing(parallel);
+  smooth->BoundarySmoothingOff();
+  smooth->SetNumberOfIterations(1);
+  smooth->SetRelaxationFactor(f);
+  smooth->Update();
+
+  double z5 = h * (1.0 - f);
+  double expected[4][2] = { { 5, z5 }, { 6, f * h / 4.0 },
+                            { 9, f * h / 4.0 }, { 10, 0.0 } };
+  if (!parallel)
+    {
+    expected[1][1] = expected[2][1] = f * z5 / 4.0;
+    expected[3][1] = f * (expected[1][1] + expected[2][1]) / 4.0;
+    }
+  vtkPolyData *output = smooth->GetOutput();
+  for (int i = 0; i < 4; i++)
+    {
+    vtkIdType ptId = static_cast<vtkIdType>(expected[i][0]);
+    double x[3], y[3];
+    grid->GetPoint(ptId, x);
+    output->GetPoint(ptId, y);
+    if (fabs(x[0] - y[0]) > 1e-6 || fabs(x[1] - y[1]) > 1e-6 ||
+        fabs(y[2] - expected[i][1]) > 1e-6)
+      {
+      cerr << "Point " << ptId << " moved to " << y[0] << " " << y[1] << " "
+           << y[2] << ", expected z = " << expected[i][1] << endl;
+      return false;
+      }
+    }
+  return true;
+}
+
+bool TestWindowedSinc(vtkPolyData *input, bool normalize)
+{
+  vtkSmartPointer<vtkPolyData> outputs[2];
+  for (int i = 0; i < 2; i++)
+    {
+    vtkSMPTools::Initialize(i ? 4 : 1);
+    vtkNew<vtkWindowedSincPolyDataFilter> smooth;
+    smooth->SetInputData(input);
+    smooth->SetNormalizeCoordinates(normalize);
+    smooth->SetFeatureEdgeSmoothing(normalize);
+    smooth->Update();
+    outputs[i] = smooth->GetOutput();
+    }
+  return ComparePoints(outputs[0], outputs[1]) &&
+    CheckFixedPoint(input, outputs[0]);
+}
+
+}
+
+int TestSmoothPolyDataFilterParallel(int, char *[])
+{
+  vtkMath::RandomSeed(4321);
+  vtkSmartPointer<vtkPolyData> input = MakeInput();
+
+  for (int parallel = 0; parallel < 2; parallel++)
+    {
+    if (!TestKnownResult(parallel != 0))
+      {
+      cerr << "vtkSmoothPolyDataFilter failed on the known result, parallel: "
+           << parallel << endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  for (int i = 0; i < 2; i++)
+    {
+    if (!TestSmooth(input, i != 0))
+      {
+      cerr << "vtkSmoothPolyDataFilter failed, constrained: " << i << endl;
+      return EXIT_FAILURE;
+      }
+    if (!TestWindowedSinc(input, i != 0))
+      {
+      cerr << "vtkWindowedSincPolyDataFilter failed, normalized: " << i
+           << endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -14,24 +14,30 @@
 =========================================================================*/
 #include "vtkCellDataToPointData.h"
 
+#include "vtkArrayDispatch.h"
 #include "vtkCellData.h"
-#include "vtkCell.h"
+#include "vtkDataArrayAccessor.h"
 #include "vtkDataSet.h"
 #include "vtkIdList.h"
+#include "vtkImageData.h"
 #include "vtkInformation.h"
 #include "vtkInformationVector.h"
+#include "vtkMath.h"
 #include "vtkNew.h"
 #include "vtkObjectFactory.h"
 #include "vtkPointData.h"
+#include "vtkRectilinearGrid.h"
+#include "vtkSMPThreadLocalObject.h"
+#include "vtkSMPTools.h"
 #include "vtkSmartPointer.h"
+#include "vtkStaticCellLinksTemplate.h"
+#include "vtkStructuredData.h"
 #include "vtkStructuredGrid.h"
-#include "vtkUnsignedIntArray.h"
 #include "vtkUnstructuredGrid.h"
 
 #include <algorithm>
-#include <functional>
-
-#define VTK_MAX_CELLS_PER_POINT 4096
+#include <utility>
+#include <vector>
 
 vtkStandardNewMacro(vtkCellDataToPointData);
 
@@ -111,51 +117,269 @@ void vtkCellDataToPointData::PrintSelf(ostream& os, vtkIndent indent)
   os << indent << "Pass Cell Data: " << (this->PassCellData ? "On\n" : "Off\n");
 }
 
+
 //----------------------------------------------------------------------------
-// Helper template function that implement the major part of the algorighm
-// which will be expanded by the vtkTemplateMacro. The template function is
-// provided so that coverage test can cover this function.
+// The point data is computed in parallel over the points. Each point gathers
+// the values of the cells using it, for all the arrays at once, so no two
+// threads ever write the same output tuple.
 namespace
 {
-  template <typename T>
-  void __spread (vtkUnstructuredGrid* const src, vtkUnsignedIntArray* const num,
-             vtkDataArray* const srcarray, vtkDataArray* const dstarray,
-             vtkIdType ncells, vtkIdType npoints, vtkIdType ncomps)
-  {
-    T const* const srcptr = static_cast<T const*>(srcarray->GetVoidPointer(0));
-    T      * const dstptr = static_cast<T      *>(dstarray->GetVoidPointer(0));
-
-    // zero initialization
-    std::fill_n(dstptr, npoints*ncomps, T(0));
-
-    // accumulate
-    T const* srcbeg = srcptr;
-    vtkNew<vtkIdList> pids;
-    for (vtkIdType cid = 0; cid < ncells; ++cid, srcbeg += ncomps)
+// Averages one cell data array into one point data array. The values are
+// summed in double precision with equal weights and rounded, as
+// vtkDataArray::InterpolateTuple() does.
+class ArrayAverager
+{
+public:
+  virtual ~ArrayAverager() {}
+  virtual void Average(vtkIdType ptId, vtkIdType numCells,
+                       const vtkIdType *cellIds) = 0;
+};
+
+template <typename InArrayT, typename OutArrayT>
+class TypedArrayAverager : public ArrayAverager
+{
+public:
+  TypedArrayAverager(InArrayT *input, OutArrayT *output) :
+    Input(input), Output(output),
+    NumberOfComponents(input->GetNumberOfComponents())
+    {
+    }
+
+  virtual void Average(vtkIdType ptId, vtkIdType numCells,
+                       const vtkIdType *cellIds)
+    {
+    typedef typename vtkDataArrayAccessor<OutArrayT>::APIType OutValueT;
+    vtkDataArrayAccessor<InArrayT> input(this->Input);
+    vtkDataArrayAccessor<OutArrayT> output(this->Output);
+
+    double weight = (numCells > 0 ? 1.0 / numCells : 0.0);
+    for (int c = 0; c < this->NumberOfComponents; ++c)
+      {
+      double val = 0.0;
+      for (vtkIdType i = 0; i < numCells; ++i)
+        {
+        val += weight * static_cast<double>(input.Get(cellIds[i], c));
+        }
+      OutValueT valT;
+      vtkMath::RoundDoubleToIntegralIfNecessary(val, &valT);
+      output.Set(ptId, c, valT);
+      }
+    }
+
+private:
+  InArrayT *Input;
+  OutArrayT *Output;
+  int NumberOfComponents;
+};
+
+struct AddAveragerWorker
+{
+  std::vector<ArrayAverager*> *Averagers;
+
+  template <typename InArrayT, typename OutArrayT>
+  void operator()(InArrayT *input, OutArrayT *output)
+    {
+    this->Averagers->push_back(
+      new TypedArrayAverager<InArrayT, OutArrayT>(input, output));
+    }
+};
+
+// The pairs of arrays to process. Those the dispatcher does not handle
+// (e.g. bit or string arrays) are interpolated serially, through
+// vtkAbstractArray::InterpolateTuple().
+struct ArrayAveragers
+{
+  typedef std::pair<vtkAbstractArray*, vtkAbstractArray*> ArrayPair;
+
+  std::vector<ArrayAverager*> Averagers;
+  std::vector<ArrayPair> Others;
+
+  ~ArrayAveragers()
+    {
+    for (size_t i = 0; i < this->Averagers.size(); ++i)
+      {
+      delete this->Averagers[i];
+      }
+    }
+
+  void Add(vtkAbstractArray *input, vtkAbstractArray *output)
+    {
+    vtkDataArray *inDA = vtkDataArray::FastDownCast(input);
+    vtkDataArray *outDA = vtkDataArray::FastDownCast(output);
+    AddAveragerWorker worker;
+    worker.Averagers = &this->Averagers;
+    if (!inDA || !outDA || inDA->GetDataType() == VTK_BIT ||
+        !vtkArrayDispatch::Dispatch2SameValueType::Execute(inDA, outDA,
+                                                           worker))
+      {
+      this->Others.push_back(ArrayPair(input, output));
+      }
+    }
+
+  // Size the output arrays of a field list built from a single cell data
+  // and add them.
+  void AddFields(vtkDataSetAttributes::FieldList &fields,
+                 vtkCellData *inCD, vtkPointData *outPD, vtkIdType numPts)
+    {
+    for (int fid = 0; fid < fields.GetNumberOfFields(); ++fid)
+      {
+      int const dstid = fields.GetFieldIndex(fid);
+      int const srcid = fields.GetDSAIndex(0, fid);
+      if (srcid < 0 || dstid < 0)
+        {
+        continue;
+        }
+      vtkAbstractArray *output = outPD->GetAbstractArray(dstid);
+      output->SetNumberOfTuples(numPts);
+      this->Add(inCD->GetAbstractArray(srcid), output);
+      }
+    }
+};
+
+// The cells using each point, from static links.
+struct LinksPointCells
+{
+  vtkStaticCellLinksTemplate<vtkIdType> Links;
+
+  LinksPointCells(vtkDataSet *ds)
+    {
+    this->Links.BuildLinks(ds);
+    }
+
+  void GetPointCells(vtkIdType ptId, vtkIdType &numCells,
+                     const vtkIdType* &cellIds)
+    {
+    numCells = this->Links.GetNumberOfCells(ptId);
+    cellIds = this->Links.GetCells(ptId);
+    }
+};
+
+// The cells using each point of a structured dataset, found from its
+// dimensions. If a visibility mask is given, the blanked cells are skipped.
+struct StructuredPointCells
+{
+  int Dimensions[3];
+  const unsigned char *Visible;
+  vtkSMPThreadLocalObject<vtkIdList> CellIds;
+
+  StructuredPointCells(const int dims[3], const unsigned char *visible) :
+    Visible(visible)
+    {
+    std::copy(dims, dims + 3, this->Dimensions);
+    }
+
+  void GetPointCells(vtkIdType ptId, vtkIdType &numCells,
+                     const vtkIdType* &cellIds)
+    {
+    vtkIdList *ids = this->CellIds.Local();
+    vtkStructuredData::GetPointCells(ptId, ids, this->Dimensions);
+    if (this->Visible)
       {
-      src->GetCellPoints(cid, pids.GetPointer());
-      for (vtkIdType i = 0, I = pids->GetNumberOfIds(); i < I; ++i)
+      vtkIdType numVisible = 0;
+      for (vtkIdType i = 0; i < ids->GetNumberOfIds(); ++i)
         {
-        T* const dstbeg = dstptr + pids->GetId(i)*ncomps;
-        // accumulate cell data to point data <==> point_data += cell_data
-        std::transform(srcbeg,srcbeg+ncomps,dstbeg,dstbeg,std::plus<T>());
+        if (this->Visible[ids->GetId(i)])
+          {
+          ids->SetId(numVisible++, ids->GetId(i));
+          }
         }
+      ids->SetNumberOfIds(numVisible);
       }
+    numCells = ids->GetNumberOfIds();
+    cellIds = ids->GetPointer(0);
+    }
+};
 
-    // average
-    T* dstbeg = dstptr;
-    for (vtkIdType pid = 0; pid < npoints; ++pid, dstbeg += ncomps)
+template <typename TPointCells>
+struct AverageFunctor
+{
+  TPointCells &PointCells;
+  std::vector<ArrayAverager*> &Averagers;
+
+  AverageFunctor(TPointCells &pointCells,
+                 std::vector<ArrayAverager*> &averagers) :
+    PointCells(pointCells), Averagers(averagers)
+    {
+    }
+
+  void operator()(vtkIdType ptId, vtkIdType endPtId)
+    {
+    vtkIdType numCells;
+    const vtkIdType *cellIds;
+    for ( ; ptId < endPtId; ++ptId)
       {
-      // guard against divide by zero
-      if (unsigned int const denum = num->GetValue(pid))
+      this->PointCells.GetPointCells(ptId, numCells, cellIds);
+      for (size_t i = 0; i < this->Averagers.size(); ++i)
         {
-        // divide point data by the number of cells using it <==>
-        // point_data /= denum
-        std::transform(dstbeg, dstbeg+ncomps, dstbeg,
-          std::bind2nd(std::divides<T>(), denum));
+        this->Averagers[i]->Average(ptId, numCells, cellIds);
         }
       }
-  }
+    }
+};
+
+// Average all the arrays, in batches of points to report progress.
+template <typename TPointCells>
+void AverageCellData(vtkAlgorithm *self, TPointCells &pointCells,
+                     ArrayAveragers &arrays, vtkIdType numPts)
+{
+  AverageFunctor<TPointCells> average(pointCells, arrays.Averagers);
+  vtkIdType batchSize = numPts / 10 + 1;
+  for (vtkIdType ptId = 0; ptId < numPts; ptId += batchSize)
+    {
+    self->UpdateProgress(static_cast<double>(ptId) / numPts);
+    if (self->GetAbortExecute())
+      {
+      return;
+      }
+    vtkSMPTools::For(ptId, std::min(ptId + batchSize, numPts), average);
+    }
+
+  if (arrays.Others.empty())
+    {
+    return;
+    }
+  vtkNew<vtkIdList> ids;
+  std::vector<double> weights;
+  for (vtkIdType ptId = 0; ptId < numPts; ++ptId)
+    {
+    vtkIdType numCells;
+    const vtkIdType *cellIds;
+    pointCells.GetPointCells(ptId, numCells, cellIds);
+    ids->SetNumberOfIds(numCells);
+    std::copy(cellIds, cellIds + numCells, ids->GetPointer(0));
+    weights.assign(numCells + 1, numCells > 0 ? 1.0 / numCells : 0.0);
+    for (size_t i = 0; i < arrays.Others.size(); ++i)
+      {
+      if (numCells > 0 || vtkDataArray::FastDownCast(arrays.Others[i].second))
+        {
+        arrays.Others[i].second->InterpolateTuple(
+          ptId, ids.GetPointer(), arrays.Others[i].first, &weights[0]);
+        }
+      }
+    }
+}
+
+// The dimensions of the structured datasets whose cells are found from
+// their point ids alone.
+bool GetStructuredDimensions(vtkDataSet *ds, int dims[3])
+{
+  if (vtkImageData *image = vtkImageData::SafeDownCast(ds))
+    {
+    image->GetDimensions(dims);
+    return true;
+    }
+  if (vtkRectilinearGrid *rgrid = vtkRectilinearGrid::SafeDownCast(ds))
+    {
+    rgrid->GetDimensions(dims);
+    return true;
+    }
+  if (vtkStructuredGrid *sgrid = vtkStructuredGrid::SafeDownCast(ds))
+    {
+    sgrid->GetDimensions(dims);
+    return true;
+    }
+  return false;
+}
 }
 
 //----------------------------------------------------------------------------
@@ -177,23 +401,6 @@ int vtkCellDataToPointData::RequestDataForUnstructuredGrid
     return 1;
     }
 
-  // count the number of cells associated with each point
-  vtkSmartPointer<vtkUnsignedIntArray> num
-    = vtkSmartPointer<vtkUnsignedIntArray>::New();
-  num->SetNumberOfComponents(1);
-  num->SetNumberOfTuples(npoints);
-  std::fill_n(num->GetPointer(0), npoints, 0u);
-  vtkNew<vtkIdList> pids;
-  for (vtkIdType cid = 0; cid < ncells; ++cid)
-    {
-    src->GetCellPoints(cid, pids.GetPointer());
-    for (vtkIdType i = 0, I = pids->GetNumberOfIds(); i < I; ++i)
-      {
-      vtkIdType const pid = pids->GetId(i);
-      num->SetValue(pid, num->GetValue(pid)+1);
-      }
-    }
-
   // First, copy the input to the output as a starting point
   dst->CopyStructure(src);
   vtkPointData* const opd = dst->GetPointData();
@@ -223,43 +430,12 @@ int vtkCellDataToPointData::RequestDataForUnstructuredGrid
   cfl.InitializeFieldList(clean);
   opd->InterpolateAllocate(cfl, npoints, npoints);
 
-  for (int fid = 0, nfields = cfl.GetNumberOfFields(); fid < nfields; ++fid)
-    {
-    // update progress and check for an abort request.
-    this->UpdateProgress((fid+1.)/nfields);
-    if (this->GetAbortExecute())
-      {
-      break;
-      }
-
-    // indices into the field arrays associated with the cell and the point
-    // respectively
-    int const dstid = cfl.GetFieldIndex(fid);
-    int const srcid = cfl.GetDSAIndex(0,fid);
-    if  (srcid < 0 || dstid < 0)
-      {
-      continue;
-      }
-
-    vtkCellData * const srccelldata  = clean;
-    vtkPointData* const dstpointdata = dst->GetPointData();
+  ArrayAveragers arrays;
+  arrays.AddFields(cfl, clean, opd, npoints);
 
-    if (!srccelldata || !dstpointdata)
-      {
-      continue;
-      }
-
-    vtkDataArray* const srcarray = srccelldata ->GetArray(srcid);
-    vtkDataArray* const dstarray = dstpointdata->GetArray(dstid);
-    dstarray->SetNumberOfTuples(npoints);
-
-    vtkIdType const ncomps = srcarray->GetNumberOfComponents();
-    switch (srcarray->GetDataType())
-      {
-      vtkTemplateMacro
-        (__spread<VTK_TT>(src,num,srcarray,dstarray,ncells,npoints,ncomps));
-      }
-    }
+  // The cells using each point, sorted by id, from links built in parallel
+  LinksPointCells links(src);
+  AverageCellData(this, links, arrays, npoints);
 
   if (!this->PassCellData)
     {
@@ -271,102 +447,61 @@ int vtkCellDataToPointData::RequestDataForUnstructuredGrid
   return 1;
 }
 
+//----------------------------------------------------------------------------
 void vtkCellDataToPointData::interpolatePointData(vtkDataSet *input,
                                                   vtkDataSet *output)
 {
-  vtkNew<vtkIdList> cellIds;
-  cellIds->Allocate(VTK_MAX_CELLS_PER_POINT);
-
   vtkIdType numPts = input->GetNumberOfPoints();
 
   vtkCellData *inCD = input->GetCellData();
   vtkPointData *outPD = output->GetPointData();
-  outPD->InterpolateAllocate(inCD,numPts);
+  vtkDataSetAttributes::FieldList fields(1);
+  fields.InitializeFieldList(inCD);
+  outPD->InterpolateAllocate(fields, numPts, numPts);
 
-  std::vector<double> weights(VTK_MAX_CELLS_PER_POINT);
+  ArrayAveragers arrays;
+  arrays.AddFields(fields, inCD, outPD, numPts);
 
-  int abort = 0;
-  vtkIdType progressInterval = numPts / 20 + 1;
-  for (vtkIdType ptId = 0; ptId < numPts && !abort; ptId++)
+  int dims[3];
+  if (GetStructuredDimensions(input, dims))
     {
-    if ( !(ptId % progressInterval) )
-      {
-      this->UpdateProgress(static_cast<double>(ptId)/numPts);
-      abort = GetAbortExecute();
-      }
-
-    input->GetPointCells(ptId, cellIds.GetPointer());
-    vtkIdType numCells = cellIds->GetNumberOfIds();
-
-    if ( numCells > 0 && numCells < VTK_MAX_CELLS_PER_POINT )
-      {
-      double weight = 1.0 / numCells;
-      for (vtkIdType cellId = 0; cellId < numCells; cellId++)
-        {
-        weights[cellId] = weight;
-        }
-      outPD->InterpolatePoint(inCD, ptId, cellIds.GetPointer(), &weights[0]);
-      }
-    else
-      {
-      outPD->NullPoint(ptId);
-      }
+    StructuredPointCells pointCells(dims, NULL);
+    AverageCellData(this, pointCells, arrays, numPts);
+    }
+  else
+    {
+    LinksPointCells pointCells(input);
+    AverageCellData(this, pointCells, arrays, numPts);
     }
 }
 
+//----------------------------------------------------------------------------
 void vtkCellDataToPointData::interpolatePointDataWithMask(
     vtkStructuredGrid *input, vtkDataSet *output)
 {
-  vtkNew<vtkIdList> allCellIds;
-  allCellIds->Allocate(VTK_MAX_CELLS_PER_POINT);
-  vtkNew<vtkIdList> cellIds;
-  cellIds->Allocate(VTK_MAX_CELLS_PER_POINT);
-
   vtkIdType numPts = input->GetNumberOfPoints();
+  vtkIdType numCells = input->GetNumberOfCells();
 
   vtkCellData *inCD = input->GetCellData();
   vtkPointData *outPD = output->GetPointData();
-  outPD->InterpolateAllocate(inCD,numPts);
-
-  std::vector<double> weights(VTK_MAX_CELLS_PER_POINT);
-
-  int abort = 0;
-  vtkIdType progressInterval = numPts / 20 + 1;
-  for (vtkIdType ptId = 0; ptId < numPts && !abort; ptId++)
+  vtkDataSetAttributes::FieldList fields(1);
+  fields.InitializeFieldList(inCD);
+  outPD->InterpolateAllocate(fields, numPts, numPts);
+
+  ArrayAveragers arrays;
+  arrays.AddFields(fields, inCD, outPD, numPts);
+
+  // Only consider cells that are not masked. The visibility of the cells
+  // is looked up once, as IsCellVisible() is not safe to call from
+  // several threads.
+  std::vector<unsigned char> visible(numCells);
+  for (vtkIdType cellId = 0; cellId < numCells; ++cellId)
     {
-    if ( !(ptId % progressInterval) )
-      {
-      this->UpdateProgress(static_cast<double>(ptId)/numPts);
-      abort = GetAbortExecute();
-      }
-
-    input->GetPointCells(ptId, allCellIds.GetPointer());
-    cellIds->Reset();
-    // Only consider cells that are not masked:
-    for (vtkIdType cId = 0; cId < allCellIds->GetNumberOfIds(); ++cId)
-      {
-      vtkIdType curCell = allCellIds->GetId(cId);
-      if (input->IsCellVisible(curCell))
-        {
-        cellIds->InsertNextId(curCell);
-        }
-      }
-
-    vtkIdType numCells = cellIds->GetNumberOfIds();
-
-    if ( numCells > 0 && numCells < VTK_MAX_CELLS_PER_POINT )
-      {
-      double weight = 1.0 / numCells;
-      for (vtkIdType cellId = 0; cellId < numCells; cellId++)
-        {
-        weights[cellId] = weight;
-        }
-      outPD->InterpolatePoint(inCD, ptId, cellIds.GetPointer(), &weights[0]);
-      }
-    else
-      {
-      outPD->NullPoint(ptId);
-      }
+    visible[cellId] = input->IsCellVisible(cellId);
     }
-}
 
+  int dims[3];
+  input->GetDimensions(dims);
+  StructuredPointCells pointCells(dims, numCells > 0 ? &visible[0] : NULL);
+  AverageCellData(this, pointCells, arrays, numPts);
+}
@@ -19,6 +19,10 @@
 // points). The method of transformation is based on averaging the data
 // values of all cells using a particular point. Optionally, the input cell
 // data can be passed through to the output as well.
+//
+// The points are processed in parallel with vtkSMPTools, all the arrays in
+// a single pass over the points. The cells using each point are found from
+// static cell links, or from the dimensions of structured datasets.
 
 // .SECTION Caveats
 // This filter is an abstract filter, that is, the output is an abstract type
@@ -14,6 +14,7 @@
 =========================================================================*/
 #include "vtkCleanPolyData.h"
 
+#include "vtkAtomic.h"
 #include "vtkCellArray.h"
 #include "vtkCellData.h"
 #include "vtkMergePoints.h"
@@ -22,11 +23,463 @@
 #include "vtkObjectFactory.h"
 #include "vtkPointData.h"
 #include "vtkPolyData.h"
+#include "vtkSMPTools.h"
 #include "vtkStreamingDemandDrivenPipeline.h"
 #include "vtkIncrementalPointLocator.h"
 
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
 vtkStandardNewMacro(vtkCleanPolyData);
 
+//---------------------------------------------------------------------------
+// Gives access to the bucket index of a point in a vtkPointLocator.
+class vtkCleanPolyDataToPointLocatorFriendship
+{
+public:
+  static vtkIdType GetBucketIndex(vtkPointLocator *locator, const double *x)
+    {
+    return locator->GetBucketIndex(x);
+    }
+};
+
+//---------------------------------------------------------------------------
+// Helper classes for merging points in parallel. vtkMergePoints merges a
+// point with a previously inserted point if both fall into the same bucket
+// and are equal once converted to the type of the output points. The
+// serial insertion numbers the output points in the order they are first
+// used while traversing the verts, lines, polys and strips. Here each point
+// use is identified by its position in the concatenated connectivity
+// arrays, so that the same ordering is obtained by sorting.
+namespace
+{
+
+// A range [Begin,End) of whole cells in a connectivity array. Position is
+// the position of the first entry of the array in the concatenated arrays.
+struct CellChunk
+{
+  const vtkIdType *Conn;
+  vtkIdType Begin;
+  vtkIdType End;
+  vtkIdType Position;
+};
+
+// Split a cell array into chunks. This is a single pass over the cells
+// since vtkCellArray does not provide random access.
+vtkIdType AddCellChunks(vtkCellArray *ca, vtkIdType position,
+                        std::vector<CellChunk> &chunks)
+{
+  const vtkIdType chunkSize = 1024;
+  vtkIdType size = ca->GetNumberOfConnectivityEntries();
+  if ( ca->GetNumberOfCells() < 1 || size < 1 )
+    {
+    return position;
+    }
+  CellChunk chunk;
+  chunk.Conn = ca->GetPointer();
+  chunk.Begin = 0;
+  chunk.Position = position;
+  vtkIdType loc = 0, numCells = 0;
+  while ( loc < size )
+    {
+    loc += chunk.Conn[loc] + 1;
+    if ( ++numCells == chunkSize || loc >= size )
+      {
+      chunk.End = (loc < size ? loc : size);
+      chunks.push_back(chunk);
+      chunk.Begin = chunk.End;
+      numCells = 0;
+      }
+    }
+  return position + size;
+}
+
+// Compute the position of the first use of each point. There is no atomic
+// minimum, so concurrent updates of the same point may leave a larger
+// value behind. A second pass detects such values and, in the rare case
+// it finds some, a final serial pass fixes them. The result thus does not
+// depend on the scheduling.
+struct ComputeFirstUse
+{
+  const std::vector<CellChunk> &Chunks;
+  vtkAtomic<vtkIdType> *FirstUse;
+  vtkAtomic<vtkIdType> NumberOfChanges;
+
+  ComputeFirstUse(const std::vector<CellChunk> &chunks,
+                  vtkAtomic<vtkIdType> *firstUse)
+    : Chunks(chunks), FirstUse(firstUse), NumberOfChanges(0)
+    {
+    }
+
+  void operator()(vtkIdType chunkId, vtkIdType endChunkId)
+    {
+    vtkIdType numChanges = 0;
+    for ( ; chunkId < endChunkId; ++chunkId )
+      {
+      const CellChunk &chunk = this->Chunks[chunkId];
+      for ( vtkIdType loc = chunk.Begin; loc < chunk.End; )
+        {
+        vtkIdType npts = chunk.Conn[loc++];
+        for ( vtkIdType i = 0; i < npts; ++i, ++loc )
+          {
+          vtkIdType ptId = chunk.Conn[loc];
+          vtkIdType position = chunk.Position + loc;
+          if ( position < this->FirstUse[ptId].load() )
+            {
+            this->FirstUse[ptId].store(position);
+            ++numChanges;
+            }
+          }
+        }
+      }
+    this->NumberOfChanges += numChanges;
+    }
+};
+
+// The merge key of a point is the bucket of the locator it falls into and
+// its coordinates converted to TKey.
+template <typename TKey>
+struct MergeTuple
+{
+  vtkIdType Bucket;
+  vtkIdType FirstUse;
+  vtkIdType PtId;
+  TKey Key[3];
+
+  bool SameKey(const MergeTuple &t) const
+    {
+    return this->Bucket == t.Bucket && this->Key[0] == t.Key[0] &&
+      this->Key[1] == t.Key[1] && this->Key[2] == t.Key[2];
+    }
+
+  // Sort by key and then by first use.
+  bool operator<(const MergeTuple &t) const
+    {
+    for ( int i = 0; i < 3; ++i )
+      {
+      if ( this->Key[i] != t.Key[i] )
+        {
+        return this->Key[i] < t.Key[i];
+        }
+      }
+    return this->FirstUse < t.FirstUse;
+    }
+};
+
+// The used points are binned into the buckets of the locator: they are
+// counted per bucket, the counts are scanned into offsets and the merge
+// tuples are then inserted from the back of each bucket. Finally the
+// buckets are sorted, so that points with the same key are consecutive,
+// the first used coming first.
+template <typename TKey>
+struct BinMergePoints
+{
+  vtkCleanPolyData *Self;
+  vtkPoints *Points;
+  vtkPointLocator *Locator;
+  const vtkAtomic<vtkIdType> *FirstUse;
+  vtkIdType NumberOfUses;
+  vtkIdType *PointBucket;
+  vtkAtomic<vtkIdType> *Offsets;
+  MergeTuple<TKey> *Tuples;
+  vtkAtomic<int> HasNaN;
+
+  BinMergePoints(vtkCleanPolyData *self, vtkPoints *pts,
+                 vtkPointLocator *locator,
+                 const vtkAtomic<vtkIdType> *firstUse, vtkIdType numUses,
+                 vtkIdType *ptBucket, vtkAtomic<vtkIdType> *offsets)
+    : Self(self), Points(pts), Locator(locator), FirstUse(firstUse),
+      NumberOfUses(numUses), PointBucket(ptBucket), Offsets(offsets),
+      Tuples(NULL), HasNaN(0)
+    {
+    }
+
+  // Count the points in each bucket.
+  void operator()(vtkIdType ptId, vtkIdType endPtId)
+    {
+    double x[3], newx[3];
+    for ( ; ptId < endPtId; ++ptId )
+      {
+      this->PointBucket[ptId] = -1;
+      if ( this->FirstUse[ptId].load() == this->NumberOfUses )
+        {
+        continue;
+        }
+      this->Points->GetPoint(ptId, x);
+      this->Self->OperateOnPoint(x, newx);
+      if ( newx[0] != newx[0] || newx[1] != newx[1] || newx[2] != newx[2] )
+        {
+        // NaN is never merged, not even with itself
+        this->HasNaN = 1;
+        continue;
+        }
+      this->PointBucket[ptId] =
+        vtkCleanPolyDataToPointLocatorFriendship::GetBucketIndex(
+          this->Locator, newx);
+      ++this->Offsets[this->PointBucket[ptId]];
+      }
+    }
+
+  struct Fill
+    {
+    BinMergePoints *Bin;
+    void operator()(vtkIdType ptId, vtkIdType endPtId)
+      {
+      double x[3], newx[3];
+      for ( ; ptId < endPtId; ++ptId )
+        {
+        vtkIdType bucket = this->Bin->PointBucket[ptId];
+        if ( bucket < 0 )
+          {
+          continue;
+          }
+        this->Bin->Points->GetPoint(ptId, x);
+        this->Bin->Self->OperateOnPoint(x, newx);
+        MergeTuple<TKey> &t = this->Bin->Tuples[--this->Bin->Offsets[bucket]];
+        t.Bucket = bucket;
+        t.FirstUse = this->Bin->FirstUse[ptId].load();
+        t.PtId = ptId;
+        t.Key[0] = static_cast<TKey>(newx[0]);
+        t.Key[1] = static_cast<TKey>(newx[1]);
+        t.Key[2] = static_cast<TKey>(newx[2]);
+        }
+      }
+    };
+
+  struct Sort
+    {
+    BinMergePoints *Bin;
+    void operator()(vtkIdType bucket, vtkIdType endBucket)
+      {
+      for ( ; bucket < endBucket; ++bucket )
+        {
+        MergeTuple<TKey> *first =
+          this->Bin->Tuples + this->Bin->Offsets[bucket].load();
+        MergeTuple<TKey> *last =
+          this->Bin->Tuples + this->Bin->Offsets[bucket + 1].load();
+        if ( last - first > 1 )
+          {
+          std::sort(first, last);
+          }
+        }
+      }
+    };
+};
+
+// The first point of each group of points sharing a key is the first one
+// used: it is the representative of the group.
+template <typename TKey>
+struct MarkMergeGroups
+{
+  const MergeTuple<TKey> *Tuples;
+  vtkIdType NumberOfUsedPoints;
+  vtkIdType *Representative;
+
+  void operator()(vtkIdType i, vtkIdType end)
+    {
+    for ( ; i < end; ++i )
+      {
+      if ( i > 0 && this->Tuples[i-1].SameKey(this->Tuples[i]) )
+        {
+        continue;
+        }
+      vtkIdType rep = this->Tuples[i].PtId;
+      for ( vtkIdType j = i; j < this->NumberOfUsedPoints &&
+              this->Tuples[j].SameKey(this->Tuples[i]); ++j )
+        {
+        this->Representative[this->Tuples[j].PtId] = rep;
+        }
+      }
+    }
+};
+
+// The output points are the representatives numbered in the order of
+// their first use. They are counted per chunk of cells; once the counts
+// are scanned into offsets, the points of each chunk are numbered.
+struct NumberNewPoints
+{
+  const std::vector<CellChunk> &Chunks;
+  const vtkAtomic<vtkIdType> *FirstUse;
+  const vtkIdType *Representative;
+  vtkIdType *ChunkOffsets;
+  vtkIdType *NewIds;
+  vtkIdType *Representatives;
+
+  NumberNewPoints(const std::vector<CellChunk> &chunks,
+                  const vtkAtomic<vtkIdType> *firstUse, const vtkIdType *rep,
+                  vtkIdType *chunkOffsets)
+    : Chunks(chunks), FirstUse(firstUse), Representative(rep),
+      ChunkOffsets(chunkOffsets), NewIds(NULL), Representatives(NULL)
+    {
+    }
+
+  void operator()(vtkIdType chunkId, vtkIdType endChunkId)
+    {
+    for ( ; chunkId < endChunkId; ++chunkId )
+      {
+      const CellChunk &chunk = this->Chunks[chunkId];
+      vtkIdType newId = this->NewIds ? this->ChunkOffsets[chunkId] : 0;
+      for ( vtkIdType loc = chunk.Begin; loc < chunk.End; )
+        {
+        vtkIdType npts = chunk.Conn[loc++];
+        for ( vtkIdType i = 0; i < npts; ++i, ++loc )
+          {
+          vtkIdType ptId = chunk.Conn[loc];
+          if ( this->Representative[ptId] == ptId &&
+               this->FirstUse[ptId].load() == chunk.Position + loc )
+            {
+            if ( this->NewIds )
+              {
+              this->NewIds[ptId] = newId;
+              this->Representatives[newId] = ptId;
+              }
+            ++newId;
+            }
+          }
+        }
+      if ( !this->NewIds )
+        {
+        this->ChunkOffsets[chunkId] = newId;
+        }
+      }
+    }
+};
+
+// Map the input points to the output points and set the coordinates of the
+// output points.
+template <typename TKey>
+struct MapMergedPoints
+{
+  vtkCleanPolyData *Self;
+  vtkPoints *Points;
+  const vtkIdType *NewIds;
+  const vtkIdType *Representatives;
+  vtkIdType *PointMap;
+  TKey *OutPts;
+
+  void operator()(vtkIdType ptId, vtkIdType end)
+    {
+    for ( ; ptId < end; ++ptId )
+      {
+      if ( this->PointMap[ptId] >= 0 )
+        {
+        this->PointMap[ptId] = this->NewIds[this->PointMap[ptId]];
+        }
+      }
+    }
+
+  struct Copy
+    {
+    MapMergedPoints *Map;
+    void operator()(vtkIdType newId, vtkIdType end)
+      {
+      double x[3], newx[3];
+      for ( ; newId < end; ++newId )
+        {
+        this->Map->Points->GetPoint(this->Map->Representatives[newId], x);
+        this->Map->Self->OperateOnPoint(x, newx);
+        TKey *p = this->Map->OutPts + 3*newId;
+        p[0] = static_cast<TKey>(newx[0]);
+        p[1] = static_cast<TKey>(newx[1]);
+        p[2] = static_cast<TKey>(newx[2]);
+        }
+      }
+    };
+};
+
+template <typename TKey>
+vtkIdType *MergePoints(vtkCleanPolyData *self, vtkPolyData *input,
+                       vtkPointLocator *locator, vtkPoints *newPts,
+                       vtkPointData *outputPD)
+{
+  vtkPoints *inPts = input->GetPoints();
+  vtkIdType numPts = input->GetNumberOfPoints();
+  vtkPointData *inputPD = input->GetPointData();
+
+  std::vector<CellChunk> chunks;
+  vtkIdType numUses = AddCellChunks(input->GetVerts(), 0, chunks);
+  numUses = AddCellChunks(input->GetLines(), numUses, chunks);
+  numUses = AddCellChunks(input->GetPolys(), numUses, chunks);
+  numUses = AddCellChunks(input->GetStrips(), numUses, chunks);
+  vtkIdType numChunks = static_cast<vtkIdType>(chunks.size());
+
+  vtkAtomic<vtkIdType> *firstUse = new vtkAtomic<vtkIdType>[numPts];
+  vtkSMPTools::Fill(firstUse, firstUse + numPts, numUses);
+  ComputeFirstUse computeFirstUse(chunks, firstUse);
+  vtkSMPTools::For(0, numChunks, 1, computeFirstUse);
+  computeFirstUse.NumberOfChanges = 0;
+  vtkSMPTools::For(0, numChunks, 1, computeFirstUse);
+  if ( computeFirstUse.NumberOfChanges.load() > 0 )
+    {
+    computeFirstUse(0, numChunks);
+    }
+
+  // Bin and sort the used points. The bucket of the points is kept in the
+  // array that becomes the point map.
+  int *divs = locator->GetDivisions();
+  vtkIdType numBuckets = static_cast<vtkIdType>(divs[0]) * divs[1] * divs[2];
+  vtkIdType *pointMap = new vtkIdType[numPts];
+  vtkAtomic<vtkIdType> *offsets = new vtkAtomic<vtkIdType>[numBuckets + 1];
+  BinMergePoints<TKey> bin(self, inPts, locator, firstUse, numUses,
+                           pointMap, offsets);
+  vtkSMPTools::For(0, numPts, bin);
+  if ( bin.HasNaN.load() )
+    {
+    delete [] offsets;
+    delete [] pointMap;
+    delete [] firstUse;
+    return NULL;
+    }
+  vtkIdType numUsedPts = vtkSMPTools::InclusiveScan(
+    offsets, offsets + numBuckets, offsets, static_cast<vtkIdType>(0));
+  offsets[numBuckets] = numUsedPts;
+  bin.Tuples = new MergeTuple<TKey>[numUsedPts];
+  typename BinMergePoints<TKey>::Fill fill = {&bin};
+  vtkSMPTools::For(0, numPts, fill);
+  typename BinMergePoints<TKey>::Sort sort = {&bin};
+  vtkSMPTools::For(0, numBuckets, sort);
+  delete [] offsets;
+
+  MarkMergeGroups<TKey> mark = {bin.Tuples, numUsedPts, pointMap};
+  vtkSMPTools::For(0, numUsedPts, mark);
+  delete [] bin.Tuples;
+
+  // Number the representatives in the order of their first use.
+  vtkIdType *chunkOffsets = new vtkIdType[numChunks];
+  NumberNewPoints number(chunks, firstUse, pointMap, chunkOffsets);
+  vtkSMPTools::For(0, numChunks, 1, number);
+  vtkIdType numNewPts = vtkSMPTools::ExclusiveScan(
+    chunkOffsets, chunkOffsets + numChunks, chunkOffsets,
+    static_cast<vtkIdType>(0));
+  vtkIdType *newIds = new vtkIdType[numPts];
+  vtkIdType *reps = new vtkIdType[numNewPts];
+  number.NewIds = newIds;
+  number.Representatives = reps;
+  vtkSMPTools::For(0, numChunks, 1, number);
+  delete [] chunkOffsets;
+  delete [] firstUse;
+
+  newPts->SetNumberOfPoints(numNewPts);
+  MapMergedPoints<TKey> map = {self, inPts, newIds, reps, pointMap,
+    static_cast<TKey*>(newPts->GetVoidPointer(0))};
+  vtkSMPTools::For(0, numPts, map);
+  typename MapMergedPoints<TKey>::Copy copy = {&map};
+  vtkSMPTools::For(0, numNewPts, copy);
+
+  // The point data is copied from the representatives.
+  for ( vtkIdType ptId = 0; ptId < numNewPts; ++ptId )
+    {
+    outputPD->CopyData(inputPD, reps[ptId], ptId);
+    }
+
+  delete [] reps;
+  delete [] newIds;
+  return pointMap;
+}
+
+} // end anon namespace
+
 //---------------------------------------------------------------------------
 // Specify a spatial locator for speeding the search process. By
 // default an instance of vtkPointLocator is used.
@@ -37,6 +490,7 @@ vtkCxxSetObjectMacro(vtkCleanPolyData,Locator,vtkIncrementalPointLocator);
 vtkCleanPolyData::vtkCleanPolyData()
 {
   this->PointMerging = 1;
+  this->ParallelPointMerging = 0;
   this->ToleranceIsAbsolute  = 0;
   this->Tolerance            = 0.0;
   this->AbsoluteTolerance    = 1.0;
@@ -169,6 +623,7 @@ int vtkCleanPolyData::RequestData(
   double x[3];
   double newx[3];
   vtkIdType *pointMap=0; //used if no merging
+  vtkIdType *mergeMap=0; //used if points are merged in parallel
 
   vtkCellArray *inVerts  = input->GetVerts(),  *newVerts  = NULL;
   vtkCellArray *inLines  = input->GetLines(),  *newLines  = NULL;
@@ -209,6 +664,10 @@ int vtkCleanPolyData::RequestData(
   vtkCellData  *outputCD = output->GetCellData();
   outputPD->CopyAllocate(inputPD);
   outputCD->CopyAllocate(inputCD);
+  if ( this->PointMerging && this->ParallelPointMerging )
+    {
+    mergeMap = this->ParallelMerge(input, newPts, outputPD);
+    }
 
   // Celldata needs to be copied correctly. If a poly is converted to
   // a line, or a line to a point, then using a CellCounter will not
@@ -237,21 +696,28 @@ int vtkCleanPolyData::RequestData(
       {
       for ( numNewPts=0, i=0; i < npts; i++ )
         {
-        inPts->GetPoint(pts[i],x);
-        this->OperateOnPoint(x, newx);
-        if ( ! this->PointMerging )
+        if ( mergeMap )
           {
-          if ( (ptId=pointMap[pts[i]]) == -1 )
+          ptId = mergeMap[pts[i]];
+          }
+        else
+          {
+          inPts->GetPoint(pts[i],x);
+          this->OperateOnPoint(x, newx);
+          if ( ! this->PointMerging )
+            {
+            if ( (ptId=pointMap[pts[i]]) == -1 )
+              {
+              pointMap[pts[i]] = ptId = numUsedPts++;
+              newPts->SetPoint(ptId,newx);
+              outputPD->CopyData(inputPD,pts[i],ptId);
+              }
+            }
+          else if ( this->Locator->InsertUniquePoint(newx, ptId) )
             {
-            pointMap[pts[i]] = ptId = numUsedPts++;
-            newPts->SetPoint(ptId,newx);
             outputPD->CopyData(inputPD,pts[i],ptId);
             }
           }
-        else if ( this->Locator->InsertUniquePoint(newx, ptId) )
-          {
-          outputPD->CopyData(inputPD,pts[i],ptId);
-          }
         updatedPts[numNewPts++] = ptId;
         }//for all points of vertex cell
 
@@ -282,21 +748,28 @@ int vtkCleanPolyData::RequestData(
       {
       for ( numNewPts=0, i=0; i<npts; i++ )
         {
-        inPts->GetPoint(pts[i],x);
-        this->OperateOnPoint(x, newx);
-        if ( ! this->PointMerging )
+        if ( mergeMap )
           {
-          if ( (ptId=pointMap[pts[i]]) == -1 )
+          ptId = mergeMap[pts[i]];
+          }
+        else
+          {
+          inPts->GetPoint(pts[i],x);
+          this->OperateOnPoint(x, newx);
+          if ( ! this->PointMerging )
+            {
+            if ( (ptId=pointMap[pts[i]]) == -1 )
+              {
+              pointMap[pts[i]] = ptId = numUsedPts++;
+              newPts->SetPoint(ptId,newx);
+              outputPD->CopyData(inputPD,pts[i],ptId);
+              }
+            }
+          else if ( this->Locator->InsertUniquePoint(newx, ptId) )
             {
-            pointMap[pts[i]] = ptId = numUsedPts++;
-            newPts->SetPoint(ptId,newx);
             outputPD->CopyData(inputPD,pts[i],ptId);
             }
           }
-        else if ( this->Locator->InsertUniquePoint(newx, ptId) )
-          {
-          outputPD->CopyData(inputPD,pts[i],ptId);
-          }
         if ( i == 0 || ptId != updatedPts[numNewPts-1] )
           {
           updatedPts[numNewPts++] = ptId;
@@ -348,21 +821,28 @@ int vtkCleanPolyData::RequestData(
       {
       for ( numNewPts=0, i=0; i<npts; i++ )
         {
-        inPts->GetPoint(pts[i],x);
-        this->OperateOnPoint(x, newx);
-        if ( ! this->PointMerging )
+        if ( mergeMap )
+          {
+          ptId = mergeMap[pts[i]];
+          }
+        else
           {
-          if ( (ptId=pointMap[pts[i]]) == -1 )
+          inPts->GetPoint(pts[i],x);
+          this->OperateOnPoint(x, newx);
+          if ( ! this->PointMerging )
+            {
+            if ( (ptId=pointMap[pts[i]]) == -1 )
+              {
+              pointMap[pts[i]] = ptId = numUsedPts++;
+              newPts->SetPoint(ptId,newx);
+              outputPD->CopyData(inputPD,pts[i],ptId);
+              }
+            }
+          else if ( this->Locator->InsertUniquePoint(newx, ptId) )
             {
-            pointMap[pts[i]] = ptId = numUsedPts++;
-            newPts->SetPoint(ptId,newx);
             outputPD->CopyData(inputPD,pts[i],ptId);
             }
           }
-        else if ( this->Locator->InsertUniquePoint(newx, ptId) )
-          {
-          outputPD->CopyData(inputPD,pts[i],ptId);
-          }
         if ( i == 0 || ptId != updatedPts[numNewPts-1] )
           {
           updatedPts[numNewPts++] = ptId;
@@ -434,21 +914,28 @@ int vtkCleanPolyData::RequestData(
       {
       for ( numNewPts=0, i=0; i < npts; i++ )
         {
-        inPts->GetPoint(pts[i],x);
-        this->OperateOnPoint(x, newx);
-        if ( ! this->PointMerging )
+        if ( mergeMap )
+          {
+          ptId = mergeMap[pts[i]];
+          }
+        else
           {
-          if ( (ptId=pointMap[pts[i]]) == -1 )
+          inPts->GetPoint(pts[i],x);
+          this->OperateOnPoint(x, newx);
+          if ( ! this->PointMerging )
+            {
+            if ( (ptId=pointMap[pts[i]]) == -1 )
+              {
+              pointMap[pts[i]] = ptId = numUsedPts++;
+              newPts->SetPoint(ptId,newx);
+              outputPD->CopyData(inputPD,pts[i],ptId);
+              }
+            }
+          else if ( this->Locator->InsertUniquePoint(newx, ptId) )
             {
-            pointMap[pts[i]] = ptId = numUsedPts++;
-            newPts->SetPoint(ptId,newx);
             outputPD->CopyData(inputPD,pts[i],ptId);
             }
           }
-        else if ( this->Locator->InsertUniquePoint(newx, ptId) )
-          {
-          outputPD->CopyData(inputPD,pts[i],ptId);
-          }
         if ( i == 0 || ptId != updatedPts[numNewPts-1] )
           {
           updatedPts[numNewPts++] = ptId;
@@ -528,6 +1015,7 @@ int vtkCleanPolyData::RequestData(
   if ( this->PointMerging )
     {
     this->Locator->Initialize(); //release memory.
+    delete [] mergeMap;
     }
   else
     {
@@ -594,6 +1082,33 @@ int vtkCleanPolyData::RequestData(
   return 1;
 }
 
+//--------------------------------------------------------------------------
+// Merge the points exactly as vtkMergePoints::InsertUniquePoint() does,
+// but in parallel. This requires the locator to be initialized for point
+// insertion.
+vtkIdType *vtkCleanPolyData::ParallelMerge(vtkPolyData *input,
+                                           vtkPoints *newPts,
+                                           vtkPointData *outputPD)
+{
+  if ( !this->Locator ||
+       strcmp(this->Locator->GetClassName(), "vtkMergePoints") != 0 )
+    {
+    return NULL;
+    }
+  vtkPointLocator *locator = static_cast<vtkPointLocator*>(this->Locator);
+
+  switch ( newPts->GetDataType() )
+    {
+    case VTK_FLOAT:
+      return MergePoints<float>(this, input, locator, newPts, outputPD);
+    case VTK_DOUBLE:
+      return MergePoints<double>(this, input, locator, newPts, outputPD);
+    default:
+      // vtkMergePoints compares other types in double precision.
+      return NULL;
+    }
+}
+
 //--------------------------------------------------------------------------
 // Method manages creation of locators. It takes into account the potential
 // change of tolerance (zero to non-zero).
@@ -651,6 +1166,8 @@ void vtkCleanPolyData::PrintSelf(ostream& os, vtkIndent indent)
 
   os << indent << "Point Merging: "
      << (this->PointMerging ? "On\n" : "Off\n");
+  os << indent << "Parallel Point Merging: "
+     << (this->ParallelPointMerging ? "On\n" : "Off\n");
   os << indent << "ToleranceIsAbsolute: "
      << (this->ToleranceIsAbsolute ? "On\n" : "Off\n");
   os << indent << "Tolerance: "
@@ -43,6 +43,14 @@
 // Note that merging of points can be disabled. In this case, a point locator
 // will not be used, and points that are not used by any cells will be
 // eliminated, but never merged.
+//
+// When points are merged exactly (the default vtkMergePoints locator is
+// used) and the output points are float or double, the merge can be
+// performed in parallel with vtkSMPTools (see ParallelPointMerging). The
+// points are binned with the buckets of the locator and sorted; the
+// output is identical to the serial insertion, i.e. output points are
+// numbered in the order they are first used by the cells (verts, lines,
+// polys and then strips).
 
 // .SECTION Caveats
 // Merging points can alter topology, including introducing non-manifold
@@ -65,6 +73,8 @@
 #include "vtkPolyDataAlgorithm.h"
 
 class vtkIncrementalPointLocator;
+class vtkPointData;
+class vtkPoints;
 
 class VTKFILTERSCORE_EXPORT vtkCleanPolyData : public vtkPolyDataAlgorithm
 {
@@ -119,6 +129,19 @@ public:
   vtkGetMacro(PointMerging,int);
   vtkBooleanMacro(PointMerging,int);
 
+  // Description:
+  // Set/Get a boolean value that controls whether exact point merging is
+  // performed in parallel. This only applies when the locator is a
+  // vtkMergePoints (the default when the tolerance is zero) and the
+  // output points are float or double; otherwise points are inserted one
+  // at a time into the locator. The result does not depend on this
+  // setting. Note that OperateOnPoint() is invoked from several threads
+  // when on, so subclasses overriding it must make it thread safe before
+  // turning this on. By default, parallel merging is off.
+  vtkSetMacro(ParallelPointMerging,int);
+  vtkGetMacro(ParallelPointMerging,int);
+  vtkBooleanMacro(ParallelPointMerging,int);
+
   // Description:
   // Set/Get a spatial locator for speeding the search process. By
   // default an instance of vtkMergePoints is used.
@@ -170,6 +193,7 @@ protected:
   virtual int RequestUpdateExtent(vtkInformation *, vtkInformationVector **, vtkInformationVector *);
 
   int   PointMerging;
+  int   ParallelPointMerging;
   double Tolerance;
   double AbsoluteTolerance;
   int ConvertLinesToPoints;
@@ -180,6 +204,12 @@ protected:
 
   int PieceInvariant;
   int OutputPointsPrecision;
+
+  // Compute the map from input to output points for exact merging in
+  // parallel, and fill the output points and point data. Returns NULL if
+  // the parallel merge cannot be used.
+  vtkIdType *ParallelMerge(vtkPolyData *input, vtkPoints *newPts,
+                           vtkPointData *outputPD);
 private:
   vtkCleanPolyData(const vtkCleanPolyData&) VTK_DELETE_FUNCTION;
   void operator=(const vtkCleanPolyData&) VTK_DELETE_FUNCTION;
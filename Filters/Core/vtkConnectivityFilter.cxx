@@ -16,6 +16,7 @@
 
 #include "vtkCell.h"
 #include "vtkCellData.h"
+#include "vtkConnectivityHelper.h"
 #include "vtkDataSet.h"
 #include "vtkFloatArray.h"
 #include "vtkIdList.h"
@@ -29,6 +30,9 @@
 #include "vtkUnstructuredGrid.h"
 #include "vtkIdTypeArray.h"
 
+#include <algorithm>
+#include <vector>
+
 vtkStandardNewMacro(vtkConnectivityFilter);
 
 // Construct with default extraction mode to extract largest regions.
@@ -57,6 +61,7 @@ vtkConnectivityFilter::vtkConnectivityFilter()
   this->NewCellScalars = 0;
 
   this->OutputPointsPrecision = vtkAlgorithm::DEFAULT_PRECISION;
+  this->ParallelLabeling = 0;
 }
 
 vtkConnectivityFilter::~vtkConnectivityFilter()
@@ -186,6 +191,37 @@ int vtkConnectivityFilter::RequestData(
 
   if ( this->ExtractionMode != VTK_EXTRACT_POINT_SEEDED_REGIONS &&
   this->ExtractionMode != VTK_EXTRACT_CELL_SEEDED_REGIONS &&
+  this->ExtractionMode != VTK_EXTRACT_CLOSEST_POINT_REGION &&
+  this->ParallelLabeling && !this->InScalars &&
+  vtkConnectivityHelper::CanLabelRegions(input) )
+    { //label all regions at once, and number the points in input order
+    std::vector<vtkIdType> pointRegions(numPts);
+    this->RegionNumber = vtkConnectivityHelper::LabelRegions(
+      input, this->Visited, &pointRegions[0], this->RegionSizes);
+    this->UpdateProgress (0.8);
+
+    std::copy(this->Visited, this->Visited + numCells,
+              this->NewCellScalars->GetPointer(0));
+    for (i=0; i < numPts; i++)
+      {
+      if ( pointRegions[i] >= 0 )
+        {
+        this->PointMap[i] = this->PointNumber++;
+        this->NewScalars->SetValue(this->PointMap[i], pointRegions[i]);
+        }
+      }
+    for (vtkIdType regionId=0; regionId < this->RegionNumber; regionId++)
+      {
+      if ( this->RegionSizes->GetValue(regionId) > maxCellsInRegion )
+        {
+        maxCellsInRegion = this->RegionSizes->GetValue(regionId);
+        largestRegionId = regionId;
+        }
+      }
+    this->UpdateProgress (0.9);
+    }
+  else if ( this->ExtractionMode != VTK_EXTRACT_POINT_SEEDED_REGIONS &&
+  this->ExtractionMode != VTK_EXTRACT_CELL_SEEDED_REGIONS &&
   this->ExtractionMode != VTK_EXTRACT_CLOSEST_POINT_REGION )
     { //visit all cells marking with region number
     for (cellId=0; cellId < numCells; cellId++)
@@ -597,5 +633,7 @@ void vtkConnectivityFilter::PrintSelf(ostream& os, vtkIndent indent)
   os << indent << "Scalar Range: (" << range[0] << ", " << range[1] << ")\n";
   os << indent << "Output Points Precision: " << this->OutputPointsPrecision
      << "\n";
+  os << indent << "Parallel Labeling: "
+     << (this->ParallelLabeling ? "On\n" : "Off\n");
 }
 
@@ -152,6 +152,18 @@ public:
   vtkSetMacro(OutputPointsPrecision,int);
   vtkGetMacro(OutputPointsPrecision,int);
 
+  // Description:
+  // Turn on/off the labeling of all the regions at once in parallel when
+  // the regions are not seeded (largest, specified or all regions) and
+  // ScalarConnectivity is off. The region ids and sizes are the same as
+  // with the serial traversal, but the output points are numbered in the
+  // order of the input points instead of the order they are reached in.
+  // Only unstructured grid and polydata inputs are labeled in parallel.
+  // Off by default.
+  vtkSetMacro(ParallelLabeling,int);
+  vtkGetMacro(ParallelLabeling,int);
+  vtkBooleanMacro(ParallelLabeling,int);
+
 protected:
   vtkConnectivityFilter();
   ~vtkConnectivityFilter();
@@ -163,6 +175,7 @@ protected:
   int ColorRegions; //boolean turns on/off scalar gen for separate regions
   int ExtractionMode; //how to extract regions
   int OutputPointsPrecision;
+  int ParallelLabeling;
   vtkIdList *Seeds; //id's of points or cells used to seed regions
   vtkIdList *SpecifiedRegionIds; //regions specified for extraction
   vtkIdTypeArray *RegionSizes; //size (in cells) of each region extracted
@@ -0,0 +1,255 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkConnectivityHelper.cxx
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "vtkConnectivityHelper.h"
+
+#include "vtkIdTypeArray.h"
+#include "vtkPolyData.h"
+#include "vtkSMPThreadLocal.h"
+#include "vtkSMPTools.h"
+#include "vtkStaticCellLinksTemplate.h"
+#include "vtkUnstructuredGrid.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace
+{
+
+// Sets the label of each cell to the smallest label of its points, or to
+// -1 if it has no points.
+template <class TDataSet>
+struct CellMinimum
+{
+  TDataSet *Input;
+  const vtkIdType *Labels;
+  vtkIdType *CellLabels;
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    vtkIdType npts, *pts;
+    for (vtkIdType cellId = begin; cellId < end; ++cellId)
+      {
+      this->Input->GetCellPoints(cellId, npts, pts);
+      vtkIdType label = -1;
+      for (vtkIdType i = 0; i < npts; ++i)
+        {
+        if (label < 0 || this->Labels[pts[i]] < label)
+          {
+          label = this->Labels[pts[i]];
+          }
+        }
+      this->CellLabels[cellId] = label;
+      }
+  }
+};
+
+// Sets the new label of each point to the smallest label of the cells
+// using it, and records whether any label changed.
+struct PointMinimum
+{
+  vtkStaticCellLinksTemplate<vtkIdType> *Links;
+  const vtkIdType *Labels;
+  const vtkIdType *CellLabels;
+  vtkIdType *NewLabels;
+  vtkSMPThreadLocal<unsigned char> Changed;
+
+  PointMinimum() : Changed(0)
+  {
+  }
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    bool changed = false;
+    for (vtkIdType ptId = begin; ptId < end; ++ptId)
+      {
+      vtkIdType label = this->Labels[ptId];
+      vtkIdType ncells = this->Links->GetNumberOfCells(ptId);
+      const vtkIdType *cells = this->Links->GetCells(ptId);
+      for (vtkIdType i = 0; i < ncells; ++i)
+        {
+        if (this->CellLabels[cells[i]] < label)
+          {
+          label = this->CellLabels[cells[i]];
+          }
+        }
+      this->NewLabels[ptId] = label;
+      changed |= (label != this->Labels[ptId]);
+      }
+    if (changed)
+      {
+      this->Changed.Local() = 1;
+      }
+  }
+};
+
+// Replaces the label of each point with the label of its label. Labels
+// are point ids of the same region, so this shortens the chains of labels.
+struct JumpLabels
+{
+  const vtkIdType *NewLabels;
+  vtkIdType *Labels;
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    for (vtkIdType ptId = begin; ptId < end; ++ptId)
+      {
+      this->Labels[ptId] = this->NewLabels[this->NewLabels[ptId]];
+      }
+  }
+};
+
+// Sets the region of each point from the region of its label.
+struct PointRegions
+{
+  const vtkIdType *Labels;
+  const vtkIdType *LabelRegions;
+  vtkIdType *Regions;
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    for (vtkIdType ptId = begin; ptId < end; ++ptId)
+      {
+      this->Regions[ptId] = this->LabelRegions[this->Labels[ptId]];
+      }
+  }
+};
+
+template <class TDataSet>
+vtkIdType LabelRegionsImpl(TDataSet *input, vtkIdType *cellRegions,
+                           vtkIdType *pointRegions,
+                           vtkIdTypeArray *regionSizes)
+{
+  vtkIdType numPts = input->GetNumberOfPoints();
+  vtkIdType numCells = input->GetNumberOfCells();
+
+  vtkStaticCellLinksTemplate<vtkIdType> links;
+  links.BuildLinks(input);
+
+  // Propagate the smallest point id through the cells. When no label
+  // changes, all the points of a region are labeled with its smallest
+  // point id.
+  std::vector<vtkIdType> labels(numPts);
+  std::vector<vtkIdType> newLabels(numPts);
+  for (vtkIdType ptId = 0; ptId < numPts; ++ptId)
+    {
+    labels[ptId] = ptId;
+    }
+  std::vector<vtkIdType> cellLabels(numCells);
+  vtkIdType *labelsPtr = numPts ? &labels[0] : NULL;
+  vtkIdType *newLabelsPtr = numPts ? &newLabels[0] : NULL;
+
+  CellMinimum<TDataSet> cellMinimum;
+  cellMinimum.Input = input;
+  cellMinimum.Labels = labelsPtr;
+  cellMinimum.CellLabels = &cellLabels[0];
+  JumpLabels jump;
+  jump.NewLabels = newLabelsPtr;
+  jump.Labels = labelsPtr;
+
+  bool changed = true;
+  while (changed)
+    {
+    vtkSMPTools::For(0, numCells, cellMinimum);
+
+    PointMinimum pointMinimum;
+    pointMinimum.Links = &links;
+    pointMinimum.Labels = labelsPtr;
+    pointMinimum.CellLabels = &cellLabels[0];
+    pointMinimum.NewLabels = newLabelsPtr;
+    vtkSMPTools::For(0, numPts, pointMinimum);
+
+    changed = false;
+    for (vtkSMPThreadLocal<unsigned char>::iterator iter =
+           pointMinimum.Changed.begin();
+         iter != pointMinimum.Changed.end(); ++iter)
+      {
+      changed |= (*iter != 0);
+      }
+
+    vtkSMPTools::For(0, numPts, jump);
+    }
+
+  // Number the regions in the order of their first cell. The cell labels
+  // are those of the last pass, in which no label changed.
+  std::vector<vtkIdType> labelRegions(numPts, -1);
+  std::vector<vtkIdType> sizes;
+  for (vtkIdType cellId = 0; cellId < numCells; ++cellId)
+    {
+    vtkIdType label = cellLabels[cellId];
+    vtkIdType region;
+    if (label < 0)
+      {
+      // a cell without points is a region by itself
+      region = static_cast<vtkIdType>(sizes.size());
+      sizes.push_back(0);
+      }
+    else if ((region = labelRegions[label]) < 0)
+      {
+      region = labelRegions[label] = static_cast<vtkIdType>(sizes.size());
+      sizes.push_back(0);
+      }
+    cellRegions[cellId] = region;
+    sizes[region]++;
+    }
+
+  PointRegions regions;
+  regions.Labels = labelsPtr;
+  regions.LabelRegions = numPts ? &labelRegions[0] : NULL;
+  regions.Regions = pointRegions;
+  vtkSMPTools::For(0, numPts, regions);
+
+  vtkIdType numRegions = static_cast<vtkIdType>(sizes.size());
+  regionSizes->SetNumberOfValues(numRegions);
+  for (vtkIdType region = 0; region < numRegions; ++region)
+    {
+    regionSizes->SetValue(region, sizes[region]);
+    }
+  return numRegions;
+}
+
+}
+
+//----------------------------------------------------------------------------
+bool vtkConnectivityHelper::CanLabelRegions(vtkDataSet *input)
+{
+  return vtkPolyData::SafeDownCast(input) ||
+    vtkUnstructuredGrid::SafeDownCast(input);
+}
+
+//----------------------------------------------------------------------------
+vtkIdType vtkConnectivityHelper::LabelRegions(vtkDataSet *input,
+                                              vtkIdType *cellRegions,
+                                              vtkIdType *pointRegions,
+                                              vtkIdTypeArray *regionSizes)
+{
+  regionSizes->Reset();
+  if (input->GetNumberOfCells() < 1)
+    {
+    std::fill_n(pointRegions, input->GetNumberOfPoints(), -1);
+    return 0;
+    }
+
+  if (vtkPolyData *polyData = vtkPolyData::SafeDownCast(input))
+    {
+    // Cells are retrieved from several threads.
+    if (polyData->NeedToBuildCells())
+      {
+      polyData->BuildCells();
+      }
+    return LabelRegionsImpl(polyData, cellRegions, pointRegions, regionSizes);
+    }
+  return LabelRegionsImpl(static_cast<vtkUnstructuredGrid*>(input),
+                          cellRegions, pointRegions, regionSizes);
+}
@@ -0,0 +1,61 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkConnectivityHelper.h
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+// .NAME vtkConnectivityHelper - A utility class used by the connectivity filters
+// .SECTION Description
+// This is a simple utility class that labels all the regions of cells
+// sharing points of an unstructured grid or polydata in parallel with
+// vtkSMPTools. Each point starts with its own id as label, and the smallest
+// label is propagated through the cells until no label changes, jumping to
+// the label of the label after each pass so that long chains of cells
+// collapse quickly. The resulting regions are numbered in the order of
+// their first cell, as the serial traversal of the connectivity filters
+// does.
+// .SECTION See Also
+// vtkConnectivityFilter vtkPolyDataConnectivityFilter
+
+#ifndef vtkConnectivityHelper_h
+#define vtkConnectivityHelper_h
+
+#include "vtkFiltersCoreModule.h" // For export macro
+#include "vtkType.h" // For vtkIdType
+
+class vtkDataSet;
+class vtkIdTypeArray;
+
+class VTKFILTERSCORE_EXPORT vtkConnectivityHelper
+{
+public:
+  // Description:
+  // Return whether the regions of input can be labeled, i.e. whether it is
+  // a vtkPolyData or a vtkUnstructuredGrid.
+  static bool CanLabelRegions(vtkDataSet *input);
+
+  // Description:
+  // Label the regions of input. cellRegions (numCells) receives the region
+  // of each cell and pointRegions (numPts) the region of each point, or -1
+  // if the point is not used by any cell. The number of cells of each
+  // region is stored in regionSizes. Return the number of regions.
+  static vtkIdType LabelRegions(vtkDataSet *input, vtkIdType *cellRegions,
+                                vtkIdType *pointRegions,
+                                vtkIdTypeArray *regionSizes);
+
+private:
+  vtkConnectivityHelper() VTK_DELETE_FUNCTION;
+  vtkConnectivityHelper(const vtkConnectivityHelper&) VTK_DELETE_FUNCTION;
+  vtkConnectivityHelper& operator=(const vtkConnectivityHelper&) VTK_DELETE_FUNCTION;
+};
+
+#endif
+// VTK-HeaderTest-Exclude: vtkConnectivityHelper.h
@@ -14,6 +14,8 @@
 =========================================================================*/
 #include "vtkGlyph3D.h"
 
+#include "vtkArrayListTemplate.h" // For processing attribute data
+#include "vtkCellArray.h"
 #include "vtkCellData.h"
 #include "vtkCell.h"
 #include "vtkFloatArray.h"
@@ -22,10 +24,13 @@
 #include "vtkInformation.h"
 #include "vtkInformationVector.h"
 #include "vtkMath.h"
+#include "vtkMatrix4x4.h"
 #include "vtkNew.h"
 #include "vtkObjectFactory.h"
 #include "vtkPointData.h"
 #include "vtkPolyData.h"
+#include "vtkSMPThreadLocalObject.h"
+#include "vtkSMPTools.h"
 #include "vtkSmartPointer.h"
 #include "vtkStreamingDemandDrivenPipeline.h"
 #include "vtkTransform.h"
@@ -33,6 +38,415 @@
 #include "vtkUniformGrid.h"
 #include "vtkUnsignedCharArray.h"
 
+#include <algorithm>
+#include <vector>
+
+namespace
+{
+
+// The number of points, cells and connectivity entries of a glyph. Once
+// scanned, the offsets of the glyph of each input point in the output.
+struct GlyphSize
+{
+  vtkIdType Points;
+  vtkIdType Cells;
+  vtkIdType Connectivity;
+};
+
+struct AddGlyphSizes
+{
+  GlyphSize operator()(const GlyphSize &a, const GlyphSize &b) const
+  {
+    GlyphSize sum = { a.Points + b.Points, a.Cells + b.Cells,
+                      a.Connectivity + b.Connectivity };
+    return sum;
+  }
+};
+
+// A glyph of the table, with its points (transformed by the source
+// transform), normals and texture coordinates read in advance.
+struct GlyphSource
+{
+  vtkPolyData *Source;
+  GlyphSize Size;
+  vtkCellArray *Cells; // The cells, when they all are in this cell array
+  std::vector<double> Points;
+  std::vector<double> Normals;
+  std::vector<double> TCoords;
+};
+
+// Generates the glyphs in two passes over the input points. The first one
+// selects the glyph of each point. Once their sizes are scanned into
+// offsets, the second one writes each glyph at its offsets in the output.
+struct GlyphWorker
+{
+  vtkDataSet *Input;
+  vtkDataArray *InSScalars;
+  vtkDataArray *InVectors; // The vectors or normals, if any
+  vtkDataArray *InCScalars;
+  const unsigned char *InGhostLevels;
+  int ScaleMode;
+  int ColorMode;
+  int IndexMode;
+  int Scaling;
+  int Clamping;
+  int Orient;
+  double ScaleFactor;
+  double Range[2];
+  double Den;
+  std::vector<GlyphSource> Sources; // Entries without a source are skipped
+
+  std::vector<int> SourceIds; // The glyph of each point, or -1
+  std::vector<GlyphSize> Offsets;
+
+  float *NewPoints;
+  float *NewNormals;
+  float *NewVectors;
+  float *NewTCoords;
+  int NumberOfTCoordComponents;
+  float *NewScalars; // The scale or the vector magnitude
+  vtkDataArray *NewColorScalars;
+  vtkIdType *PointIds;
+  vtkIdType *Connectivity; // NULL when the cells are inserted serially
+  ArrayList *PointArrays;
+  ArrayList *CellArrays;
+  vtkSMPThreadLocalObject<vtkTransform> Transform;
+
+  // Compute the scale of the glyph of ptId, before the scale factor is
+  // applied, along with the scalar and the vector of the point.
+  void ComputeScale(vtkIdType ptId, double &s, double v[3], double &vMag,
+                    double scale[3])
+  {
+    scale[0] = scale[1] = scale[2] = 1.0;
+    s = 0.0;
+    v[0] = v[1] = v[2] = 0.0;
+    vMag = 0.0;
+    if ( this->InSScalars )
+      {
+      s = this->InSScalars->GetComponent(ptId, 0);
+      if ( this->ScaleMode == VTK_SCALE_BY_SCALAR ||
+           this->ScaleMode == VTK_DATA_SCALING_OFF )
+        {
+        scale[0] = scale[1] = scale[2] = s;
+        }
+      }
+    if ( this->InVectors )
+      {
+      this->InVectors->GetTuple(ptId, v);
+      vMag = vtkMath::Norm(v);
+      if ( this->ScaleMode == VTK_SCALE_BY_VECTORCOMPONENTS )
+        {
+        scale[0] = v[0];
+        scale[1] = v[1];
+        scale[2] = v[2];
+        }
+      else if ( this->ScaleMode == VTK_SCALE_BY_VECTOR )
+        {
+        scale[0] = scale[1] = scale[2] = vMag;
+        }
+      }
+
+    // Clamp data scale if enabled
+    if ( this->Clamping )
+      {
+      for (int i = 0; i < 3; ++i)
+        {
+        scale[i] = (scale[i] < this->Range[0] ? this->Range[0] :
+                    (scale[i] > this->Range[1] ? this->Range[1] : scale[i]));
+        scale[i] = (scale[i] - this->Range[0]) / this->Den;
+        }
+      }
+  }
+
+  void SelectSources(vtkIdType begin, vtkIdType end)
+  {
+    int numberOfSources = static_cast<int>(this->Sources.size());
+    double s, v[3], vMag, scale[3];
+    for (vtkIdType ptId = begin; ptId < end; ++ptId)
+      {
+      // Compute index into table of glyphs
+      int index = 0;
+      if ( this->IndexMode != VTK_INDEXING_OFF )
+        {
+        this->ComputeScale(ptId, s, v, vMag, scale);
+        double value = this->IndexMode == VTK_INDEXING_BY_SCALAR ? s : vMag;
+        index = static_cast<int>(
+          (value - this->Range[0])*numberOfSources / this->Den);
+        index = (index < 0 ? 0 :
+                 (index >= numberOfSources ? (numberOfSources-1) : index));
+        }
+
+      // Make sure we're not indexing into empty glyph, and do not
+      // duplicate glyphs on the borders of the pieces.
+      if ( !this->Sources[index].Source ||
+           (this->InGhostLevels && this->InGhostLevels[ptId] &
+            vtkDataSetAttributes::DUPLICATEPOINT) )
+        {
+        index = -1;
+        }
+      this->SourceIds[ptId] = index;
+      }
+  }
+
+  void GenerateGlyphs(vtkIdType begin, vtkIdType end)
+  {
+    vtkTransform *trans = this->Transform.Local();
+    double s, v[3], vNew[3], vMag, scale[3], x[3], normalMatrix[16];
+    for (vtkIdType ptId = begin; ptId < end; ++ptId)
+      {
+      if ( this->SourceIds[ptId] < 0 )
+        {
+        continue;
+        }
+      const GlyphSource &glyph = this->Sources[this->SourceIds[ptId]];
+      const GlyphSize &offset = this->Offsets[ptId];
+      vtkIdType numSourcePts = glyph.Size.Points;
+      this->ComputeScale(ptId, s, v, vMag, scale);
+
+      // translate Source to Input point
+      trans->Identity();
+      this->Input->GetPoint(ptId, x);
+      trans->Translate(x[0], x[1], x[2]);
+
+      if ( this->InVectors )
+        {
+        // Copy Input vector
+        for (vtkIdType i = 0; i < numSourcePts; ++i)
+          {
+          float *vector = this->NewVectors + 3 * (offset.Points + i);
+          vector[0] = static_cast<float>(v[0]);
+          vector[1] = static_cast<float>(v[1]);
+          vector[2] = static_cast<float>(v[2]);
+          }
+        if ( this->Orient && (vMag > 0.0) )
+          {
+          // if there is no y or z component
+          if ( v[1] == 0.0 && v[2] == 0.0 )
+            {
+            if ( v[0] < 0 ) //just flip x if we need to
+              {
+              trans->RotateWXYZ(180.0,0,1,0);
+              }
+            }
+          else
+            {
+            vNew[0] = (v[0]+vMag) / 2.0;
+            vNew[1] = v[1] / 2.0;
+            vNew[2] = v[2] / 2.0;
+            trans->RotateWXYZ(180.0,vNew[0],vNew[1],vNew[2]);
+            }
+          }
+        }
+
+      if ( this->NewTCoords )
+        {
+        int numComps = this->NumberOfTCoordComponents;
+        for (vtkIdType i = 0; i < numSourcePts * numComps; ++i)
+          {
+          this->NewTCoords[offset.Points * numComps + i] =
+            static_cast<float>(glyph.TCoords[i]);
+          }
+        }
+
+      // Copy scalar value
+      if ( this->NewScalars )
+        {
+        float value = static_cast<float>(
+          this->ColorMode == VTK_COLOR_BY_VECTOR ? vMag : scale[0]);
+        std::fill_n(this->NewScalars + offset.Points, numSourcePts, value);
+        }
+      else if ( this->NewColorScalars )
+        {
+        for (vtkIdType i = 0; i < numSourcePts; ++i)
+          {
+          this->NewColorScalars->InsertTuple(offset.Points + i, ptId,
+                                             this->InCScalars);
+          }
+        }
+
+      // scale data if appropriate
+      if ( this->Scaling )
+        {
+        for (int i = 0; i < 3; ++i)
+          {
+          if ( this->ScaleMode == VTK_DATA_SCALING_OFF )
+            {
+            scale[i] = this->ScaleFactor;
+            }
+          else
+            {
+            scale[i] *= this->ScaleFactor;
+            }
+          if ( scale[i] == 0.0 )
+            {
+            scale[i] = 1.0e-10;
+            }
+          }
+        trans->Scale(scale[0], scale[1], scale[2]);
+        }
+
+      // multiply points and normals by resulting matrix
+      vtkMatrix4x4 *matrix = trans->GetMatrix();
+      for (vtkIdType i = 0; i < numSourcePts; ++i)
+        {
+        trans->InternalTransformPoint(&glyph.Points[3 * i], x);
+        float *point = this->NewPoints + 3 * (offset.Points + i);
+        point[0] = static_cast<float>(x[0]);
+        point[1] = static_cast<float>(x[1]);
+        point[2] = static_cast<float>(x[2]);
+        }
+      if ( this->NewNormals )
+        {
+        // to transform the normal, multiply by the transposed inverse matrix
+        vtkMatrix4x4::DeepCopy(normalMatrix, matrix);
+        vtkMatrix4x4::Invert(normalMatrix, normalMatrix);
+        vtkMatrix4x4::Transpose(normalMatrix, normalMatrix);
+        for (vtkIdType i = 0; i < numSourcePts; ++i)
+          {
+          const double *n = &glyph.Normals[3 * i];
+          float *normal = this->NewNormals + 3 * (offset.Points + i);
+          for (int j = 0; j < 3; ++j)
+            {
+            normal[j] = static_cast<float>(normalMatrix[4 * j] * n[0] +
+              normalMatrix[4 * j + 1] * n[1] + normalMatrix[4 * j + 2] * n[2]);
+            }
+          vtkMath::Normalize(normal);
+          }
+        }
+
+      // Copy all topology (transformation independent)
+      if ( this->Connectivity )
+        {
+        const vtkIdType *srcConn = glyph.Cells->GetPointer();
+        vtkIdType *conn = this->Connectivity + offset.Connectivity;
+        vtkIdType connSize = glyph.Size.Connectivity;
+        for (vtkIdType i = 0; i < connSize; )
+          {
+          vtkIdType npts = srcConn[i];
+          conn[i++] = npts;
+          for (vtkIdType j = 0; j < npts; ++j, ++i)
+            {
+            conn[i] = srcConn[i] + offset.Points;
+            }
+          }
+        }
+
+      // Copy point data from source (if possible)
+      for (vtkIdType i = 0; i < numSourcePts; ++i)
+        {
+        if ( this->PointArrays )
+          {
+          this->PointArrays->Copy(ptId, offset.Points + i);
+          }
+        if ( this->PointIds )
+          {
+          this->PointIds[offset.Points + i] = ptId;
+          }
+        }
+      if ( this->CellArrays )
+        {
+        for (vtkIdType i = 0; i < glyph.Size.Cells; ++i)
+          {
+          this->CellArrays->Copy(ptId, offset.Cells + i);
+          }
+        }
+      }
+  }
+};
+
+struct SelectGlyphSources
+{
+  GlyphWorker *Worker;
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    this->Worker->SelectSources(begin, end);
+  }
+};
+
+struct GenerateGlyphs
+{
+  GlyphWorker *Worker;
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    this->Worker->GenerateGlyphs(begin, end);
+  }
+};
+
+// Read the points, normals and texture coordinates of a glyph, and find
+// the cell array holding all its cells. Returns the index of this cell
+// array among the verts, lines, polys and strips, 4 if the glyph has
+// several kinds of cells, or -1 if it has none.
+int InitializeGlyphSource(GlyphSource &glyph, vtkPolyData *source,
+                          vtkTransform *sourceTransform, bool normals,
+                          bool tcoords)
+{
+  glyph.Source = source;
+  glyph.Size.Points = source->GetNumberOfPoints();
+  glyph.Size.Cells = source->GetNumberOfCells();
+  glyph.Size.Connectivity = 0;
+  glyph.Cells = NULL;
+
+  vtkIdType numPts = glyph.Size.Points;
+  glyph.Points.resize(3 * numPts);
+  if ( sourceTransform && numPts > 0 )
+    {
+    vtkNew<vtkPoints> transformedPts;
+    transformedPts->SetDataTypeToDouble();
+    sourceTransform->TransformPoints(source->GetPoints(),
+                                     transformedPts.GetPointer());
+    std::copy(static_cast<double*>(transformedPts->GetVoidPointer(0)),
+              static_cast<double*>(transformedPts->GetVoidPointer(0)) +
+              3 * numPts, glyph.Points.begin());
+    }
+  else
+    {
+    for (vtkIdType i = 0; i < numPts; ++i)
+      {
+      source->GetPoint(i, &glyph.Points[3 * i]);
+      }
+    }
+  if ( normals )
+    {
+    vtkDataArray *sourceNormals = source->GetPointData()->GetNormals();
+    glyph.Normals.resize(3 * numPts);
+    for (vtkIdType i = 0; i < numPts; ++i)
+      {
+      sourceNormals->GetTuple(i, &glyph.Normals[3 * i]);
+      }
+    }
+  if ( tcoords )
+    {
+    vtkDataArray *sourceTCoords = source->GetPointData()->GetTCoords();
+    int numComps = sourceTCoords->GetNumberOfComponents();
+    glyph.TCoords.resize(numComps * numPts);
+    for (vtkIdType i = 0; i < numPts; ++i)
+      {
+      sourceTCoords->GetTuple(i, &glyph.TCoords[numComps * i]);
+      }
+    }
+
+  vtkCellArray *cellArrays[4] = { source->GetVerts(), source->GetLines(),
+                                  source->GetPolys(), source->GetStrips() };
+  int kind = -1;
+  for (int i = 0; i < 4; ++i)
+    {
+    if ( cellArrays[i]->GetNumberOfCells() > 0 )
+      {
+      kind = kind < 0 ? i : 4;
+      glyph.Cells = cellArrays[i];
+      }
+    }
+  if ( kind >= 0 && kind < 4 )
+    {
+    glyph.Size.Connectivity = glyph.Cells->GetNumberOfConnectivityEntries();
+    }
+  return kind;
+}
+
+}
+
 vtkStandardNewMacro(vtkGlyph3D);
 vtkCxxSetObjectMacro(vtkGlyph3D, SourceTransform, vtkTransform);
 
@@ -142,38 +556,22 @@ bool vtkGlyph3D::Execute(
   vtkDataArray *inNormals, *sourceNormals = NULL;
   vtkDataArray *sourceTCoords = NULL;
   vtkIdType numPts, numSourcePts, numSourceCells, inPtId, i;
-  vtkPoints *sourcePts = NULL;
-  vtkSmartPointer<vtkPoints> transformedSourcePts = vtkSmartPointer<vtkPoints>::New();
   vtkPoints *newPts;
   vtkDataArray *newScalars=NULL;
   vtkDataArray *newVectors=NULL;
   vtkDataArray *newNormals=NULL;
   vtkDataArray *newTCoords = NULL;
-  double x[3], v[3], vNew[3], s = 0.0, vMag = 0.0, value, tc[3];
-  vtkTransform *trans = vtkTransform::New();
-  vtkNew<vtkIdList> pointIdList;
-  vtkIdList *cellPts;
-  int npts;
-  vtkIdList *pts;
-  vtkIdType ptIncr, cellIncr, cellId;
   int haveVectors, haveNormals, haveTCoords = 0;
-  double scalex,scaley,scalez, den;
+  double den;
   vtkPointData* outputPD = output->GetPointData();
   vtkCellData* outputCD = output->GetCellData();
   int numberOfSources = this->GetNumberOfInputConnections(1);
   vtkPolyData *defaultSource = NULL;
   vtkIdTypeArray *pointIds=0;
   vtkPolyData *source = this->GetSource(0, sourceVector);
-  vtkNew<vtkIdList> srcPointIdList;
-  vtkNew<vtkIdList> dstPointIdList;
-  vtkNew<vtkIdList> srcCellIdList;
-  vtkNew<vtkIdList> dstCellIdList;
 
   vtkDebugMacro(<<"Generating glyphs");
 
-  pts = vtkIdList::New();
-  pts->Allocate(VTK_CELL_SIZE);
-
   pd = input->GetPointData();
   inNormals = this->GetInputArrayToProcess(2, input);
   inCScalars = this->GetInputArrayToProcess(3, input);
@@ -202,8 +600,6 @@ bool vtkGlyph3D::Execute(
   if (numPts < 1)
     {
     vtkDebugMacro(<<"No points to glyph!");
-    pts->Delete();
-    trans->Delete();
     return 1;
     }
 
@@ -232,8 +628,6 @@ bool vtkGlyph3D::Execute(
     if ( !source )
       {
       vtkErrorMacro(<<"Indexing on but don't have data to index with");
-      pts->Delete();
-      trans->Delete();
       return true;
       }
     else
@@ -243,6 +637,17 @@ bool vtkGlyph3D::Execute(
       }
     }
 
+  vtkDataArray *array3D = NULL;
+  if ( haveVectors )
+    {
+    array3D = this->VectorMode == VTK_USE_NORMAL? inNormals : inVectors;
+    if(array3D->GetNumberOfComponents()>3)
+      {
+      vtkErrorMacro(<<"vtkDataArray "<<array3D->GetName()<<" has more than 3 components.\n");
+      return false;
+      }
+    }
+
   // Allocate storage for output PolyData
   //
   outputPD->CopyVectorsOff();
@@ -295,9 +700,7 @@ bool vtkGlyph3D::Execute(
     }
   else
     {
-    sourcePts = source->GetPoints();
-    numSourcePts = sourcePts->GetNumberOfPoints();
-    numSourceCells = source->GetNumberOfCells();
+    numberOfSources = 1;
 
     sourceNormals = source->GetPointData()->GetNormals();
     if ( sourceNormals )
@@ -321,25 +724,101 @@ bool vtkGlyph3D::Execute(
 
     // Prepare to copy output.
     pd = input->GetPointData();
-    outputPD->CopyAllocate(pd,numPts*numSourcePts);
-    if (this->FillCellData)
+    }
+
+  // Read the glyphs of the table. Their cells can be written in parallel
+  // if they all are in the same cell array of the output.
+  GlyphWorker worker;
+  worker.Sources.resize(numberOfSources);
+  int cellArrayIndex = -1;
+  for (i = 0; i < numberOfSources; i++)
+    {
+    GlyphSource &glyph = worker.Sources[i];
+    glyph.Source = this->IndexMode != VTK_INDEXING_OFF ?
+      this->GetSource(i, sourceVector) : source;
+    if ( glyph.Source )
       {
-      outputCD->CopyAllocate(pd,numPts*numSourceCells);
+      int kind = InitializeGlyphSource(glyph, glyph.Source,
+                                       this->SourceTransform,
+                                       haveNormals != 0, haveTCoords != 0);
+      if ( kind >= 0 )
+        {
+        cellArrayIndex = cellArrayIndex < 0 || cellArrayIndex == kind ?
+          kind : 4;
+        }
       }
     }
 
-  srcPointIdList->SetNumberOfIds(numSourcePts);
-  dstPointIdList->SetNumberOfIds(numSourcePts);
-  srcCellIdList->SetNumberOfIds(numSourceCells);
-  dstCellIdList->SetNumberOfIds(numSourceCells);
+  // Select the glyph of each input point. Points are hidden serially, in
+  // order, in case a subclass overrides IsPointVisible().
+  worker.Input = input;
+  worker.InSScalars = inSScalars;
+  worker.InVectors = array3D;
+  worker.InCScalars = inCScalars;
+  worker.InGhostLevels = inGhostLevels;
+  worker.ScaleMode = this->ScaleMode;
+  worker.ColorMode = this->ColorMode;
+  worker.IndexMode = this->IndexMode;
+  worker.Scaling = this->Scaling;
+  worker.Clamping = this->Clamping;
+  worker.Orient = this->Orient;
+  worker.ScaleFactor = this->ScaleFactor;
+  worker.Range[0] = this->Range[0];
+  worker.Range[1] = this->Range[1];
+  worker.Den = den;
+  worker.SourceIds.resize(numPts);
+  SelectGlyphSources selectSources = { &worker };
+  vtkSMPTools::For(0, numPts, selectSources);
+
+  GlyphSize zero = { 0, 0, 0 };
+  worker.Offsets.resize(numPts);
+  for (inPtId=0; inPtId < numPts; inPtId++)
+    {
+    int &sourceId = worker.SourceIds[inPtId];
+    if ( sourceId >= 0 &&
+         ((inputUG && !inputUG->IsPointVisible(inPtId)) ||
+          !this->IsPointVisible(input, inPtId)) )
+      {
+      sourceId = -1;
+      }
+    worker.Offsets[inPtId] =
+      sourceId >= 0 ? worker.Sources[sourceId].Size : zero;
+    }
+  GlyphSize total = vtkSMPTools::ExclusiveScan(
+    worker.Offsets.begin(), worker.Offsets.end(), worker.Offsets.begin(),
+    zero, AddGlyphSizes());
+  this->UpdateProgress(0.1);
+
+  // Allocate the output now that its size is known. Arrays that cannot be
+  // copied in parallel (e.g. string arrays) require the serial CopyData().
+  numSourcePts = total.Points;
+  numSourceCells = total.Cells;
+  ArrayList pointArrays;
+  ArrayList cellArrays;
+  bool parallelPD = true;
+  bool parallelCD = true;
+  if ( pd )
+    {
+    outputPD->CopyAllocate(pd, numSourcePts);
+    pointArrays.AddArrays(numSourcePts, pd, outputPD, 0.0, false);
+    parallelPD = static_cast<int>(pointArrays.Arrays.size()) ==
+      outputPD->GetNumberOfArrays();
+    if (this->FillCellData)
+      {
+      outputCD->CopyAllocate(pd, numSourceCells);
+      cellArrays.AddArrays(numSourceCells, pd, outputCD, 0.0, false);
+      parallelCD = static_cast<int>(cellArrays.Arrays.size()) ==
+        outputCD->GetNumberOfArrays();
+      }
+    }
 
   newPts = vtkPoints::New();
-  newPts->Allocate(numPts*numSourcePts);
+  newPts->SetNumberOfPoints(numSourcePts);
   if ( this->GeneratePointIds )
     {
     pointIds = vtkIdTypeArray::New();
     pointIds->SetName(this->PointIdsName);
-    pointIds->Allocate(numPts*numSourcePts);
+    pointIds->SetNumberOfValues(numSourcePts);
     outputPD->AddArray(pointIds);
     pointIds->Delete();
     }
@@ -347,13 +826,13 @@ bool vtkGlyph3D::Execute(
     {
     newScalars = inCScalars->NewInstance();
     newScalars->SetNumberOfComponents(inCScalars->GetNumberOfComponents());
-    newScalars->Allocate(inCScalars->GetNumberOfComponents()*numPts*numSourcePts);
+    newScalars->SetNumberOfTuples(numSourcePts);
     newScalars->SetName(inCScalars->GetName());
     }
   else if ( (this->ColorMode == VTK_COLOR_BY_SCALE) && inSScalars)
     {
     newScalars = vtkFloatArray::New();
-    newScalars->Allocate(numPts*numSourcePts);
+    newScalars->SetNumberOfTuples(numSourcePts);
     newScalars->SetName("GlyphScale");
     if (this->ScaleMode == VTK_SCALE_BY_SCALAR)
       {
@@ -363,21 +842,21 @@ bool vtkGlyph3D::Execute(
   else if ( (this->ColorMode == VTK_COLOR_BY_VECTOR) && haveVectors)
     {
     newScalars = vtkFloatArray::New();
-    newScalars->Allocate(numPts*numSourcePts);
+    newScalars->SetNumberOfTuples(numSourcePts);
     newScalars->SetName("VectorMagnitude");
     }
   if ( haveVectors )
     {
     newVectors = vtkFloatArray::New();
     newVectors->SetNumberOfComponents(3);
-    newVectors->Allocate(3*numPts*numSourcePts);
+    newVectors->SetNumberOfTuples(numSourcePts);
     newVectors->SetName("GlyphVector");
     }
   if ( haveNormals )
     {
     newNormals = vtkFloatArray::New();
     newNormals->SetNumberOfComponents(3);
-    newNormals->Allocate(3*numPts*numSourcePts);
+    newNormals->SetNumberOfTuples(numSourcePts);
     newNormals->SetName("Normals");
     }
   if (haveTCoords)
@@ -385,314 +864,127 @@ bool vtkGlyph3D::Execute(
     newTCoords = vtkFloatArray::New();
     int numComps = sourceTCoords->GetNumberOfComponents();
     newTCoords->SetNumberOfComponents(numComps);
-    newTCoords->Allocate(numComps*numPts*numSourcePts);
+    newTCoords->SetNumberOfTuples(numSourcePts);
     newTCoords->SetName("TCoords");
     }
+  vtkIdTypeArray *newConnectivity = NULL;
+  if ( cellArrayIndex >= 0 && cellArrayIndex < 4 )
+    {
+    newConnectivity = vtkIdTypeArray::New();
+    newConnectivity->SetNumberOfValues(total.Connectivity);
+    }
 
-  // Setting up for calls to PolyData::InsertNextCell()
-  if (this->IndexMode != VTK_INDEXING_OFF )
+  // Traverse all Input points, transforming Source points and copying
+  // point attributes.
+  //
+  worker.NewPoints = static_cast<float*>(newPts->GetVoidPointer(0));
+  worker.NewNormals = newNormals ?
+    static_cast<vtkFloatArray*>(newNormals)->GetPointer(0) : NULL;
+  worker.NewVectors = newVectors ?
+    static_cast<vtkFloatArray*>(newVectors)->GetPointer(0) : NULL;
+  worker.NewTCoords = newTCoords ?
+    static_cast<vtkFloatArray*>(newTCoords)->GetPointer(0) : NULL;
+  worker.NumberOfTCoordComponents =
+    newTCoords ? newTCoords->GetNumberOfComponents() : 0;
+  worker.NewScalars = newScalars && this->ColorMode != VTK_COLOR_BY_SCALAR ?
+    static_cast<vtkFloatArray*>(newScalars)->GetPointer(0) : NULL;
+  worker.NewColorScalars =
+    this->ColorMode == VTK_COLOR_BY_SCALAR ? newScalars : NULL;
+  worker.PointIds = pointIds ? pointIds->GetPointer(0) : NULL;
+  worker.Connectivity =
+    newConnectivity ? newConnectivity->GetPointer(0) : NULL;
+  worker.PointArrays = pd && parallelPD ? &pointArrays : NULL;
+  worker.CellArrays =
+    pd && this->FillCellData && parallelCD ? &cellArrays : NULL;
+  GenerateGlyphs generateGlyphs = { &worker };
+  if ( newScalars && newScalars->GetDataType() == VTK_BIT )
     {
-    output->Allocate(3*numPts*numSourceCells,numPts*numSourceCells);
+    // Bits share their bytes with the neighbouring values.
+    generateGlyphs(0, numPts);
     }
   else
     {
-    output->Allocate(source,
-                     3*numPts*numSourceCells, numPts*numSourceCells);
+    vtkSMPTools::For(0, numPts, generateGlyphs);
     }
+  this->UpdateProgress(0.8);
 
-  transformedSourcePts->SetDataTypeToDouble();
-  transformedSourcePts->Allocate(numSourcePts);
-
-  // Traverse all Input points, transforming Source points and copying
-  // point attributes.
-  //
-  ptIncr=0;
-  cellIncr=0;
+  // Serially copy what could not be written in parallel.
   for (inPtId=0; inPtId < numPts; inPtId++)
     {
-    scalex = scaley = scalez = 1.0;
-    if ( ! (inPtId % 10000) )
-      {
-      this->UpdateProgress(static_cast<double>(inPtId)/numPts);
-      if (this->GetAbortExecute())
-        {
-        break;
-        }
-      }
-
-    // Get the scalar and vector data
-    if ( inSScalars )
-      {
-      s = inSScalars->GetComponent(inPtId, 0);
-      if ( this->ScaleMode == VTK_SCALE_BY_SCALAR ||
-           this->ScaleMode == VTK_DATA_SCALING_OFF )
-        {
-        scalex = scaley = scalez = s;
-        }
-      }
-
-    if ( haveVectors )
-      {
-      vtkDataArray *array3D = this->VectorMode == VTK_USE_NORMAL? inNormals : inVectors;
-      if(array3D->GetNumberOfComponents()>3)
-        {
-        vtkErrorMacro(<<"vtkDataArray "<<array3D->GetName()<<" has more than 3 components.\n");
-        pts->Delete();
-        trans->Delete();
-        if(newPts)
-          {
-          newPts->Delete();
-          }
-        if(newVectors)
-          {
-          newVectors->Delete();
-          }
-        return false;
-        }
-
-      v[0] = 0;
-      v[1] = 0;
-      v[2] = 0;
-      array3D->GetTuple(inPtId, v);
-      vMag = vtkMath::Norm(v);
-      if ( this->ScaleMode == VTK_SCALE_BY_VECTORCOMPONENTS )
-        {
-        scalex = v[0];
-        scaley = v[1];
-        scalez = v[2];
-        }
-      else if ( this->ScaleMode == VTK_SCALE_BY_VECTOR )
-        {
-        scalex = scaley = scalez = vMag;
-        }
-      }
-
-    // Clamp data scale if enabled
-    if ( this->Clamping )
-      {
-      scalex = (scalex < this->Range[0] ? this->Range[0] :
-                (scalex > this->Range[1] ? this->Range[1] : scalex));
-      scalex = (scalex - this->Range[0]) / den;
-      scaley = (scaley < this->Range[0] ? this->Range[0] :
-                (scaley > this->Range[1] ? this->Range[1] : scaley));
-      scaley = (scaley - this->Range[0]) / den;
-      scalez = (scalez < this->Range[0] ? this->Range[0] :
-                (scalez > this->Range[1] ? this->Range[1] : scalez));
-      scalez = (scalez - this->Range[0]) / den;
-      }
-
-    // Compute index into table of glyphs
-    if ( this->IndexMode != VTK_INDEXING_OFF )
-      {
-      if ( this->IndexMode == VTK_INDEXING_BY_SCALAR )
-        {
-        value = s;
-        }
-      else
-        {
-        value = vMag;
-        }
-
-      int index = static_cast<int>((value - this->Range[0])*numberOfSources / den);
-      index = (index < 0 ? 0 :
-              (index >= numberOfSources ? (numberOfSources-1) : index));
-
-      source = this->GetSource(index, sourceVector);
-      if ( source != NULL )
-        {
-        sourcePts = source->GetPoints();
-        sourceNormals = source->GetPointData()->GetNormals();
-        numSourcePts = sourcePts->GetNumberOfPoints();
-        numSourceCells = source->GetNumberOfCells();
-        }
-      }
-
-    // Make sure we're not indexing into empty glyph
-    if ( !source )
-      {
-      continue;
-      }
-
-    // Check ghost points.
-    // If we are processing a piece, we do not want to duplicate
-    // glyphs on the borders.
-    if (inGhostLevels &&
-        inGhostLevels[inPtId] & vtkDataSetAttributes::DUPLICATEPOINT)
-      {
-      continue;
-      }
-
-    if (inputUG && !inputUG->IsPointVisible(inPtId))
+    if ( worker.SourceIds[inPtId] < 0 )
       {
-      // input is a vtkUniformGrid and the current point is blanked. Don't glyph
-      // it.
       continue;
       }
-
-    if (!this->IsPointVisible(input, inPtId))
-      {
-      continue;
-      }
-
-    // Now begin copying/transforming glyph
-    trans->Identity();
-
-    // Copy all topology (transformation independent)
-    for (cellId=0; cellId < numSourceCells; cellId++)
-      {
-      source->GetCellPoints(cellId, pointIdList.GetPointer());
-      cellPts = pointIdList.GetPointer();
-      npts = cellPts->GetNumberOfIds();
-      for (pts->Reset(), i=0; i < npts; i++)
-        {
-        pts->InsertId(i, cellPts->GetId(i) + ptIncr);
-        }
-      output->InsertNextCell(source->GetCellType(cellId), pts);
-      }
-
-    // translate Source to Input point
-    input->GetPoint(inPtId, x);
-    trans->Translate(x[0], x[1], x[2]);
-
-    if ( haveVectors )
-      {
-      // Copy Input vector
-      for (i=0; i < numSourcePts; i++)
-        {
-        newVectors->InsertTuple(i+ptIncr, v);
-        }
-      if (this->Orient && (vMag > 0.0))
-        {
-        // if there is no y or z component
-        if ( v[1] == 0.0 && v[2] == 0.0 )
-          {
-          if (v[0] < 0) //just flip x if we need to
-            {
-            trans->RotateWXYZ(180.0,0,1,0);
-            }
-          }
-        else
-          {
-          vNew[0] = (v[0]+vMag) / 2.0;
-          vNew[1] = v[1] / 2.0;
-          vNew[2] = v[2] / 2.0;
-          trans->RotateWXYZ(180.0,vNew[0],vNew[1],vNew[2]);
-          }
-        }
-      }
-
-    if (haveTCoords)
-      {
-      for (i = 0; i < numSourcePts; i++)
-        {
-        sourceTCoords->GetTuple(i, tc);
-        newTCoords->InsertTuple(i+ptIncr, tc);
-        }
-      }
-
-    // determine scale factor from scalars if appropriate
-    // Copy scalar value
-    if (inSScalars && (this->ColorMode == VTK_COLOR_BY_SCALE))
+    const GlyphSize &glyphSize = worker.Sources[worker.SourceIds[inPtId]].Size;
+    const GlyphSize &offset = worker.Offsets[inPtId];
+    if ( pd && !parallelPD )
       {
-      for (i=0; i < numSourcePts; i++)
+      for (i = 0; i < glyphSize.Points; ++i)
         {
-        newScalars->InsertTuple(i+ptIncr, &scalex); // = scaley = scalez
+        outputPD->CopyData(pd, inPtId, offset.Points + i);
         }
       }
-    else if (inCScalars && (this->ColorMode == VTK_COLOR_BY_SCALAR))
+    if ( pd && this->FillCellData && !parallelCD )
       {
-      for (i=0; i < numSourcePts; i++)
+      for (i = 0; i < glyphSize.Cells; ++i)
         {
-        outputPD->CopyTuple(inCScalars, newScalars, inPtId, ptIncr+i);
-        }
-      }
-    if (haveVectors && this->ColorMode == VTK_COLOR_BY_VECTOR)
-      {
-      for (i=0; i < numSourcePts; i++)
-        {
-        newScalars->InsertTuple(i+ptIncr, &vMag);
+        outputCD->CopyData(pd, inPtId, offset.Cells + i);
         }
       }
+    }
 
-    // scale data if appropriate
-    if ( this->Scaling )
+  if ( newConnectivity )
+    {
+    vtkCellArray *newCells = vtkCellArray::New();
+    newCells->SetCells(numSourceCells, newConnectivity);
+    newConnectivity->Delete();
+    switch (cellArrayIndex)
       {
-      if ( this->ScaleMode == VTK_DATA_SCALING_OFF )
-        {
-        scalex = scaley = scalez = this->ScaleFactor;
-        }
-      else
-        {
-        scalex *= this->ScaleFactor;
-        scaley *= this->ScaleFactor;
-        scalez *= this->ScaleFactor;
-        }
-
-      if ( scalex == 0.0 )
-        {
-        scalex = 1.0e-10;
-        }
-      if ( scaley == 0.0 )
-        {
-        scaley = 1.0e-10;
-        }
-      if ( scalez == 0.0 )
-        {
-        scalez = 1.0e-10;
-        }
-      trans->Scale(scalex,scaley,scalez);
+      case 0:
+        output->SetVerts(newCells);
+        break;
+      case 1:
+        output->SetLines(newCells);
+        break;
+      case 2:
+        output->SetPolys(newCells);
+        break;
+      default:
+        output->SetStrips(newCells);
       }
-
-    // multiply points and normals by resulting matrix
-    if (this->SourceTransform)
+    newCells->Delete();
+    }
+  else if ( cellArrayIndex == 4 )
+    {
+    // The glyphs mix several kinds of cells, whose ids are given by the
+    // order of insertion.
+    if (this->IndexMode != VTK_INDEXING_OFF )
       {
-      transformedSourcePts->Reset();
-      this->SourceTransform->TransformPoints(sourcePts, transformedSourcePts);
-      trans->TransformPoints(transformedSourcePts, newPts);
+      output->Allocate(3*numSourceCells,numSourceCells);
       }
     else
       {
-      trans->TransformPoints(sourcePts,newPts);
-      }
-
-    if ( haveNormals )
-      {
-      trans->TransformNormals(sourceNormals,newNormals);
+      output->Allocate(source,3*numSourceCells,numSourceCells);
       }
-
-    // Copy point data from source (if possible)
-    if ( pd )
+    vtkNew<vtkIdList> pts;
+    for (inPtId=0; inPtId < numPts; inPtId++)
       {
-      for (i = 0; i < numSourcePts; ++i)
+      if ( worker.SourceIds[inPtId] < 0 )
         {
-        srcPointIdList->SetId(i, inPtId);
-        dstPointIdList->SetId(i, ptIncr + i);
+        continue;
         }
-      outputPD->CopyData(pd, srcPointIdList.GetPointer(),
-                         dstPointIdList.GetPointer());
-      if (this->FillCellData)
+      vtkPolyData *glyph = worker.Sources[worker.SourceIds[inPtId]].Source;
+      vtkIdType ptIncr = worker.Offsets[inPtId].Points;
+      for (vtkIdType cellId=0; cellId < glyph->GetNumberOfCells(); cellId++)
         {
-        for (i = 0; i < numSourceCells; ++i)
+        glyph->GetCellPoints(cellId, pts.GetPointer());
+        for (i=0; i < pts->GetNumberOfIds(); i++)
           {
-          srcCellIdList->SetId(i, inPtId);
-          dstCellIdList->SetId(i, cellIncr + i);
+          pts->SetId(i, pts->GetId(i) + ptIncr);
           }
-        outputCD->CopyData(pd, srcCellIdList.GetPointer(),
-                           dstCellIdList.GetPointer());
+        output->InsertNextCell(glyph->GetCellType(cellId), pts.GetPointer());
         }
       }
-
-    // If point ids are to be generated, do it here
-    if ( this->GeneratePointIds )
-      {
-      for (i=0; i < numSourcePts; i++)
-        {
-        pointIds->InsertNextValue(inPtId);
-        }
-      }
-
-    ptIncr += numSourcePts;
-    cellIncr += numSourceCells;
     }
 
   // Update ourselves and release memory
@@ -726,8 +1018,6 @@ bool vtkGlyph3D::Execute(
     }
 
   output->Squeeze();
-  trans->Delete();
-  pts->Delete();
 
   return true;
 }
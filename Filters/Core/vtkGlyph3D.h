@@ -65,6 +65,12 @@
 // color scalars by using the SetInputArrayToProcess methods in
 // vtkAlgorithm. The first array is scalars, the next vectors, the next
 // normals and finally color scalars.
+//
+// The glyphs are generated in parallel with vtkSMPTools. The glyph of each
+// input point is selected first, then each glyph is written at the offsets
+// given by the sizes of the glyphs before it, so the output does not depend
+// on the number of threads. IsPointVisible() is called serially, in the
+// order of the input points.
 
 // .SECTION See Also
 // vtkTensorGlyph
@@ -17,16 +17,30 @@
 #include <algorithm>
 #include <cassert>
 #include <limits>
+#include <utility>
 #include <vector>
 
+#include "vtkArrayDispatch.h"
 #include "vtkCellData.h"
 #include "vtkDataArray.h"
+#include "vtkDataArrayAccessor.h"
 #include "vtkDataSet.h"
 #include "vtkIdList.h"
+#include "vtkImageData.h"
 #include "vtkInformation.h"
 #include "vtkInformationVector.h"
+#include "vtkMath.h"
+#include "vtkNew.h"
 #include "vtkObjectFactory.h"
 #include "vtkPointData.h"
+#include "vtkPolyData.h"
+#include "vtkRectilinearGrid.h"
+#include "vtkSMPThreadLocal.h"
+#include "vtkSMPThreadLocalObject.h"
+#include "vtkSMPTools.h"
+#include "vtkStructuredData.h"
+#include "vtkStructuredGrid.h"
+#include "vtkUnstructuredGrid.h"
 
 #define VTK_EPSILON 1.e-6
 
@@ -57,7 +71,7 @@ public:
   typedef std::vector<Bin> HistogramBins;
   typedef HistogramBins::iterator BinIt;
 
-  Histogram(vtkIdType size)
+  Histogram(vtkIdType size = 0)
   {
     // Construct the array of bins.
     this->Bins.assign(size + 1, this->Init);
@@ -148,6 +162,283 @@ vtkIdType Histogram::IndexOfLargestBin()
   return std::max_element(this->Bins.begin(), it2, BinCountCmp)->Index;
 }
 
+//----------------------------------------------------------------------------
+// The cell data is computed in parallel over the cells. Each cell gathers the
+// values of its points for all the arrays at once, so no two threads ever
+// write the same output tuple.
+
+// Maps one point data array to one cell data array. The values are averaged
+// in double precision with equal weights and rounded, as
+// vtkDataArray::InterpolateTuple() does, or copied from a single point.
+class ArrayAverager
+{
+public:
+  virtual ~ArrayAverager() {}
+  virtual void Average(vtkIdType cellId, vtkIdType numPts,
+                       const vtkIdType *ptIds) = 0;
+  virtual void Copy(vtkIdType ptId, vtkIdType cellId) = 0;
+};
+
+template <typename InArrayT, typename OutArrayT>
+class TypedArrayAverager : public ArrayAverager
+{
+public:
+  TypedArrayAverager(InArrayT *input, OutArrayT *output) :
+    Input(input), Output(output),
+    NumberOfComponents(input->GetNumberOfComponents())
+    {
+    }
+
+  virtual void Average(vtkIdType cellId, vtkIdType numPts,
+                       const vtkIdType *ptIds)
+    {
+    typedef typename vtkDataArrayAccessor<OutArrayT>::APIType OutValueT;
+    vtkDataArrayAccessor<InArrayT> input(this->Input);
+    vtkDataArrayAccessor<OutArrayT> output(this->Output);
+
+    double weight = (numPts > 0 ? 1.0 / numPts : 0.0);
+    for (int c = 0; c < this->NumberOfComponents; ++c)
+      {
+      double val = 0.0;
+      for (vtkIdType i = 0; i < numPts; ++i)
+        {
+        val += weight * static_cast<double>(input.Get(ptIds[i], c));
+        }
+      OutValueT valT;
+      vtkMath::RoundDoubleToIntegralIfNecessary(val, &valT);
+      output.Set(cellId, c, valT);
+      }
+    }
+
+  virtual void Copy(vtkIdType ptId, vtkIdType cellId)
+    {
+    typedef typename vtkDataArrayAccessor<OutArrayT>::APIType OutValueT;
+    vtkDataArrayAccessor<InArrayT> input(this->Input);
+    vtkDataArrayAccessor<OutArrayT> output(this->Output);
+    for (int c = 0; c < this->NumberOfComponents; ++c)
+      {
+      output.Set(cellId, c, static_cast<OutValueT>(input.Get(ptId, c)));
+      }
+    }
+
+private:
+  InArrayT *Input;
+  OutArrayT *Output;
+  int NumberOfComponents;
+};
+
+struct AddAveragerWorker
+{
+  std::vector<ArrayAverager*> *Averagers;
+
+  template <typename InArrayT, typename OutArrayT>
+  void operator()(InArrayT *input, OutArrayT *output)
+    {
+    this->Averagers->push_back(
+      new TypedArrayAverager<InArrayT, OutArrayT>(input, output));
+    }
+};
+
+// The pairs of arrays to process. Those the dispatcher does not handle
+// (e.g. bit or string arrays) are processed serially, through
+// vtkAbstractArray::InterpolateTuple() and InsertTuple().
+struct ArrayAveragers
+{
+  typedef std::pair<vtkAbstractArray*, vtkAbstractArray*> ArrayPair;
+
+  std::vector<ArrayAverager*> Averagers;
+  std::vector<ArrayPair> Others;
+
+  ~ArrayAveragers()
+    {
+    for (size_t i = 0; i < this->Averagers.size(); ++i)
+      {
+      delete this->Averagers[i];
+      }
+    }
+
+  // Size the output arrays of a field list built from a single point data
+  // and add them.
+  void AddFields(vtkDataSetAttributes::FieldList &fields,
+                 vtkPointData *inPD, vtkCellData *outCD, vtkIdType numCells)
+    {
+    for (int fid = 0; fid < fields.GetNumberOfFields(); ++fid)
+      {
+      int const dstid = fields.GetFieldIndex(fid);
+      int const srcid = fields.GetDSAIndex(0, fid);
+      if (srcid < 0 || dstid < 0)
+        {
+        continue;
+        }
+      vtkAbstractArray *input = inPD->GetAbstractArray(srcid);
+      vtkAbstractArray *output = outCD->GetAbstractArray(dstid);
+      output->SetNumberOfTuples(numCells);
+
+      vtkDataArray *inDA = vtkDataArray::FastDownCast(input);
+      vtkDataArray *outDA = vtkDataArray::FastDownCast(output);
+      AddAveragerWorker worker;
+      worker.Averagers = &this->Averagers;
+      if (!inDA || !outDA || inDA->GetDataType() == VTK_BIT ||
+          !vtkArrayDispatch::Dispatch2SameValueType::Execute(inDA, outDA,
+                                                             worker))
+        {
+        this->Others.push_back(ArrayPair(input, output));
+        }
+      }
+    }
+};
+
+// Provides the points of the cells. Unless the dataset is polydata, an
+// unstructured grid or a structured dataset, it is only safe to use from
+// one thread.
+class CellPoints
+{
+public:
+  CellPoints(vtkDataSet *ds) : DataSet(ds), PolyData(NULL), Grid(NULL),
+    Structured(false), Hexahedra(false), DataDescription(0)
+    {
+    this->Dimensions[0] = this->Dimensions[1] = this->Dimensions[2] = 0;
+    if ((this->PolyData = vtkPolyData::SafeDownCast(ds)))
+      {
+      if (this->PolyData->NeedToBuildCells())
+        {
+        this->PolyData->BuildCells();
+        }
+      }
+    else if (!(this->Grid = vtkUnstructuredGrid::SafeDownCast(ds)))
+      {
+      if (vtkImageData *image = vtkImageData::SafeDownCast(ds))
+        {
+        image->GetDimensions(this->Dimensions);
+        this->Structured = true;
+        }
+      else if (vtkRectilinearGrid *rgrid = vtkRectilinearGrid::SafeDownCast(ds))
+        {
+        rgrid->GetDimensions(this->Dimensions);
+        this->Structured = true;
+        }
+      else if (vtkStructuredGrid *sgrid = vtkStructuredGrid::SafeDownCast(ds))
+        {
+        sgrid->GetDimensions(this->Dimensions);
+        this->Structured = true;
+        this->Hexahedra = true;
+        }
+      this->DataDescription =
+        vtkStructuredData::GetDataDescription(this->Dimensions);
+      }
+    }
+
+  bool IsThreadSafe() const
+    {
+    return this->PolyData || this->Grid || this->Structured;
+    }
+
+  void GetCellPoints(vtkIdType cellId, vtkIdType &npts, const vtkIdType* &pts)
+    {
+    vtkIdType *cellPts;
+    if (this->PolyData)
+      {
+      this->PolyData->GetCellPoints(cellId, npts, cellPts);
+      pts = cellPts;
+      return;
+      }
+    if (this->Grid)
+      {
+      this->Grid->GetCellPoints(cellId, npts, cellPts);
+      pts = cellPts;
+      return;
+      }
+    vtkIdList *ptIds = this->PointIds.Local();
+    if (this->Structured)
+      {
+      vtkStructuredData::GetCellPoints(cellId, ptIds, this->DataDescription,
+                                       this->Dimensions);
+      // vtkStructuredGrid orders the points of its cells as quads and
+      // hexahedra, not as pixels and voxels.
+      if (this->Hexahedra && ptIds->GetNumberOfIds() >= 4)
+        {
+        vtkIdType *ids = ptIds->GetPointer(0);
+        std::swap(ids[2], ids[3]);
+        if (ptIds->GetNumberOfIds() == 8)
+          {
+          std::swap(ids[6], ids[7]);
+          }
+        }
+      }
+    else
+      {
+      this->DataSet->GetCellPoints(cellId, ptIds);
+      }
+    npts = ptIds->GetNumberOfIds();
+    pts = ptIds->GetPointer(0);
+    }
+
+private:
+  vtkDataSet *DataSet;
+  vtkPolyData *PolyData;
+  vtkUnstructuredGrid *Grid;
+  bool Structured;
+  bool Hexahedra;
+  int Dimensions[3];
+  int DataDescription;
+  vtkSMPThreadLocalObject<vtkIdList> PointIds;
+};
+
+// Averages the point data over each cell or, for categorical data, copies
+// it from the point whose scalar value is the most frequent in the cell.
+struct PointToCellFunctor
+{
+  CellPoints &Cells;
+  std::vector<ArrayAverager*> &Averagers;
+  vtkDataArray *Categories;
+  vtkIdType *ChosenPoints;
+  vtkSMPThreadLocal<Histogram> Histograms;
+
+  PointToCellFunctor(CellPoints &cells, std::vector<ArrayAverager*> &averagers,
+                     vtkDataArray *categories, vtkIdType *chosenPoints,
+                     int maxCellSize) :
+    Cells(cells), Averagers(averagers), Categories(categories),
+    ChosenPoints(chosenPoints), Histograms(Histogram(maxCellSize))
+    {
+    }
+
+  void operator()(vtkIdType cellId, vtkIdType endCellId)
+    {
+    Histogram &hist = this->Histograms.Local();
+    vtkIdType npts;
+    const vtkIdType *pts;
+    for ( ; cellId < endCellId; ++cellId)
+      {
+      this->Cells.GetCellPoints(cellId, npts, pts);
+
+      // If we aren't dealing with categorical data, or the cell has no
+      // points, then we simply give each point an equal weight.
+      if (!this->Categories || npts == 0)
+        {
+        for (size_t i = 0; i < this->Averagers.size(); ++i)
+          {
+          this->Averagers[i]->Average(cellId, npts, pts);
+          }
+        continue;
+        }
+
+      // ...otherwise, we populate a histogram from the scalar values at each
+      // point, and then select the bin with the most elements.
+      hist.Reset(npts);
+      for (vtkIdType i = 0; i < npts; ++i)
+        {
+        hist.Fill(pts[i], this->Categories->GetComponent(pts[i], 0));
+        }
+      vtkIdType ptId = hist.IndexOfLargestBin();
+      this->ChosenPoints[cellId] = ptId;
+      for (size_t i = 0; i < this->Averagers.size(); ++i)
+        {
+        this->Averagers[i]->Copy(ptId, cellId);
+        }
+      }
+    }
+};
+
 }
 
 
@@ -175,14 +466,10 @@ int vtkPointDataToCellData::RequestData(
   vtkDataSet *input = vtkDataSet::SafeDownCast(
     inInfo->Get(vtkDataObject::DATA_OBJECT()));
 
-  vtkIdType cellId, ptId, pointId;
-  vtkIdType numCells, numPts;
+  vtkIdType numCells;
   vtkPointData *inPD=input->GetPointData();
   vtkCellData *outCD=output->GetCellData();
   int maxCellSize=input->GetMaxCellSize();
-  vtkIdList *cellPts;
-  double weight;
-  double *weights;
 
   vtkDebugMacro(<<"Mapping point data to cell data");
 
@@ -194,10 +481,8 @@ int vtkPointDataToCellData::RequestData(
     vtkDebugMacro(<<"No input cells!");
     return 1;
     }
-  weights=new double[maxCellSize];
-
-  Histogram hist(maxCellSize);
 
+  vtkDataArray *categories = NULL;
   if (this->CategoricalData == 1)
     {
     // If the categorical data flag is enabled, then a) there must be scalars
@@ -205,20 +490,16 @@ int vtkPointDataToCellData::RequestData(
     if (!input->GetPointData()->GetScalars())
       {
       vtkDebugMacro(<<"No input scalars!");
-      delete [] weights;
       return 1;
       }
     if (input->GetPointData()->GetScalars()->GetNumberOfComponents() != 1)
       {
       vtkDebugMacro(<<"Input scalars have more than one component! Cannot categorize!");
-      delete [] weights;
       return 1;
       }
+    categories = input->GetPointData()->GetScalars();
     }
 
-  cellPts = vtkIdList::New();
-  cellPts->Allocate(maxCellSize);
-
   // Pass the cell data first. The fields and attributes
   // which also exist in the point data of the input will
   // be over-written during CopyAllocate
@@ -228,51 +509,63 @@ int vtkPointDataToCellData::RequestData(
 
   // notice that inPD and outCD are vtkPointData and vtkCellData; respectively.
   // It's weird, but it works.
-  outCD->InterpolateAllocate(inPD,numCells);
-
-  int abort=0;
-  vtkIdType progressInterval=numCells/20 + 1;
-  for (cellId=0; cellId < numCells && !abort; cellId++)
+  vtkDataSetAttributes::FieldList fields(1);
+  fields.InitializeFieldList(inPD);
+  outCD->InterpolateAllocate(fields, numCells, numCells);
+
+  ArrayAveragers arrays;
+  arrays.AddFields(fields, inPD, outCD, numCells);
+
+  // The point chosen for each cell, when copying categorical data.
+  std::vector<vtkIdType> chosenPoints(categories ? numCells : 0);
+
+  CellPoints cells(input);
+  PointToCellFunctor pointToCell(cells, arrays.Averagers, categories,
+    categories ? &chosenPoints[0] : NULL, maxCellSize);
+  vtkIdType batchSize = numCells / 10 + 1;
+  int abort = 0;
+  for (vtkIdType cellId = 0; cellId < numCells && !abort; cellId += batchSize)
     {
-    if ( !(cellId % progressInterval) )
+    this->UpdateProgress(static_cast<double>(cellId) / numCells);
+    abort = this->GetAbortExecute();
+    vtkIdType endCellId = std::min(cellId + batchSize, numCells);
+    if (cells.IsThreadSafe())
       {
-      this->UpdateProgress((double)cellId/numCells);
-      abort = GetAbortExecute();
+      vtkSMPTools::For(cellId, endCellId, pointToCell);
       }
-
-    input->GetCellPoints(cellId, cellPts);
-    numPts = cellPts->GetNumberOfIds();
-
-    if (numPts == 0)
+    else
       {
-      continue;
+      pointToCell(cellId, endCellId);
       }
+    }
 
-    // If we aren't dealing with categorical data...
-    if (!(this->CategoricalData))
-      {
-      // ...then we simply provide each point with an equal weight value and
-      // interpolate.
-      weight = 1.0 / numPts;
-      for (ptId=0; ptId < numPts; ptId++)
-        {
-        weights[ptId] = weight;
-        }
-      outCD->InterpolatePoint(inPD, cellId, cellPts, weights);
-      }
-    else
+  // The arrays that cannot be processed in parallel
+  if (!arrays.Others.empty())
+    {
+    vtkNew<vtkIdList> cellPts;
+    std::vector<double> weights;
+    for (vtkIdType cellId = 0; cellId < numCells && !abort; ++cellId)
       {
-      // ...otherwise, we populate a histogram from the scalar values at each
-      // point, and then select the bin with the most elements.
-      hist.Reset(numPts);
-      for (ptId=0; ptId < numPts; ptId++)
+      vtkIdType npts;
+      const vtkIdType *pts;
+      cells.GetCellPoints(cellId, npts, pts);
+      cellPts->SetNumberOfIds(npts);
+      std::copy(pts, pts + npts, cellPts->GetPointer(0));
+      weights.assign(npts + 1, npts > 0 ? 1.0 / npts : 0.0);
+      for (size_t i = 0; i < arrays.Others.size(); ++i)
         {
-        pointId = cellPts->GetId(ptId);
-        hist.Fill(pointId,
-                  input->GetPointData()->GetScalars()->GetTuple1(pointId));
+        vtkAbstractArray *inArray = arrays.Others[i].first;
+        vtkAbstractArray *outArray = arrays.Others[i].second;
+        if (categories && npts > 0)
+          {
+          outArray->InsertTuple(cellId, chosenPoints[cellId], inArray);
+          }
+        else if (npts > 0 || vtkDataArray::FastDownCast(outArray))
+          {
+          outArray->InterpolateTuple(cellId, cellPts.GetPointer(), inArray,
+                                     &weights[0]);
+          }
         }
-
-      outCD->CopyData(inPD, hist.IndexOfLargestBin(), cellId);
       }
     }
 
@@ -283,9 +576,6 @@ int vtkPointDataToCellData::RequestData(
     }
   output->GetPointData()->PassData(input->GetPointData());
 
-  cellPts->Delete();
-  delete [] weights;
-
   return 1;
 }
 
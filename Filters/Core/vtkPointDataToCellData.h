@@ -19,6 +19,10 @@
 // The method of transformation is based on averaging the data
 // values of all points defining a particular cell. Optionally, the input point
 // data can be passed through to the output as well.
+//
+// The cells are processed in parallel with vtkSMPTools, all the arrays in
+// a single pass over the cells, for polydata, unstructured grids and
+// structured datasets.
 
 // .SECTION Caveats
 // This filter is an abstract filter, that is, the output is an abstract type
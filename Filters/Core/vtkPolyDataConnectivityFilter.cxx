@@ -17,6 +17,7 @@
 #include "vtkCellArray.h"
 #include "vtkCellData.h"
 #include "vtkCell.h"
+#include "vtkConnectivityHelper.h"
 #include "vtkFloatArray.h"
 #include "vtkIdList.h"
 #include "vtkIdTypeArray.h"
@@ -28,6 +29,7 @@
 #include "vtkPolyData.h"
 
 #include <algorithm> // for fill_n
+#include <vector>
 
 vtkStandardNewMacro(vtkPolyDataConnectivityFilter);
 
@@ -58,6 +60,7 @@ vtkPolyDataConnectivityFilter::vtkPolyDataConnectivityFilter()
   this->VisitedPointIds = vtkIdList::New();
 
   this->OutputPointsPrecision = DEFAULT_PRECISION;
+  this->ParallelLabeling = 0;
 }
 
 vtkPolyDataConnectivityFilter::~vtkPolyDataConnectivityFilter()
@@ -131,11 +134,25 @@ int vtkPolyDataConnectivityFilter::RequestData(
       }
     }
 
+  // Label all the regions at once if they are not seeded.
+  //
+  bool labelRegions = this->ParallelLabeling && !this->InScalars &&
+    this->ExtractionMode != VTK_EXTRACT_POINT_SEEDED_REGIONS &&
+    this->ExtractionMode != VTK_EXTRACT_CELL_SEEDED_REGIONS &&
+    this->ExtractionMode != VTK_EXTRACT_CLOSEST_POINT_REGION;
+
   // Build cell structure
   //
   this->Mesh = vtkPolyData::New();
   this->Mesh->CopyStructure(input);
-  this->Mesh->BuildLinks();
+  if ( labelRegions )
+    {
+    this->Mesh->BuildCells();
+    }
+  else
+    {
+    this->Mesh->BuildLinks();
+    }
   this->UpdateProgress(0.10);
 
   // Remove all visited point ids
@@ -186,7 +203,33 @@ int vtkPolyDataConnectivityFilter::RequestData(
   this->PointIds = vtkIdList::New();
   this->PointIds->Allocate(8, VTK_CELL_SIZE);
 
-  if ( this->ExtractionMode != VTK_EXTRACT_POINT_SEEDED_REGIONS &&
+  if ( labelRegions )
+    { //label all regions at once, and number the points in input order
+    std::vector<vtkIdType> pointRegions(numPts);
+    this->RegionNumber = vtkConnectivityHelper::LabelRegions(
+      this->Mesh, this->Visited, &pointRegions[0], this->RegionSizes);
+    this->UpdateProgress (0.8);
+
+    for (i=0; i < numPts; i++)
+      {
+      if ( pointRegions[i] >= 0 )
+        {
+        this->PointMap[i] = this->PointNumber++;
+        vtkArrayDownCast<vtkIdTypeArray>(this->NewScalars)->SetValue(
+          this->PointMap[i], pointRegions[i]);
+        }
+      }
+    for (id=0; id < this->RegionNumber; id++)
+      {
+      if ( this->RegionSizes->GetValue(id) > maxCellsInRegion )
+        {
+        maxCellsInRegion = this->RegionSizes->GetValue(id);
+        largestRegionId = id;
+        }
+      }
+    this->UpdateProgress (0.9);
+    }
+  else if ( this->ExtractionMode != VTK_EXTRACT_POINT_SEEDED_REGIONS &&
   this->ExtractionMode != VTK_EXTRACT_CELL_SEEDED_REGIONS &&
   this->ExtractionMode != VTK_EXTRACT_CLOSEST_POINT_REGION )
     { //visit all cells marking with region number
@@ -661,4 +704,6 @@ void vtkPolyDataConnectivityFilter::PrintSelf(ostream& os, vtkIndent indent)
     }
 
   os << indent << "Output Points Precision: " << this->OutputPointsPrecision << "\n";
+  os << indent << "Parallel Labeling: "
+     << (this->ParallelLabeling ? "On\n" : "Off\n");
 }
@@ -180,6 +180,17 @@ public:
   vtkSetMacro(OutputPointsPrecision,int);
   vtkGetMacro(OutputPointsPrecision,int);
 
+  // Description:
+  // Turn on/off the labeling of all the regions at once in parallel when
+  // the regions are not seeded (largest, specified or all regions) and
+  // ScalarConnectivity is off. The region ids and sizes are the same as
+  // with the serial traversal, but the output points are numbered in the
+  // order of the input points instead of the order they are reached in.
+  // Off by default.
+  vtkSetMacro(ParallelLabeling,int);
+  vtkGetMacro(ParallelLabeling,int);
+  vtkBooleanMacro(ParallelLabeling,int);
+
 protected:
   vtkPolyDataConnectivityFilter();
   ~vtkPolyDataConnectivityFilter();
@@ -224,6 +235,7 @@ protected:
 
   int MarkVisitedPointIds;
   int OutputPointsPrecision;
+  int ParallelLabeling;
 
 private:
   vtkPolyDataConnectivityFilter(const vtkPolyDataConnectivityFilter&) VTK_DELETE_FUNCTION;
@@ -26,9 +26,14 @@
 #include "vtkPolygon.h"
 #include "vtkTriangleStrip.h"
 #include "vtkPriorityQueue.h"
+#include "vtkSMPThreadLocal.h"
+#include "vtkSMPTools.h"
 
 #include "vtkNew.h"
 
+#include <algorithm>
+#include <vector>
+
 vtkStandardNewMacro(vtkPolyDataNormals);
 
 // Construct with feature angle=30, splitting and consistency turned on,
@@ -60,6 +65,398 @@ vtkPolyDataNormals::vtkPolyDataNormals()
 #define VTK_CELL_NOT_VISITED     0
 #define VTK_CELL_VISITED         1
 
+namespace
+{
+
+//----------------------------------------------------------------------------
+// Compute the normals of the polygons of a mesh whose cells are built.
+class PolyNormalsFunctor
+{
+public:
+  vtkPolyData *Mesh;
+  vtkPoints *Points;
+  float *Normals;
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    vtkIdType npts;
+    vtkIdType *pts;
+    double n[3];
+    for (vtkIdType cellId = begin; cellId < end; ++cellId)
+      {
+      this->Mesh->GetCellPoints(cellId, npts, pts);
+      vtkPolygon::ComputeNormal(this->Points, npts, pts, n);
+      this->Normals[3 * cellId] = static_cast<float>(n[0]);
+      this->Normals[3 * cellId + 1] = static_cast<float>(n[1]);
+      this->Normals[3 * cellId + 2] = static_cast<float>(n[2]);
+      }
+  }
+};
+
+//----------------------------------------------------------------------------
+// Split the points of a mesh along its feature edges. The cells using a
+// point are gathered into regions separated by feature edges, boundary
+// edges and non-manifold edges, and the point is duplicated for every
+// region but the first. The regions of a point are computed from the
+// links of the unmodified mesh only, so that the points can be processed
+// concurrently; the region of each cell is stored at the position of the
+// cell in the links of the point.
+class PointSplitter
+{
+public:
+  vtkPolyData *OldMesh;
+  const float *PolyNormals;
+  double CosAngle;
+
+  // Index of each input point among the split points, or -1.
+  std::vector<vtkIdType> SplitIndex;
+  // For each split point, the id of its first duplicate and the position
+  // of the regions of its cells in Regions, followed by the number of
+  // output points and the size of Regions.
+  std::vector<vtkIdType> FirstNewIds;
+  std::vector<vtkIdType> RegionOffsets;
+  std::vector<int> Regions;
+
+  // Label the cells using ptId with their region, and return the number of
+  // regions.
+  int MarkRegions(vtkIdType ptId, vtkIdList *cellIds, int *regions) const;
+
+  // Return the id of the point replacing ptId in the cell at position k in
+  // the links of ptId.
+  vtkIdType GetNewPointId(vtkIdType ptId, int k) const
+  {
+    vtkIdType split = this->SplitIndex[ptId];
+    if (split >= 0)
+      {
+      int region = this->Regions[this->RegionOffsets[split] + k];
+      if (region > 0)
+        {
+        return this->FirstNewIds[split] + region - 1;
+        }
+      }
+    return ptId;
+  }
+
+  // Position of a cell in the links of a point.
+  static int FindCell(const vtkIdType *cells, int ncells, vtkIdType cellId)
+  {
+    return static_cast<int>(std::find(cells, cells + ncells, cellId) - cells);
+  }
+
+private:
+  // Return the point sharing an edge with ptId in the cell pts, other than
+  // nei unless both edges lead to it.
+  static vtkIdType NextEdgePoint(vtkIdType numPts, const vtkIdType *pts,
+                                 vtkIdType ptId, vtkIdType nei)
+  {
+    vtkIdType spot;
+    for (spot=0; spot < numPts; spot++)
+      {
+      if ( pts[spot] == ptId )
+        {
+        break;
+        }
+      }
+
+    if (spot == 0)
+      {
+      return (pts[spot+1] != nei ? pts[spot+1] : pts[numPts-1]);
+      }
+    else if (spot == (numPts-1))
+      {
+      return (pts[spot-1] != nei ? pts[spot-1] : pts[0]);
+      }
+    else
+      {
+      return (pts[spot+1] != nei ? pts[spot+1] : pts[spot-1]);
+      }
+  }
+};
+
+//----------------------------------------------------------------------------
+int PointSplitter::MarkRegions(vtkIdType ptId, vtkIdList *cellIds,
+                               int *regions) const
+{
+  int i,j;
+
+  // Get the cells using this point and make sure that we have to do something
+  unsigned short ncells;
+  vtkIdType *cells;
+  this->OldMesh->GetPointCells(ptId,ncells,cells);
+  if ( ncells <= 1 )
+    {
+    return 1; //point does not need to be further disconnected
+    }
+
+  // Start moving around the "cycle" of points using the point. Label
+  // each subregion of cells connected to this point that are connected
+  // (and not separated by a feature edge) with a given region number.
+  // A cell using the point twice is labelled at its first position only.
+  //
+  // Start by initializing the cells as unvisited
+  std::fill(regions, regions + ncells, -1);
+
+  // Loop over all cells and mark the region that each is in.
+  //
+  vtkIdType numPts;
+  vtkIdType *pts;
+  int numRegions = 0;
+  vtkIdType neiPt[2], nei, cellId, neiCellId;
+  int neiIdx;
+  double thisNormal[3], neiNormal[3];
+  for (j=0; j<ncells; j++) //for all cells connected to point
+    {
+    if ( regions[FindCell(cells, ncells, cells[j])] < 0 ) //for all unvisited cells
+      {
+      regions[j] = numRegions;
+      //okay, mark all the cells connected to this seed cell and using ptId
+      this->OldMesh->GetCellPoints(cells[j],numPts,pts);
+
+      //find the two edges
+      neiPt[0] = NextEdgePoint(numPts, pts, ptId, -1);
+      neiPt[1] = NextEdgePoint(numPts, pts, ptId, neiPt[0]);
+
+      for (i=0; i<2; i++) //for each of the two edges of the seed cell
+        {
+        cellId = cells[j];
+        nei = neiPt[i];
+        while ( cellId >= 0 ) //while we can grow this region
+          {
+          this->OldMesh->GetCellEdgeNeighbors(cellId,ptId,nei,cellIds);
+          if ( cellIds->GetNumberOfIds() == 1 &&
+               regions[(neiIdx=FindCell(cells, ncells,
+                  (neiCellId=cellIds->GetId(0))))] < 0 )
+            {
+            for (int c = 0; c < 3; c++)
+              {
+              thisNormal[c] = this->PolyNormals[3 * cellId + c];
+              neiNormal[c] = this->PolyNormals[3 * neiCellId + c];
+              }
+
+            if ( vtkMath::Dot(thisNormal,neiNormal) > this->CosAngle )
+              {
+              //visit and arrange to visit next edge neighbor
+              regions[neiIdx] = numRegions;
+              cellId = neiCellId;
+              this->OldMesh->GetCellPoints(cellId,numPts,pts);
+              nei = NextEdgePoint(numPts, pts, ptId, nei);
+              }//if not separated by edge angle
+            else
+              {
+              cellId = -1; //separated by edge angle
+              }
+            }//if can move to edge neighbor
+          else
+            {
+            cellId = -1;//separated by previous visit, boundary, or non-manifold
+            }
+          }//while visit wave is propagating
+        }//for each of the two edges of the starting cell
+      numRegions++;
+      }//if cell is unvisited
+    }//for all cells connected to point ptId
+
+  // Give the other positions of the cells using the point twice the same
+  // region.
+  for (j=0; j<ncells; j++)
+    {
+    if (regions[j] < 0)
+      {
+      regions[j] = regions[FindCell(cells, ncells, cells[j])];
+      }
+    }
+
+  return numRegions;
+}
+
+//----------------------------------------------------------------------------
+struct SplitLocalData
+{
+  vtkIdList *CellIds;
+  std::vector<int> Regions;
+
+  SplitLocalData() : CellIds(NULL)
+  {
+  }
+};
+
+// Base of the functors computing the regions of points, each thread with
+// its own scratch space.
+class SplitFunctorBase
+{
+public:
+  PointSplitter *Splitter;
+  vtkSMPThreadLocal<SplitLocalData> LocalData;
+
+  SplitFunctorBase() : Splitter(NULL)
+  {
+  }
+
+  ~SplitFunctorBase()
+  {
+    vtkSMPThreadLocal<SplitLocalData>::iterator iter;
+    for (iter = this->LocalData.begin(); iter != this->LocalData.end(); ++iter)
+      {
+      if (iter->CellIds)
+        {
+        iter->CellIds->Delete();
+        }
+      }
+  }
+
+  SplitLocalData &GetLocalData()
+  {
+    SplitLocalData &local = this->LocalData.Local();
+    if (!local.CellIds)
+      {
+      local.CellIds = vtkIdList::New();
+      local.CellIds->Allocate(VTK_CELL_SIZE);
+      local.Regions.resize(VTK_CELL_SIZE);
+      }
+    return local;
+  }
+
+  int MarkRegions(vtkIdType ptId)
+  {
+    SplitLocalData &local = this->GetLocalData();
+    unsigned short ncells;
+    vtkIdType *cells;
+    this->Splitter->OldMesh->GetPointCells(ptId, ncells, cells);
+    if (local.Regions.size() < ncells)
+      {
+      local.Regions.resize(ncells);
+      }
+    return this->Splitter->MarkRegions(ptId, local.CellIds, &local.Regions[0]);
+  }
+};
+
+// Count the regions around each point.
+class CountRegionsFunctor : public SplitFunctorBase
+{
+public:
+  int *NumberOfRegions;
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    for (vtkIdType ptId = begin; ptId < end; ++ptId)
+      {
+      this->NumberOfRegions[ptId] = this->MarkRegions(ptId);
+      }
+  }
+};
+
+// Store the regions of the cells around the split points.
+class StoreRegionsFunctor : public SplitFunctorBase
+{
+public:
+  const vtkIdType *SplitIds;
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    for (vtkIdType split = begin; split < end; ++split)
+      {
+      this->MarkRegions(this->SplitIds[split]);
+      const std::vector<int> &regions = this->LocalData.Local().Regions;
+      vtkIdType offset = this->Splitter->RegionOffsets[split];
+      vtkIdType size = this->Splitter->RegionOffsets[split + 1] - offset;
+      std::copy(regions.begin(), regions.begin() + size,
+                this->Splitter->Regions.begin() + offset);
+      }
+  }
+};
+
+// Replace the split points in the cells of the new mesh by their
+// duplicates. Each cell is only written by the thread processing it.
+class ReplacePointsFunctor
+{
+public:
+  PointSplitter *Splitter;
+  vtkPolyData *NewMesh;
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    vtkIdType npts;
+    vtkIdType *pts;
+    unsigned short ncells;
+    vtkIdType *cells;
+    for (vtkIdType cellId = begin; cellId < end; ++cellId)
+      {
+      this->NewMesh->GetCellPoints(cellId, npts, pts);
+      for (vtkIdType i = 0; i < npts; ++i)
+        {
+        vtkIdType ptId = pts[i];
+        if (this->Splitter->SplitIndex[ptId] >= 0)
+          {
+          this->Splitter->OldMesh->GetPointCells(ptId, ncells, cells);
+          pts[i] = this->Splitter->GetNewPointId(
+            ptId, PointSplitter::FindCell(cells, ncells, cellId));
+          }
+        }
+      }
+  }
+};
+
+//----------------------------------------------------------------------------
+// Average the normals of the polygons at their points. Each input point
+// sums the normals of the cells in its links, in the order of the cells, into
+// itself or into its duplicates, so that the sums do not depend on the
+// number of threads.
+class PointNormalsFunctor
+{
+public:
+  vtkPolyData *OldMesh;
+  const PointSplitter *Splitter;
+  const float *PolyNormals;
+  float *Normals;
+  double FlipDirection;
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    unsigned short ncells;
+    vtkIdType *cells;
+    for (vtkIdType ptId = begin; ptId < end; ++ptId)
+      {
+      this->OldMesh->GetPointCells(ptId, ncells, cells);
+      for (int k = 0; k < ncells; ++k)
+        {
+        vtkIdType newId = this->Splitter ?
+          this->Splitter->GetNewPointId(ptId, k) : ptId;
+        this->Normals[3 * newId] += this->PolyNormals[3 * cells[k]];
+        this->Normals[3 * newId + 1] += this->PolyNormals[3 * cells[k] + 1];
+        this->Normals[3 * newId + 2] += this->PolyNormals[3 * cells[k] + 2];
+        }
+
+      this->Normalize(ptId);
+      vtkIdType split = this->Splitter ? this->Splitter->SplitIndex[ptId] : -1;
+      if (split >= 0)
+        {
+        for (vtkIdType newId = this->Splitter->FirstNewIds[split];
+             newId < this->Splitter->FirstNewIds[split + 1]; ++newId)
+          {
+          this->Normalize(newId);
+          }
+        }
+      }
+  }
+
+  void Normalize(vtkIdType i)
+  {
+    float *fNormals = this->Normals;
+    const double length = sqrt(fNormals[3 * i] * fNormals[3 * i] +
+                               fNormals[3 * i + 1] * fNormals[3 * i + 1] +
+                               fNormals[3 * i + 2] * fNormals[3 * i + 2]
+                               ) * this->FlipDirection;
+    if (length != 0.0)
+      {
+      fNormals[3 * i] /= length;
+      fNormals[3 * i + 1] /= length;
+      fNormals[3 * i + 2] /= length;
+      }
+  }
+};
+
+}
+
 // Generate normals for polygon meshes
 int vtkPolyDataNormals::RequestData(
   vtkInformation *vtkNotUsed(request),
@@ -190,7 +587,7 @@ int vtkPolyDataNormals::RequestData(
 
   // The visited array keeps track of which polygons have been visited.
   //
-  if ( this->Consistency || this->Splitting || this->AutoOrientNormals )
+  if ( this->Consistency || this->AutoOrientNormals )
     {
     this->Visited = new int[numPolys];
     memset(this->Visited, VTK_CELL_NOT_VISITED, numPolys*sizeof(int));
@@ -345,23 +742,27 @@ int vtkPolyDataNormals::RequestData(
   this->PolyNormals->Allocate(3*numPolys);
   this->PolyNormals->SetName("Normals");
   this->PolyNormals->SetNumberOfTuples(numPolys);
+  float *fPolyNormals = this->PolyNormals->WritePointer(0, 3 * numPolys);
 
-  for (cellId=0, newPolys->InitTraversal(); newPolys->GetNextCell(npts,pts);
-       cellId++ )
+  // The cells of the new mesh are built, so they can be read concurrently.
+  PolyNormalsFunctor polyNormals;
+  polyNormals.Mesh = this->NewMesh;
+  polyNormals.Points = inPts;
+  polyNormals.Normals = fPolyNormals;
+  vtkIdType batchSize = numPolys / 10 + 1;
+  for (cellId = 0; cellId < numPolys; cellId += batchSize)
     {
-    if ((cellId % 1000) == 0)
+    this->UpdateProgress (0.333 + 0.333 * (double) cellId / (double) numPolys);
+    if (this->GetAbortExecute())
       {
-      this->UpdateProgress (0.333 + 0.333 * (double) cellId / (double) numPolys);
-      if (this->GetAbortExecute())
-        {
-        break;
-        }
+      break;
       }
-    vtkPolygon::ComputeNormal(inPts, npts, pts, n);
-    this->PolyNormals->SetTuple(cellId,n);
+    vtkSMPTools::For(cellId, std::min(cellId + batchSize, numPolys),
+                     polyNormals);
     }
 
   // Split mesh if sharp features
+  PointSplitter splitter;
   if ( this->Splitting )
     {
     //  Traverse all nodes; evaluate loops and feature edges.  If feature
@@ -369,20 +770,74 @@ int vtkPolyDataNormals::RequestData(
     // connectivity.
     //
       this->CosAngle = cos( vtkMath::RadiansFromDegrees( this->FeatureAngle) );
-    //  Splitting will create new points.  We have to create index array
+    splitter.OldMesh = this->OldMesh;
+    splitter.PolyNormals = fPolyNormals;
+    splitter.CosAngle = this->CosAngle;
+
+    // Count the regions around all points in parallel, then number the
+    // duplicates of the split points in the order of the points. The
+    // regions of the cells around the split points are computed again to
+    // be stored.
+    std::vector<int> numRegions(numPts);
+    CountRegionsFunctor countRegions;
+    countRegions.Splitter = &splitter;
+    countRegions.NumberOfRegions = &numRegions[0];
+    vtkSMPTools::For(0, numPts, countRegions);
+
+    std::vector<vtkIdType> splitIds;
+    splitter.SplitIndex.resize(numPts);
+    splitter.FirstNewIds.push_back(numPts);
+    splitter.RegionOffsets.push_back(0);
+    for (ptId=0; ptId < numPts; ptId++)
+      {
+      if (numRegions[ptId] > 1)
+        {
+        unsigned short ncells;
+        vtkIdType *cells;
+        this->OldMesh->GetPointCells(ptId, ncells, cells);
+        splitter.SplitIndex[ptId] = static_cast<vtkIdType>(splitIds.size());
+        splitIds.push_back(ptId);
+        splitter.FirstNewIds.push_back(
+          splitter.FirstNewIds.back() + numRegions[ptId] - 1);
+        splitter.RegionOffsets.push_back(
+          splitter.RegionOffsets.back() + ncells);
+        }
+      else
+        {
+        splitter.SplitIndex[ptId] = -1;
+        }
+      }
+    std::vector<int>().swap(numRegions);
+    vtkIdType numSplitPts = static_cast<vtkIdType>(splitIds.size());
+
+    splitter.Regions.resize(splitter.RegionOffsets.back());
+    StoreRegionsFunctor storeRegions;
+    storeRegions.Splitter = &splitter;
+    storeRegions.SplitIds = numSplitPts > 0 ? &splitIds[0] : NULL;
+    vtkSMPTools::For(0, numSplitPts, storeRegions);
+
+    ReplacePointsFunctor replacePoints;
+    replacePoints.Splitter = &splitter;
+    replacePoints.NewMesh = this->NewMesh;
+    vtkSMPTools::For(0, numPolys, replacePoints);
+
+    //  Splitting creates new points.  We have to create index array
     // to map new points into old points.
     //
     this->Map = vtkIdList::New();
-    this->Map->SetNumberOfIds(numPts);
+    this->Map->SetNumberOfIds(splitter.FirstNewIds.back());
     for (vtkIdType i=0; i < numPts; i++)
       {
       this->Map->SetId(i,i);
       }
-
-    for (ptId=0; ptId < numPts; ptId++)
+    for (vtkIdType split=0; split < numSplitPts; split++)
       {
-      this->MarkAndSplit(ptId);
-      }//for all input points
+      for (vtkIdType i=splitter.FirstNewIds[split];
+           i < splitter.FirstNewIds[split+1]; i++)
+        {
+        this->Map->SetId(i,splitIds[split]);
+        }
+      }
 
     numNewPts = this->Map->GetNumberOfIds();
 
@@ -434,9 +889,10 @@ int vtkPolyDataNormals::RequestData(
     outPD->PassData(pd);
     }
 
-  if ( this->Consistency || this->Splitting )
+  if ( this->Visited )
     {
     delete [] this->Visited;
+    this->Visited = NULL;
     this->CellIds->Delete();
     }
 
@@ -457,34 +913,15 @@ int vtkPolyDataNormals::RequestData(
   float *fNormals = newNormals->WritePointer(0, 3 * numNewPts);
   std::fill_n(fNormals, 3 * numNewPts, 0);
 
-  float *fPolyNormals = this->PolyNormals->WritePointer(0, 3 * numPolys);
-
   if (this->ComputePointNormals)
     {
-    for (cellId=0, newPolys->InitTraversal(); newPolys->GetNextCell(npts, pts);
-         ++cellId)
-      {
-      for (vtkIdType i = 0; i < npts; ++i)
-        {
-        fNormals[3 * pts[i]] += fPolyNormals[3 * cellId];
-        fNormals[3 * pts[i] + 1] += fPolyNormals[3 * cellId + 1];
-        fNormals[3 * pts[i] + 2] += fPolyNormals[3 * cellId + 2];
-        }
-      }
-
-    for (vtkIdType i = 0; i < numNewPts; ++i)
-      {
-      const double length = sqrt(fNormals[3 * i] * fNormals[3 * i] +
-                                 fNormals[3 * i + 1] * fNormals[3 * i + 1] +
-                                 fNormals[3 * i + 2] * fNormals[3 * i + 2]
-                                 ) * flipDirection;
-      if (length != 0.0)
-        {
-        fNormals[3 * i] /= length;
-        fNormals[3 * i + 1] /= length;
-        fNormals[3 * i + 2] /= length;
-        }
-      }
+    PointNormalsFunctor pointNormals;
+    pointNormals.OldMesh = this->OldMesh;
+    pointNormals.Splitter = this->Splitting ? &splitter : NULL;
+    pointNormals.PolyNormals = fPolyNormals;
+    pointNormals.Normals = fNormals;
+    pointNormals.FlipDirection = flipDirection;
+    vtkSMPTools::For(0, numPts, pointNormals);
     }
 
   //  Update ourselves.  If no new nodes have been created (i.e., no
@@ -597,167 +1034,6 @@ void vtkPolyDataNormals::TraverseAndOrder (void)
   return;
 }
 
-//
-//  Mark polygons around vertex.  Create new vertex (if necessary) and
-//  replace (i.e., split mesh).
-//
-void vtkPolyDataNormals::MarkAndSplit (vtkIdType ptId)
-{
-  int i,j;
-
-  // Get the cells using this point and make sure that we have to do something
-  unsigned short ncells;
-  vtkIdType *cells;
-  this->OldMesh->GetPointCells(ptId,ncells,cells);
-  if ( ncells <= 1 )
-    {
-    return; //point does not need to be further disconnected
-    }
-
-  // Start moving around the "cycle" of points using the point. Label
-  // each point as requiring a visit. Then label each subregion of cells
-  // connected to this point that are connected (and not separated by
-  // a feature edge) with a given region number. For each N regions
-  // created, N-1 duplicate (split) points are created. The split point
-  // replaces the current point ptId in the polygons connectivity array.
-  //
-  // Start by initializing the cells as unvisited
-  for (i=0; i<ncells; i++)
-    {
-    this->Visited[cells[i]] = -1;
-    }
-
-  // Loop over all cells and mark the region that each is in.
-  //
-  vtkIdType numPts;
-  vtkIdType *pts;
-  int numRegions = 0;
-  vtkIdType spot, neiPt[2], nei, cellId, neiCellId;
-  double thisNormal[3], neiNormal[3];
-  for (j=0; j<ncells; j++) //for all cells connected to point
-    {
-    if ( this->Visited[cells[j]] < 0 ) //for all unvisited cells
-      {
-      this->Visited[cells[j]] = numRegions;
-      //okay, mark all the cells connected to this seed cell and using ptId
-      this->OldMesh->GetCellPoints(cells[j],numPts,pts);
-
-      //find the two edges
-      for (spot=0; spot < numPts; spot++)
-        {
-        if ( pts[spot] == ptId )
-          {
-          break;
-          }
-        }
-
-      if ( spot == 0 )
-        {
-        neiPt[0] = pts[spot+1];
-        neiPt[1] = pts[numPts-1];
-        }
-      else if ( spot == (numPts-1) )
-        {
-        neiPt[0] = pts[spot-1];
-        neiPt[1] = pts[0];
-        }
-      else
-        {
-        neiPt[0] = pts[spot+1];
-        neiPt[1] = pts[spot-1];
-        }
-
-      for (i=0; i<2; i++) //for each of the two edges of the seed cell
-        {
-        cellId = cells[j];
-        nei = neiPt[i];
-        while ( cellId >= 0 ) //while we can grow this region
-          {
-          this->OldMesh->GetCellEdgeNeighbors(cellId,ptId,nei,this->CellIds);
-          if ( this->CellIds->GetNumberOfIds() == 1 &&
-               this->Visited[(neiCellId=this->CellIds->GetId(0))] < 0 )
-            {
-            this->PolyNormals->GetTuple(cellId, thisNormal);
-            this->PolyNormals->GetTuple(neiCellId, neiNormal);
-
-            if ( vtkMath::Dot(thisNormal,neiNormal) > CosAngle )
-              {
-              //visit and arrange to visit next edge neighbor
-              this->Visited[neiCellId] = numRegions;
-              cellId = neiCellId;
-              this->OldMesh->GetCellPoints(cellId,numPts,pts);
-
-              for (spot=0; spot < numPts; spot++)
-                {
-                if ( pts[spot] == ptId )
-                  {
-                  break;
-                  }
-                }
-
-              if (spot == 0)
-                {
-                nei = (pts[spot+1] != nei ? pts[spot+1] : pts[numPts-1]);
-                }
-              else if (spot == (numPts-1))
-                {
-                nei = (pts[spot-1] != nei ? pts[spot-1] : pts[0]);
-                }
-              else
-                {
-                nei = (pts[spot+1] != nei ? pts[spot+1] : pts[spot-1]);
-                }
-
-              }//if not separated by edge angle
-            else
-              {
-              cellId = -1; //separated by edge angle
-              }
-            }//if can move to edge neighbor
-          else
-            {
-            cellId = -1;//separated by previous visit, boundary, or non-manifold
-            }
-          }//while visit wave is propagating
-        }//for each of the two edges of the starting cell
-      numRegions++;
-      }//if cell is unvisited
-    }//for all cells connected to point ptId
-
-  if ( numRegions <=1 )
-    {
-    return; //a single region, no splitting ever required
-    }
-
-  // Okay, for all cells not in the first region, the ptId is
-  // replaced with a new ptId, which is a duplicate of the first
-  // point, but disconnected topologically.
-  //
-  vtkIdType lastId = this->Map->GetNumberOfIds();
-  vtkIdType replacementPoint;
-  for (j=0; j<ncells; j++)
-    {
-    if (this->Visited[cells[j]] > 0 ) //replace point if splitting needed
-      {
-      replacementPoint = lastId + this->Visited[cells[j]] - 1;
-
-      this->Map->InsertId(replacementPoint, ptId);
-
-      this->NewMesh->GetCellPoints(cells[j],numPts,pts);
-      for (i=0; i < numPts; i++)
-        {
-        if ( pts[i] == ptId )
-          {
-          pts[i] = replacementPoint; // this is very nasty! direct write!
-          break;
-          }
-        }//replace ptId with split point
-      }//if not in first regions and requiring splitting
-    }//for all cells connected to ptId
-
-  return;
-}
-
 void vtkPolyDataNormals::PrintSelf(ostream& os, vtkIndent indent)
 {
   this->Superclass::PrintSelf(os,indent);
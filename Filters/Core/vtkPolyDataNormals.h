@@ -36,6 +36,11 @@
 // averaging them at shared points. When sharp edges are present, the edges
 // are split and new points generated to prevent blurry edges (due to
 // Gouraud shading).
+//
+// The polygon normals, the splitting of the points along feature edges and
+// the point normals are computed in parallel with vtkSMPTools, and give the
+// same output whatever the number of threads. The traversal enforcing a
+// consistent ordering (Consistency and AutoOrientNormals) is serial.
 
 // .SECTION Caveats
 // Normals are computed only for polygons and triangle strips. Normals are
@@ -168,11 +173,6 @@ private:
   // checked and properly ordered polygons.
   void TraverseAndOrder(void);
 
-  // Check the point id give to see whether it lies on a feature
-  // edge. If so, split the point (i.e., duplicate it) to topologically
-  // separate the mesh.
-  void MarkAndSplit(vtkIdType ptId);
-
 private:
   vtkPolyDataNormals(const vtkPolyDataNormals&) VTK_DELETE_FUNCTION;
   void operator=(const vtkPolyDataNormals&) VTK_DELETE_FUNCTION;
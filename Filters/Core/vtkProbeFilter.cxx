@@ -14,21 +14,33 @@
 =========================================================================*/
 #include "vtkProbeFilter.h"
 
+#include "vtkAbstractCellLocator.h"
 #include "vtkCell.h"
 #include "vtkCellData.h"
 #include "vtkCharArray.h"
+#include "vtkGenericCell.h"
 #include "vtkIdTypeArray.h"
 #include "vtkImageData.h"
 #include "vtkInformation.h"
 #include "vtkInformationVector.h"
 #include "vtkMath.h"
+#include "vtkNew.h"
 #include "vtkObjectFactory.h"
 #include "vtkPointData.h"
+#include "vtkPolyData.h"
+#include "vtkRectilinearGrid.h"
+#include "vtkSMPThreadLocal.h"
+#include "vtkSMPTools.h"
+#include "vtkSmartPointer.h"
 #include "vtkStreamingDemandDrivenPipeline.h"
+#include "vtkUnstructuredGrid.h"
 
+#include <algorithm>
 #include <vector>
 
 vtkStandardNewMacro(vtkProbeFilter);
+vtkCxxSetObjectMacro(vtkProbeFilter, CellLocatorPrototype,
+                     vtkAbstractCellLocator);
 
 #define CELL_TOLERANCE_FACTOR_SQR  1e-6
 
@@ -37,6 +49,446 @@ class vtkProbeFilter::vtkVectorOfArrays :
 {
 };
 
+//----------------------------------------------------------------------------
+static void GetPointIdsInRange(double rangeMin, double rangeMax, double start,
+  double stepsize, int numSteps, int &minid, int &maxid)
+{
+  if (stepsize == 0)
+    {
+    minid = maxid = 0;
+    return;
+    }
+
+  minid = vtkMath::Ceil((rangeMin - start)/stepsize);
+  if (minid < 0)
+    {
+    minid = 0;
+    }
+
+  maxid = vtkMath::Floor((rangeMax - start)/stepsize);
+  if (maxid > numSteps-1)
+    {
+    maxid = numSteps-1;
+    }
+}
+
+namespace
+{
+
+//----------------------------------------------------------------------------
+// Datasets whose cells can be fetched from several threads once their
+// search structures are built (see BuildSourceCells()).
+bool IsThreadSafeSource(vtkDataSet *source)
+{
+  return vtkUnstructuredGrid::SafeDownCast(source) ||
+    vtkPolyData::SafeDownCast(source) || vtkImageData::SafeDownCast(source) ||
+    vtkRectilinearGrid::SafeDownCast(source);
+}
+
+//----------------------------------------------------------------------------
+// Build the cells, bounds and links of the source, which are otherwise built
+// lazily by the first query.
+void BuildSourceCells(vtkDataSet *source, bool links)
+{
+  double bounds[6];
+  source->GetBounds(bounds);
+  if (source->GetNumberOfCells() > 0 && source->GetNumberOfPoints() > 0)
+    {
+    vtkNew<vtkGenericCell> cell;
+    source->GetCell(0, cell.GetPointer());
+    if (links)
+      {
+      vtkNew<vtkIdList> cellIds;
+      source->GetPointCells(0, cellIds.GetPointer());
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+// Make a locator of the type of the prototype for the cells of a point set
+// source. Image and rectilinear grid sources find their cells directly.
+vtkAbstractCellLocator *NewCellLocator(vtkAbstractCellLocator *prototype,
+                                       vtkDataSet *source)
+{
+  if (!prototype || !vtkPointSet::SafeDownCast(source))
+    {
+    return NULL;
+    }
+  vtkAbstractCellLocator *locator = prototype->NewInstance();
+  locator->SetNumberOfCellsPerNode(prototype->GetNumberOfCellsPerNode());
+  locator->SetCacheCellBounds(prototype->GetCacheCellBounds());
+  locator->SetAutomatic(prototype->GetAutomatic());
+  locator->SetMaxLevel(prototype->GetMaxLevel());
+  locator->SetTolerance(prototype->GetTolerance());
+  locator->SetDataSet(source);
+  locator->BuildLocator();
+  return locator;
+}
+
+//----------------------------------------------------------------------------
+struct ProbeLocalData
+{
+  vtkGenericCell *Cell;
+  std::vector<double> Weights;
+  // One-tuple arrays the source point data are interpolated into, before
+  // being copied to the output.
+  std::vector<vtkDataArray*> Tuples;
+
+  ProbeLocalData() : Cell(NULL)
+  {
+  }
+};
+
+//----------------------------------------------------------------------------
+// Write the values of the probed points to the output point data. The
+// output arrays are sized to the number of points beforehand and are then
+// only accessed with the Set methods, so that distinct points can be
+// written from several threads.
+class ProbePointWriter
+{
+public:
+  std::vector<vtkDataArray*> SourcePointArrays;
+  std::vector<vtkDataArray*> OutputPointArrays;
+  std::vector<vtkDataArray*> SourceCellArrays;
+  std::vector<vtkDataArray*> OutputCellArrays;
+  std::vector<vtkDataArray*> NullArrays;
+  std::vector<double> NullTuple;
+  int MaxCellSize;
+  vtkSMPThreadLocal<ProbeLocalData> LocalData;
+
+  ProbePointWriter() : MaxCellSize(1)
+  {
+  }
+
+  ~ProbePointWriter()
+  {
+    vtkSMPThreadLocal<ProbeLocalData>::iterator iter;
+    for (iter = this->LocalData.begin(); iter != this->LocalData.end(); ++iter)
+      {
+      if (iter->Cell)
+        {
+        iter->Cell->Delete();
+        }
+      for (size_t i = 0; i < iter->Tuples.size(); ++i)
+        {
+        iter->Tuples[i]->Delete();
+        }
+      }
+  }
+
+  // Collect the arrays to write and size them. Returns false if some of
+  // them cannot be written concurrently.
+  bool Initialize(vtkDataSetAttributes::FieldList &pointList, int srcIdx,
+                  vtkDataSet *source, vtkPointData *outPD,
+                  const std::vector<vtkDataArray*> &cellArrays,
+                  bool nullPoints, vtkIdType numPts)
+  {
+    vtkPointData *pd = source->GetPointData();
+    for (int i = 0; i < pointList.GetNumberOfFields(); ++i)
+      {
+      if (pointList.GetFieldIndex(i) >= 0 && pointList.GetDSAIndex(srcIdx, i) >= 0)
+        {
+        this->SourcePointArrays.push_back(vtkArrayDownCast<vtkDataArray>(
+          pd->GetAbstractArray(pointList.GetDSAIndex(srcIdx, i))));
+        this->OutputPointArrays.push_back(vtkArrayDownCast<vtkDataArray>(
+          outPD->GetAbstractArray(pointList.GetFieldIndex(i))));
+        }
+      }
+    vtkCellData *cd = source->GetCellData();
+    for (size_t i = 0; i < cellArrays.size(); ++i)
+      {
+      vtkDataArray *inArray = cd->GetArray(cellArrays[i]->GetName());
+      if (inArray)
+        {
+        this->SourceCellArrays.push_back(inArray);
+        this->OutputCellArrays.push_back(cellArrays[i]);
+        }
+      }
+    int numComps = 1;
+    for (int i = 0; i < outPD->GetNumberOfArrays(); ++i)
+      {
+      vtkDataArray *array = outPD->GetArray(i);
+      if (array)
+        {
+        this->NullArrays.push_back(array);
+        numComps = std::max(numComps, array->GetNumberOfComponents());
+        }
+      }
+    this->NullTuple.resize(numComps, 0.0);
+    this->MaxCellSize = std::max(source->GetMaxCellSize(), 1);
+
+    if (!CanWrite(this->SourcePointArrays) ||
+        !CanWrite(this->OutputPointArrays) ||
+        !CanWrite(this->SourceCellArrays) ||
+        !CanWrite(this->OutputCellArrays) ||
+        (nullPoints && !CanWrite(this->NullArrays)))
+      {
+      return false;
+      }
+
+    for (int i = 0; i < outPD->GetNumberOfArrays(); ++i)
+      {
+      outPD->GetAbstractArray(i)->SetNumberOfTuples(numPts);
+      }
+    return true;
+  }
+
+  // Allocate the cell, weights and tuples of the calling thread.
+  void InitializeLocal()
+  {
+    ProbeLocalData &local = this->LocalData.Local();
+    if (local.Cell)
+      {
+      return;
+      }
+    local.Cell = vtkGenericCell::New();
+    local.Weights.resize(this->MaxCellSize);
+    for (size_t i = 0; i < this->OutputPointArrays.size(); ++i)
+      {
+      vtkDataArray *tuple = this->OutputPointArrays[i]->NewInstance();
+      tuple->SetNumberOfComponents(
+        this->OutputPointArrays[i]->GetNumberOfComponents());
+      tuple->SetNumberOfTuples(1);
+      local.Tuples.push_back(tuple);
+      }
+  }
+
+  // Interpolate the point data at the points of the local cell with the
+  // local weights and copy the data of the cell.
+  void WritePoint(ProbeLocalData &local, vtkIdType ptId, vtkIdType cellId)
+  {
+    vtkIdList *ptIds = local.Cell->PointIds;
+    for (size_t i = 0; i < this->OutputPointArrays.size(); ++i)
+      {
+      local.Tuples[i]->InterpolateTuple(0, ptIds, this->SourcePointArrays[i],
+                                        &local.Weights[0]);
+      this->OutputPointArrays[i]->SetTuple(ptId, 0, local.Tuples[i]);
+      }
+    for (size_t i = 0; i < this->OutputCellArrays.size(); ++i)
+      {
+      this->OutputCellArrays[i]->SetTuple(ptId, cellId,
+                                          this->SourceCellArrays[i]);
+      }
+  }
+
+  // Same as vtkPointData::NullPoint().
+  void NullPoint(vtkIdType ptId)
+  {
+    for (size_t i = 0; i < this->NullArrays.size(); ++i)
+      {
+      this->NullArrays[i]->SetTuple(ptId, &this->NullTuple[0]);
+      }
+  }
+
+private:
+  // Bits share their bytes with the neighbouring values, and other arrays
+  // are not vtkDataArrays.
+  static bool CanWrite(const std::vector<vtkDataArray*> &arrays)
+  {
+    for (size_t i = 0; i < arrays.size(); ++i)
+      {
+      if (!arrays[i] || arrays[i]->GetDataType() == VTK_BIT)
+        {
+        return false;
+        }
+      }
+    return true;
+  }
+};
+
+//----------------------------------------------------------------------------
+// Probe the points of the input that were not probed yet. The points found
+// in a cell are marked with 2 in the mask.
+class ProbeEmptyPointsFunctor
+{
+public:
+  vtkDataSet *Input;
+  vtkDataSet *Source;
+  vtkAbstractCellLocator *Locator;
+  ProbePointWriter *Writer;
+  char *Mask;
+  double Tol2;
+  bool ComputeTolerance;
+  bool UseNullPoint;
+
+  void Initialize()
+  {
+    this->Writer->InitializeLocal();
+  }
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    ProbeLocalData &local = this->Writer->LocalData.Local();
+    vtkGenericCell *cell = local.Cell;
+    double *weights = &local.Weights[0];
+    double x[3], pcoords[3];
+    int subId;
+
+    for (vtkIdType ptId = begin; ptId < end; ++ptId)
+      {
+      if (this->Mask[ptId] == static_cast<char>(1))
+        {
+        continue;
+        }
+
+      this->Input->GetPoint(ptId, x);
+      vtkIdType cellId;
+      if (this->Locator)
+        {
+        cellId = this->Locator->FindCell(x, this->Tol2, cell, pcoords, weights);
+        }
+      else
+        {
+        cellId = this->Source->FindCell(x, NULL, cell, -1, this->Tol2, subId,
+                                        pcoords, weights);
+        if (cellId >= 0)
+          {
+          this->Source->GetCell(cellId, cell);
+          }
+        }
+      if (cellId >= 0 && this->ComputeTolerance)
+        {
+        double dist2;
+        double closestPoint[3];
+        cell->EvaluatePosition(x, closestPoint, subId, pcoords, dist2, weights);
+        if (dist2 > (cell->GetLength2() * CELL_TOLERANCE_FACTOR_SQR))
+          {
+          cellId = -1;
+          }
+        }
+
+      if (cellId >= 0)
+        {
+        this->Writer->WritePoint(local, ptId, cellId);
+        this->Mask[ptId] = static_cast<char>(2);
+        }
+      else if (this->UseNullPoint)
+        {
+        this->Writer->NullPoint(ptId);
+        }
+      }
+  }
+
+  void Reduce()
+  {
+  }
+};
+
+//----------------------------------------------------------------------------
+// Compute the range of the image points in the bounds of each source cell.
+class ImageCellRangesFunctor
+{
+public:
+  vtkDataSet *Source;
+  int *Ranges;
+  double Start[3];
+  double Spacing[3];
+  int Dimensions[3];
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    double cellBounds[6];
+    for (vtkIdType cellId = begin; cellId < end; ++cellId)
+      {
+      this->Source->GetCellBounds(cellId, cellBounds);
+      int *range = this->Ranges + 6 * cellId;
+      for (int i = 0; i < 3; ++i)
+        {
+        GetPointIdsInRange(cellBounds[2 * i], cellBounds[2 * i + 1],
+                           this->Start[i], this->Spacing[i],
+                           this->Dimensions[i], range[2 * i],
+                           range[2 * i + 1]);
+        }
+      }
+  }
+};
+
+//----------------------------------------------------------------------------
+// Probe the image points of a range of slices, along the last axis of the
+// image, with the cells overlapping each slice. The cells are visited in
+// increasing order so that a point contained in several cells gets the
+// values of the last one, as in the serial loop over the cells.
+class ProbeImageSlicesFunctor
+{
+public:
+  vtkDataSet *Source;
+  ProbePointWriter *Writer;
+  char *Mask;
+  const int *Ranges;
+  const vtkIdType *SliceOffsets;
+  const vtkIdType *SliceCells;
+  int Axis;
+  double Start[3];
+  double Spacing[3];
+  int Dimensions[3];
+  double Tol2;
+  bool ComputeTolerance;
+
+  void Initialize()
+  {
+    this->Writer->InitializeLocal();
+  }
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    ProbeLocalData &local = this->Writer->LocalData.Local();
+    vtkGenericCell *cell = local.Cell;
+    double *weights = &local.Weights[0];
+    double pcoords[3];
+
+    for (vtkIdType slice = begin; slice < end; ++slice)
+      {
+      for (vtkIdType i = this->SliceOffsets[slice];
+           i < this->SliceOffsets[slice + 1]; ++i)
+        {
+        vtkIdType cellId = this->SliceCells[i];
+        int idxBounds[6];
+        std::copy(this->Ranges + 6 * cellId, this->Ranges + 6 * cellId + 6,
+                  idxBounds);
+        idxBounds[2 * this->Axis] = idxBounds[2 * this->Axis + 1] =
+          static_cast<int>(slice);
+
+        this->Source->GetCell(cellId, cell);
+        double tol2 = this->ComputeTolerance ?
+                      (CELL_TOLERANCE_FACTOR_SQR * cell->GetLength2()) :
+                      this->Tol2;
+        for (int iz = idxBounds[4]; iz <= idxBounds[5]; iz++)
+          {
+          double p[3];
+          p[2] = this->Start[2] + iz * this->Spacing[2];
+          for (int iy = idxBounds[2]; iy <= idxBounds[3]; iy++)
+            {
+            p[1] = this->Start[1] + iy * this->Spacing[1];
+            for (int ix = idxBounds[0]; ix <= idxBounds[1]; ix++)
+              {
+              p[0] = this->Start[0] + ix * this->Spacing[0];
+
+              double closestPoint[3];
+              double dist2;
+              int subId;
+              int inside = cell->EvaluatePosition(p, closestPoint, subId,
+                                                  pcoords, dist2, weights);
+              if ((inside == 1) && (dist2 <= tol2))
+                {
+                vtkIdType ptId = ix + this->Dimensions[0] *
+                  (iy + static_cast<vtkIdType>(this->Dimensions[1]) * iz);
+                this->Writer->WritePoint(local, ptId, cellId);
+                this->Mask[ptId] = static_cast<char>(1);
+                }
+              }
+            }
+          }
+        }
+      }
+  }
+
+  void Reduce()
+  {
+  }
+};
+
+} // end anonymous namespace
+
 //----------------------------------------------------------------------------
 vtkProbeFilter::vtkProbeFilter()
 {
@@ -59,6 +511,8 @@ vtkProbeFilter::vtkProbeFilter()
   this->PassFieldArrays = 1;
   this->Tolerance = 1.0;
   this->ComputeTolerance = 1;
+
+  this->CellLocatorPrototype = NULL;
 }
 
 //----------------------------------------------------------------------------
@@ -76,6 +530,8 @@ vtkProbeFilter::~vtkProbeFilter()
 
   delete this->PointList;
   delete this->CellList;
+
+  this->SetCellLocatorPrototype(NULL);
 }
 
 //----------------------------------------------------------------------------
@@ -310,8 +766,19 @@ void vtkProbeFilter::ProbeEmptyPoints(vtkDataSet *input,
 
   vtkDebugMacro(<<"Probing data");
 
+  // Build the cell locator once for all the points.
+  vtkSmartPointer<vtkAbstractCellLocator> locator;
+  locator.TakeReference(NewCellLocator(this->CellLocatorPrototype, source));
+
+  if (this->ProbeEmptyPointsInParallel(input, srcIdx, source, output,
+                                       locator))
+    {
+    return;
+    }
+
   pd = source->GetPointData();
   cd = source->GetCellData();
+  vtkNew<vtkGenericCell> genericCell;
 
   // lets use a stack allocated array if possible for performance reasons
   int mcs = source->GetMaxCellSize();
@@ -355,10 +822,19 @@ void vtkProbeFilter::ProbeEmptyPoints(vtkDataSet *input,
     input->GetPoint(ptId, x);
 
     // Find the cell that contains xyz and get it
-    vtkIdType cellId = source->FindCell(x,NULL,-1,tol2,subId,pcoords,weights);
+    vtkIdType cellId = locator ?
+      locator->FindCell(x, tol2, genericCell.GetPointer(), pcoords, weights) :
+      source->FindCell(x,NULL,-1,tol2,subId,pcoords,weights);
     if (cellId >= 0)
       {
-      cell = source->GetCell(cellId);
+      if (locator)
+        {
+        cell = genericCell.GetPointer();
+        }
+      else
+        {
+        cell = source->GetCell(cellId);
+        }
       if (this->ComputeTolerance)
         {
         // If ComputeTolerance is set, compute a tolerance proportional to the
@@ -411,32 +887,99 @@ void vtkProbeFilter::ProbeEmptyPoints(vtkDataSet *input,
     }
 }
 
-static void GetPointIdsInRange(double rangeMin, double rangeMax, double start,
-  double stepsize, int numSteps, int &minid, int &maxid)
+//----------------------------------------------------------------------------
+bool vtkProbeFilter::ProbeEmptyPointsInParallel(vtkDataSet *input,
+  int srcIdx, vtkDataSet *source, vtkDataSet *output,
+  vtkAbstractCellLocator *locator)
 {
-  if (stepsize == 0)
+  if (!(vtkPointSet::SafeDownCast(input) ||
+        vtkRectilinearGrid::SafeDownCast(input)) ||
+      !IsThreadSafeSource(source))
     {
-    minid = maxid = 0;
-    return;
+    return false;
     }
 
-  minid = vtkMath::Ceil((rangeMin - start)/stepsize);
-  if (minid < 0)
+  vtkIdType numPts = input->GetNumberOfPoints();
+  vtkPointData *outPD = output->GetPointData();
+  ProbePointWriter writer;
+  if (!writer.Initialize(*this->PointList, srcIdx, source, outPD,
+                         *this->CellArrays, this->UseNullPoint, numPts))
     {
-    minid = 0;
+    return false;
     }
 
-  maxid = vtkMath::Floor((rangeMax - start)/stepsize);
-  if (maxid > numSteps-1)
+  ProbeEmptyPointsFunctor functor;
+  functor.Input = input;
+  functor.Source = source;
+  functor.Locator = locator;
+  functor.Writer = &writer;
+  functor.Mask = this->MaskPoints->GetPointer(0);
+  functor.Tol2 = this->ComputeTolerance ? VTK_DOUBLE_MAX :
+                 (this->Tolerance * this->Tolerance);
+  functor.ComputeTolerance = this->ComputeTolerance;
+  functor.UseNullPoint = this->UseNullPoint;
+
+  // Build the search structures of the source, or of the locator, with a
+  // first query before the threads share them.
+  BuildSourceCells(source, locator == NULL);
+  if (source->GetNumberOfPoints() > 0)
     {
-    maxid = numSteps-1;
+    double x[3];
+    source->GetPoint(0, x);
+    writer.InitializeLocal();
+    ProbeLocalData &local = writer.LocalData.Local();
+    double pcoords[3];
+    int subId;
+    if (locator)
+      {
+      locator->FindCell(x, functor.Tol2, local.Cell, pcoords,
+                        &local.Weights[0]);
+      }
+    else
+      {
+      source->FindCell(x, NULL, local.Cell, -1, functor.Tol2, subId, pcoords,
+                       &local.Weights[0]);
+      }
+    }
+
+  // Probe the points by batches to report progress and check for abort
+  // between the batches.
+  const vtkIdType numBatches = 10;
+  vtkIdType batchSize = numPts / numBatches + 1;
+  for (vtkIdType first = 0; first < numPts; first += batchSize)
+    {
+    vtkIdType last = std::min(first + batchSize, numPts);
+    vtkSMPTools::For(first, last, functor);
+    this->UpdateProgress(static_cast<double>(last) / numPts);
+    if (this->GetAbortExecute())
+      {
+      break;
+      }
+    }
+
+  // List the points found by this source in increasing order.
+  char *maskArray = functor.Mask;
+  for (vtkIdType ptId = 0; ptId < numPts; ++ptId)
+    {
+    if (maskArray[ptId] == static_cast<char>(2))
+      {
+      maskArray[ptId] = static_cast<char>(1);
+      this->ValidPoints->InsertNextValue(ptId);
+      this->NumberOfValidPoints++;
+      }
     }
+  return true;
 }
 
 //----------------------------------------------------------------------------
 void vtkProbeFilter::ProbePointsImageData(vtkImageData *input,
   int srcIdx, vtkDataSet *source, vtkImageData *output)
 {
+  if (this->ProbePointsImageDataInParallel(input, srcIdx, source, output))
+    {
+    return;
+    }
+
   double pcoords[3], *weights;
   double fastweights[256];
   std::vector<double> dynamicweights;
@@ -575,6 +1118,128 @@ void vtkProbeFilter::ProbePointsImageData(vtkImageData *input,
     }
 }
 
+//----------------------------------------------------------------------------
+bool vtkProbeFilter::ProbePointsImageDataInParallel(vtkImageData *input,
+  int srcIdx, vtkDataSet *source, vtkImageData *output)
+{
+  if (!IsThreadSafeSource(source))
+    {
+    return false;
+    }
+
+  vtkIdType numPts = input->GetNumberOfPoints();
+  vtkPointData *outPD = output->GetPointData();
+  ProbePointWriter writer;
+  if (!writer.Initialize(*this->PointList, srcIdx, source, outPD,
+                         *this->CellArrays, false, numPts))
+    {
+    return false;
+    }
+  BuildSourceCells(source, false);
+
+  double spacing[3];
+  input->GetSpacing(spacing);
+  int extent[6];
+  input->GetExtent(extent);
+  int dim[3];
+  input->GetDimensions(dim);
+  double start[3];
+  input->GetOrigin(start);
+  start[0] += static_cast<double>(extent[0]) * spacing[0];
+  start[1] += static_cast<double>(extent[2]) * spacing[1];
+  start[2] += static_cast<double>(extent[4]) * spacing[2];
+
+  // Find the points of the image in the bounds of each source cell.
+  vtkIdType numSrcCells = source->GetNumberOfCells();
+  std::vector<int> ranges(6 * numSrcCells + 1);
+  ImageCellRangesFunctor rangesFunctor;
+  rangesFunctor.Source = source;
+  rangesFunctor.Ranges = &ranges[0];
+  std::copy(start, start + 3, rangesFunctor.Start);
+  std::copy(spacing, spacing + 3, rangesFunctor.Spacing);
+  std::copy(dim, dim + 3, rangesFunctor.Dimensions);
+  vtkSMPTools::For(0, numSrcCells, rangesFunctor);
+
+  // List the cells overlapping each slice of the image, along its last
+  // non-flat axis, in increasing order.
+  int axis = dim[2] > 1 ? 2 : (dim[1] > 1 ? 1 : 0);
+  vtkIdType numSlices = dim[axis];
+  std::vector<vtkIdType> sliceOffsets(numSlices + 1, 0);
+  for (vtkIdType cellId = 0; cellId < numSrcCells; ++cellId)
+    {
+    const int *range = &ranges[6 * cellId];
+    if (range[1] >= range[0] && range[3] >= range[2] && range[5] >= range[4])
+      {
+      for (int slice = range[2 * axis]; slice <= range[2 * axis + 1]; ++slice)
+        {
+        sliceOffsets[slice + 1]++;
+        }
+      }
+    }
+  for (vtkIdType slice = 0; slice < numSlices; ++slice)
+    {
+    sliceOffsets[slice + 1] += sliceOffsets[slice];
+    }
+  std::vector<vtkIdType> sliceCells(sliceOffsets[numSlices] + 1);
+  std::vector<vtkIdType> sliceEnds(sliceOffsets.begin(), sliceOffsets.end() - 1);
+  for (vtkIdType cellId = 0; cellId < numSrcCells; ++cellId)
+    {
+    const int *range = &ranges[6 * cellId];
+    if (range[1] >= range[0] && range[3] >= range[2] && range[5] >= range[4])
+      {
+      for (int slice = range[2 * axis]; slice <= range[2 * axis + 1]; ++slice)
+        {
+        sliceCells[sliceEnds[slice]++] = cellId;
+        }
+      }
+    }
+
+  ProbeImageSlicesFunctor functor;
+  functor.Source = source;
+  functor.Writer = &writer;
+  functor.Mask = this->MaskPoints->GetPointer(0);
+  functor.Ranges = &ranges[0];
+  functor.SliceOffsets = &sliceOffsets[0];
+  functor.SliceCells = &sliceCells[0];
+  functor.Axis = axis;
+  std::copy(start, start + 3, functor.Start);
+  std::copy(spacing, spacing + 3, functor.Spacing);
+  std::copy(dim, dim + 3, functor.Dimensions);
+  functor.Tol2 = this->Tolerance * this->Tolerance;
+  functor.ComputeTolerance = this->ComputeTolerance;
+
+  // Probe the slices by batches to report progress and check for abort
+  // between the batches.
+  const vtkIdType numBatches = 10;
+  vtkIdType batchSize = numSlices / numBatches + 1;
+  for (vtkIdType first = 0; first < numSlices; first += batchSize)
+    {
+    vtkIdType last = std::min(first + batchSize, numSlices);
+    vtkSMPTools::For(first, last, functor);
+    this->UpdateProgress(static_cast<double>(last) / numSlices);
+    if (this->GetAbortExecute())
+      {
+      break;
+      }
+    }
+
+  // populate ValidPoints
+  char* maskArray = functor.Mask;
+  for (vtkIdType i = 0; i < numPts; ++i)
+    {
+    if (maskArray[i])
+      {
+      this->ValidPoints->InsertNextValue(i);
+      this->NumberOfValidPoints++;
+      }
+    else if (this->UseNullPoint)
+      {
+      outPD->NullPoint(i);
+      }
+    }
+  return true;
+}
+
 //----------------------------------------------------------------------------
 int vtkProbeFilter::RequestInformation(
   vtkInformation *vtkNotUsed(request),
@@ -732,4 +1397,6 @@ void vtkProbeFilter::PrintSelf(ostream& os, vtkIndent indent)
   os << indent << "ValidPoints: " << this->ValidPoints << "\n";
   os << indent << "PassFieldArrays: "
      << (this->PassFieldArrays? "On" : " Off") << "\n";
+  os << indent << "CellLocatorPrototype: " << this->CellLocatorPrototype
+     << "\n";
 }
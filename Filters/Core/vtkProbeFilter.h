@@ -31,6 +31,12 @@
 // rendering techniques can be used to visualize the results. Another example:
 // a line or curve can be used to probe data to produce x-y plots along
 // that line or curve.
+//
+// The points are probed on several threads with vtkSMPTools when the input
+// is a point set, a rectilinear grid or an image and the source is an
+// unstructured grid, a polydata, a rectilinear grid or an image. The search
+// structures of the source are built once before the threads start, and the
+// probed values are written directly to the output arrays.
 
 #ifndef vtkProbeFilter_h
 #define vtkProbeFilter_h
@@ -39,6 +45,7 @@
 #include "vtkDataSetAlgorithm.h"
 #include "vtkDataSetAttributes.h" // needed for vtkDataSetAttributes::FieldList
 
+class vtkAbstractCellLocator;
 class vtkIdTypeArray;
 class vtkCharArray;
 class vtkMaskPoints;
@@ -127,6 +134,17 @@ public:
   vtkBooleanMacro(ComputeTolerance, bool);
   vtkGetMacro(ComputeTolerance, bool);
 
+  // Description:
+  // Set/Get the prototype of the cell locator used to find the cells of
+  // point set sources that contain the probed points. A locator of the same
+  // type is built once for each source. When NULL, the default, the
+  // FindCell() method of the source is used instead. Since the points may be
+  // probed on several threads, the FindCell() method of the locator must be
+  // safe to call concurrently once the locator is built, as is the case for
+  // vtkCellLocator.
+  virtual void SetCellLocatorPrototype(vtkAbstractCellLocator*);
+  vtkGetObjectMacro(CellLocatorPrototype, vtkAbstractCellLocator);
+
 protected:
   vtkProbeFilter();
   ~vtkProbeFilter();
@@ -140,6 +158,8 @@ protected:
   double Tolerance;
   bool ComputeTolerance;
 
+  vtkAbstractCellLocator *CellLocatorPrototype;
+
   virtual int RequestData(vtkInformation *, vtkInformationVector **,
     vtkInformationVector *);
   virtual int RequestInformation(vtkInformation *, vtkInformationVector **,
@@ -197,6 +217,14 @@ private:
   void ProbePointsImageData(vtkImageData *input, int srcIdx, vtkDataSet *source,
     vtkImageData *output);
 
+  // Thread-parallel versions of the two methods above. They return false
+  // without probing anything when the datasets or the arrays cannot be
+  // accessed from several threads.
+  bool ProbeEmptyPointsInParallel(vtkDataSet *input, int srcIdx,
+    vtkDataSet *source, vtkDataSet *output, vtkAbstractCellLocator *locator);
+  bool ProbePointsImageDataInParallel(vtkImageData *input, int srcIdx,
+    vtkDataSet *source, vtkImageData *output);
+
   class vtkVectorOfArrays;
   vtkVectorOfArrays* CellArrays;
 
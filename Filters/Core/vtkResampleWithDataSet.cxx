@@ -99,6 +99,17 @@ bool vtkResampleWithDataSet::GetPassFieldArrays()
   return this->Prober->GetPassFieldArrays() ? true : false;
 }
 
+void vtkResampleWithDataSet::SetCellLocatorPrototype(
+  vtkAbstractCellLocator *locator)
+{
+  this->Prober->SetCellLocatorPrototype(locator);
+}
+
+vtkAbstractCellLocator* vtkResampleWithDataSet::GetCellLocatorPrototype()
+{
+  return this->Prober->GetCellLocatorPrototype();
+}
+
 //----------------------------------------------------------------------------
 vtkMTimeType vtkResampleWithDataSet::GetMTime()
 {
@@ -32,6 +32,7 @@
 #include "vtkNew.h" // For vtkCompositeDataProbeFilter member variable
 #include "vtkPassInputTypeAlgorithm.h"
 
+class vtkAbstractCellLocator;
 class vtkCompositeDataProbeFilter;
 class vtkDataSet;
 
@@ -78,6 +79,13 @@ public:
   bool GetPassFieldArrays();
   vtkBooleanMacro(PassFieldArrays, bool);
 
+  // Description:
+  // Set/Get the prototype of the cell locator used to find the cells of the
+  // source that contain the probed points.
+  // See vtkProbeFilter::SetCellLocatorPrototype().
+  void SetCellLocatorPrototype(vtkAbstractCellLocator *locator);
+  vtkAbstractCellLocator* GetCellLocatorPrototype();
+
   virtual vtkMTimeType GetMTime();
 
 protected:
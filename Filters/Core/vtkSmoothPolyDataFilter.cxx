@@ -25,10 +25,14 @@
 #include "vtkPointData.h"
 #include "vtkPolyData.h"
 #include "vtkPolygon.h"
+#include "vtkSMPThreadLocal.h"
+#include "vtkSMPTools.h"
 #include "vtkStreamingDemandDrivenPipeline.h"
 #include "vtkTriangleFilter.h"
 
+#include <algorithm>
 #include <limits>
+#include <vector>
 
 vtkStandardNewMacro(vtkSmoothPolyDataFilter);
 
@@ -128,6 +132,8 @@ vtkSmoothPolyDataFilter::vtkSmoothPolyDataFilter()
   this->GenerateErrorScalars = 0;
   this->GenerateErrorVectors = 0;
 
+  this->ParallelSmoothing = 0;
+
   this->OutputPointsPrecision = vtkAlgorithm::DEFAULT_PRECISION;
 
   this->SmoothPoints = NULL;
@@ -170,6 +176,64 @@ typedef struct _vtkMeshVertex
     }
 } vtkMeshVertex, *vtkMeshVertexPtr;
 
+// Moves each point that can be smoothed toward the mean position of its
+// connected points, reading the coordinates of the previous iteration so
+// that the points can be processed in any order.
+template<typename T> struct vtkSPDF_MovePointsFunctor
+{
+  const T *Points;
+  T *NewPoints;
+  const vtkIdType *Offsets;
+  const vtkIdType *Neighbors;
+  T Factor;
+  vtkSMPThreadLocal<T> MaxDist;
+
+  vtkSPDF_MovePointsFunctor() : MaxDist(0)
+  {
+  }
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    T &maxDist = this->MaxDist.Local();
+    T dist, deltaX[3];
+    for (vtkIdType i = begin; i < end; ++i)
+      {
+      const T *x = this->Points + 3 * i;
+      T *xNew = this->NewPoints + 3 * i;
+      vtkIdType npts = this->Offsets[i + 1] - this->Offsets[i];
+      if (npts == 0)
+        {
+        xNew[0] = x[0];
+        xNew[1] = x[1];
+        xNew[2] = x[2];
+        continue;
+        }
+
+      // Compute the mean (cumulated) direction vector
+      deltaX[0] = deltaX[1] = deltaX[2] = 0.0;
+      const vtkIdType *edgeIdPtr = this->Neighbors + this->Offsets[i];
+      for (vtkIdType j = 0; j < npts; ++j)
+        {
+        for (unsigned short k = 0; k < 3; ++k)
+          {
+          deltaX[k] += this->Points[3 * edgeIdPtr[j] + k];
+          }
+        }//for all connected points
+
+      // Move the point
+      for (unsigned short k = 0; k < 3; ++k)
+        {
+        xNew[k] = x[k] + this->Factor * (deltaX[k] / npts - x[k]);
+        }
+
+      if ((dist = vtkMath::Norm(deltaX)) > maxDist)
+        {
+        maxDist = dist;
+        }
+      }
+  }
+};
+
 template<typename T> struct vtkSPDF_InternalParams
 {
   vtkSmoothPolyDataFilter* spdf;
@@ -178,14 +242,19 @@ template<typename T> struct vtkSPDF_InternalParams
   T factor;
   T conv;
   vtkIdType numPts;
-  vtkMeshVertexPtr vertexPtr;
+  const vtkIdType *offsets;
+  const vtkIdType *neighbors;
   vtkPolyData *source;
   vtkSmoothPoints *SmoothPoints;
   double *w;
   vtkCellLocator *cellLocator;
+  bool parallel;
 };
 
-template<typename T> void vtkSPDF_MovePoints(vtkSPDF_InternalParams<T>& params)
+// Moves the points in place, in point order: each point is moved using the
+// coordinates already updated for the preceding points in the iteration.
+template<typename T> void vtkSPDF_MovePointsInPlace(
+  vtkSPDF_InternalParams<T>& params)
 {
   int iterationNumber = 0;
   for (T maxDist = std::numeric_limits<T>::max();
@@ -204,8 +273,8 @@ template<typename T> void vtkSPDF_MovePoints(vtkSPDF_InternalParams<T>& params)
     maxDist = 0.0;
     T* newPtsCoords = static_cast<T*>(params.newPts->GetVoidPointer(0));
     T* start = newPtsCoords;
-    vtkMeshVertexPtr vertsPtr = params.vertexPtr;
-    vtkIdType npts, *edgeIdPtr;
+    vtkIdType npts;
+    const vtkIdType *edgeIdPtr;
     T dist, deltaX[3];
     double dist2, xNew[3], closestPt[3];
 
@@ -213,11 +282,10 @@ template<typename T> void vtkSPDF_MovePoints(vtkSPDF_InternalParams<T>& params)
     // position of its connected neighbors using the relaxation factor.
     for (vtkIdType i = 0; i < params.numPts; ++i)
       {
-      if (vertsPtr->type != VTK_FIXED_VERTEX && vertsPtr->edges != NULL &&
-         (npts = vertsPtr->edges->GetNumberOfIds()) > 0)
+      if ((npts = params.offsets[i + 1] - params.offsets[i]) > 0)
         {
         deltaX[0] = deltaX[1] = deltaX[2] = 0.0;
-        edgeIdPtr = vertsPtr->edges->GetPointer(0);
+        edgeIdPtr = params.neighbors + params.offsets[i];
         // Compute the mean (cumulated) direction vector
         for (vtkIdType j = 0; j < npts; ++j)
           {
@@ -272,13 +340,113 @@ template<typename T> void vtkSPDF_MovePoints(vtkSPDF_InternalParams<T>& params)
           {
           newPtsCoords += 3;
           }
-        ++vertsPtr;
       }//for all points
     }//for not converged or within iteration count
 
   vtkDebugWithObjectMacro(params.spdf, << "Performed " << iterationNumber << " smoothing passes");
 }
 
+template<typename T> void vtkSPDF_MovePoints(vtkSPDF_InternalParams<T>& params)
+{
+  if (!params.parallel)
+    {
+    vtkSPDF_MovePointsInPlace(params);
+    return;
+    }
+
+  // The points are moved from one buffer to the other at each iteration.
+  std::vector<T> buffer(3 * params.numPts);
+  T *points = static_cast<T*>(params.newPts->GetVoidPointer(0));
+  T *newPoints = &buffer[0];
+
+  vtkSPDF_MovePointsFunctor<T> movePoints;
+  movePoints.Offsets = params.offsets;
+  movePoints.Neighbors = params.neighbors;
+  movePoints.Factor = params.factor;
+
+  int iterationNumber = 0;
+  for (T maxDist = std::numeric_limits<T>::max();
+       maxDist > params.conv && iterationNumber < params.numberOfIterations;
+       ++iterationNumber)
+    {
+    if (iterationNumber && !(iterationNumber % 5))
+      {
+      params.spdf->UpdateProgress(0.5 + 0.5*iterationNumber / params.numberOfIterations);
+      if (params.spdf->GetAbortExecute())
+        {
+        break;
+        }
+      }
+
+    // For each non-fixed vertex of the mesh, move the point toward the mean
+    // position of its connected neighbors using the relaxation factor.
+    movePoints.Points = points;
+    movePoints.NewPoints = newPoints;
+    for (typename vtkSMPThreadLocal<T>::iterator iter =
+           movePoints.MaxDist.begin();
+         iter != movePoints.MaxDist.end(); ++iter)
+      {
+      *iter = 0.0;
+      }
+    vtkSMPTools::For(0, params.numPts, movePoints);
+
+    maxDist = 0.0;
+    for (typename vtkSMPThreadLocal<T>::iterator iter =
+           movePoints.MaxDist.begin();
+         iter != movePoints.MaxDist.end(); ++iter)
+      {
+      maxDist = std::max(maxDist, *iter);
+      }
+
+    // Constrain the moved points to the surface. The cell locator cannot
+    // be used from several threads.
+    if (params.source)
+      {
+      double xNew[3], closestPt[3], dist2;
+      for (vtkIdType i = 0; i < params.numPts; ++i)
+        {
+        if (params.offsets[i + 1] == params.offsets[i])
+          {
+          continue;
+          }
+        T *newX = newPoints + 3 * i;
+        xNew[0] = newX[0];
+        xNew[1] = newX[1];
+        xNew[2] = newX[2];
+
+        vtkSmoothPoint *sPtr = params.SmoothPoints->GetSmoothPoint(i);
+        vtkCell *cell = NULL;
+
+        if (sPtr->cellId >= 0) //in cell
+          {
+          cell = params.source->GetCell(sPtr->cellId);
+          }
+
+        if (!cell || cell->EvaluatePosition(xNew, closestPt,
+            sPtr->subId, sPtr->p, dist2, params.w) == 0)
+          { // not in cell anymore
+          params.cellLocator->FindClosestPoint(xNew, closestPt, sPtr->cellId,
+                                               sPtr->subId, dist2);
+          }
+        for (int k = 0; k < 3; ++k)
+          {
+          newX[k] = static_cast<T>(closestPt[k]);
+          }
+        }
+      }
+
+    std::swap(points, newPoints);
+    }//for not converged or within iteration count
+
+  if (points != params.newPts->GetVoidPointer(0))
+    {
+    std::copy(buffer.begin(), buffer.end(),
+              static_cast<T*>(params.newPts->GetVoidPointer(0)));
+    }
+
+  vtkDebugWithObjectMacro(params.spdf, << "Performed " << iterationNumber << " smoothing passes");
+}
+
 }// namespace
 
 int vtkSmoothPolyDataFilter::RequestData(
@@ -629,6 +797,33 @@ int vtkSmoothPolyDataFilter::RequestData(
                 << numBEdges << " boundary edge vertices\n\t"
                 << numFixed << " fixed vertices\n\t");
 
+  // Gather the connected points of the vertices that can be smoothed in a
+  // compact array. Fixed vertices have no connected points.
+  std::vector<vtkIdType> offsets(numPts + 1);
+  std::vector<vtkIdType> neighbors;
+  offsets[0] = 0;
+  for (i=0; i<numPts; i++)
+    {
+    if ( Verts[i].type != VTK_FIXED_VERTEX && Verts[i].edges != NULL )
+      {
+      vtkIdType *edges = Verts[i].edges->GetPointer(0);
+      neighbors.insert(neighbors.end(), edges,
+                       edges + Verts[i].edges->GetNumberOfIds());
+      }
+    offsets[i+1] = static_cast<vtkIdType>(neighbors.size());
+    }
+
+  //free up connectivity storage
+  for (i=0; i<numPts; i++)
+    {
+    if ( Verts[i].edges != NULL )
+      {
+      Verts[i].edges->Delete();
+      Verts[i].edges = NULL;
+      }
+    }
+  delete [] Verts;
+
   vtkDebugMacro(<<"Beginning smoothing iterations...");
 
   // We've setup the topology...now perform Laplacian smoothing
@@ -679,12 +874,14 @@ int vtkSmoothPolyDataFilter::RequestData(
       }
     }
 
+  const vtkIdType *neighborsPtr = neighbors.empty() ? NULL : &neighbors[0];
   if (newPts->GetDataType() == VTK_DOUBLE)
     {
     vtkSPDF_InternalParams<double> params = { this, this->NumberOfIterations, newPts,
                                               this->RelaxationFactor, conv, numPts,
-                                              Verts, source, this->SmoothPoints,
-                                              w, cellLocator };
+                                              &offsets[0], neighborsPtr, source,
+                                              this->SmoothPoints, w, cellLocator,
+                                              this->ParallelSmoothing != 0 };
 
     vtkSPDF_MovePoints(params);
     }
@@ -692,8 +889,10 @@ int vtkSmoothPolyDataFilter::RequestData(
     {
     vtkSPDF_InternalParams<float> params = { this, this->NumberOfIterations, newPts,
                                              static_cast<float>(this->RelaxationFactor),
-                                             static_cast<float>(conv), numPts, Verts,
-                                             source, this->SmoothPoints, w, cellLocator };
+                                             static_cast<float>(conv), numPts,
+                                             &offsets[0], neighborsPtr, source,
+                                             this->SmoothPoints, w, cellLocator,
+                                             this->ParallelSmoothing != 0 };
 
     vtkSPDF_MovePoints(params);
     }
@@ -753,17 +952,6 @@ int vtkSmoothPolyDataFilter::RequestData(
   output->SetPolys(input->GetPolys());
   output->SetStrips(input->GetStrips());
 
-  //free up connectivity storage
-  for (i=0; i<numPts; i++)
-    {
-    if ( Verts[i].edges != NULL )
-      {
-      Verts[i].edges->Delete();
-      Verts[i].edges = NULL;
-      }
-    }
-  delete [] Verts;
-
   return 1;
 }
 
@@ -795,6 +983,7 @@ void vtkSmoothPolyDataFilter::PrintSelf(ostream& os, vtkIndent indent)
   os << indent << "Boundary Smoothing: " << (this->BoundarySmoothing ? "On\n" : "Off\n");
   os << indent << "Generate Error Scalars: " << (this->GenerateErrorScalars ? "On\n" : "Off\n");
   os << indent << "Generate Error Vectors: " << (this->GenerateErrorVectors ? "On\n" : "Off\n");
+  os << indent << "Parallel Smoothing: " << (this->ParallelSmoothing ? "On\n" : "Off\n");
   if ( this->GetSource() )
     {
       os << indent << "Source: " << static_cast<void *>(this->GetSource()) << "\n";
@@ -30,7 +30,10 @@
 // relaxation factor is available to control the amount of displacement of
 // v).  The process repeats for each vertex. This pass over the list of
 // vertices is a single iteration. Many iterations (generally around 20 or
-// so) are repeated until the desired result is obtained.
+// so) are repeated until the desired result is obtained. By default the
+// vertices are moved in place, in order; with ParallelSmoothing on, each
+// iteration computes the new coordinates of all the vertices from the
+// coordinates of the previous iteration, in parallel with vtkSMPTools.
 //
 // There are some special instance variables used to control the execution
 // of this filter. (These ivars basically control what vertices can be
@@ -164,6 +167,18 @@ public:
   vtkGetMacro(GenerateErrorVectors,int);
   vtkBooleanMacro(GenerateErrorVectors,int);
 
+  // Description:
+  // Turn on/off the parallel smoothing. When on, each iteration moves all
+  // the vertices from their positions at the previous iteration, in
+  // parallel. When off (the default), the vertices are moved in place in
+  // point order, each one using the new positions of the vertices moved
+  // before it in the iteration. The two results differ slightly; the
+  // parallel one does not depend on the order of the points. The
+  // projection onto the Source, if any, is always serial.
+  vtkSetMacro(ParallelSmoothing,int);
+  vtkGetMacro(ParallelSmoothing,int);
+  vtkBooleanMacro(ParallelSmoothing,int);
+
   // Description:
   // Specify the source object which is used to constrain smoothing. The
   // source defines a surface that the input (as it is smoothed) is
@@ -194,6 +209,7 @@ protected:
   int BoundarySmoothing;
   int GenerateErrorScalars;
   int GenerateErrorVectors;
+  int ParallelSmoothing;
   int OutputPointsPrecision;
 
   vtkSmoothPoints *SmoothPoints;
@@ -24,9 +24,12 @@
 #include "vtkPointData.h"
 #include "vtkPolyData.h"
 #include "vtkPolygon.h"
+#include "vtkSMPTools.h"
 #include "vtkTriangle.h"
 #include "vtkTriangleFilter.h"
 
+#include <vector>
+
 vtkStandardNewMacro(vtkWindowedSincPolyDataFilter);
 
 // Construct object with number of iterations 20; passband .1;
@@ -64,6 +67,149 @@ typedef struct _vtkMeshVertex
   vtkIdList *edges; // connected edges (list of connected point ids)
 } vtkMeshVertex, *vtkMeshVertexPtr;
 
+namespace
+{
+
+// Computes the first iteration of the filter: the Laplacian of the points
+// in One and the first terms of the smoothed points in Three.
+struct vtkWSPDF_FirstIteration
+{
+  const float *Zero;
+  float *One;
+  float *Three;
+  const vtkIdType *Offsets;
+  const vtkIdType *Neighbors;
+  const char *Types;
+  const double *C;
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    double x[3], deltaX[3];
+    for (vtkIdType i = begin; i < end; i++)
+      {
+      vtkIdType npts = this->Offsets[i+1] - this->Offsets[i];
+      const float *x0 = this->Zero + 3*i;
+      float *x1 = this->One + 3*i;
+      float *x3 = this->Three + 3*i;
+      if ( npts > 0 )
+        {
+        // point is allowed to move
+        const vtkIdType *edges = this->Neighbors + this->Offsets[i];
+        deltaX[0] = deltaX[1] = deltaX[2] = 0.0;
+        for (int k=0; k<3; k++)
+          {
+          x[k] = x0[k]; //use current points
+          }
+
+        // calculate the negative of the laplacian
+        for (vtkIdType j=0; j<npts; j++) //for all connected points
+          {
+          const float *y = this->Zero + 3*edges[j];
+          for (int k=0; k<3; k++)
+            {
+            deltaX[k] += (x[k] - y[k]) / npts;
+            }
+          }
+        // newPts[one] = newPts[zero] - 0.5 newPts[one]
+        for (int k=0; k<3; k++)
+          {
+          deltaX[k] = x[k] - 0.5*deltaX[k];
+          x1[k] = static_cast<float>(deltaX[k]);
+          }
+
+        // calculate newPts[three] = c0 newPts[zero] + c1 newPts[one]
+        for (int k=0; k < 3; k++)
+          {
+          deltaX[k] = this->C[0]*x[k] + this->C[1]*deltaX[k];
+          x3[k] = this->Types[i] == VTK_FIXED_VERTEX ?
+            x0[k] : static_cast<float>(deltaX[k]);
+          }
+        }//if can move point
+      else
+        {
+        // point is not allowed to move, just use the old point...
+        // (zero out the Laplacian)
+        for (int k=0; k<3; k++)
+          {
+          x1[k] = 0.0f;
+          x3[k] = x0[k];
+          }
+        }
+      }//for all points
+  }
+};
+
+// Computes one of the following iterations of the filter from the points
+// of the two previous ones, Zero and One, into Two, and accumulates the
+// smoothed points in Three.
+struct vtkWSPDF_Iteration
+{
+  const float *Zero;
+  const float *One;
+  float *Two;
+  float *Three;
+  const vtkIdType *Offsets;
+  const vtkIdType *Neighbors;
+  const char *Types;
+  double C;
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    double p_x0[3], p_x1[3], deltaX[3];
+    for (vtkIdType i = begin; i < end; i++)
+      {
+      vtkIdType npts = this->Offsets[i+1] - this->Offsets[i];
+      float *x2 = this->Two + 3*i;
+      if ( npts > 0 )
+        {
+        // point is allowed to move
+        const vtkIdType *edges = this->Neighbors + this->Offsets[i];
+        for (int k=0; k<3; k++)
+          {
+          p_x0[k] = this->Zero[3*i+k]; //use current points
+          p_x1[k] = this->One[3*i+k];
+          }
+        deltaX[0] = deltaX[1] = deltaX[2] = 0.0;
+
+        // calculate the negative laplacian of x1
+        for (vtkIdType j=0; j<npts; j++)
+          {
+          const float *y = this->One + 3*edges[j];
+          for (int k=0; k<3; k++)
+            {
+            deltaX[k] += (p_x1[k] - y[k]) / npts;
+            }
+          }//for all connected points
+
+        // Taubin:  x2 = (x1 - x0) + (x1 - x2)
+        for (int k=0; k<3; k++)
+          {
+          deltaX[k] = p_x1[k] - p_x0[k] + p_x1[k] - deltaX[k];
+          x2[k] = static_cast<float>(deltaX[k]);
+          }
+
+        // smooth the vertex (x3 = x3 + cj x2)
+        if (this->Types[i] != VTK_FIXED_VERTEX)
+          {
+          float *x3 = this->Three + 3*i;
+          for (int k=0;k<3;k++)
+            {
+            x3[k] = static_cast<float>(x3[k] + this->C * deltaX[k]);
+            }
+          }
+        }//if can move point
+      else
+        {
+        // point is not allowed to move, (zero out the Laplacian). Its
+        // Laplacian in One was zeroed by the previous iteration.
+        x2[0] = x2[1] = x2[2] = 0.0f;
+        }
+      }//for all points
+  }
+};
+
+}
+
 int vtkWindowedSincPolyDataFilter::RequestData(
   vtkInformation *vtkNotUsed(request),
   vtkInformationVector **inputVector,
@@ -84,7 +230,6 @@ int vtkWindowedSincPolyDataFilter::RequestData(
   vtkIdType npts = 0;
   vtkIdType *pts = 0;
   vtkIdType p1, p2;
-  double x[3], y[3], deltaX[3], xNew[3];
   double x1[3], x2[3], x3[3], l1[3], l2[3];
   double CosFeatureAngle; //Cosine of angle between adjacent polys
   double CosEdgeAngle; // Cosine of angle between adjacent edges
@@ -98,7 +243,7 @@ int vtkWindowedSincPolyDataFilter::RequestData(
   vtkMeshVertexPtr Verts;
 
   // variables specific to windowed sinc interpolation
-  double theta_pb, k_pb, sigma, p_x0[3], p_x1[3], p_x3[3];
+  double theta_pb, k_pb, sigma;
   double *w, *c, *cprime;
   int zero, one, two, three;
 
@@ -428,6 +573,30 @@ int vtkWindowedSincPolyDataFilter::RequestData(
                 << numFEdges << " feature edge vertices\n\t"
                 << numBEdges << " boundary edge vertices\n\t"
                 << numFixed << " fixed vertices\n\t");
+  // Gather the connected points of the vertices in a compact array.
+  std::vector<vtkIdType> offsets(numPts + 1);
+  std::vector<vtkIdType> neighbors;
+  std::vector<char> types(numPts);
+  offsets[0] = 0;
+  for (i=0; i<numPts; i++)
+    {
+    types[i] = Verts[i].type;
+    if ( Verts[i].edges != NULL )
+      {
+      vtkIdType *edges = Verts[i].edges->GetPointer(0);
+      neighbors.insert(neighbors.end(), edges,
+                       edges + Verts[i].edges->GetNumberOfIds());
+      }
+    offsets[i+1] = static_cast<vtkIdType>(neighbors.size());
+    }
+
+  //free up connectivity storage
+  for (i=0; i<numPts; i++)
+    {
+    if ( Verts[i].edges != NULL ) {Verts[i].edges->Delete();}
+    }
+  delete [] Verts;
+
 //
 // Perform Windowed Sinc function interpolation
 //
@@ -490,9 +659,6 @@ int vtkWindowedSincPolyDataFilter::RequestData(
   c = new double[this->NumberOfIterations+1];
   cprime = new double[this->NumberOfIterations+1];
 
-  double zerovector[3];
-  zerovector[0] = zerovector[1] = zerovector[2] = 0.0;
-
   //
   // Calculate the weights and the Chebychev coefficients c.
   //
@@ -578,56 +744,30 @@ int vtkWindowedSincPolyDataFilter::RequestData(
     vtkErrorMacro(<< "An optimal offset for the smoothing filter could not be found.  Unpredictable smoothing/shrinkage may result.");
     }
 
-  // first iteration
-  for (i=0; i<numPts; i++)
-    {
-    if ( Verts[i].edges != NULL &&
-         (npts = Verts[i].edges->GetNumberOfIds()) > 0 )
-      {
-      // point is allowed to move
-      newPts[zero]->GetPoint(i, x); //use current points
-      deltaX[0] = deltaX[1] = deltaX[2] = 0.0;
-
-      // calculate the negative of the laplacian
-      for (j=0; j<npts; j++) //for all connected points
-        {
-        newPts[zero]->GetPoint(Verts[i].edges->GetId(j), y);
-        for (k=0; k<3; k++)
-          {
-          deltaX[k] += (x[k] - y[k]) / npts;
-          }
-        }
-      // newPts[one] = newPts[zero] - 0.5 newPts[one]
-      for (k=0; k<3; k++)
-        {
-        deltaX[k] = x[k] - 0.5*deltaX[k];
-        }
-      newPts[one]->SetPoint(i, deltaX);
+  float *pts0 = static_cast<float*>(newPts[0]->GetVoidPointer(0));
+  float *pts1 = static_cast<float*>(newPts[1]->GetVoidPointer(0));
+  float *pts2 = static_cast<float*>(newPts[2]->GetVoidPointer(0));
+  float *pts3 = static_cast<float*>(newPts[3]->GetVoidPointer(0));
+  float *ptsArray[3] = { pts0, pts1, pts2 };
+  const vtkIdType *neighborsPtr = neighbors.empty() ? NULL : &neighbors[0];
 
-      // calculate newPts[three] = c0 newPts[zero] + c1 newPts[one]
-      for (k=0; k < 3; k++)
-        {
-        deltaX[k] = c[0]*x[k] + c[1]*deltaX[k];
-        }
-      if (Verts[i].type == VTK_FIXED_VERTEX)
-        {
-        newPts[three]->SetPoint(i, newPts[zero]->GetPoint(i));
-        }
-      else
-        {
-        newPts[three]->SetPoint(i, deltaX);
-        }
-      }//if can move point
-    else
-      {
-      // point is not allowed to move, just use the old point...
-      // (zero out the Laplacian)
-      newPts[one]->SetPoint(i, zerovector);
-      newPts[three]->SetPoint(i, newPts[zero]->GetPoint(i));
-      }
-    }//for all points
+  // first iteration
+  vtkWSPDF_FirstIteration firstIteration;
+  firstIteration.Zero = ptsArray[zero];
+  firstIteration.One = ptsArray[one];
+  firstIteration.Three = pts3;
+  firstIteration.Offsets = &offsets[0];
+  firstIteration.Neighbors = neighborsPtr;
+  firstIteration.Types = &types[0];
+  firstIteration.C = c;
+  vtkSMPTools::For(0, numPts, firstIteration);
 
   // for the rest of the iterations
+  vtkWSPDF_Iteration iteration;
+  iteration.Three = pts3;
+  iteration.Offsets = &offsets[0];
+  iteration.Neighbors = neighborsPtr;
+  iteration.Types = &types[0];
   for ( iterationNumber=2;
         iterationNumber <= this->NumberOfIterations;
         iterationNumber++ )
@@ -641,53 +781,11 @@ int vtkWindowedSincPolyDataFilter::RequestData(
         }
       }
 
-    for (i=0; i<numPts; i++)
-      {
-      if ( Verts[i].edges != NULL &&
-           (npts = Verts[i].edges->GetNumberOfIds()) > 0 )
-        {
-        // point is allowed to move
-        newPts[zero]->GetPoint(i, p_x0); //use current points
-        newPts[one]->GetPoint(i, p_x1);
-
-        deltaX[0] = deltaX[1] = deltaX[2] = 0.0;
-
-        // calculate the negative laplacian of x1
-        for (j=0; j<npts; j++)
-          {
-          newPts[one]->GetPoint(Verts[i].edges->GetId(j), y);
-          for (k=0; k<3; k++)
-            {
-            deltaX[k] += (p_x1[k] - y[k]) / npts;
-            }
-          }//for all connected points
-
-        // Taubin:  x2 = (x1 - x0) + (x1 - x2)
-        for (k=0; k<3; k++)
-          {
-          deltaX[k] = p_x1[k] - p_x0[k] + p_x1[k] - deltaX[k];
-          }
-        newPts[two]->SetPoint(i, deltaX);
-
-        // smooth the vertex (x3 = x3 + cj x2)
-        newPts[three]->GetPoint(i, p_x3);
-        for (k=0;k<3;k++)
-          {
-          xNew[k] = p_x3[k] + c[iterationNumber] * deltaX[k];
-          }
-        if (Verts[i].type != VTK_FIXED_VERTEX)
-          {
-          newPts[three]->SetPoint(i,xNew);
-          }
-        }//if can move point
-      else
-        {
-        // point is not allowed to move, just use the old point...
-        // (zero out the Laplacian)
-        newPts[one]->SetPoint(i, zerovector);
-        newPts[two]->SetPoint(i, zerovector);
-        }
-      }//for all points
+    iteration.Zero = ptsArray[zero];
+    iteration.One = ptsArray[one];
+    iteration.Two = ptsArray[two];
+    iteration.C = c[iterationNumber];
+    vtkSMPTools::For(0, numPts, iteration);
 
     // update the pointers. three is always three. all other pointers
     // shift by one and wrap.
@@ -782,13 +880,6 @@ int vtkWindowedSincPolyDataFilter::RequestData(
   // finally delete the constructed (local) mesh
   inMesh->Delete();
 
-  //free up connectivity storage
-  for (i=0; i<numPts; i++)
-    {
-    if ( Verts[i].edges != NULL ) {Verts[i].edges->Delete();}
-    }
-  delete [] Verts;
-
   return 1;
 }
 
@@ -27,7 +27,10 @@
 // constructed for each vertex. (The connectivity array is a list of lists
 // of vertices that directly attach to each vertex.) Next, an iteration
 // phase begins over all vertices. For each vertex v, the coordinates of v
-// are modified using a windowed sinc function interpolation kernel.
+// are modified using a windowed sinc function interpolation kernel. The
+// vertices are processed in parallel with vtkSMPTools; each iteration only
+// reads the coordinates computed by the previous ones, so the result does
+// not depend on the number of threads.
 // Taubin describes this methodology is the IBM tech report RC-20404
 // (#90237, dated 3/12/96) "Optimal Surface Smoothing as Filter Design"
 // G. Taubin, T. Zhang and G. Golub. (Zhang and Golub are at Stanford
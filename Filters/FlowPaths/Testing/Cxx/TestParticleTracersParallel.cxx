@@ -0,0 +1,320 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    TestParticleTracersParallel.cxx
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+// Compares the particle tracers run serially and in parallel, forcing the
+// parallel integration whatever the number of threads. The particles are
+// advected in an unsteady field defined on an unstructured grid, which some
+// of them leave or stagnate in.
+
+#include "vtkCellArray.h"
+#include "vtkFloatArray.h"
+#include "vtkInformation.h"
+#include "vtkInformationVector.h"
+#include "vtkMath.h"
+#include "vtkNew.h"
+#include "vtkObjectFactory.h"
+#include "vtkParticlePathFilter.h"
+#include "vtkParticleTracer.h"
+#include "vtkPointData.h"
+#include "vtkPointSource.h"
+#include "vtkPoints.h"
+#include "vtkPolyData.h"
+#include "vtkSMPTools.h"
+#include "vtkSmartPointer.h"
+#include "vtkStreaklineFilter.h"
+#include "vtkStreamingDemandDrivenPipeline.h"
+#include "vtkUnstructuredGrid.h"
+#include "vtkUnstructuredGridAlgorithm.h"
+
+namespace
+{
+
+const int Resolution = 8;
+
+vtkIdType PointId(int i, int j, int k)
+{
+  return i + (Resolution + 1) * (j + (Resolution + 1) * k);
+}
+
+}
+
+// A grid of hexahedra and tetrahedra on [-1,1]^3 with a velocity field
+// spiralling out of the y axis, whose speed grows with time.
+class TestUnsteadyGridSource : public vtkUnstructuredGridAlgorithm
+{
+public:
+  static TestUnsteadyGridSource *New();
+  vtkTypeMacro(TestUnsteadyGridSource, vtkUnstructuredGridAlgorithm);
+
+protected:
+  TestUnsteadyGridSource()
+  {
+    this->SetNumberOfInputPorts(0);
+  }
+
+  int RequestInformation(vtkInformation *, vtkInformationVector **,
+                         vtkInformationVector *outputVector) VTK_OVERRIDE
+  {
+    vtkInformation *outInfo = outputVector->GetInformationObject(0);
+    double timeSteps[6] = { 0, 1, 2, 3, 4, 5 };
+    double range[2] = { 0, 5 };
+    outInfo->Set(vtkStreamingDemandDrivenPipeline::TIME_STEPS(),
+                 timeSteps, 6);
+    outInfo->Set(vtkStreamingDemandDrivenPipeline::TIME_RANGE(), range, 2);
+    return 1;
+  }
+
+  int RequestData(vtkInformation *, vtkInformationVector **,
+                  vtkInformationVector *outputVector) VTK_OVERRIDE
+  {
+    vtkInformation *outInfo = outputVector->GetInformationObject(0);
+    vtkUnstructuredGrid *output = vtkUnstructuredGrid::SafeDownCast(
+      outInfo->Get(vtkDataObject::DATA_OBJECT()));
+    double time = outInfo->Get(
+      vtkStreamingDemandDrivenPipeline::UPDATE_TIME_STEP());
+    output->GetInformation()->Set(vtkDataObject::DATA_TIME_STEP(), time);
+
+    vtkNew<vtkPoints> points;
+    vtkNew<vtkFloatArray> velocity;
+    velocity->SetName("Velocity");
+    velocity->SetNumberOfComponents(3);
+    vtkNew<vtkFloatArray> scalars;
+    scalars->SetName("Scalars");
+    double speed = 0.2 * (time + 1.0);
+    for (int k = 0; k <= Resolution; k++)
+      {
+      for (int j = 0; j <= Resolution; j++)
+        {
+        for (int i = 0; i <= Resolution; i++)
+          {
+          double x[3] = { 2.0 * i / Resolution - 1.0,
+                          2.0 * j / Resolution - 1.0,
+                          2.0 * k / Resolution - 1.0 };
+          points->InsertNextPoint(x);
+          velocity->InsertNextTuple3((0.3 * x[0] - x[2]) * speed,
+                                     0.3 * x[0] * speed,
+                                     (x[0] + 0.3 * x[2]) * speed);
+          scalars->InsertNextValue(x[0] + time * x[1]);
+          }
+        }
+      }
+    output->SetPoints(points.GetPointer());
+    output->GetPointData()->SetVectors(velocity.GetPointer());
+    output->GetPointData()->AddArray(scalars.GetPointer());
+
+    output->Allocate(Resolution * Resolution * Resolution);
+    for (int k = 0; k < Resolution; k++)
+      {
+      for (int j = 0; j < Resolution; j++)
+        {
+        for (int i = 0; i < Resolution; i++)
+          {
+          vtkIdType hex[8] = {
+            PointId(i, j, k), PointId(i + 1, j, k),
+            PointId(i + 1, j + 1, k), PointId(i, j + 1, k),
+            PointId(i, j, k + 1), PointId(i + 1, j, k + 1),
+            PointId(i + 1, j + 1, k + 1), PointId(i, j + 1, k + 1) };
+          if ((i + j + k) % 4 == 0)
+            {
+            // split the hexahedron in five tetrahedra
+            vtkIdType tets[5][4] = {
+              { hex[0], hex[1], hex[3], hex[4] },
+              { hex[1], hex[2], hex[3], hex[6] },
+              { hex[1], hex[4], hex[5], hex[6] },
+              { hex[3], hex[4], hex[6], hex[7] },
+              { hex[1], hex[3], hex[4], hex[6] } };
+            for (int t = 0; t < 5; t++)
+              {
+              output->InsertNextCell(VTK_TETRA, 4, tets[t]);
+              }
+            }
+          else
+            {
+            output->InsertNextCell(VTK_HEXAHEDRON, 8, hex);
+            }
+          }
+        }
+      }
+    return 1;
+  }
+
+private:
+  TestUnsteadyGridSource(const TestUnsteadyGridSource&) VTK_DELETE_FUNCTION;
+  void operator=(const TestUnsteadyGridSource&) VTK_DELETE_FUNCTION;
+};
+
+vtkStandardNewMacro(TestUnsteadyGridSource);
+
+namespace
+{
+
+bool CompareArrays(vtkDataArray *a, vtkDataArray *b)
+{
+  if (!a || !b || a->GetNumberOfTuples() != b->GetNumberOfTuples() ||
+      a->GetNumberOfComponents() != b->GetNumberOfComponents())
+    {
+    return false;
+    }
+  for (vtkIdType i = 0; i < a->GetNumberOfTuples(); i++)
+    {
+    for (int c = 0; c < a->GetNumberOfComponents(); c++)
+      {
+      if (a->GetComponent(i, c) != b->GetComponent(i, c))
+        {
+        return false;
+        }
+      }
+    }
+  return true;
+}
+
+bool CompareOutputs(vtkPolyData *a, vtkPolyData *b)
+{
+  if (a->GetNumberOfPoints() != b->GetNumberOfPoints() ||
+      a->GetNumberOfVerts() != b->GetNumberOfVerts() ||
+      a->GetNumberOfLines() != b->GetNumberOfLines())
+    {
+    cerr << "Expected " << a->GetNumberOfPoints() << " points and "
+         << a->GetNumberOfCells() << " cells, got " << b->GetNumberOfPoints()
+         << " points and " << b->GetNumberOfCells() << " cells" << endl;
+    return false;
+    }
+  if (!CompareArrays(a->GetPoints()->GetData(), b->GetPoints()->GetData()) ||
+      !CompareArrays(a->GetVerts()->GetData(), b->GetVerts()->GetData()) ||
+      !CompareArrays(a->GetLines()->GetData(), b->GetLines()->GetData()))
+    {
+    cerr << "Different points or cells" << endl;
+    return false;
+    }
+  vtkPointData *pdA = a->GetPointData();
+  vtkPointData *pdB = b->GetPointData();
+  if (pdA->GetNumberOfArrays() != pdB->GetNumberOfArrays())
+    {
+    cerr << "Different number of point arrays" << endl;
+    return false;
+    }
+  for (int i = 0; i < pdA->GetNumberOfArrays(); i++)
+    {
+    vtkDataArray *array = pdA->GetArray(i);
+    if (!CompareArrays(array, pdB->GetArray(array->GetName())))
+      {
+      cerr << "Different array " << array->GetName() << endl;
+      return false;
+      }
+    }
+  return true;
+}
+
+// Exposes the parallel integration settings of a particle tracer.
+template <class TTracer>
+class TestParallelTracer : public TTracer
+{
+public:
+  static TestParallelTracer *New()
+    {
+    VTK_STANDARD_NEW_BODY(TestParallelTracer)
+    }
+  vtkTypeMacro(TestParallelTracer, TTracer);
+
+  void SetForceParallelIntegration(int force)
+    {
+    this->ForceParallelIntegration = force;
+    }
+  vtkIdType GetNumberOfParallelAdvections()
+    {
+    return this->NumberOfParallelAdvections;
+    }
+
+protected:
+  TestParallelTracer() {}
+
+private:
+  TestParallelTracer(const TestParallelTracer&) VTK_DELETE_FUNCTION;
+  void operator=(const TestParallelTracer&) VTK_DELETE_FUNCTION;
+};
+
+template <class TTracer>
+vtkSmartPointer<vtkPolyData> RunTracer(int numThreads, int reinjection,
+                                       bool staticMesh, bool vorticity,
+                                       vtkIdType &numParallelAdvections)
+{
+  vtkSMPTools::Initialize(numThreads);
+
+  vtkNew<TestUnsteadyGridSource> source;
+  vtkMath::RandomSeed(5678);
+  vtkNew<vtkPointSource> seeds;
+  seeds->SetCenter(0.2, 0.0, 0.1);
+  seeds->SetRadius(0.8);
+  seeds->SetNumberOfPoints(100);
+
+  vtkNew<TestParallelTracer<TTracer> > tracer;
+  tracer->SetInputConnection(0, source->GetOutputPort());
+  tracer->SetInputConnection(1, seeds->GetOutputPort());
+  tracer->SetStaticMesh(staticMesh);
+  tracer->SetComputeVorticity(vorticity);
+  tracer->SetTerminalSpeed(0.05);
+  tracer->SetStartTime(0.0);
+  tracer->SetTerminationTime(4.5);
+  tracer->SetForceReinjectionEveryNSteps(reinjection);
+  tracer->SetForceParallelIntegration(numThreads > 1);
+  tracer->Update();
+  numParallelAdvections = tracer->GetNumberOfParallelAdvections();
+
+  vtkSmartPointer<vtkPolyData> output = vtkSmartPointer<vtkPolyData>::New();
+  output->DeepCopy(tracer->GetOutput());
+  return output;
+}
+
+template <class TTracer>
+bool TestTracer(const char *name, int reinjection)
+{
+  for (int test = 0; test < 4; test++)
+    {
+    bool staticMesh = (test & 1) != 0;
+    bool vorticity = (test & 2) != 0;
+    vtkIdType numSerial, numParallel;
+    vtkSmartPointer<vtkPolyData> serial = RunTracer<TTracer>(
+      1, reinjection, staticMesh, vorticity, numSerial);
+    vtkSmartPointer<vtkPolyData> parallel = RunTracer<TTracer>(
+      4, reinjection, staticMesh, vorticity, numParallel);
+    if (numSerial != 0 || numParallel == 0)
+      {
+      cerr << name << " advected " << numSerial << " and "
+           << numParallel << " particles in parallel" << endl;
+      return false;
+      }
+    if (serial->GetNumberOfPoints() == 0 ||
+        !CompareOutputs(serial, parallel))
+      {
+      cerr << "Failed for " << name << " with static mesh "
+           << staticMesh << " and vorticity " << vorticity << endl;
+      return false;
+      }
+    }
+  return true;
+}
+
+}
+
+int TestParticleTracersParallel(int, char *[])
+{
+  if (!TestTracer<vtkParticleTracer>("vtkParticleTracer", 0) ||
+      !TestTracer<vtkParticlePathFilter>("vtkParticlePathFilter", 0) ||
+      !TestTracer<vtkStreaklineFilter>("vtkStreaklineFilter", 2))
+    {
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
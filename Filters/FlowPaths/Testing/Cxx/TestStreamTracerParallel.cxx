@@ -0,0 +1,319 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    TestStreamTracerParallel.cxx
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+// Compares the streamlines of many seeds integrated in parallel with the
+// streamlines of the same seeds integrated one at a time, which must be
+// identical and in seed order.
+
+#include "vtkCellArray.h"
+#include "vtkCellData.h"
+#include "vtkDataArray.h"
+#include "vtkDoubleArray.h"
+#include "vtkIdList.h"
+#include "vtkImageData.h"
+#include "vtkIntArray.h"
+#include "vtkMath.h"
+#include "vtkMultiBlockDataSet.h"
+#include "vtkNew.h"
+#include "vtkPointData.h"
+#include "vtkPoints.h"
+#include "vtkPolyData.h"
+#include "vtkSmartPointer.h"
+#include "vtkSMPTools.h"
+#include "vtkStreamTracer.h"
+#include "vtkUnstructuredGrid.h"
+
+#include <vector>
+
+namespace
+{
+
+const int Resolution = 10;
+
+// A swirl around the z axis with some vertical motion.
+void AddVelocity(vtkDataSet *ds)
+{
+  vtkNew<vtkDoubleArray> velocity;
+  velocity->SetName("Velocity");
+  velocity->SetNumberOfComponents(3);
+  velocity->SetNumberOfTuples(ds->GetNumberOfPoints());
+  vtkNew<vtkDoubleArray> scalars;
+  scalars->SetName("Scalars");
+  scalars->SetNumberOfTuples(ds->GetNumberOfPoints());
+  for (vtkIdType i = 0; i < ds->GetNumberOfPoints(); i++)
+    {
+    double x[3];
+    ds->GetPoint(i, x);
+    velocity->SetTuple3(i, 0.5 - x[1], x[0] - 0.5, 0.3 * sin(5.0 * x[0]));
+    scalars->SetValue(i, x[0] * x[1] + x[2]);
+    }
+  ds->GetPointData()->SetVectors(velocity.GetPointer());
+  ds->GetPointData()->AddArray(scalars.GetPointer());
+}
+
+vtkSmartPointer<vtkImageData> MakeImage(int xmin, int xmax)
+{
+  vtkSmartPointer<vtkImageData> image = vtkSmartPointer<vtkImageData>::New();
+  image->SetExtent(xmin, xmax, 0, Resolution, 0, Resolution);
+  image->SetSpacing(1.0 / Resolution, 1.0 / Resolution, 1.0 / Resolution);
+  AddVelocity(image);
+  return image;
+}
+
+vtkSmartPointer<vtkUnstructuredGrid> MakeGrid()
+{
+  vtkSmartPointer<vtkImageData> image = MakeImage(0, Resolution);
+  vtkSmartPointer<vtkUnstructuredGrid> grid =
+    vtkSmartPointer<vtkUnstructuredGrid>::New();
+  vtkNew<vtkPoints> points;
+  points->SetNumberOfPoints(image->GetNumberOfPoints());
+  for (vtkIdType i = 0; i < image->GetNumberOfPoints(); i++)
+    {
+    points->SetPoint(i, image->GetPoint(i));
+    }
+  grid->SetPoints(points.GetPointer());
+  grid->Allocate(image->GetNumberOfCells());
+  vtkNew<vtkIdList> ptIds;
+  for (vtkIdType i = 0; i < image->GetNumberOfCells(); i++)
+    {
+    image->GetCellPoints(i, ptIds.GetPointer());
+    grid->InsertNextCell(VTK_VOXEL, ptIds.GetPointer());
+    }
+  AddVelocity(grid);
+  return grid;
+}
+
+// Random seeds away from the boundary, and a few out of the domain.
+vtkSmartPointer<vtkPolyData> MakeSeeds(int numSeeds)
+{
+  vtkSmartPointer<vtkPolyData> seeds = vtkSmartPointer<vtkPolyData>::New();
+  vtkNew<vtkPoints> points;
+  for (int i = 0; i < numSeeds; i++)
+    {
+    points->InsertNextPoint(i % 8 == 3 ? -0.5 : vtkMath::Random(0.2, 0.8),
+                            vtkMath::Random(0.2, 0.8),
+                            vtkMath::Random(0.2, 0.8));
+    }
+  seeds->SetPoints(points.GetPointer());
+  return seeds;
+}
+
+void SetupTracer(vtkStreamTracer *tracer, vtkDataObject *input,
+                 int interpolatorType)
+{
+  tracer->SetInputData(input);
+  tracer->SetInterpolatorType(interpolatorType);
+  tracer->SetIntegratorTypeToRungeKutta45();
+  tracer->SetMaximumPropagation(3.0);
+  tracer->SetInitialIntegrationStep(0.2);
+  tracer->SetComputeVorticity(true);
+}
+
+void Append(vtkAbstractArray *to, vtkAbstractArray *from)
+{
+  to->InsertTuples(to->GetNumberOfTuples(), from->GetNumberOfTuples(), 0,
+                   from);
+}
+
+// Integrates the seeds one at a time in each direction and appends the
+// streamlines in the order of the parallel integration.
+void IntegrateSeeds(vtkDataObject *input, vtkPolyData *seeds,
+                    int interpolatorType, vtkPolyData *expected)
+{
+  vtkNew<vtkPoints> points;
+  vtkNew<vtkCellArray> lines;
+  vtkNew<vtkIntArray> reasons;
+  std::vector<vtkSmartPointer<vtkAbstractArray> > pointArrays;
+  std::vector<int> seedIds;
+  int directions[2] = { vtkStreamTracer::FORWARD, vtkStreamTracer::BACKWARD };
+  for (int d = 0; d < 2; d++)
+    {
+    for (vtkIdType i = 0; i < seeds->GetNumberOfPoints(); i++)
+      {
+      vtkNew<vtkPolyData> seed;
+      vtkNew<vtkPoints> seedPoints;
+      seedPoints->InsertNextPoint(seeds->GetPoint(i));
+      seed->SetPoints(seedPoints.GetPointer());
+
+      vtkNew<vtkStreamTracer> tracer;
+      SetupTracer(tracer.GetPointer(), input, interpolatorType);
+      tracer->SetIntegrationDirection(directions[d]);
+      tracer->SetSourceData(seed.GetPointer());
+      tracer->Update();
+      vtkPolyData *output = tracer->GetOutput();
+      if (output->GetNumberOfPoints() == 0)
+        {
+        continue;
+        }
+
+      vtkIdType offset = points->GetNumberOfPoints();
+      points->InsertPoints(offset, output->GetNumberOfPoints(), 0,
+                           output->GetPoints());
+      if (output->GetNumberOfLines() > 0)
+        {
+        vtkIdType npts, *pts;
+        output->GetLines()->InitTraversal();
+        output->GetLines()->GetNextCell(npts, pts);
+        lines->InsertNextCell(static_cast<int>(npts));
+        for (vtkIdType j = 0; j < npts; j++)
+          {
+          lines->InsertCellPoint(offset + pts[j]);
+          }
+        reasons->InsertNextTuple(0, output->GetCellData()->GetArray(
+                                   "ReasonForTermination"));
+        seedIds.push_back(static_cast<int>(i));
+        }
+
+      vtkPointData *pd = output->GetPointData();
+      if (pointArrays.empty())
+        {
+        for (int a = 0; a < pd->GetNumberOfArrays(); a++)
+          {
+          pointArrays.push_back(vtkSmartPointer<vtkAbstractArray>::Take(
+            pd->GetAbstractArray(a)->NewInstance()));
+          pointArrays.back()->SetName(pd->GetAbstractArray(a)->GetName());
+          pointArrays.back()->SetNumberOfComponents(
+            pd->GetAbstractArray(a)->GetNumberOfComponents());
+          }
+        }
+      for (size_t a = 0; a < pointArrays.size(); a++)
+        {
+        Append(pointArrays[a], pd->GetAbstractArray(pointArrays[a]->GetName()));
+        }
+      }
+    }
+
+  expected->SetPoints(points.GetPointer());
+  expected->SetLines(lines.GetPointer());
+  for (size_t a = 0; a < pointArrays.size(); a++)
+    {
+    expected->GetPointData()->AddArray(pointArrays[a]);
+    }
+  reasons->SetName("ReasonForTermination");
+  expected->GetCellData()->AddArray(reasons.GetPointer());
+  vtkNew<vtkIntArray> sids;
+  sids->SetName("SeedIds");
+  for (size_t i = 0; i < seedIds.size(); i++)
+    {
+    sids->InsertNextValue(seedIds[i]);
+    }
+  expected->GetCellData()->AddArray(sids.GetPointer());
+}
+
+bool CompareArrays(vtkAbstractArray *a, vtkAbstractArray *b)
+{
+  if (!a || !b || a->GetNumberOfTuples() != b->GetNumberOfTuples() ||
+      a->GetNumberOfComponents() != b->GetNumberOfComponents())
+    {
+    return false;
+    }
+  vtkIdType n = a->GetNumberOfTuples() * a->GetNumberOfComponents();
+  for (vtkIdType i = 0; i < n; i++)
+    {
+    if (a->GetVariantValue(i) != b->GetVariantValue(i))
+      {
+      return false;
+      }
+    }
+  return true;
+}
+
+bool CompareAttributes(vtkDataSetAttributes *a, vtkDataSetAttributes *b)
+{
+  if (a->GetNumberOfArrays() != b->GetNumberOfArrays())
+    {
+    cerr << "Expected " << a->GetNumberOfArrays() << " arrays, got "
+         << b->GetNumberOfArrays() << endl;
+    return false;
+    }
+  for (int i = 0; i < a->GetNumberOfArrays(); i++)
+    {
+    vtkAbstractArray *array = a->GetAbstractArray(i);
+    if (!CompareArrays(array, b->GetAbstractArray(array->GetName())))
+      {
+      cerr << "Different array " << array->GetName() << endl;
+      return false;
+      }
+    }
+  return true;
+}
+
+bool TestInput(vtkDataObject *input, int interpolatorType)
+{
+  vtkSmartPointer<vtkPolyData> seeds = MakeSeeds(40);
+
+  vtkNew<vtkStreamTracer> tracer;
+  SetupTracer(tracer.GetPointer(), input, interpolatorType);
+  tracer->SetIntegrationDirectionToBoth();
+  tracer->SetSourceData(seeds);
+  tracer->Update();
+  vtkPolyData *output = tracer->GetOutput();
+
+  vtkNew<vtkPolyData> expected;
+  IntegrateSeeds(input, seeds, interpolatorType, expected.GetPointer());
+
+  if (expected->GetNumberOfLines() < 60 ||
+      expected->GetNumberOfPoints() != output->GetNumberOfPoints() ||
+      expected->GetNumberOfLines() != output->GetNumberOfLines())
+    {
+    cerr << "Expected " << expected->GetNumberOfPoints() << " points and "
+         << expected->GetNumberOfLines() << " lines, got "
+         << output->GetNumberOfPoints() << " points and "
+         << output->GetNumberOfLines() << " lines" << endl;
+    return false;
+    }
+  if (!CompareArrays(expected->GetPoints()->GetData(),
+                     output->GetPoints()->GetData()) ||
+      !CompareArrays(expected->GetLines()->GetData(),
+                     output->GetLines()->GetData()))
+    {
+    cerr << "Different streamlines" << endl;
+    return false;
+    }
+  return CompareAttributes(expected->GetPointData(), output->GetPointData()) &&
+    CompareAttributes(expected->GetCellData(), output->GetCellData());
+}
+
+}
+
+int TestStreamTracerParallel(int, char *[])
+{
+  vtkSMPTools::Initialize(4);
+  vtkMath::RandomSeed(4321);
+
+  vtkSmartPointer<vtkImageData> image = MakeImage(0, Resolution);
+  vtkSmartPointer<vtkUnstructuredGrid> grid = MakeGrid();
+  vtkNew<vtkMultiBlockDataSet> blocks;
+  blocks->SetNumberOfBlocks(2);
+  blocks->SetBlock(0, MakeImage(0, Resolution / 2));
+  blocks->SetBlock(1, MakeImage(Resolution / 2, Resolution));
+
+  vtkDataObject *inputs[3] = { image, grid, blocks.GetPointer() };
+  int interpolatorTypes[2] = {
+    vtkStreamTracer::INTERPOLATOR_WITH_DATASET_POINT_LOCATOR,
+    vtkStreamTracer::INTERPOLATOR_WITH_CELL_LOCATOR };
+  for (int i = 0; i < 3; i++)
+    {
+    for (int j = 0; j < 2; j++)
+      {
+      if (!TestInput(inputs[i], interpolatorTypes[j]))
+        {
+        cerr << "Failed for input " << i << " and interpolator " << j << endl;
+        return EXIT_FAILURE;
+        }
+      }
+    }
+
+  return EXIT_SUCCESS;
+}
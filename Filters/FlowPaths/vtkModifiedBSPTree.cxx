@@ -76,8 +76,6 @@ public:
 
 typedef cell_extents *cell_extents_List;
 
-static int global_list_count = 0;
-
 class Sorted_cell_extents_Lists
 {
 public:
@@ -91,7 +89,6 @@ public:
       Mins[i] = new cell_extents[nCells]; // max num <= nCells/2 ?
       Maxs[i] = new cell_extents[nCells];
       }
-    global_list_count += 1;
   };
   ~Sorted_cell_extents_Lists(void)
   {
@@ -100,7 +97,6 @@ public:
       delete [](Mins[i]);
       delete [](Maxs[i]);
       }
-    global_list_count -= 1;
   }
 };
 
@@ -34,6 +34,8 @@
 #include "vtkRungeKutta2.h"
 #include "vtkRungeKutta4.h"
 #include "vtkRungeKutta45.h"
+#include "vtkSMPThreadLocal.h"
+#include "vtkSMPTools.h"
 #include "vtkSmartPointer.h"
 #include "vtkStreamingDemandDrivenPipeline.h"
 #include "vtkTemporalInterpolatedVelocityField.h"
@@ -95,6 +97,15 @@ namespace
 
     return -1;
   }
+
+  // The outcome of vtkParticleTracerBase::AdvanceParticle
+  enum
+  {
+    PARTICLE_INSIDE,   // the particle is inside the domain at the target time
+    PARTICLE_OUTSIDE,  // the final position is outside the domain
+    PARTICLE_LOST,     // the integration failed, even after a push
+    PARTICLE_NOT_MOVED // the current and target times are the same
+  };
 };
 
 //---------------------------------------------------------------------------
@@ -146,6 +157,8 @@ vtkParticleTracerBase::vtkParticleTracerBase()
 
   this->SetIntegratorType(RUNGE_KUTTA4);
   this->DisableResetCache = 0;
+  this->ForceParallelIntegration = 0;
+  this->NumberOfParallelAdvections = 0;
 }
 
 //---------------------------------------------------------------------------
@@ -864,18 +877,22 @@ vtkPolyData* vtkParticleTracerBase::Execute(vtkInformationVector** inputVector)
     while(continueExecuting)
       {
       vtkDebugMacro(<<"Begin Pass " << pass << " with " << this->ParticleHistories.size() << " Particles");
-      for (ParticleListIterator it=it_first; it!=it_last;)
+      if (!this->IntegrateParticlesInParallel(
+            it_first, it_last, from, this->CurrentTimeValue))
         {
-        // Keep the 'next' iterator handy because if a particle is terminated
-        // or leaves the domain, the 'current' iterator will be deleted.
-        it_next = it;
-        it_next++;
-        this->IntegrateParticle(it, from, this->CurrentTimeValue, integrator);
-        if (this->GetAbortExecute())
+        for (ParticleListIterator it=it_first; it!=it_last;)
           {
-          break;
+          // Keep the 'next' iterator handy because if a particle is terminated
+          // or leaves the domain, the 'current' iterator will be deleted.
+          it_next = it;
+          it_next++;
+          this->IntegrateParticle(it, from, this->CurrentTimeValue, integrator);
+          if (this->GetAbortExecute())
+            {
+            break;
+            }
+          it = it_next;
           }
-        it = it_next;
         }
       // Particles might have been deleted during the first pass as they move
       // out of domain or age. Before adding any new particles that are sent
@@ -1059,17 +1076,52 @@ int vtkParticleTracerBase::RequestData(
 void vtkParticleTracerBase::IntegrateParticle(
   ParticleListIterator &it, double currenttime, double targettime,
   vtkInitialValueProblemSolver* integrator)
+{
+  double velocity[3] = {0.0, 0.0, 0.0};
+
+  ParticleInformation &info = (*it);
+  ParticleInformation previous = (*it);
+
+  int state = this->AdvanceParticle(
+    info, currenttime, targettime, integrator, this->Interpolator, velocity);
+
+  //
+  // We got this far without error :
+  // Insert the point into the output
+  // Create any new scalars and interpolate existing ones
+  // Cache cell ids and datasets
+  //
+  if (this->KeepAdvectedParticle(it, previous, state, velocity))
+    {
+    //
+    // store the last Cell Ids and dataset indices for next time particle is updated
+    //
+    this->Interpolator->GetCachedCellIds(info.CachedCellId, info.CachedDataSetId);
+    //
+    info.TimeStepAge += 1;
+    //
+    // Now generate the output geometry and scalars
+    //
+    this->AddParticle(info,velocity);
+    }
+  else
+    {
+    this->Interpolator->ClearCache();
+    }
+}
+
+//---------------------------------------------------------------------------
+int vtkParticleTracerBase::AdvanceParticle(
+  ParticleInformation &info, double currenttime, double targettime,
+  vtkInitialValueProblemSolver* integrator,
+  vtkTemporalInterpolatedVelocityField* interpolator, double velocity[3])
 {
   double epsilon = (targettime-currenttime)/100.0;
-  double velocity[3], point1[4], point2[4] = {0.0, 0.0, 0.0, 0.0};
+  double point1[4], point2[4] = {0.0, 0.0, 0.0, 0.0};
   double minStep=0, maxStep=0;
   double stepWanted, stepTaken=0.0;
   int substeps = 0;
 
-  ParticleInformation &info = (*it);
-  ParticleInformation previous = (*it);
-  bool particle_good = true;
-
   info.ErrorCode = 0;
 
   // Get the Initial point {x,y,z,t}
@@ -1078,159 +1130,337 @@ void vtkParticleTracerBase::IntegrateParticle(
   if(currenttime==targettime)
     {
     Assert(point1[3]==currenttime);
+    return PARTICLE_NOT_MOVED;
+    }
+
+  Assert (point1[3]>=(currenttime-epsilon) && point1[3]<=(targettime+epsilon));
+
+  //
+  // begin interpolation between available time values, if the particle has
+  // a cached cell ID and dataset - try to use it,
+  //
+  if(this->AllFixedGeometry)
+    {
+    interpolator->SetCachedCellIds(info.CachedCellId, info.CachedDataSetId);
     }
   else
     {
-    Assert (point1[3]>=(currenttime-epsilon) && point1[3]<=(targettime+epsilon));
+    interpolator->ClearCache();
+    }
+
+  double delT = (targettime-currenttime) * this->IntegrationStep;
+  epsilon = delT*1E-3;
 
+  while (point1[3] < (targettime-epsilon))
+    {
     //
-    // begin interpolation between available time values, if the particle has
-    // a cached cell ID and dataset - try to use it,
+    // Here beginneth the real work
     //
-    if(this->AllFixedGeometry)
-      {
-      this->Interpolator->SetCachedCellIds(info.CachedCellId, info.CachedDataSetId);
-      }
-    else
+    double error = 0;
+
+    // If, with the next step, propagation will be larger than
+    // max, reduce it so that it is (approximately) equal to max.
+    stepWanted = delT;
+    if ( (point1[3] + stepWanted) > targettime )
       {
-      this->Interpolator->ClearCache();
+      stepWanted = targettime - point1[3];
+      maxStep = stepWanted;
       }
 
-    double delT = (targettime-currenttime) * this->IntegrationStep;
-    epsilon = delT*1E-3;
-
-    while (point1[3] < (targettime-epsilon))
+    // Calculate the next step using the integrator provided.
+    // If the next point is out of bounds, send it to another process
+    if (integrator->ComputeNextStep(
+          point1, point2, point1[3], stepWanted,
+          stepTaken, minStep, maxStep,
+          this->MaximumError, error) != 0)
       {
-      //
-      // Here beginneth the real work
-      //
-      double error = 0;
-
-      // If, with the next step, propagation will be larger than
-      // max, reduce it so that it is (approximately) equal to max.
-      stepWanted = delT;
-      if ( (point1[3] + stepWanted) > targettime )
+      // if the particle is sent, remove it from the list
+      info.ErrorCode = 1;
+      if (!this->RetryWithPush(info, point1, delT, substeps, interpolator))
         {
-        stepWanted = targettime - point1[3];
-        maxStep = stepWanted;
+        return PARTICLE_LOST;
         }
-
-      // Calculate the next step using the integrator provided.
-      // If the next point is out of bounds, send it to another process
-      if (integrator->ComputeNextStep(
-            point1, point2, point1[3], stepWanted,
-            stepTaken, minStep, maxStep,
-            this->MaximumError, error) != 0)
-        {
-        // if the particle is sent, remove it from the list
-        info.ErrorCode = 1;
-        if (!this->RetryWithPush(info, point1, delT, substeps))
-          {
-          if(previous.PointId <0 && previous.TailPointId < 0)
-            {
-            vtkErrorMacro("the particle should have been added");
-            }
-          else
-            {
-            this->SendParticleToAnotherProcess(info,previous, this->ParticlePointData);
-            }
-          this->ParticleHistories.erase(it);
-          particle_good = false;
-          break;
-          }
-        else
-          {
-          // particle was not sent, retry saved it, so copy info back
-          substeps++;
-          memcpy(point1, &info.CurrentPosition, sizeof(Position));
-          }
-        }
-      else // success, increment position/time
+      else
         {
+        // particle was not sent, retry saved it, so copy info back
         substeps++;
+        memcpy(point1, &info.CurrentPosition, sizeof(Position));
+        }
+      }
+    else // success, increment position/time
+      {
+      substeps++;
 
-        // increment the particle time
-        point2[3] = point1[3] + stepTaken;
-        info.age += stepTaken;
-        info.SimulationTime += stepTaken;
+      // increment the particle time
+      point2[3] = point1[3] + stepTaken;
+      info.age += stepTaken;
+      info.SimulationTime += stepTaken;
 
-        // Point is valid. Insert it.
-        memcpy(&info.CurrentPosition, point2, sizeof(Position));
-        memcpy(point1, point2, sizeof(Position));
-        }
+      // Point is valid. Insert it.
+      memcpy(&info.CurrentPosition, point2, sizeof(Position));
+      memcpy(point1, point2, sizeof(Position));
+      }
 
-      // If the solver is adaptive and the next time step (delT.Interval)
-      // that the solver wants to use is smaller than minStep or larger
-      // than maxStep, re-adjust it. This has to be done every step
-      // because minStep and maxStep can change depending on the Cell
-      // size (unless it is specified in time units)
-      if (integrator->IsAdaptive())
-        {
-        // code removed. Put it back when this is stable
-        }
+    // If the solver is adaptive and the next time step (delT.Interval)
+    // that the solver wants to use is smaller than minStep or larger
+    // than maxStep, re-adjust it. This has to be done every step
+    // because minStep and maxStep can change depending on the Cell
+    // size (unless it is specified in time units)
+    if (integrator->IsAdaptive())
+      {
+      // code removed. Put it back when this is stable
+      }
+    }
+
+#ifdef DEBUGPARTICLETRACE
+  double eps = (this->GetCacheDataTime(1)-this->GetCacheDataTime(0))/100;
+  Assert (point1[3]>=(this->GetCacheDataTime(0)-eps) && point1[3]<=(this->GetCacheDataTime(1)+eps));
+#endif
+
+  // The integration succeeded, but check the computed final position
+  // is actually inside the domain (the intermediate steps taken inside
+  // the integrator were ok, but the final step may just pass out)
+  // if it moves out, we can't interpolate scalars, so we must send it away
+  info.LocationState = interpolator->TestPoint(info.CurrentPosition.x);
+  interpolator->GetLastGoodVelocity(velocity);
+  if (info.LocationState==ID_OUTSIDE_ALL)
+    {
+    info.ErrorCode = 2;
+    return PARTICLE_OUTSIDE;
+    }
+  return PARTICLE_INSIDE;
+}
+
+//---------------------------------------------------------------------------
+bool vtkParticleTracerBase::KeepAdvectedParticle(
+  ParticleListIterator &it, ParticleInformation &previous, int state,
+  double velocity[3])
+{
+  ParticleInformation &info = (*it);
+  if (state==PARTICLE_NOT_MOVED)
+    {
+    return true;
+    }
+  if (state==PARTICLE_LOST)
+    {
+    if(previous.PointId <0 && previous.TailPointId < 0)
+      {
+      vtkErrorMacro("the particle should have been added");
       }
+    else
+      {
+      this->SendParticleToAnotherProcess(info,previous, this->ParticlePointData);
+      }
+    this->ParticleHistories.erase(it);
+    return false;
+    }
+  // if the particle is sent, remove it from the list
+  if (state==PARTICLE_OUTSIDE &&
+      this->SendParticleToAnotherProcess(info,previous,this->OutputPointData))
+    {
+    this->ParticleHistories.erase(it);
+    return false;
+    }
+
+  // Has this particle stagnated
+  //
+  info.speed = vtkMath::Norm(velocity);
+  if (info.speed <= this->TerminalSpeed)
+    {
+    this->ParticleHistories.erase(it);
+    return false;
+    }
+  return true;
+}
 
-    if (particle_good)
+//---------------------------------------------------------------------------
+// Advances a range of particles, each thread with its own interpolator,
+// integrator and point data where the input point data of the particles
+// is interpolated. The particles are modified in place; what the serial
+// pass needs to finish them is stored in the AdvectedParticle array.
+class vtkParticleTracerBaseAdvectFunctor
+{
+public:
+  struct AdvectedParticle
+  {
+    ParticleListIterator It;
+    ParticleInformation Previous;
+    int State;
+    double Velocity[3];
+    vtkIdType CachedCellId[2];
+    int CachedDataSetId[2];
+    // the interpolated point data, PointData is NULL if it failed
+    vtkPointData* PointData;
+    vtkIdType PointDataId;
+    double Vorticity[3];
+  };
+
+  struct LocalData
+  {
+    vtkTemporalInterpolatedVelocityField* Interpolator;
+    vtkInitialValueProblemSolver* Integrator;
+    vtkPointData* PointData;
+    vtkDoubleArray* CellVectors;
+
+    LocalData() : Interpolator(0), Integrator(0), PointData(0),
+                  CellVectors(0) {}
+  };
+
+  vtkParticleTracerBase* Tracer;
+  AdvectedParticle* Particles;
+  double CurrentTime;
+  double TargetTime;
+  vtkSMPThreadLocal<LocalData> Local;
+
+  vtkParticleTracerBaseAdvectFunctor(vtkParticleTracerBase* tracer,
+                                     AdvectedParticle* particles,
+                                     double currenttime, double targettime)
+    : Tracer(tracer), Particles(particles), CurrentTime(currenttime),
+      TargetTime(targettime)
+  {
+  }
+
+  ~vtkParticleTracerBaseAdvectFunctor()
+  {
+    vtkSMPThreadLocal<LocalData>::iterator itr = this->Local.begin();
+    for (; itr != this->Local.end(); ++itr)
       {
-      // The integration succeeded, but check the computed final position
-      // is actually inside the domain (the intermediate steps taken inside
-      // the integrator were ok, but the final step may just pass out)
-      // if it moves out, we can't interpolate scalars, so we must send it away
-      info.LocationState = this->Interpolator->TestPoint(info.CurrentPosition.x);
-      if (info.LocationState==ID_OUTSIDE_ALL)
+      LocalData& local = *itr;
+      if (!local.Interpolator)
         {
-        info.ErrorCode = 2;
-        // if the particle is sent, remove it from the list
-        if (this->SendParticleToAnotherProcess(info,previous,this->OutputPointData))
-          {
-          this->ParticleHistories.erase(it);
-          particle_good = false;
-          }
+        continue;
         }
+      local.Interpolator->Delete();
+      local.Integrator->Delete();
+      local.PointData->Delete();
+      local.CellVectors->Delete();
       }
+  }
 
-    // Has this particle stagnated
-    //
-    if (particle_good)
+  void Initialize()
+  {
+    LocalData& local = this->Local.Local();
+    if (local.Interpolator)
       {
-      this->Interpolator->GetLastGoodVelocity(velocity);
-      info.speed = vtkMath::Norm(velocity);
-      if (it->speed <= this->TerminalSpeed)
+      return;
+      }
+    local.Interpolator = vtkTemporalInterpolatedVelocityField::New();
+    local.Interpolator->CopyParameters(this->Tracer->Interpolator);
+    local.Integrator = this->Tracer->GetIntegrator()->NewInstance();
+    local.Integrator->SetFunctionSet(local.Interpolator);
+    local.PointData = vtkPointData::New();
+    local.PointData->InterpolateAllocate(
+      this->Tracer->DataReferenceT[0]->GetPointData());
+    local.CellVectors = vtkDoubleArray::New();
+    local.CellVectors->SetNumberOfComponents(3);
+    local.CellVectors->Allocate(3*VTK_CELL_SIZE);
+  }
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    LocalData& local = this->Local.Local();
+    for (vtkIdType i = begin; i < end; i++)
+      {
+      AdvectedParticle& particle = this->Particles[i];
+      ParticleInformation& info = *particle.It;
+      particle.Previous = info;
+      particle.Velocity[0] = particle.Velocity[1] = particle.Velocity[2] = 0.0;
+      particle.PointData = NULL;
+      particle.PointDataId = -1;
+      particle.State = this->Tracer->AdvanceParticle(
+        info, this->CurrentTime, this->TargetTime, local.Integrator,
+        local.Interpolator, particle.Velocity);
+      if (particle.State == PARTICLE_LOST)
         {
-        this->ParticleHistories.erase(it);
-        particle_good = false;
+        continue;
+        }
+      // The particle may be kept: get what AddParticle needs from the
+      // interpolator while it still points to the cell of the particle.
+      local.Interpolator->GetCachedCellIds(
+        particle.CachedCellId, particle.CachedDataSetId);
+      vtkIdType id = local.PointData->GetNumberOfArrays() > 0 ?
+        local.PointData->GetAbstractArray(0)->GetNumberOfTuples() : 0;
+      if (this->Tracer->InterpolateParticle(
+            info, local.Interpolator, local.PointData, id,
+            local.CellVectors, particle.Vorticity))
+        {
+        particle.PointData = local.PointData;
+        particle.PointDataId = id;
         }
       }
-    }
+  }
 
-  //
-  // We got this far without error :
-  // Insert the point into the output
-  // Create any new scalars and interpolate existing ones
-  // Cache cell ids and datasets
-  //
-  if (particle_good)
+  void Reduce()
+  {
+  }
+};
+
+//---------------------------------------------------------------------------
+bool vtkParticleTracerBase::IntegrateParticlesInParallel(
+  ParticleListIterator first, ParticleListIterator last,
+  double currenttime, double targettime)
+{
+  typedef vtkParticleTracerBaseAdvectFunctor::AdvectedParticle
+    AdvectedParticle;
+
+  if (currenttime==targettime ||
+      (!this->ForceParallelIntegration &&
+       vtkSMPTools::GetEstimatedNumberOfThreads() < 2))
     {
-    //
-    // store the last Cell Ids and dataset indices for next time particle is updated
-    //
-    this->Interpolator->GetCachedCellIds(info.CachedCellId, info.CachedDataSetId);
-    //
-    info.TimeStepAge += 1;
-    //
-    // Now generate the output geometry and scalars
-    //
-    this->AddParticle(info,velocity);
+    return false;
     }
-  else
+  std::vector<AdvectedParticle> particles;
+  for (ParticleListIterator it=first; it!=last; ++it)
     {
-    this->Interpolator->ClearCache();
+    AdvectedParticle particle;
+    particle.It = it;
+    particles.push_back(particle);
+    }
+  if (particles.size() < 2)
+    {
+    return false;
     }
 
-#ifdef DEBUGPARTICLETRACE
-  double eps = (this->GetCacheDataTime(1)-this->GetCacheDataTime(0))/100;
-  Assert (point1[3]>=(this->GetCacheDataTime(0)-eps) && point1[3]<=(this->GetCacheDataTime(1)+eps));
-#endif
+  // The locators are shared by the interpolators of the threads
+  this->Interpolator->BuildSearchStructures();
+  vtkParticleTracerBaseAdvectFunctor functor(
+    this, &particles[0], currenttime, targettime);
+  vtkSMPTools::For(0, static_cast<vtkIdType>(particles.size()), functor);
+  this->NumberOfParallelAdvections += static_cast<vtkIdType>(particles.size());
+
+  // Send, remove and output the particles in list order, so that the
+  // virtual methods are called as in the serial integration.
+  for (size_t i=0; i<particles.size(); i++)
+    {
+    AdvectedParticle& particle = particles[i];
+    ParticleInformation& info = *particle.It;
+    if (!this->KeepAdvectedParticle(particle.It, particle.Previous,
+                                    particle.State, particle.Velocity))
+      {
+      continue;
+      }
+    for (int j=0; j<2; j++)
+      {
+      info.CachedCellId[j] = particle.CachedCellId[j];
+      info.CachedDataSetId[j] = particle.CachedDataSetId[j];
+      }
+    info.TimeStepAge += 1;
+    vtkIdType tempId = this->InsertParticle(info);
+    if (particle.PointData)
+      {
+      for (int j=0; j<particle.PointData->GetNumberOfArrays(); j++)
+        {
+        this->OutputPointData->GetAbstractArray(j)->InsertTuple(
+          tempId, particle.PointDataId,
+          particle.PointData->GetAbstractArray(j));
+        }
+      }
+    if (this->ComputeVorticity)
+      {
+      this->AddParticleVorticity(info, particle.Velocity, particle.Vorticity);
+      }
+    }
+  return true;
 }
 
 //---------------------------------------------------------------------------
@@ -1248,6 +1478,10 @@ void vtkParticleTracerBase::PrintSelf(ostream& os, vtkIndent indent)
   os << indent << "StaticMesh: " << this->StaticMesh << endl;
   os << indent << "TerminationTime: " << this->TerminationTime << endl;
   os << indent << "StaticSeeds: " << this->StaticSeeds << endl;
+  os << indent << "ForceParallelIntegration: "
+     << this->ForceParallelIntegration << endl;
+  os << indent << "NumberOfParallelAdvections: "
+     << this->NumberOfParallelAdvections << endl;
 }
 
 //---------------------------------------------------------------------------
@@ -1371,6 +1605,7 @@ void vtkParticleTracerBase::ResetCache()
     this->ParticleHistories.clear();
     this->ReinjectionCounter = 0;
     this->UniqueIdCounter    = 0; ///check
+    this->NumberOfParallelAdvections = 0;
 
     this->CachedData[0] = NULL;
     this->CachedData[1] = NULL;
@@ -1447,12 +1682,13 @@ void vtkParticleTracerBase::CreateProtoPD(vtkDataObject* input)
 
 //---------------------------------------------------------------------------
 bool vtkParticleTracerBase::RetryWithPush(
-  ParticleInformation &info,  double* point1,double delT, int substeps)
+  ParticleInformation &info,  double* point1,double delT, int substeps,
+  vtkTemporalInterpolatedVelocityField* interpolator)
 {
   double velocity[3];
-  this->Interpolator->ClearCache();
+  interpolator->ClearCache();
 
-  info.LocationState = this->Interpolator->TestPoint(point1);
+  info.LocationState = interpolator->TestPoint(point1);
 
   if (info.LocationState==ID_OUTSIDE_ALL)
     {
@@ -1461,7 +1697,7 @@ bool vtkParticleTracerBase::RetryWithPush(
     // send the particle 'as is' and hope it lands in another process
     if (substeps>0)
       {
-      this->Interpolator->GetLastGoodVelocity(velocity);
+      interpolator->GetLastGoodVelocity(velocity);
       }
     else
       {
@@ -1472,19 +1708,19 @@ bool vtkParticleTracerBase::RetryWithPush(
   else if (info.LocationState==ID_OUTSIDE_T0)
     {
     // the particle left the volume but can be tested at T2, so use the velocity at T2
-    this->Interpolator->GetLastGoodVelocity(velocity);
+    interpolator->GetLastGoodVelocity(velocity);
     info.ErrorCode = 4;
     }
   else if (info.LocationState==ID_OUTSIDE_T1)
     {
     // the particle left the volume but can be tested at T1, so use the velocity at T1
-    this->Interpolator->GetLastGoodVelocity(velocity);
+    interpolator->GetLastGoodVelocity(velocity);
     info.ErrorCode = 5;
     }
   else
     {
     // The test returned INSIDE_ALL, so test failed near start of integration,
-    this->Interpolator->GetLastGoodVelocity(velocity);
+    interpolator->GetLastGoodVelocity(velocity);
     }
 
   // try adding a one increment push to the particle to get over a rotating/moving boundary
@@ -1494,7 +1730,7 @@ bool vtkParticleTracerBase::RetryWithPush(
     }
 
   info.CurrentPosition.x[3] += delT;
-  info.LocationState = this->Interpolator->TestPoint(info.CurrentPosition.x);
+  info.LocationState = interpolator->TestPoint(info.CurrentPosition.x);
   info.age += delT;
   info.SimulationTime += delT; // = this->GetCurrentTimeValue();
 
@@ -1510,6 +1746,20 @@ bool vtkParticleTracerBase::RetryWithPush(
 //---------------------------------------------------------------------------
 void vtkParticleTracerBase::AddParticle(
   vtkParticleTracerBaseNamespace::ParticleInformation &info, double* velocity)
+{
+  vtkIdType tempId = this->InsertParticle(info);
+  double vorticity[3];
+  this->InterpolateParticle(info, this->Interpolator, this->OutputPointData,
+                            tempId, this->CellVectors, vorticity);
+  if (this->ComputeVorticity)
+    {
+    this->AddParticleVorticity(info, velocity, vorticity);
+    }
+}
+
+//---------------------------------------------------------------------------
+vtkIdType vtkParticleTracerBase::InsertParticle(
+  vtkParticleTracerBaseNamespace::ParticleInformation &info)
 {
   const double    *coord = info.CurrentPosition.x;
   vtkIdType tempId = this->OutputCoordinates->InsertNextPoint(coord);
@@ -1525,7 +1775,15 @@ void vtkParticleTracerBase::AddParticle(
   this->AppendToExtraPointDataArrays(info);
   info.PointId = tempId;
   info.TailPointId = -1;
+  return tempId;
+}
 
+//---------------------------------------------------------------------------
+bool vtkParticleTracerBase::InterpolateParticle(
+  vtkParticleTracerBaseNamespace::ParticleInformation &info,
+  vtkTemporalInterpolatedVelocityField* interpolator, vtkPointData* outPD,
+  vtkIdType outIndex, vtkDoubleArray* cellVectors, double vorticity[3])
+{
   //
   // Interpolate all existing point attributes
   // In principle we always integrate the particle until it reaches Time2
@@ -1533,13 +1791,14 @@ void vtkParticleTracerBase::AddParticle(
   // between T0 and T1, just fetch the values
   // of the spatially interpolated scalars from T1.
   //
+  bool interpolated;
   if (info.LocationState==ID_OUTSIDE_T1)
     {
-    this->Interpolator->InterpolatePoint(0, this->OutputPointData, tempId);
+    interpolated = interpolator->InterpolatePoint(0, outPD, outIndex);
     }
   else
     {
-    this->Interpolator->InterpolatePoint(1, this->OutputPointData, tempId);
+    interpolated = interpolator->InterpolatePoint(1, outPD, outIndex);
     }
   //
   // Compute vorticity
@@ -1547,48 +1806,54 @@ void vtkParticleTracerBase::AddParticle(
   if (this->ComputeVorticity)
     {
     vtkGenericCell *cell(NULL);
-    double pcoords[3], vorticity[3], weights[256];
-    double rotation, omega;
+    double pcoords[3], weights[256];
     // have to use T0 if particle is out at T1, otherwise use T1
-    if (info.LocationState==ID_OUTSIDE_T1)
-      {
-      this->Interpolator->GetVorticityData(
-        0, pcoords, weights, cell, this->CellVectors);
-      }
-    else
-      {
-      this->Interpolator->GetVorticityData(
-        1, pcoords, weights, cell, this->CellVectors);
-      }
-
-    this->CalculateVorticity(cell, pcoords, CellVectors, vorticity);
-    this->ParticleVorticity->InsertNextTuple(vorticity);
-    // local rotation = vorticity . unit tangent ( i.e. velocity/speed )
-    if (info.speed != 0.0)
-      {
-      omega = vtkMath::Dot(vorticity, velocity);
-      omega /= info.speed;
-      omega *= this->RotationScale;
-      }
-    else
-      {
-      omega = 0.0;
-      }
-    vtkIdType index = this->ParticleAngularVel->InsertNextValue(omega);
-    if (index>0)
+    int T = (info.LocationState==ID_OUTSIDE_T1) ? 0 : 1;
+    if (interpolator->GetVorticityData(
+          T, pcoords, weights, cell, cellVectors))
       {
-      rotation     = info.rotation + (info.angularVel + omega)/2 * (info.CurrentPosition.x[3] - info.time);
+      this->CalculateVorticity(cell, pcoords, cellVectors, vorticity);
       }
     else
       {
-      rotation     = 0.0;
+      // the particle is not in a cell, e.g. it left the domain
+      vorticity[0] = vorticity[1] = vorticity[2] = 0.0;
       }
-    this->ParticleRotation->InsertNextValue(rotation);
-    info.rotation   = rotation;
-    info.angularVel = omega;
-    info.time       = info.CurrentPosition.x[3];
     }
+  return interpolated;
+}
 
+//---------------------------------------------------------------------------
+void vtkParticleTracerBase::AddParticleVorticity(
+  vtkParticleTracerBaseNamespace::ParticleInformation &info,
+  double* velocity, double vorticity[3])
+{
+  double rotation, omega;
+  this->ParticleVorticity->InsertNextTuple(vorticity);
+  // local rotation = vorticity . unit tangent ( i.e. velocity/speed )
+  if (info.speed != 0.0)
+    {
+    omega = vtkMath::Dot(vorticity, velocity);
+    omega /= info.speed;
+    omega *= this->RotationScale;
+    }
+  else
+    {
+    omega = 0.0;
+    }
+  vtkIdType index = this->ParticleAngularVel->InsertNextValue(omega);
+  if (index>0)
+    {
+    rotation     = info.rotation + (info.angularVel + omega)/2 * (info.CurrentPosition.x[3] - info.time);
+    }
+  else
+    {
+    rotation     = 0.0;
+    }
+  this->ParticleRotation->InsertNextValue(rotation);
+  info.rotation   = rotation;
+  info.angularVel = omega;
+  info.time       = info.CurrentPosition.x[3];
 }
 
 //---------------------------------------------------------------------------
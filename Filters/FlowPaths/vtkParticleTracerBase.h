@@ -18,6 +18,12 @@
 // in a vector field. Note that the input vtkPointData structure must
 // be identical on all datasets.
 //
+// The particles are advanced on several threads when vtkSMPTools runs more
+// than one, each thread with its own copy of the interpolator and of its
+// cell caches. They are then removed, sent to other processes and added to
+// the output in list order, so the output does not depend on the number
+// of threads.
+//
 // .SECTION See Also
 // vtkRibbonFilter vtkRuledSurfaceFilter vtkInitialValueProblemSolver
 // vtkRungeKutta2 vtkRungeKutta4 vtkRungeKutta45 vtkStreamTracer
@@ -230,6 +236,12 @@ public:
   //Everything related to time
   int IgnorePipelineTime; //whether to use the pipeline time for termination
   int DisableResetCache; //whether to enable ResetCache() method
+  // Whether to integrate the particles in parallel even when vtkSMPTools
+  // runs a single thread, and the number of particle advections done in
+  // parallel since the cache was last reset. These are set and checked by
+  // the tests; the output does not depend on them.
+  int ForceParallelIntegration;
+  vtkIdType NumberOfParallelAdvections;
 
   vtkParticleTracerBase();
   virtual ~vtkParticleTracerBase();
@@ -430,7 +442,51 @@ public:
   // first order integration though so it may introduce a bit extra error compared
   // to the integrator that is used.
   bool RetryWithPush(
-    vtkParticleTracerBaseNamespace::ParticleInformation &info, double* point1,double delT, int subSteps);
+    vtkParticleTracerBaseNamespace::ParticleInformation &info, double* point1,double delT, int subSteps,
+    vtkTemporalInterpolatedVelocityField* interpolator);
+
+  // Description:
+  // AdvanceParticle moves a particle between the two times supplied using
+  // the given interpolator and integrator, and only modifies the particle
+  // itself so it can be called concurrently on different particles. It
+  // returns whether the particle was lost, left the domain or is still
+  // inside, and its last velocity. KeepAdvectedParticle then sends or
+  // removes the particles which were lost, left the domain or stagnated,
+  // and returns true if the particle is kept in the list.
+  int AdvanceParticle(
+    vtkParticleTracerBaseNamespace::ParticleInformation &info,
+    double currenttime, double targettime,
+    vtkInitialValueProblemSolver* integrator,
+    vtkTemporalInterpolatedVelocityField* interpolator, double velocity[3]);
+  bool KeepAdvectedParticle(
+    vtkParticleTracerBaseNamespace::ParticleListIterator &it,
+    vtkParticleTracerBaseNamespace::ParticleInformation &previous,
+    int state, double velocity[3]);
+
+  // Description:
+  // Advance the particles of [first, last) on several threads, each with
+  // its own copy of the interpolator. The particles are then removed,
+  // sent or added to the output in list order, as IntegrateParticle does.
+  // Returns false when the particles should be integrated serially.
+  bool IntegrateParticlesInParallel(
+    vtkParticleTracerBaseNamespace::ParticleListIterator first,
+    vtkParticleTracerBaseNamespace::ParticleListIterator last,
+    double currenttime, double targettime);
+
+  // Description:
+  // The parts of AddParticle: InsertParticle appends the particle to the
+  // output and returns its point id, InterpolateParticle interpolates the
+  // input point data and computes the vorticity at the particle, and
+  // AddParticleVorticity appends the vorticity, rotation and angular
+  // velocity of the particle.
+  vtkIdType InsertParticle(vtkParticleTracerBaseNamespace::ParticleInformation &info);
+  bool InterpolateParticle(
+    vtkParticleTracerBaseNamespace::ParticleInformation &info,
+    vtkTemporalInterpolatedVelocityField* interpolator, vtkPointData* outPD,
+    vtkIdType outIndex, vtkDoubleArray* cellVectors, double vorticity[3]);
+  void AddParticleVorticity(
+    vtkParticleTracerBaseNamespace::ParticleInformation &info,
+    double* velocity, double vorticity[3]);
 
   bool SetTerminationTimeNoModify(double t);
 
@@ -512,6 +568,7 @@ public:
 
   friend class ParticlePathFilterInternal;
   friend class StreaklineFilterInternal;
+  friend class vtkParticleTracerBaseAdvectFunctor;
 
   static const double Epsilon;
 };
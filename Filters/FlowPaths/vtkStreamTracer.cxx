@@ -45,8 +45,11 @@ PURPOSE.  See the above copyright notice for more information.
 #include "vtkRungeKutta2.h"
 #include "vtkRungeKutta4.h"
 #include "vtkRungeKutta45.h"
+#include "vtkSMPThreadLocal.h"
+#include "vtkSMPTools.h"
 #include "vtkSmartPointer.h"
 
+#include <algorithm>
 #include <vector>
 
 vtkObjectFactoryNewMacro(vtkStreamTracer)
@@ -653,6 +656,254 @@ int vtkStreamTracer::CheckInputs(vtkAbstractInterpolatedVelocityField*& func,
   return VTK_OK;
 }
 
+// The objects used to integrate streamlines and the arrays receiving their
+// points and point data. The serial integration uses a single state writing
+// directly to the output, the parallel integration one state per thread.
+struct vtkStreamTracer::IntegrationState
+{
+  vtkAbstractInterpolatedVelocityField* Func;
+  vtkInterpolatedVelocityField* SurfaceFunc;
+  vtkInitialValueProblemSolver* Integrator;
+  vtkGenericCell* Cell;
+  double* Weights;
+  vtkDoubleArray* CellVectors;
+  int VecType;
+  const char* VecName;
+  bool ReportProgress;
+  double LastUsedStepSize;
+
+  vtkPoints* Points;
+  vtkDataSetAttributes* PointData;
+  vtkDoubleArray* Time;
+  vtkDoubleArray* VelocityVectors;
+  vtkDoubleArray* Vorticity;
+  vtkDoubleArray* Rotation;
+  vtkDoubleArray* AngularVelocity;
+
+  IntegrationState()
+    : Func(0), SurfaceFunc(0), Integrator(0), Cell(0), Weights(0),
+      CellVectors(0), VecType(0), VecName(0), ReportProgress(false),
+      LastUsedStepSize(0.0), Points(0), PointData(0), Time(0),
+      VelocityVectors(0), Vorticity(0), Rotation(0), AngularVelocity(0)
+  {
+  }
+};
+
+namespace
+{
+  // vtkDataSet builds some of its search structures (bounds, cells and links
+  // of vtkPolyData and vtkUnstructuredGrid, point locator of vtkPointSet) on
+  // the first cell search. Build them before the dataset is searched by
+  // several threads.
+  void BuildSearchStructures(vtkDataSet* input, bool findCell,
+                             vtkGenericCell* cell, double* weights)
+  {
+    double bounds[6];
+    input->GetBounds(bounds);
+    if (input->GetNumberOfCells() < 1 || input->GetNumberOfPoints() < 1)
+      {
+      return;
+      }
+    input->GetCell(0, cell);
+    if (findCell)
+      {
+      double x[3], pcoords[3];
+      int subId;
+      input->GetPoint(0, x);
+      input->FindCell(x, 0, cell, -1, 0.0, subId, pcoords, weights);
+      }
+  }
+}
+
+// Integrates the streamlines of a range of seeds. Each thread uses its own
+// copy of the velocity field and of the integrator, and appends the points
+// of its streamlines to its own arrays.
+class vtkStreamTracerIntegrateFunctor
+{
+public:
+  typedef vtkStreamTracer::IntegrationState IntegrationState;
+
+  // The streamline of a seed, stored in the arrays of State.
+  struct StreamlineInfo
+  {
+    IntegrationState* State;
+    vtkIdType Begin;
+    vtkIdType NumberOfPoints;
+    int ReasonForTermination;
+    double Propagation;
+    vtkIdType NumberOfSteps;
+    double IntegrationTime;
+    double LastUsedStepSize;
+  };
+
+  vtkStreamTracer* Tracer;
+  vtkAbstractInterpolatedVelocityField* Func;
+  std::vector<vtkDataSet*> DataSets;
+  vtkPointData* InputPointData;
+  int MaxCellSize;
+  int VecType;
+  const char* VecName;
+  vtkDataArray* SeedSource;
+  vtkIdList* SeedIds;
+  vtkIntArray* IntegrationDirections;
+  vtkIdType NumberOfLines;
+  StreamlineInfo* Lines;
+  vtkSMPThreadLocal<IntegrationState> LocalState;
+
+  vtkStreamTracerIntegrateFunctor()
+  {
+    this->Tracer = 0;
+    this->Func = 0;
+    this->InputPointData = 0;
+    this->MaxCellSize = 0;
+    this->VecType = 0;
+    this->VecName = 0;
+    this->SeedSource = 0;
+    this->SeedIds = 0;
+    this->IntegrationDirections = 0;
+    this->NumberOfLines = 0;
+    this->Lines = 0;
+  }
+
+  ~vtkStreamTracerIntegrateFunctor()
+  {
+    vtkSMPThreadLocal<IntegrationState>::iterator itr =
+      this->LocalState.begin();
+    for (; itr != this->LocalState.end(); ++itr)
+      {
+      IntegrationState& state = *itr;
+      if (!state.Func)
+        {
+        continue;
+        }
+      state.Func->Delete();
+      state.Integrator->Delete();
+      state.Cell->Delete();
+      delete [] state.Weights;
+      state.Points->Delete();
+      state.PointData->Delete();
+      state.Time->Delete();
+      if (state.VelocityVectors)
+        {
+        state.VelocityVectors->Delete();
+        }
+      if (state.CellVectors)
+        {
+        state.CellVectors->Delete();
+        state.Vorticity->Delete();
+        state.Rotation->Delete();
+        state.AngularVelocity->Delete();
+        }
+      }
+  }
+
+  void Initialize()
+  {
+    // The functor is executed once per batch of seeds; create the thread
+    // local state only the first time.
+    IntegrationState& state = this->LocalState.Local();
+    if (state.Func)
+      {
+      return;
+      }
+
+    vtkCompositeInterpolatedVelocityField* func =
+      vtkCompositeInterpolatedVelocityField::SafeDownCast(
+        this->Func->NewInstance());
+    func->CopyParameters(this->Func);
+    for (size_t i = 0; i < this->DataSets.size(); i++)
+      {
+      func->AddDataSet(this->DataSets[i]);
+      }
+    func->SelectVectors(this->VecType, this->VecName);
+    state.Func = func;
+    state.SurfaceFunc = 0;
+    if (this->Tracer->SurfaceStreamlines)
+      {
+      state.SurfaceFunc = vtkInterpolatedVelocityField::SafeDownCast(func);
+      state.SurfaceFunc->SetForceSurfaceTangentVector(true);
+      state.SurfaceFunc->SetSurfaceDataset(true);
+      }
+    state.Integrator = this->Tracer->GetIntegrator()->NewInstance();
+    state.Integrator->SetFunctionSet(func);
+    state.Cell = vtkGenericCell::New();
+    state.Weights = this->MaxCellSize > 0 ? new double[this->MaxCellSize] : 0;
+    state.VecType = this->VecType;
+    state.VecName = this->VecName;
+    state.ReportProgress = false;
+    state.LastUsedStepSize = 0.0;
+
+    state.Points = vtkPoints::New();
+    state.PointData = vtkPointData::New();
+    state.PointData->InterpolateAllocate(this->InputPointData);
+    state.Time = vtkDoubleArray::New();
+    state.VelocityVectors = 0;
+    if (this->VecType != vtkDataObject::POINT)
+      {
+      state.VelocityVectors = vtkDoubleArray::New();
+      state.VelocityVectors->SetNumberOfComponents(3);
+      }
+    state.CellVectors = 0;
+    state.Vorticity = 0;
+    state.Rotation = 0;
+    state.AngularVelocity = 0;
+    if (this->Tracer->ComputeVorticity)
+      {
+      state.CellVectors = vtkDoubleArray::New();
+      state.CellVectors->SetNumberOfComponents(3);
+      state.CellVectors->Allocate(3*VTK_CELL_SIZE);
+      state.Vorticity = vtkDoubleArray::New();
+      state.Vorticity->SetNumberOfComponents(3);
+      state.Rotation = vtkDoubleArray::New();
+      state.AngularVelocity = vtkDoubleArray::New();
+      }
+  }
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    IntegrationState& state = this->LocalState.Local();
+    double lastPoint[3];
+    for (vtkIdType currentLine = begin; currentLine < end; currentLine++)
+      {
+      if (this->Tracer->GetAbortExecute())
+        {
+        break;
+        }
+      StreamlineInfo& line = this->Lines[currentLine];
+      int direction =
+        this->IntegrationDirections->GetValue(currentLine) ==
+        vtkStreamTracer::BACKWARD ? -1 : 1;
+      double seed[3];
+      this->SeedSource->GetTuple(this->SeedIds->GetId(currentLine), seed);
+
+      // Always start the search from the first dataset so that the
+      // streamline does not depend on the previous ones of the thread.
+      state.Func->SetLastCellId(-1, 0);
+
+      line.State = &state;
+      line.Begin = state.Points->GetNumberOfPoints();
+      line.ReasonForTermination = vtkStreamTracer::OUT_OF_LENGTH;
+      line.Propagation = 0.0;
+      line.NumberOfSteps = 0;
+      line.IntegrationTime = 0.0;
+      bool abort = false;
+      line.NumberOfPoints = this->Tracer->IntegrateLine(
+        state, seed, direction, currentLine, this->NumberOfLines, lastPoint,
+        line.Propagation, line.NumberOfSteps, line.IntegrationTime,
+        line.ReasonForTermination, abort);
+      line.LastUsedStepSize = state.LastUsedStepSize;
+      if (abort)
+        {
+        break;
+        }
+      }
+  }
+
+  void Reduce()
+  {
+  }
+};
+
 void vtkStreamTracer::Integrate(vtkPointData *input0Data,
                                 vtkPolyData* output,
                                 vtkDataArray* seedSource,
@@ -667,7 +918,7 @@ void vtkStreamTracer::Integrate(vtkPointData *input0Data,
                                 vtkIdType& inNumSteps,
                                 double &inIntegrationTime)
 {
-  int i;
+  vtkIdType i;
   vtkIdType numLines = seedIds->GetNumberOfIds();
   double propagation = inPropagation;
   vtkIdType numSteps = inNumSteps;
@@ -676,11 +927,6 @@ void vtkStreamTracer::Integrate(vtkPointData *input0Data,
   // Useful pointers
   vtkDataSetAttributes* outputPD = output->GetPointData();
   vtkDataSetAttributes* outputCD = output->GetCellData();
-  vtkPointData* inputPD;
-  vtkDataSet* input;
-  vtkDataArray* inVectors;
-
-  int direction=1;
 
   if (this->GetIntegrator() == 0)
     {
@@ -786,17 +1032,54 @@ void vtkStreamTracer::Integrate(vtkPointData *input0Data,
   outputPD->InterpolateAllocate( input0Data,
                                  this->MaximumNumberOfSteps );
 
-  vtkIdType numPtsTotal=0;
-  double velocity[3];
+  IntegrationState state;
+  state.Func = func;
+  state.SurfaceFunc = surfaceFunc;
+  state.Integrator = integrator;
+  state.Cell = cell;
+  state.Weights = weights;
+  state.CellVectors = cellVectors;
+  state.VecType = vecType;
+  state.VecName = vecName;
+  state.ReportProgress = true;
+  state.LastUsedStepSize = this->LastUsedStepSize;
+  state.Points = outputPoints;
+  state.PointData = outputPD;
+  state.Time = time;
+  state.VelocityVectors = velocityVectors;
+  state.Vorticity = vorticity;
+  state.Rotation = rotation;
+  state.AngularVelocity = angularVel;
+
+  bool shouldAbort = false;
+
+  // The seeds are integrated in parallel when each thread can use its own
+  // copy of the velocity field. The streamlines start from the first
+  // dataset instead of the last one used, and the last point is not
+  // reported since there is no last streamline.
+  vtkCompositeInterpolatedVelocityField* compositeFunc =
+    vtkCompositeInterpolatedVelocityField::SafeDownCast(func);
+  if (numLines > 1 && compositeFunc &&
+      !vtkAMRInterpolatedVelocityField::SafeDownCast(func) &&
+      this->HasMatchingPointAttributes && this->InputData &&
+      propagation == 0.0 && numSteps == 0 && integrationTime == 0.0)
+    {
+    shouldAbort = !this->IntegrateInParallel(
+      state, input0Data, outputLines, retVals, sids, seedSource, seedIds,
+      integrationDirections, maxCellSize, inPropagation, inNumSteps,
+      inIntegrationTime);
+    numLines = 0;
+    }
 
-  int shouldAbort = 0;
+  vtkIdType numPtsTotal=0;
 
-  for(int currentLine = 0; currentLine < numLines; currentLine++)
+  for(vtkIdType currentLine = 0; currentLine < numLines; currentLine++)
     {
 
     double progress = static_cast<double>(currentLine)/numLines;
     this->UpdateProgress(progress);
 
+    int direction=1;
     switch (integrationDirections->GetValue(currentLine))
       {
       case FORWARD:
@@ -807,312 +1090,21 @@ void vtkStreamTracer::Integrate(vtkPointData *input0Data,
         break;
       }
 
-    // temporary variables used in the integration
-    double point1[3], point2[3], pcoords[3], vort[3], omega;
-    vtkIdType index, numPts=0;
-
-    // Clear the last cell to avoid starting a search from
-    // the last point in the streamline
-    func->ClearLastCellId();
-
     // Initial point
-    seedSource->GetTuple(seedIds->GetId(currentLine), point1);
-    memcpy(point2, point1, 3*sizeof(double));
-    if (!func->FunctionValues(point1, velocity))
+    double seed[3];
+    seedSource->GetTuple(seedIds->GetId(currentLine), seed);
+
+    int retVal=OUT_OF_LENGTH;
+    vtkIdType numPts = this->IntegrateLine(state, seed, direction,
+                                           currentLine, numLines, lastPoint,
+                                           propagation, numSteps,
+                                           integrationTime, retVal,
+                                           shouldAbort);
+    if (numPts == 0)
       {
       continue;
       }
-
-    if ( propagation >= this->MaximumPropagation ||
-         numSteps    >  this->MaximumNumberOfSteps)
-      {
-      continue;
-      }
-
-    numPts++;
-    numPtsTotal++;
-    vtkIdType nextPoint = outputPoints->InsertNextPoint(point1);
-    double lastInsertedPoint[3];
-    outputPoints->GetPoint(nextPoint, lastInsertedPoint);
-    time->InsertNextValue(integrationTime);
-
-    // We will always pass an arc-length step size to the integrator.
-    // If the user specifies a step size in cell length unit, we will
-    // have to convert it to arc length.
-    IntervalInformation stepSize;  // either positive or negative
-    stepSize.Unit  = LENGTH_UNIT;
-    stepSize.Interval = 0;
-    IntervalInformation aStep; // always positive
-    aStep.Unit = LENGTH_UNIT;
-    double step, minStep=0, maxStep=0;
-    double stepTaken;
-    double speed;
-    double cellLength;
-    int retVal=OUT_OF_LENGTH, tmp;
-
-    // Make sure we use the dataset found by the vtkAbstractInterpolatedVelocityField
-    input = func->GetLastDataSet();
-    inputPD = input->GetPointData();
-    inVectors = input->GetAttributesAsFieldData(vecType)->GetArray(vecName);
-    // Convert intervals to arc-length unit
-    input->GetCell(func->GetLastCellId(), cell);
-    cellLength = sqrt(static_cast<double>(cell->GetLength2()));
-    speed = vtkMath::Norm(velocity);
-    // Never call conversion methods if speed == 0
-    if ( speed != 0.0 )
-      {
-      this->ConvertIntervals( stepSize.Interval, minStep, maxStep,
-                              direction, cellLength );
-      }
-
-    // Interpolate all point attributes on first point
-    func->GetLastWeights(weights);
-    InterpolatePoint(outputPD, inputPD, nextPoint, cell->PointIds, weights, this->HasMatchingPointAttributes);
-    if(vecType != vtkDataObject::POINT)
-      {
-      velocityVectors->InsertNextTuple(velocity);
-      }
-
-    // Compute vorticity if required
-    // This can be used later for streamribbon generation.
-    if (this->ComputeVorticity)
-      {
-      if(vecType == vtkDataObject::POINT)
-        {
-        inVectors->GetTuples(cell->PointIds, cellVectors);
-        func->GetLastLocalCoordinates(pcoords);
-        vtkStreamTracer::CalculateVorticity(cell, pcoords, cellVectors, vort);
-        }
-      else
-        {
-        vort[0] = 0;
-        vort[1] = 0;
-        vort[2] = 0;
-        }
-      vorticity->InsertNextTuple(vort);
-      // rotation
-      // local rotation = vorticity . unit tangent ( i.e. velocity/speed )
-      if (speed != 0.0)
-        {
-        omega = vtkMath::Dot(vort, velocity);
-        omega /= speed;
-        omega *= this->RotationScale;
-        }
-      else
-        {
-        omega = 0.0;
-        }
-      angularVel->InsertNextValue(omega);
-      rotation->InsertNextValue(0.0);
-      }
-
-    double error = 0;
-
-    // Integrate until the maximum propagation length is reached,
-    // maximum number of steps is reached or until a boundary is encountered.
-    // Begin Integration
-    while ( propagation < this->MaximumPropagation )
-      {
-
-      if (numSteps > this->MaximumNumberOfSteps)
-        {
-        retVal = OUT_OF_STEPS;
-        break;
-        }
-
-      if ( numSteps++ % 1000 == 1 )
-        {
-        progress =
-          ( currentLine + propagation / this->MaximumPropagation ) / numLines;
-        this->UpdateProgress(progress);
-
-        if (this->GetAbortExecute())
-          {
-          shouldAbort = 1;
-          break;
-          }
-        }
-
-      // Never call conversion methods if speed == 0
-      if ( (speed == 0) || (speed <= this->TerminalSpeed) )
-        {
-        retVal = STAGNATION;
-        break;
-        }
-
-      // If, with the next step, propagation will be larger than
-      // max, reduce it so that it is (approximately) equal to max.
-      aStep.Interval = fabs( stepSize.Interval );
-
-      if ( ( propagation + aStep.Interval ) > this->MaximumPropagation )
-        {
-        aStep.Interval = this->MaximumPropagation - propagation;
-        if ( stepSize.Interval >= 0 )
-          {
-          stepSize.Interval = this->ConvertToLength( aStep, cellLength );
-          }
-        else
-          {
-          stepSize.Interval = this->ConvertToLength( aStep, cellLength ) * ( -1.0 );
-          }
-        maxStep = stepSize.Interval;
-        }
-      this->LastUsedStepSize = stepSize.Interval;
-
-      // Calculate the next step using the integrator provided
-      // Break if the next point is out of bounds.
-      func->SetNormalizeVector( true );
-      tmp = integrator->ComputeNextStep( point1, point2, 0, stepSize.Interval,
-                                         stepTaken, minStep, maxStep,
-                                         this->MaximumError, error );
-      func->SetNormalizeVector( false );
-      if ( tmp != 0 )
-        {
-        retVal = tmp;
-        memcpy(lastPoint, point2, 3*sizeof(double));
-        break;
-        }
-
-      // This is the next starting point
-      if (this->SurfaceStreamlines && surfaceFunc != NULL)
-        {
-        if (surfaceFunc->SnapPointOnCell(point2, point1) != 1)
-          {
-          retVal = OUT_OF_DOMAIN;
-          memcpy(lastPoint, point2, 3 * sizeof(double));
-          break;
-          }
-        }
-      else
-        {
-        for (i = 0; i < 3; i++)
-          {
-          point1[i] = point2[i];
-          }
-        }
-
-      // Interpolate the velocity at the next point
-      if ( !func->FunctionValues(point2, velocity) )
-        {
-        retVal = OUT_OF_DOMAIN;
-        memcpy(lastPoint, point2, 3*sizeof(double));
-        break;
-        }
-
-      // It is not enough to use the starting point for stagnation calculation
-      // Use average speed to check if it is below stagnation threshold
-      double speed2 = vtkMath::Norm(velocity);
-      if ( (speed+speed2)/2 <= this->TerminalSpeed )
-        {
-        retVal = STAGNATION;
-        break;
-        }
-
-      integrationTime += stepTaken / speed;
-      // Calculate propagation (using the same units as MaximumPropagation
-      propagation += fabs( stepSize.Interval );
-
-      // Make sure we use the dataset found by the vtkAbstractInterpolatedVelocityField
-      input = func->GetLastDataSet();
-      inputPD = input->GetPointData();
-      inVectors = input->GetAttributesAsFieldData(vecType)->GetArray(vecName);
-
-      // Calculate cell length and speed to be used in unit conversions
-      input->GetCell(func->GetLastCellId(), cell);
-      cellLength = sqrt(static_cast<double>(cell->GetLength2()));
-      speed = speed2;
-
-      // Check if conversion to float will produce a point in same place
-      float convertedPoint[3];
-      for (i = 0; i < 3; i++)
-        {
-        convertedPoint[i] = point1[i];
-        }
-      if (lastInsertedPoint[0] != convertedPoint[0] ||
-          lastInsertedPoint[1] != convertedPoint[1] ||
-          lastInsertedPoint[2] != convertedPoint[2])
-        {
-        // Point is valid. Insert it.
-        numPts++;
-        numPtsTotal++;
-        nextPoint = outputPoints->InsertNextPoint(point1);
-        outputPoints->GetPoint(nextPoint, lastInsertedPoint);
-        time->InsertNextValue(integrationTime);
-
-        // Interpolate all point attributes on current point
-        func->GetLastWeights(weights);
-        InterpolatePoint(outputPD, inputPD, nextPoint, cell->PointIds, weights, this->HasMatchingPointAttributes);
-
-        if(vecType != vtkDataObject::POINT)
-          {
-          velocityVectors->InsertNextTuple(velocity);
-          }
-        // Compute vorticity if required
-        // This can be used later for streamribbon generation.
-        if (this->ComputeVorticity)
-          {
-          if(vecType == vtkDataObject::POINT)
-            {
-            inVectors->GetTuples(cell->PointIds, cellVectors);
-            func->GetLastLocalCoordinates(pcoords);
-            vtkStreamTracer::CalculateVorticity(cell, pcoords, cellVectors, vort);
-            }
-          else
-            {
-            vort[0] = 0;
-            vort[1] = 0;
-            vort[2] = 0;
-            }
-          vorticity->InsertNextTuple(vort);
-          // rotation
-          // angular velocity = vorticity . unit tangent ( i.e. velocity/speed )
-          // rotation = sum ( angular velocity * stepSize )
-          omega = vtkMath::Dot(vort, velocity);
-          omega /= speed;
-          omega *= this->RotationScale;
-          index = angularVel->InsertNextValue(omega);
-          rotation->InsertNextValue(rotation->GetValue(index-1) +
-                                    (angularVel->GetValue(index-1) + omega)/2 *
-                                    (integrationTime - time->GetValue(index-1)));
-          }
-        }
-
-      // Never call conversion methods if speed == 0
-      if ( (speed == 0) || (speed <= this->TerminalSpeed) )
-        {
-        retVal = STAGNATION;
-        break;
-        }
-
-      // Convert all intervals to arc length
-      this->ConvertIntervals( step, minStep, maxStep, direction, cellLength );
-
-
-      // If the solver is adaptive and the next step size (stepSize.Interval)
-      // that the solver wants to use is smaller than minStep or larger
-      // than maxStep, re-adjust it. This has to be done every step
-      // because minStep and maxStep can change depending on the cell
-      // size (unless it is specified in arc-length unit)
-      if (integrator->IsAdaptive())
-        {
-        if (fabs(stepSize.Interval) < fabs(minStep))
-          {
-          stepSize.Interval = fabs( minStep ) *
-                                stepSize.Interval / fabs( stepSize.Interval );
-          }
-        else if (fabs(stepSize.Interval) > fabs(maxStep))
-          {
-          stepSize.Interval = fabs( maxStep ) *
-                                stepSize.Interval / fabs( stepSize.Interval );
-          }
-        }
-      else
-        {
-        stepSize.Interval = step;
-        }
-
-      // End Integration
-      }
+    numPtsTotal += numPts;
 
     if (shouldAbort)
       {
@@ -1141,6 +1133,7 @@ void vtkStreamTracer::Integrate(vtkPointData *input0Data,
     numSteps = 0;
     integrationTime = 0;
     }
+  this->LastUsedStepSize = state.LastUsedStepSize;
 
   if (!shouldAbort)
     {
@@ -1202,6 +1195,480 @@ void vtkStreamTracer::Integrate(vtkPointData *input0Data,
   return;
 }
 
+vtkIdType vtkStreamTracer::IntegrateLine(IntegrationState& state,
+                                         double seed[3],
+                                         int direction,
+                                         vtkIdType currentLine,
+                                         vtkIdType numLines,
+                                         double lastPoint[3],
+                                         double& propagation,
+                                         vtkIdType& numSteps,
+                                         double& integrationTime,
+                                         int& retVal,
+                                         bool& shouldAbort)
+{
+  int i;
+  vtkAbstractInterpolatedVelocityField* func = state.Func;
+  vtkInterpolatedVelocityField* surfaceFunc = state.SurfaceFunc;
+  vtkInitialValueProblemSolver* integrator = state.Integrator;
+  vtkGenericCell* cell = state.Cell;
+  double* weights = state.Weights;
+  vtkDoubleArray* cellVectors = state.CellVectors;
+  int vecType = state.VecType;
+  const char* vecName = state.VecName;
+  vtkPoints* outputPoints = state.Points;
+  vtkDataSetAttributes* outputPD = state.PointData;
+  vtkDoubleArray* time = state.Time;
+  vtkDoubleArray* velocityVectors = state.VelocityVectors;
+  vtkDoubleArray* vorticity = state.Vorticity;
+  vtkDoubleArray* rotation = state.Rotation;
+  vtkDoubleArray* angularVel = state.AngularVelocity;
+
+  vtkPointData* inputPD;
+  vtkDataSet* input;
+  vtkDataArray* inVectors;
+  double velocity[3];
+  double progress;
+
+  // temporary variables used in the integration
+  double point1[3], point2[3], pcoords[3], vort[3], omega;
+  vtkIdType index, numPts=0;
+
+  // Clear the last cell to avoid starting a search from
+  // the last point in the streamline
+  func->ClearLastCellId();
+
+  // Initial point
+  memcpy(point1, seed, 3*sizeof(double));
+  memcpy(point2, point1, 3*sizeof(double));
+  if (!func->FunctionValues(point1, velocity))
+    {
+    return 0;
+    }
+
+  if ( propagation >= this->MaximumPropagation ||
+       numSteps    >  this->MaximumNumberOfSteps)
+    {
+    return 0;
+    }
+
+  numPts++;
+  vtkIdType nextPoint = outputPoints->InsertNextPoint(point1);
+  double lastInsertedPoint[3];
+  outputPoints->GetPoint(nextPoint, lastInsertedPoint);
+  time->InsertNextValue(integrationTime);
+
+  // We will always pass an arc-length step size to the integrator.
+  // If the user specifies a step size in cell length unit, we will
+  // have to convert it to arc length.
+  IntervalInformation stepSize;  // either positive or negative
+  stepSize.Unit  = LENGTH_UNIT;
+  stepSize.Interval = 0;
+  IntervalInformation aStep; // always positive
+  aStep.Unit = LENGTH_UNIT;
+  double step, minStep=0, maxStep=0;
+  double stepTaken;
+  double speed;
+  double cellLength;
+  int tmp;
+  retVal = OUT_OF_LENGTH;
+
+  // Make sure we use the dataset found by the vtkAbstractInterpolatedVelocityField
+  input = func->GetLastDataSet();
+  inputPD = input->GetPointData();
+  inVectors = input->GetAttributesAsFieldData(vecType)->GetArray(vecName);
+  // Convert intervals to arc-length unit
+  input->GetCell(func->GetLastCellId(), cell);
+  cellLength = sqrt(static_cast<double>(cell->GetLength2()));
+  speed = vtkMath::Norm(velocity);
+  // Never call conversion methods if speed == 0
+  if ( speed != 0.0 )
+    {
+    this->ConvertIntervals( stepSize.Interval, minStep, maxStep,
+                            direction, cellLength );
+    }
+
+  // Interpolate all point attributes on first point
+  func->GetLastWeights(weights);
+  InterpolatePoint(outputPD, inputPD, nextPoint, cell->PointIds, weights, this->HasMatchingPointAttributes);
+  if(vecType != vtkDataObject::POINT)
+    {
+    velocityVectors->InsertNextTuple(velocity);
+    }
+
+  // Compute vorticity if required
+  // This can be used later for streamribbon generation.
+  if (this->ComputeVorticity)
+    {
+    if(vecType == vtkDataObject::POINT)
+      {
+      inVectors->GetTuples(cell->PointIds, cellVectors);
+      func->GetLastLocalCoordinates(pcoords);
+      vtkStreamTracer::CalculateVorticity(cell, pcoords, cellVectors, vort);
+      }
+    else
+      {
+      vort[0] = 0;
+      vort[1] = 0;
+      vort[2] = 0;
+      }
+    vorticity->InsertNextTuple(vort);
+    // rotation
+    // local rotation = vorticity . unit tangent ( i.e. velocity/speed )
+    if (speed != 0.0)
+      {
+      omega = vtkMath::Dot(vort, velocity);
+      omega /= speed;
+      omega *= this->RotationScale;
+      }
+    else
+      {
+      omega = 0.0;
+      }
+    angularVel->InsertNextValue(omega);
+    rotation->InsertNextValue(0.0);
+    }
+
+  double error = 0;
+
+  // Integrate until the maximum propagation length is reached,
+  // maximum number of steps is reached or until a boundary is encountered.
+  // Begin Integration
+  while ( propagation < this->MaximumPropagation )
+    {
+
+    if (numSteps > this->MaximumNumberOfSteps)
+      {
+      retVal = OUT_OF_STEPS;
+      break;
+      }
+
+    if ( numSteps++ % 1000 == 1 )
+      {
+      if (state.ReportProgress)
+        {
+        progress =
+          ( currentLine + propagation / this->MaximumPropagation ) / numLines;
+        this->UpdateProgress(progress);
+        }
+
+      if (this->GetAbortExecute())
+        {
+        shouldAbort = true;
+        break;
+        }
+      }
+
+    // Never call conversion methods if speed == 0
+    if ( (speed == 0) || (speed <= this->TerminalSpeed) )
+      {
+      retVal = STAGNATION;
+      break;
+      }
+
+    // If, with the next step, propagation will be larger than
+    // max, reduce it so that it is (approximately) equal to max.
+    aStep.Interval = fabs( stepSize.Interval );
+
+    if ( ( propagation + aStep.Interval ) > this->MaximumPropagation )
+      {
+      aStep.Interval = this->MaximumPropagation - propagation;
+      if ( stepSize.Interval >= 0 )
+        {
+        stepSize.Interval = this->ConvertToLength( aStep, cellLength );
+        }
+      else
+        {
+        stepSize.Interval = this->ConvertToLength( aStep, cellLength ) * ( -1.0 );
+        }
+      maxStep = stepSize.Interval;
+      }
+    state.LastUsedStepSize = stepSize.Interval;
+
+    // Calculate the next step using the integrator provided
+    // Break if the next point is out of bounds.
+    func->SetNormalizeVector( true );
+    tmp = integrator->ComputeNextStep( point1, point2, 0, stepSize.Interval,
+                                       stepTaken, minStep, maxStep,
+                                       this->MaximumError, error );
+    func->SetNormalizeVector( false );
+    if ( tmp != 0 )
+      {
+      retVal = tmp;
+      memcpy(lastPoint, point2, 3*sizeof(double));
+      break;
+      }
+
+    // This is the next starting point
+    if (this->SurfaceStreamlines && surfaceFunc != NULL)
+      {
+      if (surfaceFunc->SnapPointOnCell(point2, point1) != 1)
+        {
+        retVal = OUT_OF_DOMAIN;
+        memcpy(lastPoint, point2, 3 * sizeof(double));
+        break;
+        }
+      }
+    else
+      {
+      for (i = 0; i < 3; i++)
+        {
+        point1[i] = point2[i];
+        }
+      }
+
+    // Interpolate the velocity at the next point
+    if ( !func->FunctionValues(point2, velocity) )
+      {
+      retVal = OUT_OF_DOMAIN;
+      memcpy(lastPoint, point2, 3*sizeof(double));
+      break;
+      }
+
+    // It is not enough to use the starting point for stagnation calculation
+    // Use average speed to check if it is below stagnation threshold
+    double speed2 = vtkMath::Norm(velocity);
+    if ( (speed+speed2)/2 <= this->TerminalSpeed )
+      {
+      retVal = STAGNATION;
+      break;
+      }
+
+    integrationTime += stepTaken / speed;
+    // Calculate propagation (using the same units as MaximumPropagation
+    propagation += fabs( stepSize.Interval );
+
+    // Make sure we use the dataset found by the vtkAbstractInterpolatedVelocityField
+    input = func->GetLastDataSet();
+    inputPD = input->GetPointData();
+    inVectors = input->GetAttributesAsFieldData(vecType)->GetArray(vecName);
+
+    // Calculate cell length and speed to be used in unit conversions
+    input->GetCell(func->GetLastCellId(), cell);
+    cellLength = sqrt(static_cast<double>(cell->GetLength2()));
+    speed = speed2;
+
+    // Check if conversion to float will produce a point in same place
+    float convertedPoint[3];
+    for (i = 0; i < 3; i++)
+      {
+      convertedPoint[i] = point1[i];
+      }
+    if (lastInsertedPoint[0] != convertedPoint[0] ||
+        lastInsertedPoint[1] != convertedPoint[1] ||
+        lastInsertedPoint[2] != convertedPoint[2])
+      {
+      // Point is valid. Insert it.
+      numPts++;
+      nextPoint = outputPoints->InsertNextPoint(point1);
+      outputPoints->GetPoint(nextPoint, lastInsertedPoint);
+      time->InsertNextValue(integrationTime);
+
+      // Interpolate all point attributes on current point
+      func->GetLastWeights(weights);
+      InterpolatePoint(outputPD, inputPD, nextPoint, cell->PointIds, weights, this->HasMatchingPointAttributes);
+
+      if(vecType != vtkDataObject::POINT)
+        {
+        velocityVectors->InsertNextTuple(velocity);
+        }
+      // Compute vorticity if required
+      // This can be used later for streamribbon generation.
+      if (this->ComputeVorticity)
+        {
+        if(vecType == vtkDataObject::POINT)
+          {
+          inVectors->GetTuples(cell->PointIds, cellVectors);
+          func->GetLastLocalCoordinates(pcoords);
+          vtkStreamTracer::CalculateVorticity(cell, pcoords, cellVectors, vort);
+          }
+        else
+          {
+          vort[0] = 0;
+          vort[1] = 0;
+          vort[2] = 0;
+          }
+        vorticity->InsertNextTuple(vort);
+        // rotation
+        // angular velocity = vorticity . unit tangent ( i.e. velocity/speed )
+        // rotation = sum ( angular velocity * stepSize )
+        omega = vtkMath::Dot(vort, velocity);
+        omega /= speed;
+        omega *= this->RotationScale;
+        index = angularVel->InsertNextValue(omega);
+        rotation->InsertNextValue(rotation->GetValue(index-1) +
+                                  (angularVel->GetValue(index-1) + omega)/2 *
+                                  (integrationTime - time->GetValue(index-1)));
+        }
+      }
+
+    // Never call conversion methods if speed == 0
+    if ( (speed == 0) || (speed <= this->TerminalSpeed) )
+      {
+      retVal = STAGNATION;
+      break;
+      }
+
+    // Convert all intervals to arc length
+    this->ConvertIntervals( step, minStep, maxStep, direction, cellLength );
+
+
+    // If the solver is adaptive and the next step size (stepSize.Interval)
+    // that the solver wants to use is smaller than minStep or larger
+    // than maxStep, re-adjust it. This has to be done every step
+    // because minStep and maxStep can change depending on the cell
+    // size (unless it is specified in arc-length unit)
+    if (integrator->IsAdaptive())
+      {
+      if (fabs(stepSize.Interval) < fabs(minStep))
+        {
+        stepSize.Interval = fabs( minStep ) *
+                              stepSize.Interval / fabs( stepSize.Interval );
+        }
+      else if (fabs(stepSize.Interval) > fabs(maxStep))
+        {
+        stepSize.Interval = fabs( maxStep ) *
+                              stepSize.Interval / fabs( stepSize.Interval );
+        }
+      }
+    else
+      {
+      stepSize.Interval = step;
+      }
+
+    // End Integration
+    }
+
+  return numPts;
+}
+
+bool vtkStreamTracer::IntegrateInParallel(IntegrationState& output,
+                                          vtkPointData* input0Data,
+                                          vtkCellArray* outputLines,
+                                          vtkIntArray* retVals,
+                                          vtkIntArray* sids,
+                                          vtkDataArray* seedSource,
+                                          vtkIdList* seedIds,
+                                          vtkIntArray* integrationDirections,
+                                          int maxCellSize,
+                                          double& propagation,
+                                          vtkIdType& numSteps,
+                                          double& integrationTime)
+{
+  vtkIdType numLines = seedIds->GetNumberOfIds();
+
+  vtkStreamTracerIntegrateFunctor functor;
+  functor.Tracer = this;
+  functor.Func = output.Func;
+  functor.InputPointData = input0Data;
+  functor.MaxCellSize = maxCellSize;
+  functor.VecType = output.VecType;
+  functor.VecName = output.VecName;
+  functor.SeedSource = seedSource;
+  functor.SeedIds = seedIds;
+  functor.IntegrationDirections = integrationDirections;
+  functor.NumberOfLines = numLines;
+
+  // Collect the datasets of the velocity field (as CheckInputs() does) and
+  // build their search structures before sharing them between the threads.
+  bool findCell =
+    vtkInterpolatedVelocityField::SafeDownCast(output.Func) != 0;
+  vtkSmartPointer<vtkCompositeDataIterator> iter;
+  iter.TakeReference(this->InputData->NewIterator());
+  for (iter->GoToFirstItem(); !iter->IsDoneWithTraversal();
+       iter->GoToNextItem())
+    {
+    vtkDataSet* input = vtkDataSet::SafeDownCast(iter->GetCurrentDataObject());
+    if (input)
+      {
+      BuildSearchStructures(input, findCell, output.Cell, output.Weights);
+      functor.DataSets.push_back(input);
+      }
+    }
+  if (functor.DataSets.empty())
+    {
+    return true;
+    }
+
+  typedef vtkStreamTracerIntegrateFunctor::StreamlineInfo StreamlineInfo;
+  std::vector<StreamlineInfo> lines(numLines);
+  for (vtkIdType i = 0; i < numLines; i++)
+    {
+    lines[i].State = 0;
+    lines[i].NumberOfPoints = 0;
+    }
+  functor.Lines = &lines[0];
+
+  // Integrate the seeds by batches to report progress and check for abort
+  // between the batches. A streamline can be much longer than another one,
+  // hence the small grain.
+  const vtkIdType numBatches = 10;
+  vtkIdType batchSize = numLines / numBatches + 1;
+  for (vtkIdType first = 0; first < numLines; first += batchSize)
+    {
+    vtkIdType last = std::min(first + batchSize, numLines);
+    vtkSMPTools::For(first, last, 1, functor);
+    this->UpdateProgress(static_cast<double>(last) / numLines);
+    if (this->GetAbortExecute())
+      {
+      return false;
+      }
+    }
+
+  // Stitch the streamlines in seed order.
+  vtkIdType numPtsTotal = 0;
+  for (vtkIdType currentLine = 0; currentLine < numLines; currentLine++)
+    {
+    const StreamlineInfo& line = lines[currentLine];
+    vtkIdType numPts = line.NumberOfPoints;
+    if (numPts == 0)
+      {
+      continue;
+      }
+    IntegrationState& state = *line.State;
+    output.Points->InsertPoints(numPtsTotal, numPts, line.Begin, state.Points);
+    for (int a = 0; a < output.PointData->GetNumberOfArrays(); a++)
+      {
+      output.PointData->GetAbstractArray(a)->InsertTuples(
+        numPtsTotal, numPts, line.Begin, state.PointData->GetAbstractArray(a));
+      }
+    output.Time->InsertTuples(numPtsTotal, numPts, line.Begin, state.Time);
+    if (output.VelocityVectors)
+      {
+      output.VelocityVectors->InsertTuples(
+        numPtsTotal, numPts, line.Begin, state.VelocityVectors);
+      }
+    if (output.Vorticity)
+      {
+      output.Vorticity->InsertTuples(
+        numPtsTotal, numPts, line.Begin, state.Vorticity);
+      output.Rotation->InsertTuples(
+        numPtsTotal, numPts, line.Begin, state.Rotation);
+      output.AngularVelocity->InsertTuples(
+        numPtsTotal, numPts, line.Begin, state.AngularVelocity);
+      }
+
+    if (numPts > 1)
+      {
+      outputLines->InsertNextCell(numPts);
+      for (vtkIdType i = numPtsTotal; i < numPtsTotal + numPts; i++)
+        {
+        outputLines->InsertCellPoint(i);
+        }
+      retVals->InsertNextValue(line.ReasonForTermination);
+      sids->InsertNextValue(seedIds->GetId(currentLine));
+      }
+    numPtsTotal += numPts;
+
+    propagation = line.Propagation;
+    numSteps = line.NumberOfSteps;
+    integrationTime = line.IntegrationTime;
+    output.LastUsedStepSize = line.LastUsedStepSize;
+    }
+
+  return true;
+}
+
 void vtkStreamTracer::GenerateNormals(vtkPolyData* output, double* firstNormal,
                                       const char *vecName)
 {
@@ -67,6 +67,13 @@
 // a source object, traces will be generated from each point in the source
 // that is inside the dataset.
 //
+// The seeds are integrated in parallel with vtkSMPTools when the velocity
+// field is an interpolator of vtkCompositeInterpolatedVelocityField type
+// (but not vtkAMRInterpolatedVelocityField). Each thread uses its own copy
+// of the interpolator and of the integrator, and each streamline starts its
+// search from the first dataset. The streamlines are stitched in seed order,
+// so that the output does not depend on the number of threads.
+//
 // .SECTION See Also
 // vtkRibbonFilter vtkRuledSurfaceFilter vtkInitialValueProblemSolver
 // vtkRungeKutta2 vtkRungeKutta4 vtkRungeKutta45 vtkTemporalStreamTracer
@@ -82,6 +89,7 @@
 
 #include "vtkInitialValueProblemSolver.h" // Needed for constants
 
+class vtkCellArray;
 class vtkCompositeDataSet;
 class vtkDataArray;
 class vtkDoubleArray;
@@ -331,6 +339,48 @@ protected:
                  double& propagation,
                  vtkIdType& numSteps,
                  double& integrationTime);
+
+  // Description:
+  // The objects used to integrate streamlines and the arrays receiving
+  // their points and point data (see vtkStreamTracer.cxx).
+  struct IntegrationState;
+
+  // Description:
+  // Integrate the streamline of the seed in the given direction (1 or -1)
+  // and append its points to the arrays of state. Return the number of
+  // points appended, 0 if the seed is out of the domain or if propagation or
+  // numSteps are already out of bounds. shouldAbort is set to true if the
+  // execution was aborted during the integration.
+  vtkIdType IntegrateLine(IntegrationState& state,
+                          double seed[3],
+                          int direction,
+                          vtkIdType currentLine,
+                          vtkIdType numLines,
+                          double lastPoint[3],
+                          double& propagation,
+                          vtkIdType& numSteps,
+                          double& integrationTime,
+                          int& retVal,
+                          bool& shouldAbort);
+
+  // Description:
+  // Integrate the seeds with vtkSMPTools, each thread using its own copy of
+  // the velocity field and of the integrator, and append the streamlines to
+  // the arrays of output in seed order. The output is then the same whatever
+  // the number of threads. Return false if the execution was aborted.
+  bool IntegrateInParallel(IntegrationState& output,
+                           vtkPointData* input0Data,
+                           vtkCellArray* outputLines,
+                           vtkIntArray* retVals,
+                           vtkIntArray* sids,
+                           vtkDataArray* seedSource,
+                           vtkIdList* seedIds,
+                           vtkIntArray* integrationDirections,
+                           int maxCellSize,
+                           double& propagation,
+                           vtkIdType& numSteps,
+                           double& integrationTime);
+
   double SimpleIntegrate(double seed[3],
                          double lastPoint[3],
                          double stepSize,
@@ -393,6 +443,7 @@ protected:
   bool HasMatchingPointAttributes; //does the point data in the multiblocks have the same attributes?
 
   friend class PStreamTracerUtils;
+  friend class vtkStreamTracerIntegrateFunctor;
 
 private:
   vtkStreamTracer(const vtkStreamTracer&) VTK_DELETE_FUNCTION;
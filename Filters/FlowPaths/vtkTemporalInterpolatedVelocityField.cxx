@@ -85,6 +85,60 @@ void vtkTemporalInterpolatedVelocityField::SetDataSetAtTime(int I, int N, double
     }
 }
 //---------------------------------------------------------------------------
+void vtkTemporalInterpolatedVelocityField::CopyParameters(
+  vtkTemporalInterpolatedVelocityField* from)
+{
+  this->SetVectorsSelection(from->IVF[0]->GetVectorsSelection());
+  for (int N=0; N<2; N++)
+    {
+    this->Times[N] = from->Times[N];
+    IVFCacheList &cacheList = from->IVF[N]->CacheList;
+    for (size_t i=0; i<cacheList.size(); i++)
+      {
+      if (cacheList[i].DataSet)
+        {
+        this->IVF[N]->SetDataSet(static_cast<int>(i), cacheList[i].DataSet,
+          cacheList[i].StaticDataSet, cacheList[i].BSPTree);
+        }
+      }
+    }
+  this->ScaleCoeff = from->ScaleCoeff;
+  this->StaticDataSets = from->StaticDataSets;
+}
+//---------------------------------------------------------------------------
+void vtkTemporalInterpolatedVelocityField::BuildSearchStructures()
+{
+  vtkSmartPointer<vtkGenericCell> cell = vtkSmartPointer<vtkGenericCell>::New();
+  for (int N=0; N<2; N++)
+    {
+    IVFCacheList &cacheList = this->IVF[N]->CacheList;
+    for (size_t i=0; i<cacheList.size(); i++)
+      {
+      vtkDataSet *ds = cacheList[i].DataSet;
+      if (!ds || ds->GetNumberOfCells()==0 || ds->GetNumberOfPoints()==0)
+        {
+        continue;
+        }
+      // locating the first point builds the locators, GetCell() builds
+      // the cell structure of polydata
+      double x[3], pcoords[3];
+      int subId;
+      std::vector<double> weights(ds->GetMaxCellSize()+1);
+      ds->GetCell(0, cell);
+      ds->GetPoint(0, x);
+      if (cacheList[i].BSPTree)
+        {
+        cacheList[i].BSPTree->FindCell(x, 0.0, cell, pcoords, &weights[0]);
+        }
+      else
+        {
+        ds->FindCell(x, NULL, cell, -1, cacheList[i].Tolerance, subId,
+          pcoords, &weights[0]);
+        }
+      }
+    }
+}
+//---------------------------------------------------------------------------
 bool vtkTemporalInterpolatedVelocityField::IsStatic(int datasetIndex)
 {
   return this->StaticDataSets[datasetIndex];
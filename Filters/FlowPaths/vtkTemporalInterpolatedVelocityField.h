@@ -91,6 +91,19 @@ public:
   // this function.
   void SetDataSetAtTime(int I, int N, double T, vtkDataSet* dataset, bool staticdataset);
 
+  // Description:
+  // Copy the datasets, times, vector selection and static flags of
+  // another field. The cell locators are shared with the other field
+  // while the cached cells and weights are not, so several copies can be
+  // evaluated concurrently once BuildSearchStructures() has been called
+  // on the original.
+  void CopyParameters(vtkTemporalInterpolatedVelocityField* from);
+
+  // Description:
+  // Build the cell locators and the lazily computed search structures of
+  // the datasets, which are otherwise built on the first evaluation.
+  void BuildSearchStructures();
+
   // Description:
   // Between iterations of the Particle Tracer, Id's of the Cell
   // are stored and then at the start of the next particle the
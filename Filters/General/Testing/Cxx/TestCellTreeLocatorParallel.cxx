@@ -0,0 +1,361 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    TestCellTreeLocatorParallel.cxx
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+// Checks that vtkCellTreeLocator builds the same tree on one and on several
+// threads, and that its batch queries return the same cells as the single
+// point and single line queries, also for a subclass overriding the cell/ray
+// test.
+
+#include "vtkCellArray.h"
+#include "vtkCellTreeLocator.h"
+#include "vtkDoubleArray.h"
+#include "vtkGenericCell.h"
+#include "vtkIdList.h"
+#include "vtkMath.h"
+#include "vtkNew.h"
+#include "vtkObjectFactory.h"
+#include "vtkPoints.h"
+#include "vtkPolyData.h"
+#include "vtkSMPTools.h"
+#include "vtkSmartPointer.h"
+#include "vtkSphereSource.h"
+#include "vtkUnstructuredGrid.h"
+
+#include <vector>
+
+// Counts the cell/ray tests, which must all be done by the thread calling
+// the locator.
+class vtkCountingCellTreeLocator : public vtkCellTreeLocator
+{
+public:
+  static vtkCountingCellTreeLocator *New();
+  vtkTypeMacro(vtkCountingCellTreeLocator, vtkCellTreeLocator);
+
+  vtkIdType NumberOfTests;
+
+protected:
+  vtkCountingCellTreeLocator() : NumberOfTests(0) {}
+
+  virtual int IntersectCellInternal(vtkIdType cell_ID, const double p1[3],
+    const double p2[3], const double tol, double &t, double ipt[3],
+    double pcoords[3], int &subId)
+  {
+    ++this->NumberOfTests;
+    return this->Superclass::IntersectCellInternal(cell_ID, p1, p2, tol, t,
+                                                   ipt, pcoords, subId);
+  }
+
+private:
+  vtkCountingCellTreeLocator(const vtkCountingCellTreeLocator&) VTK_DELETE_FUNCTION;
+  void operator=(const vtkCountingCellTreeLocator&) VTK_DELETE_FUNCTION;
+};
+
+vtkStandardNewMacro(vtkCountingCellTreeLocator);
+
+namespace
+{
+
+const int Resolution = 28;
+
+vtkIdType PointId(int i, int j, int k)
+{
+  return i + (Resolution + 1) * (j + (Resolution + 1) * k);
+}
+
+// A grid of hexahedra and tetrahedra on [-1,1]^3 with jittered points.
+vtkSmartPointer<vtkUnstructuredGrid> MakeGrid()
+{
+  vtkMath::RandomSeed(1234);
+  vtkNew<vtkPoints> points;
+  for (int k = 0; k <= Resolution; k++)
+    {
+    for (int j = 0; j <= Resolution; j++)
+      {
+      for (int i = 0; i <= Resolution; i++)
+        {
+        double h = 0.3 / Resolution;
+        points->InsertNextPoint(
+          2.0 * i / Resolution - 1.0 + vtkMath::Random(-h, h),
+          2.0 * j / Resolution - 1.0 + vtkMath::Random(-h, h),
+          2.0 * k / Resolution - 1.0 + vtkMath::Random(-h, h));
+        }
+      }
+    }
+
+  vtkSmartPointer<vtkUnstructuredGrid> grid =
+    vtkSmartPointer<vtkUnstructuredGrid>::New();
+  grid->SetPoints(points.GetPointer());
+  grid->Allocate(Resolution * Resolution * Resolution);
+  for (int k = 0; k < Resolution; k++)
+    {
+    for (int j = 0; j < Resolution; j++)
+      {
+      for (int i = 0; i < Resolution; i++)
+        {
+        vtkIdType hex[8] = {
+          PointId(i, j, k), PointId(i + 1, j, k),
+          PointId(i + 1, j + 1, k), PointId(i, j + 1, k),
+          PointId(i, j, k + 1), PointId(i + 1, j, k + 1),
+          PointId(i + 1, j + 1, k + 1), PointId(i, j + 1, k + 1) };
+        if ((i + j + k) % 3 == 0)
+          {
+          vtkIdType tets[5][4] = {
+            { hex[0], hex[1], hex[3], hex[4] },
+            { hex[1], hex[2], hex[3], hex[6] },
+            { hex[1], hex[4], hex[5], hex[6] },
+            { hex[3], hex[4], hex[6], hex[7] },
+            { hex[1], hex[3], hex[4], hex[6] } };
+          for (int t = 0; t < 5; t++)
+            {
+            grid->InsertNextCell(VTK_TETRA, 4, tets[t]);
+            }
+          }
+        else
+          {
+          grid->InsertNextCell(VTK_HEXAHEDRON, 8, hex);
+          }
+        }
+      }
+    }
+  return grid;
+}
+
+vtkSmartPointer<vtkCellTreeLocator> NewLocator(vtkDataSet *ds,
+                                               int numThreads, bool cache)
+{
+  vtkSMPTools::Initialize(numThreads);
+  vtkSmartPointer<vtkCellTreeLocator> locator =
+    vtkSmartPointer<vtkCellTreeLocator>::New();
+  locator->SetDataSet(ds);
+  locator->SetCacheCellBounds(cache);
+  locator->BuildLocator();
+  return locator;
+}
+
+// The boxes of the leaves describe the whole tree.
+bool CompareTrees(vtkCellTreeLocator *a, vtkCellTreeLocator *b)
+{
+  vtkNew<vtkPolyData> pdA;
+  vtkNew<vtkPoints> ptsA;
+  vtkNew<vtkCellArray> linesA;
+  pdA->SetPoints(ptsA.GetPointer());
+  pdA->SetLines(linesA.GetPointer());
+  a->GenerateRepresentation(-1, pdA.GetPointer());
+
+  vtkNew<vtkPolyData> pdB;
+  vtkNew<vtkPoints> ptsB;
+  vtkNew<vtkCellArray> linesB;
+  pdB->SetPoints(ptsB.GetPointer());
+  pdB->SetLines(linesB.GetPointer());
+  b->GenerateRepresentation(-1, pdB.GetPointer());
+
+  if (ptsA->GetNumberOfPoints() == 0 ||
+      ptsA->GetNumberOfPoints() != ptsB->GetNumberOfPoints())
+    {
+    cerr << "Expected " << ptsA->GetNumberOfPoints() << " box corners, got "
+         << ptsB->GetNumberOfPoints() << endl;
+    return false;
+    }
+  for (vtkIdType i = 0; i < ptsA->GetNumberOfPoints(); i++)
+    {
+    double xA[3], xB[3];
+    ptsA->GetPoint(i, xA);
+    ptsB->GetPoint(i, xB);
+    if (xA[0] != xB[0] || xA[1] != xB[1] || xA[2] != xB[2])
+      {
+      cerr << "Different box corner " << i << endl;
+      return false;
+      }
+    }
+  return true;
+}
+
+bool TestFindCells(vtkDataSet *ds, vtkCellTreeLocator *locator)
+{
+  vtkNew<vtkPoints> points;
+  for (int i = 0; i < 5000; i++)
+    {
+    points->InsertNextPoint(vtkMath::Random(-1.1, 1.1),
+                            vtkMath::Random(-1.1, 1.1),
+                            vtkMath::Random(-1.1, 1.1));
+    }
+
+  vtkNew<vtkIdList> cellIds;
+  locator->FindCells(points.GetPointer(), cellIds.GetPointer());
+  if (cellIds->GetNumberOfIds() != points->GetNumberOfPoints())
+    {
+    cerr << "Wrong number of cell ids" << endl;
+    return false;
+    }
+
+  vtkNew<vtkGenericCell> cell;
+  std::vector<double> weights(ds->GetMaxCellSize());
+  vtkIdType numFound = 0;
+  for (vtkIdType i = 0; i < points->GetNumberOfPoints(); i++)
+    {
+    double x[3], pcoords[3];
+    points->GetPoint(i, x);
+    vtkIdType cellId = locator->FindCell(x, 0.0, cell.GetPointer(), pcoords,
+                                         &weights[0]);
+    if (cellId != cellIds->GetId(i))
+      {
+      cerr << "Point " << i << ": expected cell " << cellId << ", got "
+           << cellIds->GetId(i) << endl;
+      return false;
+      }
+    numFound += (cellId >= 0);
+    }
+  if (numFound == 0 || numFound == points->GetNumberOfPoints())
+    {
+    cerr << "Expected points inside and outside of the grid" << endl;
+    return false;
+    }
+  return true;
+}
+
+bool TestIntersectWithLines(vtkCellTreeLocator *locator)
+{
+  // Rays from outside of the sphere towards its center, some of them too
+  // short to reach it.
+  vtkNew<vtkPoints> p1;
+  vtkNew<vtkPoints> p2;
+  for (int i = 0; i < 5000; i++)
+    {
+    double dir[3] = { vtkMath::Random(-1.0, 1.0), vtkMath::Random(-1.0, 1.0),
+                      vtkMath::Random(-1.0, 1.0) };
+    vtkMath::Normalize(dir);
+    double length = vtkMath::Random(0.0, 1.0);
+    p1->InsertNextPoint(1.2 * dir[0], 1.2 * dir[1], 1.2 * dir[2]);
+    p2->InsertNextPoint((1.2 - length) * dir[0], (1.2 - length) * dir[1],
+                        (1.2 - length) * dir[2]);
+    }
+
+  vtkNew<vtkIdList> cellIds;
+  vtkNew<vtkPoints> hits;
+  hits->SetDataTypeToDouble();
+  vtkNew<vtkDoubleArray> ts;
+  locator->IntersectWithLines(p1.GetPointer(), p2.GetPointer(), 0.001,
+                              cellIds.GetPointer(), hits.GetPointer(),
+                              ts.GetPointer());
+  if (cellIds->GetNumberOfIds() != p1->GetNumberOfPoints() ||
+      hits->GetNumberOfPoints() != p1->GetNumberOfPoints() ||
+      ts->GetNumberOfTuples() != p1->GetNumberOfPoints())
+    {
+    cerr << "Wrong number of intersections" << endl;
+    return false;
+    }
+
+  vtkNew<vtkGenericCell> cell;
+  vtkIdType numHits = 0;
+  for (vtkIdType i = 0; i < p1->GetNumberOfPoints(); i++)
+    {
+    double a[3], b[3], x[3], pcoords[3], t;
+    int subId;
+    vtkIdType cellId;
+    p1->GetPoint(i, a);
+    p2->GetPoint(i, b);
+    if (!locator->IntersectWithLine(a, b, 0.001, t, x, pcoords, subId, cellId,
+                                    cell.GetPointer()))
+      {
+      cellId = -1;
+      t = 1.0;
+      x[0] = b[0];
+      x[1] = b[1];
+      x[2] = b[2];
+      }
+    double hit[3];
+    hits->GetPoint(i, hit);
+    if (cellId != cellIds->GetId(i) || t != ts->GetValue(i) ||
+        x[0] != hit[0] || x[1] != hit[1] || x[2] != hit[2])
+      {
+      cerr << "Line " << i << ": expected cell " << cellId << " at " << t
+           << ", got " << cellIds->GetId(i) << " at " << ts->GetValue(i)
+           << endl;
+      return false;
+      }
+    numHits += (cellId >= 0);
+    }
+  if (numHits == 0 || numHits == p1->GetNumberOfPoints())
+    {
+    cerr << "Expected lines hitting and missing the sphere" << endl;
+    return false;
+    }
+  return true;
+}
+
+}
+
+int TestCellTreeLocatorParallel(int, char *[])
+{
+  vtkSmartPointer<vtkUnstructuredGrid> grid = MakeGrid();
+
+  vtkNew<vtkSphereSource> sphere;
+  sphere->SetThetaResolution(150);
+  sphere->SetPhiResolution(150);
+  sphere->Update();
+  vtkPolyData *sphereData = sphere->GetOutput();
+
+  for (int cache = 0; cache < 2; cache++)
+    {
+    vtkSmartPointer<vtkCellTreeLocator> serialGrid =
+      NewLocator(grid, 1, cache != 0);
+    vtkSmartPointer<vtkCellTreeLocator> parallelGrid =
+      NewLocator(grid, 4, cache != 0);
+    if (!CompareTrees(serialGrid, parallelGrid) ||
+        !TestFindCells(grid, parallelGrid))
+      {
+      cerr << "Failed for the grid with cached cell bounds " << cache << endl;
+      return EXIT_FAILURE;
+      }
+
+    vtkSmartPointer<vtkCellTreeLocator> serialSphere =
+      NewLocator(sphereData, 1, cache != 0);
+    vtkSmartPointer<vtkCellTreeLocator> parallelSphere =
+      NewLocator(sphereData, 4, cache != 0);
+    if (!CompareTrees(serialSphere, parallelSphere) ||
+        !TestIntersectWithLines(parallelSphere))
+      {
+      cerr << "Failed for the sphere with cached cell bounds " << cache
+           << endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  // The cell/ray test of a subclass is used by all the line queries.
+  vtkSMPTools::Initialize(4);
+  vtkNew<vtkCountingCellTreeLocator> counting;
+  counting->SetDataSet(sphereData);
+  counting->BuildLocator();
+  if (!TestIntersectWithLines(counting.GetPointer()) ||
+      counting->NumberOfTests == 0)
+    {
+    cerr << "Failed for the subclass, which tested "
+         << counting->NumberOfTests << " cells" << endl;
+    return EXIT_FAILURE;
+    }
+  vtkIdType numTests = counting->NumberOfTests;
+  double a[3] = { 0.0, 0.0, 2.0 };
+  double b[3] = { 0.0, 0.0, 0.0 };
+  double x[3], pcoords[3], t;
+  int subId;
+  vtkIdType cellId;
+  if (!counting->IntersectWithLine(a, b, 0.001, t, x, pcoords, subId, cellId) ||
+      counting->NumberOfTests == numTests)
+    {
+    cerr << "The subclass did not test the cells of a single line" << endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
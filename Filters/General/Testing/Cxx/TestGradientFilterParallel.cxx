@@ -0,0 +1,327 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    TestGradientFilterParallel.cxx
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+// Compares vtkGradientFilter run on one and on several threads on an
+// unstructured grid and on polydata, for point and cell arrays. The
+// gradients of a linear field on the unstructured grid are also checked
+// against their exact value, along with the vorticity, Q-criterion and
+// divergence.
+
+#include "vtkCellData.h"
+#include "vtkDataArray.h"
+#include "vtkDoubleArray.h"
+#include "vtkFloatArray.h"
+#include "vtkGradientFilter.h"
+#include "vtkMath.h"
+#include "vtkNew.h"
+#include "vtkPointData.h"
+#include "vtkPoints.h"
+#include "vtkPolyData.h"
+#include "vtkSMPTools.h"
+#include "vtkSmartPointer.h"
+#include "vtkSphereSource.h"
+#include "vtkUnstructuredGrid.h"
+
+#include <cmath>
+
+namespace
+{
+
+const int Resolution = 12;
+
+// The gradient of the linear field, as stored by the filter.
+const double Gradient[9] = { 1.0, 2.0, -1.0,
+                             0.5, -3.0, 2.0,
+                             4.0, 1.0, 0.25 };
+
+vtkIdType PointId(int i, int j, int k)
+{
+  return i + (Resolution + 1) * (j + (Resolution + 1) * k);
+}
+
+void LinearField(const double x[3], double v[3])
+{
+  for (int c = 0; c < 3; c++)
+    {
+    v[c] = Gradient[3 * c] * x[0] + Gradient[3 * c + 1] * x[1] +
+      Gradient[3 * c + 2] * x[2];
+    }
+}
+
+// A grid of hexahedra and tetrahedra on [-1,1]^3 with jittered points,
+// with the linear field at its points and a random field at its cells.
+vtkSmartPointer<vtkUnstructuredGrid> MakeGrid()
+{
+  vtkNew<vtkPoints> points;
+  points->SetDataTypeToDouble();
+  vtkNew<vtkDoubleArray> velocity;
+  velocity->SetName("Velocity");
+  velocity->SetNumberOfComponents(3);
+  for (int k = 0; k <= Resolution; k++)
+    {
+    for (int j = 0; j <= Resolution; j++)
+      {
+      for (int i = 0; i <= Resolution; i++)
+        {
+        double h = 0.3 / Resolution;
+        double x[3] = {
+          2.0 * i / Resolution - 1.0 + vtkMath::Random(-h, h),
+          2.0 * j / Resolution - 1.0 + vtkMath::Random(-h, h),
+          2.0 * k / Resolution - 1.0 + vtkMath::Random(-h, h) };
+        double v[3];
+        LinearField(x, v);
+        points->InsertNextPoint(x);
+        velocity->InsertNextTuple(v);
+        }
+      }
+    }
+
+  vtkSmartPointer<vtkUnstructuredGrid> grid =
+    vtkSmartPointer<vtkUnstructuredGrid>::New();
+  grid->SetPoints(points.GetPointer());
+  grid->GetPointData()->AddArray(velocity.GetPointer());
+  grid->Allocate(Resolution * Resolution * Resolution);
+  for (int k = 0; k < Resolution; k++)
+    {
+    for (int j = 0; j < Resolution; j++)
+      {
+      for (int i = 0; i < Resolution; i++)
+        {
+        vtkIdType hex[8] = {
+          PointId(i, j, k), PointId(i + 1, j, k),
+          PointId(i + 1, j + 1, k), PointId(i, j + 1, k),
+          PointId(i, j, k + 1), PointId(i + 1, j, k + 1),
+          PointId(i + 1, j + 1, k + 1), PointId(i, j + 1, k + 1) };
+        if ((i + j + k) % 3 == 0)
+          {
+          vtkIdType tets[5][4] = {
+            { hex[0], hex[1], hex[3], hex[4] },
+            { hex[1], hex[2], hex[3], hex[6] },
+            { hex[1], hex[4], hex[5], hex[6] },
+            { hex[3], hex[4], hex[6], hex[7] },
+            { hex[1], hex[3], hex[4], hex[6] } };
+          for (int t = 0; t < 5; t++)
+            {
+            grid->InsertNextCell(VTK_TETRA, 4, tets[t]);
+            }
+          }
+        else
+          {
+          grid->InsertNextCell(VTK_HEXAHEDRON, 8, hex);
+          }
+        }
+      }
+    }
+
+  vtkNew<vtkFloatArray> cellVelocity;
+  cellVelocity->SetName("Velocity");
+  cellVelocity->SetNumberOfComponents(3);
+  cellVelocity->SetNumberOfTuples(grid->GetNumberOfCells());
+  for (vtkIdType i = 0; i < grid->GetNumberOfCells(); i++)
+    {
+    cellVelocity->SetTuple3(i, vtkMath::Random(-1.0, 1.0),
+                            vtkMath::Random(-1.0, 1.0),
+                            vtkMath::Random(-1.0, 1.0));
+    }
+  grid->GetCellData()->AddArray(cellVelocity.GetPointer());
+  return grid;
+}
+
+// A sphere with random fields at its points and cells.
+vtkSmartPointer<vtkPolyData> MakePolyData()
+{
+  vtkNew<vtkSphereSource> sphere;
+  sphere->SetThetaResolution(60);
+  sphere->SetPhiResolution(40);
+  sphere->Update();
+  vtkSmartPointer<vtkPolyData> pd = vtkSmartPointer<vtkPolyData>::New();
+  pd->DeepCopy(sphere->GetOutput());
+
+  vtkDataSetAttributes *attributes[2] = { pd->GetPointData(),
+                                          pd->GetCellData() };
+  vtkIdType sizes[2] = { pd->GetNumberOfPoints(), pd->GetNumberOfCells() };
+  for (int a = 0; a < 2; a++)
+    {
+    vtkNew<vtkFloatArray> velocity;
+    velocity->SetName("Velocity");
+    velocity->SetNumberOfComponents(3);
+    velocity->SetNumberOfTuples(sizes[a]);
+    for (vtkIdType i = 0; i < sizes[a]; i++)
+      {
+      velocity->SetTuple3(i, vtkMath::Random(-1.0, 1.0),
+                          vtkMath::Random(-1.0, 1.0),
+                          vtkMath::Random(-1.0, 1.0));
+      }
+    attributes[a]->AddArray(velocity.GetPointer());
+    }
+  return pd;
+}
+
+bool CompareArrays(vtkDataArray *a, vtkDataArray *b)
+{
+  if (!a || !b || a->GetNumberOfTuples() != b->GetNumberOfTuples() ||
+      a->GetNumberOfComponents() != b->GetNumberOfComponents() ||
+      a->GetDataType() != b->GetDataType())
+    {
+    return false;
+    }
+  for (vtkIdType i = 0; i < a->GetNumberOfTuples(); i++)
+    {
+    for (int c = 0; c < a->GetNumberOfComponents(); c++)
+      {
+      if (a->GetComponent(i, c) != b->GetComponent(i, c))
+        {
+        return false;
+        }
+      }
+    }
+  return true;
+}
+
+const char *ArrayNames[4] = { "Gradients", "Vorticity", "Q-criterion",
+                              "Divergence" };
+
+vtkSmartPointer<vtkDataSet> RunGradient(vtkDataSet *input, int numThreads,
+                                        int association, bool faster)
+{
+  vtkSMPTools::Initialize(numThreads);
+  vtkNew<vtkGradientFilter> gradient;
+  gradient->SetInputData(input);
+  gradient->SetInputScalars(association, "Velocity");
+  gradient->SetFasterApproximation(faster);
+  gradient->ComputeVorticityOn();
+  gradient->ComputeQCriterionOn();
+  gradient->ComputeDivergenceOn();
+  gradient->Update();
+
+  vtkSmartPointer<vtkDataSet> output;
+  output.TakeReference(input->NewInstance());
+  output->DeepCopy(gradient->GetOutput());
+  return output;
+}
+
+vtkDataSetAttributes *GetAttributes(vtkDataSet *ds, int association)
+{
+  if (association == vtkDataObject::FIELD_ASSOCIATION_POINTS)
+    {
+    return ds->GetPointData();
+    }
+  return ds->GetCellData();
+}
+
+bool TestDataSet(vtkDataSet *input, const char *name)
+{
+  for (int test = 0; test < 3; test++)
+    {
+    int association = test < 2 ? vtkDataObject::FIELD_ASSOCIATION_POINTS :
+      vtkDataObject::FIELD_ASSOCIATION_CELLS;
+    bool faster = test == 1;
+    vtkSmartPointer<vtkDataSet> serial =
+      RunGradient(input, 1, association, faster);
+    vtkSmartPointer<vtkDataSet> parallel =
+      RunGradient(input, 4, association, faster);
+    for (int a = 0; a < 4; a++)
+      {
+      vtkDataArray *x = GetAttributes(serial, association)->GetArray(
+        ArrayNames[a]);
+      vtkDataArray *y = GetAttributes(parallel, association)->GetArray(
+        ArrayNames[a]);
+      if (!CompareArrays(x, y))
+        {
+        cerr << "Different " << ArrayNames[a] << " for " << name
+             << " in test " << test << endl;
+        return false;
+        }
+      }
+    }
+  return true;
+}
+
+// The point gradients of the linear field are exact.
+bool TestLinearField(vtkUnstructuredGrid *grid)
+{
+  double vorticity[3] = { Gradient[7] - Gradient[5], Gradient[2] - Gradient[6],
+                          Gradient[3] - Gradient[1] };
+  double divergence = Gradient[0] + Gradient[4] + Gradient[8];
+  double qCriterion = 0.0;
+  for (int i = 0; i < 3; i++)
+    {
+    for (int j = 0; j < 3; j++)
+      {
+      // The rotation rate squared minus the strain rate squared.
+      double s = 0.5 * (Gradient[3 * i + j] + Gradient[3 * j + i]);
+      double w = 0.5 * (Gradient[3 * i + j] - Gradient[3 * j + i]);
+      qCriterion += 0.5 * (w * w - s * s);
+      }
+    }
+
+  for (int faster = 0; faster < 2; faster++)
+    {
+    vtkSmartPointer<vtkDataSet> output = RunGradient(
+      grid, 4, vtkDataObject::FIELD_ASSOCIATION_POINTS, faster != 0);
+    vtkDataArray *gradients = output->GetPointData()->GetArray("Gradients");
+    vtkDataArray *vort = output->GetPointData()->GetArray("Vorticity");
+    vtkDataArray *div = output->GetPointData()->GetArray("Divergence");
+    vtkDataArray *q = output->GetPointData()->GetArray("Q-criterion");
+    if (!gradients || !vort || !div || !q)
+      {
+      cerr << "Missing output arrays" << endl;
+      return false;
+      }
+    for (vtkIdType i = 0; i < output->GetNumberOfPoints(); i++)
+      {
+      for (int c = 0; c < 9; c++)
+        {
+        if (std::fabs(gradients->GetComponent(i, c) - Gradient[c]) > 1e-8)
+          {
+          cerr << "Wrong gradient " << gradients->GetComponent(i, c)
+               << " at point " << i << ", expected " << Gradient[c] << endl;
+          return false;
+          }
+        }
+      for (int c = 0; c < 3; c++)
+        {
+        if (std::fabs(vort->GetComponent(i, c) - vorticity[c]) > 1e-8)
+          {
+          cerr << "Wrong vorticity at point " << i << endl;
+          return false;
+          }
+        }
+      if (std::fabs(div->GetComponent(i, 0) - divergence) > 1e-8 ||
+          std::fabs(q->GetComponent(i, 0) - qCriterion) > 1e-8)
+        {
+        cerr << "Wrong divergence or Q-criterion at point " << i << endl;
+        return false;
+        }
+      }
+    }
+  return true;
+}
+
+}
+
+int TestGradientFilterParallel(int, char *[])
+{
+  vtkMath::RandomSeed(1357);
+
+  vtkSmartPointer<vtkUnstructuredGrid> grid = MakeGrid();
+  if (!TestLinearField(grid) ||
+      !TestDataSet(grid, "unstructured grid") ||
+      !TestDataSet(MakePolyData(), "polydata"))
+    {
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -15,6 +15,7 @@
 
 #include "vtkCellTreeLocator.h"
 #include <cstdlib>
+#include <cstring>
 #include <cassert>
 #include <cmath>
 #include <stack>
@@ -29,6 +30,14 @@
 #include "vtkPolyData.h"
 #include "vtkBoundingBox.h"
 #include "vtkPointData.h"
+#include "vtkPoints.h"
+#include "vtkDoubleArray.h"
+#include "vtkIdList.h"
+#include "vtkImageData.h"
+#include "vtkRectilinearGrid.h"
+#include "vtkUnstructuredGrid.h"
+#include "vtkSMPThreadLocal.h"
+#include "vtkSMPTools.h"
 
 vtkStandardNewMacro(vtkCellTreeLocator);
 
@@ -37,6 +46,33 @@ namespace
   const double EPSILON_= 1E-8;
   enum { POS_X, NEG_X, POS_Y, NEG_Y, POS_Z, NEG_Z };
   #define CELLTREE_MAX_DEPTH 32
+
+  // Nodes with at least this many cells have their buckets filled and their
+  // bounds computed in parallel.
+  const unsigned int PARALLEL_SPLIT_SIZE = 16384;
+  // The subtrees of the nodes with less cells than this are built
+  // concurrently.
+  const unsigned int SUBTREE_SIZE = 4096;
+
+  // Data sets whose cells and cell bounds can be fetched from several
+  // threads once their cells are built.
+  bool IsThreadSafeDataSet(vtkDataSet *ds)
+  {
+    return vtkUnstructuredGrid::SafeDownCast(ds) ||
+      vtkPolyData::SafeDownCast(ds) || vtkImageData::SafeDownCast(ds) ||
+      vtkRectilinearGrid::SafeDownCast(ds);
+  }
+
+  // Build the cells of the data set, which vtkPolyData does lazily on the
+  // first query.
+  void BuildDataSetCells(vtkDataSet *ds)
+  {
+    if (ds->GetNumberOfCells() > 0)
+      {
+      double bounds[6];
+      ds->GetCellBounds(0, bounds);
+      }
+  }
 }
 
 // -------------------------------------------------------------------------
@@ -217,6 +253,52 @@ class vtkCellTreeBuilder
           Max = _max;
           }
         }
+
+      void Merge( const Bucket& other )
+        {
+        Cnt += other.Cnt;
+
+        if( other.Min < Min )
+          {
+          Min = other.Min;
+          }
+
+        if( other.Max > Max )
+          {
+          Max = other.Max;
+          }
+        }
+      };
+
+    enum { NBUCKETS = 6 };
+
+    struct BucketSet
+      {
+      Bucket B[3][NBUCKETS];
+      };
+
+    struct MinMax
+      {
+      float  Min[3];
+      float  Max[3];
+
+      MinMax()
+        {
+        for( unsigned int d=0; d<3; ++d )
+          {
+          Min[d] =  std::numeric_limits<float>::max();
+          Max[d] = -std::numeric_limits<float>::max();
+          }
+        }
+
+      void Add( const float* _min, const float* _max )
+        {
+        for( unsigned int d=0; d<3; ++d )
+          {
+          if( _min[d] < Min[d] )    Min[d] = _min[d];
+          if( _max[d] > Max[d] )    Max[d] = _max[d];
+          }
+        }
       };
 
     struct PerCell
@@ -250,6 +332,131 @@ class vtkCellTreeBuilder
       };
 
 
+    typedef std::vector<vtkCellTreeLocator::vtkCellTreeNode> NodeVector;
+
+    // A node whose subtree is split apart from the rest of the tree, see
+    // Build().
+    struct Subtree
+      {
+      unsigned int Index;
+      float  Min[3];
+      float  Max[3];
+      NodeVector Nodes;
+      };
+
+    // -------------------------------------------------------------------------
+
+    static void BinCells( const PerCell* begin, const PerCell* end,
+      const float* min, const float* iext, Bucket b[3][NBUCKETS] )
+      {
+      for( const PerCell* pc=begin; pc!=end; ++pc )
+        {
+        for( unsigned int d=0; d<3; ++d )
+          {
+          float cen = (pc->Min[d] + pc->Max[d])/2.0f;
+          int   ind = (int)( (cen-min[d])*iext[d] );
+
+          if( ind<0 )
+            {
+            ind = 0;
+            }
+
+          if( ind>=NBUCKETS )
+            {
+            ind = NBUCKETS-1;
+            }
+
+          b[d][ind].Add( pc->Min[d], pc->Max[d] );
+          }
+        }
+      }
+
+    // Fill the buckets of a range of the cells of a node.
+    struct BinCellsFunctor
+      {
+      const PerCell* Cells;
+      const float*   Min;
+      const float*   IExt;
+      vtkSMPThreadLocal<BucketSet> Buckets;
+
+      void operator()( vtkIdType begin, vtkIdType end )
+        {
+        BinCells( this->Cells+begin, this->Cells+end, this->Min, this->IExt,
+          this->Buckets.Local().B );
+        }
+      };
+
+    // Compute the bounds of a range of the cells of a node.
+    struct MinMaxFunctor
+      {
+      const PerCell* Cells;
+      vtkSMPThreadLocal<MinMax> Bounds;
+
+      void operator()( vtkIdType begin, vtkIdType end )
+        {
+        MinMax& mm = this->Bounds.Local();
+        for( const PerCell* pc=this->Cells+begin; pc!=this->Cells+end; ++pc )
+          {
+          mm.Add( pc->Min, pc->Max );
+          }
+        }
+      };
+
+    // Gather the bounds of the cells of the data set and of the data set.
+    struct InitCellsFunctor
+      {
+      vtkDataSet* DataSet;
+      double (*CellBounds)[6];
+      PerCell* Cells;
+      vtkSMPThreadLocal<MinMax> Bounds;
+
+      void operator()( vtkIdType begin, vtkIdType end )
+        {
+        MinMax& mm = this->Bounds.Local();
+        double cellBounds[6];
+        for( vtkIdType i=begin; i<end; ++i )
+          {
+          PerCell& pc = this->Cells[i];
+          pc.Ind = i;
+
+          double *boundsPtr = cellBounds;
+          if (this->CellBounds)
+            {
+            boundsPtr = this->CellBounds[i];
+            }
+          else
+            {
+            this->DataSet->GetCellBounds(i, boundsPtr);
+            }
+
+          for( int d=0; d<3; ++d )
+            {
+            pc.Min[d] = boundsPtr[2*d+0];
+            pc.Max[d] = boundsPtr[2*d+1];
+            }
+          mm.Add( pc.Min, pc.Max );
+          }
+        }
+      };
+
+    // Split the subtrees deferred by the top levels of the build, each into
+    // its own vector of nodes.
+    struct SubtreeFunctor
+      {
+      vtkCellTreeBuilder* Builder;
+      std::vector<Subtree>* Subtrees;
+
+      void operator()( vtkIdType begin, vtkIdType end )
+        {
+        for( vtkIdType i=begin; i<end; ++i )
+          {
+          Subtree& st = (*this->Subtrees)[i];
+          st.Nodes.push_back( this->Builder->m_nodes[st.Index] );
+          this->Builder->Split( st.Nodes, 0, st.Min, st.Max, NULL );
+          }
+        }
+      };
+
     // -------------------------------------------------------------------------
 
     void FindMinMax( const PerCell* begin, const PerCell* end,
@@ -260,6 +467,26 @@ class vtkCellTreeBuilder
         return;
         }
 
+      if( end-begin >= static_cast<vtkIdType>(PARALLEL_SPLIT_SIZE) )
+        {
+        MinMaxFunctor functor;
+        functor.Cells = begin;
+        vtkSMPTools::For( 0, end-begin, functor );
+
+        MinMax mm;
+        vtkSMPThreadLocal<MinMax>::iterator iter;
+        for( iter=functor.Bounds.begin(); iter!=functor.Bounds.end(); ++iter )
+          {
+          mm.Add( iter->Min, iter->Max );
+          }
+        for( unsigned int d=0; d<3; ++d )
+          {
+          min[d] = mm.Min[d];
+          max[d] = mm.Max[d];
+          }
+        return;
+        }
+
       for( unsigned int d=0; d<3; ++d )
         {
         min[d] = begin->Min[d];
@@ -279,47 +506,68 @@ class vtkCellTreeBuilder
 
     // -------------------------------------------------------------------------
 
-    void Split( unsigned int index, float min[3], float max[3] )
+    // Split the node at index in nodes, then its children recursively. When
+    // subtrees is given, the nodes with less than SUBTREE_SIZE cells
+    // are appended to it instead of being split. Distinct subtrees hold
+    // distinct ranges of m_pc, so they can be split concurrently.
+    void Split( NodeVector& nodes, unsigned int index, float min[3], float max[3],
+      std::vector<Subtree>* subtrees )
       {
-      unsigned int start = this->m_nodes[index].Start();
-      unsigned int size  = this->m_nodes[index].Size();
+      unsigned int start = nodes[index].Start();
+      unsigned int size  = nodes[index].Size();
 
       if( size < this->m_leafsize )
         {
         return;
         }
 
+      if( subtrees && size < SUBTREE_SIZE )
+        {
+        Subtree st;
+        st.Index = index;
+        std::copy( min, min+3, st.Min );
+        std::copy( max, max+3, st.Max );
+        subtrees->push_back( st );
+        return;
+        }
+
       PerCell* begin = &(this->m_pc[start]);
       PerCell* end   = &(this->m_pc[0])+start + size;
       PerCell* mid = begin;
 
-      const int nbuckets = 6;
+      const int nbuckets = NBUCKETS;
 
       const float ext[3] = { max[0]-min[0], max[1]-min[1], max[2]-min[2] };
       const float iext[3] = { nbuckets/ext[0], nbuckets/ext[1], nbuckets/ext[2] };
 
       Bucket b[3][nbuckets];
 
-      for( const PerCell* pc=begin; pc!=end; ++pc )
+      if( size >= PARALLEL_SPLIT_SIZE )
         {
-        for( unsigned int d=0; d<3; ++d )
+        // min, max and counts do not depend on the order the cells are
+        // added in, so the buckets are the same as when filled serially.
+        BinCellsFunctor functor;
+        functor.Cells = begin;
+        functor.Min = min;
+        functor.IExt = iext;
+        vtkSMPTools::For( 0, size, functor );
+
+        vtkSMPThreadLocal<BucketSet>::iterator iter;
+        for( iter=functor.Buckets.begin(); iter!=functor.Buckets.end(); ++iter )
           {
-          float cen = (pc->Min[d] + pc->Max[d])/2.0f;
-          int   ind = (int)( (cen-min[d])*iext[d] );
-
-          if( ind<0 )
+          for( unsigned int d=0; d<3; ++d )
             {
-            ind = 0;
-            }
-
-          if( ind>=nbuckets )
-            {
-            ind = nbuckets-1;
+            for( int n=0; n<nbuckets; ++n )
+              {
+              b[d][n].Merge( iter->B[d][n] );
+              }
             }
-
-          b[d][ind].Add( pc->Min[d], pc->Max[d] );
           }
         }
+      else
+        {
+        BinCells( begin, end, min, iext, b );
+        }
 
       float cost = std::numeric_limits<float>::max();
       float plane = VTK_FLOAT_MIN; // bad value in case it doesn't get setx
@@ -399,11 +647,11 @@ class vtkCellTreeBuilder
       child[0].MakeLeaf( begin - &(this->m_pc[0]), mid-begin );
       child[1].MakeLeaf( mid   - &(this->m_pc[0]), end-mid );
 
-      this->m_nodes[index].MakeNode( (int)m_nodes.size(), dim, clip );
-      this->m_nodes.insert( m_nodes.end(), child, child+2 );
+      nodes[index].MakeNode( (int)nodes.size(), dim, clip );
+      nodes.insert( nodes.end(), child, child+2 );
 
-      Split( this->m_nodes[index].GetLeftChildIndex(), lmin, lmax );
-      Split( this->m_nodes[index].GetRightChildIndex(), rmin, rmax );
+      Split( nodes, nodes[index].GetLeftChildIndex(), lmin, lmax, subtrees );
+      Split( nodes, nodes[index].GetRightChildIndex(), rmin, rmax, subtrees );
       }
 
   public:
@@ -421,53 +669,32 @@ class vtkCellTreeBuilder
         {
         vtkGenericWarningMacro("Too many cells.");
         }
-      double cellBounds[6];
       this->m_pc.resize(size);
 
-      float min[3] =
+      // The bounds of the cells are gathered in parallel when they are
+      // cached or when the data set can compute them concurrently.
+      InitCellsFunctor initCells;
+      initCells.DataSet = ds;
+      initCells.CellBounds = ctl->CellBounds;
+      initCells.Cells = size > 0 ? &this->m_pc[0] : NULL;
+      if( ctl->CellBounds || IsThreadSafeDataSet(ds) )
         {
-        std::numeric_limits<float>::max(),
-        std::numeric_limits<float>::max(),
-        std::numeric_limits<float>::max()
-        };
-
-      float max[3] =
+        BuildDataSetCells(ds);
+        vtkSMPTools::For( 0, size, initCells );
+        }
+      else
         {
-        -std::numeric_limits<float>::max(),
-        -std::numeric_limits<float>::max(),
-        -std::numeric_limits<float>::max(),
-        };
+        initCells( 0, size );
+        }
 
-      for( vtkIdType i=0; i<size; ++i )
+      MinMax bounds;
+      vtkSMPThreadLocal<MinMax>::iterator iter;
+      for( iter=initCells.Bounds.begin(); iter!=initCells.Bounds.end(); ++iter )
         {
-        this->m_pc[i].Ind = i;
-
-        double *boundsPtr = cellBounds;
-        if (ctl->CellBounds)
-          {
-          boundsPtr = ctl->CellBounds[i];
-          }
-        else
-          {
-          ds->GetCellBounds(i, boundsPtr);
-          }
-
-        for( int d=0; d<3; ++d )
-          {
-          this->m_pc[i].Min[d] = boundsPtr[2*d+0];
-          this->m_pc[i].Max[d] = boundsPtr[2*d+1];
-
-          if( this->m_pc[i].Min[d] < min[d] )
-            {
-            min[d] = this->m_pc[i].Min[d];
-            }
-
-          if( this->m_pc[i].Max[d] > max[d] )  /// This can be m_pc[i].max[d] instead of min
-            {
-            max[d] = this->m_pc[i].Max[d];
-            }
-          }
+        bounds.Add( iter->Min, iter->Max );
         }
+      float* min = bounds.Min;
+      float* max = bounds.Max;
 
       ct.DataBBox[0] = min[0];
       ct.DataBBox[1] = max[0];
@@ -480,7 +707,35 @@ class vtkCellTreeBuilder
       root.MakeLeaf( 0, size );
       this->m_nodes.push_back( root );
 
-      Split( 0, min, max );
+      // Split the top of the tree, with the buckets of its largest nodes
+      // filled in parallel, then the subtrees below it concurrently. Each
+      // subtree is split exactly as it would be serially, and the nodes are
+      // reordered breadth first below, so the tree does not depend on the
+      // number of threads.
+      std::vector<Subtree> subtrees;
+      Split( this->m_nodes, 0, min, max, &subtrees );
+
+      SubtreeFunctor splitSubtrees;
+      splitSubtrees.Builder = this;
+      splitSubtrees.Subtrees = &subtrees;
+      vtkSMPTools::For( 0, static_cast<vtkIdType>(subtrees.size()), 1, splitSubtrees );
+
+      // Graft the subtrees: the root of each replaces the node it was split
+      // from and its other nodes are appended to m_nodes.
+      for( size_t s=0; s<subtrees.size(); ++s )
+        {
+        NodeVector& stNodes = subtrees[s].Nodes;
+        const unsigned int offset = static_cast<unsigned int>(this->m_nodes.size()) - 1;
+        for( size_t n=0; n<stNodes.size(); ++n )
+          {
+          if( stNodes[n].IsNode() )
+            {
+            stNodes[n].SetChildren( stNodes[n].GetLeftChildIndex() + offset );
+            }
+          }
+        this->m_nodes[subtrees[s].Index] = stNodes[0];
+        this->m_nodes.insert( this->m_nodes.end(), stNodes.begin()+1, stNodes.end() );
+        }
 
       ct.Nodes.resize( this->m_nodes.size() );
       ct.Nodes[0] = this->m_nodes[0];
@@ -608,6 +863,46 @@ void vtkCellTreeLocator::BuildLocator()
   this->ForceBuildLocator();
 }
 
+//----------------------------------------------------------------------------
+namespace
+{
+  class CellBoundsFunctor
+  {
+  public:
+    vtkDataSet *DataSet;
+    double (*CellBounds)[6];
+
+    void operator()(vtkIdType begin, vtkIdType end)
+    {
+      for (vtkIdType cellId = begin; cellId < end; ++cellId)
+        {
+        this->DataSet->GetCellBounds(cellId, this->CellBounds[cellId]);
+        }
+    }
+  };
+}
+
+//----------------------------------------------------------------------------
+bool vtkCellTreeLocator::StoreCellBounds()
+{
+  if (this->CellBounds || !this->DataSet)
+    {
+    return false;
+    }
+  if (!IsThreadSafeDataSet(this->DataSet))
+    {
+    return this->Superclass::StoreCellBounds();
+    }
+  vtkIdType numCells = this->DataSet->GetNumberOfCells();
+  this->CellBounds = new double [numCells][6];
+  BuildDataSetCells(this->DataSet);
+  CellBoundsFunctor functor;
+  functor.DataSet = this->DataSet;
+  functor.CellBounds = this->CellBounds;
+  vtkSMPTools::For(0, numCells, functor);
+  return true;
+}
+
 //----------------------------------------------------------------------------
 vtkIdType vtkCellTreeLocator::FindCell( double pos[3], double , vtkGenericCell *cell, double pcoords[3],
                                         double* weights )
@@ -686,7 +981,9 @@ int vtkCellTreeLocator::IntersectWithLine(double p1[3],
                                           vtkIdType &cellId,
                                           vtkGenericCell *cell)
 {
-  int hit = this->IntersectWithLine(p1, p2, tol, t, x, pcoords, subId, cellId);
+  this->BuildLocatorIfNeeded();
+  int hit = this->IntersectWithLineInternal(p1, p2, tol, t, x, pcoords, subId,
+                                            cellId, cell);
   if (hit)
     {
     this->DataSet->GetCell(cellId, cell);
@@ -697,6 +994,15 @@ int vtkCellTreeLocator::IntersectWithLine(double p1[3],
 int vtkCellTreeLocator::IntersectWithLine(double p1[3], double p2[3], double tol,
   double& t, double x[3], double pcoords[3],
   int &subId, vtkIdType &cellIds)
+{
+  this->BuildLocatorIfNeeded();
+  return this->IntersectWithLineInternal(p1, p2, tol, t, x, pcoords, subId,
+                                         cellIds, this->GenericCell);
+}
+
+int vtkCellTreeLocator::IntersectWithLineInternal(const double p1[3],
+  const double p2[3], double tol, double& t, double x[3], double pcoords[3],
+  int &subId, vtkIdType &cellIds, vtkGenericCell *cell)
 {
   //
   vtkCellTreeNode  *node, *near, *far;
@@ -705,7 +1011,11 @@ int vtkCellTreeLocator::IntersectWithLine(double p1[3], double p2[3], double tol
 
   double cellBounds[6];
 
-  this->BuildLocatorIfNeeded();
+  if (this->Tree == NULL)
+    {
+    return false;
+    }
+  bool useHook = this->UsesIntersectCellInternal();
 
   // Does ray pass through root BBox
   tmin = 0; tmax = 1;
@@ -809,7 +1119,10 @@ int vtkCellTreeLocator::IntersectWithLine(double p1[3], double p2[3], double tol
       ctmin = _tmin; ctmax = _tmax;
       if (this->RayMinMaxT(boundsPtr, p1, ray_vec, ctmin, ctmax))
         {
-        if (this->IntersectCellInternal(cell_ID, p1, p2, tol, t_hit, ipt, pcoords, subId))
+        int hit = useHook ?
+          this->IntersectCellInternal(cell_ID, p1, p2, tol, t_hit, ipt, pcoords, subId) :
+          this->IntersectCellWithLine(cell_ID, p1, p2, tol, t_hit, ipt, pcoords, subId, cell);
+        if (hit)
           {
           if (t_hit<closest_intersection)
             {
@@ -839,7 +1152,7 @@ int vtkCellTreeLocator::IntersectWithLine(double p1[3], double p2[3], double tol
 bool vtkCellTreeLocator::RayMinMaxT(const double origin[3],
   const double dir[3],
   double &rTmin,
-  double &rTmax)
+  double &rTmax) const
 {
   double tT;
   // X-Axis
@@ -999,7 +1312,7 @@ bool vtkCellTreeLocator::RayMinMaxT(const double bounds[6],
   const double origin[3],
   const double dir[3],
   double &rTmin,
-  double &rTmax)
+  double &rTmax) const
 {
   double tT;
   // X-Axis
@@ -1143,7 +1456,7 @@ bool vtkCellTreeLocator::RayMinMaxT(const double bounds[6],
   return (true);
 }
 //----------------------------------------------------------------------------
-int vtkCellTreeLocator::getDominantAxis(const double dir[3])
+int vtkCellTreeLocator::getDominantAxis(const double dir[3]) const
 {
   double tX = (dir[0]>0) ? dir[0] : -dir[0];
   double tY = (dir[1]>0) ? dir[1] : -dir[1];
@@ -1166,7 +1479,7 @@ void vtkCellTreeLocator::Classify(const double origin[3],
   const double dir[3],
   double &rDist,
   vtkCellTreeNode *&near, vtkCellTreeNode *&parent,
-  vtkCellTreeNode *&far, int& mustCheck)
+  vtkCellTreeNode *&far, int& mustCheck) const
 {
   double tOriginToDivPlane = parent->GetLeftMaxValue() - origin[parent->GetDimension()];
   double tOriginToDivPlane2 = parent->GetRightMinValue() - origin[parent->GetDimension()];
@@ -1226,8 +1539,28 @@ int vtkCellTreeLocator::IntersectCellInternal(
   double pcoords[3],
   int &subId)
 {
-  this->DataSet->GetCell(cell_ID, this->GenericCell);
-  return this->GenericCell->IntersectWithLine(const_cast<double*>(p1), const_cast<double*>(p2), tol, t, ipt, pcoords, subId);
+  return this->IntersectCellWithLine(cell_ID, p1, p2, tol, t, ipt, pcoords,
+                                     subId, this->GenericCell);
+}
+//----------------------------------------------------------------------------
+int vtkCellTreeLocator::IntersectCellWithLine(
+  vtkIdType cell_ID,
+  const double p1[3],
+  const double p2[3],
+  const double tol,
+  double &t,
+  double ipt[3],
+  double pcoords[3],
+  int &subId,
+  vtkGenericCell *cell) const
+{
+  this->DataSet->GetCell(cell_ID, cell);
+  return cell->IntersectWithLine(const_cast<double*>(p1), const_cast<double*>(p2), tol, t, ipt, pcoords, subId);
+}
+//----------------------------------------------------------------------------
+bool vtkCellTreeLocator::UsesIntersectCellInternal() const
+{
+  return strcmp(this->GetClassName(), "vtkCellTreeLocator") != 0;
 }
 //----------------------------------------------------------------------------
 void vtkCellTreeLocator::FreeSearchStructure(void)
@@ -1425,6 +1758,219 @@ void vtkCellTreeLocator::FindCellsWithinBounds(double *bbox, vtkIdList *cells)
       }
     }
 }
+//---------------------------------------------------------------------------
+namespace
+{
+  struct CellTreeLocalData
+  {
+    vtkGenericCell *Cell;
+    std::vector<double> Weights;
+
+    CellTreeLocalData() : Cell(NULL)
+    {
+    }
+  };
+
+  // Base of the functors answering batches of queries, each thread with its
+  // own cell and weights.
+  class CellTreeQueryFunctor
+  {
+  public:
+    vtkCellTreeLocator *Locator;
+    vtkIdList *CellIds;
+    int MaxCellSize;
+    vtkSMPThreadLocal<CellTreeLocalData> LocalData;
+
+    CellTreeQueryFunctor() : Locator(NULL), CellIds(NULL), MaxCellSize(1)
+    {
+    }
+
+    ~CellTreeQueryFunctor()
+    {
+      vtkSMPThreadLocal<CellTreeLocalData>::iterator iter;
+      for (iter = this->LocalData.begin(); iter != this->LocalData.end(); ++iter)
+        {
+        if (iter->Cell)
+          {
+          iter->Cell->Delete();
+          }
+        }
+    }
+
+    CellTreeLocalData &GetLocalData()
+    {
+      CellTreeLocalData &local = this->LocalData.Local();
+      if (!local.Cell)
+        {
+        local.Cell = vtkGenericCell::New();
+        local.Weights.resize(this->MaxCellSize);
+        }
+      return local;
+    }
+  };
+
+  class FindCellsFunctor : public CellTreeQueryFunctor
+  {
+  public:
+    vtkPoints *Points;
+
+    void operator()(vtkIdType begin, vtkIdType end)
+    {
+      CellTreeLocalData &local = this->GetLocalData();
+      double x[3], pcoords[3];
+      for (vtkIdType i = begin; i < end; ++i)
+        {
+        this->Points->GetPoint(i, x);
+        this->CellIds->SetId(i, this->Locator->FindCell(
+          x, 0.0, local.Cell, pcoords, &local.Weights[0]));
+        }
+    }
+  };
+
+  class IntersectWithLinesFunctor : public CellTreeQueryFunctor
+  {
+  public:
+    vtkPoints *P1;
+    vtkPoints *P2;
+    double Tolerance;
+    vtkPoints *X;
+    vtkDoubleArray *T;
+
+    void operator()(vtkIdType begin, vtkIdType end)
+    {
+      CellTreeLocalData &local = this->GetLocalData();
+      double p1[3], p2[3], x[3], pcoords[3], t;
+      int subId;
+      vtkIdType cellId;
+      for (vtkIdType i = begin; i < end; ++i)
+        {
+        this->P1->GetPoint(i, p1);
+        this->P2->GetPoint(i, p2);
+        if (!this->Locator->IntersectWithLine(p1, p2, this->Tolerance, t, x,
+                                              pcoords, subId, cellId, local.Cell))
+          {
+          this->SetMiss(i, p2);
+          }
+        else
+          {
+          this->SetHit(i, cellId, x, t);
+          }
+        }
+    }
+
+    void SetHit(vtkIdType i, vtkIdType cellId, const double x[3], double t)
+    {
+      this->CellIds->SetId(i, cellId);
+      if (this->X)
+        {
+        this->X->SetPoint(i, x);
+        }
+      if (this->T)
+        {
+        this->T->SetValue(i, t);
+        }
+    }
+
+    void SetMiss(vtkIdType i, const double p2[3])
+    {
+      this->SetHit(i, -1, p2, 1.0);
+    }
+  };
+
+  // The queries only run in parallel when they may and the cells of the data
+  // set can be fetched concurrently.
+  template <class Functor>
+  void RunQueries(vtkDataSet *ds, bool parallel, vtkIdType numQueries,
+                  Functor &functor)
+  {
+    if (parallel && IsThreadSafeDataSet(ds))
+      {
+      BuildDataSetCells(ds);
+      vtkSMPTools::For(0, numQueries, functor);
+      }
+    else
+      {
+      functor(0, numQueries);
+      }
+  }
+}
+
+//---------------------------------------------------------------------------
+void vtkCellTreeLocator::FindCells(vtkPoints *points, vtkIdList *cellIds)
+{
+  vtkIdType numPts = points->GetNumberOfPoints();
+  cellIds->SetNumberOfIds(numPts);
+  if (this->DataSet)
+    {
+    this->BuildLocatorIfNeeded();
+    }
+  if (!this->Tree)
+    {
+    for (vtkIdType i = 0; i < numPts; ++i)
+      {
+      cellIds->SetId(i, -1);
+      }
+    return;
+    }
+
+  FindCellsFunctor functor;
+  functor.Locator = this;
+  functor.CellIds = cellIds;
+  functor.MaxCellSize = std::max(this->DataSet->GetMaxCellSize(), 1);
+  functor.Points = points;
+  RunQueries(this->DataSet, true, numPts, functor);
+}
+
+//---------------------------------------------------------------------------
+void vtkCellTreeLocator::IntersectWithLines(vtkPoints *p1, vtkPoints *p2,
+                                            double tol, vtkIdList *cellIds,
+                                            vtkPoints *x, vtkDoubleArray *t)
+{
+  vtkIdType numLines = p1->GetNumberOfPoints();
+  if (p2->GetNumberOfPoints() != numLines)
+    {
+    vtkErrorMacro(<< "Different numbers of start and end points.");
+    return;
+    }
+  cellIds->SetNumberOfIds(numLines);
+  if (x)
+    {
+    x->SetNumberOfPoints(numLines);
+    }
+  if (t)
+    {
+    t->SetNumberOfComponents(1);
+    t->SetNumberOfTuples(numLines);
+    }
+  if (this->DataSet)
+    {
+    this->BuildLocatorIfNeeded();
+    }
+
+  IntersectWithLinesFunctor functor;
+  functor.Locator = this;
+  functor.CellIds = cellIds;
+  functor.P1 = p1;
+  functor.P2 = p2;
+  functor.Tolerance = tol;
+  functor.X = x;
+  functor.T = t;
+  if (!this->Tree)
+    {
+    double p[3];
+    for (vtkIdType i = 0; i < numLines; ++i)
+      {
+      p2->GetPoint(i, p);
+      functor.SetMiss(i, p);
+      }
+    return;
+    }
+  // The cells of the subclasses are tested by IntersectCellInternal(), which
+  // may not be thread safe.
+  RunQueries(this->DataSet, !this->UsesIntersectCellInternal(), numLines,
+             functor);
+}
+
 //---------------------------------------------------------------------------
 
 void vtkCellTreeLocator::PrintSelf(ostream& os, vtkIndent indent)
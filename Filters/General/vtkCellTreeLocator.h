@@ -25,6 +25,14 @@
 // and traversal algorithms described in the paper.
 // Some methods in building and traversing the cell tree in this class were derived
 // avtCellLocatorBIH class in the VisIT Visualization Tool
+//
+// The tree is built with vtkSMPTools: the bounds of the cells and the
+// buckets of the largest nodes are computed in parallel, then the subtrees
+// below them are split concurrently. The tree is the same whatever the
+// number of threads. Once built, the locator may be shared by several
+// threads calling FindCell() and IntersectWithLine() with their own
+// vtkGenericCell, and FindCells() and IntersectWithLines() locate arrays
+// of points and line segments in parallel.
 
 // .SECTION Caveats
 //
@@ -43,6 +51,8 @@
 class vtkCellPointTraversal;
 class vtkIdTypeArray;
 class vtkCellArray;
+class vtkDoubleArray;
+class vtkPoints;
 
 class VTKFILTERSGENERAL_EXPORT vtkCellTreeLocator : public vtkAbstractCellLocator
 {
@@ -58,20 +68,44 @@ class VTKFILTERSGENERAL_EXPORT vtkCellTreeLocator : public vtkAbstractCellLocato
     // and number of buckets to 5.  Buckets are used in building the cell tree as described in the paper
     static vtkCellTreeLocator *New();
 
-     // Description:
+    // Description:
     // Test a point to find if it is inside a cell. Returns the cellId if inside
-    // or -1 if not.
+    // or -1 if not. Only the given cell and weights are modified, so this
+    // method may be called concurrently once the locator is built.
     virtual vtkIdType FindCell(double pos[3], double vtkNotUsed, vtkGenericCell *cell,  double pcoords[3],
                                        double* weights );
 
     // Description:
     // Return intersection point (if any) AND the cell which was intersected by
     // the finite line. The cell is returned as a cell id and as a generic cell.
+    // Only the given cell is modified, so this method may be called
+    // concurrently once the locator is built. This does not hold for the
+    // subclasses, whose cells are tested with IntersectCellInternal().
     virtual int IntersectWithLine(double a0[3], double a1[3], double tol,
                                       double& t, double x[3], double pcoords[3],
                                       int &subId, vtkIdType &cellId,
                                       vtkGenericCell *cell);
 
+    // Description:
+    // Find the cells containing the given points, in parallel. cellIds is
+    // resized to the number of points and receives the id of the cell
+    // containing each point, or -1 if the point is outside of the data set.
+    // The locator is built first if needed.
+    virtual void FindCells(vtkPoints *points, vtkIdList *cellIds);
+
+    // Description:
+    // Intersect the line segments going from the points of p1 to the points
+    // of p2 with the cells, in parallel except for the subclasses (see
+    // IntersectWithLine()). cellIds is resized to the number of
+    // segments and receives the id of the first cell hit along each segment,
+    // or -1 if none is. When given, x and t are resized likewise and receive
+    // the intersection points and their parametric coordinates along the
+    // segments, or the end point and 1 for the segments hitting no cell.
+    // The locator is built first if needed.
+    virtual void IntersectWithLines(vtkPoints *p1, vtkPoints *p2, double tol,
+                                    vtkIdList *cellIds, vtkPoints *x = NULL,
+                                    vtkDoubleArray *t = NULL);
+
     // Description:
     // Return a list of unique cell ids inside of a given bounding box. The
     // user must provide the vtkIdList to populate. This method returns data
@@ -191,28 +225,42 @@ protected:
   bool RayMinMaxT(const double origin[3],
     const double dir[3],
     double &rTmin,
-    double &rTmax);
+    double &rTmax) const;
 
   bool RayMinMaxT(const double bounds[6],
     const double origin[3],
     const double dir[3],
     double &rTmin,
-    double &rTmax);
+    double &rTmax) const;
 
-  int getDominantAxis(const double dir[3]);
+  int getDominantAxis(const double dir[3]) const;
 
   // Order nodes as near/far relative to ray
   void Classify(const double origin[3],
     const double dir[3],
     double &rDist,
     vtkCellTreeNode *&near, vtkCellTreeNode *&mid,
-    vtkCellTreeNode *&far, int &mustCheck);
+    vtkCellTreeNode *&far, int &mustCheck) const;
+
+  // Walk the tree to find the cell closest to p1 intersected by the line,
+  // using cell as scratch. The locator must be built.
+  int IntersectWithLineInternal(const double p1[3],
+    const double p2[3],
+    double tol,
+    double &t,
+    double x[3],
+    double pcoords[3],
+    int &subId,
+    vtkIdType &cellId,
+    vtkGenericCell *cell);
 
   // From vtkModifiedBSPTRee
   // We provide a function which does the cell/ray test so that
   // it can be overriden by subclasses to perform special treatment
   // (Example : Particles stored in tree, have no dimension, so we must
   // override the cell test to return a value based on some particle size
+  // It is called for the cells of all subclasses, which are then not
+  // queried concurrently.
   virtual int IntersectCellInternal( vtkIdType cell_ID,  const double p1[3],
     const double p2[3],
     const double tol,
@@ -221,6 +269,25 @@ protected:
     double pcoords[3],
     int &subId);
 
+  // The default cell/ray test, using cell as scratch instead of the cell of
+  // the locator, so that it may be called concurrently.
+  int IntersectCellWithLine(vtkIdType cell_ID,
+    const double p1[3],
+    const double p2[3],
+    const double tol,
+    double &t,
+    double ipt[3],
+    double pcoords[3],
+    int &subId,
+    vtkGenericCell *cell) const;
+
+  // Whether the cells are tested with IntersectCellInternal(), which
+  // subclasses may override, rather than concurrently.
+  bool UsesIntersectCellInternal() const;
+
+  // Compute the cached cell bounds in parallel when the data set allows it.
+  virtual bool StoreCellBounds();
+
 
     int NumberOfBuckets;
 
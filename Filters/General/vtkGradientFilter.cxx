@@ -20,11 +20,14 @@
 
 #include "vtkGradientFilter.h"
 
+#include "vtkArrayDispatch.h"
 #include "vtkCell.h"
 #include "vtkCellData.h"
 #include "vtkCellDataToPointData.h"
 #include "vtkDataArray.h"
+#include "vtkDataArrayAccessor.h"
 #include "vtkDataSet.h"
+#include "vtkGenericCell.h"
 #include "vtkIdList.h"
 #include "vtkImageData.h"
 #include "vtkInformation.h"
@@ -35,7 +38,10 @@
 #include "vtkPointData.h"
 #include "vtkPolyData.h"
 #include "vtkRectilinearGrid.h"
+#include "vtkSMPThreadLocalObject.h"
+#include "vtkSMPTools.h"
 #include "vtkSmartPointer.h"
+#include "vtkStaticCellLinksTemplate.h"
 #include "vtkStreamingDemandDrivenPipeline.h"
 #include "vtkStructuredGrid.h"
 #include "vtkUnstructuredGrid.h"
@@ -81,21 +87,322 @@ namespace
   }
 
   // Functions for unstructured grids and polydatas
-  template<class data_type>
-  void ComputePointGradientsUG(
-    vtkDataSet *structure, data_type *array, data_type *gradients,
-    int numberOfInputComponents, data_type* vorticity, data_type* qCriterion,
-    data_type* divergence);
-
   int GetCellParametricData(
     vtkIdType pointId, double pointCoord[3], vtkCell *cell, int & subId,
-    double parametricCoord[3]);
+    double parametricCoord[3], double *weights);
+
+  // Common part of the functors computing the gradients of unstructured
+  // grids and polydatas. The gradient of a tuple is stored along with the
+  // vorticity, Q-criterion and divergence derived from it, so that all of
+  // them are computed in a single pass over the dataset.
+  template<class InArrayT, class OutArrayT>
+  class GradientsUGFunctor
+  {
+  public:
+    typedef typename vtkDataArrayAccessor<OutArrayT>::APIType ValueType;
+
+    GradientsUGFunctor(vtkDataSet *structure, InArrayT *array,
+                       OutArrayT *gradients, OutArrayT *vorticity,
+                       OutArrayT *qCriterion, OutArrayT *divergence)
+      : Structure(structure), Array(array), Gradients(gradients),
+        Vorticity(vorticity), QCriterion(qCriterion), Divergence(divergence),
+        NumberOfInputComponents(array->GetNumberOfComponents())
+    {
+    }
 
-  template<class data_type>
-  void ComputeCellGradientsUG(
-    vtkDataSet *structure, data_type *array, data_type *gradients,
-    int numberOfInputComponents, data_type* vorticity, data_type* qCriterion,
-    data_type* divergence);
+  protected:
+    void StoreResults(vtkIdType id, ValueType *g)
+    {
+      if(this->Vorticity)
+        {
+        ValueType vorticity[3];
+        ComputeVorticityFromGradient(g, vorticity);
+        vtkDataArrayAccessor<OutArrayT> v(this->Vorticity);
+        v.Set(id, 0, vorticity[0]);
+        v.Set(id, 1, vorticity[1]);
+        v.Set(id, 2, vorticity[2]);
+        }
+      if(this->QCriterion)
+        {
+        ValueType qCriterion;
+        ComputeQCriterionFromGradient(g, &qCriterion);
+        vtkDataArrayAccessor<OutArrayT>(this->QCriterion).Set(id, 0, qCriterion);
+        }
+      if(this->Divergence)
+        {
+        ValueType divergence;
+        ComputeDivergenceFromGradient(g, &divergence);
+        vtkDataArrayAccessor<OutArrayT>(this->Divergence).Set(id, 0, divergence);
+        }
+      if(this->Gradients)
+        {
+        vtkDataArrayAccessor<OutArrayT> gradients(this->Gradients);
+        for(int i=0;i<3*this->NumberOfInputComponents;i++)
+          {
+          gradients.Set(id, i, g[i]);
+          }
+        }
+    }
+
+    vtkDataSet *Structure;
+    InArrayT *Array;
+    OutArrayT *Gradients;
+    OutArrayT *Vorticity;
+    OutArrayT *QCriterion;
+    OutArrayT *Divergence;
+    int NumberOfInputComponents;
+    vtkSMPThreadLocalObject<vtkGenericCell> Cell;
+  };
+
+  // Point gradients are the average of the derivatives at the point of
+  // the cells using it. The cells using each point are given by the
+  // precomputed links.
+  template<class InArrayT, class OutArrayT>
+  class PointGradientsUGFunctor : public GradientsUGFunctor<InArrayT, OutArrayT>
+  {
+  public:
+    typedef GradientsUGFunctor<InArrayT, OutArrayT> Superclass;
+    typedef typename Superclass::ValueType ValueType;
+
+    PointGradientsUGFunctor(vtkDataSet *structure, InArrayT *array,
+                            OutArrayT *gradients, OutArrayT *vorticity,
+                            OutArrayT *qCriterion, OutArrayT *divergence,
+                            vtkStaticCellLinksTemplate<vtkIdType> *links)
+      : Superclass(structure, array, gradients, vorticity, qCriterion,
+                   divergence), Links(links)
+    {
+    }
+
+    void operator()(vtkIdType begin, vtkIdType end)
+    {
+      vtkGenericCell *cell = this->Cell.Local();
+      vtkDataArrayAccessor<InArrayT> array(this->Array);
+      int numberOfInputComponents = this->NumberOfInputComponents;
+      std::vector<ValueType> g(3*numberOfInputComponents);
+      std::vector<double> values(8);
+
+      for (vtkIdType point = begin; point < end; point++)
+        {
+        double pointcoords[3];
+        this->Structure->GetPoint(point, pointcoords);
+        // Get all cells touching this point.
+        vtkIdType numCellNeighbors = this->Links->GetNumberOfCells(point);
+        const vtkIdType *cellsOnPoint = this->Links->GetCells(point);
+
+        for(int i=0;i<3*numberOfInputComponents;i++)
+          {
+          g[i] = 0;
+          }
+
+        // Iterate on all cells and find all points connected to current
+        // point by an edge.
+        for (vtkIdType neighbor = 0; neighbor < numCellNeighbors; neighbor++)
+          {
+          this->Structure->GetCell(cellsOnPoint[neighbor], cell);
+          int numberOfCellPoints = cell->GetNumberOfPoints();
+          if(static_cast<size_t>(numberOfCellPoints) > values.size())
+            {
+            values.resize(numberOfCellPoints);
+            }
+          int subId;
+          double parametricCoord[3];
+          if(GetCellParametricData(point, pointcoords, cell,
+                                   subId, parametricCoord, &values[0]))
+            {
+            for(int inputComponent=0;inputComponent<numberOfInputComponents;
+                inputComponent++)
+              {
+              // Get values of Array at cell points.
+              for (int i = 0; i < numberOfCellPoints; i++)
+                {
+                values[i] = static_cast<double>(
+                  array.Get(cell->GetPointId(i), inputComponent));
+                }
+
+              double derivative[3];
+              // Get derivative of cell at point.
+              cell->Derivatives(subId, parametricCoord, &values[0], 1,
+                                derivative);
+
+              g[inputComponent*3] += static_cast<ValueType>(derivative[0]);
+              g[inputComponent*3+1] += static_cast<ValueType>(derivative[1]);
+              g[inputComponent*3+2] += static_cast<ValueType>(derivative[2]);
+              } // iterating over Components
+            } // if(GetCellParametricData())
+          } // iterating over neighbors
+
+        if (numCellNeighbors > 0)
+          {
+          for(int i=0;i<3*numberOfInputComponents;i++)
+            {
+            g[i] /= numCellNeighbors;
+            }
+          }
+
+        this->StoreResults(point, &g[0]);
+        }  // iterating over points in grid
+    }
+
+  private:
+    vtkStaticCellLinksTemplate<vtkIdType> *Links;
+  };
+
+  // Cell gradients are the derivatives at the parametric center of the
+  // cells.
+  template<class InArrayT, class OutArrayT>
+  class CellGradientsUGFunctor : public GradientsUGFunctor<InArrayT, OutArrayT>
+  {
+  public:
+    typedef GradientsUGFunctor<InArrayT, OutArrayT> Superclass;
+    typedef typename Superclass::ValueType ValueType;
+
+    CellGradientsUGFunctor(vtkDataSet *structure, InArrayT *array,
+                           OutArrayT *gradients, OutArrayT *vorticity,
+                           OutArrayT *qCriterion, OutArrayT *divergence)
+      : Superclass(structure, array, gradients, vorticity, qCriterion,
+                   divergence)
+    {
+    }
+
+    void operator()(vtkIdType begin, vtkIdType end)
+    {
+      vtkGenericCell *cell = this->Cell.Local();
+      vtkDataArrayAccessor<InArrayT> array(this->Array);
+      int numberOfInputComponents = this->NumberOfInputComponents;
+      std::vector<double> values(8);
+      std::vector<ValueType> cellGradients(3*numberOfInputComponents);
+
+      for (vtkIdType cellid = begin; cellid < end; cellid++)
+        {
+        this->Structure->GetCell(cellid, cell);
+
+        int subId;
+        double cellCenter[3];
+        subId = cell->GetParametricCenter(cellCenter);
+
+        int numpoints = cell->GetNumberOfPoints();
+        if(static_cast<size_t>(numpoints) > values.size())
+          {
+          values.resize(numpoints);
+          }
+        double derivative[3];
+        for(int inputComponent=0;inputComponent<numberOfInputComponents;
+            inputComponent++)
+          {
+          for (int i = 0; i < numpoints; i++)
+            {
+            values[i] = static_cast<double>(
+              array.Get(cell->GetPointId(i), inputComponent));
+            }
+
+          cell->Derivatives(subId, cellCenter, &values[0], 1, derivative);
+          cellGradients[inputComponent*3] =
+            static_cast<ValueType>(derivative[0]);
+          cellGradients[inputComponent*3+1] =
+            static_cast<ValueType>(derivative[1]);
+          cellGradients[inputComponent*3+2] =
+            static_cast<ValueType>(derivative[2]);
+          }
+
+        this->StoreResults(cellid, &cellGradients[0]);
+        }
+    }
+  };
+
+  // Dispatches the computation of the gradients of an unstructured grid or
+  // polydata on the type of the input array and of the output arrays, which
+  // all have the same type. Unstructured grids and polydatas are processed
+  // in parallel since retrieving their cells is thread safe once their
+  // cells and links are built.
+  struct GradientsUGWorker
+  {
+    vtkDataSet *Structure;
+    bool PointGradients;
+    vtkDataArray *Gradients;
+    vtkDataArray *Vorticity;
+    vtkDataArray *QCriterion;
+    vtkDataArray *Divergence;
+
+    template<class InArrayT, class OutArrayT>
+    void operator()(InArrayT *array, OutArrayT *)
+    {
+      bool parallel = false;
+      if(vtkPolyData *polyData = vtkPolyData::SafeDownCast(this->Structure))
+        {
+        polyData->BuildCells();
+        parallel = true;
+        }
+      else if(vtkUnstructuredGrid::SafeDownCast(this->Structure))
+        {
+        parallel = true;
+        }
+
+      OutArrayT *gradients = static_cast<OutArrayT*>(this->Gradients);
+      OutArrayT *vorticity = static_cast<OutArrayT*>(this->Vorticity);
+      OutArrayT *qCriterion = static_cast<OutArrayT*>(this->QCriterion);
+      OutArrayT *divergence = static_cast<OutArrayT*>(this->Divergence);
+      if(this->PointGradients)
+        {
+        vtkStaticCellLinksTemplate<vtkIdType> links;
+        links.BuildLinks(this->Structure);
+        PointGradientsUGFunctor<InArrayT, OutArrayT> functor(
+          this->Structure, array, gradients, vorticity, qCriterion,
+          divergence, &links);
+        this->Execute(functor, this->Structure->GetNumberOfPoints(), parallel);
+        }
+      else
+        {
+        CellGradientsUGFunctor<InArrayT, OutArrayT> functor(
+          this->Structure, array, gradients, vorticity, qCriterion,
+          divergence);
+        this->Execute(functor, this->Structure->GetNumberOfCells(), parallel);
+        }
+    }
+
+    template<class Functor>
+    void Execute(Functor &functor, vtkIdType num, bool parallel)
+    {
+      if(parallel)
+        {
+        vtkSMPTools::For(0, num, functor);
+        }
+      else
+        {
+        functor(0, num);
+        }
+    }
+  };
+
+  // Computes the gradients of array over structure into the first non-NULL
+  // output arrays, which have the type of array.
+  void ComputeGradientsUG(
+    vtkDataSet *structure, vtkDataArray *array, bool pointGradients,
+    vtkDataArray *gradients, vtkDataArray *vorticity, vtkDataArray *qCriterion,
+    vtkDataArray *divergence)
+  {
+    vtkDataArray *outputs[4] = { gradients, vorticity, qCriterion, divergence };
+    vtkDataArray *output = NULL;
+    for(int i=0;i<4 && !output;i++)
+      {
+      output = outputs[i];
+      }
+    if(!output)
+      {
+      return;
+      }
+
+    GradientsUGWorker worker;
+    worker.Structure = structure;
+    worker.PointGradients = pointGradients;
+    worker.Gradients = gradients;
+    worker.Vorticity = vorticity;
+    worker.QCriterion = qCriterion;
+    worker.Divergence = divergence;
+    if(!vtkArrayDispatch::Dispatch2SameValueType::Execute(array, output, worker))
+      {
+      worker(array, output);
+      }
+  }
 
   // Functions for image data and structured grids
   template<class Grid, class data_type>
@@ -399,21 +706,8 @@ int vtkGradientFilter::ComputeUnstructuredGridGradient(
     {
     if (!this->FasterApproximation)
       {
-      switch (array->GetDataType())
-        {
-        vtkTemplateMacro(ComputePointGradientsUG(
-                           input,
-                           static_cast<VTK_TT *>(array->GetVoidPointer(0)),
-                           (gradients == NULL ? NULL :
-                            static_cast<VTK_TT *>(gradients->GetVoidPointer(0))),
-                           numberOfInputComponents,
-                           (vorticity == NULL ? NULL :
-                            static_cast<VTK_TT *>(vorticity->GetVoidPointer(0))),
-                           (qCriterion == NULL ? NULL :
-                            static_cast<VTK_TT *>(qCriterion->GetVoidPointer(0))),
-                           (divergence == NULL ? NULL :
-                            static_cast<VTK_TT *>(divergence->GetVoidPointer(0)))));
-        }
+      ComputeGradientsUG(input, array, true, gradients, vorticity,
+                         qCriterion, divergence);
       if(gradients)
         {
         output->GetPointData()->AddArray(gradients);
@@ -467,21 +761,8 @@ int vtkGradientFilter::ComputeUnstructuredGridGradient(
         cellQCriterion->SetNumberOfTuples(input->GetNumberOfCells());
         }
 
-      switch (array->GetDataType())
-        {
-        vtkTemplateMacro(
-          ComputeCellGradientsUG(
-            input, static_cast<VTK_TT *>(array->GetVoidPointer(0)),
-            (cellGradients == NULL ? NULL :
-             static_cast<VTK_TT *>(cellGradients->GetVoidPointer(0))),
-            numberOfInputComponents,
-            (vorticity == NULL ? NULL :
-             static_cast<VTK_TT *>(cellVorticity->GetVoidPointer(0))),
-            (qCriterion == NULL ? NULL :
-             static_cast<VTK_TT *>(cellQCriterion->GetVoidPointer(0))),
-            (divergence == NULL ? NULL :
-             static_cast<VTK_TT *>(cellDivergence->GetVoidPointer(0)))));
-        }
+      ComputeGradientsUG(input, array, false, cellGradients, cellVorticity,
+                         cellQCriterion, cellDivergence);
 
       // We need to convert cell Array to points Array.
       vtkSmartPointer<vtkDataSet> dummy;
@@ -548,21 +829,8 @@ int vtkGradientFilter::ComputeUnstructuredGridGradient(
       = cd2pd->GetOutput()->GetPointData()->GetScalars();
     pointScalars->Register(this);
 
-    switch (pointScalars->GetDataType())
-      {
-      vtkTemplateMacro(ComputeCellGradientsUG(
-                         input,
-                         static_cast<VTK_TT *>(pointScalars->GetVoidPointer(0)),
-                         (gradients == NULL ? NULL :
-                          static_cast<VTK_TT *>(gradients->GetVoidPointer(0))),
-                         numberOfInputComponents,
-                         (vorticity == NULL ? NULL :
-                          static_cast<VTK_TT *>(vorticity->GetVoidPointer(0))),
-                         (qCriterion == NULL ? NULL :
-                          static_cast<VTK_TT *>(qCriterion->GetVoidPointer(0))),
-                         (divergence == NULL ? NULL :
-                          static_cast<VTK_TT *>(divergence->GetVoidPointer(0)))));
-      }
+    ComputeGradientsUG(input, pointScalars, false, gradients, vorticity,
+                       qCriterion, divergence);
 
     if(gradients)
       {
@@ -754,104 +1022,10 @@ int vtkGradientFilter::ComputeRegularGridGradient(
 }
 
 namespace {
-//-----------------------------------------------------------------------------
-  template<class data_type>
-  void ComputePointGradientsUG(
-    vtkDataSet *structure, data_type *array, data_type *gradients,
-    int numberOfInputComponents, data_type* vorticity, data_type* qCriterion,
-    data_type* divergence)
-  {
-    vtkNew<vtkIdList> currentPoint;
-    currentPoint->SetNumberOfIds(1);
-    vtkNew<vtkIdList> cellsOnPoint;
-
-    vtkIdType numpts = structure->GetNumberOfPoints();
-
-    int numberOfOutputComponents = 3*numberOfInputComponents;
-    std::vector<data_type> g(numberOfOutputComponents);
-
-    for (vtkIdType point = 0; point < numpts; point++)
-      {
-      currentPoint->SetId(0, point);
-      double pointcoords[3];
-      structure->GetPoint(point, pointcoords);
-      // Get all cells touching this point.
-      structure->GetCellNeighbors(-1, currentPoint.GetPointer(),
-                                  cellsOnPoint.GetPointer());
-      vtkIdType numCellNeighbors = cellsOnPoint->GetNumberOfIds();
-      vtkIdType numValidCellNeighbors = 0;
-
-      for(int i=0;i<numberOfOutputComponents;i++)
-        {
-        g[i] = 0;
-        }
-
-      // Iterate on all cells and find all points connected to current point
-      // by an edge.
-      for (vtkIdType neighbor = 0; neighbor < numCellNeighbors; neighbor++)
-        {
-        vtkCell *cell = structure->GetCell(cellsOnPoint->GetId(neighbor));
-        int subId;
-        double parametricCoord[3];
-        if(GetCellParametricData(point, pointcoords, cell,
-                                 subId, parametricCoord))
-          {
-          numValidCellNeighbors++;
-          for(int InputComponent=0;InputComponent<numberOfInputComponents;InputComponent++)
-            {
-            int NumberOfCellPoints = cell->GetNumberOfPoints();
-            std::vector<double> values(NumberOfCellPoints);
-            // Get values of Array at cell points.
-            for (int i = 0; i < NumberOfCellPoints; i++)
-              {
-              values[i] = static_cast<double>(
-                array[cell->GetPointId(i)*numberOfInputComponents+InputComponent]);
-              }
-
-            double derivative[3];
-            // Get derivative of cell at point.
-            cell->Derivatives(subId, parametricCoord, &values[0], 1, derivative);
-
-            g[InputComponent*3] += static_cast<data_type>(derivative[0]);
-            g[InputComponent*3+1] += static_cast<data_type>(derivative[1]);
-            g[InputComponent*3+2] += static_cast<data_type>(derivative[2]);
-            } // iterating over Components
-          } // if(GetCellParametricData())
-        } // iterating over neighbors
-
-      if (numCellNeighbors > 0)
-        {
-        for(int i=0;i<3*numberOfInputComponents;i++)
-          {
-          g[i] /= numCellNeighbors;
-          }
-        }
-
-      if(vorticity)
-        {
-        ComputeVorticityFromGradient(&g[0], vorticity+3*point);
-        }
-      if(qCriterion)
-        {
-        ComputeQCriterionFromGradient(&g[0], qCriterion+point);
-        }
-      if(divergence)
-        {
-        ComputeDivergenceFromGradient(&g[0], divergence+point);
-        }
-      if(gradients)
-        {
-        for(int i=0;i<numberOfOutputComponents;i++)
-          {
-          gradients[point*numberOfOutputComponents+i] = g[i];
-          }
-        }
-      }  // iterating over points in grid
-  }
-
 //-----------------------------------------------------------------------------
   int GetCellParametricData(vtkIdType pointId, double pointCoord[3],
-                            vtkCell *cell, int &subId, double parametricCoord[3])
+                            vtkCell *cell, int &subId, double parametricCoord[3],
+                            double *weights)
   {
     // Watch out for degenerate cells.  They make the derivative calculation
     // fail.
@@ -871,78 +1045,13 @@ namespace {
       }
 
     double dummy;
-    int numpoints = cell->GetNumberOfPoints();
-    std::vector<double> values(numpoints);
     // Get parametric position of point.
     cell->EvaluatePosition(pointCoord, NULL, subId, parametricCoord,
-                           dummy, &values[0]/*Really another dummy.*/);
+                           dummy, weights/*Really another dummy.*/);
 
     return 1;
   }
 
-//-----------------------------------------------------------------------------
-  template<class data_type>
-    void ComputeCellGradientsUG(
-      vtkDataSet *structure, data_type *array, data_type *gradients,
-      int numberOfInputComponents, data_type* vorticity,
-      data_type* qCriterion, data_type* divergence)
-  {
-    vtkIdType numcells = structure->GetNumberOfCells();
-    std::vector<double> values(8);
-    std::vector<data_type> cellGradients(3*numberOfInputComponents);
-    for (vtkIdType cellid = 0; cellid < numcells; cellid++)
-      {
-      vtkCell *cell = structure->GetCell(cellid);
-
-      int subId;
-      double cellCenter[3];
-      subId = cell->GetParametricCenter(cellCenter);
-
-      int numpoints = cell->GetNumberOfPoints();
-      if(static_cast<size_t>(numpoints) > values.size())
-        {
-        values.resize(numpoints);
-        }
-      double derivative[3];
-      for(int inputComponent=0;inputComponent<numberOfInputComponents;
-          inputComponent++)
-        {
-        for (int i = 0; i < numpoints; i++)
-          {
-          values[i] = static_cast<double>(
-            array[cell->GetPointId(i)*numberOfInputComponents+inputComponent]);
-          }
-
-        cell->Derivatives(subId, cellCenter, &values[0], 1, derivative);
-        cellGradients[inputComponent*3] =
-          static_cast<data_type>(derivative[0]);
-        cellGradients[inputComponent*3+1] =
-          static_cast<data_type>(derivative[1]);
-        cellGradients[inputComponent*3+2] =
-          static_cast<data_type>(derivative[2]);
-        }
-      if(gradients)
-        {
-        for(int i=0;i<3*numberOfInputComponents;i++)
-          {
-          gradients[cellid*3*numberOfInputComponents+i] = cellGradients[i];
-          }
-        }
-      if(vorticity)
-        {
-        ComputeVorticityFromGradient(&cellGradients[0], vorticity+3*cellid);
-        }
-      if(qCriterion)
-        {
-        ComputeQCriterionFromGradient(&cellGradients[0], qCriterion+cellid);
-        }
-      if(divergence)
-        {
-        ComputeDivergenceFromGradient(&cellGradients[0], divergence+cellid);
-        }
-      }
-  }
-
 //-----------------------------------------------------------------------------
   template<class Grid, class data_type>
   void ComputeGradientsSG(Grid output, data_type* array, data_type* gradients,
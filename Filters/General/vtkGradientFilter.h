@@ -29,6 +29,10 @@
 // output tuple will be {du/dx, du/dy, du/dz, dv/dx, dv/dy, dv/dz, dw/dx,
 // dw/dy, dw/dz} for an input array {u, v, w}. There are also the options
 // to additionally compute the vorticity and Q criterion of a vector field.
+//
+// On unstructured grids and polydata the gradients, along with the
+// vorticity, Q criterion and divergence, are computed in a single pass
+// over the points or cells, which is executed in parallel with vtkSMPTools.
 
 #ifndef vtkGradientFilter_h
 #define vtkGradientFilter_h
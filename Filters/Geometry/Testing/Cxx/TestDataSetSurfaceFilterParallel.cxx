@@ -0,0 +1,324 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    TestDataSetSurfaceFilterParallel.cxx
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+// Compares the parallel and serial extraction of the surface of
+// unstructured grids made of all the cell types handled in parallel,
+// including duplicate and degenerate cells and ghost points. The parallel
+// extraction is forced, whatever the number of threads.
+
+#include "vtkCellArray.h"
+#include "vtkCellData.h"
+#include "vtkDataSetSurfaceFilter.h"
+#include "vtkFloatArray.h"
+#include "vtkIdTypeArray.h"
+#include "vtkIntArray.h"
+#include "vtkMath.h"
+#include "vtkNew.h"
+#include "vtkObjectFactory.h"
+#include "vtkPointData.h"
+#include "vtkPoints.h"
+#include "vtkPolyData.h"
+#include "vtkSMPTools.h"
+#include "vtkStringArray.h"
+#include "vtkUnsignedCharArray.h"
+#include "vtkUnstructuredGrid.h"
+
+#include <sstream>
+
+// Always extracts the surface of unstructured grids in parallel, and
+// records whether the parallel extraction succeeded.
+class vtkParallelSurfaceFilter : public vtkDataSetSurfaceFilter
+{
+public:
+  static vtkParallelSurfaceFilter *New();
+  vtkTypeMacro(vtkParallelSurfaceFilter, vtkDataSetSurfaceFilter);
+
+  bool Parallel;
+
+  int UnstructuredGridExecute(vtkDataSet *input,
+                              vtkPolyData *output) VTK_OVERRIDE
+  {
+    vtkUnstructuredGrid *grid = vtkUnstructuredGrid::SafeDownCast(input);
+    this->Parallel =
+      grid && this->ParallelUnstructuredGridExecute(grid, output) != 0;
+    return this->Parallel ? 1 :
+      this->Superclass::UnstructuredGridExecute(input, output);
+  }
+
+protected:
+  vtkParallelSurfaceFilter() : Parallel(false)
+  {
+  }
+};
+
+vtkStandardNewMacro(vtkParallelSurfaceFilter);
+
+namespace
+{
+
+const int Resolution = 8;
+
+vtkIdType PointId(int i, int j, int k)
+{
+  return i + (Resolution + 1) * (j + (Resolution + 1) * k);
+}
+
+vtkIdType RandomPointId()
+{
+  return static_cast<vtkIdType>(
+    vtkMath::Random(0, (Resolution + 1) * (Resolution + 1) * (Resolution + 1)));
+}
+
+void InsertCell(vtkUnstructuredGrid *grid, int type, int npts,
+                const vtkIdType *pts, vtkIntArray *cellIds)
+{
+  cellIds->InsertNextValue(static_cast<int>(grid->GetNumberOfCells()));
+  grid->InsertNextCell(type, npts, const_cast<vtkIdType*>(pts));
+}
+
+void MakeGrid(vtkUnstructuredGrid *grid, bool stringArray, bool ghosts)
+{
+  vtkNew<vtkPoints> points;
+  vtkNew<vtkFloatArray> vectors;
+  vectors->SetName("Vectors");
+  vectors->SetNumberOfComponents(3);
+  vtkNew<vtkStringArray> strings;
+  strings->SetName("Strings");
+  vtkNew<vtkUnsignedCharArray> ghostArray;
+  ghostArray->SetName(vtkDataSetAttributes::GhostArrayName());
+  for (int k = 0; k <= Resolution; k++)
+    {
+    for (int j = 0; j <= Resolution; j++)
+      {
+      for (int i = 0; i <= Resolution; i++)
+        {
+        points->InsertNextPoint(i, j, k);
+        vectors->InsertNextTuple3(i * j, k - j, vtkMath::Random());
+        std::ostringstream str;
+        str << PointId(i, j, k);
+        strings->InsertNextValue(str.str());
+        double r = vtkMath::Random();
+        ghostArray->InsertNextValue(
+          r < 0.2 ? vtkDataSetAttributes::DUPLICATEPOINT :
+          (r < 0.22 ? vtkDataSetAttributes::HIDDENPOINT : 0));
+        }
+      }
+    }
+  grid->SetPoints(points.GetPointer());
+  grid->GetPointData()->AddArray(vectors.GetPointer());
+  if (stringArray)
+    {
+    grid->GetPointData()->AddArray(strings.GetPointer());
+    }
+  if (ghosts)
+    {
+    grid->GetPointData()->AddArray(ghostArray.GetPointer());
+    }
+
+  vtkNew<vtkIntArray> cellIds;
+  cellIds->SetName("CellIds");
+  grid->Allocate(Resolution * Resolution * Resolution);
+  for (int k = 0; k < Resolution; k++)
+    {
+    for (int j = 0; j < Resolution; j++)
+      {
+      for (int i = 0; i < Resolution; i++)
+        {
+        vtkIdType hex[8] = {
+          PointId(i, j, k), PointId(i + 1, j, k),
+          PointId(i + 1, j + 1, k), PointId(i, j + 1, k),
+          PointId(i, j, k + 1), PointId(i + 1, j, k + 1),
+          PointId(i + 1, j + 1, k + 1), PointId(i, j + 1, k + 1) };
+        vtkIdType voxel[8] = { hex[0], hex[1], hex[3], hex[2],
+                               hex[4], hex[5], hex[7], hex[6] };
+        vtkIdType wedge[6] = { hex[0], hex[1], hex[3], hex[4], hex[5], hex[7] };
+        vtkIdType other[12];
+        for (int p = 0; p < 12; p++)
+          {
+          other[p] = RandomPointId();
+          }
+        switch (static_cast<int>(vtkMath::Random(0, 14)))
+          {
+          case 0:
+            InsertCell(grid, VTK_VOXEL, 8, voxel, cellIds.GetPointer());
+            break;
+          case 1:
+            InsertCell(grid, VTK_TETRA, 4, hex, cellIds.GetPointer());
+            InsertCell(grid, VTK_TETRA, 4, hex + 4, cellIds.GetPointer());
+            break;
+          case 2:
+            InsertCell(grid, VTK_WEDGE, 6, wedge, cellIds.GetPointer());
+            break;
+          case 3:
+            InsertCell(grid, VTK_PYRAMID, 5, hex, cellIds.GetPointer());
+            InsertCell(grid, VTK_PYRAMID, 5, hex + 3, cellIds.GetPointer());
+            break;
+          case 4:
+            InsertCell(grid, VTK_PENTAGONAL_PRISM, 10, other,
+                       cellIds.GetPointer());
+            break;
+          case 5:
+            InsertCell(grid, VTK_HEXAGONAL_PRISM, 12, other,
+                       cellIds.GetPointer());
+            break;
+          case 6:
+            // A degenerate hexahedron and a duplicate one.
+            hex[1] = hex[0];
+            hex[6] = hex[2];
+            InsertCell(grid, VTK_HEXAHEDRON, 8, hex, cellIds.GetPointer());
+            InsertCell(grid, VTK_HEXAHEDRON, 8, hex, cellIds.GetPointer());
+            break;
+          case 7:
+            InsertCell(grid, VTK_VERTEX, 1, other, cellIds.GetPointer());
+            InsertCell(grid, VTK_POLY_VERTEX, 3, other + 1,
+                       cellIds.GetPointer());
+            InsertCell(grid, VTK_HEXAHEDRON, 8, hex, cellIds.GetPointer());
+            break;
+          case 8:
+            InsertCell(grid, VTK_LINE, 2, other, cellIds.GetPointer());
+            InsertCell(grid, VTK_POLY_LINE, 4, other + 2,
+                       cellIds.GetPointer());
+            break;
+          case 9:
+            InsertCell(grid, VTK_TRIANGLE, 3, other, cellIds.GetPointer());
+            InsertCell(grid, VTK_QUAD, 4, hex, cellIds.GetPointer());
+            break;
+          case 10:
+            InsertCell(grid, VTK_PIXEL, 4, voxel, cellIds.GetPointer());
+            InsertCell(grid, VTK_POLYGON, 5, other, cellIds.GetPointer());
+            break;
+          case 11:
+            InsertCell(grid, VTK_TRIANGLE_STRIP, 3 + (i + j) % 5, other,
+                       cellIds.GetPointer());
+            break;
+          default:
+            InsertCell(grid, VTK_HEXAHEDRON, 8, hex, cellIds.GetPointer());
+          }
+        }
+      }
+    }
+  grid->GetCellData()->AddArray(cellIds.GetPointer());
+}
+
+bool CompareArrays(vtkAbstractArray *a, vtkAbstractArray *b)
+{
+  if (!a || !b || a->GetNumberOfTuples() != b->GetNumberOfTuples() ||
+      a->GetNumberOfComponents() != b->GetNumberOfComponents() ||
+      a->GetDataType() != b->GetDataType())
+    {
+    return false;
+    }
+  vtkIdType n = a->GetNumberOfTuples() * a->GetNumberOfComponents();
+  for (vtkIdType i = 0; i < n; i++)
+    {
+    if (a->GetVariantValue(i) != b->GetVariantValue(i))
+      {
+      return false;
+      }
+    }
+  return true;
+}
+
+bool CompareAttributes(vtkDataSetAttributes *a, vtkDataSetAttributes *b)
+{
+  if (a->GetNumberOfArrays() != b->GetNumberOfArrays())
+    {
+    return false;
+    }
+  for (int i = 0; i < a->GetNumberOfArrays(); i++)
+    {
+    vtkAbstractArray *array = a->GetAbstractArray(i);
+    if (!CompareArrays(array, b->GetAbstractArray(array->GetName())))
+      {
+      cerr << "Different array " << array->GetName() << endl;
+      return false;
+      }
+    }
+  return true;
+}
+
+bool CompareOutputs(vtkPolyData *a, vtkPolyData *b)
+{
+  if (a->GetNumberOfPoints() != b->GetNumberOfPoints() ||
+      a->GetNumberOfVerts() != b->GetNumberOfVerts() ||
+      a->GetNumberOfLines() != b->GetNumberOfLines() ||
+      a->GetNumberOfPolys() != b->GetNumberOfPolys() ||
+      a->GetNumberOfStrips() != b->GetNumberOfStrips())
+    {
+    cerr << "Expected " << a->GetNumberOfPoints() << " points and "
+         << a->GetNumberOfCells() << " cells, got " << b->GetNumberOfPoints()
+         << " points and " << b->GetNumberOfCells() << " cells" << endl;
+    return false;
+    }
+  if (!CompareArrays(a->GetPoints()->GetData(), b->GetPoints()->GetData()) ||
+      !CompareArrays(a->GetVerts()->GetData(), b->GetVerts()->GetData()) ||
+      !CompareArrays(a->GetLines()->GetData(), b->GetLines()->GetData()) ||
+      !CompareArrays(a->GetPolys()->GetData(), b->GetPolys()->GetData()))
+    {
+    cerr << "Different points or cells" << endl;
+    return false;
+    }
+  return CompareAttributes(a->GetPointData(), b->GetPointData()) &&
+    CompareAttributes(a->GetCellData(), b->GetCellData());
+}
+
+bool TestGrid(vtkUnstructuredGrid *grid)
+{
+  vtkNew<vtkDataSetSurfaceFilter> serial;
+  vtkNew<vtkParallelSurfaceFilter> parallel;
+  vtkDataSetSurfaceFilter *filters[2] = { serial.GetPointer(),
+                                          parallel.GetPointer() };
+  for (int passIds = 0; passIds < 2; passIds++)
+    {
+    for (int i = 0; i < 2; i++)
+      {
+      filters[i]->SetInputData(grid);
+      filters[i]->SetPassThroughCellIds(passIds);
+      filters[i]->SetPassThroughPointIds(passIds);
+      filters[i]->Update();
+      }
+    if (!parallel->Parallel)
+      {
+      cerr << "The surface was not extracted in parallel" << endl;
+      return false;
+      }
+    if (serial->GetOutput()->GetNumberOfPolys() == 0 ||
+        !CompareOutputs(serial->GetOutput(), parallel->GetOutput()))
+      {
+      return false;
+      }
+    }
+  return true;
+}
+
+}
+
+int TestDataSetSurfaceFilterParallel(int, char *[])
+{
+  vtkSMPTools::Initialize(4);
+  vtkMath::RandomSeed(5678);
+
+  for (int test = 0; test < 4; test++)
+    {
+    vtkNew<vtkUnstructuredGrid> grid;
+    MakeGrid(grid.GetPointer(), (test & 1) != 0, (test & 2) != 0);
+    if (!TestGrid(grid.GetPointer()))
+      {
+      cerr << "Failed for test " << test << endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -14,6 +14,8 @@
 =========================================================================*/
 #include "vtkDataSetSurfaceFilter.h"
 
+#include "vtkArrayListTemplate.h" // For processing attribute data
+#include "vtkAtomic.h"
 #include "vtkCellArray.h"
 #include "vtkCellData.h"
 #include "vtkCellIterator.h"
@@ -30,6 +32,7 @@
 #include "vtkPolyData.h"
 #include "vtkPyramid.h"
 #include "vtkRectilinearGrid.h"
+#include "vtkSMPTools.h"
 #include "vtkSmartPointer.h"
 #include "vtkStreamingDemandDrivenPipeline.h"
 #include "vtkStructuredGridGeometryFilter.h"
@@ -46,6 +49,7 @@
 #include "vtkStructuredData.h"
 
 #include <algorithm>
+#include <vector>
 #include <vtksys/hash_map.hxx>
 
 #include <cassert>
@@ -128,6 +132,8 @@ vtkDataSetSurfaceFilter::vtkDataSetSurfaceFilter()
   this->OriginalPointIdsName = NULL;
 
   this->NonlinearSubdivisionLevel = 1;
+
+  this->ParallelFaceExtraction = 0;
 }
 
 //----------------------------------------------------------------------------
@@ -1282,6 +1288,8 @@ void vtkDataSetSurfaceFilter::PrintSelf(ostream& os, vtkIndent indent)
 
   os << indent << "NonlinearSubdivisionLevel: "
      << this->GetNonlinearSubdivisionLevel() << endl;
+  os << indent << "ParallelFaceExtraction: "
+     << (this->ParallelFaceExtraction ? "On\n" : "Off\n");
 }
 
 //========================================================================
@@ -1294,6 +1302,14 @@ void vtkDataSetSurfaceFilter::PrintSelf(ostream& os, vtkIndent indent)
 int vtkDataSetSurfaceFilter::UnstructuredGridExecute(vtkDataSet *dataSetInput,
                                                      vtkPolyData *output)
 {
+  vtkUnstructuredGrid *grid = vtkUnstructuredGrid::SafeDownCast(dataSetInput);
+  if (this->ParallelFaceExtraction && grid &&
+      vtkSMPTools::GetEstimatedNumberOfThreads() > 1 &&
+      this->ParallelUnstructuredGridExecute(grid, output))
+    {
+    return 1;
+    }
+
   vtkUnstructuredGridBase *input =
       vtkUnstructuredGridBase::SafeDownCast(dataSetInput);
 
@@ -2028,6 +2044,1037 @@ int vtkDataSetSurfaceFilter::UnstructuredGridExecute(vtkDataSet *dataSetInput,
   return 1;
 }
 
+//----------------------------------------------------------------------------
+// Helper classes for extracting the surface of unstructured grids in
+// parallel. The serial extraction inserts the faces of the 3D cells into a
+// hash indexed by the smallest point id of the face (QuadHash) and numbers
+// the output points in the order they are first used by the output cells.
+// Here the faces are generated in parallel and sorted into the same bins.
+// Each bin is processed independently in the order of insertion, with the
+// same matching rules as the hash. The output points are then numbered by
+// computing the first use of each point in the output connectivity.
+namespace
+{
+
+const vtkIdType SurfaceChunkSize = 1024;
+
+// The faces of the 3D cells in the order they are inserted into the hash
+// by the serial extraction, in vtkCellArray format.
+const int TetraFaces[] = { 3,0,1,3, 3,0,2,1, 3,0,3,2, 3,1,2,3 };
+const int VoxelFaces[] = { 4,0,1,5,4, 4,0,2,3,1, 4,0,4,6,2, 4,1,3,7,5,
+                           4,2,6,7,3, 4,4,5,7,6 };
+const int HexahedronFaces[] = { 4,0,1,5,4, 4,0,3,2,1, 4,0,4,7,3, 4,1,2,6,5,
+                                4,2,3,7,6, 4,4,5,6,7 };
+const int WedgeFaces[] = { 3,0,1,2, 3,3,5,4, 4,0,3,4,1, 4,1,4,5,2,
+                           4,2,5,3,0 };
+const int PyramidFaces[] = { 4,0,3,2,1, 3,0,1,4, 3,1,2,4, 3,2,3,4,
+                             3,3,0,4 };
+const int PentagonalPrismFaces[] = { 4,0,1,6,5, 4,1,2,7,6, 4,2,3,8,7,
+                                     4,3,4,9,8, 4,4,0,5,9, 5,0,1,2,3,4,
+                                     5,5,6,7,8,9 };
+const int HexagonalPrismFaces[] = { 4,0,1,7,6, 4,1,2,8,7, 4,2,3,9,8,
+                                    4,3,4,10,9, 4,4,5,11,10, 4,5,0,6,11,
+                                    6,0,1,2,3,4,5, 6,6,7,8,9,10,11 };
+
+struct FaceTable
+{
+  int NumberOfFaces;
+  int Size;
+  const int *Faces;
+};
+
+// Returns false if the cell type is not handled in parallel.
+bool GetFaceTable(int cellType, FaceTable &table)
+{
+  switch (cellType)
+    {
+    case VTK_TETRA:
+      table.NumberOfFaces = 4;
+      table.Size = sizeof(TetraFaces) / sizeof(int);
+      table.Faces = TetraFaces;
+      return true;
+    case VTK_VOXEL:
+      table.NumberOfFaces = 6;
+      table.Size = sizeof(VoxelFaces) / sizeof(int);
+      table.Faces = VoxelFaces;
+      return true;
+    case VTK_HEXAHEDRON:
+      table.NumberOfFaces = 6;
+      table.Size = sizeof(HexahedronFaces) / sizeof(int);
+      table.Faces = HexahedronFaces;
+      return true;
+    case VTK_WEDGE:
+      table.NumberOfFaces = 5;
+      table.Size = sizeof(WedgeFaces) / sizeof(int);
+      table.Faces = WedgeFaces;
+      return true;
+    case VTK_PYRAMID:
+      table.NumberOfFaces = 5;
+      table.Size = sizeof(PyramidFaces) / sizeof(int);
+      table.Faces = PyramidFaces;
+      return true;
+    case VTK_PENTAGONAL_PRISM:
+      table.NumberOfFaces = 7;
+      table.Size = sizeof(PentagonalPrismFaces) / sizeof(int);
+      table.Faces = PentagonalPrismFaces;
+      return true;
+    case VTK_HEXAGONAL_PRISM:
+      table.NumberOfFaces = 8;
+      table.Size = sizeof(HexagonalPrismFaces) / sizeof(int);
+      table.Faces = HexagonalPrismFaces;
+      return true;
+    }
+  return false;
+}
+
+// Rotate the points of a face like InsertQuadInHash(), InsertTriInHash()
+// and InsertPolygonInHash() do: the first smallest point comes first.
+// Triangles and quads are rotated only if their smallest point is unique.
+void OrderFace(vtkIdType *ids, int numPts)
+{
+  int first = 0;
+  for (int i = 1; i < numPts; i++)
+    {
+    if (ids[i] < ids[first])
+      {
+      first = i;
+      }
+    }
+  if (first == 0)
+    {
+    return;
+    }
+  if (numPts <= 4)
+    {
+    for (int i = first + 1; i < numPts; i++)
+      {
+      if (ids[i] == ids[first])
+        {
+        return;
+        }
+      }
+    }
+  std::rotate(ids, ids + first, ids + numPts);
+}
+
+// Whether the face (a) matches the face (b) previously inserted into the
+// same bin, with the rules of the serial hash.
+bool MatchFace(const vtkIdType *a, int numPts, const vtkIdType *b,
+               int numBPts)
+{
+  if (numPts != numBPts)
+    {
+    return false;
+    }
+  if (numPts == 4)
+    {
+    return a[2] == b[2] && ((a[1] == b[1] && a[3] == b[3]) ||
+                            (a[1] == b[3] && a[3] == b[1]));
+    }
+  if (numPts == 3)
+    {
+    return (a[1] == b[1] && a[2] == b[2]) || (a[1] == b[2] && a[2] == b[1]);
+    }
+  if (a[0] != b[0])
+    {
+    return false;
+    }
+  if (a[1] == b[1])
+    {
+    for (int i = 2; i < numPts; ++i)
+      {
+      if (a[i] != b[i])
+        {
+        return false;
+        }
+      }
+    return true;
+    }
+  for (int i = 1; i < numPts; ++i)
+    {
+    if (a[numPts - i] != b[i])
+      {
+      return false;
+      }
+    }
+  return true;
+}
+
+
+// A face is identified by the id of its cell and its index in the face
+// table of the cell.
+const int FaceBits = 3;
+const int MaxFacePoints = 6;
+
+// Get the points of the next face of a cell, rotated like
+// InsertQuadInHash(), InsertTriInHash() and InsertPolygonInHash() do. The
+// first point gives the bin of the face. Returns the number of points.
+int GetNextFace(const int *&face, const vtkIdType *pts, vtkIdType *ids)
+{
+  int numPts = *(face++);
+  for (int i = 0; i < numPts; ++i)
+    {
+    ids[i] = pts[*(face++)];
+    }
+  OrderFace(ids, numPts);
+  return numPts;
+}
+
+int GetFace(vtkUnstructuredGrid *input, vtkIdType faceId, vtkIdType *ids)
+{
+  vtkIdType npts, *pts;
+  FaceTable table;
+  vtkIdType cellId = faceId >> FaceBits;
+  GetFaceTable(input->GetCellType(cellId), table);
+  input->GetCellPoints(cellId, npts, pts);
+  const int *face = table.Faces;
+  for (int i = static_cast<int>(faceId & ((1 << FaceBits) - 1)); i > 0; --i)
+    {
+    face += *face + 1;
+    }
+  return GetNextFace(face, pts, ids);
+}
+
+// What a chunk of cells generates: the number of cells and the size of the
+// connectivity of the verts (0), lines (1) and polys (2). Once scanned, the
+// same structure holds the offsets of the chunk.
+struct SurfaceChunk
+{
+  vtkIdType Cells[3];
+  vtkIdType Size[3];
+};
+
+// Count what each chunk of cells generates. The extraction falls back to
+// the serial path if a cell is not handled.
+struct CountSurfaceCells
+{
+  vtkUnstructuredGrid *Input;
+  vtkIdType NumberOfCells;
+  SurfaceChunk *Chunks;
+  vtkAtomic<int> Unsupported;
+
+  void operator()(vtkIdType chunk, vtkIdType endChunk)
+    {
+    vtkIdType npts, *pts;
+    FaceTable table;
+    for ( ; chunk < endChunk; ++chunk )
+      {
+      SurfaceChunk &c = this->Chunks[chunk];
+      std::fill(c.Cells, c.Cells + 3, 0);
+      std::fill(c.Size, c.Size + 3, 0);
+      vtkIdType cellId = chunk * SurfaceChunkSize;
+      vtkIdType endCellId =
+        std::min(cellId + SurfaceChunkSize, this->NumberOfCells);
+      for ( ; cellId < endCellId; ++cellId )
+        {
+        int cellType = this->Input->GetCellType(cellId);
+        this->Input->GetCellPoints(cellId, npts, pts);
+        switch (cellType)
+          {
+          case VTK_VERTEX:
+          case VTK_POLY_VERTEX:
+            c.Cells[0]++;
+            c.Size[0] += npts + 1;
+            break;
+          case VTK_LINE:
+          case VTK_POLY_LINE:
+            c.Cells[1]++;
+            c.Size[1] += npts + 1;
+            break;
+          case VTK_PIXEL:
+          case VTK_TRIANGLE:
+          case VTK_QUAD:
+          case VTK_POLYGON:
+            c.Cells[2]++;
+            c.Size[2] += npts + 1;
+            break;
+          case VTK_TRIANGLE_STRIP:
+            // Shorter strips use points without generating cells.
+            if (npts < 3)
+              {
+              this->Unsupported = 1;
+              return;
+              }
+            c.Cells[2] += npts - 2;
+            c.Size[2] += 4 * (npts - 2);
+            break;
+          default:
+            if (!GetFaceTable(cellType, table))
+              {
+              this->Unsupported = 1;
+              return;
+              }
+          }
+        }
+      }
+    }
+};
+
+// Count the faces of the 3D cells falling into each bin. Once the counts
+// are scanned, the faces are placed in their bin from the back.
+struct BinSurfaceFaces
+{
+  vtkUnstructuredGrid *Input;
+  vtkAtomic<vtkIdType> *BinOffsets;
+  vtkIdType *BinFaces;
+
+  void operator()(vtkIdType cellId, vtkIdType endCellId)
+    {
+    vtkIdType npts, *pts, ids[MaxFacePoints];
+    FaceTable table;
+    for ( ; cellId < endCellId; ++cellId )
+      {
+      if (!GetFaceTable(this->Input->GetCellType(cellId), table))
+        {
+        continue;
+        }
+      this->Input->GetCellPoints(cellId, npts, pts);
+      const int *face = table.Faces;
+      for (int i = 0; i < table.NumberOfFaces; ++i)
+        {
+        GetNextFace(face, pts, ids);
+        if (this->BinFaces)
+          {
+          this->BinFaces[--this->BinOffsets[ids[0]]] =
+            (cellId << FaceBits) + i;
+          }
+        else
+          {
+          ++this->BinOffsets[ids[0]];
+          }
+        }
+      }
+    }
+};
+
+// Process the faces of each bin in the order of insertion, that is sorted
+// by id. A face is visible if no other face of the bin matches it. The
+// faces whose points are all duplicate points, or one of the points is
+// hidden, are visible (their points are used) but not extracted.
+struct MatchFaces
+{
+  vtkUnstructuredGrid *Input;
+  const vtkAtomic<vtkIdType> *BinOffsets;
+  const unsigned char *Ghosts;
+  vtkIdType *BinFaces;
+  unsigned char *Visible;
+
+  void operator()(vtkIdType bin, vtkIdType endBin)
+    {
+    // The points of the faces inserted in the bin (each preceded by their
+    // number) and their position in BinFaces.
+    std::vector<vtkIdType> entryPts;
+    std::vector<vtkIdType> entries;
+    vtkIdType ids[MaxFacePoints];
+    for ( ; bin < endBin; ++bin )
+      {
+      vtkIdType first = this->BinOffsets[bin].load();
+      vtkIdType last = this->BinOffsets[bin + 1].load();
+      if (first == last)
+        {
+        continue;
+        }
+      std::sort(this->BinFaces + first, this->BinFaces + last);
+      entryPts.clear();
+      entries.clear();
+      for (vtkIdType i = first; i < last; ++i)
+        {
+        int numPts = GetFace(this->Input, this->BinFaces[i], ids);
+        this->Visible[i] = 1;
+        for (size_t j = 0, loc = 0; j < entries.size();
+             loc += entryPts[loc] + 1, ++j)
+          {
+          if (MatchFace(ids, numPts, &entryPts[loc + 1],
+                        static_cast<int>(entryPts[loc])))
+            {
+            this->Visible[entries[j]] = 0;
+            this->Visible[i] = 0;
+            break;
+            }
+          }
+        if (this->Visible[i])
+          {
+          entries.push_back(i);
+          entryPts.push_back(numPts);
+          entryPts.insert(entryPts.end(), ids, ids + numPts);
+          }
+        }
+      if (!this->Ghosts)
+        {
+        continue;
+        }
+      for (size_t j = 0, loc = 0; j < entries.size();
+           loc += entryPts[loc] + 1, ++j)
+        {
+        if (this->Visible[entries[j]] && this->IsGhost(&entryPts[loc]))
+          {
+          this->Visible[entries[j]] = 2;
+          }
+        }
+      }
+    }
+
+  bool IsGhost(const vtkIdType *face)
+    {
+    bool allGhosts = true;
+    for (vtkIdType i = 1; i <= face[0]; ++i)
+      {
+      unsigned char val = this->Ghosts[face[i]];
+      if (!(val & vtkDataSetAttributes::DUPLICATEPOINT))
+        {
+        allGhosts = false;
+        }
+      if (val & vtkDataSetAttributes::HIDDENPOINT)
+        {
+        return true;
+        }
+      }
+    return allGhosts;
+    }
+};
+
+// The visible faces in the order of the bins. Visible counts all of them
+// and Kept the extracted ones; once scanned, they are offsets.
+struct FaceChunk
+{
+  vtkIdType Visible;
+  vtkIdType VisibleSize;
+  vtkIdType Kept;
+  vtkIdType KeptSize;
+};
+
+// Count the visible faces of each chunk of BinFaces, and once the counts
+// are scanned, copy them into a connectivity array of input point ids.
+struct GatherVisibleFaces
+{
+  vtkUnstructuredGrid *Input;
+  const vtkIdType *BinFaces;
+  const unsigned char *Visible;
+  vtkIdType NumberOfFaces;
+  FaceChunk *Chunks;
+  vtkIdType *VisibleConnectivity;
+
+  void operator()(vtkIdType chunk, vtkIdType endChunk)
+    {
+    vtkIdType ids[MaxFacePoints];
+    for ( ; chunk < endChunk; ++chunk )
+      {
+      FaceChunk &c = this->Chunks[chunk];
+      vtkIdType loc = c.VisibleSize;
+      if (!this->VisibleConnectivity)
+        {
+        c.Visible = c.VisibleSize = c.Kept = c.KeptSize = 0;
+        }
+      vtkIdType i = chunk * SurfaceChunkSize;
+      vtkIdType end = std::min(i + SurfaceChunkSize, this->NumberOfFaces);
+      for ( ; i < end; ++i )
+        {
+        if (!this->Visible[i])
+          {
+          continue;
+          }
+        int numPts = GetFace(this->Input, this->BinFaces[i], ids);
+        if (this->VisibleConnectivity)
+          {
+          this->VisibleConnectivity[loc++] = numPts;
+          std::copy(ids, ids + numPts, this->VisibleConnectivity + loc);
+          loc += numPts;
+          continue;
+          }
+        c.Visible++;
+        c.VisibleSize += numPts + 1;
+        if (this->Visible[i] == 1)
+          {
+          c.Kept++;
+          c.KeptSize += numPts + 1;
+          }
+        }
+      }
+    }
+};
+
+// Copy the verts, lines and polygons of the input in the output
+// connectivity arrays (with input point ids) and record their source cell.
+struct CopySurfaceCells
+{
+  vtkUnstructuredGrid *Input;
+  vtkIdType NumberOfCells;
+  const SurfaceChunk *Chunks;
+  vtkIdType *Connectivity[3];
+  vtkIdType *Sources[3];
+
+  void operator()(vtkIdType chunk, vtkIdType endChunk)
+    {
+    vtkIdType npts, *pts;
+    for ( ; chunk < endChunk; ++chunk )
+      {
+      vtkIdType cells[3], locs[3];
+      std::copy(this->Chunks[chunk].Cells, this->Chunks[chunk].Cells + 3,
+                cells);
+      std::copy(this->Chunks[chunk].Size, this->Chunks[chunk].Size + 3, locs);
+      vtkIdType cellId = chunk * SurfaceChunkSize;
+      vtkIdType endCellId =
+        std::min(cellId + SurfaceChunkSize, this->NumberOfCells);
+      for ( ; cellId < endCellId; ++cellId )
+        {
+        int cellType = this->Input->GetCellType(cellId);
+        int type;
+        switch (cellType)
+          {
+          case VTK_VERTEX:
+          case VTK_POLY_VERTEX:
+            type = 0;
+            break;
+          case VTK_LINE:
+          case VTK_POLY_LINE:
+            type = 1;
+            break;
+          case VTK_PIXEL:
+          case VTK_TRIANGLE:
+          case VTK_QUAD:
+          case VTK_POLYGON:
+          case VTK_TRIANGLE_STRIP:
+            type = 2;
+            break;
+          default:
+            continue;
+          }
+        this->Input->GetCellPoints(cellId, npts, pts);
+        vtkIdType *conn = this->Connectivity[type];
+        vtkIdType &loc = locs[type];
+        if (cellType == VTK_PIXEL)
+          {
+          conn[loc++] = 4;
+          conn[loc++] = pts[0];
+          conn[loc++] = pts[1];
+          conn[loc++] = pts[3];
+          conn[loc++] = pts[2];
+          this->Sources[type][cells[type]++] = cellId;
+          }
+        else if (cellType == VTK_TRIANGLE_STRIP)
+          {
+          // Change strips to triangles like the serial extraction.
+          int toggle = 0;
+          vtkIdType ptIds[3] = { pts[0], pts[1], 0 };
+          for (vtkIdType i = 2; i < npts; ++i)
+            {
+            ptIds[2] = pts[i];
+            conn[loc++] = 3;
+            conn[loc++] = ptIds[0];
+            conn[loc++] = ptIds[1];
+            conn[loc++] = ptIds[2];
+            this->Sources[type][cells[type]++] = cellId;
+            ptIds[toggle] = ptIds[2];
+            toggle = !toggle;
+            }
+          }
+        else
+          {
+          conn[loc++] = npts;
+          std::copy(pts, pts + npts, conn + loc);
+          loc += npts;
+          this->Sources[type][cells[type]++] = cellId;
+          }
+        }
+      }
+    }
+};
+
+// A range [Begin,End) of whole cells in a connectivity array. Position is
+// the position of the first entry of the array in the concatenated arrays.
+struct CellChunk
+{
+  vtkIdType *Conn;
+  vtkIdType Begin;
+  vtkIdType End;
+  vtkIdType Position;
+};
+
+// Compute the position of the first use of each point. There is no atomic
+// minimum, so concurrent updates of the same point may leave a larger
+// value behind. A second pass detects such values and, in the rare case
+// it finds some, a final serial pass fixes them. The result thus does not
+// depend on the scheduling.
+struct ComputeFirstUse
+{
+  const std::vector<CellChunk> &Chunks;
+  vtkAtomic<vtkIdType> *FirstUse;
+  vtkAtomic<vtkIdType> NumberOfChanges;
+
+  ComputeFirstUse(const std::vector<CellChunk> &chunks,
+                  vtkAtomic<vtkIdType> *firstUse)
+    : Chunks(chunks), FirstUse(firstUse), NumberOfChanges(0)
+    {
+    }
+
+  void operator()(vtkIdType chunkId, vtkIdType endChunkId)
+    {
+    vtkIdType numChanges = 0;
+    for ( ; chunkId < endChunkId; ++chunkId )
+      {
+      const CellChunk &chunk = this->Chunks[chunkId];
+      for ( vtkIdType loc = chunk.Begin; loc < chunk.End; )
+        {
+        vtkIdType npts = chunk.Conn[loc++];
+        for ( vtkIdType i = 0; i < npts; ++i, ++loc )
+          {
+          vtkIdType ptId = chunk.Conn[loc];
+          vtkIdType position = chunk.Position + loc;
+          if ( position < this->FirstUse[ptId].load() )
+            {
+            this->FirstUse[ptId].store(position);
+            ++numChanges;
+            }
+          }
+        }
+      }
+    this->NumberOfChanges += numChanges;
+    }
+};
+
+// The output points are numbered in the order of their first use. They are
+// counted per chunk of cells; once the counts are scanned into offsets,
+// the points of each chunk are numbered.
+struct NumberSurfacePoints
+{
+  const std::vector<CellChunk> &Chunks;
+  const vtkAtomic<vtkIdType> *FirstUse;
+  vtkIdType *ChunkOffsets;
+  vtkIdType *PointMap;
+  vtkIdType *OriginalIds;
+
+  NumberSurfacePoints(const std::vector<CellChunk> &chunks,
+                      const vtkAtomic<vtkIdType> *firstUse,
+                      vtkIdType *chunkOffsets)
+    : Chunks(chunks), FirstUse(firstUse), ChunkOffsets(chunkOffsets),
+      PointMap(NULL), OriginalIds(NULL)
+    {
+    }
+
+  void operator()(vtkIdType chunkId, vtkIdType endChunkId)
+    {
+    for ( ; chunkId < endChunkId; ++chunkId )
+      {
+      const CellChunk &chunk = this->Chunks[chunkId];
+      vtkIdType newId = this->PointMap ? this->ChunkOffsets[chunkId] : 0;
+      for ( vtkIdType loc = chunk.Begin; loc < chunk.End; )
+        {
+        vtkIdType npts = chunk.Conn[loc++];
+        for ( vtkIdType i = 0; i < npts; ++i, ++loc )
+          {
+          vtkIdType ptId = chunk.Conn[loc];
+          if ( this->FirstUse[ptId].load() == chunk.Position + loc )
+            {
+            if ( this->PointMap )
+              {
+              this->PointMap[ptId] = newId;
+              this->OriginalIds[newId] = ptId;
+              }
+            ++newId;
+            }
+          }
+        }
+      if ( !this->PointMap )
+        {
+        this->ChunkOffsets[chunkId] = newId;
+        }
+      }
+    }
+};
+
+// Replace the input point ids by the output point ids. The chunks of
+// visible faces are not renumbered in place: only the extracted faces are
+// copied at the end of the polys.
+struct MapSurfacePoints
+{
+  const std::vector<CellChunk> &Chunks;
+  const vtkIdType *PointMap;
+
+  MapSurfacePoints(const std::vector<CellChunk> &chunks,
+                   const vtkIdType *pointMap)
+    : Chunks(chunks), PointMap(pointMap)
+    {
+    }
+
+  void operator()(vtkIdType chunkId, vtkIdType endChunkId)
+    {
+    for ( ; chunkId < endChunkId; ++chunkId )
+      {
+      const CellChunk &chunk = this->Chunks[chunkId];
+      for ( vtkIdType loc = chunk.Begin; loc < chunk.End; )
+        {
+        vtkIdType npts = chunk.Conn[loc++];
+        for ( vtkIdType i = 0; i < npts; ++i, ++loc )
+          {
+          chunk.Conn[loc] = this->PointMap[chunk.Conn[loc]];
+          }
+        }
+      }
+    }
+};
+
+
+// Copy the extracted faces at the end of the polys with the output point
+// ids and record their source cell.
+struct CopyKeptFaces
+{
+  const vtkIdType *VisibleConnectivity;
+  const unsigned char *Visible;
+  const vtkIdType *BinFaces;
+  vtkIdType NumberOfFaces;
+  const FaceChunk *Chunks;
+  const vtkIdType *PointMap;
+  vtkIdType *Connectivity;
+  vtkIdType *Sources;
+
+  void operator()(vtkIdType chunk, vtkIdType endChunk)
+    {
+    for ( ; chunk < endChunk; ++chunk )
+      {
+      vtkIdType loc = this->Chunks[chunk].VisibleSize;
+      vtkIdType newLoc = this->Chunks[chunk].KeptSize;
+      vtkIdType newId = this->Chunks[chunk].Kept;
+      vtkIdType i = chunk * SurfaceChunkSize;
+      vtkIdType end = std::min(i + SurfaceChunkSize, this->NumberOfFaces);
+      for ( ; i < end; ++i )
+        {
+        if (!this->Visible[i])
+          {
+          continue;
+          }
+        vtkIdType npts = this->VisibleConnectivity[loc];
+        if (this->Visible[i] == 1)
+          {
+          this->Connectivity[newLoc++] = npts;
+          for (vtkIdType j = 1; j <= npts; ++j)
+            {
+            this->Connectivity[newLoc++] =
+              this->PointMap[this->VisibleConnectivity[loc + j]];
+            }
+          this->Sources[newId++] = this->BinFaces[i] >> FaceBits;
+          }
+        loc += npts + 1;
+        }
+      }
+    }
+};
+
+// Copy the points and the point data.
+struct CopySurfacePoints
+{
+  vtkPoints *InPoints;
+  vtkPoints *OutPoints;
+  const vtkIdType *OriginalIds;
+  ArrayList *Arrays;
+
+  void operator()(vtkIdType ptId, vtkIdType endPtId)
+    {
+    double x[3];
+    for ( ; ptId < endPtId; ++ptId )
+      {
+      this->InPoints->GetPoint(this->OriginalIds[ptId], x);
+      this->OutPoints->SetPoint(ptId, x);
+      if ( this->Arrays )
+        {
+        this->Arrays->Copy(this->OriginalIds[ptId], ptId);
+        }
+      }
+    }
+};
+
+// Copy the cell data from the source cells.
+struct CopySurfaceCellData
+{
+  const vtkIdType *Sources;
+  ArrayList *Arrays;
+
+  void operator()(vtkIdType cellId, vtkIdType endCellId)
+    {
+    for ( ; cellId < endCellId; ++cellId )
+      {
+      this->Arrays->Copy(this->Sources[cellId], cellId);
+      }
+    }
+};
+
+// Set up the parallel copy of the attributes. Arrays that cannot be copied
+// in parallel (e.g. string arrays) require the serial CopyData().
+bool AddSurfaceArrays(ArrayList &arrays, vtkIdType num,
+                      vtkDataSetAttributes *in, vtkDataSetAttributes *out)
+{
+  out->CopyGlobalIdsOn();
+  out->CopyAllocate(in, num);
+  arrays.AddArrays(num, in, out, 0.0, false);
+  return static_cast<int>(arrays.Arrays.size()) == out->GetNumberOfArrays();
+}
+
+vtkCellArray *NewCellArray(vtkIdType numCells, vtkIdTypeArray *conn)
+{
+  vtkCellArray *cells = vtkCellArray::New();
+  cells->SetCells(numCells, conn);
+  conn->Delete();
+  return cells;
+}
+
+} // end anon namespace
+//----------------------------------------------------------------------------
+int vtkDataSetSurfaceFilter::ParallelUnstructuredGridExecute(
+  vtkUnstructuredGrid *input, vtkPolyData *output)
+{
+  vtkIdType numPts = input->GetNumberOfPoints();
+  vtkIdType numCells = input->GetNumberOfCells();
+  vtkIdType numChunks = (numCells + SurfaceChunkSize - 1) / SurfaceChunkSize;
+  if (numPts < 1 || numCells < 1 || numCells > (VTK_ID_MAX >> FaceBits))
+    {
+    return 0;
+    }
+
+  // Count the verts, lines and polygons generated by each chunk of cells.
+  std::vector<SurfaceChunk> chunks(numChunks + 1);
+  CountSurfaceCells count;
+  count.Input = input;
+  count.NumberOfCells = numCells;
+  count.Chunks = &chunks[0];
+  count.Unsupported = 0;
+  vtkSMPTools::For(0, numChunks, count);
+  if (count.Unsupported.load())
+    {
+    return 0;
+    }
+  SurfaceChunk total = {{0, 0, 0}, {0, 0, 0}};
+  for (vtkIdType chunk = 0; chunk < numChunks; ++chunk)
+    {
+    SurfaceChunk c = chunks[chunk];
+    chunks[chunk] = total;
+    for (int i = 0; i < 3; ++i)
+      {
+      total.Cells[i] += c.Cells[i];
+      total.Size[i] += c.Size[i];
+      }
+    }
+  chunks[numChunks] = total;
+
+  // Sort the faces of the 3D cells into the bins of the hash and find the
+  // visible ones.
+  vtkAtomic<vtkIdType> *binOffsets = new vtkAtomic<vtkIdType>[numPts + 1];
+  vtkSMPTools::Fill(binOffsets, binOffsets + numPts + 1,
+                    static_cast<vtkIdType>(0));
+  BinSurfaceFaces bin = {input, binOffsets, NULL};
+  vtkSMPTools::For(0, numCells, bin);
+  vtkIdType numFaces = vtkSMPTools::InclusiveScan(
+    binOffsets, binOffsets + numPts, binOffsets, static_cast<vtkIdType>(0));
+  binOffsets[numPts] = numFaces;
+  vtkIdType *binFaces = new vtkIdType[numFaces];
+  bin.BinFaces = binFaces;
+  vtkSMPTools::For(0, numCells, bin);
+
+  unsigned char *visible = new unsigned char[numFaces];
+  vtkUnsignedCharArray *ghosts = input->GetPointGhostArray();
+  MatchFaces match = {input, binOffsets,
+                      ghosts ? ghosts->GetPointer(0) : NULL,
+                      binFaces, visible};
+  vtkSMPTools::For(0, numPts, match);
+  delete [] binOffsets;
+  this->UpdateProgress(0.5);
+
+  // Gather the visible faces in the order of the bins.
+  vtkIdType numFaceChunks =
+    (numFaces + SurfaceChunkSize - 1) / SurfaceChunkSize;
+  std::vector<FaceChunk> faceChunks(numFaceChunks + 1);
+  GatherVisibleFaces gather = {input, binFaces, visible, numFaces,
+                               &faceChunks[0], NULL};
+  vtkSMPTools::For(0, numFaceChunks, gather);
+  FaceChunk faceTotal = {0, 0, 0, 0};
+  for (vtkIdType chunk = 0; chunk < numFaceChunks; ++chunk)
+    {
+    FaceChunk c = faceChunks[chunk];
+    faceChunks[chunk] = faceTotal;
+    faceTotal.Visible += c.Visible;
+    faceTotal.VisibleSize += c.VisibleSize;
+    faceTotal.Kept += c.Kept;
+    faceTotal.KeptSize += c.KeptSize;
+    }
+  faceChunks[numFaceChunks] = faceTotal;
+  vtkIdType *visibleConn = new vtkIdType[faceTotal.VisibleSize];
+  gather.VisibleConnectivity = visibleConn;
+  vtkSMPTools::For(0, numFaceChunks, gather);
+
+  // Copy the verts, lines and polygons.
+  vtkIdType numNewCells =
+    total.Cells[0] + total.Cells[1] + total.Cells[2] + faceTotal.Kept;
+  vtkIdTypeArray *sources = vtkIdTypeArray::New();
+  sources->SetName(this->GetOriginalCellIdsName());
+  sources->SetNumberOfValues(numNewCells);
+  vtkIdTypeArray *conn[3];
+  for (int i = 0; i < 3; ++i)
+    {
+    conn[i] = vtkIdTypeArray::New();
+    conn[i]->SetNumberOfValues(
+      total.Size[i] + (i == 2 ? faceTotal.KeptSize : 0));
+    }
+  CopySurfaceCells copyCells;
+  copyCells.Input = input;
+  copyCells.NumberOfCells = numCells;
+  copyCells.Chunks = &chunks[0];
+  for (int i = 0; i < 3; ++i)
+    {
+    copyCells.Connectivity[i] = conn[i]->GetPointer(0);
+    }
+  copyCells.Sources[0] = sources->GetPointer(0);
+  copyCells.Sources[1] = copyCells.Sources[0] + total.Cells[0];
+  copyCells.Sources[2] = copyCells.Sources[1] + total.Cells[1];
+  vtkSMPTools::For(0, numChunks, copyCells);
+
+  // Number the output points in the order of their first use: the verts,
+  // the lines, the polygons and the visible faces.
+  std::vector<CellChunk> useChunks;
+  vtkIdType position = 0;
+  for (int i = 0; i < 4; ++i)
+    {
+    vtkIdType n = (i < 3 ? numChunks : numFaceChunks);
+    for (vtkIdType chunk = 0; chunk < n; ++chunk)
+      {
+      CellChunk c;
+      if (i < 3)
+        {
+        c.Conn = conn[i]->GetPointer(0);
+        c.Begin = chunks[chunk].Size[i];
+        c.End = chunks[chunk + 1].Size[i];
+        }
+      else
+        {
+        c.Conn = visibleConn;
+        c.Begin = faceChunks[chunk].VisibleSize;
+        c.End = faceChunks[chunk + 1].VisibleSize;
+        }
+      c.Position = position;
+      if (c.End > c.Begin)
+        {
+        useChunks.push_back(c);
+        }
+      }
+    position += (i < 3 ? total.Size[i] : faceTotal.VisibleSize);
+    }
+  vtkIdType numUseChunks = static_cast<vtkIdType>(useChunks.size());
+
+  vtkAtomic<vtkIdType> *firstUse = new vtkAtomic<vtkIdType>[numPts];
+  vtkSMPTools::Fill(firstUse, firstUse + numPts, position);
+  ComputeFirstUse computeFirstUse(useChunks, firstUse);
+  vtkSMPTools::For(0, numUseChunks, 1, computeFirstUse);
+  computeFirstUse.NumberOfChanges = 0;
+  vtkSMPTools::For(0, numUseChunks, 1, computeFirstUse);
+  if (computeFirstUse.NumberOfChanges.load() > 0)
+    {
+    computeFirstUse(0, numUseChunks);
+    }
+
+  vtkIdType *chunkOffsets = new vtkIdType[numUseChunks + 1];
+  NumberSurfacePoints number(useChunks, firstUse, chunkOffsets);
+  vtkSMPTools::For(0, numUseChunks, 1, number);
+  vtkIdType numNewPts = vtkSMPTools::ExclusiveScan(
+    chunkOffsets, chunkOffsets + numUseChunks, chunkOffsets,
+    static_cast<vtkIdType>(0));
+  vtkIdType *pointMap = new vtkIdType[numPts];
+  vtkIdTypeArray *originalPointIds = vtkIdTypeArray::New();
+  originalPointIds->SetName(this->GetOriginalPointIdsName());
+  originalPointIds->SetNumberOfValues(numNewPts);
+  number.PointMap = pointMap;
+  number.OriginalIds = originalPointIds->GetPointer(0);
+  vtkSMPTools::For(0, numUseChunks, 1, number);
+  delete [] chunkOffsets;
+  delete [] firstUse;
+
+  // Renumber the cells and append the extracted faces to the polys. The
+  // chunks of the visible faces come last.
+  vtkIdType numCellUseChunks = numUseChunks;
+  while (numCellUseChunks > 0 &&
+         useChunks[numCellUseChunks - 1].Conn == visibleConn)
+    {
+    --numCellUseChunks;
+    }
+  MapSurfacePoints map(useChunks, pointMap);
+  vtkSMPTools::For(0, numCellUseChunks, 1, map);
+  CopyKeptFaces copyFaces = {visibleConn, visible, binFaces, numFaces,
+                             &faceChunks[0], pointMap,
+                             conn[2]->GetPointer(total.Size[2]),
+                             copyCells.Sources[2] + total.Cells[2]};
+  vtkSMPTools::For(0, numFaceChunks, copyFaces);
+  delete [] pointMap;
+  delete [] visibleConn;
+  delete [] visible;
+  delete [] binFaces;
+  this->UpdateProgress(0.75);
+
+  // Points and point data
+  vtkPointData *inPD = input->GetPointData();
+  vtkPointData *outPD = output->GetPointData();
+  vtkPoints *newPts = vtkPoints::New(input->GetPoints()->GetDataType());
+  newPts->SetNumberOfPoints(numNewPts);
+  ArrayList pointArrays;
+  bool parallelPD = AddSurfaceArrays(pointArrays, numNewPts, inPD, outPD);
+  CopySurfacePoints copyPoints = {input->GetPoints(), newPts,
+                                  originalPointIds->GetPointer(0),
+                                  parallelPD ? &pointArrays : NULL};
+  vtkSMPTools::For(0, numNewPts, copyPoints);
+  if (!parallelPD)
+    {
+    for (vtkIdType ptId = 0; ptId < numNewPts; ++ptId)
+      {
+      outPD->CopyData(inPD, originalPointIds->GetValue(ptId), ptId);
+      }
+    }
+  if (this->PassThroughPointIds)
+    {
+    outPD->AddArray(originalPointIds);
+    }
+  originalPointIds->Delete();
+
+  // Cell data
+  vtkCellData *inCD = input->GetCellData();
+  vtkCellData *outCD = output->GetCellData();
+  ArrayList cellArrays;
+  if (AddSurfaceArrays(cellArrays, numNewCells, inCD, outCD))
+    {
+    CopySurfaceCellData copyCD = {sources->GetPointer(0), &cellArrays};
+    vtkSMPTools::For(0, numNewCells, copyCD);
+    }
+  else
+    {
+    for (vtkIdType cellId = 0; cellId < numNewCells; ++cellId)
+      {
+      outCD->CopyData(inCD, sources->GetValue(cellId), cellId);
+      }
+    }
+  if (this->PassThroughCellIds)
+    {
+    outCD->AddArray(sources);
+    }
+  sources->Delete();
+
+  output->GetFieldData()->ShallowCopy(input->GetFieldData());
+  output->SetPoints(newPts);
+  newPts->Delete();
+  vtkCellArray *newVerts = NewCellArray(total.Cells[0], conn[0]);
+  vtkCellArray *newLines = NewCellArray(total.Cells[1], conn[1]);
+  vtkCellArray *newPolys =
+    NewCellArray(total.Cells[2] + faceTotal.Kept, conn[2]);
+  if (newVerts->GetNumberOfCells() > 0)
+    {
+    output->SetVerts(newVerts);
+    }
+  if (newLines->GetNumberOfCells() > 0)
+    {
+    output->SetLines(newLines);
+    }
+  output->SetPolys(newPolys);
+  newVerts->Delete();
+  newLines->Delete();
+  newPolys->Delete();
+  this->NumberOfNewCells = numNewCells;
+
+  return 1;
+}
+
 //----------------------------------------------------------------------------
 void vtkDataSetSurfaceFilter::InitializeQuadHash(vtkIdType numPoints)
 {
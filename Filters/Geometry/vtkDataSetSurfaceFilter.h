@@ -18,6 +18,10 @@
 // does not have an option to select bounds.  It may use more memory than
 // vtkGeometryFilter.  It only has one option: whether to use triangle strips
 // when the input type is structured.
+//
+// The external faces of unstructured grids made of linear cells can be
+// extracted in parallel with vtkSMPTools (see ParallelFaceExtraction). The
+// output is identical to the serial extraction.
 
 // .SECTION See Also
 // vtkGeometryFilter vtkStructuredGridGeometryFilter.
@@ -32,6 +36,7 @@
 class vtkPointData;
 class vtkPoints;
 class vtkIdTypeArray;
+class vtkUnstructuredGrid;
 
 // Helper structure for hashing faces.
 struct vtkFastGeomQuadStruct
@@ -110,6 +115,22 @@ public:
   vtkSetMacro(NonlinearSubdivisionLevel, int);
   vtkGetMacro(NonlinearSubdivisionLevel, int);
 
+  // Description:
+  // If on, the surface of a vtkUnstructuredGrid is extracted in parallel
+  // when all its cells are vertices, lines, polygons, triangle strips or
+  // linear 3D cells other than polyhedra and convex point sets. The faces
+  // are sorted into the same bins as in the serial hash (the smallest point
+  // id of the face) and the bins are processed independently, so that the
+  // output does not depend on this setting. The binning costs more than the
+  // serial hash, so the parallel path is only taken when vtkSMPTools runs
+  // more than one thread. Other inputs are always processed serially. The
+  // hash methods (InsertQuadInHash() ...) are not invoked in parallel, so
+  // subclasses overriding them must leave this off. By default, parallel
+  // face extraction is off.
+  vtkSetMacro(ParallelFaceExtraction, int);
+  vtkGetMacro(ParallelFaceExtraction, int);
+  vtkBooleanMacro(ParallelFaceExtraction, int);
+
   // Description:
   // Direct access methods that can be used to use the this class as an
   // algorithm without using it as a filter.
@@ -243,6 +264,14 @@ protected:
 
   int NonlinearSubdivisionLevel;
 
+  int ParallelFaceExtraction;
+
+  // Extract the surface of an unstructured grid with vtkSMPTools. Returns 0,
+  // leaving the output untouched, if the grid has cells that are not
+  // handled in parallel.
+  int ParallelUnstructuredGridExecute(vtkUnstructuredGrid *input,
+                                      vtkPolyData *output);
+
 private:
   vtkDataSetSurfaceFilter(const vtkDataSetSurfaceFilter&) VTK_DELETE_FUNCTION;
   void operator=(const vtkDataSetSurfaceFilter&) VTK_DELETE_FUNCTION;
@@ -0,0 +1,296 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    TestSMPCutAndClip.cxx
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+// Compares vtkSMPCutter and vtkSMPClipDataSet with their serial
+// superclasses. The cells are compared independently of their order. The
+// cut and clip values avoid the points of the grid, where the merging of
+// coincident points depends on the binning of the locators.
+
+#include "vtkCellData.h"
+#include "vtkClipDataSet.h"
+#include "vtkCutter.h"
+#include "vtkDataSet.h"
+#include "vtkFloatArray.h"
+#include "vtkIdList.h"
+#include "vtkIntArray.h"
+#include "vtkNew.h"
+#include "vtkPlane.h"
+#include "vtkPointData.h"
+#include "vtkPointLocator.h"
+#include "vtkPoints.h"
+#include "vtkSMPClipDataSet.h"
+#include "vtkSMPCutter.h"
+#include "vtkSMPTools.h"
+#include "vtkSphere.h"
+#include "vtkUnstructuredGrid.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace
+{
+
+const int Resolution = 10;
+
+vtkIdType PointId(int i, int j, int k)
+{
+  return i + (Resolution + 1) * (j + (Resolution + 1) * k);
+}
+
+// A grid of hexahedra and tetrahedra, with quads on one face and lines on
+// one edge so that cutting generates verts, lines and polys. With
+// polyhedra, the hexahedra are replaced by polyhedra of the same shape.
+void MakeGrid(vtkUnstructuredGrid *grid, bool polyhedra)
+{
+  vtkNew<vtkPoints> points;
+  vtkNew<vtkFloatArray> scalars;
+  scalars->SetName("Scalars");
+  for (int k = 0; k <= Resolution; k++)
+    {
+    for (int j = 0; j <= Resolution; j++)
+      {
+      for (int i = 0; i <= Resolution; i++)
+        {
+        double x[3] = { static_cast<double>(i) / Resolution,
+                        static_cast<double>(j) / Resolution,
+                        static_cast<double>(k) / Resolution };
+        points->InsertNextPoint(x);
+        scalars->InsertNextValue(x[0] * x[0] + x[1] - x[2]);
+        }
+      }
+    }
+  grid->SetPoints(points.GetPointer());
+  grid->GetPointData()->SetScalars(scalars.GetPointer());
+
+  grid->Allocate(Resolution * Resolution * Resolution);
+  for (int i = 0; i < Resolution; i++)
+    {
+    vtkIdType line[2] = { PointId(i, 0, 0), PointId(i + 1, 0, 0) };
+    grid->InsertNextCell(VTK_LINE, 2, line);
+    }
+  for (int k = 0; k < Resolution; k++)
+    {
+    for (int j = 0; j < Resolution; j++)
+      {
+      for (int i = 0; i < Resolution; i++)
+        {
+        vtkIdType hex[8] = {
+          PointId(i, j, k), PointId(i + 1, j, k),
+          PointId(i + 1, j + 1, k), PointId(i, j + 1, k),
+          PointId(i, j, k + 1), PointId(i + 1, j, k + 1),
+          PointId(i + 1, j + 1, k + 1), PointId(i, j + 1, k + 1) };
+        if ((i + j + k) % 3 == 0)
+          {
+          grid->InsertNextCell(VTK_TETRA, 4, hex);
+          }
+        else if (polyhedra)
+          {
+          vtkIdType faces[30] = {
+            4, hex[0], hex[3], hex[2], hex[1],
+            4, hex[4], hex[5], hex[6], hex[7],
+            4, hex[0], hex[1], hex[5], hex[4],
+            4, hex[1], hex[2], hex[6], hex[5],
+            4, hex[2], hex[3], hex[7], hex[6],
+            4, hex[3], hex[0], hex[4], hex[7] };
+          grid->InsertNextCell(VTK_POLYHEDRON, 8, hex, 6, faces);
+          }
+        else
+          {
+          grid->InsertNextCell(VTK_HEXAHEDRON, 8, hex);
+          }
+        if (k == 0)
+          {
+          grid->InsertNextCell(VTK_QUAD, 4, hex);
+          }
+        }
+      }
+    }
+
+  vtkNew<vtkIntArray> cellIds;
+  cellIds->SetName("CellIds");
+  for (vtkIdType i = 0; i < grid->GetNumberOfCells(); i++)
+    {
+    cellIds->InsertNextValue(static_cast<int>(i));
+    }
+  grid->GetCellData()->AddArray(cellIds.GetPointer());
+}
+
+// Each cell is described by its type, the coordinates and the point data
+// of its points, and its cell data.
+void GetCells(vtkDataSet *ds, std::vector<std::vector<double> > &cells)
+{
+  vtkPointData *pd = ds->GetPointData();
+  vtkCellData *cd = ds->GetCellData();
+  vtkNew<vtkIdList> ptIds;
+  cells.resize(ds->GetNumberOfCells());
+  for (vtkIdType cellId = 0; cellId < ds->GetNumberOfCells(); cellId++)
+    {
+    std::vector<double> &cell = cells[cellId];
+    cell.push_back(ds->GetCellType(cellId));
+    ds->GetCellPoints(cellId, ptIds.GetPointer());
+    for (vtkIdType i = 0; i < ptIds->GetNumberOfIds(); i++)
+      {
+      double x[3];
+      ds->GetPoint(ptIds->GetId(i), x);
+      cell.insert(cell.end(), x, x + 3);
+      for (int a = 0; a < pd->GetNumberOfArrays(); a++)
+        {
+        vtkDataArray *array = pd->GetArray(a);
+        for (int c = 0; c < array->GetNumberOfComponents(); c++)
+          {
+          cell.push_back(array->GetComponent(ptIds->GetId(i), c));
+          }
+        }
+      }
+    for (int a = 0; a < cd->GetNumberOfArrays(); a++)
+      {
+      cell.push_back(cd->GetArray(a)->GetComponent(cellId, 0));
+      }
+    }
+  std::sort(cells.begin(), cells.end());
+}
+
+bool Compare(vtkDataSet *expected, vtkDataSet *result, const char *name)
+{
+  if (expected->GetNumberOfPoints() != result->GetNumberOfPoints() ||
+      expected->GetNumberOfCells() != result->GetNumberOfCells() ||
+      expected->GetPointData()->GetNumberOfArrays() !=
+      result->GetPointData()->GetNumberOfArrays() ||
+      expected->GetCellData()->GetNumberOfArrays() !=
+      result->GetCellData()->GetNumberOfArrays())
+    {
+    cerr << name << ": expected " << expected->GetNumberOfPoints()
+         << " points and " << expected->GetNumberOfCells() << " cells, got "
+         << result->GetNumberOfPoints() << " points and "
+         << result->GetNumberOfCells() << " cells" << endl;
+    return false;
+    }
+  if (expected->GetNumberOfCells() == 0)
+    {
+    cerr << name << ": empty output" << endl;
+    return false;
+    }
+  std::vector<std::vector<double> > expectedCells, resultCells;
+  GetCells(expected, expectedCells);
+  GetCells(result, resultCells);
+  if (expectedCells != resultCells)
+    {
+    cerr << name << ": different cells" << endl;
+    return false;
+    }
+  return true;
+}
+
+bool TestCutter(vtkUnstructuredGrid *grid)
+{
+  vtkNew<vtkPlane> plane;
+  plane->SetOrigin(0.52, 0.47, 0.5);
+  plane->SetNormal(1.0, 0.3, 0.2);
+  vtkNew<vtkSphere> sphere;
+  sphere->SetCenter(0.13, 0.21, 0.34);
+  sphere->SetRadius(0.61);
+
+  vtkNew<vtkCutter> cutter;
+  vtkNew<vtkSMPCutter> smpCutter;
+  vtkCutter *cutters[2] = { cutter.GetPointer(), smpCutter.GetPointer() };
+  for (int test = 0; test < 5; test++)
+    {
+    for (int i = 0; i < 2; i++)
+      {
+      cutters[i]->SetInputData(grid);
+      if (test % 2 == 0)
+        {
+        cutters[i]->SetCutFunction(plane.GetPointer());
+        }
+      else
+        {
+        cutters[i]->SetCutFunction(sphere.GetPointer());
+        }
+      cutters[i]->SetValue(0, 0.0);
+      cutters[i]->SetValue(1, 0.113);
+      cutters[i]->SetGenerateCutScalars(test < 2);
+      if (test == 4)
+        {
+        // Used by the superclass.
+        vtkNew<vtkPointLocator> locator;
+        cutters[i]->SetLocator(locator.GetPointer());
+        }
+      cutters[i]->Update();
+      }
+    if (!Compare(cutter->GetOutput(), smpCutter->GetOutput(), "vtkSMPCutter"))
+      {
+      return false;
+      }
+    }
+  return true;
+}
+
+bool TestClip(vtkUnstructuredGrid *grid)
+{
+  vtkNew<vtkPlane> plane;
+  plane->SetOrigin(0.52, 0.47, 0.5);
+  plane->SetNormal(1.0, 0.3, 0.2);
+
+  vtkNew<vtkClipDataSet> clip;
+  vtkNew<vtkSMPClipDataSet> smpClip;
+  vtkClipDataSet *clips[2] = { clip.GetPointer(), smpClip.GetPointer() };
+  for (int test = 0; test < 3; test++)
+    {
+    for (int i = 0; i < 2; i++)
+      {
+      clips[i]->SetInputData(grid);
+      clips[i]->SetClipFunction(test < 2 ? plane.GetPointer() : NULL);
+      clips[i]->SetGenerateClipScalars(test == 0);
+      clips[i]->SetGenerateClippedOutput(test != 1);
+      clips[i]->SetInsideOut(test == 1);
+      clips[i]->SetValue(0.2513);
+      clips[i]->Update();
+      }
+    if (!Compare(clip->GetOutput(), smpClip->GetOutput(),
+                 "vtkSMPClipDataSet") ||
+        (test != 1 && !Compare(clip->GetClippedOutput(),
+                               smpClip->GetClippedOutput(),
+                               "vtkSMPClipDataSet clipped output")))
+      {
+      return false;
+      }
+    }
+  return true;
+}
+
+}
+
+int TestSMPCutAndClip(int, char *[])
+{
+  vtkSMPTools::Initialize(4);
+
+  vtkNew<vtkUnstructuredGrid> grid;
+  MakeGrid(grid.GetPointer(), false);
+
+  if (!TestCutter(grid.GetPointer()) || !TestClip(grid.GetPointer()))
+    {
+    return EXIT_FAILURE;
+    }
+
+  // Grids with polyhedra are cut by the superclass.
+  vtkNew<vtkUnstructuredGrid> polyhedra;
+  MakeGrid(polyhedra.GetPointer(), true);
+
+  if (!TestCutter(polyhedra.GetPointer()))
+    {
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
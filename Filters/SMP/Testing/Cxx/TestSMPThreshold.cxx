@@ -0,0 +1,320 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    TestSMPThreshold.cxx
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+
+#include "vtkCellArray.h"
+#include "vtkCellData.h"
+#include "vtkDoubleArray.h"
+#include "vtkFloatArray.h"
+#include "vtkIdList.h"
+#include "vtkIntArray.h"
+#include "vtkMath.h"
+#include "vtkNew.h"
+#include "vtkPointData.h"
+#include "vtkPoints.h"
+#include "vtkPolyData.h"
+#include "vtkSMPThreshold.h"
+#include "vtkSMPTools.h"
+#include "vtkThreshold.h"
+#include "vtkUnstructuredGrid.h"
+
+namespace
+{
+
+const int Resolution = 12;
+
+void AddAttributes(vtkDataSet *ds)
+{
+  vtkIdType numPts = ds->GetNumberOfPoints();
+  vtkIdType numCells = ds->GetNumberOfCells();
+
+  vtkNew<vtkFloatArray> pointScalars;
+  pointScalars->SetName("PointScalars");
+  pointScalars->SetNumberOfComponents(3);
+  pointScalars->SetNumberOfTuples(numPts);
+  vtkNew<vtkIntArray> pointIds;
+  pointIds->SetName("PointIds");
+  pointIds->SetNumberOfTuples(numPts);
+  for (vtkIdType i = 0; i < numPts; i++)
+    {
+    double x[3];
+    ds->GetPoint(i, x);
+    pointScalars->SetTuple3(i, x[0] + x[1], x[1] - x[2],
+                            vtkMath::Random(-1.0, 1.0));
+    pointIds->SetValue(i, static_cast<int>(i));
+    }
+  ds->GetPointData()->AddArray(pointScalars.GetPointer());
+  ds->GetPointData()->AddArray(pointIds.GetPointer());
+
+  vtkNew<vtkDoubleArray> cellScalars;
+  cellScalars->SetName("CellScalars");
+  cellScalars->SetNumberOfComponents(2);
+  cellScalars->SetNumberOfTuples(numCells);
+  for (vtkIdType i = 0; i < numCells; i++)
+    {
+    cellScalars->SetTuple2(i, vtkMath::Random(-1.0, 1.0),
+                           vtkMath::Random(-1.0, 1.0));
+    }
+  ds->GetCellData()->AddArray(cellScalars.GetPointer());
+}
+
+vtkPoints *MakePoints()
+{
+  vtkPoints *points = vtkPoints::New();
+  for (int k = 0; k <= Resolution; k++)
+    {
+    for (int j = 0; j <= Resolution; j++)
+      {
+      for (int i = 0; i <= Resolution; i++)
+        {
+        points->InsertNextPoint(static_cast<double>(i) / Resolution,
+                                static_cast<double>(j) / Resolution,
+                                static_cast<double>(k) / Resolution);
+        }
+      }
+    }
+  return points;
+}
+
+vtkIdType PointId(int i, int j, int k)
+{
+  return i + (Resolution + 1) * (j + (Resolution + 1) * k);
+}
+
+void MakeGrid(vtkUnstructuredGrid *grid)
+{
+  vtkPoints *points = MakePoints();
+  grid->SetPoints(points);
+  points->Delete();
+  grid->Allocate(Resolution * Resolution * Resolution);
+  for (int k = 0; k < Resolution; k++)
+    {
+    for (int j = 0; j < Resolution; j++)
+      {
+      for (int i = 0; i < Resolution; i++)
+        {
+        vtkIdType hex[8] = {
+          PointId(i, j, k), PointId(i + 1, j, k),
+          PointId(i + 1, j + 1, k), PointId(i, j + 1, k),
+          PointId(i, j, k + 1), PointId(i + 1, j, k + 1),
+          PointId(i + 1, j + 1, k + 1), PointId(i, j + 1, k + 1) };
+        if ((i + j + k) % 7 == 0)
+          {
+          grid->InsertNextCell(VTK_TETRA, 4, hex);
+          }
+        else
+          {
+          grid->InsertNextCell(VTK_HEXAHEDRON, 8, hex);
+          }
+        }
+      }
+    }
+  AddAttributes(grid);
+}
+
+void MakePolyData(vtkPolyData *polyData)
+{
+  vtkPoints *points = MakePoints();
+  polyData->SetPoints(points);
+  points->Delete();
+  vtkNew<vtkCellArray> verts;
+  vtkNew<vtkCellArray> lines;
+  vtkNew<vtkCellArray> polys;
+  for (int k = 0; k < Resolution; k++)
+    {
+    for (int j = 0; j < Resolution; j++)
+      {
+      for (int i = 0; i < Resolution; i++)
+        {
+        vtkIdType tri[3] = {
+          PointId(i, j, k), PointId(i + 1, j, k), PointId(i, j + 1, k + 1) };
+        polys->InsertNextCell(3, tri);
+        if (i == j)
+          {
+          verts->InsertNextCell(1, tri);
+          lines->InsertNextCell(2, tri + 1);
+          }
+        }
+      }
+    }
+  polyData->SetVerts(verts.GetPointer());
+  polyData->SetLines(lines.GetPointer());
+  polyData->SetPolys(polys.GetPointer());
+  AddAttributes(polyData);
+}
+
+bool CompareTuples(vtkDataArray *a, vtkIdType i, vtkDataArray *b, vtkIdType j)
+{
+  for (int c = 0; c < a->GetNumberOfComponents(); c++)
+    {
+    if (a->GetComponent(i, c) != b->GetComponent(j, c))
+      {
+      return false;
+      }
+    }
+  return true;
+}
+
+// The cells must be the same and in the same order. The points may be in a
+// different order.
+bool CompareOutputs(vtkUnstructuredGrid *expected, vtkUnstructuredGrid *result)
+{
+  if (expected->GetNumberOfCells() != result->GetNumberOfCells() ||
+      expected->GetNumberOfPoints() != result->GetNumberOfPoints() ||
+      expected->GetPoints()->GetDataType() !=
+      result->GetPoints()->GetDataType())
+    {
+    cerr << "Expected " << expected->GetNumberOfCells() << " cells and "
+         << expected->GetNumberOfPoints() << " points, got "
+         << result->GetNumberOfCells() << " cells and "
+         << result->GetNumberOfPoints() << " points" << endl;
+    return false;
+    }
+
+  vtkPointData *expectedPD = expected->GetPointData();
+  vtkPointData *resultPD = result->GetPointData();
+  vtkCellData *expectedCD = expected->GetCellData();
+  vtkCellData *resultCD = result->GetCellData();
+  if (expectedPD->GetNumberOfArrays() != resultPD->GetNumberOfArrays() ||
+      expectedCD->GetNumberOfArrays() != resultCD->GetNumberOfArrays())
+    {
+    cerr << "Wrong number of arrays" << endl;
+    return false;
+    }
+
+  vtkNew<vtkIdList> expectedIds;
+  vtkNew<vtkIdList> resultIds;
+  for (vtkIdType cellId = 0; cellId < expected->GetNumberOfCells(); cellId++)
+    {
+    expected->GetCellPoints(cellId, expectedIds.GetPointer());
+    result->GetCellPoints(cellId, resultIds.GetPointer());
+    if (expected->GetCellType(cellId) != result->GetCellType(cellId) ||
+        expectedIds->GetNumberOfIds() != resultIds->GetNumberOfIds())
+      {
+      cerr << "Wrong cell " << cellId << endl;
+      return false;
+      }
+    for (vtkIdType i = 0; i < expectedIds->GetNumberOfIds(); i++)
+      {
+      double x[3], y[3];
+      expected->GetPoint(expectedIds->GetId(i), x);
+      result->GetPoint(resultIds->GetId(i), y);
+      if (x[0] != y[0] || x[1] != y[1] || x[2] != y[2])
+        {
+        cerr << "Wrong point in cell " << cellId << endl;
+        return false;
+        }
+      for (int a = 0; a < expectedPD->GetNumberOfArrays(); a++)
+        {
+        vtkDataArray *array = expectedPD->GetArray(a);
+        if (!CompareTuples(array, expectedIds->GetId(i),
+                           resultPD->GetArray(array->GetName()),
+                           resultIds->GetId(i)))
+          {
+          cerr << "Wrong point data " << array->GetName() << endl;
+          return false;
+          }
+        }
+      }
+    for (int a = 0; a < expectedCD->GetNumberOfArrays(); a++)
+      {
+      vtkDataArray *array = expectedCD->GetArray(a);
+      if (!CompareTuples(array, cellId, resultCD->GetArray(array->GetName()),
+                         cellId))
+        {
+        cerr << "Wrong cell data " << array->GetName() << endl;
+        return false;
+        }
+      }
+    }
+  return true;
+}
+
+bool TestThreshold(vtkDataSet *input)
+{
+  vtkNew<vtkThreshold> threshold;
+  vtkNew<vtkSMPThreshold> smpThreshold;
+  threshold->SetInputData(input);
+  smpThreshold->SetInputData(input);
+
+  const char *arrays[2] = { "PointScalars", "CellScalars" };
+  const int associations[2] = { vtkDataObject::FIELD_ASSOCIATION_POINTS,
+                                vtkDataObject::FIELD_ASSOCIATION_CELLS };
+  for (int a = 0; a < 2; a++)
+    {
+    for (int mode = 0; mode < 3; mode++)
+      {
+      for (int type = 0; type < 3; type++)
+        {
+        for (int flags = 0; flags < 4; flags++)
+          {
+          vtkThreshold *filters[2] = { threshold.GetPointer(),
+                                       smpThreshold.GetPointer() };
+          for (int f = 0; f < 2; f++)
+            {
+            filters[f]->SetInputArrayToProcess(0, 0, 0, associations[a],
+                                               arrays[a]);
+            filters[f]->SetComponentMode(mode);
+            filters[f]->SetSelectedComponent(1);
+            filters[f]->SetAllScalars(flags & 1);
+            filters[f]->SetUseContinuousCellRange((flags & 2) >> 1);
+            switch (type)
+              {
+              case 0:
+                filters[f]->ThresholdByLower(0.2);
+                break;
+              case 1:
+                filters[f]->ThresholdByUpper(0.3);
+                break;
+              default:
+                filters[f]->ThresholdBetween(-0.2, 0.4);
+              }
+            filters[f]->Update();
+            }
+          if (!CompareOutputs(threshold->GetOutput(),
+                              smpThreshold->GetOutput()))
+            {
+            cerr << "Failed for " << input->GetClassName() << " with "
+                 << arrays[a] << ", component mode " << mode
+                 << ", threshold type " << type << " and flags " << flags
+                 << endl;
+            return false;
+            }
+          }
+        }
+      }
+    }
+  return true;
+}
+
+}
+
+int TestSMPThreshold(int, char *[])
+{
+  vtkSMPTools::Initialize(4);
+  vtkMath::RandomSeed(1234);
+
+  vtkNew<vtkUnstructuredGrid> grid;
+  MakeGrid(grid.GetPointer());
+  vtkNew<vtkPolyData> polyData;
+  MakePolyData(polyData.GetPointer());
+
+  if (!TestThreshold(grid.GetPointer()) ||
+      !TestThreshold(polyData.GetPointer()))
+    {
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,496 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkSMPClipDataSet.cxx
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "vtkSMPClipDataSet.h"
+
+#include "vtkCellArray.h"
+#include "vtkCellData.h"
+#include "vtkFloatArray.h"
+#include "vtkGenericCell.h"
+#include "vtkIdTypeArray.h"
+#include "vtkImplicitFunction.h"
+#include "vtkInformation.h"
+#include "vtkInformationVector.h"
+#include "vtkNew.h"
+#include "vtkObjectFactory.h"
+#include "vtkPointData.h"
+#include "vtkSMPMergePoints.h"
+#include "vtkSMPMergePolyDataHelper.h"
+#include "vtkSMPThreadLocal.h"
+#include "vtkSMPTools.h"
+#include "vtkSmartPointer.h"
+#include "vtkUnsignedCharArray.h"
+#include "vtkUnstructuredGrid.h"
+
+#include <vector>
+
+vtkStandardNewMacro(vtkSMPClipDataSet);
+
+//----------------------------------------------------------------------------
+vtkSMPClipDataSet::vtkSMPClipDataSet()
+{
+}
+
+//----------------------------------------------------------------------------
+vtkSMPClipDataSet::~vtkSMPClipDataSet()
+{
+}
+
+namespace
+{
+
+// Evaluates the clip function at the points of the input.
+struct vtkEvaluateClipFunction
+{
+  vtkImplicitFunction* Function;
+  vtkDataSet* Input;
+  float* Scalars;
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    double x[3];
+    for (vtkIdType i = begin; i < end; i++)
+      {
+      this->Input->GetPoint(i, x);
+      this->Scalars[i] = static_cast<float>(this->Function->FunctionValue(x));
+      }
+  }
+};
+
+// The clipped cells of one thread, for both outputs. The points and the
+// point data are stored in a vtkUnstructuredGrid to be merged by
+// vtkSMPMergePolyDataHelper::MergePoints().
+struct vtkLocalClipData
+{
+  vtkUnstructuredGrid* Points;
+  vtkSMPMergePoints* Locator;
+  vtkCellArray* Conn[2];
+  vtkUnsignedCharArray* Types[2];
+  vtkIdTypeArray* Locs[2];
+  vtkCellData* CellData[2];
+  vtkFloatArray* CellScalars;
+  vtkGenericCell* Cell;
+
+  vtkLocalClipData() : Points(0)
+    {
+    }
+};
+
+//----------------------------------------------------------------------------
+class vtkClipDataSetFunctor
+{
+public:
+  vtkUnstructuredGrid* Input;
+  vtkPointData* InPD;
+  vtkDataArray* ClipScalars;
+  double Value;
+  int InsideOut;
+  int NumOutputs;
+  int PointsType;
+  vtkIdType EstimatedSize;
+
+  vtkSMPThreadLocal<vtkLocalClipData> LocalData;
+
+  ~vtkClipDataSetFunctor()
+  {
+    vtkSMPThreadLocal<vtkLocalClipData>::iterator itr =
+      this->LocalData.begin();
+    for (; itr != this->LocalData.end(); ++itr)
+      {
+      (*itr).Points->Delete();
+      (*itr).Locator->Delete();
+      for (int i = 0; i < this->NumOutputs; i++)
+        {
+        (*itr).Conn[i]->Delete();
+        (*itr).Types[i]->Delete();
+        (*itr).Locs[i]->Delete();
+        (*itr).CellData[i]->Delete();
+        }
+      (*itr).CellScalars->Delete();
+      (*itr).Cell->Delete();
+      }
+  }
+
+  void Initialize()
+  {
+    vtkLocalClipData& localData = this->LocalData.Local();
+    vtkIdType estimatedSize = this->EstimatedSize;
+
+    localData.Points = vtkUnstructuredGrid::New();
+    vtkPoints* newPts = vtkPoints::New(this->PointsType);
+    newPts->Allocate(estimatedSize, estimatedSize/2);
+    localData.Points->SetPoints(newPts);
+    newPts->Delete();
+    localData.Points->GetPointData()->InterpolateAllocate(
+      this->InPD, estimatedSize, estimatedSize/2);
+
+    // All the locators must use the same binning for merging.
+    localData.Locator = vtkSMPMergePoints::New();
+    localData.Locator->InitPointInsertion(newPts, this->Input->GetBounds(),
+                                          this->Input->GetNumberOfPoints());
+
+    for (int i = 0; i < this->NumOutputs; i++)
+      {
+      localData.Conn[i] = vtkCellArray::New();
+      localData.Conn[i]->Allocate(estimatedSize, estimatedSize/2);
+      localData.Conn[i]->InitTraversal();
+      localData.Types[i] = vtkUnsignedCharArray::New();
+      localData.Types[i]->Allocate(estimatedSize, estimatedSize/2);
+      localData.Locs[i] = vtkIdTypeArray::New();
+      localData.Locs[i]->Allocate(estimatedSize, estimatedSize/2);
+      localData.CellData[i] = vtkCellData::New();
+      localData.CellData[i]->CopyAllocate(this->Input->GetCellData(),
+                                          estimatedSize, estimatedSize/2);
+      }
+
+    localData.CellScalars = vtkFloatArray::New();
+    localData.CellScalars->Allocate(VTK_CELL_SIZE);
+    localData.Cell = vtkGenericCell::New();
+  }
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    vtkLocalClipData& localData = this->LocalData.Local();
+    vtkGenericCell* cell = localData.Cell;
+    vtkFloatArray* cellScalars = localData.CellScalars;
+    vtkPointData* outPD = localData.Points->GetPointData();
+    vtkCellData* inCD = this->Input->GetCellData();
+
+    vtkIdType npts, *pts;
+    int cellType = 0;
+    for (vtkIdType cellId = begin; cellId < end; cellId++)
+      {
+      this->Input->GetCell(cellId, cell);
+      vtkIdList* cellIds = cell->GetPointIds();
+      npts = cell->GetPoints()->GetNumberOfPoints();
+
+      for (vtkIdType i = 0; i < npts; i++)
+        {
+        double s = this->ClipScalars->GetComponent(cellIds->GetId(i), 0);
+        cellScalars->InsertTuple(i, &s);
+        }
+
+      for (int i = 0; i < this->NumOutputs; i++)
+        {
+        vtkCellArray* conn = localData.Conn[i];
+        vtkIdType numCells = conn->GetNumberOfCells();
+        cell->Clip(this->Value, cellScalars, localData.Locator, conn,
+                   this->InPD, outPD, inCD, cellId, localData.CellData[i],
+                   i == 0 ? this->InsideOut : !this->InsideOut);
+
+        // For each new cell added, got to set the type of the cell
+        for (vtkIdType j = numCells; j < conn->GetNumberOfCells(); j++)
+          {
+          localData.Locs[i]->InsertNextValue(conn->GetTraversalLocation());
+          conn->GetNextCell(npts, pts);
+          switch (cell->GetCellDimension())
+            {
+            case 0: //points are generated
+              cellType = (npts > 1 ? VTK_POLY_VERTEX : VTK_VERTEX);
+              break;
+
+            case 1: //lines are generated
+              cellType = (npts > 2 ? VTK_POLY_LINE : VTK_LINE);
+              break;
+
+            case 2: //polygons are generated
+              cellType = (npts == 3 ? VTK_TRIANGLE :
+                          (npts == 4 ? VTK_QUAD : VTK_POLYGON));
+              break;
+
+            case 3: //tetrahedra or wedges are generated
+              cellType = (npts == 4 ? VTK_TETRA : VTK_WEDGE);
+              break;
+            }
+          localData.Types[i]->InsertNextValue(cellType);
+          }
+        }
+      }
+  }
+
+  void Reduce()
+  {
+  }
+};
+
+//----------------------------------------------------------------------------
+// Copies the cells of one thread to the merged cells, mapping their point
+// ids to the merged points.
+struct vtkMergeClippedCells
+{
+  const vtkIdType* InConn;
+  const unsigned char* InTypes;
+  const vtkIdType* InLocs;
+  vtkCellData* InCellData;
+  vtkIdList* IdMap;
+  vtkIdType CellOffset;
+  vtkIdType ConnOffset;
+  vtkIdType* OutConn;
+  unsigned char* OutTypes;
+  vtkIdType* OutLocs;
+  vtkCellData* OutCellData;
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    bool copyCellData = this->OutCellData->GetNumberOfArrays() > 0;
+    for (vtkIdType cellId = begin; cellId < end; cellId++)
+      {
+      vtkIdType loc = this->InLocs[cellId];
+      const vtkIdType* cell = this->InConn + loc;
+      vtkIdType* outCell = this->OutConn + this->ConnOffset + loc;
+      vtkIdType npts = *cell++;
+      *outCell++ = npts;
+      for (vtkIdType i = 0; i < npts; i++)
+        {
+        outCell[i] = this->IdMap ? this->IdMap->GetId(cell[i]) : cell[i];
+        }
+      this->OutTypes[this->CellOffset + cellId] = this->InTypes[cellId];
+      this->OutLocs[this->CellOffset + cellId] = this->ConnOffset + loc;
+      if (copyCellData)
+        {
+        this->OutCellData->SetTuple(this->CellOffset + cellId, cellId,
+                                    this->InCellData);
+        }
+      }
+  }
+};
+
+void MergeCells(vtkClipDataSetFunctor& functor,
+                int output,
+                const std::vector<vtkIdList*>& idMaps,
+                vtkUnstructuredGrid* outGrid)
+{
+  vtkSMPThreadLocal<vtkLocalClipData>::iterator begin =
+    functor.LocalData.begin();
+  vtkSMPThreadLocal<vtkLocalClipData>::iterator end = functor.LocalData.end();
+  vtkSMPThreadLocal<vtkLocalClipData>::iterator itr;
+
+  vtkIdType numCells = 0;
+  vtkIdType connSize = 0;
+  for (itr = begin; itr != end; ++itr)
+    {
+    numCells += (*itr).Conn[output]->GetNumberOfCells();
+    connSize += (*itr).Conn[output]->GetNumberOfConnectivityEntries();
+    }
+
+  vtkSmartPointer<vtkIdTypeArray> conn = vtkSmartPointer<vtkIdTypeArray>::New();
+  conn->SetNumberOfValues(connSize);
+  vtkSmartPointer<vtkUnsignedCharArray> types =
+    vtkSmartPointer<vtkUnsignedCharArray>::New();
+  types->SetNumberOfValues(numCells);
+  vtkSmartPointer<vtkIdTypeArray> locs = vtkSmartPointer<vtkIdTypeArray>::New();
+  locs->SetNumberOfValues(numCells);
+
+  // The cell data of all the threads has the same structure.
+  vtkCellData* firstCellData = (*begin).CellData[output];
+  vtkCellData* outCellData = outGrid->GetCellData();
+  outCellData->CopyStructure(firstCellData);
+  int attributeIndices[vtkDataSetAttributes::NUM_ATTRIBUTES];
+  firstCellData->GetAttributeIndices(attributeIndices);
+  for (int i = 0; i < vtkDataSetAttributes::NUM_ATTRIBUTES; i++)
+    {
+    if (attributeIndices[i] >= 0)
+      {
+      outCellData->SetActiveAttribute(attributeIndices[i], i);
+      }
+    }
+  for (int i = 0; i < outCellData->GetNumberOfArrays(); i++)
+    {
+    outCellData->GetAbstractArray(i)->SetNumberOfTuples(numCells);
+    }
+
+  vtkMergeClippedCells merge;
+  merge.CellOffset = 0;
+  merge.ConnOffset = 0;
+  merge.OutConn = conn->GetPointer(0);
+  merge.OutTypes = types->GetPointer(0);
+  merge.OutLocs = locs->GetPointer(0);
+  merge.OutCellData = outCellData;
+  std::vector<vtkIdList*>::const_iterator mapIter = idMaps.begin();
+  for (itr = begin; itr != end; ++itr)
+    {
+    // The point ids of the first thread are not changed by the merging.
+    merge.IdMap = itr == begin ? NULL : *mapIter++;
+    merge.InConn = (*itr).Conn[output]->GetPointer();
+    merge.InTypes = (*itr).Types[output]->GetPointer(0);
+    merge.InLocs = (*itr).Locs[output]->GetPointer(0);
+    merge.InCellData = (*itr).CellData[output];
+    vtkIdType numPieceCells = (*itr).Conn[output]->GetNumberOfCells();
+    vtkSMPTools::For(0, numPieceCells, merge);
+    merge.CellOffset += numPieceCells;
+    merge.ConnOffset +=
+      (*itr).Conn[output]->GetNumberOfConnectivityEntries();
+    }
+
+  vtkSmartPointer<vtkCellArray> cells = vtkSmartPointer<vtkCellArray>::New();
+  cells->SetCells(numCells, conn);
+  outGrid->SetCells(types, locs, cells);
+}
+
+} // end anon namespace
+
+//----------------------------------------------------------------------------
+int vtkSMPClipDataSet::RequestData(
+  vtkInformation *request,
+  vtkInformationVector **inputVector,
+  vtkInformationVector *outputVector)
+{
+  // get the info objects
+  vtkInformation *inInfo = inputVector[0]->GetInformationObject(0);
+  vtkInformation *outInfo = outputVector->GetInformationObject(0);
+
+  // get the input and output
+  vtkUnstructuredGrid *realInput = vtkUnstructuredGrid::SafeDownCast(
+    inInfo->Get(vtkDataObject::DATA_OBJECT()));
+  vtkUnstructuredGrid *output = vtkUnstructuredGrid::SafeDownCast(
+    outInfo->Get(vtkDataObject::DATA_OBJECT()));
+  vtkDataArray *inScalars = this->ClipFunction ? NULL :
+    this->GetInputArrayToProcess(0,inputVector);
+
+  // Let the superclass handle the other cases, including the errors.
+  if (!realInput || realInput->GetFaces() || this->MergeTolerance != 0.0 ||
+      realInput->GetNumberOfPoints() < 1 ||
+      realInput->GetNumberOfCells() < 1 ||
+      (!this->ClipFunction && (this->GenerateClipScalars || !inScalars)))
+    {
+    return this->Superclass::RequestData(request, inputVector, outputVector);
+    }
+
+  vtkDebugMacro(<< "Clipping unstructured grid with SMP");
+
+  // See vtkClipDataSet: the point data of the input must look exactly like
+  // the one of the output.
+  vtkSmartPointer<vtkUnstructuredGrid> input =
+    vtkSmartPointer<vtkUnstructuredGrid>::New();
+  input->CopyStructure(realInput);
+  input->GetCellData()->PassData(realInput->GetCellData());
+  input->GetPointData()->InterpolateAllocate(realInput->GetPointData(), 0, 0, 1);
+
+  vtkUnstructuredGrid *clippedOutput = this->GetClippedOutput();
+  vtkIdType numPts = input->GetNumberOfPoints();
+  vtkIdType numCells = input->GetNumberOfCells();
+
+  // Not thread safe so calculate first.
+  input->GetBounds();
+
+  vtkClipDataSetFunctor functor;
+  functor.Input = input;
+  functor.InPD = input->GetPointData();
+  functor.InsideOut = this->InsideOut;
+  functor.NumOutputs = this->GenerateClippedOutput ? 2 : 1;
+  functor.Value = 0.0;
+  if (this->UseValueAsOffset || !this->ClipFunction)
+    {
+    functor.Value = this->Value;
+    }
+
+  // Determine whether we're clipping with input scalars or a clip function
+  // and do necessary setup. Stateless functions are evaluated in parallel.
+  if (this->ClipFunction)
+    {
+    vtkFloatArray *tmpScalars = vtkFloatArray::New();
+    tmpScalars->SetNumberOfTuples(numPts);
+    tmpScalars->SetName("ClipDataSetScalars");
+    functor.InPD = vtkPointData::New();
+    functor.InPD->ShallowCopy(input->GetPointData());//copies original
+    if (this->GenerateClipScalars)
+      {
+      functor.InPD->SetScalars(tmpScalars);
+      }
+    vtkEvaluateClipFunction evaluate;
+    evaluate.Function = this->ClipFunction;
+    evaluate.Input = input;
+    evaluate.Scalars = tmpScalars->GetPointer(0);
+    evaluate(0, 1); // updates the transform of the function, if any
+    if (this->ClipFunction->IsA("vtkPlane") ||
+        this->ClipFunction->IsA("vtkSphere") ||
+        this->ClipFunction->IsA("vtkCylinder") ||
+        this->ClipFunction->IsA("vtkBox") ||
+        this->ClipFunction->IsA("vtkQuadric"))
+      {
+      vtkSMPTools::For(1, numPts, evaluate);
+      }
+    else
+      {
+      evaluate(1, numPts);
+      }
+    functor.ClipScalars = tmpScalars;
+    }
+  else
+    {
+    functor.ClipScalars = inScalars;
+    }
+
+  // set precision for the points in the output
+  functor.PointsType = input->GetPoints()->GetDataType();
+  if (this->OutputPointsPrecision == vtkAlgorithm::SINGLE_PRECISION)
+    {
+    functor.PointsType = VTK_FLOAT;
+    }
+  else if (this->OutputPointsPrecision == vtkAlgorithm::DOUBLE_PRECISION)
+    {
+    functor.PointsType = VTK_DOUBLE;
+    }
+
+  functor.EstimatedSize = numCells / 1024 * 1024; //multiple of 1024
+  if (functor.EstimatedSize < 1024)
+    {
+    functor.EstimatedSize = 1024;
+    }
+
+  vtkSMPTools::For(0, numCells, functor);
+
+  // Merge the points of all the threads, then their cells.
+  std::vector<vtkPointSet*> pieces;
+  std::vector<vtkSMPMergePoints*> locators;
+  vtkSMPThreadLocal<vtkLocalClipData>::iterator itr =
+    functor.LocalData.begin();
+  for (; itr != functor.LocalData.end(); ++itr)
+    {
+    pieces.push_back((*itr).Points);
+    locators.push_back((*itr).Locator);
+    }
+  std::vector<vtkIdList*> idMaps;
+  vtkNew<vtkUnstructuredGrid> merged;
+  vtkSMPMergePolyDataHelper::MergePoints(pieces, locators,
+                                         merged.GetPointer(), idMaps);
+
+  output->SetPoints(merged->GetPoints());
+  output->GetPointData()->ShallowCopy(merged->GetPointData());
+  MergeCells(functor, 0, idMaps, output);
+  if (this->GenerateClippedOutput)
+    {
+    clippedOutput->SetPoints(merged->GetPoints());
+    MergeCells(functor, 1, idMaps, clippedOutput);
+    }
+
+  for (size_t i = 0; i < idMaps.size(); i++)
+    {
+    idMaps[i]->Delete();
+    }
+  if (this->ClipFunction)
+    {
+    functor.ClipScalars->Delete();
+    functor.InPD->Delete();
+    }
+  output->Squeeze();
+
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+void vtkSMPClipDataSet::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os,indent);
+}
@@ -0,0 +1,63 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkSMPClipDataSet.h
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+// .NAME vtkSMPClipDataSet - multithreaded vtkClipDataSet for unstructured grids
+// .SECTION Description
+// Just like parent, but clips vtkUnstructuredGrid inputs using the SMP
+// framework. The clip scalars are evaluated in parallel, the cells are
+// clipped by many threads, each one with its own vtkSMPMergePoints
+// locator, and the pieces are merged in parallel.
+//
+// The outputs have the same points and cells as the ones of
+// vtkClipDataSet, but they are not in the same order.
+//
+// .SECTION Caveats
+// Other inputs, inputs with polyhedra and a non zero MergeTolerance are
+// handled by the superclass. The Locator is not used by the parallel path.
+// The clip function is evaluated in parallel only for implicit functions
+// known to be thread safe (vtkPlane, vtkSphere, vtkCylinder, vtkBox and
+// vtkQuadric).
+//
+// .SECTION See Also
+// vtkClipDataSet vtkSMPCutter
+
+#ifndef vtkSMPClipDataSet_h
+#define vtkSMPClipDataSet_h
+
+#include "vtkFiltersSMPModule.h" // For export macro
+#include "vtkClipDataSet.h"
+
+class VTKFILTERSSMP_EXPORT vtkSMPClipDataSet : public vtkClipDataSet
+{
+public:
+  vtkTypeMacro(vtkSMPClipDataSet,vtkClipDataSet);
+  static vtkSMPClipDataSet *New();
+  void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
+
+protected:
+  vtkSMPClipDataSet();
+  ~vtkSMPClipDataSet();
+
+  // Description:
+  // Overridden to use threads.
+  int RequestData(vtkInformation *,
+                  vtkInformationVector **,
+                  vtkInformationVector *) VTK_OVERRIDE;
+
+private:
+  vtkSMPClipDataSet(const vtkSMPClipDataSet&) VTK_DELETE_FUNCTION;
+  void operator=(const vtkSMPClipDataSet&) VTK_DELETE_FUNCTION;
+};
+
+#endif
@@ -0,0 +1,397 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkSMPCutter.cxx
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "vtkSMPCutter.h"
+
+#include "vtkCellArray.h"
+#include "vtkCellData.h"
+#include "vtkContourHelper.h"
+#include "vtkDoubleArray.h"
+#include "vtkGenericCell.h"
+#include "vtkImplicitFunction.h"
+#include "vtkIncrementalPointLocator.h"
+#include "vtkInformation.h"
+#include "vtkInformationVector.h"
+#include "vtkObjectFactory.h"
+#include "vtkPointData.h"
+#include "vtkPolyData.h"
+#include "vtkSMPMergePoints.h"
+#include "vtkSMPMergePolyDataHelper.h"
+#include "vtkSMPThreadLocal.h"
+#include "vtkSMPTools.h"
+#include "vtkUnstructuredGrid.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+vtkStandardNewMacro(vtkSMPCutter);
+
+//----------------------------------------------------------------------------
+vtkSMPCutter::vtkSMPCutter()
+{
+}
+
+//----------------------------------------------------------------------------
+vtkSMPCutter::~vtkSMPCutter()
+{
+}
+
+namespace
+{
+
+// Evaluates the cut function at the points of the input.
+struct vtkEvaluateCutFunction
+{
+  vtkImplicitFunction* Function;
+  vtkDataSet* Input;
+  double* Scalars;
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    double x[3];
+    for (vtkIdType i = begin; i < end; i++)
+      {
+      this->Input->GetPoint(i, x);
+      this->Scalars[i] = this->Function->FunctionValue(x);
+      }
+  }
+};
+
+struct vtkLocalCutData
+{
+  vtkPolyData* Output;
+  vtkSMPMergePoints* Locator;
+  vtkIdList* VertOffsets;
+  vtkIdList* LineOffsets;
+  vtkIdList* PolyOffsets;
+  vtkDoubleArray* CellScalars;
+  vtkGenericCell* Cell;
+  vtkContourHelper* Helper;
+
+  vtkLocalCutData() : Output(0)
+    {
+    }
+};
+
+//----------------------------------------------------------------------------
+// Each thread cuts the cells it is given into its own vtkPolyData. The
+// cells are cut one dimension at a time so that the cell data of each
+// vtkPolyData is ordered as verts, lines and then polys, as expected by
+// vtkSMPMergePolyDataHelper.
+class vtkCutterFunctor
+{
+public:
+  vtkSMPCutter* Filter;
+  vtkUnstructuredGrid* Input;
+  vtkPointData* InPD;
+  vtkDoubleArray* CutScalars;
+  int NumValues;
+  double* Values;
+  int PointsType;
+  vtkIdType EstimatedSize;
+  unsigned char CellTypeDimensions[VTK_NUMBER_OF_CELL_TYPES];
+  int Dimension;
+
+  vtkSMPThreadLocal<vtkLocalCutData> LocalData;
+
+  ~vtkCutterFunctor()
+  {
+    vtkSMPThreadLocal<vtkLocalCutData>::iterator itr = this->LocalData.begin();
+    for (; itr != this->LocalData.end(); ++itr)
+      {
+      delete (*itr).Helper;
+      (*itr).Output->Delete();
+      (*itr).Locator->Delete();
+      (*itr).VertOffsets->Delete();
+      (*itr).LineOffsets->Delete();
+      (*itr).PolyOffsets->Delete();
+      (*itr).CellScalars->Delete();
+      (*itr).Cell->Delete();
+      }
+  }
+
+  void Initialize()
+  {
+    // The functor is executed once per dimension; create the thread local
+    // data only the first time.
+    vtkLocalCutData& localData = this->LocalData.Local();
+    if (localData.Output)
+      {
+      return;
+      }
+    vtkIdType estimatedSize = this->EstimatedSize;
+
+    localData.Output = vtkPolyData::New();
+    vtkPolyData* output = localData.Output;
+
+    vtkPoints* newPts = vtkPoints::New(this->PointsType);
+    newPts->Allocate(estimatedSize, estimatedSize);
+    output->SetPoints(newPts);
+    newPts->Delete();
+
+    // All the locators must use the same binning for merging.
+    localData.Locator = vtkSMPMergePoints::New();
+    localData.Locator->InitPointInsertion(newPts, this->Input->GetBounds(),
+                                          this->Input->GetNumberOfPoints());
+
+    localData.VertOffsets = vtkIdList::New();
+    localData.VertOffsets->Allocate(estimatedSize);
+    localData.LineOffsets = vtkIdList::New();
+    localData.LineOffsets->Allocate(estimatedSize);
+    localData.PolyOffsets = vtkIdList::New();
+    localData.PolyOffsets->Allocate(estimatedSize);
+
+    vtkCellArray* newVerts = vtkCellArray::New();
+    newVerts->Allocate(estimatedSize, estimatedSize);
+    output->SetVerts(newVerts);
+    newVerts->Delete();
+    vtkCellArray* newLines = vtkCellArray::New();
+    newLines->Allocate(estimatedSize, estimatedSize);
+    output->SetLines(newLines);
+    newLines->Delete();
+    vtkCellArray* newPolys = vtkCellArray::New();
+    newPolys->Allocate(estimatedSize, estimatedSize);
+    output->SetPolys(newPolys);
+    newPolys->Delete();
+
+    localData.CellScalars = vtkDoubleArray::New();
+    localData.CellScalars->Allocate(VTK_CELL_SIZE);
+    localData.Cell = vtkGenericCell::New();
+
+    vtkPointData* outPD = output->GetPointData();
+    vtkCellData* outCD = output->GetCellData();
+    vtkCellData* inCD = this->Input->GetCellData();
+    outPD->InterpolateAllocate(this->InPD, estimatedSize, estimatedSize);
+    outCD->CopyAllocate(inCD, estimatedSize, estimatedSize);
+
+    localData.Helper = new vtkContourHelper(
+      localData.Locator, newVerts, newLines, newPolys, this->InPD, inCD,
+      outPD, outCD, estimatedSize, this->Filter->GetGenerateTriangles() != 0);
+  }
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    vtkLocalCutData& localData = this->LocalData.Local();
+    vtkCellArray* verts = localData.Output->GetVerts();
+    vtkCellArray* lines = localData.Output->GetLines();
+    vtkCellArray* polys = localData.Output->GetPolys();
+    vtkDoubleArray* cellScalars = localData.CellScalars;
+    vtkGenericCell* cell = localData.Cell;
+    const double* scalars = this->CutScalars->GetPointer(0);
+    const double* values = this->Values;
+    const double* valuesEnd = values + this->NumValues;
+
+    vtkIdType npts, *pts;
+    for (vtkIdType cellId = begin; cellId < end; cellId++)
+      {
+      int cellType = this->Input->GetCellType(cellId);
+      if (cellType >= VTK_NUMBER_OF_CELL_TYPES ||
+          this->CellTypeDimensions[cellType] != this->Dimension)
+        {
+        continue;
+        }
+
+      // find min and max values in scalar data
+      this->Input->GetCellPoints(cellId, npts, pts);
+      double range[2];
+      range[0] = range[1] = scalars[pts[0]];
+      for (vtkIdType i = 1; i < npts; i++)
+        {
+        range[0] = std::min(range[0], scalars[pts[i]]);
+        range[1] = std::max(range[1], scalars[pts[i]]);
+        }
+
+      const double* value = values;
+      while (value != valuesEnd && (*value < range[0] || *value > range[1]))
+        {
+        ++value;
+        }
+      if (value == valuesEnd)
+        {
+        continue;
+        }
+
+      this->Input->GetCell(cellId, cell);
+      this->CutScalars->GetTuples(cell->GetPointIds(), cellScalars);
+      for (value = values; value != valuesEnd; ++value)
+        {
+        vtkIdType begVertSize = verts->GetNumberOfConnectivityEntries();
+        vtkIdType begLineSize = lines->GetNumberOfConnectivityEntries();
+        vtkIdType begPolySize = polys->GetNumberOfConnectivityEntries();
+        localData.Helper->Contour(cell, *value, cellScalars, cellId);
+        // Keep track of the insertion points for the parallel merging,
+        // see vtkSMPMergePolyDataHelper.
+        if (verts->GetNumberOfConnectivityEntries() > begVertSize)
+          {
+          localData.VertOffsets->InsertNextId(begVertSize);
+          }
+        if (lines->GetNumberOfConnectivityEntries() > begLineSize)
+          {
+          localData.LineOffsets->InsertNextId(begLineSize);
+          }
+        if (polys->GetNumberOfConnectivityEntries() > begPolySize)
+          {
+          localData.PolyOffsets->InsertNextId(begPolySize);
+          }
+        }
+      }
+  }
+
+  void Reduce()
+  {
+  }
+};
+
+} // end anon namespace
+
+//----------------------------------------------------------------------------
+int vtkSMPCutter::RequestData(
+  vtkInformation *request,
+  vtkInformationVector **inputVector,
+  vtkInformationVector *outputVector)
+{
+  // get the info objects
+  vtkInformation *inInfo = inputVector[0]->GetInformationObject(0);
+  vtkInformation *outInfo = outputVector->GetInformationObject(0);
+
+  // get the input and output
+  vtkUnstructuredGrid *input = vtkUnstructuredGrid::SafeDownCast(
+    inInfo->Get(vtkDataObject::DATA_OBJECT()));
+  vtkPolyData *output = vtkPolyData::SafeDownCast(
+    outInfo->Get(vtkDataObject::DATA_OBJECT()));
+
+  // Let the superclass handle the other cases, including the errors. The
+  // parallel path merges points exactly like vtkMergePoints, the default
+  // locator, so other locators are honored by the superclass.
+  if (!input || input->GetFaces() || !this->CutFunction ||
+      this->SortBy == VTK_SORT_BY_CELL ||
+      (this->Locator &&
+       strcmp(this->Locator->GetClassName(), "vtkMergePoints") != 0) ||
+      input->GetNumberOfPoints() < 1 || input->GetNumberOfCells() < 1 ||
+      this->GetNumberOfContours() < 1)
+    {
+    return this->Superclass::RequestData(request, inputVector, outputVector);
+    }
+
+  vtkDebugMacro(<< "Executing SMP unstructured grid cutter");
+
+  vtkIdType numPts = input->GetNumberOfPoints();
+  vtkIdType numCells = input->GetNumberOfCells();
+  int numContours = this->GetNumberOfContours();
+
+  // Not thread safe so calculate first.
+  input->GetBounds();
+
+  // Evaluate the cut function at each point. Stateless functions are
+  // evaluated in parallel.
+  vtkDoubleArray *cutScalars = vtkDoubleArray::New();
+  cutScalars->SetNumberOfTuples(numPts);
+  vtkEvaluateCutFunction evaluate;
+  evaluate.Function = this->CutFunction;
+  evaluate.Input = input;
+  evaluate.Scalars = cutScalars->GetPointer(0);
+  evaluate(0, 1); // updates the transform of the function, if any
+  if (this->CutFunction->IsA("vtkPlane") ||
+      this->CutFunction->IsA("vtkSphere") ||
+      this->CutFunction->IsA("vtkCylinder") ||
+      this->CutFunction->IsA("vtkBox") ||
+      this->CutFunction->IsA("vtkQuadric"))
+    {
+    vtkSMPTools::For(1, numPts, evaluate);
+    }
+  else
+    {
+    evaluate(1, numPts);
+    }
+
+  // Interpolate data along edge. If generating cut scalars, do necessary setup
+  vtkPointData *inPD;
+  if (this->GenerateCutScalars)
+    {
+    inPD = vtkPointData::New();
+    inPD->ShallowCopy(input->GetPointData());//copies original attributes
+    inPD->SetScalars(cutScalars);
+    }
+  else
+    {
+    inPD = input->GetPointData();
+    }
+
+  vtkCutterFunctor functor;
+  functor.Filter = this;
+  functor.Input = input;
+  functor.InPD = inPD;
+  functor.CutScalars = cutScalars;
+  functor.NumValues = numContours;
+  functor.Values = this->ContourValues->GetValues();
+  vtkCutter::GetCellTypeDimensions(functor.CellTypeDimensions);
+
+  // set precision for the points in the output
+  functor.PointsType = input->GetPoints()->GetDataType();
+  if (this->OutputPointsPrecision == vtkAlgorithm::SINGLE_PRECISION)
+    {
+    functor.PointsType = VTK_FLOAT;
+    }
+  else if (this->OutputPointsPrecision == vtkAlgorithm::DOUBLE_PRECISION)
+    {
+    functor.PointsType = VTK_DOUBLE;
+    }
+
+  functor.EstimatedSize = static_cast<vtkIdType>(
+    pow(static_cast<double>(numCells), .75)) * numContours;
+  functor.EstimatedSize = functor.EstimatedSize / 1024 * 1024;
+  if (functor.EstimatedSize < 1024)
+    {
+    functor.EstimatedSize = 1024;
+    }
+
+  // Cut lower dimensional cells first. We skip 0d cells (points), because
+  // they cannot be cut (generate no data).
+  for (functor.Dimension = 1; functor.Dimension <= 3; functor.Dimension++)
+    {
+    vtkSMPTools::For(0, numCells, functor);
+    }
+
+  std::vector<vtkSMPMergePolyDataHelper::InputData> mpData;
+  vtkSMPThreadLocal<vtkLocalCutData>::iterator itr =
+    functor.LocalData.begin();
+  for (; itr != functor.LocalData.end(); ++itr)
+    {
+    mpData.push_back(vtkSMPMergePolyDataHelper::InputData((*itr).Output,
+                                                          (*itr).Locator,
+                                                          (*itr).VertOffsets,
+                                                          (*itr).LineOffsets,
+                                                          (*itr).PolyOffsets));
+    }
+  vtkPolyData *merged = vtkSMPMergePolyDataHelper::MergePolyData(mpData);
+  output->ShallowCopy(merged);
+  merged->Delete();
+  output->Squeeze();
+
+  if (this->GenerateCutScalars)
+    {
+    inPD->Delete();
+    }
+  cutScalars->Delete();
+
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+void vtkSMPCutter::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os,indent);
+}
@@ -0,0 +1,62 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkSMPCutter.h
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+// .NAME vtkSMPCutter - multithreaded vtkCutter for unstructured grids
+// .SECTION Description
+// Just like parent, but cuts vtkUnstructuredGrid inputs using the SMP
+// framework. The cut scalars are evaluated in parallel, the cells are cut
+// by many threads, each one with its own vtkSMPMergePoints locator, and
+// the pieces are merged with vtkSMPMergePolyDataHelper.
+//
+// The output has the same points and cells as the one of vtkCutter, but
+// they are not in the same order.
+//
+// .SECTION Caveats
+// Other inputs, grids with polyhedra, SortBy set to VTK_SORT_BY_CELL and
+// locators other than vtkMergePoints are handled by the superclass. The cut
+// function is evaluated in parallel only for implicit functions known to
+// be thread safe (vtkPlane, vtkSphere, vtkCylinder, vtkBox and vtkQuadric).
+//
+// .SECTION See Also
+// vtkCutter vtkSMPClipDataSet vtkSMPContourGrid
+
+#ifndef vtkSMPCutter_h
+#define vtkSMPCutter_h
+
+#include "vtkFiltersSMPModule.h" // For export macro
+#include "vtkCutter.h"
+
+class VTKFILTERSSMP_EXPORT vtkSMPCutter : public vtkCutter
+{
+public:
+  vtkTypeMacro(vtkSMPCutter,vtkCutter);
+  static vtkSMPCutter *New();
+  void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
+
+protected:
+  vtkSMPCutter();
+  ~vtkSMPCutter();
+
+  // Description:
+  // Overridden to use threads.
+  int RequestData(vtkInformation *,
+                  vtkInformationVector **,
+                  vtkInformationVector *) VTK_OVERRIDE;
+
+private:
+  vtkSMPCutter(const vtkSMPCutter&) VTK_DELETE_FUNCTION;
+  void operator=(const vtkSMPCutter&) VTK_DELETE_FUNCTION;
+};
+
+#endif
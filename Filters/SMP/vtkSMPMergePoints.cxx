@@ -147,7 +147,9 @@ void vtkSMPMergePoints::Merge(vtkSMPMergePoints* locator,
 
   // points have to be added
   vtkIdType NumberOfInsertions = oldIdToMerge->GetNumberOfIds();
-  vtkIdType first_id = (this->AtomicInsertionId += NumberOfInsertions);
+  // += returns the incremented value, the range starts before it.
+  vtkIdType first_id =
+    (this->AtomicInsertionId += NumberOfInsertions) - NumberOfInsertions;
   bucket->Resize( bucket->GetNumberOfIds() + NumberOfInsertions );
   for ( i = 0; i < NumberOfInsertions; ++i )
     {
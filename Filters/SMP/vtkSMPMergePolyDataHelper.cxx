@@ -19,6 +19,7 @@
 #include "vtkDataArray.h"
 #include "vtkNew.h"
 #include "vtkPointData.h"
+#include "vtkPointSet.h"
 #include "vtkPolyData.h"
 #include "vtkSmartPointer.h"
 #include "vtkSMPTools.h"
@@ -29,10 +30,10 @@ namespace
 
 struct vtkMergePointsData
 {
-  vtkPolyData* Output;
+  vtkPointSet* Output;
   vtkSMPMergePoints* Locator;
 
-  vtkMergePointsData(vtkPolyData* output, vtkSMPMergePoints* locator) :
+  vtkMergePointsData(vtkPointSet* output, vtkSMPMergePoints* locator) :
     Output(output), Locator(locator)
     {
     }
@@ -74,7 +75,7 @@ public:
 
 void MergePoints(std::vector<vtkMergePointsData>& data,
                  std::vector<vtkIdList*>& idMaps,
-                 vtkPolyData* outPolyData)
+                 vtkPointSet* outPointSet)
 {
   // This merges points in parallel/
 
@@ -157,8 +158,8 @@ void MergePoints(std::vector<vtkMergePointsData>& data,
       mergePoints.OutputPointData->GetArray(i)->SetNumberOfTuples(mergePoints.Merger->GetMaxId()+1);
       }
     }
-  outPolyData->SetPoints(mergePoints.Merger->GetPoints());
-  outPolyData->GetPointData()->ShallowCopy(mergePoints.OutputPointData);
+  outPointSet->SetPoints(mergePoints.Merger->GetPoints());
+  outPointSet->GetPointData()->ShallowCopy(mergePoints.OutputPointData);
 }
 
 class vtkParallelMergeCells
@@ -220,29 +221,36 @@ class vtkParallelCellDataCopier
 public:
   vtkDataSetAttributes* InputCellData;
   vtkDataSetAttributes* OutputCellData;
+  vtkIdType InputOffset;
   vtkIdType Offset;
 
   void operator()(vtkIdType begin, vtkIdType end)
   {
     vtkDataSetAttributes* inputCellData = this->InputCellData;
     vtkDataSetAttributes* outputCellData = this->OutputCellData;
+    vtkIdType inputOffset = this->InputOffset;
     vtkIdType offset = this->Offset;
 
     for (vtkIdType i=begin; i<end; i++)
       {
-      outputCellData->SetTuple(offset + i, i, inputCellData);
+      outputCellData->SetTuple(offset + i, inputOffset + i, inputCellData);
       }
   }
 };
 
+// The cell data of each input is ordered as verts, lines and then polys.
+// CellDataOffset is the cell data index of the first cell of OutCellArray.
 struct vtkMergeCellsData
 {
   vtkPolyData* Output;
   vtkIdList* CellOffsets;
   vtkCellArray* OutCellArray;
+  vtkIdType CellDataOffset;
 
-  vtkMergeCellsData(vtkPolyData* output, vtkIdList* celloffsets, vtkCellArray* cellarray) :
-    Output(output), CellOffsets(celloffsets), OutCellArray(cellarray)
+  vtkMergeCellsData(vtkPolyData* output, vtkIdList* celloffsets,
+                    vtkCellArray* cellarray, vtkIdType celldataoffset) :
+    Output(output), CellOffsets(celloffsets), OutCellArray(cellarray),
+    CellDataOffset(celldataoffset)
     {
     }
 };
@@ -251,7 +259,8 @@ void MergeCells(std::vector<vtkMergeCellsData>& data,
                 const std::vector<vtkIdList*>& idMaps,
                 vtkIdType numCells,
                 vtkIdType cellDataOffset,
-                vtkCellArray* outCells)
+                vtkCellArray* outCells,
+                vtkCellData* outCellData)
 {
   std::vector<vtkMergeCellsData>::iterator begin = data.begin();
   std::vector<vtkMergeCellsData>::iterator itr;
@@ -295,29 +304,43 @@ void MergeCells(std::vector<vtkMergeCellsData>& data,
   outCellsArray->SetNumberOfTuples(outCellsOffset);
   outCells->SetNumberOfCells(numCells);
 
-  outCellsOffset = cellDataOffset + (*begin).OutCellArray->GetNumberOfCells();
+  outCellsOffset = cellDataOffset;
 
   // Now copy cell data in parallel
   vtkParallelCellDataCopier cellCopier;
-  cellCopier.OutputCellData = (*begin).Output->GetCellData();
+  cellCopier.OutputCellData = outCellData;
   int numCellArrays = cellCopier.OutputCellData->GetNumberOfArrays();
   if (numCellArrays > 0)
     {
-    for (itr = second; itr != end; ++itr)
+    for (itr = begin; itr != end; ++itr)
       {
       cellCopier.InputCellData = (*itr).Output->GetCellData();
+      cellCopier.InputOffset = (*itr).CellDataOffset;
       cellCopier.Offset = outCellsOffset;
       vtkCellArray* cells = (*itr).OutCellArray;
 
       vtkSMPTools::For(0,  cells->GetNumberOfCells(), cellCopier);
-      //cellCopier.operator()(0, polys->GetNumberOfCells());
 
-      outCellsOffset += (*itr).Output->GetPolys()->GetNumberOfCells();
+      outCellsOffset += cells->GetNumberOfCells();
       }
     }
 }
 }
 
+void vtkSMPMergePolyDataHelper::MergePoints(
+  const std::vector<vtkPointSet*>& inputs,
+  const std::vector<vtkSMPMergePoints*>& locators,
+  vtkPointSet* output,
+  std::vector<vtkIdList*>& idMaps)
+{
+  std::vector<vtkMergePointsData> mpData;
+  for (size_t i=0; i<inputs.size(); i++)
+    {
+    mpData.push_back(vtkMergePointsData(inputs[i], locators[i]));
+    }
+  ::MergePoints(mpData, idMaps, output);
+}
+
 vtkPolyData* vtkSMPMergePolyDataHelper::MergePolyData(std::vector<InputData>& inputs)
 {
   // First merge points
@@ -336,7 +359,7 @@ vtkPolyData* vtkSMPMergePolyDataHelper::MergePolyData(std::vector<InputData>& in
   std::vector<vtkIdList*> idMaps;
   vtkPolyData* outPolyData = vtkPolyData::New();
 
-  MergePoints(mpData, idMaps, outPolyData);
+  ::MergePoints(mpData, idMaps, outPolyData);
 
   itr = begin;
   vtkIdType vertSize = 0;
@@ -359,12 +382,24 @@ vtkPolyData* vtkSMPMergePolyDataHelper::MergePolyData(std::vector<InputData>& in
 
   vtkIdType numOutCells = numVerts + numLines + numPolys;
 
-  vtkCellData* outCellData = (*begin).Input->GetCellData();
+  // The cell data of all inputs, including the first one, is copied to
+  // the merged cell data which is ordered as verts, lines and then polys.
+  vtkCellData* firstCellData = (*begin).Input->GetCellData();
+  vtkCellData* outCellData = vtkCellData::New();
+  outCellData->CopyStructure(firstCellData);
+  int attributeIndices[vtkDataSetAttributes::NUM_ATTRIBUTES];
+  firstCellData->GetAttributeIndices(attributeIndices);
+  for (int i=0; i<vtkDataSetAttributes::NUM_ATTRIBUTES; i++)
+    {
+    if (attributeIndices[i] >= 0)
+      {
+      outCellData->SetActiveAttribute(attributeIndices[i], i);
+      }
+    }
   int numCellArrays = outCellData->GetNumberOfArrays();
   for (int i=0; i<numCellArrays; i++)
     {
-    outCellData->GetArray(i)->Resize(numOutCells);
-    outCellData->GetArray(i)->SetNumberOfTuples(numOutCells);
+    outCellData->GetAbstractArray(i)->SetNumberOfTuples(numOutCells);
     }
 
   // Now merge each cell type. Because vtkPolyData stores each
@@ -378,10 +413,12 @@ vtkPolyData* vtkSMPMergePolyDataHelper::MergePolyData(std::vector<InputData>& in
     itr = begin;
     while(itr != end)
     {
-    mcData.push_back(vtkMergeCellsData((*itr).Input, (*itr).VertOffsets, (*itr).Input->GetVerts()));
+    mcData.push_back(vtkMergeCellsData((*itr).Input, (*itr).VertOffsets,
+                                       (*itr).Input->GetVerts(), 0));
     ++itr;
     }
-    MergeCells(mcData, idMaps, numVerts, 0, outVerts.GetPointer());
+    MergeCells(mcData, idMaps, numVerts, 0, outVerts.GetPointer(),
+               outCellData);
 
     outPolyData->SetVerts(outVerts.GetPointer());
 
@@ -396,10 +433,13 @@ vtkPolyData* vtkSMPMergePolyDataHelper::MergePolyData(std::vector<InputData>& in
     itr = begin;
     while(itr != end)
     {
-    mcData.push_back(vtkMergeCellsData((*itr).Input, (*itr).LineOffsets, (*itr).Input->GetLines()));
+    mcData.push_back(vtkMergeCellsData((*itr).Input, (*itr).LineOffsets,
+                                       (*itr).Input->GetLines(),
+                                       (*itr).Input->GetVerts()->GetNumberOfCells()));
     ++itr;
     }
-    MergeCells(mcData, idMaps, numLines, vertSize, outLines.GetPointer());
+    MergeCells(mcData, idMaps, numLines, numVerts, outLines.GetPointer(),
+               outCellData);
 
     outPolyData->SetLines(outLines.GetPointer());
 
@@ -414,15 +454,20 @@ vtkPolyData* vtkSMPMergePolyDataHelper::MergePolyData(std::vector<InputData>& in
     itr = begin;
     while(itr != end)
       {
-      mcData.push_back(vtkMergeCellsData((*itr).Input, (*itr).PolyOffsets, (*itr).Input->GetPolys()));
+      mcData.push_back(vtkMergeCellsData((*itr).Input, (*itr).PolyOffsets,
+                                         (*itr).Input->GetPolys(),
+                                         (*itr).Input->GetVerts()->GetNumberOfCells() +
+                                         (*itr).Input->GetLines()->GetNumberOfCells()));
       ++itr;
       }
-    MergeCells(mcData, idMaps, numPolys, vertSize + lineSize, outPolys.GetPointer());
+    MergeCells(mcData, idMaps, numPolys, numVerts + numLines,
+               outPolys.GetPointer(), outCellData);
 
     outPolyData->SetPolys(outPolys.GetPointer());
     }
 
   outPolyData->GetCellData()->ShallowCopy(outCellData);
+  outCellData->Delete();
 
   std::vector<vtkIdList*>::iterator mapIter = idMaps.begin();
   while (mapIter != idMaps.end())
@@ -26,6 +26,7 @@
 
 #include <vector>
 
+class vtkPointSet;
 class vtkPolyData;
 class vtkSMPMergePoints;
 class vtkIdList;
@@ -71,6 +72,19 @@ public:
   // it, use DeepCopy before passing to MergePolyData.
   static vtkPolyData* MergePolyData(std::vector<InputData>& inputs);
 
+  // Description:
+  // Merges the points and point data of the given point sets, each with its
+  // locator generated using identical binning structure, and sets them on
+  // output. The point ids of the first input are preserved. idMaps receives
+  // one map per remaining input, from its point ids to the merged point ids,
+  // which need to be deleted by the caller. As with MergePolyData, the
+  // first input is used as the merging target and is modified in place.
+  // This can be used to merge outputs that are not vtkPolyData.
+  static void MergePoints(const std::vector<vtkPointSet*>& inputs,
+                          const std::vector<vtkSMPMergePoints*>& locators,
+                          vtkPointSet* output,
+                          std::vector<vtkIdList*>& idMaps);
+
 protected:
   vtkSMPMergePolyDataHelper();
   ~vtkSMPMergePolyDataHelper();
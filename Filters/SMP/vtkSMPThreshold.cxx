@@ -0,0 +1,543 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkSMPThreshold.cxx
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "vtkSMPThreshold.h"
+
+#include "vtkArrayListTemplate.h" // For processing attribute data
+#include "vtkAtomic.h"
+#include "vtkCellArray.h"
+#include "vtkCellData.h"
+#include "vtkIdTypeArray.h"
+#include "vtkInformation.h"
+#include "vtkInformationVector.h"
+#include "vtkObjectFactory.h"
+#include "vtkPointData.h"
+#include "vtkPolyData.h"
+#include "vtkSMPTools.h"
+#include "vtkUnsignedCharArray.h"
+#include "vtkUnstructuredGrid.h"
+
+#include <algorithm>
+#include <cfloat>
+
+vtkStandardNewMacro(vtkSMPThreshold);
+
+//----------------------------------------------------------------------------
+vtkSMPThreshold::vtkSMPThreshold()
+{
+}
+
+//----------------------------------------------------------------------------
+vtkSMPThreshold::~vtkSMPThreshold()
+{
+}
+
+namespace
+{
+
+// The cells are processed in chunks of consecutive cells. The number of
+// kept cells and the connectivity size of each chunk are scanned into the
+// offsets at which each chunk writes its output.
+const vtkIdType ChunkSize = 1024;
+
+enum ThresholdType
+{
+  THRESHOLD_LOWER,
+  THRESHOLD_UPPER,
+  THRESHOLD_BETWEEN
+};
+
+// The parameters of vtkThreshold.
+struct ThresholdSettings
+{
+  int NumberOfComponents;
+  int ComponentMode;
+  int SelectedComponent;
+  int Type;
+  double Lower;
+  double Upper;
+  bool UsePointScalars;
+  bool AllScalars;
+  bool UseContinuousCellRange;
+  int PointsType;
+};
+
+// The threshold criterion of vtkThreshold, evaluated on a typed scalar
+// array with contiguous tuples.
+template <typename TScalar>
+struct ThresholdCriterion : public ThresholdSettings
+{
+  const TScalar *Scalars;
+
+  bool Test(double s) const
+    {
+    switch ( this->Type )
+      {
+      case THRESHOLD_LOWER:
+        return s <= this->Lower;
+      case THRESHOLD_UPPER:
+        return s >= this->Upper;
+      default:
+        return s >= this->Lower && s <= this->Upper;
+      }
+    }
+
+  // See vtkThreshold::EvaluateComponents().
+  bool EvaluateComponents(vtkIdType id) const
+    {
+    const TScalar *s = this->Scalars + id*this->NumberOfComponents;
+    int c;
+    switch ( this->ComponentMode )
+      {
+      case VTK_COMPONENT_MODE_USE_SELECTED:
+        c = ( this->SelectedComponent < this->NumberOfComponents ) ?
+          this->SelectedComponent : 0;
+        return this->Test(static_cast<double>(s[c]));
+      case VTK_COMPONENT_MODE_USE_ANY:
+        for ( c = 0; c < this->NumberOfComponents; ++c )
+          {
+          if ( this->Test(static_cast<double>(s[c])) )
+            {
+            return true;
+            }
+          }
+        return false;
+      case VTK_COMPONENT_MODE_USE_ALL:
+        for ( c = 0; c < this->NumberOfComponents; ++c )
+          {
+          if ( !this->Test(static_cast<double>(s[c])) )
+            {
+            return false;
+            }
+          }
+        return true;
+      }
+    return false;
+    }
+
+  // See vtkThreshold::EvaluateCell(): the range of the point scalars of the
+  // cell must intersect the threshold range.
+  bool EvaluateCell(int c, vtkIdType npts, const vtkIdType *pts) const
+    {
+    double minScalar = DBL_MAX, maxScalar = DBL_MIN;
+    for ( vtkIdType i = 0; i < npts; ++i )
+      {
+      double s = static_cast<double>(
+        this->Scalars[pts[i]*this->NumberOfComponents + c]);
+      minScalar = std::min(s, minScalar);
+      maxScalar = std::max(s, maxScalar);
+      }
+    return !(this->Lower > maxScalar || this->Upper < minScalar);
+    }
+
+  bool EvaluateCell(vtkIdType npts, const vtkIdType *pts) const
+    {
+    int c;
+    switch ( this->ComponentMode )
+      {
+      case VTK_COMPONENT_MODE_USE_SELECTED:
+        c = ( this->SelectedComponent < this->NumberOfComponents ) ?
+          this->SelectedComponent : 0;
+        return this->EvaluateCell(c, npts, pts);
+      case VTK_COMPONENT_MODE_USE_ANY:
+        for ( c = 0; c < this->NumberOfComponents; ++c )
+          {
+          if ( this->EvaluateCell(c, npts, pts) )
+            {
+            return true;
+            }
+          }
+        return false;
+      case VTK_COMPONENT_MODE_USE_ALL:
+        for ( c = 0; c < this->NumberOfComponents; ++c )
+          {
+          if ( !this->EvaluateCell(c, npts, pts) )
+            {
+            return false;
+            }
+          }
+        return true;
+      }
+    return false;
+    }
+};
+
+// Classify the cells, count the kept cells and their connectivity size per
+// chunk, and mark the points used by the kept cells.
+template <typename TInput, typename TScalar>
+struct ClassifyCells
+{
+  TInput *Input;
+  ThresholdCriterion<TScalar> Criterion;
+  vtkIdType NumberOfCells;
+  unsigned char *KeepCell;
+  vtkIdType *ChunkCells;
+  vtkIdType *ChunkConnectivity;
+  vtkAtomic<vtkIdType> *PointMap;
+
+  bool Keep(vtkIdType cellId, vtkIdType npts, const vtkIdType *pts) const
+    {
+    if ( !this->Criterion.UsePointScalars )
+      {
+      return this->Criterion.EvaluateComponents(cellId);
+      }
+    if ( this->Criterion.AllScalars )
+      {
+      for ( vtkIdType i = 0; i < npts; ++i )
+        {
+        if ( !this->Criterion.EvaluateComponents(pts[i]) )
+          {
+          return false;
+          }
+        }
+      return true;
+      }
+    if ( this->Criterion.UseContinuousCellRange )
+      {
+      return this->Criterion.EvaluateCell(npts, pts);
+      }
+    for ( vtkIdType i = 0; i < npts; ++i )
+      {
+      if ( this->Criterion.EvaluateComponents(pts[i]) )
+        {
+        return true;
+        }
+      }
+    return false;
+    }
+
+  void operator()(vtkIdType chunk, vtkIdType endChunk)
+    {
+    vtkIdType npts, *pts;
+    for ( ; chunk < endChunk; ++chunk )
+      {
+      vtkIdType cellId = chunk*ChunkSize;
+      vtkIdType endCellId = std::min(cellId + ChunkSize, this->NumberOfCells);
+      vtkIdType numCells = 0, connSize = 0;
+      for ( ; cellId < endCellId; ++cellId )
+        {
+        this->Input->GetCellPoints(cellId, npts, pts);
+        // empty cells (VTK_EMPTY_CELL) are never kept
+        this->KeepCell[cellId] = npts > 0 && this->Keep(cellId, npts, pts);
+        if ( this->KeepCell[cellId] )
+          {
+          ++numCells;
+          connSize += npts + 1;
+          for ( vtkIdType i = 0; i < npts; ++i )
+            {
+            if ( this->PointMap[pts[i]].load() == 0 )
+              {
+              this->PointMap[pts[i]].store(1);
+              }
+            }
+          }
+        }
+      this->ChunkCells[chunk] = numCells;
+      this->ChunkConnectivity[chunk] = connSize;
+      }
+    }
+};
+
+// After the exclusive scan of the point marks, PointMap[ptId] is the
+// output id of ptId if it is used, that is if PointMap[ptId+1] differs.
+struct CopyPoints
+{
+  vtkPoints *InPoints;
+  vtkPoints *OutPoints;
+  const vtkAtomic<vtkIdType> *PointMap;
+  ArrayList *Arrays;
+
+  void operator()(vtkIdType ptId, vtkIdType endPtId)
+    {
+    double x[3];
+    for ( ; ptId < endPtId; ++ptId )
+      {
+      vtkIdType newId = this->PointMap[ptId].load();
+      if ( this->PointMap[ptId+1].load() != newId )
+        {
+        this->InPoints->GetPoint(ptId, x);
+        this->OutPoints->SetPoint(newId, x);
+        if ( this->Arrays )
+          {
+          this->Arrays->Copy(ptId, newId);
+          }
+        }
+      }
+    }
+};
+
+// Write the kept cells of each chunk at the offsets computed by the scans.
+template <typename TInput>
+struct CopyCells
+{
+  TInput *Input;
+  vtkIdType NumberOfCells;
+  const unsigned char *KeepCell;
+  const vtkIdType *ChunkCells;
+  const vtkIdType *ChunkConnectivity;
+  const vtkAtomic<vtkIdType> *PointMap;
+  unsigned char *Types;
+  vtkIdType *Locations;
+  vtkIdType *Connectivity;
+  ArrayList *Arrays;
+
+  void operator()(vtkIdType chunk, vtkIdType endChunk)
+    {
+    vtkIdType npts, *pts;
+    for ( ; chunk < endChunk; ++chunk )
+      {
+      vtkIdType cellId = chunk*ChunkSize;
+      vtkIdType endCellId = std::min(cellId + ChunkSize, this->NumberOfCells);
+      vtkIdType newCellId = this->ChunkCells[chunk];
+      vtkIdType loc = this->ChunkConnectivity[chunk];
+      for ( ; cellId < endCellId; ++cellId )
+        {
+        if ( !this->KeepCell[cellId] )
+          {
+          continue;
+          }
+        this->Input->GetCellPoints(cellId, npts, pts);
+        this->Types[newCellId] =
+          static_cast<unsigned char>(this->Input->GetCellType(cellId));
+        this->Locations[newCellId] = loc;
+        this->Connectivity[loc++] = npts;
+        for ( vtkIdType i = 0; i < npts; ++i )
+          {
+          this->Connectivity[loc++] = this->PointMap[pts[i]].load();
+          }
+        if ( this->Arrays )
+          {
+          this->Arrays->Copy(cellId, newCellId);
+          }
+        ++newCellId;
+        }
+      }
+    }
+};
+
+// Set up the parallel copy of the attributes. Arrays that cannot be copied
+// in parallel (e.g. string arrays) require the serial CopyData().
+bool AddArrays(ArrayList &arrays, vtkIdType num, vtkDataSetAttributes *in,
+               vtkDataSetAttributes *out)
+{
+  out->CopyAllocate(in, num);
+  arrays.AddArrays(num, in, out, 0.0, false);
+  return static_cast<int>(arrays.Arrays.size()) == out->GetNumberOfArrays();
+}
+
+template <typename TInput, typename TScalar>
+void Execute(TInput *input, const TScalar *scalars,
+             const ThresholdSettings &settings, vtkUnstructuredGrid *output)
+{
+  vtkIdType numPts = input->GetNumberOfPoints();
+  vtkIdType numCells = input->GetNumberOfCells();
+  vtkIdType numChunks = (numCells + ChunkSize - 1) / ChunkSize;
+  vtkPointData *pd = input->GetPointData(), *outPD = output->GetPointData();
+  vtkCellData *cd = input->GetCellData(), *outCD = output->GetCellData();
+
+  // Classify the cells and mark the used points.
+  unsigned char *keepCell = new unsigned char[numCells];
+  vtkIdType *chunkCells = new vtkIdType[numChunks];
+  vtkIdType *chunkConn = new vtkIdType[numChunks];
+  vtkAtomic<vtkIdType> *pointMap = new vtkAtomic<vtkIdType>[numPts + 1];
+  vtkSMPTools::Fill(pointMap, pointMap + numPts + 1,
+                    static_cast<vtkIdType>(0));
+  ClassifyCells<TInput,TScalar> classify;
+  static_cast<ThresholdSettings&>(classify.Criterion) = settings;
+  classify.Criterion.Scalars = scalars;
+  classify.Input = input;
+  classify.NumberOfCells = numCells;
+  classify.KeepCell = keepCell;
+  classify.ChunkCells = chunkCells;
+  classify.ChunkConnectivity = chunkConn;
+  classify.PointMap = pointMap;
+  vtkSMPTools::For(0, numChunks, classify);
+
+  // Compaction
+  vtkIdType numNewCells = vtkSMPTools::ExclusiveScan(
+    chunkCells, chunkCells + numChunks, chunkCells, static_cast<vtkIdType>(0));
+  vtkIdType connSize = vtkSMPTools::ExclusiveScan(
+    chunkConn, chunkConn + numChunks, chunkConn, static_cast<vtkIdType>(0));
+  vtkIdType numNewPts = vtkSMPTools::ExclusiveScan(
+    pointMap, pointMap + numPts + 1, pointMap, static_cast<vtkIdType>(0));
+
+  // Points and point data
+  vtkPoints *newPoints = vtkPoints::New(settings.PointsType);
+  newPoints->SetNumberOfPoints(numNewPts);
+  outPD->CopyGlobalIdsOn();
+  ArrayList pointArrays;
+  bool parallelPD = AddArrays(pointArrays, numNewPts, pd, outPD);
+  CopyPoints copyPoints = {input->GetPoints(), newPoints, pointMap,
+                           parallelPD ? &pointArrays : NULL};
+  vtkSMPTools::For(0, numPts, copyPoints);
+  if ( !parallelPD )
+    {
+    for ( vtkIdType ptId = 0; ptId < numPts; ++ptId )
+      {
+      if ( pointMap[ptId+1].load() != pointMap[ptId].load() )
+        {
+        outPD->CopyData(pd, ptId, pointMap[ptId].load());
+        }
+      }
+    }
+
+  // Cells and cell data
+  vtkUnsignedCharArray *types = vtkUnsignedCharArray::New();
+  types->SetNumberOfValues(numNewCells);
+  vtkIdTypeArray *locations = vtkIdTypeArray::New();
+  locations->SetNumberOfValues(numNewCells);
+  vtkIdTypeArray *conn = vtkIdTypeArray::New();
+  conn->SetNumberOfValues(connSize);
+  outCD->CopyGlobalIdsOn();
+  ArrayList cellArrays;
+  bool parallelCD = AddArrays(cellArrays, numNewCells, cd, outCD);
+  CopyCells<TInput> copyCells = {input, numCells, keepCell, chunkCells,
+                                 chunkConn, pointMap, types->GetPointer(0),
+                                 locations->GetPointer(0), conn->GetPointer(0),
+                                 parallelCD ? &cellArrays : NULL};
+  vtkSMPTools::For(0, numChunks, copyCells);
+  if ( !parallelCD )
+    {
+    for ( vtkIdType cellId = 0, newCellId = 0; cellId < numCells; ++cellId )
+      {
+      if ( keepCell[cellId] )
+        {
+        outCD->CopyData(cd, cellId, newCellId++);
+        }
+      }
+    }
+
+  vtkCellArray *cells = vtkCellArray::New();
+  cells->SetCells(numNewCells, conn);
+  output->SetPoints(newPoints);
+  output->SetCells(types, locations, cells);
+
+  newPoints->Delete();
+  cells->Delete();
+  conn->Delete();
+  locations->Delete();
+  types->Delete();
+  delete [] pointMap;
+  delete [] chunkConn;
+  delete [] chunkCells;
+  delete [] keepCell;
+}
+
+template <typename TScalar>
+void Execute(vtkDataSet *input, const TScalar *scalars,
+             const ThresholdSettings &settings, vtkUnstructuredGrid *output)
+{
+  vtkPolyData *inputPD = vtkPolyData::SafeDownCast(input);
+  if ( inputPD )
+    {
+    Execute(inputPD, scalars, settings, output);
+    }
+  else
+    {
+    Execute(static_cast<vtkUnstructuredGrid*>(input), scalars, settings,
+            output);
+    }
+}
+
+} // end anon namespace
+
+//----------------------------------------------------------------------------
+int vtkSMPThreshold::RequestData(
+  vtkInformation *request,
+  vtkInformationVector **inputVector,
+  vtkInformationVector *outputVector)
+{
+  // get the info objects
+  vtkInformation *inInfo = inputVector[0]->GetInformationObject(0);
+  vtkInformation *outInfo = outputVector->GetInformationObject(0);
+
+  // get the input and output
+  vtkDataSet *input = vtkDataSet::SafeDownCast(
+    inInfo->Get(vtkDataObject::DATA_OBJECT()));
+  vtkUnstructuredGrid *output = vtkUnstructuredGrid::SafeDownCast(
+    outInfo->Get(vtkDataObject::DATA_OBJECT()));
+
+  vtkUnstructuredGrid *inputUG = vtkUnstructuredGrid::SafeDownCast(input);
+  vtkPolyData *inputPD = vtkPolyData::SafeDownCast(input);
+  vtkDataArray *inScalars = this->GetInputArrayToProcess(0,inputVector);
+
+  // Let the superclass handle the other cases, including the errors.
+  if ( (!inputPD && !inputUG) || (inputUG && inputUG->GetFaces()) ||
+       !input->GetNumberOfCells() || this->AttributeMode != -1 ||
+       !inScalars || !inScalars->HasStandardMemoryLayout() )
+    {
+    return this->Superclass::RequestData(request, inputVector, outputVector);
+    }
+
+  vtkDebugMacro(<< "Executing threshold filter");
+
+  ThresholdSettings settings;
+  settings.NumberOfComponents = inScalars->GetNumberOfComponents();
+  settings.ComponentMode = this->ComponentMode;
+  settings.SelectedComponent = this->SelectedComponent;
+  settings.Type = THRESHOLD_BETWEEN;
+  if ( this->ThresholdFunction == &vtkSMPThreshold::Lower )
+    {
+    settings.Type = THRESHOLD_LOWER;
+    }
+  else if ( this->ThresholdFunction == &vtkSMPThreshold::Upper )
+    {
+    settings.Type = THRESHOLD_UPPER;
+    }
+  settings.Lower = this->LowerThreshold;
+  settings.Upper = this->UpperThreshold;
+  settings.UsePointScalars = this->GetInputArrayAssociation(0, inputVector) ==
+    vtkDataObject::FIELD_ASSOCIATION_POINTS;
+  settings.AllScalars = this->AllScalars != 0;
+  settings.UseContinuousCellRange = this->UseContinuousCellRange != 0;
+
+  // set precision for the points in the output
+  vtkPoints *inPts = vtkPointSet::SafeDownCast(input)->GetPoints();
+  settings.PointsType = inPts ? inPts->GetDataType() : VTK_FLOAT;
+  if(this->OutputPointsPrecision == vtkAlgorithm::SINGLE_PRECISION)
+    {
+    settings.PointsType = VTK_FLOAT;
+    }
+  else if(this->OutputPointsPrecision == vtkAlgorithm::DOUBLE_PRECISION)
+    {
+    settings.PointsType = VTK_DOUBLE;
+    }
+
+  // Cell access must be thread safe.
+  if ( inputPD && inputPD->NeedToBuildCells() )
+    {
+    inputPD->BuildCells();
+    }
+
+  switch (inScalars->GetDataType())
+    {
+    vtkTemplateMacro(
+      Execute(input, static_cast<VTK_TT*>(inScalars->GetVoidPointer(0)),
+              settings, output));
+    default:
+      return this->Superclass::RequestData(request, inputVector,
+                                           outputVector);
+    }
+
+  vtkDebugMacro(<< "Extracted " << output->GetNumberOfCells()
+                << " number of cells.");
+
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+void vtkSMPThreshold::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os,indent);
+}
@@ -0,0 +1,62 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkSMPThreshold.h
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+// .NAME vtkSMPThreshold - multithreaded vtkThreshold
+// .SECTION Description
+// Just like parent, but uses the SMP framework to do the work on many
+// threads. The cells are classified in parallel, the kept cells and the
+// points they use are compacted with prefix sums, and the output
+// connectivity and attributes are written in parallel.
+//
+// The output cells are the same, and in the same order, as the ones
+// produced by vtkThreshold. The output points however are ordered by
+// increasing input point id rather than by first use.
+//
+// .SECTION Caveats
+// Only vtkUnstructuredGrid (without polyhedra) and vtkPolyData inputs are
+// processed in parallel, with scalars stored contiguously in memory. Other
+// inputs are handled by the superclass.
+//
+// .SECTION See Also
+// vtkThreshold
+
+#ifndef vtkSMPThreshold_h
+#define vtkSMPThreshold_h
+
+#include "vtkFiltersSMPModule.h" // For export macro
+#include "vtkThreshold.h"
+
+class VTKFILTERSSMP_EXPORT vtkSMPThreshold : public vtkThreshold
+{
+public:
+  vtkTypeMacro(vtkSMPThreshold,vtkThreshold);
+  static vtkSMPThreshold *New();
+  void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
+
+protected:
+  vtkSMPThreshold();
+  ~vtkSMPThreshold();
+
+  // Description:
+  // Overridden to use threads.
+  int RequestData(vtkInformation *,
+                  vtkInformationVector **,
+                  vtkInformationVector *) VTK_OVERRIDE;
+
+private:
+  vtkSMPThreshold(const vtkSMPThreshold&) VTK_DELETE_FUNCTION;
+  void operator=(const vtkSMPThreshold&) VTK_DELETE_FUNCTION;
+};
+
+#endif
@@ -0,0 +1,148 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    TestLZ4Compress.cxx
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+// .NAME Test of vtkLZ4DataCompressor
+// .SECTION Description
+// Uncompresses a block written by the reference LZ4 library, checks that
+// corrupted and truncated blocks are rejected, and round-trips data
+// through the compressor.
+
+#include "vtkCommand.h"
+#include "vtkLZ4DataCompressor.h"
+#include "vtkNew.h"
+#include "vtkTestErrorObserver.h"
+
+#include <cstring>
+#include <vector>
+
+namespace
+{
+
+// The data compressed in Block: repeated text, a run of bytes, literals
+// longer than 15 bytes and a repeated pair of bytes.
+std::vector<unsigned char> MakeData()
+{
+  std::vector<unsigned char> data;
+  const char *text = "vtkLZ4DataCompressor ";
+  for (int i = 0; i < 6; i++)
+    {
+    data.insert(data.end(), text, text + strlen(text));
+    }
+  data.insert(data.end(), 300, 'z');
+  for (int i = 0; i < 40; i++)
+    {
+    data.push_back(static_cast<unsigned char>((i * 37 + 11) % 256));
+    }
+  for (int i = 0; i < 50; i++)
+    {
+    data.push_back('a');
+    data.push_back('b');
+    }
+  return data;
+}
+
+// MakeData() compressed by LZ4_compress_default() of liblz4 1.9. It has
+// matches that overlap their output and lengths stored on several bytes.
+const unsigned char Block[] = {
+  0xff, 0x06, 0x76, 0x74, 0x6b, 0x4c, 0x5a, 0x34, 0x44, 0x61, 0x74, 0x61,
+  0x43, 0x6f, 0x6d, 0x70, 0x72, 0x65, 0x73, 0x73, 0x6f, 0x72, 0x20, 0x15,
+  0x00, 0x56, 0x1f, 0x7a, 0x01, 0x00, 0xff, 0x19, 0xff, 0x1b, 0x0b, 0x30,
+  0x55, 0x7a, 0x9f, 0xc4, 0xe9, 0x0e, 0x33, 0x58, 0x7d, 0xa2, 0xc7, 0xec,
+  0x11, 0x36, 0x5b, 0x80, 0xa5, 0xca, 0xef, 0x14, 0x39, 0x5e, 0x83, 0xa8,
+  0xcd, 0xf2, 0x17, 0x3c, 0x61, 0x86, 0xab, 0xd0, 0xf5, 0x1a, 0x3f, 0x64,
+  0x89, 0xae, 0x61, 0x62, 0x02, 0x00, 0x4a, 0x50, 0x62, 0x61, 0x62, 0x61,
+  0x62
+};
+const size_t BlockSize = sizeof(Block);
+
+// Uncompresses the block with the given byte replaced, if any, and checks
+// that it is rejected with an error.
+bool Reject(vtkLZ4DataCompressor *compressor, size_t size,
+            size_t uncompressedSize, size_t index, unsigned char value,
+            const char *name)
+{
+  std::vector<unsigned char> block(Block, Block + BlockSize);
+  if (index < BlockSize)
+    {
+    block[index] = value;
+    }
+  std::vector<unsigned char> output(uncompressedSize);
+  vtkNew<vtkTest::ErrorObserver> observer;
+  unsigned long tag =
+    compressor->AddObserver(vtkCommand::ErrorEvent, observer.GetPointer());
+  size_t result =
+    compressor->Uncompress(&block[0], size, &output[0], uncompressedSize);
+  compressor->RemoveObserver(tag);
+  if (result != 0 || !observer->GetError())
+    {
+    cerr << "The " << name << " block was not rejected" << endl;
+    return false;
+    }
+  return true;
+}
+
+}
+
+int TestLZ4Compress(int, char *[])
+{
+  vtkNew<vtkLZ4DataCompressor> compressor;
+  std::vector<unsigned char> data = MakeData();
+
+  // The block of the reference implementation.
+  std::vector<unsigned char> output(data.size());
+  if (compressor->Uncompress(Block, BlockSize, &output[0], output.size()) !=
+      data.size() || output != data)
+    {
+    cerr << "Could not uncompress the reference block" << endl;
+    return EXIT_FAILURE;
+    }
+
+  // Truncated in the last literals and in the offset of a match, a match
+  // before the start of the data, a literal length past the end of the
+  // block, and an unexpected uncompressed size.
+  if (!Reject(compressor.GetPointer(), BlockSize - 1, data.size(), BlockSize,
+              0, "truncated") ||
+      !Reject(compressor.GetPointer(), 24, data.size(), BlockSize, 0,
+              "truncated match") ||
+      !Reject(compressor.GetPointer(), BlockSize, data.size(), 23, 0xff,
+              "bad offset") ||
+      !Reject(compressor.GetPointer(), BlockSize, data.size(), 1, 0xff,
+              "bad length") ||
+      !Reject(compressor.GetPointer(), BlockSize, data.size() - 1, BlockSize,
+              0, "too long"))
+    {
+    return EXIT_FAILURE;
+    }
+
+  // Round trip through the compressor.
+  for (int level = 1; level <= 64; level *= 8)
+    {
+    compressor->SetAccelerationLevel(level);
+    std::vector<unsigned char> compressed(
+      compressor->GetMaximumCompressionSpace(data.size()));
+    size_t size = compressor->Compress(&data[0], data.size(),
+                                       &compressed[0], compressed.size());
+    std::vector<unsigned char> uncompressed(data.size());
+    if (size == 0 ||
+        compressor->Uncompress(&compressed[0], size, &uncompressed[0],
+                               uncompressed.size()) != data.size() ||
+        uncompressed != data)
+      {
+      cerr << "Round trip failed with acceleration " << level << endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  return EXIT_SUCCESS;
+}
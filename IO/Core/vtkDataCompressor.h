@@ -18,6 +18,10 @@
 // compression.  Subclasses provide one compression method and one
 // decompression method.  The public interface to all compressors
 // remains the same, and is defined by this class.
+//
+// The VTK XML readers and writers compress and uncompress the blocks of
+// an array from several threads at once with the same compressor, so
+// CompressBuffer and UncompressBuffer must not modify the compressor.
 
 #ifndef vtkDataCompressor_h
 #define vtkDataCompressor_h
@@ -0,0 +1,364 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkLZ4DataCompressor.cxx
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+#include "vtkLZ4DataCompressor.h"
+#include "vtkObjectFactory.h"
+
+#include <cstring>
+
+vtkStandardNewMacro(vtkLZ4DataCompressor);
+
+//----------------------------------------------------------------------------
+// The LZ4 block format is a sequence of literal bytes followed by a match,
+// repeated.  Each sequence starts with a token holding the number of
+// literals in its upper 4 bits and the length of the match minus 4 in its
+// lower 4 bits.  A value of 15 is followed by bytes which are added to it
+// until a byte smaller than 255.  The literals then follow, and the match
+// is given by its 2 bytes little-endian distance back in the uncompressed
+// data, followed by the rest of its length.  The last sequence has only
+// literals.
+namespace
+{
+
+// A match is at least 4 bytes long.
+const size_t vtkLZ4MinMatch = 4;
+
+// The last 5 bytes are always literals, and no match starts in the last
+// 12 bytes.
+const size_t vtkLZ4LastLiterals = 5;
+const size_t vtkLZ4MatchFindLimit = 12;
+
+// The largest distance back to a match.
+const size_t vtkLZ4MaxDistance = 65535;
+
+// The largest input of the format.
+const size_t vtkLZ4MaxInputSize = 0x7E000000;
+
+// The number of bits of the hash of 4 bytes used to find the matches.
+const int vtkLZ4HashLog = 12;
+
+inline vtkTypeUInt32 vtkLZ4Read32(const unsigned char* p)
+{
+  vtkTypeUInt32 value;
+  memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+inline vtkTypeUInt32 vtkLZ4Hash(const unsigned char* p)
+{
+  return (vtkLZ4Read32(p) * 2654435761U) >> (32 - vtkLZ4HashLog);
+}
+
+// Writes the part of a literal or match length which does not fit in the
+// token.
+inline unsigned char* vtkLZ4WriteLength(unsigned char* op, size_t length)
+{
+  for(length -= 15; length >= 255; length -= 255)
+    {
+    *op++ = 255;
+    }
+  *op++ = static_cast<unsigned char>(length);
+  return op;
+}
+
+// Adds to a length the bytes following a token.
+inline bool vtkLZ4ReadLength(const unsigned char*& ip,
+                             const unsigned char* iend, size_t& length)
+{
+  unsigned char byte;
+  do
+    {
+    if(ip == iend)
+      {
+      return false;
+      }
+    byte = *ip++;
+    length += byte;
+    }
+  while(byte == 255);
+  return true;
+}
+
+// Writes the literals from anchor to ip in a new sequence and returns
+// its token.
+inline unsigned char* vtkLZ4WriteLiterals(unsigned char*& op,
+                                          const unsigned char* anchor,
+                                          const unsigned char* ip)
+{
+  unsigned char* token = op++;
+  size_t length = ip - anchor;
+  if(length >= 15)
+    {
+    *token = 15 << 4;
+    op = vtkLZ4WriteLength(op, length);
+    }
+  else
+    {
+    *token = static_cast<unsigned char>(length << 4);
+    }
+  memcpy(op, anchor, length);
+  op += length;
+  return token;
+}
+
+}
+
+//----------------------------------------------------------------------------
+vtkLZ4DataCompressor::vtkLZ4DataCompressor()
+{
+  this->AccelerationLevel = 1;
+}
+
+//----------------------------------------------------------------------------
+vtkLZ4DataCompressor::~vtkLZ4DataCompressor()
+{
+}
+
+//----------------------------------------------------------------------------
+void vtkLZ4DataCompressor::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os,indent);
+
+  os << indent << "AccelerationLevel: " << this->AccelerationLevel << endl;
+}
+
+//----------------------------------------------------------------------------
+size_t
+vtkLZ4DataCompressor::CompressBuffer(unsigned char const* uncompressedData,
+                                     size_t uncompressedSize,
+                                     unsigned char* compressedData,
+                                     size_t compressionSpace)
+{
+  if(uncompressedSize > vtkLZ4MaxInputSize)
+    {
+    vtkErrorMacro("Cannot compress more than " << vtkLZ4MaxInputSize
+                  << " bytes at once.");
+    return 0;
+    }
+
+  const unsigned char* const iend = uncompressedData + uncompressedSize;
+  const unsigned char* ip = uncompressedData;
+  const unsigned char* anchor = uncompressedData;
+  unsigned char* op = compressedData;
+  unsigned char* const oend = compressedData + compressionSpace;
+
+  if(uncompressedSize > vtkLZ4MatchFindLimit)
+    {
+    const unsigned char* const mflimit = iend - vtkLZ4MatchFindLimit;
+    const unsigned char* const matchlimit = iend - vtkLZ4LastLiterals;
+
+    // The offsets of the last positions seen with each hash.  The
+    // compressor is used by several threads at once, so the table is
+    // local to this call.
+    vtkTypeUInt32 table[1 << vtkLZ4HashLog];
+    memset(table, 0, sizeof(table));
+    ++ip;
+
+    for(;;)
+      {
+      // Look for a match at the next positions.  The step between the
+      // positions grows with the number of positions tried, to go
+      // quickly through data that do not compress.
+      const unsigned char* match = 0;
+      const unsigned char* forwardIp = ip;
+      unsigned int searchCount = this->AccelerationLevel << 6;
+      bool found = false;
+      do
+        {
+        ip = forwardIp;
+        forwardIp += searchCount++ >> 6;
+        if(forwardIp > mflimit)
+          {
+          break;
+          }
+        vtkTypeUInt32 const h = vtkLZ4Hash(ip);
+        match = uncompressedData + table[h];
+        table[h] = static_cast<vtkTypeUInt32>(ip - uncompressedData);
+        found = (static_cast<size_t>(ip - match) <= vtkLZ4MaxDistance &&
+                 vtkLZ4Read32(match) == vtkLZ4Read32(ip));
+        }
+      while(!found);
+      if(!found)
+        {
+        break;
+        }
+
+      // Extend the match backwards over the pending literals, then
+      // forwards.
+      while(ip > anchor && match > uncompressedData && ip[-1] == match[-1])
+        {
+        --ip;
+        --match;
+        }
+      const unsigned char* matchEnd = ip + vtkLZ4MinMatch;
+      const unsigned char* ref = match + vtkLZ4MinMatch;
+      while(matchEnd < matchlimit && *matchEnd == *ref)
+        {
+        ++matchEnd;
+        ++ref;
+        }
+
+      // Write the sequence.
+      size_t const literalLength = ip - anchor;
+      size_t const matchLength = matchEnd - ip - vtkLZ4MinMatch;
+      if(static_cast<size_t>(oend - op) < 1 + literalLength +
+         literalLength/255 + 1 + 2 + matchLength/255 + 1)
+        {
+        vtkErrorMacro("Not enough space to compress data.");
+        return 0;
+        }
+      unsigned char* token = vtkLZ4WriteLiterals(op, anchor, ip);
+      size_t const offset = ip - match;
+      *op++ = static_cast<unsigned char>(offset & 255);
+      *op++ = static_cast<unsigned char>(offset >> 8);
+      if(matchLength >= 15)
+        {
+        *token |= 15;
+        op = vtkLZ4WriteLength(op, matchLength);
+        }
+      else
+        {
+        *token |= static_cast<unsigned char>(matchLength);
+        }
+
+      anchor = ip = matchEnd;
+      if(ip > mflimit)
+        {
+        break;
+        }
+
+      // Remember a position inside the match.
+      table[vtkLZ4Hash(ip - 2)] =
+        static_cast<vtkTypeUInt32>(ip - 2 - uncompressedData);
+      }
+    }
+
+  // Write the last literals.
+  size_t const literalLength = iend - anchor;
+  if(static_cast<size_t>(oend - op) < 1 + literalLength + literalLength/255 + 1)
+    {
+    vtkErrorMacro("Not enough space to compress data.");
+    return 0;
+    }
+  vtkLZ4WriteLiterals(op, anchor, iend);
+
+  return static_cast<size_t>(op - compressedData);
+}
+
+//----------------------------------------------------------------------------
+size_t
+vtkLZ4DataCompressor::UncompressBuffer(unsigned char const* compressedData,
+                                       size_t compressedSize,
+                                       unsigned char* uncompressedData,
+                                       size_t uncompressedSize)
+{
+  const unsigned char* ip = compressedData;
+  const unsigned char* const iend = compressedData + compressedSize;
+  unsigned char* op = uncompressedData;
+  unsigned char* const oend = uncompressedData + uncompressedSize;
+
+  // Check every length against both buffers since the data may be
+  // corrupted.
+  bool valid = true;
+  while(ip < iend)
+    {
+    unsigned int const token = *ip++;
+
+    // Copy the literals.
+    size_t length = token >> 4;
+    if(length == 15 && !vtkLZ4ReadLength(ip, iend, length))
+      {
+      valid = false;
+      break;
+      }
+    if(length > static_cast<size_t>(iend - ip) ||
+       length > static_cast<size_t>(oend - op))
+      {
+      valid = false;
+      break;
+      }
+    memcpy(op, ip, length);
+    ip += length;
+    op += length;
+
+    // The last sequence has no match.
+    if(ip == iend)
+      {
+      break;
+      }
+
+    // Copy the match, which overlaps the output when it is closer than
+    // its length.
+    if(iend - ip < 2)
+      {
+      valid = false;
+      break;
+      }
+    size_t const offset = ip[0] | (static_cast<size_t>(ip[1]) << 8);
+    ip += 2;
+    length = token & 15;
+    if(length == 15 && !vtkLZ4ReadLength(ip, iend, length))
+      {
+      valid = false;
+      break;
+      }
+    length += vtkLZ4MinMatch;
+    if(offset == 0 ||
+       offset > static_cast<size_t>(op - uncompressedData) ||
+       length > static_cast<size_t>(oend - op))
+      {
+      valid = false;
+      break;
+      }
+    const unsigned char* match = op - offset;
+    if(offset >= length)
+      {
+      memcpy(op, match, length);
+      op += length;
+      }
+    else
+      {
+      for(size_t i = 0; i < length; ++i)
+        {
+        *op++ = *match++;
+        }
+      }
+    }
+
+  if(!valid)
+    {
+    vtkErrorMacro("LZ4 error while uncompressing data.");
+    return 0;
+    }
+
+  // Make sure the output size matched that expected.
+  size_t const size = static_cast<size_t>(op - uncompressedData);
+  if(size != uncompressedSize)
+    {
+    vtkErrorMacro("Decompression produced incorrect size.\n"
+                  "Expected " << uncompressedSize << " and got " << size);
+    return 0;
+    }
+
+  return size;
+}
+
+//----------------------------------------------------------------------------
+size_t
+vtkLZ4DataCompressor::GetMaximumCompressionSpace(size_t size)
+{
+  // Data that do not compress are stored as literals, with one more byte
+  // every 255 bytes for their length.
+  return size + size/255 + 16;
+}
@@ -0,0 +1,149 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    TestSTLReaderMerging.cxx
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+// .NAME Test of the merging of the points by vtkSTLReader
+// .SECTION Description
+// Writes binary and ASCII STL files, and checks that the points merged by
+// default on one and on several threads are the same as those merged with
+// vtkMergePoints.
+
+#include "vtkCellArray.h"
+#include "vtkCellData.h"
+#include "vtkDataArray.h"
+#include "vtkMergePoints.h"
+#include "vtkNew.h"
+#include "vtkPoints.h"
+#include "vtkPolyData.h"
+#include "vtkSMPTools.h"
+#include "vtkSTLReader.h"
+#include "vtkSTLWriter.h"
+#include "vtkSmartPointer.h"
+#include "vtkSphereSource.h"
+#include "vtkTestUtilities.h"
+
+#include <string>
+
+namespace
+{
+
+// A sphere with a degenerate triangle, and points at 0 and -0.
+vtkSmartPointer<vtkPolyData> MakeInput()
+{
+  vtkNew<vtkSphereSource> sphere;
+  sphere->SetThetaResolution(30);
+  sphere->SetPhiResolution(20);
+  sphere->Update();
+  vtkSmartPointer<vtkPolyData> input = vtkSmartPointer<vtkPolyData>::New();
+  input->DeepCopy(sphere->GetOutput());
+
+  vtkPoints *points = input->GetPoints();
+  vtkIdType ids[4];
+  ids[0] = points->InsertNextPoint(0.0, 0.0, 2.0);
+  ids[1] = points->InsertNextPoint(-0.0, 0.0, 2.0);
+  ids[2] = points->InsertNextPoint(0.0, 1.0, 2.0);
+  ids[3] = points->InsertNextPoint(1.0, 0.0, -0.0);
+  input->GetPolys()->InsertNextCell(3, ids);
+  input->GetPolys()->InsertNextCell(3, ids + 1);
+  return input;
+}
+
+vtkSmartPointer<vtkPolyData> Read(const std::string &filename, bool locator,
+                                  int threads)
+{
+  vtkSMPTools::Initialize(threads);
+  vtkNew<vtkSTLReader> reader;
+  reader->SetFileName(filename.c_str());
+  reader->ScalarTagsOn();
+  if (locator)
+    {
+    vtkNew<vtkMergePoints> mergePoints;
+    reader->SetLocator(mergePoints.GetPointer());
+    }
+  reader->Update();
+  return reader->GetOutput();
+}
+
+bool CompareArrays(vtkDataArray *a, vtkDataArray *b)
+{
+  if (!a || !b || a->GetNumberOfTuples() != b->GetNumberOfTuples() ||
+      a->GetNumberOfComponents() != b->GetNumberOfComponents())
+    {
+    return a == b;
+    }
+  for (vtkIdType i = 0; i < a->GetNumberOfTuples(); i++)
+    {
+    for (int j = 0; j < a->GetNumberOfComponents(); j++)
+      {
+      if (a->GetComponent(i, j) != b->GetComponent(i, j))
+        {
+        return false;
+        }
+      }
+    }
+  return true;
+}
+
+bool CompareOutputs(vtkPolyData *a, vtkPolyData *b)
+{
+  return CompareArrays(a->GetPoints()->GetData(), b->GetPoints()->GetData()) &&
+    CompareArrays(a->GetPolys()->GetData(), b->GetPolys()->GetData()) &&
+    CompareArrays(a->GetCellData()->GetScalars(),
+                  b->GetCellData()->GetScalars());
+}
+
+}
+
+int TestSTLReaderMerging(int argc, char *argv[])
+{
+  char *temp_dir_c =
+    vtkTestUtilities::GetArgOrEnvOrDefault("-T", argc, argv,
+                                           "VTK_TEMP_DIR",
+                                           "Testing/Temporary");
+  std::string filename = std::string(temp_dir_c) + "/TestSTLReaderMerging.stl";
+  delete [] temp_dir_c;
+
+  vtkSmartPointer<vtkPolyData> input = MakeInput();
+  for (int binary = 0; binary < 2; binary++)
+    {
+    vtkNew<vtkSTLWriter> writer;
+    writer->SetInputData(input);
+    writer->SetFileName(filename.c_str());
+    writer->SetFileType(binary ? VTK_BINARY : VTK_ASCII);
+    writer->Write();
+
+    vtkSmartPointer<vtkPolyData> expected = Read(filename, true, 1);
+    // The degenerate triangle is removed.
+    if (expected->GetNumberOfPoints() != input->GetNumberOfPoints() - 1 ||
+        expected->GetNumberOfPolys() != input->GetNumberOfPolys() - 1)
+      {
+      cerr << "Wrong number of points or triangles read with vtkMergePoints"
+           << endl;
+      return EXIT_FAILURE;
+      }
+
+    for (int threads = 1; threads <= 4; threads += 3)
+      {
+      vtkSmartPointer<vtkPolyData> output = Read(filename, false, threads);
+      if (!CompareOutputs(expected, output))
+        {
+        cerr << "Different points merged in the "
+             << (binary ? "binary" : "ASCII") << " file on " << threads
+             << " threads" << endl;
+        return EXIT_FAILURE;
+        }
+      }
+    }
+
+  return EXIT_SUCCESS;
+}
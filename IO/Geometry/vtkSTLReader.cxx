@@ -19,19 +19,23 @@
 #include "vtkCellData.h"
 #include "vtkErrorCode.h"
 #include "vtkFloatArray.h"
+#include "vtkIdTypeArray.h"
 #include "vtkIncrementalPointLocator.h"
 #include "vtkInformation.h"
 #include "vtkInformationVector.h"
 #include "vtkMergePoints.h"
 #include "vtkObjectFactory.h"
 #include "vtkPolyData.h"
+#include "vtkSMPTools.h"
 #include "vtkSmartPointer.h"
 #include "vtkStreamingDemandDrivenPipeline.h"
 
 #include <algorithm>
 #include <cctype>
+#include <cstring>
 #include <stdexcept>
 #include <string>
+#include <vector>
 #include <vtksys/SystemTools.hxx>
 
 vtkStandardNewMacro(vtkSTLReader);
@@ -41,6 +45,87 @@ vtkStandardNewMacro(vtkSTLReader);
 
 vtkCxxSetObjectMacro(vtkSTLReader, Locator, vtkIncrementalPointLocator);
 
+namespace
+{
+
+// The coordinates of a point as integers, which are equal when the
+// coordinates are, and the point id.
+struct vtkSTLReaderPointKey
+{
+  vtkTypeUInt32 X[3];
+  vtkIdType Id;
+
+  bool SamePoint(const vtkSTLReaderPointKey& other) const
+  {
+    return this->X[0] == other.X[0] && this->X[1] == other.X[1] &&
+      this->X[2] == other.X[2];
+  }
+
+  // The same points are sorted by id.
+  bool operator<(const vtkSTLReaderPointKey& other) const
+  {
+    for (int i = 0; i < 3; i++)
+      {
+      if (this->X[i] != other.X[i])
+        {
+        return this->X[i] < other.X[i];
+        }
+      }
+    return this->Id < other.Id;
+  }
+};
+
+struct vtkSTLReaderMakeKeys
+{
+  const float* Points;
+  vtkSTLReaderPointKey* Keys;
+
+  void operator()(vtkIdType begin, vtkIdType end) const
+  {
+    for (vtkIdType ptId = begin; ptId < end; ptId++)
+      {
+      vtkSTLReaderPointKey& key = this->Keys[ptId];
+      memcpy(key.X, this->Points + 3 * ptId, sizeof(key.X));
+      for (int i = 0; i < 3; i++)
+        {
+        // -0 is equal to 0.
+        if (key.X[i] == 0x80000000)
+          {
+          key.X[i] = 0;
+          }
+        }
+      key.Id = ptId;
+      }
+  }
+};
+
+// Gives each point the id of the first point equal to it.
+struct vtkSTLReaderFindFirstPoints
+{
+  const vtkSTLReaderPointKey* Keys;
+  vtkIdType* FirstIds;
+
+  void operator()(vtkIdType begin, vtkIdType end) const
+  {
+    vtkIdType first = begin;
+    while (first > 0 && this->Keys[first - 1].SamePoint(this->Keys[begin]))
+      {
+      first--;
+      }
+    vtkIdType firstId = this->Keys[first].Id;
+    for (vtkIdType i = begin; i < end; i++)
+      {
+      if (i > first && !this->Keys[i].SamePoint(this->Keys[i - 1]))
+        {
+        firstId = this->Keys[i].Id;
+        }
+      this->FirstIds[this->Keys[i].Id] = firstId;
+      }
+  }
+};
+
+}
+
 //------------------------------------------------------------------------------
 // Construct object with merging set to true.
 vtkSTLReader::vtkSTLReader()
@@ -160,46 +245,49 @@ int vtkSTLReader::RequestData(
   if (this->Merging)
     {
     mergedPts = vtkPoints::New();
-    mergedPts->Allocate(newPts->GetNumberOfPoints() /2);
     mergedPolys = vtkCellArray::New();
-    mergedPolys->Allocate(newPolys->GetSize());
     if (newScalars)
       {
       mergedScalars = vtkFloatArray::New();
-      mergedScalars->Allocate(newPolys->GetSize());
+      mergedScalars->Allocate(newPolys->GetNumberOfCells());
       }
 
-    vtkSmartPointer<vtkIncrementalPointLocator> locator = this->Locator;
     if (this->Locator == NULL)
       {
-      locator.TakeReference(this->NewDefaultLocator());
+      this->MergePoints(newPts, newPolys, newScalars,
+                        mergedPts, mergedPolys, mergedScalars);
       }
-    locator->InitPointInsertion(mergedPts, newPts->GetBounds());
-
-    int nextCell = 0;
-    vtkIdType *pts = 0;
-    vtkIdType npts;
-    for (newPolys->InitTraversal(); newPolys->GetNextCell(npts, pts);)
+    else
       {
-      vtkIdType nodes[3];
-      for (int i = 0; i < 3; i++)
+      mergedPts->Allocate(newPts->GetNumberOfPoints() /2);
+      mergedPolys->Allocate(newPolys->GetSize());
+      this->Locator->InitPointInsertion(mergedPts, newPts->GetBounds());
+
+      int nextCell = 0;
+      vtkIdType *pts = 0;
+      vtkIdType npts;
+      for (newPolys->InitTraversal(); newPolys->GetNextCell(npts, pts);)
         {
-        double x[3];
-        newPts->GetPoint(pts[i], x);
-        locator->InsertUniquePoint(x, nodes[i]);
-        }
+        vtkIdType nodes[3];
+        for (int i = 0; i < 3; i++)
+          {
+          double x[3];
+          newPts->GetPoint(pts[i], x);
+          this->Locator->InsertUniquePoint(x, nodes[i]);
+          }
 
-      if (nodes[0] != nodes[1] &&
-        nodes[0] != nodes[2] &&
-        nodes[1] != nodes[2])
-        {
-        mergedPolys->InsertNextCell(3, nodes);
-        if (newScalars)
+        if (nodes[0] != nodes[1] &&
+          nodes[0] != nodes[2] &&
+          nodes[1] != nodes[2])
           {
-          mergedScalars->InsertNextValue(newScalars->GetValue(nextCell));
+          mergedPolys->InsertNextCell(3, nodes);
+          if (newScalars)
+            {
+            mergedScalars->InsertNextValue(newScalars->GetValue(nextCell));
+            }
           }
+        nextCell++;
         }
-      nextCell++;
       }
 
     newPts->Delete();
@@ -241,8 +329,6 @@ int vtkSTLReader::RequestData(
 bool vtkSTLReader::ReadBinarySTL(FILE *fp, vtkPoints *newPts,
                                  vtkCellArray *newPolys)
 {
-  typedef struct { float  n[3], v1[3], v2[3], v3[3]; } facet_t;
-
   vtkDebugMacro(<< "Reading BINARY STL file");
 
   //  File is read to obtain raw information as well as bounding box
@@ -255,7 +341,7 @@ bool vtkSTLReader::ReadBinarySTL(FILE *fp, vtkPoints *newPts,
     return false;
     }
 
-  unsigned long ulint;
+  vtkTypeUInt32 ulint;
   if (fread(&ulint, 1, 4, fp) != 4)
     {
     vtkErrorMacro("STLReader error reading file: " << this->FileName
@@ -267,69 +353,146 @@ bool vtkSTLReader::ReadBinarySTL(FILE *fp, vtkPoints *newPts,
   // Many .stl files contain bogus count.  Hence we will ignore and read
   //   until end of file.
   //
-  int numTris = static_cast<int>(ulint);
-  if (numTris <= 0)
+  int numHeaderTris = static_cast<int>(ulint);
+  if (numHeaderTris <= 0)
     {
     vtkDebugMacro(<< "Bad binary count: attempting to correct("
-      << numTris << ")");
+      << numHeaderTris << ")");
     }
 
-  // Verify the numTris with the length of the file
+  // Get the numTris from the length of the file
   unsigned long ulFileLength = vtksys::SystemTools::FileLength(this->FileName);
   ulFileLength -= (80 + 4); // 80 byte - header, 4 byte - tringle count
   ulFileLength /= 50;       // 50 byte - twelve 32-bit-floating point numbers + 2 byte for attribute byte count
-
-  if (numTris < static_cast<int>(ulFileLength))
-    {
-    numTris = static_cast<int>(ulFileLength);
-    }
-
-  // now we can allocate the memory we need for this STL file
-  newPts->Allocate(numTris * 3);
-  newPolys->Allocate(numTris);
-
-  facet_t facet;
-  for (int i = 0; fread(&facet, 48, 1, fp) > 0; i++)
+  vtkIdType numTris = static_cast<vtkIdType>(ulFileLength);
+
+  // Read the facets by blocks directly into the points and the cells.
+  // Each facet is made of its normal, its 3 points and 2 bytes of extra
+  // junk.
+  newPts->SetNumberOfPoints(3 * numTris);
+  float *points = static_cast<float*>(newPts->GetVoidPointer(0));
+  vtkIdTypeArray *cells = vtkIdTypeArray::New();
+  cells->SetNumberOfValues(4 * numTris);
+  vtkIdType *cell = cells->GetPointer(0);
+
+  const size_t facetSize = 50;
+  const size_t blockSize = 4096;
+  std::vector<char> block(blockSize * facetSize);
+  vtkIdType numFacets = 0;
+  size_t bytesRead = 0;
+  do
     {
-    unsigned short ibuff2;
-    if (fread(&ibuff2, 2, 1, fp) != 1) //read extra junk
+    bytesRead = fread(&block[0], 1, block.size(), fp);
+    size_t numBlockFacets = bytesRead / facetSize;
+    if (bytesRead % facetSize >= 48)
       {
       vtkErrorMacro("STLReader error reading file: " << this->FileName
         << " Premature EOF while reading extra junk.");
+      cells->Delete();
       return false;
       }
+    for (size_t i = 0; i < numBlockFacets && numFacets < numTris; i++)
+      {
+      float *facetPoints = points + 9 * numFacets;
+      memcpy(facetPoints, &block[i * facetSize + 12], 9 * sizeof(float));
+      vtkByteSwap::Swap4LERange(facetPoints, 9);
+
+      vtkIdType ptId = 3 * numFacets;
+      *cell++ = 3;
+      *cell++ = ptId;
+      *cell++ = ptId + 1;
+      *cell++ = ptId + 2;
+      numFacets++;
+      }
 
-    vtkByteSwap::Swap4LE(facet.n);
-    vtkByteSwap::Swap4LE(facet.n+1);
-    vtkByteSwap::Swap4LE(facet.n+2);
-
-    vtkByteSwap::Swap4LE(facet.v1);
-    vtkByteSwap::Swap4LE(facet.v1+1);
-    vtkByteSwap::Swap4LE(facet.v1+2);
+    vtkDebugMacro(<< "triangle# " << numFacets);
+    if (numTris > 0)
+      {
+      this->UpdateProgress(static_cast<double>(numFacets) / numTris);
+      }
+    }
+  while (bytesRead == block.size() && numFacets < numTris);
 
-    vtkByteSwap::Swap4LE(facet.v2);
-    vtkByteSwap::Swap4LE(facet.v2+1);
-    vtkByteSwap::Swap4LE(facet.v2+2);
+  newPts->SetNumberOfPoints(3 * numFacets);
+  cells->SetNumberOfValues(4 * numFacets);
+  newPolys->SetCells(numFacets, cells);
+  cells->Delete();
 
-    vtkByteSwap::Swap4LE(facet.v3);
-    vtkByteSwap::Swap4LE(facet.v3+1);
-    vtkByteSwap::Swap4LE(facet.v3+2);
+  return true;
+}
 
-    vtkIdType pts[3];
-    pts[0] = newPts->InsertNextPoint(facet.v1);
-    pts[1] = newPts->InsertNextPoint(facet.v2);
-    pts[2] = newPts->InsertNextPoint(facet.v3);
+//------------------------------------------------------------------------------
+// Merges the points equal to each other by sorting them in parallel.  The
+// points are numbered in the order they are used by the triangles, so that
+// the result is the same as with vtkMergePoints.
+void vtkSTLReader::MergePoints(vtkPoints *newPts, vtkCellArray *newPolys,
+                               vtkFloatArray *newScalars,
+                               vtkPoints *mergedPts, vtkCellArray *mergedPolys,
+                               vtkFloatArray *mergedScalars)
+{
+  vtkIdType numPts = newPts->GetNumberOfPoints();
+  const float *points = static_cast<float*>(newPts->GetVoidPointer(0));
+  std::vector<vtkIdType> firstIds(numPts);
+  if (numPts > 0)
+    {
+    std::vector<vtkSTLReaderPointKey> keys(numPts);
+    vtkSTLReaderMakeKeys makeKeys;
+    makeKeys.Points = points;
+    makeKeys.Keys = &keys[0];
+    vtkSMPTools::For(0, numPts, makeKeys);
+    vtkSMPTools::Sort(keys.begin(), keys.end());
+    vtkSTLReaderFindFirstPoints findFirstPoints;
+    findFirstPoints.Keys = &keys[0];
+    findFirstPoints.FirstIds = &firstIds[0];
+    vtkSMPTools::For(0, numPts, findFirstPoints);
+    }
 
-    newPolys->InsertNextCell(3, pts);
+  std::vector<vtkIdType> newIds(numPts, -1);
+  mergedPts->SetNumberOfPoints(numPts);
+  float *merged = static_cast<float*>(mergedPts->GetVoidPointer(0));
+  vtkIdType numMergedPts = 0;
+  vtkIdTypeArray *cells = vtkIdTypeArray::New();
+  cells->SetNumberOfValues(newPolys->GetNumberOfConnectivityEntries());
+  vtkIdType *cell = cells->GetPointer(0);
+  vtkIdType numCells = 0;
+
+  vtkIdType cellId = 0;
+  vtkIdType *pts = 0;
+  vtkIdType npts;
+  for (newPolys->InitTraversal(); newPolys->GetNextCell(npts, pts); cellId++)
+    {
+    vtkIdType nodes[3];
+    for (int i = 0; i < 3; i++)
+      {
+      vtkIdType &newId = newIds[firstIds[pts[i]]];
+      if (newId < 0)
+        {
+        newId = numMergedPts++;
+        memcpy(merged + 3 * newId, points + 3 * pts[i], 3 * sizeof(float));
+        }
+      nodes[i] = newId;
+      }
 
-    if ((i % 5000) == 0 && i != 0)
+    if (nodes[0] != nodes[1] &&
+      nodes[0] != nodes[2] &&
+      nodes[1] != nodes[2])
       {
-      vtkDebugMacro(<< "triangle# " << i);
-      this->UpdateProgress(static_cast<double>(i) / numTris);
+      *cell++ = 3;
+      *cell++ = nodes[0];
+      *cell++ = nodes[1];
+      *cell++ = nodes[2];
+      numCells++;
+      if (newScalars)
+        {
+        mergedScalars->InsertNextValue(newScalars->GetValue(cellId));
+        }
       }
     }
 
-  return true;
+  mergedPts->SetNumberOfPoints(numMergedPts);
+  cells->SetNumberOfValues(4 * numCells);
+  mergedPolys->SetCells(numCells, cells);
+  cells->Delete();
 }
 
 //------------------------------------------------------------------------------
@@ -22,8 +22,8 @@
 // .stl files are quite inefficient since they duplicate vertex
 // definitions. By setting the Merging boolean you can control whether the
 // point data is merged after reading. Merging is performed by default,
-// however, merging requires a large amount of temporary storage since a
-// 3D hash table must be constructed.
+// however, merging requires a large amount of temporary storage since the
+// points must be sorted.
 
 // .SECTION Caveats
 // Binary files written on one system may not be readable on other systems.
@@ -68,8 +68,9 @@ public:
   vtkBooleanMacro(ScalarTags,int);
 
   // Description:
-  // Specify a spatial locator for merging points. By
-  // default an instance of vtkMergePoints is used.
+  // Specify a spatial locator for merging points. By default the points
+  // are sorted in parallel to merge them, which gives the same points and
+  // triangles as an instance of vtkMergePoints.
   void SetLocator(vtkIncrementalPointLocator *locator);
   vtkGetObjectMacro(Locator,vtkIncrementalPointLocator);
 
@@ -78,7 +79,7 @@ protected:
   ~vtkSTLReader();
 
   // Description:
-  // Create default locator. Used to create one when none is specified.
+  // Create default locator, an instance of vtkMergePoints.
   vtkIncrementalPointLocator* NewDefaultLocator();
 
   int Merging;
@@ -87,6 +88,8 @@ protected:
 
   int RequestData(vtkInformation *, vtkInformationVector **, vtkInformationVector *);
   bool ReadBinarySTL(FILE *fp, vtkPoints*, vtkCellArray*);
+  void MergePoints(vtkPoints*, vtkCellArray*, vtkFloatArray*,
+                   vtkPoints*, vtkCellArray*, vtkFloatArray*);
   bool ReadASCIISTL(FILE *fp, vtkPoints*, vtkCellArray*,
                     vtkFloatArray* scalars=0);
   int GetSTLFileType(const char *filename);
@@ -0,0 +1,137 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    TestLegacyASCIIData.cxx
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+
+// Reads numbers written in various forms in an ASCII legacy file and
+// compares them with the values read by a stream.
+
+#include "vtkDataArray.h"
+#include "vtkNew.h"
+#include "vtkPointData.h"
+#include "vtkPoints.h"
+#include "vtkPolyData.h"
+#include "vtkPolyDataReader.h"
+
+#include <locale>
+#include <sstream>
+#include <string>
+
+namespace {
+
+const char *Reals[] = {
+  "0", "-0", "1", "+2.5", "-2.5E+2", ".5", "5.", "0.1", "1e-3", "7e22",
+  "3.4028235e38", "1.17549435e-38", "0.30000000000000004",
+  "123456789012345678901234567890", "9007199254740993",
+  "0.000000000000000000000000000001234", "6.02214076e23",
+  "1.00000005960464477539062", "1.0000000596046448", "33554431",
+  "0.1000000000000000055511151231257827", "1e1", "3.14159265358979"
+};
+const int NumberOfReals = sizeof(Reals) / sizeof(Reals[0]);
+
+const char *Integers[] = {
+  "0", "-0", "+7", "00012", "-2147483648", "2147483647", "65536", "-1"
+};
+const int NumberOfIntegers = sizeof(Integers) / sizeof(Integers[0]);
+
+template <class T>
+T ReadValue(const char *text)
+{
+  std::istringstream stream(text);
+  stream.imbue(std::locale::classic());
+  T value = 0;
+  stream >> value;
+  return value;
+}
+
+// The points are 3 reals each, padded with zeros.
+std::string MakeFile()
+{
+  int numPts = (NumberOfReals + 2) / 3;
+  std::ostringstream file;
+  file << "# vtk DataFile Version 3.0\n"
+       << "numbers\n"
+       << "ASCII\n"
+       << "DATASET POLYDATA\n"
+       << "POINTS " << numPts << " float\n";
+  for (int i = 0; i < 3 * numPts; i++)
+    {
+    file << (i < NumberOfReals ? Reals[i] : "0") << (i % 3 == 2 ? "\n" : " ");
+    }
+  file << "VERTICES 1 " << NumberOfIntegers + 1 << "\n"
+       << NumberOfIntegers;
+  for (int i = 0; i < NumberOfIntegers; i++)
+    {
+    file << " " << i % numPts;
+    }
+  file << "\n"
+       << "POINT_DATA " << numPts << "\n"
+       << "FIELD FieldData 2\n"
+       << "Doubles 3 " << numPts << " double\n";
+  for (int i = 0; i < 3 * numPts; i++)
+    {
+    file << "  " << (i < NumberOfReals ? Reals[i] : "0");
+    }
+  file << "\n"
+       << "Ints 1 " << NumberOfIntegers << " int\n";
+  for (int i = 0; i < NumberOfIntegers; i++)
+    {
+    file << Integers[i] << "\t";
+    }
+  file << "\n";
+  return file.str();
+}
+
+}
+
+int TestLegacyASCIIData(int, char *[])
+{
+  vtkNew<vtkPolyDataReader> reader;
+  reader->ReadFromInputStringOn();
+  reader->SetInputString(MakeFile());
+  reader->Update();
+  vtkPolyData *output = reader->GetOutput();
+
+  vtkDataArray *points = output->GetPoints() ?
+    output->GetPoints()->GetData() : NULL;
+  vtkDataArray *doubles = output->GetPointData()->GetArray("Doubles");
+  vtkDataArray *ints = output->GetPointData()->GetArray("Ints");
+  if (!points || !doubles || !ints || output->GetNumberOfVerts() != 1 ||
+      ints->GetNumberOfTuples() != NumberOfIntegers)
+    {
+    cerr << "Could not read the file" << endl;
+    return EXIT_FAILURE;
+    }
+
+  for (int i = 0; i < NumberOfReals; i++)
+    {
+    float f = ReadValue<float>(Reals[i]);
+    double d = ReadValue<double>(Reals[i]);
+    if (points->GetComponent(i / 3, i % 3) != f ||
+        doubles->GetComponent(i / 3, i % 3) != d)
+      {
+      cerr << "Wrong value read for " << Reals[i] << endl;
+      return EXIT_FAILURE;
+      }
+    }
+  for (int i = 0; i < NumberOfIntegers; i++)
+    {
+    if (ints->GetComponent(i, 0) != ReadValue<int>(Integers[i]))
+      {
+      cerr << "Wrong value read for " << Integers[i] << endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -59,6 +59,10 @@
 #include "vtkTypeUInt64Array.h"
 
 #include <cctype>
+#include <cfloat>
+#include <cstring>
+#include <limits>
+#include <locale>
 #include <sys/stat.h>
 
 // I need a safe way to read a line of arbitrary length.  It exists on
@@ -237,132 +241,351 @@ int vtkDataReader::ReadString(char result[256])
   return 1;
 }
 
-// Internal function to read in an integer value.
-// Returns zero if there was an error.
-int vtkDataReader::Read(char *result)
+// The numbers are parsed directly from the buffer of the stream, which
+// is much faster than its formatted input and does not depend on the
+// locale.  The values not handled exactly below are given to a stream
+// using the classic locale.
+namespace
 {
-  int intData;
-  *this->IS >> intData;
-  if (this->IS->fail())
+
+// Extended precision would round the real values twice.
+#if (defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD != 0) || \
+    (defined(__FLT_EVAL_METHOD__) && __FLT_EVAL_METHOD__ != 0)
+const bool vtkDataReaderFastReals = false;
+#else
+const bool vtkDataReaderFastReals = true;
+#endif
+
+// The longest number parsed.
+const size_t vtkDataReaderMaxTokenLength = 255;
+
+// Skips the white space and copies the characters of the next number into
+// token, as the formatted input of the stream would.  Returns false if the
+// number is too long.
+bool vtkDataReaderScanNumber(istream *is, bool real,
+                             char token[vtkDataReaderMaxTokenLength + 1])
+{
+  typedef std::char_traits<char> traits;
+  std::streambuf *sb = is->rdbuf();
+  traits::int_type c = sb->sgetc();
+  while (!traits::eq_int_type(c, traits::eof()) && isspace(c))
     {
-    return 0;
+    c = sb->snextc();
     }
 
-  *result = (char) intData;
-  return 1;
+  size_t n = 0;
+  bool digits = false;
+  bool point = false;
+  bool exponent = false;
+  while (!traits::eq_int_type(c, traits::eof()) &&
+         n < vtkDataReaderMaxTokenLength)
+    {
+    if (c >= '0' && c <= '9')
+      {
+      digits = true;
+      }
+    else if ((c == '+' || c == '-') &&
+             (n == 0 || (token[n-1] == 'e' || token[n-1] == 'E')))
+      {
+      }
+    else if (real && c == '.' && !point && !exponent)
+      {
+      point = true;
+      }
+    else if (real && (c == 'e' || c == 'E') && digits && !exponent)
+      {
+      exponent = true;
+      }
+    else
+      {
+      break;
+      }
+    token[n++] = traits::to_char_type(c);
+    c = sb->snextc();
+    }
+  token[n] = '\0';
+
+  if (traits::eq_int_type(c, traits::eof()))
+    {
+    is->setstate(ios::eofbit);
+    }
+  return n < vtkDataReaderMaxTokenLength;
 }
 
-int vtkDataReader::Read(unsigned char *result)
+// Parses a number with a stream using the classic locale.
+template <class T>
+int vtkDataReaderParseToken(istream *is, const char *token, T *result)
 {
-  int intData;
-  *this->IS >> intData;
-  if (this->IS->fail())
+  std::istringstream tokenStream(token);
+  tokenStream.imbue(std::locale::classic());
+  tokenStream >> *result;
+  if (tokenStream.fail() || !tokenStream.eof())
     {
+    is->setstate(ios::failbit);
     return 0;
     }
-
-  *result = (unsigned char) intData;
   return 1;
 }
 
-int vtkDataReader::Read(short *result)
+template <class T>
+int vtkDataReaderReadInteger(istream *is, T *result)
 {
-  *this->IS >> *result;
-  if (this->IS->fail())
+  if (!is->good())
+    {
+    is->setstate(ios::failbit);
+    return 0;
+    }
+  char token[vtkDataReaderMaxTokenLength + 1];
+  if (!vtkDataReaderScanNumber(is, false, token))
     {
+    is->setstate(ios::failbit);
     return 0;
     }
+
+  const char *p = token;
+  bool negative = (*p == '-');
+  if (*p == '-' || *p == '+')
+    {
+    ++p;
+    }
+  const char *digits = p;
+  vtkTypeUInt64 value = 0;
+  for (; *p && p - digits < 18; ++p)
+    {
+    value = 10 * value + (*p - '0');
+    }
+
+  // Leave the long, negative unsigned and out of range values to the
+  // stream.
+  const vtkTypeUInt64 max =
+    static_cast<vtkTypeUInt64>(std::numeric_limits<T>::max());
+  if (p == digits || *p ||
+      (negative && !std::numeric_limits<T>::is_signed) ||
+      value > max + (negative ? 1 : 0))
+    {
+    return vtkDataReaderParseToken(is, token, result);
+    }
+  *result = negative ?
+    static_cast<T>(-static_cast<vtkTypeInt64>(value)) : static_cast<T>(value);
   return 1;
 }
 
-int vtkDataReader::Read(unsigned short *result)
+// Parses the values with at most 19 significant digits whose mantissa
+// and power of ten are exact doubles, so that a single operation rounds
+// them correctly.  Returns false for the other values.
+bool vtkDataReaderParseReal(const char *token, double *result)
 {
-  *this->IS >> *result;
-  if (this->IS->fail())
+  static const double powers[] =
     {
-    return 0;
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+
+  const char *p = token;
+  bool negative = (*p == '-');
+  if (*p == '-' || *p == '+')
+    {
+    ++p;
     }
-  return 1;
+
+  vtkTypeUInt64 mantissa = 0;
+  int numDigits = 0;
+  int exponent = 0;
+  bool digits = false;
+  for (; *p >= '0' && *p <= '9'; ++p)
+    {
+    digits = true;
+    if (mantissa || *p != '0')
+      {
+      mantissa = 10 * mantissa + (*p - '0');
+      ++numDigits;
+      }
+    }
+  if (*p == '.')
+    {
+    for (++p; *p >= '0' && *p <= '9'; ++p)
+      {
+      digits = true;
+      if (mantissa || *p != '0')
+        {
+        mantissa = 10 * mantissa + (*p - '0');
+        ++numDigits;
+        }
+      --exponent;
+      }
+    }
+  if (!digits || numDigits > 19)
+    {
+    return false;
+    }
+  if (*p == 'e' || *p == 'E')
+    {
+    ++p;
+    bool negativeExponent = (*p == '-');
+    if (*p == '-' || *p == '+')
+      {
+      ++p;
+      }
+    int value = 0;
+    const char *exponentDigits = p;
+    for (; *p >= '0' && *p <= '9' && p - exponentDigits < 5; ++p)
+      {
+      value = 10 * value + (*p - '0');
+      }
+    if (p == exponentDigits)
+      {
+      return false;
+      }
+    exponent += negativeExponent ? -value : value;
+    }
+  if (*p)
+    {
+    return false;
+    }
+
+  double value;
+  if (mantissa == 0)
+    {
+    value = 0.0;
+    }
+  else if (mantissa <= (static_cast<vtkTypeUInt64>(1) << 53) &&
+           exponent >= -22 && exponent <= 22)
+    {
+    value = static_cast<double>(mantissa);
+    value = exponent < 0 ? value / powers[-exponent] :
+      value * powers[exponent];
+    }
+  else
+    {
+    return false;
+    }
+  *result = negative ? -value : value;
+  return true;
 }
 
-int vtkDataReader::Read(int *result)
+// Rounds a value parsed as a double to the type read.
+bool vtkDataReaderRoundReal(double value, double *result)
 {
-  *this->IS >> *result;
-  if (this->IS->fail())
+  *result = value;
+  return true;
+}
+
+bool vtkDataReaderRoundReal(double value, float *result)
+{
+  // The double is the value correctly rounded, so the float nearest to it
+  // is nearest to the value unless the double is halfway between two
+  // floats, or out of the range of the normalized floats.
+  double magnitude = value < 0.0 ? -value : value;
+  vtkTypeUInt64 bits;
+  memcpy(&bits, &value, sizeof(bits));
+  if (magnitude > FLT_MAX || (magnitude != 0.0 && magnitude < FLT_MIN) ||
+      (bits & 0x1FFFFFFF) == 0x10000000)
     {
-    return 0;
+    return false;
     }
-  return 1;
+  *result = static_cast<float>(value);
+  return true;
 }
 
-int vtkDataReader::Read(unsigned int *result)
+template <class T>
+int vtkDataReaderReadReal(istream *is, T *result)
 {
-  *this->IS >> *result;
-  if (this->IS->fail())
+  if (!is->good())
     {
+    is->setstate(ios::failbit);
     return 0;
     }
+  char token[vtkDataReaderMaxTokenLength + 1];
+  if (!vtkDataReaderScanNumber(is, true, token))
+    {
+    is->setstate(ios::failbit);
+    return 0;
+    }
+  double value;
+  if (!vtkDataReaderFastReals || !vtkDataReaderParseReal(token, &value) ||
+      !vtkDataReaderRoundReal(value, result))
+    {
+    return vtkDataReaderParseToken(is, token, result);
+    }
   return 1;
 }
 
-int vtkDataReader::Read(long *result)
+}
+
+// Internal function to read in an integer value.
+// Returns zero if there was an error.
+int vtkDataReader::Read(char *result)
 {
-  *this->IS >> *result;
-  if (this->IS->fail())
+  int intData;
+  if (!vtkDataReaderReadInteger(this->IS, &intData))
     {
     return 0;
     }
+
+  *result = (char) intData;
   return 1;
 }
 
-int vtkDataReader::Read(unsigned long *result)
+int vtkDataReader::Read(unsigned char *result)
 {
-  *this->IS >> *result;
-  if (this->IS->fail())
+  int intData;
+  if (!vtkDataReaderReadInteger(this->IS, &intData))
     {
     return 0;
     }
+
+  *result = (unsigned char) intData;
   return 1;
 }
 
+int vtkDataReader::Read(short *result)
+{
+  return vtkDataReaderReadInteger(this->IS, result);
+}
+
+int vtkDataReader::Read(unsigned short *result)
+{
+  return vtkDataReaderReadInteger(this->IS, result);
+}
+
+int vtkDataReader::Read(int *result)
+{
+  return vtkDataReaderReadInteger(this->IS, result);
+}
+
+int vtkDataReader::Read(unsigned int *result)
+{
+  return vtkDataReaderReadInteger(this->IS, result);
+}
+
+int vtkDataReader::Read(long *result)
+{
+  return vtkDataReaderReadInteger(this->IS, result);
+}
+
+int vtkDataReader::Read(unsigned long *result)
+{
+  return vtkDataReaderReadInteger(this->IS, result);
+}
+
 int vtkDataReader::Read(long long *result)
 {
-  *this->IS >> *result;
-  if (this->IS->fail())
-    {
-    return 0;
-    }
-  return 1;
+  return vtkDataReaderReadInteger(this->IS, result);
 }
 
 int vtkDataReader::Read(unsigned long long *result)
 {
-  *this->IS >> *result;
-  if (this->IS->fail())
-    {
-    return 0;
-    }
-  return 1;
+  return vtkDataReaderReadInteger(this->IS, result);
 }
 
 int vtkDataReader::Read(float *result)
 {
-  *this->IS >> *result;
-  if (this->IS->fail())
-    {
-    return 0;
-    }
-  return 1;
+  return vtkDataReaderReadReal(this->IS, result);
 }
 
 int vtkDataReader::Read(double *result)
 {
-  *this->IS >> *result;
-  if (this->IS->fail())
-    {
-    return 0;
-    }
-  return 1;
+  return vtkDataReaderReadReal(this->IS, result);
 }
 
 size_t vtkDataReader::Peek(char *str, size_t n)
@@ -0,0 +1,208 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    TestXMLCompressionParallel.cxx
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+// .NAME Test of the parallel compression of the VTK XML writer and reader
+// .SECTION Description
+// Writes image data compressed with zlib and LZ4 on one and on several
+// threads, checks that the outputs are the same, and reads the whole data
+// and a sub-extent back on several threads.
+
+#include "vtkAlgorithm.h"
+#include "vtkDoubleArray.h"
+#include "vtkIdTypeArray.h"
+#include "vtkImageData.h"
+#include "vtkNew.h"
+#include "vtkPointData.h"
+#include "vtkSMPTools.h"
+#include "vtkStringArray.h"
+#include "vtkUnsignedCharArray.h"
+#include "vtkXMLImageDataReader.h"
+#include "vtkXMLImageDataWriter.h"
+
+#include <sstream>
+#include <string>
+
+namespace
+{
+
+void MakeImage(vtkImageData *image)
+{
+  // The vectors are larger than the amount of data compressed at once.
+  image->SetExtent(0, 79, 0, 79, 0, 109);
+  vtkIdType numPts = image->GetNumberOfPoints();
+
+  vtkNew<vtkDoubleArray> vectors;
+  vectors->SetName("Vectors");
+  vectors->SetNumberOfComponents(3);
+  vectors->SetNumberOfTuples(numPts);
+  vtkNew<vtkIdTypeArray> ids;
+  ids->SetName("Ids");
+  ids->SetNumberOfTuples(numPts);
+  vtkNew<vtkUnsignedCharArray> bytes;
+  bytes->SetName("Bytes");
+  bytes->SetNumberOfTuples(numPts);
+  for (vtkIdType i = 0; i < numPts; i++)
+    {
+    vectors->SetTuple3(i, 0.5 * i, (i % 97) * 0.25, -1.0 * (i % 1013));
+    ids->SetValue(i, numPts - i);
+    bytes->SetValue(i, static_cast<unsigned char>(i % 251));
+    }
+  image->GetPointData()->AddArray(vectors.GetPointer());
+  image->GetPointData()->AddArray(ids.GetPointer());
+  image->GetPointData()->AddArray(bytes.GetPointer());
+
+  // Some strings are longer than a block.
+  vtkNew<vtkStringArray> strings;
+  strings->SetName("Strings");
+  for (int i = 0; i < 100; i++)
+    {
+    std::ostringstream str;
+    str << "String" << i << std::string(i * 50, 'a' + i % 26);
+    strings->InsertNextValue(str.str());
+    }
+  image->GetFieldData()->AddArray(strings.GetPointer());
+}
+
+// Writing caches the ranges in the arrays, so each file is written from a
+// new image.
+std::string Write(int compressorType, int dataMode, int threads)
+{
+  vtkNew<vtkImageData> image;
+  MakeImage(image.GetPointer());
+  vtkSMPTools::Initialize(threads);
+  vtkNew<vtkXMLImageDataWriter> writer;
+  writer->SetInputData(image.GetPointer());
+  writer->SetCompressorType(compressorType);
+  writer->SetDataMode(dataMode);
+  writer->EncodeAppendedDataOff();
+  writer->SetByteOrderToBigEndian();
+  writer->SetIdTypeToInt32();
+  writer->SetBlockSize(1024);
+  writer->WriteToOutputStringOn();
+  writer->Write();
+  return writer->GetOutputString();
+}
+
+bool CompareArrays(vtkDataArray *a, vtkDataArray *b,
+                   const int extent[6], const int subExtent[6])
+{
+  if (!a || !b || a->GetNumberOfComponents() != b->GetNumberOfComponents())
+    {
+    return false;
+    }
+  int numComp = a->GetNumberOfComponents();
+  vtkIdType subId = 0;
+  for (int k = subExtent[4]; k <= subExtent[5]; k++)
+    {
+    for (int j = subExtent[2]; j <= subExtent[3]; j++)
+      {
+      for (int i = subExtent[0]; i <= subExtent[1]; i++, subId++)
+        {
+        vtkIdType id = (i - extent[0]) + (extent[1] - extent[0] + 1) *
+          ((j - extent[2]) + (extent[3] - extent[2] + 1) * (k - extent[4]));
+        for (int c = 0; c < numComp; c++)
+          {
+          if (a->GetComponent(id, c) != b->GetComponent(subId, c))
+            {
+            return false;
+            }
+          }
+        }
+      }
+    }
+  return true;
+}
+
+bool Read(vtkImageData *image, const std::string &file, const int subExtent[6])
+{
+  vtkSMPTools::Initialize(4);
+  vtkNew<vtkXMLImageDataReader> reader;
+  reader->ReadFromInputStringOn();
+  reader->SetInputString(file);
+  // UpdateExtent() is hidden by an ivar of vtkXMLStructuredDataReader.
+  vtkAlgorithm *algorithm = reader.GetPointer();
+  algorithm->UpdateExtent(subExtent);
+  vtkImageData *output = reader->GetOutput();
+
+  int extent[6];
+  image->GetExtent(extent);
+  vtkPointData *pd = image->GetPointData();
+  for (int i = 0; i < pd->GetNumberOfArrays(); i++)
+    {
+    const char *name = pd->GetArrayName(i);
+    if (!CompareArrays(pd->GetArray(i), output->GetPointData()->GetArray(name),
+                       extent, subExtent))
+      {
+      cerr << "Wrong values in " << name << endl;
+      return false;
+      }
+    }
+
+  vtkStringArray *strings =
+    vtkStringArray::SafeDownCast(image->GetFieldData()->GetAbstractArray(0));
+  vtkStringArray *readStrings = vtkStringArray::SafeDownCast(
+    output->GetFieldData()->GetAbstractArray(strings->GetName()));
+  if (!readStrings ||
+      readStrings->GetNumberOfValues() != strings->GetNumberOfValues())
+    {
+    cerr << "Wrong strings" << endl;
+    return false;
+    }
+  for (vtkIdType i = 0; i < strings->GetNumberOfValues(); i++)
+    {
+    if (readStrings->GetValue(i) != strings->GetValue(i))
+      {
+      cerr << "Wrong string " << i << endl;
+      return false;
+      }
+    }
+  return true;
+}
+
+}
+
+int TestXMLCompressionParallel(int, char *[])
+{
+  vtkNew<vtkImageData> image;
+  MakeImage(image.GetPointer());
+
+  int compressors[2] = { vtkXMLWriter::ZLIB, vtkXMLWriter::LZ4 };
+  int modes[2] = { vtkXMLWriter::Appended, vtkXMLWriter::Binary };
+  for (int c = 0; c < 2; c++)
+    {
+    for (int m = 0; m < 2; m++)
+      {
+      std::string serial = Write(compressors[c], modes[m], 1);
+      std::string parallel = Write(compressors[c], modes[m], 4);
+      if (serial != parallel)
+        {
+        cerr << "Different files written with compressor " << compressors[c]
+             << " in mode " << modes[m] << endl;
+        return EXIT_FAILURE;
+        }
+
+      int wholeExtent[6] = { 0, 79, 0, 79, 0, 109 };
+      int subExtent[6] = { 3, 41, 17, 18, 50, 95 };
+      if (!Read(image.GetPointer(), parallel, wholeExtent) ||
+          !Read(image.GetPointer(), parallel, subExtent))
+        {
+        cerr << "Could not read the file written with compressor "
+             << compressors[c] << " in mode " << modes[m] << endl;
+        return EXIT_FAILURE;
+        }
+      }
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,265 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    TestXMLMemoryMappedData.cxx
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+// .NAME Test of the memory mapping of appended data by the VTK XML readers
+// .SECTION Description
+// Writes image data with raw appended data, reads it back with and
+// without memory mapping, and checks that the arrays read are the same,
+// that the uncompressed arrays were mapped from aligned data, that they
+// outlive the reader and that they can be modified without changing the
+// file.
+
+#include "vtkDoubleArray.h"
+#include "vtkFloatArray.h"
+#include "vtkImageData.h"
+#include "vtkIntArray.h"
+#include "vtkNew.h"
+#include "vtkObjectFactory.h"
+#include "vtkPointData.h"
+#include "vtkSmartPointer.h"
+#include "vtkStringArray.h"
+#include "vtkTestUtilities.h"
+#include "vtkUnsignedCharArray.h"
+#include "vtkXMLDataElement.h"
+#include "vtkXMLDataParser.h"
+#include "vtkXMLImageDataReader.h"
+#include "vtkXMLImageDataWriter.h"
+
+#include <cstring>
+#include <string>
+
+// Exposes the number of arrays mapped from the file by the last update.
+class vtkTestMappingImageDataReader : public vtkXMLImageDataReader
+{
+public:
+  static vtkTestMappingImageDataReader *New();
+  vtkTypeMacro(vtkTestMappingImageDataReader, vtkXMLImageDataReader);
+
+  int GetNumberOfMappedArrays() { return this->NumberOfMappedArrays; }
+
+protected:
+  vtkTestMappingImageDataReader() {}
+
+private:
+  vtkTestMappingImageDataReader(const vtkTestMappingImageDataReader&) VTK_DELETE_FUNCTION;
+  void operator=(const vtkTestMappingImageDataReader&) VTK_DELETE_FUNCTION;
+};
+
+vtkStandardNewMacro(vtkTestMappingImageDataReader);
+
+namespace
+{
+
+void MakeImage(vtkImageData *image)
+{
+  image->SetExtent(0, 39, 0, 29, 0, 19);
+  vtkIdType numPts = image->GetNumberOfPoints();
+
+  vtkNew<vtkUnsignedCharArray> bytes;
+  bytes->SetName("Bytes");
+  bytes->SetNumberOfTuples(numPts);
+  vtkNew<vtkFloatArray> vectors;
+  vectors->SetName("Vectors");
+  vectors->SetNumberOfComponents(3);
+  vectors->SetNumberOfTuples(numPts);
+  vtkNew<vtkIntArray> ints;
+  ints->SetName("Ints");
+  ints->SetNumberOfTuples(numPts);
+  vtkNew<vtkDoubleArray> doubles;
+  doubles->SetName("Doubles");
+  doubles->SetNumberOfTuples(numPts);
+  for (vtkIdType i = 0; i < numPts; i++)
+    {
+    bytes->SetValue(i, static_cast<unsigned char>(i % 253));
+    vectors->SetTuple3(i, 0.5 * i, (i % 97) * 0.25, -1.0 * (i % 1013));
+    ints->SetValue(i, static_cast<int>(numPts - i));
+    doubles->SetValue(i, i / 7.0);
+    }
+  image->GetPointData()->AddArray(bytes.GetPointer());
+  image->GetPointData()->AddArray(vectors.GetPointer());
+  image->GetPointData()->AddArray(ints.GetPointer());
+  image->GetPointData()->AddArray(doubles.GetPointer());
+
+  vtkNew<vtkStringArray> strings;
+  strings->SetName("Strings");
+  strings->InsertNextValue("first");
+  strings->InsertNextValue("second");
+  image->GetFieldData()->AddArray(strings.GetPointer());
+}
+
+// Checks that the raw data of the arrays written uncompressed start at a
+// multiple of their word size in the file, and that the mapped arrays are
+// aligned in memory.
+bool CheckAlignment(vtkXMLDataElement *element, vtkTypeInt64 dataPosition,
+                    int headerSize, vtkImageData *mapped)
+{
+  vtkTypeInt64 offset = 0;
+  const char *name = element->GetAttribute("Name");
+  vtkDataArray *array = name ? mapped->GetPointData()->GetArray(name) : 0;
+  if (array && strcmp(element->GetName(), "DataArray") == 0 &&
+      element->GetScalarAttribute("offset", offset))
+    {
+    int wordSize = array->GetDataTypeSize();
+    if ((dataPosition + offset + headerSize) % wordSize != 0 ||
+        reinterpret_cast<size_t>(array->GetVoidPointer(0)) % wordSize != 0)
+      {
+      cerr << "The data of " << name << " are not aligned" << endl;
+      return false;
+      }
+    }
+  for (int i = 0; i < element->GetNumberOfNestedElements(); i++)
+    {
+    if (!CheckAlignment(element->GetNestedElement(i), dataPosition,
+                        headerSize, mapped))
+      {
+      return false;
+      }
+    }
+  return true;
+}
+
+// Reads the file and checks the number of arrays mapped from it, and their
+// alignment if any.
+vtkSmartPointer<vtkImageData> Read(const std::string &filename, bool map,
+                                   int numMapped, int headerSize)
+{
+  vtkNew<vtkTestMappingImageDataReader> reader;
+  reader->SetFileName(filename.c_str());
+  reader->SetMemoryMapAppendedData(map);
+  reader->Update();
+  if (reader->GetNumberOfMappedArrays() != numMapped)
+    {
+    cerr << reader->GetNumberOfMappedArrays() << " arrays mapped instead of "
+         << numMapped << endl;
+    return 0;
+    }
+  vtkXMLDataParser *parser = reader->GetXMLParser();
+  if (numMapped > 0 &&
+      !CheckAlignment(parser->GetRootElement(),
+                      parser->GetAppendedDataPosition(), headerSize,
+                      reader->GetOutput()))
+    {
+    return 0;
+    }
+  return reader->GetOutput();
+}
+
+bool CompareArrays(vtkDataArray *a, vtkDataArray *b)
+{
+  if (!a || !b || a->GetNumberOfTuples() != b->GetNumberOfTuples() ||
+      a->GetNumberOfComponents() != b->GetNumberOfComponents())
+    {
+    return false;
+    }
+  for (vtkIdType i = 0; i < a->GetNumberOfTuples(); i++)
+    {
+    for (int c = 0; c < a->GetNumberOfComponents(); c++)
+      {
+      if (a->GetComponent(i, c) != b->GetComponent(i, c))
+        {
+        return false;
+        }
+      }
+    }
+  return true;
+}
+
+bool CompareImages(vtkImageData *a, vtkImageData *b)
+{
+  vtkPointData *pd = a->GetPointData();
+  for (int i = 0; i < pd->GetNumberOfArrays(); i++)
+    {
+    const char *name = pd->GetArrayName(i);
+    if (!CompareArrays(pd->GetArray(i), b->GetPointData()->GetArray(name)))
+      {
+      cerr << "Wrong values in " << name << endl;
+      return false;
+      }
+    }
+  vtkStringArray *strings = vtkStringArray::SafeDownCast(
+    b->GetFieldData()->GetAbstractArray("Strings"));
+  if (!strings || strings->GetNumberOfValues() != 2 ||
+      strings->GetValue(1) != "second")
+    {
+    cerr << "Wrong strings" << endl;
+    return false;
+    }
+  return true;
+}
+
+}
+
+int TestXMLMemoryMappedData(int argc, char *argv[])
+{
+  char* temp_dir_c =
+    vtkTestUtilities::GetArgOrEnvOrDefault("-T", argc, argv,
+                                           "VTK_TEMP_DIR",
+                                           "Testing/Temporary");
+  std::string temp_dir = std::string(temp_dir_c);
+  delete [] temp_dir_c;
+
+  vtkNew<vtkImageData> image;
+  MakeImage(image.GetPointer());
+
+  // The arrays are mapped from raw appended data in the native byte order,
+  // and read otherwise.
+  int headerTypes[2] = { vtkXMLWriter::UInt32, vtkXMLWriter::UInt64 };
+  int compressors[2] = { vtkXMLWriter::NONE, vtkXMLWriter::ZLIB };
+  for (int h = 0; h < 2; h++)
+    {
+    for (int c = 0; c < 2; c++)
+      {
+      std::string filename = temp_dir + "/TestXMLMemoryMappedData.vti";
+      vtkNew<vtkXMLImageDataWriter> writer;
+      writer->SetFileName(filename.c_str());
+      writer->SetInputData(image.GetPointer());
+      writer->SetDataModeToAppended();
+      writer->EncodeAppendedDataOff();
+      writer->SetHeaderType(headerTypes[h]);
+      writer->SetCompressorType(compressors[c]);
+      writer->Write();
+
+      // The 4 numeric arrays are mapped, but not the strings.
+      int numMapped = (compressors[c] == vtkXMLWriter::NONE ? 4 : 0);
+      int headerSize = (headerTypes[h] == vtkXMLWriter::UInt32 ? 4 : 8);
+      vtkSmartPointer<vtkImageData> read = Read(filename, false, 0, headerSize);
+      vtkSmartPointer<vtkImageData> mapped =
+        Read(filename, true, numMapped, headerSize);
+      if (!read || !mapped ||
+          !CompareImages(image.GetPointer(), read) ||
+          !CompareImages(image.GetPointer(), mapped))
+        {
+        cerr << "Could not read the file written with header type "
+             << headerTypes[h] << " and compressor " << compressors[c]
+             << endl;
+        return EXIT_FAILURE;
+        }
+
+      // Modifying the arrays does not change the file.
+      vtkPointData *pd = mapped->GetPointData();
+      for (int i = 0; i < pd->GetNumberOfArrays(); i++)
+        {
+        pd->GetArray(i)->SetComponent(0, 0, 42.0);
+        }
+      mapped = Read(filename, true, numMapped, headerSize);
+      if (!mapped || !CompareImages(image.GetPointer(), mapped))
+        {
+        cerr << "The file changed with the arrays mapped from it" << endl;
+        return EXIT_FAILURE;
+        }
+      }
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -377,6 +377,7 @@ vtkDataSet* vtkXMLCompositeDataReader::ReadDataset(vtkXMLDataElement* xmlElem,
     return 0;
     }
   reader->SetFileName(fileName.c_str());
+  reader->SetMemoryMapAppendedData(this->MemoryMapAppendedData);
   // initialize array selection so we don't have any residual array selections
   // from previous use of the reader.
   reader->GetPointDataArraySelection()->RemoveAllArrays();
@@ -14,6 +14,7 @@
 =========================================================================*/
 #include "vtkXMLDataReader.h"
 
+#include "vtkAOSDataArrayTemplate.h"
 #include "vtkArrayIteratorIncludes.h"
 #include "vtkCallbackCommand.h"
 #include "vtkCellData.h"
@@ -723,6 +724,42 @@ void vtkXMLDataReader::ConvertGhostLevelsToGhostType(
 
 
 
+//----------------------------------------------------------------------------
+// Uses the raw appended data of a whole array in place in a mapping of the
+// file in memory.  Returns 0 if the data must be read instead.
+template <class iterT>
+int vtkXMLDataReaderMapArrayValues(vtkXMLDataElement* da,
+  vtkXMLDataParser* xmlparser, iterT* iter, vtkIdType numValues)
+{
+  typedef vtkAOSDataArrayTemplate<typename iterT::ValueType> ArrayType;
+  ArrayType* array = iter ? ArrayType::SafeDownCast(iter->GetArray()) : 0;
+  vtkTypeInt64 offset = 0;
+  if (!array || array->GetNumberOfValues() != numValues ||
+      !da->GetScalarAttribute("offset", offset))
+    {
+    return 0;
+    }
+  vtkObjectBase* mapping;
+  void* data = xmlparser->MapAppendedData(offset, numValues,
+                                          array->GetDataType(), mapping);
+  if (!data)
+    {
+    return 0;
+    }
+  array->SetArray(static_cast<typename iterT::ValueType*>(data), numValues,
+                  mapping);
+  mapping->UnRegister(0);
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+template<>
+int vtkXMLDataReaderMapArrayValues(vtkXMLDataElement*, vtkXMLDataParser*,
+  vtkArrayIteratorTemplate<vtkStdString>*, vtkIdType)
+{
+  return 0;
+}
+
 //----------------------------------------------------------------------------
 int vtkXMLDataReader::ReadArrayValues(
   vtkXMLDataElement* da, vtkIdType arrayIndex,
@@ -736,13 +773,20 @@ int vtkXMLDataReader::ReadArrayValues(
     }
   this->InReadData = 1;
   int result;
+  // Whole arrays may be mapped from the file.
+  bool map = (this->MemoryMapAppendedData && arrayIndex == 0 &&
+              startIndex == 0);
+  int mapped = 0;
   // All arrays types except vtkBitArray.
   vtkArrayIterator* iter = array->NewIterator();
   switch (array->GetDataType())
     {
     vtkArrayIteratorTemplateMacro(
-      result = vtkXMLDataReaderReadArrayValues(da, this->XMLParser,
-        arrayIndex, static_cast<VTK_TT*>(iter), startIndex, numValues));
+      mapped = map && vtkXMLDataReaderMapArrayValues(da, this->XMLParser,
+                        static_cast<VTK_TT*>(iter), numValues);
+      result = mapped ||
+        vtkXMLDataReaderReadArrayValues(da, this->XMLParser,
+          arrayIndex, static_cast<VTK_TT*>(iter), startIndex, numValues));
   default:
     result = 0;
     }
@@ -750,6 +794,10 @@ int vtkXMLDataReader::ReadArrayValues(
     {
     iter->Delete();
     }
+  if (mapped)
+    {
+    ++this->NumberOfMappedArrays;
+    }
 
   this->ConvertGhostLevelsToGhostType(fieldType, array, startIndex, numValues);
   // Marking the array modified is essential, since otherwise, when reading
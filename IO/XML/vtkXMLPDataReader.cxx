@@ -345,6 +345,7 @@ int vtkXMLPDataReader::ReadPiece(vtkXMLDataElement* ePiece)
   this->PieceReaders[this->Piece]->AddObserver(vtkCommand::ProgressEvent,
                                                this->PieceProgressObserver);
   reader->SetFileName(pieceFileName);
+  reader->SetMemoryMapAppendedData(this->MemoryMapAppendedData);
 
   delete [] pieceFileName;
 
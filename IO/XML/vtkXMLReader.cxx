@@ -32,6 +32,7 @@
 #include "vtkInformationUnsignedLongKey.h"
 #include "vtkInformationVector.h"
 #include "vtkInstantiator.h"
+#include "vtkLZ4DataCompressor.h"
 #include "vtkObjectFactory.h"
 #include "vtkQuadratureSchemeDefinition.h"
 #include "vtkStreamingDemandDrivenPipeline.h"
@@ -101,6 +102,8 @@ vtkXMLReader::vtkXMLReader()
   this->StringStream = 0;
   this->ReadFromInputString = 0;
   this->InputString = "";
+  this->MemoryMapAppendedData = 0;
+  this->NumberOfMappedArrays = 0;
   this->XMLParser = 0;
   this->ReaderErrorObserver = 0;
   this->ParserErrorObserver = 0;
@@ -188,6 +191,10 @@ void vtkXMLReader::PrintSelf(ostream& os, vtkIndent indent)
     {
     os << indent << "Stream: (none)\n";
     }
+  os << indent << "MemoryMapAppendedData: " << this->MemoryMapAppendedData
+     << "\n";
+  os << indent << "NumberOfMappedArrays: " << this->NumberOfMappedArrays
+     << "\n";
   os << indent << "TimeStep:" << this->TimeStep << "\n";
   os << indent << "NumberOfTimeSteps:" << this->NumberOfTimeSteps << "\n";
   os << indent << "TimeStepRange:(" << this->TimeStepRange[0] << ","
@@ -400,12 +407,17 @@ void vtkXMLReader::SetupCompressor(const char* type)
   vtkObject* object = vtkInstantiator::CreateInstance(type);
   vtkDataCompressor* compressor = vtkDataCompressor::SafeDownCast(object);
 
-  // In static builds, the vtkZLibDataCompressor may not have been
-  // registered with the vtkInstantiator.  Check for it here.
+  // In static builds, the vtkZLibDataCompressor and vtkLZ4DataCompressor
+  // may not have been registered with the vtkInstantiator.  Check for them
+  // here.
   if (!compressor && (strcmp(type, "vtkZLibDataCompressor") == 0))
     {
     compressor = vtkZLibDataCompressor::New();
     }
+  else if (!compressor && (strcmp(type, "vtkLZ4DataCompressor") == 0))
+    {
+    compressor = vtkLZ4DataCompressor::New();
+    }
 
   if (!compressor)
     {
@@ -529,6 +541,7 @@ int vtkXMLReader::RequestData(vtkInformation *vtkNotUsed(request),
                               vtkInformationVector *outputVector)
 {
   this->CurrentTimeStep = this->TimeStep;
+  this->NumberOfMappedArrays = 0;
 
   // Get the output pipeline information and data object.
   vtkInformation* outInfo = outputVector->GetInformationObject(0);
@@ -592,6 +605,12 @@ int vtkXMLReader::RequestData(vtkInformation *vtkNotUsed(request),
   (*this->Stream).imbue(std::locale::classic());
   this->XMLParser->SetStream(this->Stream);
 
+  // The parser maps the appended data from the file when it is given its
+  // name.
+  this->XMLParser->SetFileName(
+    (this->MemoryMapAppendedData && !this->ReadFromInputString) ?
+    this->FileName : 0);
+
   // We are just starting to read.  Do not call UpdateProgressDiscrete
   // because we want a 0 progress callback the first time.
   this->UpdateProgress(0.);
@@ -55,6 +55,18 @@ public:
   vtkBooleanMacro(ReadFromInputString, int);
   void SetInputString(std::string s) { this->InputString = s; }
 
+  // Description:
+  // Enable mapping the file in memory to use the arrays stored in raw
+  // uncompressed appended data in place, instead of reading them.  The
+  // pages of an array are then only read from the file when they are
+  // first accessed.  This is done for the whole arrays stored in the
+  // byte order of this machine and aligned in the file for their type,
+  // on systems providing mmap.  The file must not be modified while the
+  // arrays are in use.  Default is 0: the arrays are read.
+  vtkSetMacro(MemoryMapAppendedData, int);
+  vtkGetMacro(MemoryMapAppendedData, int);
+  vtkBooleanMacro(MemoryMapAppendedData, int);
+
   // Description:
   // Test whether the file (type) with the given name can be read by this
   // reader. If the file has a newer version than the reader, we still say
@@ -255,6 +267,12 @@ protected:
   // The input string.
   std::string InputString;
 
+  // Whether the raw appended data are mapped in memory.
+  int MemoryMapAppendedData;
+
+  // The number of arrays mapped from the file by the last update.
+  int NumberOfMappedArrays;
+
   // The array selections.
   vtkDataArraySelection* PointDataArraySelection;
   vtkDataArraySelection* CellDataArraySelection;
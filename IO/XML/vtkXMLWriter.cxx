@@ -36,10 +36,12 @@
 #include "vtkInformationStringVectorKey.h"
 #include "vtkInformationUnsignedLongKey.h"
 #include "vtkInformationVector.h"
+#include "vtkLZ4DataCompressor.h"
 #include "vtkNew.h"
 #include "vtkOutputStream.h"
 #include "vtkPointData.h"
 #include "vtkPoints.h"
+#include "vtkSMPTools.h"
 #include "vtkStdString.h"
 #include "vtkStreamingDemandDrivenPipeline.h"
 #include "vtkUnsignedCharArray.h"
@@ -61,6 +63,7 @@
 #include <cassert>
 #include <sstream>
 #include <string>
+#include <vector>
 
 #if !defined(_WIN32) || defined(__CYGWIN__)
 # include <unistd.h> /* unlink */
@@ -100,8 +103,46 @@ public:
    }
 };
 
+//*****************************************************************************
+// Blocks of data waiting to be compressed together, each one stored at a
+// multiple of the block size, and the buffer receiving them compressed.
+class vtkXMLWriterCompressionBlocks
+{
+public:
+  std::vector<unsigned char> Data;
+  std::vector<size_t> Sizes;
+  std::vector<unsigned char> CompressedData;
+  std::vector<size_t> CompressedSizes;
+};
+
 namespace {
 
+// The amount of data compressed at once by the threads.
+const size_t vtkXMLWriterCompressionBatchSize = 16777216;
+
+// Compresses each block into its own range of the compressed buffer.
+struct CompressBlocksFunctor
+{
+  vtkDataCompressor *Compressor;
+  const unsigned char *Data;
+  size_t BlockSize;
+  const size_t *Sizes;
+  unsigned char *CompressedData;
+  size_t CompressionSpace;
+  size_t *CompressedSizes;
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    for (vtkIdType i = begin; i < end; ++i)
+      {
+      this->CompressedSizes[i] = this->Compressor->Compress(
+        this->Data + i * this->BlockSize, this->Sizes[i],
+        this->CompressedData + i * this->CompressionSpace,
+        this->CompressionSpace);
+      }
+  }
+};
+
 struct WriteBinaryDataBlockWorker
 {
   vtkXMLWriter *Writer;
@@ -346,7 +387,6 @@ static int vtkXMLWriterWriteBinaryDataBlocks(
       const char* data = str.c_str();
       data += stringOffset; // advance by the chars already written.
       length -= stringOffset;
-      stringOffset = 0;
       if (length == 0)
         {
         // just write the string termination char.
@@ -363,12 +403,15 @@ static int vtkXMLWriterWriteBinaryDataBlocks(
           }
         else
           {
+          // The rest of the string goes in the next blocks.
           size_t bytes_to_copy =  (maxCharsPerBlock - cur_offset);
-          stringOffset = bytes_to_copy;
+          stringOffset += bytes_to_copy;
           memcpy(&temp_buffer[cur_offset], data, bytes_to_copy);
           cur_offset += bytes_to_copy;
+          continue;
           }
         }
+      stringOffset = 0;
       index++;
       }
     if (cur_offset > 0)
@@ -422,6 +465,7 @@ vtkXMLWriter::vtkXMLWriter()
   this->BlockSize = 32768; //2^15
   this->Compressor = vtkZLibDataCompressor::New();
   this->CompressionHeader = 0;
+  this->CompressionBlocks = new vtkXMLWriterCompressionBlocks;
   this->Int32IdTypeBuffer = 0;
   this->ByteSwapBuffer = 0;
 
@@ -452,6 +496,7 @@ vtkXMLWriter::~vtkXMLWriter()
   this->SetFileName(0);
   this->DataStream->Delete();
   this->SetCompressor(0);
+  delete this->CompressionBlocks;
   delete this->OutFile;
   this->OutFile = 0;
   delete this->OutStringStream;
@@ -476,8 +521,12 @@ void vtkXMLWriter::SetCompressorType(int compressorType)
 
   if (compressorType == ZLIB)
     {
-    if (this->Compressor && !this->Compressor->IsTypeOf("vtkZLibDataCompressor"))
+    if (this->Compressor)
       {
+      if (this->Compressor->IsA("vtkZLibDataCompressor"))
+        {
+        return;
+        }
       this->Compressor->Delete();
       }
 
@@ -485,6 +534,22 @@ void vtkXMLWriter::SetCompressorType(int compressorType)
     this->Modified();
     return;
     }
+
+  if (compressorType == LZ4)
+    {
+    if (this->Compressor)
+      {
+      if (this->Compressor->IsA("vtkLZ4DataCompressor"))
+        {
+        return;
+        }
+      this->Compressor->Delete();
+      }
+
+    this->Compressor = vtkLZ4DataCompressor::New();
+    this->Modified();
+    return;
+    }
 }
 
 //----------------------------------------------------------------------------
@@ -1234,6 +1299,12 @@ int vtkXMLWriter::WriteBinaryData(vtkAbstractArray* a)
       result = 0;
       }
 
+    // Compress and write the last blocks.
+    if (result && !this->FlushCompressionBlocks())
+      {
+      result = 0;
+      }
+
     // Finish writing the data.
     if (result && !this->DataStream->EndWriting())
       {
@@ -1415,12 +1486,13 @@ int vtkXMLWriter::WriteBinaryDataInternal(vtkAbstractArray* a)
     ret = 0;
     }
 
-  // Free the byte swap buffer if it was allocated.
+  // Free the byte swap buffer if it was allocated.  When it shares the
+  // id-type conversion buffer, it is freed with it below.
   if (!this->Int32IdTypeBuffer)
     {
     delete [] this->ByteSwapBuffer;
-    this->ByteSwapBuffer = 0;
     }
+  this->ByteSwapBuffer = 0;
 
 #ifdef VTK_USE_64BIT_IDS
   // Free the id-type conversion buffer if it was allocated.
@@ -1584,6 +1656,7 @@ int vtkXMLWriter::CreateCompressionHeader(size_t size)
 
   // Initialize counter for block writing.
   this->CompressionBlockNumber = 0;
+  this->CompressionBlocks->Sizes.clear();
 
   return result;
 }
@@ -1591,26 +1664,71 @@ int vtkXMLWriter::CreateCompressionHeader(size_t size)
 //----------------------------------------------------------------------------
 int vtkXMLWriter::WriteCompressionBlock(unsigned char* data, size_t size)
 {
-  // Compress the data.
-  vtkUnsignedCharArray* outputArray = this->Compressor->Compress(data, size);
+  // Keep the block until enough blocks are gathered to be compressed in
+  // parallel.
+  vtkXMLWriterCompressionBlocks* blocks = this->CompressionBlocks;
+  size_t numBlocks = blocks->Sizes.size();
+  if (blocks->Data.size() < (numBlocks + 1) * this->BlockSize)
+    {
+    blocks->Data.resize((numBlocks + 1) * this->BlockSize);
+    }
+  memcpy(&blocks->Data[numBlocks * this->BlockSize], data, size);
+  blocks->Sizes.push_back(size);
+
+  if ((numBlocks + 1) * this->BlockSize >= vtkXMLWriterCompressionBatchSize)
+    {
+    return this->FlushCompressionBlocks();
+    }
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+int vtkXMLWriter::FlushCompressionBlocks()
+{
+  vtkXMLWriterCompressionBlocks* blocks = this->CompressionBlocks;
+  size_t numBlocks = blocks->Sizes.size();
+  if (numBlocks == 0)
+    {
+    return 1;
+    }
 
-  // Find the compressed size.
-  size_t outputSize = outputArray->GetNumberOfTuples();
-  unsigned char* outputPointer = outputArray->GetPointer(0);
+  // Compress the data.
+  size_t compressionSpace =
+    this->Compressor->GetMaximumCompressionSpace(this->BlockSize);
+  blocks->CompressedData.resize(numBlocks * compressionSpace);
+  blocks->CompressedSizes.resize(numBlocks);
+  CompressBlocksFunctor compress;
+  compress.Compressor = this->Compressor;
+  compress.Data = &blocks->Data[0];
+  compress.BlockSize = this->BlockSize;
+  compress.Sizes = &blocks->Sizes[0];
+  compress.CompressedData = &blocks->CompressedData[0];
+  compress.CompressionSpace = compressionSpace;
+  compress.CompressedSizes = &blocks->CompressedSizes[0];
+  vtkSMPTools::For(0, static_cast<vtkIdType>(numBlocks), 1, compress);
+  blocks->Sizes.clear();
+
+  // Write the compressed data in order.
+  int result = 1;
+  for (size_t i = 0; result && i < numBlocks; ++i)
+    {
+    size_t outputSize = blocks->CompressedSizes[i];
+    if (!outputSize)
+      {
+      return 0;
+      }
+    result = this->DataStream->Write(
+      &blocks->CompressedData[i * compressionSpace], outputSize);
 
-  // Write the compressed data.
-  int result = this->DataStream->Write(outputPointer, outputSize);
+    // Store the resulting compressed size in the compression header.
+    this->CompressionHeader->Set(3+this->CompressionBlockNumber++, outputSize);
+    }
   this->Stream->flush();
   if (this->Stream->fail())
     {
     this->SetErrorCode(vtkErrorCode::GetLastSystemError());
     }
 
-  // Store the resulting compressed size in the compression header.
-  this->CompressionHeader->Set(3+this->CompressionBlockNumber++, outputSize);
-
-  outputArray->Delete();
-
   return result;
 }
 
@@ -2211,6 +2329,21 @@ void vtkXMLWriter::WriteArrayAppendedData(vtkAbstractArray* a,
                                           vtkTypeInt64 pos,
                                           vtkTypeInt64& lastoffset)
 {
+  // Align raw data on their words in the file, so that readers can use
+  // them in place in a mapping of the file in memory.
+  if (!this->EncodeAppendedData && !this->Compressor &&
+      vtkArrayDownCast<vtkDataArray>(a) && a->GetDataType() != VTK_BIT)
+    {
+    ostream& os = *(this->Stream);
+    vtkTypeInt64 dataPos =
+      static_cast<vtkTypeInt64>(os.tellp()) + this->HeaderType / 8;
+    vtkTypeInt64 wordSize = static_cast<vtkTypeInt64>(
+      this->GetOutputWordTypeSize(a->GetDataType()));
+    for (vtkTypeInt64 i = dataPos % wordSize; i > 0 && i < wordSize; ++i)
+      {
+      os.put('\0');
+      }
+    }
   this->WriteAppendedDataOffset(pos, lastoffset, "offset");
   this->WriteBinaryData(a);
 }
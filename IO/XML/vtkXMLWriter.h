@@ -46,6 +46,7 @@ class vtkStdString;
 class OffsetsManager;      // one per piece/per time
 class OffsetsManagerGroup; // array of OffsetsManager
 class OffsetsManagerArray; // array of OffsetsManagerGroup
+class vtkXMLWriterCompressionBlocks; // blocks waiting for compression
 
 class VTKIOXML_EXPORT vtkXMLWriter : public vtkAlgorithm
 {
@@ -121,7 +122,8 @@ public:
   enum CompressorType
     {
     NONE,
-    ZLIB
+    ZLIB,
+    LZ4
     };
 
   // Description:
@@ -135,6 +137,10 @@ public:
     {
     this->SetCompressorType(ZLIB);
     }
+  void SetCompressorTypeToLZ4()
+    {
+    this->SetCompressorType(LZ4);
+    }
 
   // Description:
   // Get/Set the block size used in compression.  When reading, this
@@ -270,6 +276,7 @@ protected:
   size_t CompressionBlockNumber;
   vtkXMLDataHeader* CompressionHeader;
   vtkTypeInt64 CompressionHeaderPosition;
+  vtkXMLWriterCompressionBlocks* CompressionBlocks;
 
   // The output stream used to write binary and appended data.  May
   // transparently encode the data.
@@ -405,6 +412,7 @@ protected:
   void PerformByteSwap(void* data, size_t numWords, size_t wordSize);
   int CreateCompressionHeader(size_t size);
   int WriteCompressionBlock(unsigned char* data, size_t size);
+  int FlushCompressionBlocks();
   int WriteCompressionHeader();
   size_t GetWordTypeSize(int dataType);
   const char* GetWordTypeName(int dataType);
@@ -20,20 +20,131 @@
 #include "vtkDataCompressor.h"
 #include "vtkInputStream.h"
 #include "vtkObjectFactory.h"
+#include "vtkSMPTools.h"
 #include "vtkXMLDataElement.h"
 #define vtkXMLDataHeaderPrivate_DoNotInclude
 #include "vtkXMLDataHeaderPrivate.h"
 #undef vtkXMLDataHeaderPrivate_DoNotInclude
 
+#include <algorithm>
 #include <memory>
 #include <sstream>
+#include <vector>
 
 #include "vtkXMLUtilities.h"
 
+#if !defined(_WIN32) || defined(__CYGWIN__)
+# include <fcntl.h> /* open */
+# include <sys/mman.h> /* mmap */
+# include <sys/stat.h> /* fstat */
+# include <unistd.h> /* close */
+#endif
+
 
 vtkStandardNewMacro(vtkXMLDataParser);
 vtkCxxSetObjectMacro(vtkXMLDataParser, Compressor, vtkDataCompressor);
 
+// The amount of uncompressed data whose compressed blocks are read at once
+// before being uncompressed in parallel.
+static const vtkTypeUInt64 vtkXMLDataParserBatchSize = 16777216;
+
+//----------------------------------------------------------------------------
+// Uncompresses blocks read at once from the data stream into their place
+// in the requested range of data, and byte swaps them.  The blocks which
+// are only partly requested are uncompressed into a temporary buffer.
+class vtkXMLDataParserUncompressBlocks
+{
+public:
+  vtkXMLDataParser* Parser;
+  unsigned char* Data;
+  vtkTypeUInt64 BeginOffset;
+  vtkTypeUInt64 EndOffset;
+  size_t WordSize;
+  vtkTypeUInt64 FirstBlock;
+  const unsigned char* CompressedData;
+  vtkTypeInt64 CompressedDataOffset;
+  unsigned char* Results;
+
+  void operator()(vtkIdType begin, vtkIdType end)
+    {
+    std::vector<unsigned char> blockBuffer;
+    for(vtkIdType i = begin; i < end; ++i)
+      {
+      vtkTypeUInt64 const block = this->FirstBlock + i;
+      size_t const blockSize = this->Parser->FindBlockSize(block);
+      vtkTypeUInt64 const blockBegin =
+        block*this->Parser->BlockUncompressedSize;
+      vtkTypeUInt64 const blockEnd = blockBegin + blockSize;
+      vtkTypeUInt64 const copyBegin =
+        blockBegin > this->BeginOffset ? blockBegin : this->BeginOffset;
+      vtkTypeUInt64 const copyEnd =
+        blockEnd < this->EndOffset ? blockEnd : this->EndOffset;
+      unsigned char* outputPointer =
+        this->Data + (copyBegin - this->BeginOffset);
+
+      unsigned char* buffer = outputPointer;
+      if(copyBegin != blockBegin || copyEnd != blockEnd)
+        {
+        blockBuffer.resize(blockSize);
+        buffer = &blockBuffer[0];
+        }
+      size_t const compressedSize = this->Parser->BlockCompressedSizes[block];
+      const unsigned char* compressedData = this->CompressedData +
+        (this->Parser->BlockStartOffsets[block] - this->CompressedDataOffset);
+      if(!this->Parser->Compressor->Uncompress(compressedData, compressedSize,
+                                               buffer, blockSize))
+        {
+        continue;
+        }
+      size_t const n = copyEnd - copyBegin;
+      if(buffer != outputPointer)
+        {
+        memcpy(outputPointer, buffer + (copyBegin - blockBegin), n);
+        }
+
+      // Byte swap this block.  Note that n will always be an integer
+      // multiple of the word size.
+      this->Parser->PerformByteSwap(outputPointer, n / this->WordSize,
+                                    this->WordSize);
+      this->Results[i] = 1;
+      }
+    }
+};
+
+//----------------------------------------------------------------------------
+// Keeps a part of a file mapped in memory while arrays use it.
+class vtkXMLDataParserMapping : public vtkObject
+{
+public:
+  static vtkXMLDataParserMapping* New();
+  vtkTypeMacro(vtkXMLDataParserMapping, vtkObject);
+
+  void* Address;
+  size_t Length;
+
+protected:
+  vtkXMLDataParserMapping()
+    {
+    this->Address = 0;
+    this->Length = 0;
+    }
+  ~vtkXMLDataParserMapping()
+    {
+#if !defined(_WIN32) || defined(__CYGWIN__)
+    if(this->Address)
+      {
+      munmap(this->Address, this->Length);
+      }
+#endif
+    }
+
+private:
+  vtkXMLDataParserMapping(const vtkXMLDataParserMapping&) VTK_DELETE_FUNCTION;
+  void operator=(const vtkXMLDataParserMapping&) VTK_DELETE_FUNCTION;
+};
+
+vtkStandardNewMacro(vtkXMLDataParserMapping);
+
 //----------------------------------------------------------------------------
 vtkXMLDataParser::vtkXMLDataParser()
 {
@@ -715,89 +826,70 @@ size_t vtkXMLDataParser::ReadCompressedData(unsigned char* data,
 
   // Find the range of compression blocks to read.
   vtkTypeUInt64 firstBlock = beginOffset / this->BlockUncompressedSize;
-  vtkTypeUInt64 lastBlock = endOffset / this->BlockUncompressedSize;
-
-  // Find the offset into the first block where the data begin.
-  size_t beginBlockOffset =
-    beginOffset - firstBlock*this->BlockUncompressedSize;
+  vtkTypeUInt64 endBlock =
+    (endOffset + this->BlockUncompressedSize - 1) / this->BlockUncompressedSize;
+
+  // Read the compressed data of a few blocks at a time, and uncompress
+  // these blocks in parallel directly into their place in the output.
+  vtkTypeUInt64 blocksPerBatch = vtkXMLDataParserBatchSize /
+    this->BlockUncompressedSize;
+  if(blocksPerBatch < 1)
+    {
+    blocksPerBatch = 1;
+    }
+  std::vector<unsigned char> compressedData;
+  std::vector<unsigned char> results;
 
-  // Find the offset into the last block where the data end.
-  size_t endBlockOffset =
-    endOffset - lastBlock*this->BlockUncompressedSize;
+  vtkXMLDataParserUncompressBlocks uncompressBlocks;
+  uncompressBlocks.Parser = this;
+  uncompressBlocks.Data = data;
+  uncompressBlocks.BeginOffset = beginOffset;
+  uncompressBlocks.EndOffset = endOffset;
+  uncompressBlocks.WordSize = wordSize;
 
   this->UpdateProgress(0);
-  if(firstBlock == lastBlock)
-    {
-    // Everything fits in one block.
-    unsigned char* blockBuffer = this->ReadBlock(firstBlock);
-    if(!blockBuffer) { return 0; }
-    size_t n = endBlockOffset - beginBlockOffset;
-    memcpy(data, blockBuffer+beginBlockOffset, n);
-    delete [] blockBuffer;
-
-    // Byte swap this block.  Note that n will always be an integer
-    // multiple of the word size.
-    this->PerformByteSwap(data, n / wordSize, wordSize);
-    }
-  else
+  for(vtkTypeUInt64 batchBegin = firstBlock;
+      batchBegin < endBlock && !this->Abort; batchBegin += blocksPerBatch)
     {
-    // Read all the complete blocks first.
-    size_t length = endOffset - beginOffset;
-    unsigned char* outputPointer = data;
-    size_t blockSize = this->FindBlockSize(firstBlock);
+    vtkTypeUInt64 batchEnd = batchBegin + blocksPerBatch;
+    if(batchEnd > endBlock)
+      {
+      batchEnd = endBlock;
+      }
 
-    // Read the first block.
-    unsigned char* blockBuffer = this->ReadBlock(firstBlock);
-    if(!blockBuffer)
+    // The compressed blocks are stored one after another.
+    vtkTypeInt64 const batchOffset = this->BlockStartOffsets[batchBegin];
+    size_t const batchSize = static_cast<size_t>(
+      this->BlockStartOffsets[batchEnd-1] - batchOffset +
+      this->BlockCompressedSizes[batchEnd-1]);
+    compressedData.resize(batchSize);
+    if(!this->DataStream->Seek(batchOffset) ||
+       (batchSize > 0 &&
+        this->DataStream->Read(&compressedData[0], batchSize) < batchSize))
       {
       return 0;
       }
-    size_t n = blockSize-beginBlockOffset;
-    memcpy(outputPointer, blockBuffer+beginBlockOffset, n);
-    delete [] blockBuffer;
 
-    // Byte swap the first block.  Note that n will always be an
-    // integer multiple of the word size.
-    this->PerformByteSwap(outputPointer, n / wordSize, wordSize);
-
-    // Advance the pointer to the beginning of the second block.
-    outputPointer += blockSize-beginBlockOffset;
-
-    // Report progress.
-    this->UpdateProgress(float(outputPointer-data)/length);
-
-    unsigned int currentBlock = firstBlock+1;
-    for(;currentBlock != lastBlock && !this->Abort; ++currentBlock)
+    results.assign(batchEnd - batchBegin, 0);
+    uncompressBlocks.FirstBlock = batchBegin;
+    uncompressBlocks.CompressedData =
+      batchSize > 0 ? &compressedData[0] : 0;
+    uncompressBlocks.CompressedDataOffset = batchOffset;
+    uncompressBlocks.Results = &results[0];
+    vtkSMPTools::For(0, static_cast<vtkIdType>(batchEnd - batchBegin), 1,
+                     uncompressBlocks);
+    if(std::find(results.begin(), results.end(), 0) != results.end())
       {
-      // Read this block.
-      if(!this->ReadBlock(currentBlock, outputPointer)) { return 0; }
-
-      // Byte swap this block.  Note that blockSize will always be an
-      // integer multiple of the word size.
-      this->PerformByteSwap(outputPointer, blockSize / wordSize, wordSize);
-
-      // Advance the pointer to the beginning of the next block.
-      outputPointer += this->FindBlockSize(currentBlock);
-
-      // Report progress.
-      this->UpdateProgress(float(outputPointer-data)/length);
+      return 0;
       }
 
-    // Now read the final block, which is incomplete if it exists.
-    if(endBlockOffset > 0 && !this->Abort)
+    // Report progress.
+    vtkTypeUInt64 readEnd = batchEnd*this->BlockUncompressedSize;
+    if(readEnd > endOffset)
       {
-      blockBuffer = this->ReadBlock(lastBlock);
-      if(!blockBuffer)
-        {
-        return 0;
-        }
-      memcpy(outputPointer, blockBuffer, endBlockOffset);
-      delete [] blockBuffer;
-
-      // Byte swap the partial block.  Note that endBlockOffset will
-      // always be an integer multiple of the word size.
-      this->PerformByteSwap(outputPointer, endBlockOffset / wordSize, wordSize);
+      readEnd = endOffset;
       }
+    this->UpdateProgress(float(readEnd-beginOffset)/(endOffset-beginOffset));
     }
   this->UpdateProgress(1);
 
@@ -926,6 +1018,102 @@ size_t vtkXMLDataParser::ReadAppendedData(vtkTypeInt64 offset,
   return this->ReadBinaryData(buffer, startWord, numWords, wordType);
 }
 
+//----------------------------------------------------------------------------
+void* vtkXMLDataParser::MapAppendedData(vtkTypeInt64 offset,
+                                        size_t numWords,
+                                        int wordType,
+                                        vtkObjectBase*& mapping)
+{
+  mapping = 0;
+#if !defined(_WIN32) || defined(__CYGWIN__)
+  size_t wordSize = this->GetWordTypeSize(wordType);
+#ifdef VTK_WORDS_BIGENDIAN
+  bool swap = (wordSize > 1 && this->ByteOrder != vtkXMLDataParser::BigEndian);
+#else
+  bool swap =
+    (wordSize > 1 && this->ByteOrder != vtkXMLDataParser::LittleEndian);
+#endif
+  if(!this->FileName || this->Compressor || swap || numWords == 0 ||
+     this->AppendedDataStream->IsA("vtkBase64InputStream") || this->Abort)
+    {
+    return 0;
+    }
+
+  // Read the length of the data, which must hold all the words.
+#if defined(VTK_HAS_STD_UNIQUE_PTR)
+  std::unique_ptr<vtkXMLDataHeader>
+    uh(vtkXMLDataHeader::New(this->HeaderType, 1));
+#else
+  std::auto_ptr<vtkXMLDataHeader>
+    uh(vtkXMLDataHeader::New(this->HeaderType, 1));
+#endif
+  size_t const headerSize = uh->DataSize();
+  this->DataStream = this->AppendedDataStream;
+  this->DataStream->SetStream(this->Stream);
+  this->SeekG(this->AppendedDataPosition+offset);
+  this->DataStream->StartReading();
+  size_t r = this->DataStream->Read(uh->Data(), headerSize);
+  this->DataStream->EndReading();
+  if(r < headerSize)
+    {
+    return 0;
+    }
+  this->PerformByteSwap(uh->Data(), uh->WordCount(), uh->WordSize());
+  vtkTypeUInt64 const length = numWords*wordSize;
+  if(uh->Get(0) < length)
+    {
+    return 0;
+    }
+
+  // The mapping starts on a page, so the data must be aligned in the file.
+  vtkTypeUInt64 const begin = this->AppendedDataPosition+offset+headerSize;
+  if(begin % wordSize != 0)
+    {
+    return 0;
+    }
+  vtkTypeUInt64 const pageSize = sysconf(_SC_PAGESIZE);
+  vtkTypeUInt64 const mapBegin = begin - begin % pageSize;
+  vtkTypeUInt64 const mapLength = begin + length - mapBegin;
+  if(static_cast<vtkTypeUInt64>(static_cast<size_t>(mapLength)) != mapLength ||
+     static_cast<vtkTypeUInt64>(static_cast<off_t>(mapBegin)) != mapBegin)
+    {
+    return 0;
+    }
+
+  int fd = open(this->FileName, O_RDONLY);
+  if(fd < 0)
+    {
+    return 0;
+    }
+  // Pages past the end of the file cannot be accessed.  Private pages let
+  // the arrays be modified without changing the file.
+  void* address = MAP_FAILED;
+  struct stat fs;
+  if(fstat(fd, &fs) == 0 &&
+     static_cast<vtkTypeUInt64>(fs.st_size) >= begin + length)
+    {
+    address = mmap(0, static_cast<size_t>(mapLength), PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE, fd, static_cast<off_t>(mapBegin));
+    }
+  close(fd);
+  if(address == MAP_FAILED)
+    {
+    return 0;
+    }
+
+  vtkXMLDataParserMapping* fileMapping = vtkXMLDataParserMapping::New();
+  fileMapping->Address = address;
+  fileMapping->Length = static_cast<size_t>(mapLength);
+  mapping = fileMapping;
+  return static_cast<unsigned char*>(address) + (begin - mapBegin);
+#else
+  static_cast<void>(offset);
+  static_cast<void>(numWords);
+  static_cast<void>(wordType);
+  return 0;
+#endif
+}
+
 //----------------------------------------------------------------------------
 //----------------------------------------------------------------------------
 // Define a parsing function template.  The extra "long" argument is used
@@ -72,6 +72,18 @@ public:
   { return this->ReadAppendedData(offset, buffer, startWord, numWords,
                                     VTK_CHAR); }
 
+  // Description:
+  // Map in memory the raw uncompressed appended data at the given
+  // appended data offset instead of reading them.  The file named by
+  // FileName is mapped when the data are stored in the byte order of this
+  // machine and aligned for their type.  Returns a pointer to the first
+  // numWords words, whose pages are read from the file when first
+  // accessed, or 0 if the data cannot be mapped.  The pointer is valid as
+  // long as the returned mapping object exists, whose reference is given
+  // to the caller.
+  void* MapAppendedData(vtkTypeInt64 offset, size_t numWords, int wordType,
+                        vtkObjectBase*& mapping);
+
   // Description:
   // Read from an ascii data section starting at the current position in
   // the stream.  Returns the number of words read.
@@ -236,6 +248,8 @@ protected:
 
   int AttributesEncoding;
 
+  friend class vtkXMLDataParserUncompressBlocks;
+
 private:
   vtkXMLDataParser(const vtkXMLDataParser&) VTK_DELETE_FUNCTION;
   void operator=(const vtkXMLDataParser&) VTK_DELETE_FUNCTION;